@@ -50,6 +50,22 @@ PHI_DEFINE_EXPORTED_int32(paddle_num_threads,
                           1,
                           "Number of threads for each paddle instance.");
 
+/**
+ * CPU related FLAG
+ * Name: FLAGS_cpu_intra_op_num_threads
+ * Since Version: 3.0.0
+ * Value Range: int32, default=0
+ * Example: FLAGS_cpu_intra_op_num_threads=8, the CPU kernels of the process
+ * share 8 threads, the calling one included.
+ * Note: The size of the intra-op thread pool shared by the CPUContexts, which
+ * runs phi::funcs::ParallelFor. 0 means the number of cpus.
+ */
+PHI_DEFINE_EXPORTED_int32(cpu_intra_op_num_threads,
+                          0,
+                          "The number of threads of the shared intra-op "
+                          "thread pool of the CPU kernels, 0 for the number "
+                          "of cpus");
+
 /**
  * Low Precision Op related FLAG
  * Name: FLAGS_low_precision_op_list
@@ -468,6 +484,52 @@ PHI_DEFINE_EXPORTED_string(
     "on the same GPU card but may lead to more memory fragmentation "
     "(i.e., maximum batch size of models may be smaller).");
 
+/**
+ * Allocator related FLAG
+ * Name: FLAGS_cpu_allocator_strategy
+ * Since Version: 3.0.0
+ * Value Range: string, {system, pooled}, default=system
+ * Example: FLAGS_cpu_allocator_strategy=pooled
+ * Note: For selecting the allocator of CPUPlace. system allocates every
+ *       tensor with posix_memalign and frees it right away. pooled keeps the
+ *       freed blocks in size class free lists with per-thread caches, which
+ *       avoids the allocator calls and page faults of repeated runs.
+ */
+PHI_DEFINE_EXPORTED_string(
+    cpu_allocator_strategy,
+    "system",
+    "The allocation strategy of CPUPlace, enum in [system, pooled].");
+
+/**
+ * Allocator related FLAG
+ * Name: FLAGS_pooled_cpu_allocator_max_cached_mb
+ * Since Version: 3.0.0
+ * Value Range: int64, default=1024
+ * Example: FLAGS_pooled_cpu_allocator_max_cached_mb=256
+ * Note: The free blocks cached by the pooled cpu allocator are released to
+ *       the system once they exceed this size, in MB.
+ */
+PHI_DEFINE_EXPORTED_int64(
+    pooled_cpu_allocator_max_cached_mb,
+    1024,
+    "The free memory cached by the pooled cpu allocator beyond which blocks "
+    "are released to the system, in MB.");
+
+/**
+ * Allocator related FLAG
+ * Name: FLAGS_pooled_cpu_allocator_use_huge_page
+ * Since Version: 3.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_pooled_cpu_allocator_use_huge_page=true
+ * Note: Back the blocks of at least 2MB of the pooled cpu allocator with
+ *       transparent huge pages. Only works on Linux with THP enabled.
+ */
+PHI_DEFINE_EXPORTED_bool(
+    pooled_cpu_allocator_use_huge_page,
+    false,
+    "Whether to advise huge pages for large blocks of the pooled cpu "
+    "allocator.");
+
 /**
  * Memory related FLAG
  * Name: FLAGS_fraction_of_cpu_memory_to_use
@@ -1143,6 +1205,73 @@ PHI_DEFINE_EXPORTED_uint64(executor_log_deps_every_microseconds,
                            0,
                            "Enable new executor log deps every n microseconds");
 
+/*
+ * Executor related FLAG
+ * Name: FLAGS_new_executor_work_stealing
+ * Since Version: 3.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_new_executor_work_stealing=true
+ * Note: If True, a host thread of the new executor runs the first ready
+ * successor of an instruction itself and pushes the other ready successors
+ * onto its own queue at once, where idle threads steal them. Parked threads
+ * are only woken up for the tasks the spinning threads can not take.
+ */
+PHI_DEFINE_EXPORTED_bool(new_executor_work_stealing,
+                         false,
+                         "Schedule the host instructions of the new executor "
+                         "by continuation and work stealing");
+
+/*
+ * Executor related FLAG
+ * Name: FLAGS_new_executor_scheduler_stats
+ * Since Version: 3.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_new_executor_scheduler_stats=true
+ * Note: If True, the worker threads of the new executor count their tasks,
+ * steals, wakeups, parks, idle time and queue depth. The totals are written
+ * to FLAGS_static_executor_perfstat_filepath. Off by default since every
+ * task then pays a few atomic updates and clock reads.
+ */
+PHI_DEFINE_EXPORTED_bool(new_executor_scheduler_stats,
+                         false,
+                         "Collect the scheduler statistics of the worker "
+                         "threads of the new executor");
+
+/*
+ * Executor related FLAG
+ * Name: FLAGS_new_executor_gc_batch_size
+ * Since Version: 3.0.0
+ * Value Range: int32, default=0
+ * Example: FLAGS_new_executor_gc_batch_size=64
+ * Note: If greater than 0, the garbage collector of the new executor keeps
+ * the variables freed by each thread in a list of that thread, and releases
+ * a list at once when it holds that many garbages or the run finishes,
+ * instead of taking the lock of the collector for every variable.
+ */
+PHI_DEFINE_EXPORTED_int32(new_executor_gc_batch_size,
+                          0,
+                          "The number of garbages a thread of the new "
+                          "executor collects before releasing them at once, "
+                          "0 to release each one");
+
+/*
+ * Executor related FLAG
+ * Name: FLAGS_new_executor_instruction_priority
+ * Since Version: 3.0.0
+ * Value Range: string, {"fifo", "critical_path"}, default="fifo"
+ * Example: FLAGS_new_executor_instruction_priority="critical_path"
+ * Note: The order in which the new executor runs the ready instructions.
+ * "fifo": the ready instruction that comes first in the program goes first.
+ * "critical_path": the ready instruction with the longest remaining path to
+ * the end of the program goes first, the path is weighted by the number of
+ * elements each instruction reads and writes. The scheduling_priority
+ * attribute of an op takes precedence in both cases.
+ */
+PHI_DEFINE_EXPORTED_string(new_executor_instruction_priority,
+                           "fifo",
+                           "The order of the ready instructions in the new "
+                           "executor, fifo or critical_path");
+
 PD_DEFINE_int32(record_pool_max_size,
                 2000000,
                 "SlotRecordDataset slot record pool max size");
@@ -1158,6 +1287,36 @@ PD_DEFINE_bool(enable_slotrecord_reset_shrink,  // NOLINT
 PD_DEFINE_bool(enable_ins_parser_file,  // NOLINT
                false,
                "enable parser ins file, default false");
+
+/**
+ * Dataset related FLAG
+ * Name: FLAGS_dataset_shuffle_spill_dir
+ * Since Version: 3.0.0
+ * Value Range: string, default=""
+ * Example: FLAGS_dataset_shuffle_spill_dir=/tmp/shuffle
+ * Note: When set, InMemoryDataset.local_shuffle spills the records to bucket
+ *       files in this local directory and shuffles one bucket at a time,
+ *       instead of shuffling all records in memory at once. global_shuffle
+ *       is not affected and still shuffles across trainers in memory.
+ */
+PHI_DEFINE_EXPORTED_string(dataset_shuffle_spill_dir,
+                           "",
+                           "Local directory of the external bucketed shuffle "
+                           "of InMemoryDataset, empty to shuffle in memory.");
+
+/**
+ * Dataset related FLAG
+ * Name: FLAGS_dataset_shuffle_memory_mb
+ * Since Version: 3.0.0
+ * Value Range: int64_t, default=1024
+ * Example:
+ * Note: Upper bound in MB of the spill buffers and of the buckets loaded at
+ *       the same time by the external shuffle, the number of buckets is
+ *       chosen to stay within it. A dataset that does not fit is refused.
+ */
+PHI_DEFINE_EXPORTED_int64(dataset_shuffle_memory_mb,
+                          1024,
+                          "Memory bound in MB of the external shuffle.");
 PHI_DEFINE_EXPORTED_bool(
     gpugraph_enable_hbm_table_collision_stat,
     false,
@@ -1490,6 +1649,69 @@ PHI_DEFINE_EXPORTED_bool(enable_pir_in_executor_trace_run,
                          false,
                          "Enable PIR in executor");
 
+/**
+ * Using PIR in executor FLAG
+ * Name: enable_pir_static_memory_plan
+ * Since Version: 3.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_enable_pir_static_memory_plan=true
+ * Note: If True, the PIR interpreter running in trace mode on CPU plans the
+ * intermediate DenseTensors of fixed shapes into one arena after the first
+ * run, so the later runs do not call the allocator for them.
+ */
+PHI_DEFINE_EXPORTED_bool(enable_pir_static_memory_plan,
+                         false,
+                         "Plan the intermediate tensors of the pir "
+                         "interpreter into one arena");
+
+/**
+ * Using PIR in executor FLAG
+ * Name: enable_pir_frozen_trace_run
+ * Since Version: 3.0.0
+ * Value Range: bool, default=false
+ * Example: FLAGS_enable_pir_frozen_trace_run=true
+ * Note: If True, the PIR interpreter running in trace mode on CPU freezes the
+ * execution order after the first run. The later runs call the cached phi
+ * kernels with their prebuilt contexts and skip InferMeta while the metas of
+ * the inputs and outputs are unchanged. It implies
+ * FLAGS_enable_pir_static_memory_plan.
+ */
+PHI_DEFINE_EXPORTED_bool(enable_pir_frozen_trace_run,
+                         false,
+                         "Replay the trace of the pir interpreter with the "
+                         "cached kernel contexts");
+
+/**
+ * Using PIR in executor FLAG
+ * Name: pir_shape_bucket_policy
+ * Since Version: 3.0.0
+ * Value Range: string, default=""
+ * Example: FLAGS_pir_shape_bucket_policy="pow2"
+ * Note: If not empty, the PIR interpreter running in trace mode on CPU keeps
+ * a static memory plan and a frozen trace for each bucket of the input
+ * shapes, so a request reuses the state warmed by an earlier one of the same
+ * bucket. The dims are rounded up with one of "exact", "pow2", "step:<n>" or
+ * "boundaries:<b0>,<b1>,...".
+ */
+PHI_DEFINE_EXPORTED_string(pir_shape_bucket_policy,
+                           "",
+                           "The bucket policy of the input shapes of the "
+                           "pir interpreter, empty to disable");
+
+/**
+ * Using PIR in executor FLAG
+ * Name: pir_shape_bucket_capacity
+ * Since Version: 3.0.0
+ * Value Range: int32, default=8
+ * Example: FLAGS_pir_shape_bucket_capacity=16
+ * Note: The number of shape buckets a PIR interpreter keeps, the least
+ * recently used one is dropped beyond it.
+ */
+PHI_DEFINE_EXPORTED_int32(pir_shape_bucket_capacity,
+                          8,
+                          "The number of shape buckets kept by the pir "
+                          "interpreter");
+
 /**
  * Apply inplace pass to PIR FLAG
  * Name: pir_apply_inplace_pass
@@ -89,5 +89,23 @@ class CostTimer {
   uint64_t _start_time_ms;
   CostProfilerNode* _profiler_node;
 };
+
+// Records microseconds, for calls that usually finish within a millisecond.
+class CostTimerUs {
+ public:
+  explicit CostTimerUs(const std::string& label) {
+    _profiler_node = CostProfiler::instance().profiler(label);
+    _start_time_us = butil::gettimeofday_us();
+  }
+  ~CostTimerUs() {
+    if (_profiler_node != NULL) {
+      *(_profiler_node->recorder) << butil::gettimeofday_us() - _start_time_us;
+    }
+  }
+
+ private:
+  uint64_t _start_time_us;
+  CostProfilerNode* _profiler_node;
+};
 }  // namespace distributed
 }  // namespace paddle
@@ -14,6 +14,8 @@
 
 #include "paddle/fluid/distributed/ps/table/ctr_accessor.h"
 
+#include <algorithm>
+
 #include "glog/logging.h"
 #include "paddle/common/flags.h"
 #include "paddle/utils/string/string_helper.h"
@@ -245,39 +247,58 @@ int32_t CtrCommonAccessor::Merge(float** update_values,
 int32_t CtrCommonAccessor::Update(float** update_values,
                                   const float** push_values,
                                   size_t num) {
-  for (size_t value_item = 0; value_item < num; ++value_item) {
-    float* update_value = update_values[value_item];
-    const float* push_value = push_values[value_item];
-    float push_show = push_value[CtrCommonPushValue::ShowIndex()];
-    float push_click = push_value[CtrCommonPushValue::ClickIndex()];
-    float slot = push_value[CtrCommonPushValue::SlotIndex()];
-    update_value[common_feature_value.ShowIndex()] += push_show;
-    update_value[common_feature_value.ClickIndex()] += push_click;
-    update_value[common_feature_value.SlotIndex()] = slot;
-    update_value[common_feature_value.DeltaScoreIndex()] +=
-        (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
-        push_click * _config.ctr_accessor_param().click_coeff();
-    update_value[common_feature_value.UnseenDaysIndex()] = 0;
-    // TODO(zhaocaibei123): add configure show_scale
-    if (!_show_scale) {
-      push_show = 1;
+  // the stat fields are updated row by row, then each sgd rule runs over the
+  // whole batch so it is dispatched once and can prefetch the next rows
+  const size_t kBatchSize = 256;
+  float push_shows[kBatchSize];  // NOLINT
+  for (size_t begin = 0; begin < num; begin += kBatchSize) {
+    size_t batch_size = std::min(kBatchSize, num - begin);
+    float** batch_values = update_values + begin;
+    const float** batch_push_values = push_values + begin;
+    for (size_t value_item = 0; value_item < batch_size; ++value_item) {
+      push_shows[value_item] = UpdateShowClick(batch_values[value_item],
+                                               batch_push_values[value_item]);
     }
-    VLOG(3) << "accessor show scale:" << _show_scale
-            << ", push_show:" << push_show;
-    _embed_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedWIndex(),
-        update_value + common_feature_value.EmbedG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedGIndex(),
-        push_show);
-    _embedx_sgd_rule->UpdateValue(
-        update_value + common_feature_value.EmbedxWIndex(),
-        update_value + common_feature_value.EmbedxG2SumIndex(),
-        push_value + CtrCommonPushValue::EmbedxGIndex(),
-        push_show);
+    _embed_sgd_rule->UpdateValueBatch(batch_values,
+                                      common_feature_value.EmbedWIndex(),
+                                      common_feature_value.EmbedG2SumIndex(),
+                                      batch_push_values,
+                                      CtrCommonPushValue::EmbedGIndex(),
+                                      push_shows,
+                                      batch_size);
+    _embedx_sgd_rule->UpdateValueBatch(
+        batch_values,
+        common_feature_value.EmbedxWIndex(),
+        common_feature_value.EmbedxG2SumIndex(),
+        batch_push_values,
+        CtrCommonPushValue::EmbedxGIndex(),
+        push_shows,
+        batch_size);
   }
   return 0;
 }
 
+float CtrCommonAccessor::UpdateShowClick(float* update_value,
+                                         const float* push_value) {
+  float push_show = push_value[CtrCommonPushValue::ShowIndex()];
+  float push_click = push_value[CtrCommonPushValue::ClickIndex()];
+  float slot = push_value[CtrCommonPushValue::SlotIndex()];
+  update_value[common_feature_value.ShowIndex()] += push_show;
+  update_value[common_feature_value.ClickIndex()] += push_click;
+  update_value[common_feature_value.SlotIndex()] = slot;
+  update_value[common_feature_value.DeltaScoreIndex()] +=
+      (push_show - push_click) * _config.ctr_accessor_param().nonclk_coeff() +
+      push_click * _config.ctr_accessor_param().click_coeff();
+  update_value[common_feature_value.UnseenDaysIndex()] = 0;
+  // TODO(zhaocaibei123): add configure show_scale
+  if (!_show_scale) {
+    push_show = 1;
+  }
+  VLOG(3) << "accessor show scale:" << _show_scale
+          << ", push_show:" << push_show;
+  return push_show;
+}
+
 bool CtrCommonAccessor::CreateValue(int stage, const float* value) {
   // stage == 0, pull
   // stage == 1, push
@@ -187,7 +187,10 @@ class CtrCommonAccessor : public ValueAccessor {
     return 0.0;
   }
 
- private:
+ protected:
+  // update the show/click stats of a value from a push value, return the
+  // show used to scale the gradients
+  float UpdateShowClick(float* update_value, const float* push_value);
   // float ShowClickScore(float show, float click);
 
   // SparseValueSGDRule* _embed_sgd_rule;
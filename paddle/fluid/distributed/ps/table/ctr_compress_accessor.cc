@@ -0,0 +1,205 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/ps/table/ctr_compress_accessor.h"
+
+#include <sstream>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/utils/string/string_helper.h"
+
+namespace paddle::distributed {
+
+int CtrCompressAccessor::Initialize() {
+  auto weight_type = _config.ctr_accessor_param().embedx_weight_type();
+  if (!ParseEmbeddingQuantType(weight_type,
+                               &compress_feature_value.weight_type)) {
+    LOG(ERROR) << "CtrCompressAccessor unknown embedx_weight_type "
+               << weight_type << ", expect fp16, bf16 or int8";
+    return -1;
+  }
+  // sets up common_feature_value and calls InitAccessorInfo
+  return CtrCommonAccessor::Initialize();
+}
+
+void CtrCompressAccessor::InitAccessorInfo() {
+  compress_feature_value.embed_sgd_dim = common_feature_value.embed_sgd_dim;
+  compress_feature_value.embedx_dim = common_feature_value.embedx_dim;
+  compress_feature_value.embedx_sgd_dim = common_feature_value.embedx_sgd_dim;
+  _accessor_info.dim = compress_feature_value.Dim();
+  _accessor_info.size = compress_feature_value.Size();
+
+  auto embedx_dim = _config.embedx_dim();
+  _accessor_info.select_dim = 3 + embedx_dim;
+  _accessor_info.select_size = _accessor_info.select_dim * sizeof(float);
+  _accessor_info.update_dim = 4 + embedx_dim;
+  _accessor_info.update_size = _accessor_info.update_dim * sizeof(float);
+  _accessor_info.mf_size =
+      (compress_feature_value.Dim() -
+       compress_feature_value.EmbedxG2SumIndex()) *
+      sizeof(float);
+  VLOG(1) << "CtrCompressAccessor embedx_weight_type "
+          << EmbeddingQuantTypeName(compress_feature_value.weight_type)
+          << ", value dim " << _accessor_info.dim << " vs "
+          << common_feature_value.Dim() << " in fp32";
+}
+
+bool CtrCompressAccessor::HasMF(int size) {
+  return size > compress_feature_value.EmbedxG2SumIndex();
+}
+
+int32_t CtrCompressAccessor::Create(float** values, size_t num) {
+  auto& layout = compress_feature_value;
+  thread_local std::vector<float> embedx_w;
+  embedx_w.resize(layout.embedx_dim);
+  bool zero_init = _config.ctr_accessor_param().zero_init();
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* value = values[value_item];
+    value[common_feature_value.UnseenDaysIndex()] = 0;
+    value[common_feature_value.DeltaScoreIndex()] = 0;
+    value[common_feature_value.ShowIndex()] = 0;
+    value[common_feature_value.ClickIndex()] = 0;
+    value[common_feature_value.SlotIndex()] = -1;
+    _embed_sgd_rule->InitValue(value + layout.EmbedWIndex(),
+                               value + layout.EmbedG2SumIndex(),
+                               zero_init);
+    _embedx_sgd_rule->InitValue(
+        embedx_w.data(), value + layout.EmbedxG2SumIndex(), false);
+    QuantizeEmbedding(layout.weight_type,
+                      embedx_w.data(),
+                      layout.embedx_dim,
+                      false,
+                      value + layout.EmbedxWIndex());
+  }
+  return 0;
+}
+
+// from CtrCompressFeatureValue to CtrCommonPullValue
+int32_t CtrCompressAccessor::Select(float** select_values,
+                                    const float** values,
+                                    size_t num) {
+  auto& layout = compress_feature_value;
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* select_value = select_values[value_item];
+    const float* value = values[value_item];
+    select_value[CtrCommonPullValue::ShowIndex()] =
+        value[common_feature_value.ShowIndex()];
+    select_value[CtrCommonPullValue::ClickIndex()] =
+        value[common_feature_value.ClickIndex()];
+    select_value[CtrCommonPullValue::EmbedWIndex()] =
+        value[layout.EmbedWIndex()];
+    DequantizeEmbedding(layout.weight_type,
+                        value + layout.EmbedxWIndex(),
+                        layout.embedx_dim,
+                        select_value + CtrCommonPullValue::EmbedxWIndex());
+  }
+  return 0;
+}
+
+// from CtrCommonPushValue to CtrCompressFeatureValue, the embedx weights
+// are updated in fp32 and requantized with stochastic rounding
+int32_t CtrCompressAccessor::Update(float** update_values,
+                                    const float** push_values,
+                                    size_t num) {
+  auto& layout = compress_feature_value;
+  thread_local std::vector<float> embedx_w;
+  embedx_w.resize(layout.embedx_dim);
+  for (size_t value_item = 0; value_item < num; ++value_item) {
+    float* update_value = update_values[value_item];
+    const float* push_value = push_values[value_item];
+    float push_show = UpdateShowClick(update_value, push_value);
+    _embed_sgd_rule->UpdateValue(
+        update_value + layout.EmbedWIndex(),
+        update_value + layout.EmbedG2SumIndex(),
+        push_value + CtrCommonPushValue::EmbedGIndex(),
+        push_show);
+    DequantizeEmbedding(layout.weight_type,
+                        update_value + layout.EmbedxWIndex(),
+                        layout.embedx_dim,
+                        embedx_w.data());
+    _embedx_sgd_rule->UpdateValue(
+        embedx_w.data(),
+        update_value + layout.EmbedxG2SumIndex(),
+        push_value + CtrCommonPushValue::EmbedxGIndex(),
+        push_show);
+    QuantizeEmbedding(layout.weight_type,
+                      embedx_w.data(),
+                      layout.embedx_dim,
+                      true,
+                      update_value + layout.EmbedxWIndex());
+  }
+  return 0;
+}
+
+// same text format as CtrCommonAccessor, embedx_w is written dequantized
+std::string CtrCompressAccessor::ParseToString(const float* v, int param) {
+  auto& layout = compress_feature_value;
+  thread_local std::ostringstream os;
+  os.clear();
+  os.str("");
+  os << v[0] << " " << v[1] << " " << v[2] << " " << v[3] << " " << v[4] << " "
+     << v[5];
+  for (int i = layout.EmbedG2SumIndex(); i < layout.EmbedxG2SumIndex(); i++) {
+    os << " " << v[i];
+  }
+  auto show = common_feature_value.Show(const_cast<float*>(v));
+  auto click = common_feature_value.Click(const_cast<float*>(v));
+  auto score = ShowClickScore(show, click);
+  if (score >= _config.embedx_threshold() && HasMF(param)) {
+    thread_local std::vector<float> embedx_w;
+    embedx_w.resize(layout.embedx_dim);
+    DequantizeEmbedding(layout.weight_type,
+                        v + layout.EmbedxWIndex(),
+                        layout.embedx_dim,
+                        embedx_w.data());
+    for (auto w : embedx_w) {
+      os << " " << w;
+    }
+    for (auto i = layout.EmbedxG2SumIndex(); i < layout.EmbedxWIndex(); ++i) {
+      os << " " << v[i];
+    }
+  }
+  return os.str();
+}
+
+int CtrCompressAccessor::ParseFromString(const std::string& str,
+                                         float* value) {
+  auto& layout = compress_feature_value;
+  // parse into the fp32 layout of CtrCommonAccessor first
+  thread_local std::vector<float> buffer;
+  buffer.resize(common_feature_value.Dim());
+  float* common_value = buffer.data();
+  _embedx_sgd_rule->InitValue(
+      common_value + common_feature_value.EmbedxWIndex(),
+      common_value + common_feature_value.EmbedxG2SumIndex());
+  auto ret = paddle::string::str_to_float(str.data(), common_value);
+  CHECK(ret >= 6) << "expect more than 6 real:" << ret;
+  // slot to embed_g2sum share the same layout
+  memcpy(value, common_value, layout.EmbedxG2SumIndex() * sizeof(float));
+  if (ret <= common_feature_value.EmbedxWIndex()) {
+    return ret;
+  }
+  memcpy(value + layout.EmbedxG2SumIndex(),
+         common_value + common_feature_value.EmbedxG2SumIndex(),
+         layout.embedx_sgd_dim * sizeof(float));
+  QuantizeEmbedding(layout.weight_type,
+                    common_value + common_feature_value.EmbedxWIndex(),
+                    layout.embedx_dim,
+                    false,
+                    value + layout.EmbedxWIndex());
+  return layout.Dim();
+}
+
+}  // namespace paddle::distributed
@@ -0,0 +1,83 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps/table/ctr_accessor.h"
+#include "paddle/fluid/distributed/ps/table/depends/embedding_quant.h"
+
+namespace paddle {
+namespace distributed {
+
+// CtrCommonAccessor with the embedx weights stored in fp16, bf16 or int8
+// with a per row scale, chosen by ctr_accessor_param.embedx_weight_type.
+// The optimizer state stays in fp32, weights are dequantized on pull and
+// requantized with stochastic rounding after every push.
+//
+// Pull and push values, and the text checkpoints, are the same as
+// CtrCommonAccessor, so the two accessors can load each other's models.
+class CtrCompressAccessor : public CtrCommonAccessor {
+ public:
+  struct CtrCompressFeatureValue {
+    /*
+       float slot;
+       float unseen_days;
+       float delta_score;
+       float show;
+       float click;
+       float embed_w;
+       std::vector<float> embed_g2sum;
+       std::vector<float> embedx_g2sum;
+       packed embedx_w, see embedding_quant.h
+       */
+
+    int Dim() { return EmbedxWIndex() + EmbedxWDim(); }
+    int Size() { return Dim() * sizeof(float); }
+    int EmbedWIndex() { return 5; }
+    int EmbedG2SumIndex() { return EmbedWIndex() + 1; }
+    int EmbedxG2SumIndex() { return EmbedG2SumIndex() + embed_sgd_dim; }
+    int EmbedxWIndex() { return EmbedxG2SumIndex() + embedx_sgd_dim; }
+    int EmbedxWDim() { return QuantizedFloatNum(weight_type, embedx_dim); }
+
+    int embed_sgd_dim;
+    int embedx_dim;
+    int embedx_sgd_dim;
+    EmbeddingQuantType weight_type;
+  };
+
+  CtrCompressAccessor() {}
+  virtual ~CtrCompressAccessor() {}
+  int Initialize() override;
+  void InitAccessorInfo() override;
+  bool HasMF(int size) override;
+  int32_t Create(float** value, size_t num) override;
+  int32_t Select(float** select_values,
+                 const float** values,
+                 size_t num) override;
+  int32_t Update(float** values,
+                 const float** update_values,
+                 size_t num) override;
+
+  std::string ParseToString(const float* value, int param) override;
+  int32_t ParseFromString(const std::string& str, float* v) override;
+
+  CtrCompressFeatureValue compress_feature_value;
+};
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,302 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace paddle {
+namespace distributed {
+
+// On-disk layout of one sparse table shard saved in binary format:
+//
+//   | header (64B) | sorted keys (8B * n) | row sizes (4B * n) | pad to 64B |
+//   | values (4B * stride * n) |
+//
+// Every row occupies `stride` floats in the value region, `row sizes` keeps
+// how many of them are used, so a row can be located from its index alone
+// and the file can be read in place through mmap.
+static const char kBinaryShardMagic[8] = {
+    'P', 'D', 'S', 'H', 'A', 'R', 'D', '\0'};
+static const uint32_t kBinaryShardVersion = 1;
+static const char* const kBinaryShardSuffix = ".bin";
+
+struct BinaryShardHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t stride;
+  uint64_t row_num;
+  uint64_t key_offset;
+  uint64_t size_offset;
+  uint64_t value_offset;
+  uint64_t reserved[2];
+};
+static_assert(sizeof(BinaryShardHeader) == 64,
+              "BinaryShardHeader must be 64 bytes");
+
+struct BinaryShardRow {
+  uint64_t key;
+  const float* data;
+  uint32_t size;
+};
+
+inline bool IsBinaryShardFile(const std::string& path) {
+  size_t suffix_len = strlen(kBinaryShardSuffix);
+  return path.size() >= suffix_len &&
+         path.compare(path.size() - suffix_len,
+                      suffix_len,
+                      kBinaryShardSuffix) == 0;
+}
+
+// whether the file name of path is part-<server>-<shard> followed by a
+// suffix, which is returned in *suffix
+inline bool ParseTableShardFile(const std::string& path, std::string* suffix) {
+  size_t slash = path.find_last_of('/');
+  std::string name =
+      slash == std::string::npos ? path : path.substr(slash + 1);
+  const std::string prefix = "part-";
+  if (name.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  size_t pos = prefix.size();
+  auto skip_digits = [&name, &pos]() {
+    size_t begin = pos;
+    while (pos < name.size() &&
+           isdigit(static_cast<unsigned char>(name[pos]))) {
+      ++pos;
+    }
+    return pos > begin;
+  };
+  if (!skip_digits() || pos >= name.size() || name[pos] != '-') {
+    return false;
+  }
+  ++pos;
+  if (!skip_digits()) {
+    return false;
+  }
+  *suffix = name.substr(pos);
+  return true;
+}
+
+// whether the file name of path is one a table save writes for a shard:
+// part-<server>-<shard> with no suffix, .gz or .bin. Anything else in the
+// table directory, like the .tmp file of an interrupted binary save, is not
+// a shard.
+inline bool IsTableShardFile(const std::string& path) {
+  std::string suffix;
+  return ParseTableShardFile(path, &suffix) &&
+         (suffix.empty() || suffix == ".gz" || suffix == kBinaryShardSuffix);
+}
+
+// whether the file name of path is one a delta save writes for a shard:
+// part-<server>-<shard>.delta or .delta.gz
+inline bool IsDeltaShardFile(const std::string& path) {
+  std::string suffix;
+  return ParseTableShardFile(path, &suffix) &&
+         (suffix == ".delta" || suffix == ".delta.gz");
+}
+
+class BinaryShardWriter {
+ public:
+  // sort the rows by key and write them to path, return 0 on success
+  static int Write(const std::string& path,
+                   uint32_t stride,
+                   std::vector<BinaryShardRow>* rows) {
+    std::sort(rows->begin(),
+              rows->end(),
+              [](const BinaryShardRow& a, const BinaryShardRow& b) {
+                return a.key < b.key;
+              });
+    size_t row_num = rows->size();
+    BinaryShardHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kBinaryShardMagic, sizeof(header.magic));
+    header.version = kBinaryShardVersion;
+    header.stride = stride;
+    header.row_num = row_num;
+    header.key_offset = sizeof(BinaryShardHeader);
+    header.size_offset = header.key_offset + row_num * sizeof(uint64_t);
+    header.value_offset =
+        AlignUp(header.size_offset + row_num * sizeof(uint32_t));
+
+    // write to a temp file first so a crash never leaves a torn shard
+    std::string tmp_path = path + ".tmp";
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (fp == nullptr) {
+      LOG(ERROR) << "BinaryShardWriter open " << tmp_path << " failed";
+      return -1;
+    }
+    std::vector<char> io_buffer(4 * 1024 * 1024);
+    setvbuf(fp, io_buffer.data(), _IOFBF, io_buffer.size());
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (size_t i = 0; ok && i < row_num; ++i) {
+      ok = fwrite(&(*rows)[i].key, sizeof(uint64_t), 1, fp) == 1;
+    }
+    for (size_t i = 0; ok && i < row_num; ++i) {
+      uint32_t size = std::min((*rows)[i].size, stride);
+      ok = fwrite(&size, sizeof(uint32_t), 1, fp) == 1;
+    }
+    std::vector<float> padded(stride, 0.0);
+    size_t pad = header.value_offset -
+                 (header.size_offset + row_num * sizeof(uint32_t));
+    if (ok && pad > 0) {
+      ok = fwrite(padded.data(), 1, pad, fp) == pad;
+    }
+    for (size_t i = 0; ok && i < row_num; ++i) {
+      uint32_t size = std::min((*rows)[i].size, stride);
+      memcpy(padded.data(), (*rows)[i].data, size * sizeof(float));
+      std::fill(padded.begin() + size, padded.end(), 0.0);
+      ok = fwrite(padded.data(), sizeof(float), stride, fp) == stride;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+      LOG(ERROR) << "BinaryShardWriter write " << path << " failed";
+      unlink(tmp_path.c_str());
+      return -1;
+    }
+    return 0;
+  }
+
+ private:
+  static uint64_t AlignUp(uint64_t offset) { return (offset + 63) & ~63ULL; }
+};
+
+// Read-only view of a binary shard file mapped into memory.
+class MappedBinaryShard {
+ public:
+  MappedBinaryShard() {}
+  MappedBinaryShard(const MappedBinaryShard&) = delete;
+  ~MappedBinaryShard() { Close(); }
+
+  // return 0 on success
+  int Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(ERROR) << "MappedBinaryShard open " << path << " failed";
+      return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(BinaryShardHeader)) {
+      LOG(ERROR) << "MappedBinaryShard " << path << " is truncated";
+      close(fd);
+      return -1;
+    }
+    _length = st.st_size;
+    _addr = mmap(nullptr, _length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (_addr == MAP_FAILED) {
+      LOG(ERROR) << "MappedBinaryShard mmap " << path << " failed";
+      _addr = nullptr;
+      return -1;
+    }
+    _header = reinterpret_cast<const BinaryShardHeader*>(_addr);
+    if (!ValidHeader()) {
+      LOG(ERROR) << "MappedBinaryShard " << path
+                 << " has a bad header, version " << _header->version
+                 << ", stride " << _header->stride << ", rows "
+                 << _header->row_num << ", file size " << _length;
+      Close();
+      return -1;
+    }
+    const char* base = reinterpret_cast<const char*>(_addr);
+    _keys = reinterpret_cast<const uint64_t*>(base + _header->key_offset);
+    _sizes = reinterpret_cast<const uint32_t*>(base + _header->size_offset);
+    _values = reinterpret_cast<const float*>(base + _header->value_offset);
+    for (size_t i = 0; i < _header->row_num; ++i) {
+      if (_sizes[i] > _header->stride) {
+        LOG(ERROR) << "MappedBinaryShard " << path << " row " << i
+                   << " has " << _sizes[i] << " floats, more than the stride "
+                   << _header->stride;
+        Close();
+        return -1;
+      }
+    }
+    madvise(_addr, _length, MADV_WILLNEED);
+    return 0;
+  }
+
+  void Close() {
+    if (_addr != nullptr) {
+      munmap(_addr, _length);
+    }
+    _addr = nullptr;
+    _length = 0;
+    _header = nullptr;
+  }
+
+  size_t size() const { return _header == nullptr ? 0 : _header->row_num; }
+  uint32_t stride() const { return _header->stride; }
+  uint64_t key(size_t idx) const { return _keys[idx]; }
+  uint32_t value_size(size_t idx) const { return _sizes[idx]; }
+  const float* value(size_t idx) const {
+    return _values + idx * _header->stride;
+  }
+
+  // binary search over the sorted keys, -1 if absent
+  int64_t Find(uint64_t key) const {
+    const uint64_t* end = _keys + size();
+    const uint64_t* it = std::lower_bound(_keys, end, key);
+    if (it == end || *it != key) {
+      return -1;
+    }
+    return it - _keys;
+  }
+
+ private:
+  // the layout written by BinaryShardWriter, checked without overflowing
+  bool ValidHeader() const {
+    const BinaryShardHeader& h = *_header;
+    if (memcmp(h.magic, kBinaryShardMagic, sizeof(h.magic)) != 0 ||
+        h.version != kBinaryShardVersion || h.stride == 0 ||
+        h.key_offset != sizeof(BinaryShardHeader)) {
+      return false;
+    }
+    size_t index_size = sizeof(uint64_t) + sizeof(uint32_t);
+    if (h.row_num > (_length - h.key_offset) / index_size) {
+      return false;
+    }
+    if (h.size_offset != h.key_offset + h.row_num * sizeof(uint64_t) ||
+        h.value_offset % 64 != 0 ||
+        h.value_offset < h.size_offset + h.row_num * sizeof(uint32_t) ||
+        h.value_offset > _length) {
+      return false;
+    }
+    uint64_t row_bytes = static_cast<uint64_t>(h.stride) * sizeof(float);
+    return h.row_num <= (_length - h.value_offset) / row_bytes;
+  }
+
+  void* _addr = nullptr;
+  size_t _length = 0;
+  const BinaryShardHeader* _header = nullptr;
+  const uint64_t* _keys = nullptr;
+  const uint32_t* _sizes = nullptr;
+  const float* _values = nullptr;
+};
+
+}  // namespace distributed
+}  // namespace paddle
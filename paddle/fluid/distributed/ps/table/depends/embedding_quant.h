@@ -0,0 +1,269 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include "paddle/fluid/distributed/common/local_random.h"
+
+namespace paddle {
+namespace distributed {
+
+// Storage types of the compressed embedding weights. The packed weights live
+// inside the float rows of a sparse table, padded to a whole number of
+// floats:
+//
+//   fp16 / bf16: | w0 w1 | w2 w3 | ...                 (2 weights per float)
+//   int8:        | scale | w0 w1 w2 w3 | w4 ...       (4 weights per float)
+//
+// int8 uses a symmetric per row scale, w = q * scale with q in [-127, 127].
+// An all zero region always decodes to zeros.
+enum class EmbeddingQuantType { kFP16 = 0, kBF16 = 1, kINT8 = 2 };
+
+inline bool ParseEmbeddingQuantType(const std::string& name,
+                                    EmbeddingQuantType* type) {
+  if (name == "fp16") {
+    *type = EmbeddingQuantType::kFP16;
+  } else if (name == "bf16") {
+    *type = EmbeddingQuantType::kBF16;
+  } else if (name == "int8") {
+    *type = EmbeddingQuantType::kINT8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline const char* EmbeddingQuantTypeName(EmbeddingQuantType type) {
+  switch (type) {
+    case EmbeddingQuantType::kFP16:
+      return "fp16";
+    case EmbeddingQuantType::kBF16:
+      return "bf16";
+    default:
+      return "int8";
+  }
+}
+
+// number of floats used by dim packed weights, the int8 scale included
+inline int QuantizedFloatNum(EmbeddingQuantType type, int dim) {
+  if (type == EmbeddingQuantType::kINT8) {
+    return 1 + (dim + 3) / 4;
+  }
+  return (dim + 1) / 2;
+}
+
+namespace quant_internal {
+
+// xorshift64*, seeded once per thread from local_random_engine. The state
+// is copied in and out around a row, the thread local lookup is not free.
+struct QuantRandom {
+  QuantRandom() : state(ThreadState()) {}
+  ~QuantRandom() { ThreadState() = state; }
+
+  static uint64_t& ThreadState() {
+    thread_local uint64_t thread_state =
+        (static_cast<uint64_t>(local_random_engine()()) << 32) ^
+        local_random_engine()() ^ 0x9E3779B97F4A7C15ULL;
+    return thread_state;
+  }
+
+  uint32_t Next() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<uint32_t>((state * 0x2545F4914F6CDD1DULL) >> 32);
+  }
+
+  // 16 random bits for element i, one draw serves two elements
+  uint32_t Next16(int i) {
+    if ((i & 1) == 0) {
+      bits = Next();
+      return bits & 0xFFFF;
+    }
+    return bits >> 16;
+  }
+
+  uint64_t state;
+  uint32_t bits = 0;
+};
+
+inline uint32_t FloatBits(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+  return x;
+}
+
+inline float BitsFloat(uint32_t x) {
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// rounding the low bits of x away either to nearest even or stochastically
+// with 16 random bits, so that the expectation of the rounded value is x
+inline uint32_t RoundingBias(uint32_t x,
+                             int shift,
+                             bool stochastic,
+                             uint32_t rand16) {
+  uint32_t mask = (1u << shift) - 1;
+  if (stochastic) {
+    return rand16 & mask;
+  }
+  return (mask >> 1) + ((x >> shift) & 1);
+}
+
+// finite values beyond the fp16 range saturate to +-65504. Both fp16
+// conversions are written with selects only so the row loops vectorize.
+inline uint16_t FloatToHalf(float f, bool stochastic, uint32_t rand16) {
+  uint32_t x = FloatBits(f);
+  uint32_t sign = (x >> 16) & 0x8000;
+  x &= 0x7FFFFFFF;
+  uint32_t normal =
+      ((x + RoundingBias(x, 13, stochastic, rand16)) >> 13) - (112 << 10);
+  normal = normal > 0x7BFF ? 0x7BFF : normal;
+  // below 2^-14 the half is subnormal, count in units of 2^-24
+  bool is_subnormal = x < 0x38800000;
+  float units = is_subnormal ? BitsFloat(x) * 16777216.0f : 0.0f;
+  uint32_t q = static_cast<uint32_t>(units);
+  float frac = units - static_cast<float>(q);
+  bool up = stochastic ? rand16 * (1.0f / 65536.0f) < frac
+                       : frac > 0.5f || (frac == 0.5f && (q & 1));
+  uint32_t h = is_subnormal ? q + up : normal;
+  h = x >= 0x7F800000 ? (x > 0x7F800000 ? 0x7E00 : 0x7C00) : h;
+  return static_cast<uint16_t>(sign | h);
+}
+
+inline float HalfToFloat(uint16_t h) {
+  // rebias by a multiply with 2^112, which also normalizes the subnormals
+  uint32_t bits = static_cast<uint32_t>(h & 0x7FFF) << 13;
+  float f = BitsFloat(bits) * BitsFloat(239u << 23);
+  // inf and nan keep the max exponent
+  bits = FloatBits(f) | (f >= 65536.0f ? 0x7F800000 : 0);
+  return BitsFloat(bits | (static_cast<uint32_t>(h & 0x8000) << 16));
+}
+
+inline uint16_t FloatToBFloat16(float f, bool stochastic, uint32_t rand16) {
+  uint32_t x = FloatBits(f);
+  if ((x & 0x7FFFFFFF) > 0x7F800000) {
+    return static_cast<uint16_t>((x >> 16) | 0x40);
+  }
+  x += RoundingBias(x, 16, stochastic, rand16);
+  return static_cast<uint16_t>(x >> 16);
+}
+
+inline float BFloat16ToFloat(uint16_t h) {
+  return BitsFloat(static_cast<uint32_t>(h) << 16);
+}
+
+// the packed bytes are accessed through uint8_t which may alias the floats
+inline void Store16(uint8_t* dst, size_t i, uint16_t h) {
+  dst[2 * i] = static_cast<uint8_t>(h & 0xFF);
+  dst[2 * i + 1] = static_cast<uint8_t>(h >> 8);
+}
+
+inline uint16_t Load16(const uint8_t* src, size_t i) {
+  return static_cast<uint16_t>(src[2 * i] | (src[2 * i + 1] << 8));
+}
+
+}  // namespace quant_internal
+
+// pack dim weights of src into dst, which holds QuantizedFloatNum floats.
+// stochastic rounding keeps the quantized weights unbiased so small sgd steps
+// are not lost, round to nearest is used otherwise.
+inline void QuantizeEmbedding(EmbeddingQuantType type,
+                              const float* src,
+                              int dim,
+                              bool stochastic,
+                              float* dst) {
+  using namespace quant_internal;  // NOLINT
+  int float_num = QuantizedFloatNum(type, dim);
+  if (type == EmbeddingQuantType::kINT8) {
+    float max_abs = 0;
+    for (int i = 0; i < dim; ++i) {
+      float abs = fabsf(src[i]);
+      max_abs = abs > max_abs ? abs : max_abs;
+    }
+    float scale = max_abs / 127.0f;
+    float inv_scale = scale > 0 ? 1.0f / scale : 0.0f;
+    dst[0] = scale;
+    uint8_t* packed = reinterpret_cast<uint8_t*>(dst + 1);
+    // q + 128 is kept in [1, 255] so the truncating conversion is a floor,
+    // this avoids the libm rounding calls. NaN goes to -127.
+    if (stochastic) {
+      QuantRandom random;
+      for (int i = 0; i < dim; ++i) {
+        float q = src[i] * inv_scale + 128.0f +
+                  random.Next16(i) * (1.0f / 65536.0f);
+        q = !(q >= 1.0f) ? 1.0f : (q > 255.0f ? 255.0f : q);
+        packed[i] = static_cast<uint8_t>(static_cast<int>(q) - 128);
+      }
+    } else {
+      for (int i = 0; i < dim; ++i) {
+        float q = src[i] * inv_scale + 128.5f;
+        q = !(q >= 1.0f) ? 1.0f : (q > 255.0f ? 255.0f : q);
+        packed[i] = static_cast<uint8_t>(static_cast<int>(q) - 128);
+      }
+    }
+    memset(packed + dim, 0, (float_num - 1) * sizeof(float) - dim);
+    return;
+  }
+  uint8_t* packed = reinterpret_cast<uint8_t*>(dst);
+  QuantRandom random;
+  if (type == EmbeddingQuantType::kFP16) {
+    for (int i = 0; i < dim; ++i) {
+      uint32_t rand16 = stochastic ? random.Next16(i) : 0;
+      Store16(packed, i, FloatToHalf(src[i], stochastic, rand16));
+    }
+  } else {
+    for (int i = 0; i < dim; ++i) {
+      uint32_t rand16 = stochastic ? random.Next16(i) : 0;
+      Store16(packed, i, FloatToBFloat16(src[i], stochastic, rand16));
+    }
+  }
+  memset(packed + 2 * dim, 0, float_num * sizeof(float) - 2 * dim);
+}
+
+inline void DequantizeEmbedding(EmbeddingQuantType type,
+                                const float* src,
+                                int dim,
+                                float* dst) {
+  using namespace quant_internal;  // NOLINT
+  if (type == EmbeddingQuantType::kINT8) {
+    float scale = src[0];
+    const uint8_t* packed = reinterpret_cast<const uint8_t*>(src + 1);
+    for (int i = 0; i < dim; ++i) {
+      dst[i] = static_cast<float>(static_cast<int8_t>(packed[i])) * scale;
+    }
+    return;
+  }
+  const uint8_t* packed = reinterpret_cast<const uint8_t*>(src);
+  if (type == EmbeddingQuantType::kFP16) {
+    for (int i = 0; i < dim; ++i) {
+      dst[i] = HalfToFloat(Load16(packed, i));
+    }
+  } else {
+    for (int i = 0; i < dim; ++i) {
+      dst[i] = BFloat16ToFloat(Load16(packed, i));
+    }
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <limits>
 #include <vector>
 
 #include <mct/hash-map.hpp>
@@ -36,9 +37,19 @@ class FixedFeatureValue {
   size_t size() { return _data.size(); }
   void resize(size_t size) { _data.resize(size); }
   void shrink_to_fit() { _data.shrink_to_fit(); }
+  // the value was last modified after the checkpoint with this id, used by
+  // the delta checkpoints of MemorySparseTable
+  uint32_t dirty_epoch() const { return _dirty_epoch; }
+  void set_dirty_epoch(uint32_t epoch) { _dirty_epoch = epoch; }
+  // for the writers through the pointers of PullSparsePtr, which do not know
+  // the table's epoch: the row is stamped by the next checkpoint
+  static constexpr uint32_t kDirtyUnstamped =
+      std::numeric_limits<uint32_t>::max();
+  void mark_dirty() { _dirty_epoch = kDirtyUnstamped; }
 
  private:
   std::vector<float> _data;
+  uint32_t _dirty_epoch = 0;
 };
 
 template <class KEY, class VALUE>
@@ -93,8 +104,14 @@ struct alignas(64) SparseTableShard {
   };
 
   ~SparseTableShard() { clear(); }
-  bool empty() { return _alloc.size() == 0; }
-  size_t size() { return _alloc.size(); }
+  bool empty() { return size() == 0; }
+  size_t size() {
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; bucket++) {
+      total += _alloc[bucket].size();
+    }
+    return total;
+  }
   void set_max_load_factor(float x) {
     for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; bucket++) {
       _buckets[bucket].max_load_factor(x);
@@ -106,7 +123,7 @@ struct alignas(64) SparseTableShard {
     for (size_t bucket = 0; bucket < CTR_SPARSE_SHARD_BUCKET_NUM; bucket++) {
       map_type& data = _buckets[bucket];
       for (auto it = data.begin(); it != data.end(); ++it) {
-        _alloc.release((VALUE*)(void*)it->second);  // NOLINT
+        _alloc[bucket].release((VALUE*)(void*)it->second);  // NOLINT
       }
       data.clear();
     }
@@ -150,13 +167,14 @@ struct alignas(64) SparseTableShard {
     auto res = _buckets[bucket].insert_with_hash({key, NULL}, hash);
 
     if (res.second) {
-      res.first->second = _alloc.acquire(std::forward<ARGS>(args)...);
+      res.first->second =
+          _alloc[bucket].acquire(std::forward<ARGS>(args)...);
     }
 
     return {{res.first, bucket, _buckets}, res.second};
   }
   iterator erase(iterator it) {
-    _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
+    _alloc[it.bucket].release((VALUE*)(void*)it.it->second);  // NOLINT
     size_t bucket = it.bucket;
     auto it2 = _buckets[bucket].erase(it.it);
     while (it2 == _buckets[bucket].end() &&
@@ -166,15 +184,15 @@ struct alignas(64) SparseTableShard {
     return {it2, bucket, _buckets};
   }
   void quick_erase(iterator it) {
-    _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
+    _alloc[it.bucket].release((VALUE*)(void*)it.it->second);  // NOLINT
     _buckets[it.bucket].quick_erase(it.it);
   }
   local_iterator erase(size_t bucket, local_iterator it) {
-    _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
+    _alloc[bucket].release((VALUE*)(void*)it.it->second);  // NOLINT
     return {_buckets[bucket].erase(it.it)};
   }
   void quick_erase(size_t bucket, local_iterator it) {
-    _alloc.release((VALUE*)(void*)it.it->second);  // NOLINT
+    _alloc[bucket].release((VALUE*)(void*)it.it->second);  // NOLINT
     _buckets[bucket].quick_erase(it.it);
   }
   size_t erase(const KEY& key) {
@@ -192,10 +210,13 @@ struct alignas(64) SparseTableShard {
       return hash >> (sizeof(size_t) * 8 - CTR_SPARSE_SHARD_BUCKET_NUM_BITS);
     }
   }
+  size_t bucket_of(const KEY& key) { return compute_bucket(_hasher(key)); }
 
  private:
   map_type _buckets[CTR_SPARSE_SHARD_BUCKET_NUM];
-  ChunkAllocator<VALUE> _alloc;
+  // Every bucket owns its allocator, so threads working on disjoint buckets
+  // of the same shard can insert and erase without any locking.
+  ChunkAllocator<VALUE> _alloc[CTR_SPARSE_SHARD_BUCKET_NUM];
   std::hash<KEY> _hasher;
 };
 
@@ -0,0 +1,317 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/distributed/ps/table/depends/rocksdb_warpper.h"
+
+namespace paddle {
+namespace distributed {
+
+// TinyLFU frequency sketch: a count-min sketch of 4-bit saturating counters
+// that halves itself every `10 * width` increments so old popularity ages out.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(size_t capacity) {
+    size_t width = 64;
+    while (width < capacity) {
+      width <<= 1;
+    }
+    _width_bits = 0;
+    while ((static_cast<size_t>(1) << _width_bits) < width) {
+      ++_width_bits;
+    }
+    _table.assign(kDepth * width, 0);
+    _sample_size = 10 * width;
+    _additions = 0;
+  }
+
+  void Increment(uint64_t key) {
+    for (size_t i = 0; i < kDepth; ++i) {
+      uint8_t& counter = _table[Index(i, key)];
+      if (counter < kMaxCount) {
+        ++counter;
+      }
+    }
+    if (++_additions >= _sample_size) {
+      for (auto& counter : _table) {
+        counter >>= 1;
+      }
+      _additions /= 2;
+    }
+  }
+
+  uint32_t Estimate(uint64_t key) const {
+    uint32_t freq = kMaxCount;
+    for (size_t i = 0; i < kDepth; ++i) {
+      freq = std::min<uint32_t>(freq, _table[Index(i, key)]);
+    }
+    return freq;
+  }
+
+  static const uint32_t kMaxCount = 15;
+
+ private:
+  static const size_t kDepth = 4;
+
+  size_t Index(size_t row, uint64_t key) const {
+    static const uint64_t seeds[kDepth] = {0x9E3779B97F4A7C15ULL,
+                                           0xC2B2AE3D27D4EB4FULL,
+                                           0x165667B19E3779F9ULL,
+                                           0x27D4EB2F165667C5ULL};
+    uint64_t h = (key ^ (key >> 31)) * seeds[row];
+    return (row << _width_bits) + (h >> (64 - _width_bits));
+  }
+
+  std::vector<uint8_t> _table;
+  size_t _width_bits;
+  size_t _sample_size;
+  size_t _additions;
+};
+
+struct SSDCacheStat {
+  std::atomic<uint64_t> mem_hit{0};
+  std::atomic<uint64_t> pending_hit{0};
+  std::atomic<uint64_t> ssd_hit{0};
+  std::atomic<uint64_t> miss{0};
+  std::atomic<uint64_t> admitted{0};
+  std::atomic<uint64_t> rejected{0};
+  std::atomic<uint64_t> evicted{0};
+};
+
+// Size-bounded in-memory tier of one SSDSparseTable shard. The resident rows
+// live in the shard's SparseTableShard; this class only keeps the TinyLFU
+// sketch and a CLOCK hand that sweeps the shard buckets on eviction, so no
+// per-row metadata is added. All methods are called from the shard's task
+// thread, only the counters and the pins are used concurrently.
+//
+// Rows handed out by pointer (PullSparsePtr) are pinned with the pass that
+// pulled them and are never evicted while pinned. The pins of a pass are
+// dropped once two newer passes have pulled, since a pass is built at most
+// one pass ahead of the one being trained.
+class SSDShardCache {
+ public:
+  explicit SSDShardCache(size_t capacity)
+      : _capacity(capacity), _sketch(capacity) {}
+
+  size_t capacity() const { return _capacity; }
+  // low watermark an eviction round shrinks the shard to
+  size_t evict_target() const { return _capacity - _capacity / 10; }
+
+  void Access(uint64_t key) { _sketch.Increment(key); }
+  uint32_t Frequency(uint64_t key) const { return _sketch.Estimate(key); }
+
+  // TinyLFU admission: a cold row only displaces resident ones if it is
+  // more popular than the rows the last eviction round had to give up.
+  bool Admit(uint64_t key, size_t resident) {
+    bool admit =
+        resident < _capacity || _sketch.Estimate(key) > _victim_frequency;
+    if (admit) {
+      _stat.admitted.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      _stat.rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+    return admit;
+  }
+
+  size_t NextBucket(size_t bucket_count) {
+    size_t bucket = _hand;
+    _hand = (_hand + 1) % bucket_count;
+    return bucket;
+  }
+  void set_victim_frequency(uint32_t freq) { _victim_frequency = freq; }
+
+  void Pin(uint64_t key, uint16_t pass_id) {
+    std::lock_guard<std::mutex> guard(_pin_mutex);
+    if (!_has_pin_pass || pass_id != _pin_pass) {
+      _pins[1] = std::move(_pins[0]);
+      _pins[0].clear();
+      _pin_pass = pass_id;
+      _has_pin_pass = true;
+    }
+    _pins[0].insert(key);
+  }
+  bool Pinned(uint64_t key) {
+    std::lock_guard<std::mutex> guard(_pin_mutex);
+    return _pins[0].count(key) > 0 || _pins[1].count(key) > 0;
+  }
+  size_t pinned_size() {
+    std::lock_guard<std::mutex> guard(_pin_mutex);
+    return _pins[0].size() + _pins[1].size();
+  }
+
+  SSDCacheStat& stat() { return _stat; }
+
+ private:
+  size_t _capacity;
+  FrequencySketch _sketch;
+  size_t _hand{0};
+  uint32_t _victim_frequency{0};
+  SSDCacheStat _stat;
+  std::mutex _pin_mutex;
+  // the pins of the latest pass and of the one before
+  std::unordered_set<uint64_t> _pins[2];
+  uint16_t _pin_pass{0};
+  bool _has_pin_pass{false};
+};
+
+// Groups rows evicted from the memory tier into rocksdb WriteBatches that are
+// written by one background thread per shard. Rows stay readable through
+// Get() until their batch is persisted, and deletes are queued behind the
+// puts of the same shard so the write order is preserved.
+class SSDWriteBackBatcher {
+ public:
+  SSDWriteBackBatcher(RocksDBHandler* db, int shard_num, size_t batch_size)
+      : _db(db), _batch_size(std::max<size_t>(batch_size, 1)) {
+    _shards.resize(shard_num);
+    for (auto& shard : _shards) {
+      shard.reset(new Shard());
+      shard->writer.reset(new ::ThreadPool(1));
+    }
+  }
+  ~SSDWriteBackBatcher() { Flush(); }
+
+  void Put(int shard_id, uint64_t key, const float* data, size_t len) {
+    auto value = std::make_shared<std::string>(
+        reinterpret_cast<const char*>(data), len * sizeof(float));
+    Append(shard_id, key, std::move(value));
+  }
+
+  void Delete(int shard_id, uint64_t key) { Append(shard_id, key, nullptr); }
+
+  // return 0 if the key has a pending value, 1 if the key is not pending
+  // and -1 if its pending operation is a delete
+  int Get(int shard_id, uint64_t key, std::string* value) {
+    auto& shard = *_shards[shard_id];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.pending.find(key);
+    if (it == shard.pending.end()) {
+      return 1;
+    }
+    if (it->second.value == nullptr) {
+      return -1;
+    }
+    *value = *it->second.value;
+    return 0;
+  }
+
+  // submit the partial batches and wait until everything is persisted
+  void Flush() {
+    for (size_t shard_id = 0; shard_id < _shards.size(); ++shard_id) {
+      std::lock_guard<std::mutex> guard(_shards[shard_id]->mutex);
+      Submit(shard_id);
+    }
+    for (auto& shard : _shards) {
+      std::future<void> last;
+      {
+        std::lock_guard<std::mutex> guard(shard->mutex);
+        last = std::move(shard->last_write);
+      }
+      if (last.valid()) {
+        last.wait();
+      }
+    }
+  }
+
+  uint64_t written_rows() const {
+    return _written_rows.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Op {
+    uint64_t key;
+    uint64_t seq;
+    std::shared_ptr<std::string> value;  // nullptr means delete
+  };
+  struct Pending {
+    uint64_t seq;
+    std::shared_ptr<std::string> value;
+  };
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Pending> pending;
+    std::vector<Op> batch;
+    uint64_t seq{0};
+    std::unique_ptr<::ThreadPool> writer;
+    std::future<void> last_write;
+  };
+
+  void Append(int shard_id,
+              uint64_t key,
+              std::shared_ptr<std::string> value) {
+    auto& shard = *_shards[shard_id];
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    uint64_t seq = ++shard.seq;
+    shard.pending[key] = {seq, value};
+    shard.batch.push_back({key, seq, std::move(value)});
+    if (shard.batch.size() >= _batch_size) {
+      Submit(shard_id);
+    }
+  }
+
+  // must hold the shard mutex
+  void Submit(int shard_id) {
+    auto& shard = *_shards[shard_id];
+    if (shard.batch.empty()) {
+      return;
+    }
+    auto ops = std::make_shared<std::vector<Op>>(std::move(shard.batch));
+    shard.batch.clear();
+    // the writer is single-threaded, so batches land in submit order and
+    // waiting on the last one waits on all of them
+    shard.last_write = shard.writer->enqueue([this, shard_id, ops]() {
+      rocksdb::WriteBatch batch;
+      for (auto& op : *ops) {
+        rocksdb::Slice key(reinterpret_cast<const char*>(&op.key),
+                           sizeof(uint64_t));
+        if (op.value == nullptr) {
+          batch.Delete(key);
+        } else {
+          batch.Put(key, rocksdb::Slice(*op.value));
+        }
+      }
+      _db->write_batch(shard_id, &batch);
+      _written_rows.fetch_add(ops->size(), std::memory_order_relaxed);
+      auto& cur_shard = *_shards[shard_id];
+      std::lock_guard<std::mutex> guard(cur_shard.mutex);
+      for (auto& op : *ops) {
+        auto it = cur_shard.pending.find(op.key);
+        if (it != cur_shard.pending.end() && it->second.seq == op.seq) {
+          cur_shard.pending.erase(it);
+        }
+      }
+    });
+  }
+
+  RocksDBHandler* _db;
+  size_t _batch_size;
+  std::vector<std::unique_ptr<Shard>> _shards;
+  std::atomic<uint64_t> _written_rows{0};
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -13,12 +13,14 @@
 // limitations under the License.
 
 #include <omp.h>
+#include <algorithm>
 #include <sstream>
 
 #include "glog/logging.h"
 #include "paddle/fluid/distributed/common/cost_timer.h"
 #include "paddle/fluid/distributed/common/local_random.h"
 #include "paddle/fluid/distributed/common/topk_calculator.h"
+#include "paddle/fluid/distributed/ps/table/depends/binary_shard.h"
 #include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 #include "paddle/fluid/framework/archive.h"
 #include "paddle/fluid/framework/io/fs.h"
@@ -38,6 +40,18 @@ PD_DEFINE_bool(pserver_enable_create_feasign_randomly,
 PD_DEFINE_int32(pserver_table_save_max_retry,
                 3,
                 "pserver_table_save_max_retry");
+PD_DEFINE_bool(pserver_sparse_table_binary_save,
+               false,
+               "save checkpoints of local sparse tables in the mmap-able "
+               "binary shard format");
+PD_DEFINE_bool(pserver_sparse_table_delta_save,
+               false,
+               "keep the keys erased by shrink so that delta checkpoints "
+               "(save param 6) can drop them on load");
+PD_DEFINE_int32(pserver_sparse_shard_fanout,
+                1,
+                "split the keys of one sparse shard by hash bucket and "
+                "pull/push them with this many threads, 1 means disabled");
 
 namespace paddle {
 namespace distributed {
@@ -51,7 +65,14 @@ int32_t MemorySparseTable::Initialize() {
   for (auto &shards_task : _shards_task_pool) {
     shards_task.reset(new ::ThreadPool(1));
   }
-  VLOG(0) << "initalize MemorySparseTable succ";
+  _shard_fanout = std::min<int>(std::max(FLAGS_pserver_sparse_shard_fanout, 1),
+                                CTR_SPARSE_SHARD_BUCKET_NUM);
+  _shards_fanout_task_pool.resize(_task_pool_size * (_shard_fanout - 1));
+  for (auto &shards_task : _shards_fanout_task_pool) {
+    shards_task.reset(new ::ThreadPool(1));
+  }
+  VLOG(0) << "initalize MemorySparseTable succ, shard fanout: "
+          << _shard_fanout;
   return 0;
 }
 
@@ -76,6 +97,7 @@ int32_t MemorySparseTable::InitializeValue() {
           << " _task_pool_size:" << _task_pool_size;
 
   _local_shards.reset(new shard_type[_real_local_shard_num]);
+  _erased_keys.resize(_real_local_shard_num);
 
   if (_config.enable_revert()) {
     // calculate merged shard number based on config param;
@@ -106,8 +128,18 @@ int32_t MemorySparseTable::InitializeValue() {
 
 int32_t MemorySparseTable::Load(const std::string &path,
                                 const std::string &param) {
+  if (atoi(param.c_str()) == 6) {
+    return LoadWithDeltas(path);
+  }
   std::string table_path = TableDir(path);
   auto file_list = _afs_client.list(table_path);
+  // only the shard files count, not leftovers like an unfinished .tmp
+  file_list.erase(std::remove_if(file_list.begin(),
+                                 file_list.end(),
+                                 [](const std::string &file) {
+                                   return !IsTableShardFile(file);
+                                 }),
+                  file_list.end());
 
   std::sort(file_list.begin(), file_list.end());
   for (auto file : file_list) {
@@ -135,6 +167,9 @@ int32_t MemorySparseTable::Load(const std::string &path,
   if (file_start_idx >= file_list.size()) {
     return 0;
   }
+  if (IsBinaryShardFile(file_list[file_start_idx])) {
+    return LoadBinaryShards(file_list, file_start_idx);
+  }
 
   size_t feature_value_size =
       _value_accessor->GetAccessorInfo().size / sizeof(float);
@@ -202,6 +237,295 @@ int32_t MemorySparseTable::Load(const std::string &path,
   return 0;
 }
 
+int32_t MemorySparseTable::LoadBinaryShards(
+    const std::vector<std::string> &file_list, size_t file_start_idx) {
+  std::vector<MappedBinaryShard> mapped(_real_local_shard_num);
+  uint32_t stride = _value_accessor->GetAccessorInfo().size / sizeof(float);
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    if (mapped[i].Open(file_list[file_start_idx + i]) != 0) {
+      LOG(ERROR) << "MemorySparseTable load binary shard failed, path: "
+                 << file_list[file_start_idx + i];
+      return -1;
+    }
+    // Open checked every row fits in the stride, the stride must be the
+    // value size of this table's accessor
+    if (mapped[i].stride() != stride) {
+      LOG(ERROR) << "MemorySparseTable binary shard "
+                 << file_list[file_start_idx + i] << " has rows of "
+                 << mapped[i].stride() << " floats, but the accessor has "
+                 << stride;
+      return -1;
+    }
+  }
+  // every shard is filled by part_num threads, each owning the hash buckets
+  // with bucket % part_num == part, so rows are copied straight from the
+  // mapping into the shard without any locking or text parsing
+  int part_num = std::max(1, omp_get_num_procs() / _real_local_shard_num);
+  part_num = std::min<int>(part_num, CTR_SPARSE_SHARD_BUCKET_NUM);
+  omp_set_num_threads(std::min(_real_local_shard_num * part_num,
+                               std::max(omp_get_num_procs(), 1)));
+#pragma omp parallel for schedule(dynamic)
+  for (int task = 0; task < _real_local_shard_num * part_num; ++task) {
+    int shard_id = task / part_num;
+    size_t part = task % part_num;
+    auto &shard = _local_shards[shard_id];
+    const auto &file = mapped[shard_id];
+    for (size_t row = 0; row < file.size(); ++row) {
+      uint64_t key = file.key(row);
+      if (shard.bucket_of(key) % part_num != part) {
+        continue;
+      }
+      auto &value = shard[key];
+      value.resize(file.value_size(row));
+      memcpy(value.data(),
+             file.value(row),
+             file.value_size(row) * sizeof(float));
+    }
+  }
+  LOG(INFO) << "MemorySparseTable load binary success, path from "
+            << file_list[file_start_idx] << " to "
+            << file_list[file_start_idx + _real_local_shard_num - 1];
+  return 0;
+}
+
+int32_t MemorySparseTable::SaveBinaryShard(int shard_id,
+                                           const std::string &path,
+                                           int save_param) {
+  auto &shard = _local_shards[shard_id];
+  std::vector<BinaryShardRow> rows;
+  rows.reserve(shard.size());
+  for (auto it = shard.begin(); it != shard.end(); ++it) {
+    if (_value_accessor->Save(it.value().data(), save_param)) {
+      rows.push_back({it.key(),
+                      it.value().data(),
+                      static_cast<uint32_t>(it.value().size())});
+    }
+  }
+  uint32_t stride = _value_accessor->GetAccessorInfo().size / sizeof(float);
+  if (BinaryShardWriter::Write(path, stride, &rows) != 0) {
+    return -1;
+  }
+  return static_cast<int32_t>(rows.size());
+}
+
+int32_t MemorySparseTable::SaveDelta(const std::string &table_path,
+                                     uint32_t since_epoch) {
+  if (!FLAGS_pserver_sparse_table_delta_save) {
+    LOG(ERROR) << "MemorySparseTable delta save needs "
+               << "FLAGS_pserver_sparse_table_delta_save";
+    return -1;
+  }
+  // the tombstones are dropped by every full checkpoint
+  if (since_epoch < _base_checkpoint_epoch ||
+      since_epoch > _last_checkpoint_epoch) {
+    LOG(ERROR) << "MemorySparseTable can not save delta since checkpoint "
+               << since_epoch << ", valid range [" << _base_checkpoint_epoch
+               << ", " << _last_checkpoint_epoch << "]";
+    return -1;
+  }
+  _afs_client.remove(::paddle::string::format_string(
+      "%s/part-%03d-*", table_path.c_str(), _shard_idx));
+  std::atomic<uint32_t> feasign_size_all{0};
+  size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+
+  int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    FsChannelConfig channel_config = {};
+    channel_config.path = ::paddle::string::format_string(
+        "%s/part-%03d-%05d%s",
+        table_path.c_str(),
+        _shard_idx,
+        file_start_idx + i,
+        _config.compress_in_save() ? ".delta.gz" : ".delta");
+    channel_config.converter = _value_accessor->Converter(0).converter;
+    channel_config.deconverter = _value_accessor->Converter(0).deconverter;
+    auto &shard = _local_shards[i];
+    bool is_write_failed = false;
+    int feasign_size = 0;
+    int retry_num = 0;
+    int err_no = 0;
+    do {
+      err_no = 0;
+      feasign_size = 0;
+      is_write_failed = false;
+      auto write_channel =
+          _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+      for (auto it = shard.begin(); it != shard.end() && !is_write_failed;
+           ++it) {
+        if (it.value().dirty_epoch() <= since_epoch) {
+          continue;
+        }
+        std::string format_value = _value_accessor->ParseToString(
+            it.value().data(), it.value().size());
+        is_write_failed =
+            write_channel->write_line(::paddle::string::format_string(
+                "%lu %s", it.key(), format_value.c_str())) != 0;
+        ++feasign_size;
+      }
+      // a key without value is a tombstone
+      for (auto &erased : _erased_keys[i]) {
+        if (is_write_failed) {
+          break;
+        }
+        if (erased.second <= since_epoch ||
+            shard.find(erased.first) != shard.end()) {
+          continue;
+        }
+        is_write_failed = write_channel->write_line(
+                              ::paddle::string::format_string(
+                                  "%lu", erased.first)) != 0;
+      }
+      write_channel->close();
+      if (err_no == -1) {
+        is_write_failed = true;
+      }
+      if (is_write_failed) {
+        ++retry_num;
+        LOG(ERROR) << "MemorySparseTable save delta failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
+        _afs_client.remove(channel_config.path);
+      }
+      if (retry_num > FLAGS_pserver_table_save_max_retry) {
+        LOG(ERROR) << "MemorySparseTable save delta failed reach max limit!";
+        exit(-1);
+      }
+    } while (is_write_failed);
+    feasign_size_all += feasign_size;
+  }
+  FinishCheckpoint(false);
+  LOG(INFO) << "MemorySparseTable save delta success, checkpoint id: "
+            << _last_checkpoint_epoch << " since: " << since_epoch
+            << " feasign_size: " << feasign_size_all;
+  return 0;
+}
+
+void MemorySparseTable::FinishCheckpoint(bool full) {
+  uint32_t epoch = _dirty_epoch.fetch_add(1);
+  if (_pulled_by_ptr.load(std::memory_order_relaxed)) {
+    // the rows written through pointers since the last checkpoint are in
+    // this one
+    omp_set_num_threads(std::min(_real_local_shard_num, 20));
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < _real_local_shard_num; ++i) {
+      auto &shard = _local_shards[i];
+      for (auto it = shard.begin(); it != shard.end(); ++it) {
+        if (it.value().dirty_epoch() == FixedFeatureValue::kDirtyUnstamped) {
+          it.value().set_dirty_epoch(epoch);
+        }
+      }
+    }
+  }
+  _last_checkpoint_epoch = epoch;
+  if (full) {
+    _base_checkpoint_epoch = epoch;
+    for (auto &erased_keys : _erased_keys) {
+      erased_keys.clear();
+    }
+  }
+}
+
+int32_t MemorySparseTable::LoadWithDeltas(const std::string &path) {
+  auto dirs = ::paddle::string::split_string<std::string>(path, ",");
+  if (dirs.empty() || Load(dirs[0], "0") != 0) {
+    LOG(ERROR) << "MemorySparseTable load base failed, path: " << path;
+    return -1;
+  }
+  for (size_t i = 1; i < dirs.size(); ++i) {
+    if (LoadDelta(dirs[i]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int32_t MemorySparseTable::LoadDelta(const std::string &path) {
+  std::string table_path = TableDir(path);
+  auto file_list = _afs_client.list(table_path);
+  // only the delta files count, like the shard files of a full load
+  file_list.erase(std::remove_if(file_list.begin(),
+                                 file_list.end(),
+                                 [](const std::string &file) {
+                                   return !IsDeltaShardFile(file);
+                                 }),
+                  file_list.end());
+  std::sort(file_list.begin(), file_list.end());
+  if (file_list.size() != static_cast<size_t>(_sparse_table_shard_num)) {
+    LOG(WARNING) << "MemorySparseTable delta file_size:" << file_list.size()
+                 << " not equal to expect_shard_num:"
+                 << _sparse_table_shard_num;
+    return -1;
+  }
+  size_t file_start_idx = _shard_idx * _avg_local_shard_num;
+  if (file_start_idx >= file_list.size()) {
+    return 0;
+  }
+  size_t feature_value_size =
+      _value_accessor->GetAccessorInfo().size / sizeof(float);
+
+  int thread_num = _real_local_shard_num < 15 ? _real_local_shard_num : 15;
+  omp_set_num_threads(thread_num);
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < _real_local_shard_num; ++i) {
+    FsChannelConfig channel_config = {};
+    channel_config.path = file_list[file_start_idx + i];
+    channel_config.converter = _value_accessor->Converter(0).converter;
+    channel_config.deconverter = _value_accessor->Converter(0).deconverter;
+
+    bool is_read_failed = false;
+    int retry_num = 0;
+    int err_no = 0;
+    do {
+      // replaying a delta is idempotent, so a retry starts over
+      is_read_failed = false;
+      err_no = 0;
+      std::string line_data;
+      auto read_channel = _afs_client.open_r(channel_config, 0, &err_no);
+      char *end = nullptr;
+      auto &shard = _local_shards[i];
+      try {
+        while (read_channel->read_line(line_data) == 0) {
+          if (line_data.empty()) {
+            continue;
+          }
+          uint64_t key = std::strtoul(line_data.data(), &end, 10);
+          if (*end != ' ') {
+            shard.erase(key);
+            continue;
+          }
+          auto &value = shard[key];
+          value.resize(feature_value_size);
+          int parse_size =
+              _value_accessor->ParseFromString(++end, value.data());
+          value.resize(parse_size);
+        }
+        read_channel->close();
+        if (err_no == -1) {
+          ++retry_num;
+          is_read_failed = true;
+          LOG(ERROR) << "MemorySparseTable load delta failed after read, "
+                     << "retry it! path:" << channel_config.path
+                     << " , retry_num=" << retry_num;
+        }
+      } catch (...) {
+        ++retry_num;
+        is_read_failed = true;
+        LOG(ERROR) << "MemorySparseTable load delta failed, retry it! path:"
+                   << channel_config.path << " , retry_num=" << retry_num;
+      }
+      if (retry_num > FLAGS_pserver_table_save_max_retry) {
+        LOG(ERROR) << "MemorySparseTable load delta failed reach max limit!";
+        exit(-1);
+      }
+    } while (is_read_failed);
+  }
+  LOG(INFO) << "MemorySparseTable load delta success, path from "
+            << file_list[file_start_idx] << " to "
+            << file_list[file_start_idx + _real_local_shard_num - 1];
+  return 0;
+}
+
 int32_t MemorySparseTable::LoadPatch(const std::vector<std::string> &file_list,
                                      int load_param) {
   if (!_config.enable_revert()) {
@@ -332,6 +656,16 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
     return 0;
   }
 
+  // delta checkpoint, param is "6" or "6,<since checkpoint id>"
+  if (save_param == 6) {
+    auto params = ::paddle::string::split_string<std::string>(param, ",");
+    uint32_t since_epoch = _last_checkpoint_epoch;
+    if (params.size() > 1) {
+      since_epoch = static_cast<uint32_t>(std::stoul(params[1]));
+    }
+    return SaveDelta(TableDir(dirname), since_epoch);
+  }
+
   // cache model
   int64_t tk_size = LocalSize() * _config.sparse_table_cache_rate();
   TopkCalculator tk(_real_local_shard_num, tk_size);
@@ -342,6 +676,14 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
   std::atomic<uint32_t> feasign_size_all{0};
 
   size_t file_start_idx = _avg_local_shard_num * _shard_idx;
+  // the binary format keeps raw values, so only checkpoints use it, and it
+  // has to be mmap-ed on load, so only on the local file system
+  bool binary_save = FLAGS_pserver_sparse_table_binary_save &&
+                     (save_param == 0 || save_param == 3) &&
+                     ::paddle::framework::fs_select_internal(table_path) == 0;
+  if (binary_save) {
+    ::paddle::framework::localfs_mkdir(table_path);
+  }
 
 #ifdef PADDLE_WITH_HETERPS
   int thread_num = _real_local_shard_num;
@@ -352,7 +694,15 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
 #pragma omp parallel for schedule(dynamic)
   for (int i = 0; i < _real_local_shard_num; ++i) {
     FsChannelConfig channel_config = {};
-    if (_config.compress_in_save() && (save_param == 0 || save_param == 3)) {
+    if (binary_save) {
+      channel_config.path =
+          ::paddle::string::format_string("%s/part-%03d-%05d%s",
+                                          table_path.c_str(),
+                                          _shard_idx,
+                                          file_start_idx + i,
+                                          kBinaryShardSuffix);
+    } else if (_config.compress_in_save() &&
+               (save_param == 0 || save_param == 3)) {
       channel_config.path =
           ::paddle::string::format_string("%s/part-%03d-%05d.gz",
                                           table_path.c_str(),
@@ -380,51 +730,64 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
       }
     }
 #endif
-    do {
-      err_no = 0;
-      feasign_size = 0;
-      is_write_failed = false;
-      auto write_channel =
-          _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
-      for (auto it = shard.begin(); it != shard.end(); ++it) {
-        if (_config.enable_sparse_table_cache() &&
-            (save_param == 1 || save_param == 2) &&
-            _value_accessor->Save(it.value().data(), 4)) {
-          CostTimer timer10("sprase table top push");
-          tk.push(i, _value_accessor->GetField(it.value().data(), "show"));
+    if (binary_save) {
+      while ((feasign_size = SaveBinaryShard(
+                  i, channel_config.path, save_param)) < 0) {
+        if (++retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR) << "MemorySparseTable save binary failed reach max limit!";
+          exit(-1);
         }
+      }
+    } else {
+      do {
+        err_no = 0;
+        feasign_size = 0;
+        is_write_failed = false;
+        auto write_channel =
+            _afs_client.open_w(channel_config, 1024 * 1024 * 40, &err_no);
+        for (auto it = shard.begin(); it != shard.end(); ++it) {
+          if (_config.enable_sparse_table_cache() &&
+              (save_param == 1 || save_param == 2) &&
+              _value_accessor->Save(it.value().data(), 4)) {
+            CostTimer timer10("sprase table top push");
+            tk.push(i, _value_accessor->GetField(it.value().data(), "show"));
+          }
 
-        if (_value_accessor->Save(it.value().data(), save_param)) {
-          std::string format_value = _value_accessor->ParseToString(
-              it.value().data(), it.value().size());
-          if (0 != write_channel->write_line(::paddle::string::format_string(
-                       "%lu %s", it.key(), format_value.c_str()))) {
-            ++retry_num;
-            is_write_failed = true;
-            LOG(ERROR)
-                << "MemorySparseTable save prefix failed, retry it! path:"
-                << channel_config.path << " , retry_num=" << retry_num;
-            break;
+          if (_value_accessor->Save(it.value().data(), save_param)) {
+            std::string format_value = _value_accessor->ParseToString(
+                it.value().data(), it.value().size());
+            if (0 !=
+                write_channel->write_line(::paddle::string::format_string(
+                    "%lu %s", it.key(), format_value.c_str()))) {
+              ++retry_num;
+              is_write_failed = true;
+              LOG(ERROR)
+                  << "MemorySparseTable save prefix failed, retry it! path:"
+                  << channel_config.path << " , retry_num=" << retry_num;
+              break;
+            }
+            ++feasign_size;
           }
-          ++feasign_size;
         }
-      }
-      write_channel->close();
-      if (err_no == -1) {
-        ++retry_num;
-        is_write_failed = true;
-        LOG(ERROR)
-            << "MemorySparseTable save prefix failed after write, retry it! "
-            << "path:" << channel_config.path << " , retry_num=" << retry_num;
-      }
-      if (is_write_failed) {
-        _afs_client.remove(channel_config.path);
-      }
-      if (retry_num > FLAGS_pserver_table_save_max_retry) {
-        LOG(ERROR) << "MemorySparseTable save prefix failed reach max limit!";
-        exit(-1);
-      }
-    } while (is_write_failed);
+        write_channel->close();
+        if (err_no == -1) {
+          ++retry_num;
+          is_write_failed = true;
+          LOG(ERROR)
+              << "MemorySparseTable save prefix failed after write, retry it! "
+              << "path:" << channel_config.path
+              << " , retry_num=" << retry_num;
+        }
+        if (is_write_failed) {
+          _afs_client.remove(channel_config.path);
+        }
+        if (retry_num > FLAGS_pserver_table_save_max_retry) {
+          LOG(ERROR)
+              << "MemorySparseTable save prefix failed reach max limit!";
+          exit(-1);
+        }
+      } while (is_write_failed);
+    }
     feasign_size_all += feasign_size;
 #ifndef PADDLE_WITH_GPU_GRAPH
     for (auto it = shard.begin(); it != shard.end(); ++it) {
@@ -441,6 +804,9 @@ int32_t MemorySparseTable::Save(const std::string &dirname,
               << channel_config.path << " feasign_size: " << feasign_size;
   }
   _local_show_threshold = tk.top();
+  if (save_param == 0 || save_param == 3) {
+    FinishCheckpoint(true);
+  }
   // int32 may overflow need to change return value
   return 0;
 }
@@ -975,7 +1341,8 @@ int32_t MemorySparseTable::Push(TableContext &context) {
 int32_t MemorySparseTable::PullSparse(float *pull_values,
                                       const PullSparseValue &pull_value) {
   CostTimer timer("pserver_sparse_select_all");
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
+  const size_t task_num = _real_local_shard_num * _shard_fanout;
+  std::vector<std::future<int>> tasks(task_num);
 
   const size_t value_size =
       _value_accessor->GetAccessorInfo().size / sizeof(float);
@@ -985,62 +1352,63 @@ int32_t MemorySparseTable::PullSparse(float *pull_values,
       _value_accessor->GetAccessorInfo().select_size / sizeof(float);
   // std::atomic<uint32_t> missed_keys{0};
 
-  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(task_num);
+  uint32_t dirty_epoch = _dirty_epoch.load(std::memory_order_relaxed);
   size_t num = pull_value.numel_;
   for (size_t i = 0; i < num; ++i) {
     int shard_id = (pull_value.feasigns_[i] % _sparse_table_shard_num) %
                    _avg_local_shard_num;
-    task_keys[shard_id].push_back({pull_value.feasigns_[i], i});
+    task_keys[ShardTaskIndex(shard_id, pull_value.feasigns_[i])].push_back(
+        {pull_value.feasigns_[i], i});
   }
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    tasks[shard_id] =
-        _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
-            [this,
-             shard_id,
-             &task_keys,
-             value_size,
-             pull_values,
-             mf_value_size,
-             select_value_size]() -> int {
-              auto &local_shard = _local_shards[shard_id];
-              float data_buffer[value_size];  // NOLINT
-              float *data_buffer_ptr = data_buffer;
-
-              auto &keys = task_keys[shard_id];
-              for (auto &item : keys) {
-                uint64_t key = item.first;
-                auto itr = local_shard.find(key);
-                size_t data_size = value_size - mf_value_size;
-                if (itr == local_shard.end()) {
-                  // ++missed_keys;
-                  if (FLAGS_pserver_create_value_when_push) {
-                    memset(data_buffer, 0, sizeof(float) * data_size);
-                  } else {
-                    auto &feature_value = local_shard[key];
-                    feature_value.resize(data_size);
-                    float *data_ptr = feature_value.data();
-                    _value_accessor->Create(&data_buffer_ptr, 1);
-                    memcpy(
-                        data_ptr, data_buffer_ptr, data_size * sizeof(float));
-                  }
-                } else {
-                  data_size = itr.value().size();
-                  memcpy(data_buffer_ptr,
-                         itr.value().data(),
-                         data_size * sizeof(float));
-                }
-                for (size_t mf_idx = data_size; mf_idx < value_size; ++mf_idx) {
-                  data_buffer[mf_idx] = 0.0;
-                }
-                auto offset = item.second;
-                float *select_data = pull_values + select_value_size * offset;
-                _value_accessor->Select(
-                    &select_data, (const float **)&data_buffer_ptr, 1);
+  for (size_t task_idx = 0; task_idx < task_num; ++task_idx) {
+    tasks[task_idx] = ShardTaskPool(task_idx)->enqueue(
+        [this,
+         task_idx,
+         &task_keys,
+         value_size,
+         pull_values,
+         mf_value_size,
+         select_value_size,
+         dirty_epoch]() -> int {
+          auto &local_shard = _local_shards[task_idx / _shard_fanout];
+          float data_buffer[value_size];  // NOLINT
+          float *data_buffer_ptr = data_buffer;
+
+          auto &keys = task_keys[task_idx];
+          for (auto &item : keys) {
+            uint64_t key = item.first;
+            auto itr = local_shard.find(key);
+            size_t data_size = value_size - mf_value_size;
+            if (itr == local_shard.end()) {
+              // ++missed_keys;
+              if (FLAGS_pserver_create_value_when_push) {
+                memset(data_buffer, 0, sizeof(float) * data_size);
+              } else {
+                auto &feature_value = local_shard[key];
+                feature_value.resize(data_size);
+                feature_value.set_dirty_epoch(dirty_epoch);
+                float *data_ptr = feature_value.data();
+                _value_accessor->Create(&data_buffer_ptr, 1);
+                memcpy(data_ptr, data_buffer_ptr, data_size * sizeof(float));
               }
+            } else {
+              data_size = itr.value().size();
+              memcpy(data_buffer_ptr,
+                     itr.value().data(),
+                     data_size * sizeof(float));
+            }
+            for (size_t mf_idx = data_size; mf_idx < value_size; ++mf_idx) {
+              data_buffer[mf_idx] = 0.0;
+            }
+            auto offset = item.second;
+            float *select_data = pull_values + select_value_size * offset;
+            _value_accessor->Select(
+                &select_data, (const float **)&data_buffer_ptr, 1);
+          }
 
-              return 0;
-            });
+          return 0;
+        });
   }
 
   for (auto &task : tasks) {
@@ -1059,48 +1427,53 @@ int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
   size_t mf_value_size =
       _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
 
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
-  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+  const size_t task_num = _real_local_shard_num * _shard_fanout;
+  std::vector<std::future<int>> tasks(task_num);
+  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(task_num);
   for (size_t i = 0; i < num; ++i) {
     int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
-    task_keys[shard_id].push_back({keys[i], i});
+    task_keys[ShardTaskIndex(shard_id, keys[i])].push_back({keys[i], i});
   }
+  // only the created rows are dirty here, the writers through the returned
+  // pointers mark the rows they update with mark_dirty()
+  uint32_t dirty_epoch = _dirty_epoch.load(std::memory_order_relaxed);
+  _pulled_by_ptr.store(true, std::memory_order_relaxed);
   // std::atomic<uint32_t> missed_keys{0};
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    tasks[shard_id] =
-        _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
-            [this,
-             shard_id,
-             &task_keys,
-             pull_values,
-             value_size,
-             mf_value_size]() -> int {
-              auto &keys = task_keys[shard_id];
-              auto &local_shard = _local_shards[shard_id];
-              float data_buffer[value_size];  // NOLINT
-              float *data_buffer_ptr = data_buffer;
-              for (auto &item : keys) {
-                uint64_t key = item.first;
-                auto itr = local_shard.find(key);
-                size_t data_size = value_size - mf_value_size;
-                FixedFeatureValue *ret = NULL;
-                if (itr == local_shard.end()) {
-                  // ++missed_keys;
-                  auto &feature_value = local_shard[key];
-                  feature_value.resize(data_size);
-                  float *data_ptr = feature_value.data();
-                  _value_accessor->Create(&data_buffer_ptr, 1);
-                  memcpy(data_ptr, data_buffer_ptr, data_size * sizeof(float));
-                  ret = &feature_value;
-                } else {
-                  ret = itr.value_ptr();
-                }
-                int pull_data_idx = item.second;
-                pull_values[pull_data_idx] = reinterpret_cast<char *>(ret);
-              }
-              return 0;
-            });
+  for (size_t task_idx = 0; task_idx < task_num; ++task_idx) {
+    tasks[task_idx] = ShardTaskPool(task_idx)->enqueue(
+        [this,
+         task_idx,
+         &task_keys,
+         pull_values,
+         value_size,
+         mf_value_size,
+         dirty_epoch]() -> int {
+          auto &keys = task_keys[task_idx];
+          auto &local_shard = _local_shards[task_idx / _shard_fanout];
+          float data_buffer[value_size];  // NOLINT
+          float *data_buffer_ptr = data_buffer;
+          for (auto &item : keys) {
+            uint64_t key = item.first;
+            auto itr = local_shard.find(key);
+            size_t data_size = value_size - mf_value_size;
+            FixedFeatureValue *ret = NULL;
+            if (itr == local_shard.end()) {
+              // ++missed_keys;
+              auto &feature_value = local_shard[key];
+              feature_value.resize(data_size);
+              float *data_ptr = feature_value.data();
+              _value_accessor->Create(&data_buffer_ptr, 1);
+              memcpy(data_ptr, data_buffer_ptr, data_size * sizeof(float));
+              feature_value.set_dirty_epoch(dirty_epoch);
+              ret = &feature_value;
+            } else {
+              ret = itr.value_ptr();
+            }
+            int pull_data_idx = item.second;
+            pull_values[pull_data_idx] = reinterpret_cast<char *>(ret);
+          }
+          return 0;
+        });
   }
   for (auto &task : tasks) {
     task.wait();
@@ -1108,16 +1481,77 @@ int32_t MemorySparseTable::PullSparsePtr(int shard_id,  // fake num
   return 0;
 }
 
+MemorySparseTable::PushBatch::PushBatch(ValueAccessor *accessor,
+                                        size_t value_col)
+    : accessor_(accessor),
+      value_col_(value_col),
+      buffer_(kBatchSize * value_col) {
+  keys_.reserve(kBatchSize);
+  rows_.reserve(kBatchSize);
+  update_values_.reserve(kBatchSize);
+  push_values_.reserve(kBatchSize);
+}
+
+void MemorySparseTable::PushBatch::Add(uint64_t key,
+                                       FixedFeatureValue *value,
+                                       const float *push) {
+  float *update_value = value->data();
+  if (value->size() != value_col_) {
+    if (!buffered_keys_.insert(key).second) {
+      Flush();
+      buffered_keys_.insert(key);
+    }
+    // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
+    update_value = buffer_.data() + rows_.size() * value_col_;
+    memcpy(update_value, value->data(), value->size() * sizeof(float));
+  }
+  keys_.push_back(key);
+  rows_.push_back(value);
+  update_values_.push_back(update_value);
+  push_values_.push_back(push);
+  if (rows_.size() == kBatchSize) {
+    Flush();
+  }
+}
+
+void MemorySparseTable::PushBatch::Flush() {
+  if (rows_.empty()) {
+    return;
+  }
+  accessor_->Update(update_values_.data(), push_values_.data(), rows_.size());
+  for (size_t i = 0; i < rows_.size(); ++i) {
+    FixedFeatureValue *value = rows_[i];
+    float *value_data = value->data();
+    if (update_values_[i] != value_data) {
+      size_t value_size = value->size();
+      if (accessor_->NeedExtendMF(update_values_[i])) {
+        value->resize(value_col_);
+        value_data = value->data();
+        accessor_->Create(&value_data, 1);
+      }
+      memcpy(value_data, update_values_[i], value_size * sizeof(float));
+    }
+    if (after_update) {
+      after_update(keys_[i], value);
+    }
+  }
+  keys_.clear();
+  rows_.clear();
+  update_values_.clear();
+  push_values_.clear();
+  buffered_keys_.clear();
+}
+
 int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                                       const float *values,
                                       size_t num) {
   CostTimer timer("pserver_sparse_update_all");
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
-  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+  const size_t task_num = _real_local_shard_num * _shard_fanout;
+  std::vector<std::future<int>> tasks(task_num);
+  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(task_num);
   for (size_t i = 0; i < num; ++i) {
     int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
-    task_keys[shard_id].push_back({keys[i], i});
+    task_keys[ShardTaskIndex(shard_id, keys[i])].push_back({keys[i], i});
   }
 
   const size_t value_col =
@@ -1126,21 +1560,36 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
       _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
   size_t update_value_col =
       _value_accessor->GetAccessorInfo().update_size / sizeof(float);
+  uint32_t dirty_epoch = _dirty_epoch.load(std::memory_order_relaxed);
 
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    tasks[shard_id] = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
+  for (size_t task_idx = 0; task_idx < task_num; ++task_idx) {
+    tasks[task_idx] = ShardTaskPool(task_idx)->enqueue(
         [this,
-         shard_id,
+         task_idx,
          value_col,
          mf_value_col,
          update_value_col,
          values,
-         &task_keys]() -> int {
-          auto &keys = task_keys[shard_id];
+         &task_keys,
+         dirty_epoch]() -> int {
+          int shard_id = static_cast<int>(task_idx / _shard_fanout);
+          auto &keys = task_keys[task_idx];
           auto &local_shard = _local_shards[shard_id];
           auto &local_shard_new = _local_shards_new[shard_id];
           float data_buffer[value_col];  // NOLINT
           float *data_buffer_ptr = data_buffer;
+          PushBatch batch(_value_accessor.get(), value_col);
+          if (_config.enable_revert()) {
+            batch.after_update = [&local_shard_new](uint64_t key,
+                                                    FixedFeatureValue *value) {
+              FixedFeatureValue *feature_value_new = &(local_shard_new[key]);
+              auto new_size = value->size();
+              feature_value_new->resize(new_size);
+              memcpy(feature_value_new->data(),
+                     value->data(),
+                     new_size * sizeof(float));
+            };
+          }
           for (auto &item : keys) {
             uint64_t key = item.first;
             uint64_t push_data_idx = item.second;
@@ -1163,32 +1612,10 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
             }
 
             auto &feature_value = itr.value();
-            float *value_data = feature_value.data();
-            size_t value_size = feature_value.size();
-
-            if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accessor->Update(&value_data, &update_data, 1);
-            } else {
-              // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
-              memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
-              _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
-
-              if (_value_accessor->NeedExtendMF(data_buffer)) {
-                feature_value.resize(value_col);
-                value_data = feature_value.data();
-                _value_accessor->Create(&value_data, 1);
-              }
-              memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
-            }
-            if (_config.enable_revert()) {
-              FixedFeatureValue *feature_value_new = &(local_shard_new[key]);
-              auto new_size = feature_value.size();
-              feature_value_new->resize(new_size);
-              memcpy(feature_value_new->data(),
-                     value_data,
-                     new_size * sizeof(float));
-            }
+            feature_value.set_dirty_epoch(dirty_epoch);
+            batch.Add(key, &feature_value, update_data);
           }
+          batch.Flush();
           return 0;
         });
   }
@@ -1202,25 +1629,33 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
 int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
                                       const float **values,
                                       size_t num) {
-  std::vector<std::future<int>> tasks(_real_local_shard_num);
-  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(
-      _real_local_shard_num);
+  const size_t task_num = _real_local_shard_num * _shard_fanout;
+  std::vector<std::future<int>> tasks(task_num);
+  std::vector<std::vector<std::pair<uint64_t, int>>> task_keys(task_num);
   for (size_t i = 0; i < num; ++i) {
     int shard_id = (keys[i] % _sparse_table_shard_num) % _avg_local_shard_num;
-    task_keys[shard_id].push_back({keys[i], i});
+    task_keys[ShardTaskIndex(shard_id, keys[i])].push_back({keys[i], i});
   }
 
   size_t value_col = _value_accessor->GetAccessorInfo().size / sizeof(float);
   size_t mf_value_col =
       _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
+  uint32_t dirty_epoch = _dirty_epoch.load(std::memory_order_relaxed);
 
-  for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
-    tasks[shard_id] = _shards_task_pool[shard_id % _task_pool_size]->enqueue(
-        [this, shard_id, value_col, mf_value_col, values, &task_keys]() -> int {
-          auto &keys = task_keys[shard_id];
-          auto &local_shard = _local_shards[shard_id];
+  for (size_t task_idx = 0; task_idx < task_num; ++task_idx) {
+    tasks[task_idx] = ShardTaskPool(task_idx)->enqueue(
+        [this,
+         task_idx,
+         value_col,
+         mf_value_col,
+         values,
+         &task_keys,
+         dirty_epoch]() -> int {
+          auto &keys = task_keys[task_idx];
+          auto &local_shard = _local_shards[task_idx / _shard_fanout];
           float data_buffer[value_col];  // NOLINT
           float *data_buffer_ptr = data_buffer;
+          PushBatch batch(_value_accessor.get(), value_col);
           for (auto &item : keys) {
             uint64_t key = item.first;
             uint64_t push_data_idx = item.second;
@@ -1241,22 +1676,10 @@ int32_t MemorySparseTable::PushSparse(const uint64_t *keys,
               itr = local_shard.find(key);
             }
             auto &feature_value = itr.value();
-            float *value_data = feature_value.data();
-            size_t value_size = feature_value.size();
-            if (value_size == value_col) {  // 已拓展到最大size, 则就地update
-              _value_accessor->Update(&value_data, &update_data, 1);
-            } else {
-              // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
-              memcpy(data_buffer_ptr, value_data, value_size * sizeof(float));
-              _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
-              if (_value_accessor->NeedExtendMF(data_buffer)) {
-                feature_value.resize(value_col);
-                value_data = feature_value.data();
-                _value_accessor->Create(&value_data, 1);
-              }
-              memcpy(value_data, data_buffer_ptr, value_size * sizeof(float));
-            }
+            feature_value.set_dirty_epoch(dirty_epoch);
+            batch.Add(key, &feature_value, update_data);
           }
+          batch.Flush();
           return 0;
         });
   }
@@ -1272,6 +1695,8 @@ int32_t MemorySparseTable::Flush() { return 0; }
 int32_t MemorySparseTable::Shrink(const std::string &param) {
   VLOG(0) << "MemorySparseTable::Shrink";
   std::atomic<uint32_t> shrink_size_all{0};
+  // shrink decays every row, so all the survivors are dirty
+  uint32_t dirty_epoch = _dirty_epoch.load(std::memory_order_relaxed);
   int thread_num = _real_local_shard_num;
   omp_set_num_threads(thread_num);
 #pragma omp parallel for schedule(dynamic)
@@ -1281,9 +1706,13 @@ int32_t MemorySparseTable::Shrink(const std::string &param) {
     auto &shard = _local_shards[shard_id];
     for (auto it = shard.begin(); it != shard.end();) {
       if (_value_accessor->Shrink(it.value().data())) {
+        if (FLAGS_pserver_sparse_table_delta_save) {
+          _erased_keys[shard_id].emplace_back(it.key(), dirty_epoch);
+        }
         it = shard.erase(it);
         ++feasign_size;
       } else {
+        it.value().set_dirty_epoch(dirty_epoch);
         ++it;
       }
     }
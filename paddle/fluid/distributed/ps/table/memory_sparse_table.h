@@ -18,10 +18,13 @@
 #include <assert.h>
 #include <pthread.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -118,14 +121,95 @@ class MemorySparseTable : public Table {
   virtual int32_t SavePatch(const std::string& path, int save_param);
   virtual int32_t LoadPatch(const std::vector<std::string>& file_list,
                             int save_param);
+  // binary shard format, see depends/binary_shard.h
+  int32_t LoadBinaryShards(const std::vector<std::string>& file_list,
+                           size_t file_start_idx);
+  // return the number of saved rows, -1 on failure
+  int32_t SaveBinaryShard(int shard_id,
+                          const std::string& path,
+                          int save_param);
+  // delta checkpoint (param 6), rows modified after the checkpoint
+  // `since_epoch` plus tombstones of the keys erased by shrink since then
+  int32_t SaveDelta(const std::string& table_path, uint32_t since_epoch);
+  // path is "base_dir,delta_dir_1,...,delta_dir_n"
+  int32_t LoadWithDeltas(const std::string& path);
+  int32_t LoadDelta(const std::string& path);
+  // take a new checkpoint id, a full checkpoint starts a new delta chain
+  void FinishCheckpoint(bool full);
+
+  // Updates the rows a shard task pushes to with one ValueAccessor::Update
+  // call per kBatchSize rows, so that the sgd rules run over a batch. The
+  // rows not extended to their mf part yet are updated in a buffer, then
+  // extended if the accessor asks for it and copied back, like one by one.
+  class PushBatch {
+   public:
+    static constexpr size_t kBatchSize = 256;
+
+    PushBatch(ValueAccessor* accessor, size_t value_col);
+
+    // push is applied to value, the row of key, by this call or a later one
+    void Add(uint64_t key, FixedFeatureValue* value, const float* push);
+    // update the rows added since the last Flush
+    void Flush();
+
+    // called for each row after its update, if set
+    std::function<void(uint64_t key, FixedFeatureValue* value)> after_update;
+
+   private:
+    ValueAccessor* accessor_;
+    size_t value_col_;
+    std::vector<uint64_t> keys_;
+    std::vector<FixedFeatureValue*> rows_;
+    std::vector<float*> update_values_;
+    std::vector<const float*> push_values_;
+    // the rows of the batch updated in buffer_, a key pushed twice has to
+    // see its first update, so it starts a new batch
+    std::vector<float> buffer_;
+    std::unordered_set<uint64_t> buffered_keys_;
+  };
+
+  // Pull/push work of one shard is split by hash bucket into _shard_fanout
+  // tasks. Part 0 runs on the shard's own task pool, the other parts on
+  // _shards_fanout_task_pool, one single-thread pool per (shard, part) so
+  // that each bucket is still only touched by a single thread.
+  size_t ShardTaskIndex(int shard_id, uint64_t key) {
+    if (_shard_fanout == 1) {
+      return shard_id;
+    }
+    return shard_id * _shard_fanout +
+           _local_shards[shard_id].bucket_of(key) % _shard_fanout;
+  }
+  ::ThreadPool* ShardTaskPool(size_t task_idx) {
+    int shard_id = static_cast<int>(task_idx / _shard_fanout);
+    int part = static_cast<int>(task_idx % _shard_fanout);
+    if (part == 0) {
+      return _shards_task_pool[shard_id % _shards_task_pool.size()].get();
+    }
+    return _shards_fanout_task_pool[(shard_id % _task_pool_size) *
+                                        (_shard_fanout - 1) +
+                                    part - 1]
+        .get();
+  }
 
   int _task_pool_size = 24;
+  int _shard_fanout = 1;
   int _avg_local_shard_num;
   int _real_local_shard_num;
   int _sparse_table_shard_num;
   std::vector<std::shared_ptr<::ThreadPool>> _shards_task_pool;
+  std::vector<std::shared_ptr<::ThreadPool>> _shards_fanout_task_pool;
   std::unique_ptr<shard_type[]> _local_shards;
 
+  // for delta checkpoint, rows modified after checkpoint k carry a dirty
+  // epoch greater than k
+  std::atomic<uint32_t> _dirty_epoch{1};
+  // rows handed out by PullSparsePtr may be marked dirty without an epoch
+  std::atomic<bool> _pulled_by_ptr{false};
+  uint32_t _last_checkpoint_epoch = 0;
+  uint32_t _base_checkpoint_epoch = 0;
+  // keys erased by shrink since the last full checkpoint and their epoch
+  std::vector<std::vector<std::pair<uint64_t, uint32_t>>> _erased_keys;
+
   // for patch model
   int _m_avg_local_shard_num;
   int _m_real_local_shard_num;
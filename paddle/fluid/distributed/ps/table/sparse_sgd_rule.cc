@@ -17,11 +17,58 @@
 #include "glog/logging.h"
 
 #include "paddle/common/flags.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
 
 PD_DEFINE_bool(enable_show_scale_gradient, true, "enable show scale gradient");
+PD_DEFINE_bool(pserver_sparse_sgd_simd,
+               true,
+               "update sparse values with the AVX2/AVX-512 sgd kernels when "
+               "the cpu supports them");
 
 namespace paddle::distributed {
 
+const SparseSGDKernels *GetSparseSGDKernels() {
+  if (!FLAGS_pserver_sparse_sgd_simd) {
+    return nullptr;
+  }
+  static const SparseSGDKernels *kernels = []() -> const SparseSGDKernels * {
+    const SparseSGDKernels *ret = nullptr;
+    if (phi::backends::cpu::MayIUse(phi::backends::cpu::avx512f)) {
+      ret = SparseSGDKernelsAVX512();
+    }
+    if (ret == nullptr &&
+        phi::backends::cpu::MayIUse(phi::backends::cpu::avx2)) {
+      ret = SparseSGDKernelsAVX2();
+    }
+    VLOG(0) << "sparse sgd rule kernels: "
+            << (ret == nullptr ? "scalar" : ret->name);
+    return ret;
+  }();
+  return kernels;
+}
+
+void SparseValueSGDRule::UpdateValueBatch(float **values,
+                                          size_t w_offset,
+                                          size_t sgd_offset,
+                                          const float **push_values,
+                                          size_t grad_offset,
+                                          const float *scales,
+                                          size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    // rows are scattered over the shard, fetch the next one while this one
+    // is being updated
+    if (i + 1 < num) {
+      __builtin_prefetch(values[i + 1] + w_offset, 1);
+      __builtin_prefetch(values[i + 1] + sgd_offset, 1);
+      __builtin_prefetch(push_values[i + 1] + grad_offset, 0);
+    }
+    UpdateValueWork(values[i] + w_offset,
+                    values[i] + sgd_offset,
+                    push_values[i] + grad_offset,
+                    scales[i]);
+  }
+}
+
 void SparseNaiveSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
                                     size_t emb_dim) {
   _embedding_dim = emb_dim;
@@ -38,12 +85,18 @@ void SparseNaiveSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = naive_param.weight_bounds(0);
     _max_bound = naive_param.weight_bounds(1);
   }
+  _kernels = GetSparseSGDKernels();
 }
 
 void SparseNaiveSGDRule::UpdateValueWork(float *w,
                                          float *sgd,
                                          const float *push_value,
                                          float scale) {
+  if (_kernels != nullptr) {
+    _kernels->naive(
+        w, push_value, _embedding_dim, learning_rate_, _min_bound, _max_bound);
+    return;
+  }
   for (size_t i = 0; i < _embedding_dim; ++i) {
     w[i] -= learning_rate_ * push_value[i];
     BoundValue(w[i]);
@@ -85,6 +138,7 @@ void SparseAdaGradSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adagrad_param.weight_bounds(0);
     _max_bound = adagrad_param.weight_bounds(1);
   }
+  _kernels = GetSparseSGDKernels();
 }
 
 void SparseAdaGradSGDRule::UpdateValueWork(float *w,
@@ -93,6 +147,13 @@ void SparseAdaGradSGDRule::UpdateValueWork(float *w,
                                            float scale) {
   float &g2sum = sgd[G2SumIndex()];
   double add_g2sum = 0;
+  if (_kernels != nullptr) {
+    float lr = learning_rate_ * sqrt(_initial_g2sum / (_initial_g2sum + g2sum));
+    add_g2sum = _kernels->adagrad(
+        w, grad, _embedding_dim, lr, scale, _min_bound, _max_bound);
+    g2sum += add_g2sum / _embedding_dim;
+    return;
+  }
 
   for (size_t i = 0; i < _embedding_dim; i++) {
     double scaled_grad = grad[i] / scale;
@@ -142,12 +203,25 @@ void StdAdaGradSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adagrad_param.weight_bounds(0);
     _max_bound = adagrad_param.weight_bounds(1);
   }
+  _kernels = GetSparseSGDKernels();
 }
 
 void StdAdaGradSGDRule::UpdateValueWork(float *w,
                                         float *sgd,
                                         const float *grad,
                                         float scale) {
+  if (_kernels != nullptr) {
+    _kernels->std_adagrad(w,
+                          sgd + G2SumIndex(),
+                          grad,
+                          _embedding_dim,
+                          learning_rate_,
+                          _initial_g2sum,
+                          scale,
+                          _min_bound,
+                          _max_bound);
+    return;
+  }
   for (size_t i = 0; i < _embedding_dim; i++) {
     float &g2sum = sgd[G2SumIndex() + i];
     double scaled_grad = grad[i] / scale;
@@ -196,6 +270,7 @@ void SparseAdamSGDRule::LoadConfig(const SparseCommonSGDRuleParameter &param,
     _min_bound = adam_param.weight_bounds(0);
     _max_bound = adam_param.weight_bounds(1);
   }
+  _kernels = GetSparseSGDKernels();
 }
 
 void SparseAdamSGDRule::UpdateValueWork(float *w,
@@ -213,6 +288,22 @@ void SparseAdamSGDRule::UpdateValueWork(float *w,
   float beta2_pow_ = *beta2_pow;
 
   lr *= sqrt(1 - beta2_pow_) / (1 - beta1_pow_);
+  if (_kernels != nullptr) {
+    _kernels->adam(w,
+                   gsum,
+                   g2sum,
+                   g,
+                   _embedding_dim,
+                   lr,
+                   _beta1_decay_rate,
+                   _beta2_decay_rate,
+                   _ada_epsilon,
+                   _min_bound,
+                   _max_bound);
+    (*beta1_pow) *= _beta1_decay_rate;
+    (*beta2_pow) *= _beta2_decay_rate;
+    return;
+  }
   for (size_t i = 0; i < _embedding_dim; i++) {
     // Calculation
     gsum[i] = _beta1_decay_rate * gsum[i] + (1 - _beta1_decay_rate) * g[i];
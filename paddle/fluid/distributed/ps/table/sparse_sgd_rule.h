@@ -21,6 +21,7 @@
 #include "glog/logging.h"                                  // for CHECK
 #include "paddle/fluid/distributed/common/local_random.h"  // for local_uniform_real_distribution
 #include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule_simd.h"
 #include "paddle/fluid/distributed/the_one_ps.pb.h"
 
 namespace paddle {
@@ -51,6 +52,16 @@ class SparseValueSGDRule {
                    float scale = 1) {
     UpdateValueWork(w, sgd, push_value, scale);
   }
+  // Update `num` rows in one call. Row i keeps its weights at values[i] +
+  // w_offset, its optimizer state at values[i] + sgd_offset and reads the
+  // gradients at push_values[i] + grad_offset scaled by scales[i].
+  virtual void UpdateValueBatch(float** values,
+                                size_t w_offset,
+                                size_t sgd_offset,
+                                const float** push_values,
+                                size_t grad_offset,
+                                const float* scales,
+                                size_t num);
   template <class T>
   void BoundValue(T& w) {  // NOLINT
     if (!(w >= _min_bound)) {
@@ -67,6 +78,8 @@ class SparseValueSGDRule {
   float _max_bound;
   float _initial_range;
   size_t _embedding_dim;
+  // vectorized loops picked in LoadConfig, nullptr for the scalar ones
+  const SparseSGDKernels* _kernels = nullptr;
 
  private:
   std::string _name;
@@ -0,0 +1,191 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Built with the AVX2 and FMA flags, keep the includes minimal.
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule_simd.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#include <math.h>
+#endif
+
+namespace paddle {
+namespace distributed {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+namespace {
+
+// max/min return their second operand on NaN, so NaN goes to min_bound
+inline __m256 Bound(__m256 w, __m256 min_bound, __m256 max_bound) {
+  return _mm256_min_ps(_mm256_max_ps(w, min_bound), max_bound);
+}
+
+inline float Bound(float w, float min_bound, float max_bound) {
+  if (!(w >= min_bound)) {
+    return min_bound;
+  } else if (!(w <= max_bound)) {
+    return max_bound;
+  }
+  return w;
+}
+
+inline float HorizontalSum(__m256 v) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v),
+                          _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+void NaiveAVX2(float* w,
+               const float* g,
+               size_t dim,
+               float lr,
+               float min_bound,
+               float max_bound) {
+  const __m256 v_lr = _mm256_set1_ps(lr);
+  const __m256 v_min = _mm256_set1_ps(min_bound);
+  const __m256 v_max = _mm256_set1_ps(max_bound);
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256 v_w = _mm256_fnmadd_ps(
+        v_lr, _mm256_loadu_ps(g + i), _mm256_loadu_ps(w + i));
+    _mm256_storeu_ps(w + i, Bound(v_w, v_min, v_max));
+  }
+  for (; i < dim; ++i) {
+    w[i] = Bound(w[i] - lr * g[i], min_bound, max_bound);
+  }
+}
+
+float AdaGradAVX2(float* w,
+                  const float* g,
+                  size_t dim,
+                  float lr,
+                  float scale,
+                  float min_bound,
+                  float max_bound) {
+  const __m256 v_lr = _mm256_set1_ps(lr);
+  const __m256 v_scale = _mm256_set1_ps(scale);
+  const __m256 v_min = _mm256_set1_ps(min_bound);
+  const __m256 v_max = _mm256_set1_ps(max_bound);
+  __m256 v_sum = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256 v_g = _mm256_div_ps(_mm256_loadu_ps(g + i), v_scale);
+    __m256 v_w = _mm256_fnmadd_ps(v_lr, v_g, _mm256_loadu_ps(w + i));
+    _mm256_storeu_ps(w + i, Bound(v_w, v_min, v_max));
+    v_sum = _mm256_fmadd_ps(v_g, v_g, v_sum);
+  }
+  float sum = HorizontalSum(v_sum);
+  for (; i < dim; ++i) {
+    float scaled_grad = g[i] / scale;
+    w[i] = Bound(w[i] - lr * scaled_grad, min_bound, max_bound);
+    sum += scaled_grad * scaled_grad;
+  }
+  return sum;
+}
+
+void StdAdaGradAVX2(float* w,
+                    float* g2sum,
+                    const float* g,
+                    size_t dim,
+                    float lr,
+                    float initial_g2sum,
+                    float scale,
+                    float min_bound,
+                    float max_bound) {
+  const __m256 v_lr = _mm256_set1_ps(lr);
+  const __m256 v_init = _mm256_set1_ps(initial_g2sum);
+  const __m256 v_scale = _mm256_set1_ps(scale);
+  const __m256 v_min = _mm256_set1_ps(min_bound);
+  const __m256 v_max = _mm256_set1_ps(max_bound);
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256 v_g = _mm256_div_ps(_mm256_loadu_ps(g + i), v_scale);
+    __m256 v_g2sum = _mm256_loadu_ps(g2sum + i);
+    __m256 v_ratio = _mm256_sqrt_ps(
+        _mm256_div_ps(v_init, _mm256_add_ps(v_init, v_g2sum)));
+    __m256 v_w = _mm256_fnmadd_ps(
+        _mm256_mul_ps(v_lr, v_ratio), v_g, _mm256_loadu_ps(w + i));
+    _mm256_storeu_ps(w + i, Bound(v_w, v_min, v_max));
+    _mm256_storeu_ps(g2sum + i, _mm256_fmadd_ps(v_g, v_g, v_g2sum));
+  }
+  for (; i < dim; ++i) {
+    float scaled_grad = g[i] / scale;
+    float ratio = sqrtf(initial_g2sum / (initial_g2sum + g2sum[i]));
+    w[i] = Bound(w[i] - lr * ratio * scaled_grad, min_bound, max_bound);
+    g2sum[i] += scaled_grad * scaled_grad;
+  }
+}
+
+void AdamAVX2(float* w,
+              float* gsum,
+              float* g2sum,
+              const float* g,
+              size_t dim,
+              float lr,
+              float beta1,
+              float beta2,
+              float epsilon,
+              float min_bound,
+              float max_bound) {
+  const __m256 v_lr = _mm256_set1_ps(lr);
+  const __m256 v_beta1 = _mm256_set1_ps(beta1);
+  const __m256 v_beta2 = _mm256_set1_ps(beta2);
+  const __m256 v_one_beta1 = _mm256_set1_ps(1 - beta1);
+  const __m256 v_one_beta2 = _mm256_set1_ps(1 - beta2);
+  const __m256 v_eps = _mm256_set1_ps(epsilon);
+  const __m256 v_min = _mm256_set1_ps(min_bound);
+  const __m256 v_max = _mm256_set1_ps(max_bound);
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    __m256 v_g = _mm256_loadu_ps(g + i);
+    __m256 v_gsum = _mm256_fmadd_ps(
+        v_beta1, _mm256_loadu_ps(gsum + i), _mm256_mul_ps(v_one_beta1, v_g));
+    __m256 v_g2sum =
+        _mm256_fmadd_ps(v_beta2,
+                        _mm256_loadu_ps(g2sum + i),
+                        _mm256_mul_ps(v_one_beta2, _mm256_mul_ps(v_g, v_g)));
+    __m256 v_step = _mm256_div_ps(
+        v_gsum, _mm256_add_ps(_mm256_sqrt_ps(v_g2sum), v_eps));
+    __m256 v_w = _mm256_fnmadd_ps(v_lr, v_step, _mm256_loadu_ps(w + i));
+    _mm256_storeu_ps(gsum + i, v_gsum);
+    _mm256_storeu_ps(g2sum + i, v_g2sum);
+    _mm256_storeu_ps(w + i, Bound(v_w, v_min, v_max));
+  }
+  for (; i < dim; ++i) {
+    gsum[i] = beta1 * gsum[i] + (1 - beta1) * g[i];
+    g2sum[i] = beta2 * g2sum[i] + (1 - beta2) * g[i] * g[i];
+    w[i] = Bound(w[i] - lr * (gsum[i] / (sqrtf(g2sum[i]) + epsilon)),
+                 min_bound,
+                 max_bound);
+  }
+}
+
+const SparseSGDKernels kAVX2Kernels = {
+    "avx2", NaiveAVX2, AdaGradAVX2, StdAdaGradAVX2, AdamAVX2};
+
+}  // namespace
+
+const SparseSGDKernels* SparseSGDKernelsAVX2() { return &kAVX2Kernels; }
+
+#else
+
+const SparseSGDKernels* SparseSGDKernelsAVX2() { return nullptr; }
+
+#endif
+
+}  // namespace distributed
+}  // namespace paddle
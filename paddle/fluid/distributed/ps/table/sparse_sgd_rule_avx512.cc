@@ -0,0 +1,171 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Built with the AVX512F flag, keep the includes minimal.
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule_simd.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace paddle {
+namespace distributed {
+
+#if defined(__AVX512F__)
+
+namespace {
+
+// max/min return their second operand on NaN, so NaN goes to min_bound
+inline __m512 Bound(__m512 w, __m512 min_bound, __m512 max_bound) {
+  return _mm512_min_ps(_mm512_max_ps(w, min_bound), max_bound);
+}
+
+// the tail of a row is handled by masked loads and stores, masked off lanes
+// read zeros and are never written back
+inline __mmask16 TailMask(size_t dim, size_t i) {
+  size_t rest = dim - i;
+  return rest >= 16 ? static_cast<__mmask16>(0xFFFF)
+                    : static_cast<__mmask16>((1u << rest) - 1);
+}
+
+void NaiveAVX512(float* w,
+                 const float* g,
+                 size_t dim,
+                 float lr,
+                 float min_bound,
+                 float max_bound) {
+  const __m512 v_lr = _mm512_set1_ps(lr);
+  const __m512 v_min = _mm512_set1_ps(min_bound);
+  const __m512 v_max = _mm512_set1_ps(max_bound);
+  for (size_t i = 0; i < dim; i += 16) {
+    __mmask16 mask = TailMask(dim, i);
+    __m512 v_w = _mm512_fnmadd_ps(v_lr,
+                                  _mm512_maskz_loadu_ps(mask, g + i),
+                                  _mm512_maskz_loadu_ps(mask, w + i));
+    _mm512_mask_storeu_ps(w + i, mask, Bound(v_w, v_min, v_max));
+  }
+}
+
+float AdaGradAVX512(float* w,
+                    const float* g,
+                    size_t dim,
+                    float lr,
+                    float scale,
+                    float min_bound,
+                    float max_bound) {
+  const __m512 v_lr = _mm512_set1_ps(lr);
+  const __m512 v_scale = _mm512_set1_ps(scale);
+  const __m512 v_min = _mm512_set1_ps(min_bound);
+  const __m512 v_max = _mm512_set1_ps(max_bound);
+  __m512 v_sum = _mm512_setzero_ps();
+  for (size_t i = 0; i < dim; i += 16) {
+    __mmask16 mask = TailMask(dim, i);
+    __m512 v_g = _mm512_div_ps(_mm512_maskz_loadu_ps(mask, g + i), v_scale);
+    __m512 v_w =
+        _mm512_fnmadd_ps(v_lr, v_g, _mm512_maskz_loadu_ps(mask, w + i));
+    _mm512_mask_storeu_ps(w + i, mask, Bound(v_w, v_min, v_max));
+    v_sum = _mm512_fmadd_ps(v_g, v_g, v_sum);
+  }
+  float lanes[16];  // NOLINT
+  _mm512_storeu_ps(lanes, v_sum);
+  float sum = 0;
+  for (int i = 0; i < 16; ++i) {
+    sum += lanes[i];
+  }
+  return sum;
+}
+
+void StdAdaGradAVX512(float* w,
+                      float* g2sum,
+                      const float* g,
+                      size_t dim,
+                      float lr,
+                      float initial_g2sum,
+                      float scale,
+                      float min_bound,
+                      float max_bound) {
+  const __m512 v_lr = _mm512_set1_ps(lr);
+  const __m512 v_init = _mm512_set1_ps(initial_g2sum);
+  const __m512 v_scale = _mm512_set1_ps(scale);
+  const __m512 v_min = _mm512_set1_ps(min_bound);
+  const __m512 v_max = _mm512_set1_ps(max_bound);
+  for (size_t i = 0; i < dim; i += 16) {
+    __mmask16 mask = TailMask(dim, i);
+    __m512 v_g = _mm512_div_ps(_mm512_maskz_loadu_ps(mask, g + i), v_scale);
+    __m512 v_g2sum = _mm512_maskz_loadu_ps(mask, g2sum + i);
+    __m512 v_ratio = _mm512_sqrt_ps(
+        _mm512_div_ps(v_init, _mm512_add_ps(v_init, v_g2sum)));
+    __m512 v_w = _mm512_fnmadd_ps(_mm512_mul_ps(v_lr, v_ratio),
+                                  v_g,
+                                  _mm512_maskz_loadu_ps(mask, w + i));
+    _mm512_mask_storeu_ps(w + i, mask, Bound(v_w, v_min, v_max));
+    _mm512_mask_storeu_ps(
+        g2sum + i, mask, _mm512_fmadd_ps(v_g, v_g, v_g2sum));
+  }
+}
+
+void AdamAVX512(float* w,
+                float* gsum,
+                float* g2sum,
+                const float* g,
+                size_t dim,
+                float lr,
+                float beta1,
+                float beta2,
+                float epsilon,
+                float min_bound,
+                float max_bound) {
+  const __m512 v_lr = _mm512_set1_ps(lr);
+  const __m512 v_beta1 = _mm512_set1_ps(beta1);
+  const __m512 v_beta2 = _mm512_set1_ps(beta2);
+  const __m512 v_one_beta1 = _mm512_set1_ps(1 - beta1);
+  const __m512 v_one_beta2 = _mm512_set1_ps(1 - beta2);
+  const __m512 v_eps = _mm512_set1_ps(epsilon);
+  const __m512 v_min = _mm512_set1_ps(min_bound);
+  const __m512 v_max = _mm512_set1_ps(max_bound);
+  for (size_t i = 0; i < dim; i += 16) {
+    __mmask16 mask = TailMask(dim, i);
+    __m512 v_g = _mm512_maskz_loadu_ps(mask, g + i);
+    __m512 v_gsum = _mm512_fmadd_ps(v_beta1,
+                                    _mm512_maskz_loadu_ps(mask, gsum + i),
+                                    _mm512_mul_ps(v_one_beta1, v_g));
+    __m512 v_g2sum =
+        _mm512_fmadd_ps(v_beta2,
+                        _mm512_maskz_loadu_ps(mask, g2sum + i),
+                        _mm512_mul_ps(v_one_beta2, _mm512_mul_ps(v_g, v_g)));
+    __m512 v_step = _mm512_div_ps(
+        v_gsum, _mm512_add_ps(_mm512_sqrt_ps(v_g2sum), v_eps));
+    __m512 v_w =
+        _mm512_fnmadd_ps(v_lr, v_step, _mm512_maskz_loadu_ps(mask, w + i));
+    _mm512_mask_storeu_ps(gsum + i, mask, v_gsum);
+    _mm512_mask_storeu_ps(g2sum + i, mask, v_g2sum);
+    _mm512_mask_storeu_ps(w + i, mask, Bound(v_w, v_min, v_max));
+  }
+}
+
+const SparseSGDKernels kAVX512Kernels = {
+    "avx512f", NaiveAVX512, AdaGradAVX512, StdAdaGradAVX512, AdamAVX512};
+
+}  // namespace
+
+const SparseSGDKernels* SparseSGDKernelsAVX512() { return &kAVX512Kernels; }
+
+#else
+
+const SparseSGDKernels* SparseSGDKernelsAVX512() { return nullptr; }
+
+#endif
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,77 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+
+namespace paddle {
+namespace distributed {
+
+// Vectorized inner loops of the sparse sgd rules. Every table lives in its
+// own translation unit built with the matching ISA flags, so this header must
+// stay free of inline code that could be emitted with those flags.
+//
+// All kernels clamp the updated weights into [min_bound, max_bound] like
+// SparseValueSGDRule::BoundValue, NaN included.
+struct SparseSGDKernels {
+  const char* name;
+  // w -= lr * g
+  void (*naive)(float* w,
+                const float* g,
+                size_t dim,
+                float lr,
+                float min_bound,
+                float max_bound);
+  // w -= lr * g / scale, returns the sum of (g / scale)^2
+  float (*adagrad)(float* w,
+                   const float* g,
+                   size_t dim,
+                   float lr,
+                   float scale,
+                   float min_bound,
+                   float max_bound);
+  // per dimension adagrad with g2sum updated in place
+  void (*std_adagrad)(float* w,
+                      float* g2sum,
+                      const float* g,
+                      size_t dim,
+                      float lr,
+                      float initial_g2sum,
+                      float scale,
+                      float min_bound,
+                      float max_bound);
+  // adam with bias corrected lr, gsum and g2sum updated in place
+  void (*adam)(float* w,
+               float* gsum,
+               float* g2sum,
+               const float* g,
+               size_t dim,
+               float lr,
+               float beta1,
+               float beta2,
+               float epsilon,
+               float min_bound,
+               float max_bound);
+};
+
+// nullptr if the library was built without the ISA
+const SparseSGDKernels* SparseSGDKernelsAVX2();
+const SparseSGDKernels* SparseSGDKernelsAVX512();
+
+// the widest kernels supported by the cpu, nullptr means the scalar loops
+const SparseSGDKernels* GetSparseSGDKernels();
+
+}  // namespace distributed
+}  // namespace paddle
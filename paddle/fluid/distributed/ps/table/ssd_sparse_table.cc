@@ -25,6 +25,16 @@ PD_DECLARE_bool(pserver_create_value_when_push);
 PD_DECLARE_bool(pserver_enable_create_feasign_randomly);
 PD_DEFINE_bool(pserver_open_strict_check, false, "pserver_open_strict_check");
 PD_DEFINE_int32(pserver_load_batch_size, 5000, "load batch size for ssd");
+PD_DEFINE_int64(pserver_ssd_cache_capacity_per_shard,
+                0,
+                "max rows kept in memory per ssd table shard, cold rows are "
+                "admitted by TinyLFU and evicted to rocksdb, 0 is unbounded");
+PD_DEFINE_int32(pserver_ssd_multi_get_batch_size,
+                256,
+                "keys per rocksdb MultiGet when pulling cold rows");
+PD_DEFINE_int32(pserver_ssd_writeback_batch_size,
+                1024,
+                "rows per rocksdb WriteBatch when writing back evicted rows");
 PADDLE_DEFINE_EXPORTED_string(rocksdb_path,
                               "database",
                               "path of sparse table rocksdb file");
@@ -34,8 +44,26 @@ namespace distributed {
 
 int32_t SSDSparseTable::Initialize() {
   MemorySparseTable::Initialize();
+  auto& profiler = CostProfiler::instance();
+  profiler.register_profiler("pserver_ssd_sparse_pull_us");
+  profiler.register_profiler("pserver_ssd_multi_get_us");
+  _shards_read_pool.resize(_shards_task_pool.size());
+  for (auto& read_pool : _shards_read_pool) {
+    read_pool.reset(new ::ThreadPool(1));
+  }
   _db = ::paddle::distributed::RocksDBHandler::GetInstance();
   _db->initialize(FLAGS_rocksdb_path, _real_local_shard_num);
+  if (FLAGS_pserver_ssd_cache_capacity_per_shard > 0) {
+    _shard_caches.resize(_real_local_shard_num);
+    for (auto& cache : _shard_caches) {
+      cache.reset(
+          new SSDShardCache(FLAGS_pserver_ssd_cache_capacity_per_shard));
+    }
+    _writeback.reset(new SSDWriteBackBatcher(
+        _db, _real_local_shard_num, FLAGS_pserver_ssd_writeback_batch_size));
+    VLOG(0) << "SSDSparseTable memory tier capacity per shard: "
+            << FLAGS_pserver_ssd_cache_capacity_per_shard;
+  }
   VLOG(0) << "initialize SSDSparseTable succ";
   VLOG(0) << "SSD FLAGS_pserver_print_missed_key_num_every_push:"
           << FLAGS_pserver_print_missed_key_num_every_push;
@@ -44,6 +72,91 @@ int32_t SSDSparseTable::Initialize() {
 
 int32_t SSDSparseTable::InitializeShard() { return 0; }
 
+int SSDSparseTable::GetColdValue(int shard_id,
+                                 uint64_t key,
+                                 std::string* value) {
+  SSDCacheStat* stat =
+      _shard_caches.empty() ? nullptr : &_shard_caches[shard_id]->stat();
+  if (_writeback != nullptr) {
+    int ret = _writeback->Get(shard_id, key, value);
+    if (ret == 0) {
+      stat->pending_hit.fetch_add(1, std::memory_order_relaxed);
+      return 0;
+    } else if (ret < 0) {
+      stat->miss.fetch_add(1, std::memory_order_relaxed);
+      return 1;
+    }
+  }
+  int ret = _db->get(
+      shard_id, reinterpret_cast<char*>(&key), sizeof(uint64_t), *value);
+  if (stat != nullptr) {
+    if (ret > 0) {
+      stat->miss.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      stat->ssd_hit.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return ret;
+}
+
+void SSDSparseTable::DelColdValue(int shard_id, uint64_t key) {
+  if (_writeback != nullptr) {
+    _writeback->Delete(shard_id, key);
+  } else {
+    _db->del_data(shard_id, reinterpret_cast<char*>(&key), sizeof(uint64_t));
+  }
+}
+
+void SSDSparseTable::EvictShard(int shard_id) {
+  if (_shard_caches.empty()) {
+    return;
+  }
+  auto& cache = *_shard_caches[shard_id];
+  auto& local_shard = _local_shards[shard_id];
+  if (local_shard.size() <= cache.capacity()) {
+    return;
+  }
+  // CLOCK over the shard buckets: every full sweep that frees too little
+  // raises the frequency a row may have and still be evicted. Pinned rows are
+  // skipped, so a sweep at the highest threshold that frees nothing means
+  // only pinned rows are left above the target.
+  size_t target = cache.evict_target();
+  size_t bucket_count = local_shard.bucket_count();
+  uint32_t threshold = 0;
+  size_t swept = 0;
+  size_t evicted_in_sweep = 0;
+  while (local_shard.size() > target) {
+    size_t bucket = cache.NextBucket(bucket_count);
+    for (auto it = local_shard.begin(bucket);
+         it != local_shard.end(bucket) && local_shard.size() > target;) {
+      if (cache.Frequency(it.key()) <= threshold && !cache.Pinned(it.key())) {
+        _writeback->Put(
+            shard_id, it.key(), it.value().data(), it.value().size());
+        it = local_shard.erase(bucket, it);
+        cache.stat().evicted.fetch_add(1, std::memory_order_relaxed);
+        ++evicted_in_sweep;
+      } else {
+        ++it;
+      }
+    }
+    if (++swept % bucket_count == 0) {
+      if (threshold < FrequencySketch::kMaxCount) {
+        ++threshold;
+      } else if (evicted_in_sweep == 0) {
+        break;
+      }
+      evicted_in_sweep = 0;
+    }
+  }
+  cache.set_victim_frequency(threshold);
+}
+
+void SSDSparseTable::FlushWriteBack() {
+  if (_writeback != nullptr) {
+    _writeback->Flush();
+  }
+}
+
 void SSDSparseTable::SetDayId(int day_id) { _day_id = day_id; }
 
 int32_t SSDSparseTable::Pull(TableContext& context) {
@@ -78,11 +191,7 @@ int32_t SSDSparseTable::PullSparse(float* pull_values,
                                    const uint64_t* keys,
                                    size_t num) {
   CostTimer timer("pserver_downpour_sparse_select_all");
-  size_t value_size = _value_accessor->GetAccessorInfo().size / sizeof(float);
-  size_t mf_value_size =
-      _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
-  size_t select_value_size =
-      _value_accessor->GetAccessorInfo().select_size / sizeof(float);
+  CostTimerUs latency_timer("pserver_ssd_sparse_pull_us");
 
   {  // 从table取值 or create
     std::vector<std::future<int>> tasks(_real_local_shard_num);
@@ -97,74 +206,9 @@ int32_t SSDSparseTable::PullSparse(float* pull_values,
     for (int shard_id = 0; shard_id < _real_local_shard_num; ++shard_id) {
       tasks[shard_id] =
           _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
-              [this,
-               shard_id,
-               &task_keys,
-               value_size,
-               mf_value_size,
-               select_value_size,
-               pull_values,
-               &missed_keys]() -> int {
-                auto& keys = task_keys[shard_id];
-                auto& local_shard = _local_shards[shard_id];
-                float data_buffer[value_size];  // NOLINT
-                float* data_buffer_ptr = data_buffer;
-                for (size_t i = 0; i < keys.size(); ++i) {
-                  uint64_t key = keys[i].first;
-                  auto itr = local_shard.find(key);
-                  size_t data_size = value_size - mf_value_size;
-                  if (itr == local_shard.end()) {
-                    // pull rocksdb
-                    std::string tmp_string("");
-                    if (_db->get(shard_id,
-                                 reinterpret_cast<char*>(&key),
-                                 sizeof(uint64_t),
-                                 tmp_string) > 0) {
-                      ++missed_keys;
-                      if (FLAGS_pserver_create_value_when_push) {
-                        memset(data_buffer, 0, sizeof(float) * data_size);
-                      } else {
-                        auto& feature_value = local_shard[key];
-                        feature_value.resize(data_size);
-                        float* data_ptr =
-                            const_cast<float*>(feature_value.data());
-                        _value_accessor->Create(&data_buffer_ptr, 1);
-                        memcpy(data_ptr,
-                               data_buffer_ptr,
-                               data_size * sizeof(float));
-                      }
-                    } else {
-                      data_size = tmp_string.size() / sizeof(float);
-                      memcpy(data_buffer_ptr,
-                             ::paddle::string::str_to_float(tmp_string),
-                             data_size * sizeof(float));
-                      // from rocksdb to mem
-                      auto& feature_value = local_shard[key];
-                      feature_value.resize(data_size);
-                      memcpy(const_cast<float*>(feature_value.data()),
-                             data_buffer_ptr,
-                             data_size * sizeof(float));
-                      _db->del_data(shard_id,
-                                    reinterpret_cast<char*>(&key),
-                                    sizeof(uint64_t));
-                    }
-                  } else {
-                    data_size = itr.value().size();
-                    memcpy(data_buffer_ptr,
-                           itr.value().data(),
-                           data_size * sizeof(float));
-                  }
-                  for (size_t mf_idx = data_size; mf_idx < value_size;
-                       ++mf_idx) {
-                    data_buffer[mf_idx] = 0.0;
-                  }
-                  int pull_data_idx = keys[i].second;
-                  float* select_data =
-                      pull_values + pull_data_idx * select_value_size;
-                  _value_accessor->Select(
-                      &select_data, (const float**)&data_buffer_ptr, 1);
-                }
-                return 0;
+              [this, shard_id, &task_keys, pull_values, &missed_keys]() -> int {
+                return PullSparseShard(
+                    shard_id, &task_keys[shard_id], pull_values, &missed_keys);
               });
     }
     for (int i = 0; i < _real_local_shard_num; ++i) {
@@ -178,6 +222,173 @@ int32_t SSDSparseTable::PullSparse(float* pull_values,
   return 0;
 }
 
+int32_t SSDSparseTable::PullSparseShard(
+    int shard_id,
+    std::vector<std::pair<uint64_t, int>>* keys,
+    float* pull_values,
+    std::atomic<uint32_t>* missed_keys) {
+  size_t value_size = _value_accessor->GetAccessorInfo().size / sizeof(float);
+  size_t mf_value_size =
+      _value_accessor->GetAccessorInfo().mf_size / sizeof(float);
+  size_t select_value_size =
+      _value_accessor->GetAccessorInfo().select_size / sizeof(float);
+  auto& local_shard = _local_shards[shard_id];
+  SSDShardCache* cache =
+      _shard_caches.empty() ? nullptr : _shard_caches[shard_id].get();
+  float data_buffer[value_size];  // NOLINT
+  float* data_buffer_ptr = data_buffer;
+
+  // data_buffer holds data_size floats of the row, select it to the output
+  auto select = [&](int pull_data_idx, size_t data_size) {
+    for (size_t mf_idx = data_size; mf_idx < value_size; ++mf_idx) {
+      data_buffer[mf_idx] = 0.0;
+    }
+    float* select_data = pull_values + pull_data_idx * select_value_size;
+    _value_accessor->Select(&select_data, (const float**)&data_buffer_ptr, 1);
+  };
+  // returns false if the key is not resident
+  auto pull_mem = [&](uint64_t key, int pull_data_idx) {
+    auto itr = local_shard.find(key);
+    if (itr == local_shard.end()) {
+      return false;
+    }
+    size_t data_size = itr.value().size();
+    memcpy(data_buffer_ptr, itr.value().data(), data_size * sizeof(float));
+    select(pull_data_idx, data_size);
+    return true;
+  };
+  // the row is decoded from rocksdb's buffer without an extra string copy
+  auto pull_cold = [&](uint64_t key, int pull_data_idx, rocksdb::Slice data) {
+    size_t data_size = data.size() / sizeof(float);
+    memcpy(data_buffer_ptr, data.data(), data_size * sizeof(float));
+    // rows rejected by the admission policy are served straight from
+    // rocksdb and stay there
+    if (cache == nullptr || cache->Admit(key, local_shard.size())) {
+      // from rocksdb to mem
+      auto& feature_value = local_shard[key];
+      feature_value.resize(data_size);
+      memcpy(feature_value.data(), data_buffer_ptr, data_size * sizeof(float));
+      DelColdValue(shard_id, key);
+    }
+    select(pull_data_idx, data_size);
+  };
+  auto pull_missed = [&](uint64_t key, int pull_data_idx) {
+    ++(*missed_keys);
+    size_t data_size = value_size - mf_value_size;
+    if (FLAGS_pserver_create_value_when_push) {
+      memset(data_buffer, 0, sizeof(float) * data_size);
+    } else {
+      auto& feature_value = local_shard[key];
+      feature_value.resize(data_size);
+      _value_accessor->Create(&data_buffer_ptr, 1);
+      memcpy(feature_value.data(), data_buffer_ptr, data_size * sizeof(float));
+    }
+    select(pull_data_idx, data_size);
+  };
+
+  std::vector<std::pair<uint64_t, int>> cold_keys;
+  for (auto& item : *keys) {
+    uint64_t key = item.first;
+    if (cache != nullptr) {
+      cache->Access(key);
+    }
+    if (pull_mem(key, item.second)) {
+      if (cache != nullptr) {
+        cache->stat().mem_hit.fetch_add(1, std::memory_order_relaxed);
+      }
+      continue;
+    }
+    if (_writeback != nullptr) {
+      // rows still waiting for write back are not visible to MultiGet
+      std::string tmp_string("");
+      int ret = _writeback->Get(shard_id, key, &tmp_string);
+      if (ret == 0) {
+        cache->stat().pending_hit.fetch_add(1, std::memory_order_relaxed);
+        pull_cold(key, item.second, rocksdb::Slice(tmp_string));
+        continue;
+      } else if (ret < 0) {
+        cache->stat().miss.fetch_add(1, std::memory_order_relaxed);
+        pull_missed(key, item.second);
+        continue;
+      }
+    }
+    cold_keys.push_back(item);
+  }
+
+  if (!cold_keys.empty()) {
+    // multi_get passes sorted_input, so the keys are sorted with the
+    // comparator the shard db was opened with (Uint64Comparator), not by
+    // their bytes. The batches are read on the shard's read thread while the
+    // previous batch is being decoded.
+    const rocksdb::Comparator* comparator = _db->get_comparator();
+    std::sort(cold_keys.begin(),
+              cold_keys.end(),
+              [comparator](const std::pair<uint64_t, int>& a,
+                           const std::pair<uint64_t, int>& b) {
+                return comparator->Compare(
+                           rocksdb::Slice(
+                               reinterpret_cast<const char*>(&a.first),
+                               sizeof(uint64_t)),
+                           rocksdb::Slice(
+                               reinterpret_cast<const char*>(&b.first),
+                               sizeof(uint64_t))) < 0;
+              });
+    size_t batch_size = std::max(FLAGS_pserver_ssd_multi_get_batch_size, 1);
+    RocksDBCtx context;
+    auto submit = [&](size_t begin) {
+      RocksDBItem* item = context.switch_item();
+      item->reset();
+      size_t end = std::min(begin + batch_size, cold_keys.size());
+      for (size_t i = begin; i < end; ++i) {
+        item->batch_keys.emplace_back(
+            reinterpret_cast<const char*>(&cold_keys[i].first),
+            sizeof(uint64_t));
+        item->batch_index.push_back(i);
+      }
+      item->batch_values.resize(item->batch_keys.size());
+      item->status.resize(item->batch_keys.size());
+      return _shards_read_pool[shard_id % _shards_read_pool.size()]->enqueue(
+          [this, shard_id, item]() -> int {
+            CostTimerUs timer("pserver_ssd_multi_get_us");
+            _db->multi_get(shard_id,
+                           item->batch_keys.size(),
+                           item->batch_keys.data(),
+                           item->batch_values.data(),
+                           item->status.data());
+            return 0;
+          });
+    };
+    auto fut = submit(0);
+    for (size_t begin = 0; begin < cold_keys.size(); begin += batch_size) {
+      fut.wait();
+      RocksDBItem* ready = &context.items[context.cur_index];
+      if (begin + batch_size < cold_keys.size()) {
+        fut = submit(begin + batch_size);
+      }
+      for (size_t idx = 0; idx < ready->status.size(); ++idx) {
+        auto& item = cold_keys[ready->batch_index[idx]];
+        // a duplicated key was already promoted by its first occurrence
+        if (pull_mem(item.first, item.second)) {
+          continue;
+        }
+        if (ready->status[idx].ok()) {
+          if (cache != nullptr) {
+            cache->stat().ssd_hit.fetch_add(1, std::memory_order_relaxed);
+          }
+          pull_cold(item.first, item.second, ready->batch_values[idx]);
+        } else {
+          if (cache != nullptr) {
+            cache->stat().miss.fetch_add(1, std::memory_order_relaxed);
+          }
+          pull_missed(item.first, item.second);
+        }
+      }
+    }
+  }
+  EvictShard(shard_id);
+  return 0;
+}
+
 int32_t SSDSparseTable::PullSparsePtr(int shard_id,
                                       char** pull_values,
                                       const uint64_t* pull_keys,
@@ -201,6 +412,30 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
     for (size_t i = 0; i < num; ++i) {
       uint64_t key = pull_keys[i];
       auto itr = local_shard.find(key);
+      if (itr == local_shard.end() && _writeback != nullptr) {
+        // rows still waiting for write back are not visible to MultiGet
+        std::string tmp_string("");
+        int ret = _writeback->Get(shard_id, key, &tmp_string);
+        if (ret <= 0) {
+          auto& feature_value = local_shard[key];
+          if (ret == 0) {
+            int data_size = tmp_string.size() / sizeof(float);
+            feature_value.resize(data_size);
+            memcpy(const_cast<float*>(feature_value.data()),
+                   ::paddle::string::str_to_float(tmp_string),
+                   data_size * sizeof(float));
+            DelColdValue(shard_id, key);
+          } else {
+            int init_size = value_size - mf_value_size;
+            feature_value.resize(init_size);
+            _value_accessor->Create(&data_buffer_ptr, 1);
+            memcpy(const_cast<float*>(feature_value.data()),
+                   data_buffer_ptr,
+                   init_size * sizeof(float));
+          }
+          itr = local_shard.find(key);
+        }
+      }
       if (itr == local_shard.end()) {
         cur_ctx->batch_index.push_back(i);
         cur_ctx->batch_keys.emplace_back(
@@ -211,11 +446,13 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
           auto fut =
               _shards_task_pool[shard_id % _shards_task_pool.size()]->enqueue(
                   [this, shard_id, cur_ctx]() -> int {
+                    // the keys are in pull order
                     _db->multi_get(shard_id,
                                    cur_ctx->batch_keys.size(),
                                    cur_ctx->batch_keys.data(),
                                    cur_ctx->batch_values.data(),
-                                   cur_ctx->status.data());
+                                   cur_ctx->status.data(),
+                                   /*sorted_input=*/false);
                     return 0;
                   });
           cur_ctx = context.switch_item();
@@ -224,7 +461,12 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
             for (size_t idx = 0; idx < cur_ctx->status.size(); idx++) {
               uint64_t cur_key = *(reinterpret_cast<uint64_t*>(
                   const_cast<char*>(cur_ctx->batch_keys[idx].data())));
-              if (cur_ctx->status[idx].IsNotFound()) {
+              auto cur_itr = local_shard.find(cur_key);
+              if (cur_itr != local_shard.end()) {
+                // a duplicated key was promoted by its first occurrence, and
+                // its rocksdb row may already be deleted
+                ret = cur_itr.value_ptr();
+              } else if (cur_ctx->status[idx].IsNotFound()) {
                 auto& feature_value = local_shard[cur_key];
                 int init_size = value_size - mf_value_size;
                 feature_value.resize(init_size);
@@ -243,9 +485,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
                        ::paddle::string::str_to_float(
                            cur_ctx->batch_values[idx].data()),
                        data_size * sizeof(float));
-                _db->del_data(shard_id,
-                              reinterpret_cast<char*>(&cur_key),
-                              sizeof(uint64_t));
+                DelColdValue(shard_id, cur_key);
                 ret = &feature_value;
               }
 
@@ -281,7 +521,8 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
                                cur_ctx->batch_keys.size(),
                                cur_ctx->batch_keys.data(),
                                cur_ctx->batch_values.data(),
-                               cur_ctx->status.data());
+                               cur_ctx->status.data(),
+                               /*sorted_input=*/false);
                 return 0;
               });
       tasks.push_back(std::move(fut));
@@ -294,7 +535,11 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
       for (size_t idx = 0; idx < cur_ctx->status.size(); idx++) {
         uint64_t cur_key = *(reinterpret_cast<uint64_t*>(
             const_cast<char*>(cur_ctx->batch_keys[idx].data())));
-        if (cur_ctx->status[idx].IsNotFound()) {
+        auto cur_itr = local_shard.find(cur_key);
+        if (cur_itr != local_shard.end()) {
+          // a duplicated key was promoted by its first occurrence
+          ret = cur_itr.value_ptr();
+        } else if (cur_ctx->status[idx].IsNotFound()) {
           auto& feature_value = local_shard[cur_key];
           int init_size = value_size - mf_value_size;
           feature_value.resize(init_size);
@@ -312,8 +557,7 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
               const_cast<float*>(feature_value.data()),
               ::paddle::string::str_to_float(cur_ctx->batch_values[idx].data()),
               data_size * sizeof(float));
-          _db->del_data(
-              shard_id, reinterpret_cast<char*>(&cur_key), sizeof(uint64_t));
+          DelColdValue(shard_id, cur_key);
           ret = &feature_value;
         }
         _value_accessor->UpdateTimeDecay(ret->data(), true);
@@ -326,6 +570,16 @@ int32_t SSDSparseTable::PullSparsePtr(int shard_id,
       cur_ctx->reset();
     }
   }
+  if (!_shard_caches.empty()) {
+    // the caller keeps the returned pointers, pin the rows before the shard
+    // is shrunk back under its capacity
+    auto& cache = *_shard_caches[shard_id];
+    for (size_t i = 0; i < num; ++i) {
+      cache.Access(pull_keys[i]);
+      cache.Pin(pull_keys[i], pass_id);
+    }
+    EvictShard(shard_id);
+  }
   return 0;
 }
 
@@ -359,14 +613,31 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                &task_keys]() -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                SSDShardCache* cache = _shard_caches.empty()
+                                           ? nullptr
+                                           : _shard_caches[shard_id].get();
                 float data_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                PushBatch batch(_value_accessor.get(), value_col);
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
                   uint64_t push_data_idx = keys[i].second;
                   const float* update_data =
                       values + push_data_idx * update_value_col;
                   auto itr = local_shard.find(key);
+                  if (itr == local_shard.end() && cache != nullptr) {
+                    // evicted or never admitted rows are updated in memory
+                    std::string tmp_string("");
+                    if (GetColdValue(shard_id, key, &tmp_string) == 0) {
+                      auto& feature_value = local_shard[key];
+                      feature_value.resize(tmp_string.size() / sizeof(float));
+                      memcpy(const_cast<float*>(feature_value.data()),
+                             ::paddle::string::str_to_float(tmp_string),
+                             tmp_string.size());
+                      DelColdValue(shard_id, key);
+                      itr = local_shard.find(key);
+                    }
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accessor->CreateValue(1, update_data)) {
@@ -381,29 +652,10 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                            value_size * sizeof(float));
                     itr = local_shard.find(key);
                   }
-                  auto& feature_value = itr.value();
-                  float* value_data = const_cast<float*>(feature_value.data());
-                  size_t value_size = feature_value.size();
-
-                  if (value_size ==
-                      value_col) {  // 已拓展到最大size, 则就地update
-                    _value_accessor->Update(&value_data, &update_data, 1);
-                  } else {
-                    // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
-                    memcpy(data_buffer_ptr,
-                           value_data,
-                           value_size * sizeof(float));
-                    _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
-                    if (_value_accessor->NeedExtendMF(data_buffer)) {
-                      feature_value.resize(value_col);
-                      value_data = const_cast<float*>(feature_value.data());
-                      _value_accessor->Create(&value_data, 1);
-                    }
-                    memcpy(value_data,
-                           data_buffer_ptr,
-                           value_size * sizeof(float));
-                  }
+                  batch.Add(key, &itr.value(), update_data);
                 }
+                batch.Flush();
+                EvictShard(shard_id);
                 return 0;
               });
     }
@@ -460,13 +712,30 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                   -> int {
                 auto& keys = task_keys[shard_id];
                 auto& local_shard = _local_shards[shard_id];
+                SSDShardCache* cache = _shard_caches.empty()
+                                           ? nullptr
+                                           : _shard_caches[shard_id].get();
                 float data_buffer[value_col];  // NOLINT
                 float* data_buffer_ptr = data_buffer;
+                PushBatch batch(_value_accessor.get(), value_col);
                 for (size_t i = 0; i < keys.size(); ++i) {
                   uint64_t key = keys[i].first;
                   uint64_t push_data_idx = keys[i].second;
                   const float* update_data = values[push_data_idx];
                   auto itr = local_shard.find(key);
+                  if (itr == local_shard.end() && cache != nullptr) {
+                    // evicted or never admitted rows are updated in memory
+                    std::string tmp_string("");
+                    if (GetColdValue(shard_id, key, &tmp_string) == 0) {
+                      auto& feature_value = local_shard[key];
+                      feature_value.resize(tmp_string.size() / sizeof(float));
+                      memcpy(const_cast<float*>(feature_value.data()),
+                             ::paddle::string::str_to_float(tmp_string),
+                             tmp_string.size());
+                      DelColdValue(shard_id, key);
+                      itr = local_shard.find(key);
+                    }
+                  }
                   if (itr == local_shard.end()) {
                     if (FLAGS_pserver_enable_create_feasign_randomly &&
                         !_value_accessor->CreateValue(1, update_data)) {
@@ -481,29 +750,10 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
                            value_size * sizeof(float));
                     itr = local_shard.find(key);
                   }
-                  auto& feature_value = itr.value();
-                  float* value_data = const_cast<float*>(feature_value.data());
-                  size_t value_size = feature_value.size();
-
-                  if (value_size ==
-                      value_col) {  // 已拓展到最大size, 则就地update
-                    _value_accessor->Update(&value_data, &update_data, 1);
-                  } else {
-                    // 拷入buffer区进行update，然后再回填，不需要的mf则回填时抛弃了
-                    memcpy(data_buffer_ptr,
-                           value_data,
-                           value_size * sizeof(float));
-                    _value_accessor->Update(&data_buffer_ptr, &update_data, 1);
-                    if (_value_accessor->NeedExtendMF(data_buffer)) {
-                      feature_value.resize(value_col);
-                      value_data = const_cast<float*>(feature_value.data());
-                      _value_accessor->Create(&value_data, 1);
-                    }
-                    memcpy(value_data,
-                           data_buffer_ptr,
-                           value_size * sizeof(float));
-                  }
+                  batch.Add(key, &itr.value(), update_data);
                 }
+                batch.Flush();
+                EvictShard(shard_id);
                 return 0;
               });
     }
@@ -515,6 +765,7 @@ int32_t SSDSparseTable::PushSparse(const uint64_t* keys,
 }
 
 int32_t SSDSparseTable::Shrink(const std::string& param) {
+  FlushWriteBack();
   int thread_num = _real_local_shard_num < 20 ? _real_local_shard_num : 20;
   omp_set_num_threads(thread_num);
 #pragma omp parallel for schedule(dynamic)
@@ -555,6 +806,7 @@ int32_t SSDSparseTable::Shrink(const std::string& param) {
 }
 
 int32_t SSDSparseTable::UpdateTable() {
+  FlushWriteBack();
   int count = 0;
   for (int i = 0; i < _real_local_shard_num; ++i) {
     auto& shard = _local_shards[i];
@@ -589,6 +841,7 @@ int64_t SSDSparseTable::LocalSize() {
 int32_t SSDSparseTable::Save(const std::string& path,
                              const std::string& param) {
   std::lock_guard<std::mutex> guard(_table_mutex);
+  FlushWriteBack();
 #ifdef PADDLE_WITH_HETERPS
   int save_param = atoi(param.c_str());
   int32_t ret = 0;
@@ -612,6 +865,7 @@ int32_t SSDSparseTable::Save_v2(const std::string& path,
     return Save(path, param);
   }
   std::lock_guard<std::mutex> guard(_table_mutex);
+  FlushWriteBack();
 #ifdef PADDLE_WITH_HETERPS
   int save_param = atoi(param.c_str());
   int32_t ret = 0;
@@ -2355,6 +2609,7 @@ int64_t SSDSparseTable::CacheShuffle(
     const std::vector<Table*>& table_ptrs) {
   LOG(INFO) << "cache shuffle with cache threshold: " << cache_threshold
             << " param:" << param;
+  FlushWriteBack();
   int save_param = atoi(param.c_str());  // batch_model:0  xbox:1
   if (!_config.enable_sparse_table_cache() || cache_threshold < 0) {
     LOG(WARNING)
@@ -2468,6 +2723,7 @@ int32_t SSDSparseTable::SaveCache(
   if (_shard_idx >= _config.sparse_table_cache_file_num()) {
     return 0;
   }
+  FlushWriteBack();
   int save_param = atoi(param.c_str());  // batch_model:0  xbox:1
   std::string table_path = ::paddle::string::format_string(
       "%s/%03d_cache/", path.c_str(), _config.table_id());
@@ -2512,6 +2768,7 @@ int32_t SSDSparseTable::SaveCache(
 int32_t SSDSparseTable::Load(const std::string& path,
                              const std::string& param) {
   VLOG(0) << "LOAD FLAGS_rocksdb_path:" << FLAGS_rocksdb_path;
+  FlushWriteBack();
   std::string table_path = TableDir(path);
   auto file_list = _afs_client.list(table_path);
 
@@ -2937,11 +3194,43 @@ int32_t SSDSparseTable::LoadWithBinary(const std::string& path, int param) {
 
 std::pair<int64_t, int64_t> SSDSparseTable::PrintTableStat() {
   int64_t feasign_size = LocalSize();
+  if (!_shard_caches.empty()) {
+    uint64_t mem_hit = 0, pending_hit = 0, ssd_hit = 0, miss = 0;
+    uint64_t admitted = 0, rejected = 0, evicted = 0;
+    for (auto& cache : _shard_caches) {
+      auto& stat = cache->stat();
+      mem_hit += stat.mem_hit.load(std::memory_order_relaxed);
+      pending_hit += stat.pending_hit.load(std::memory_order_relaxed);
+      ssd_hit += stat.ssd_hit.load(std::memory_order_relaxed);
+      miss += stat.miss.load(std::memory_order_relaxed);
+      admitted += stat.admitted.load(std::memory_order_relaxed);
+      rejected += stat.rejected.load(std::memory_order_relaxed);
+      evicted += stat.evicted.load(std::memory_order_relaxed);
+    }
+    LOG(INFO) << "SSDSparseTable memory tier: mem_hit " << mem_hit
+              << " pending_hit " << pending_hit << " ssd_hit " << ssd_hit
+              << " miss " << miss << " admitted " << admitted << " rejected "
+              << rejected << " evicted " << evicted << " written_back "
+              << _writeback->written_rows();
+  }
+  auto& profiler = CostProfiler::instance();
+  for (auto* label :
+       {"pserver_ssd_sparse_pull_us", "pserver_ssd_multi_get_us"}) {
+    auto* node = profiler.profiler(label);
+    if (node != nullptr && node->recorder->count() > 0) {
+      LOG(INFO) << label << " count " << node->recorder->count() << " avg "
+                << node->recorder->latency() << " p50 "
+                << node->recorder->latency_percentile(0.5) << " p99 "
+                << node->recorder->latency_percentile(0.99) << " max "
+                << node->recorder->max_latency();
+    }
+  }
   return {feasign_size, -1};
 }
 
 int32_t SSDSparseTable::CacheTable(uint16_t pass_id) {
   std::lock_guard<std::mutex> guard(_table_mutex);
+  FlushWriteBack();
   VLOG(0) << "cache_table";
   std::atomic<uint32_t> count{0};
   std::vector<std::future<int>> tasks;
@@ -14,8 +14,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "paddle/common/flags.h"
 #include "paddle/fluid/distributed/ps/table/depends/rocksdb_warpper.h"
+#include "paddle/fluid/distributed/ps/table/depends/ssd_cache.h"
 #include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
 
 namespace paddle {
@@ -73,6 +80,12 @@ class SSDSparseTable : public MemorySparseTable {
   int32_t Push(TableContext& context) override;
 
   int32_t PullSparse(float* pull_values, const uint64_t* keys, size_t num);
+  // pull the keys of one shard, cold rows are fetched with pipelined
+  // MultiGet batches
+  int32_t PullSparseShard(int shard_id,
+                          std::vector<std::pair<uint64_t, int>>* keys,
+                          float* pull_values,
+                          std::atomic<uint32_t>* missed_keys);
   int32_t PullSparsePtr(int shard_id,
                         char** pull_values,
                         const uint64_t* keys,
@@ -130,8 +143,27 @@ class SSDSparseTable : public MemorySparseTable {
 
   void SetDayId(int day_id) override;
 
+  // the memory tier of the shard, nullptr if the table is unbounded
+  SSDShardCache* ShardCache(int shard_id) {
+    return _shard_caches.empty() ? nullptr : _shard_caches[shard_id].get();
+  }
+  // wait until the rows evicted so far are persisted in rocksdb
+  void FlushWriteBack();
+
  private:
+  // look up a row that is not resident in memory, 1 means not found
+  int GetColdValue(int shard_id, uint64_t key, std::string* value);
+  void DelColdValue(int shard_id, uint64_t key);
+  // shrink the memory tier of the shard back under its capacity
+  void EvictShard(int shard_id);
+
   RocksDBHandler* _db;
+  // one MultiGet prefetch thread per shard task thread
+  std::vector<std::shared_ptr<::ThreadPool>> _shards_read_pool;
+  // bounded memory tier, only set up when
+  // FLAGS_pserver_ssd_cache_capacity_per_shard > 0
+  std::vector<std::unique_ptr<SSDShardCache>> _shard_caches;
+  std::unique_ptr<SSDWriteBackBatcher> _writeback;
   int64_t _cache_tk_size;
   double _local_show_threshold{0.0};
   std::vector<paddle::framework::Channel<std::string>> _fs_channel;
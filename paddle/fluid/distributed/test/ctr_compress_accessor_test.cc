@@ -0,0 +1,335 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/ctr_compress_accessor.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/common/registerer.h"
+#include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+namespace paddle::distributed {
+REGISTER_PSCORE_CLASS(SparseValueSGDRule, SparseAdaGradSGDRule);
+REGISTER_PSCORE_CLASS(SparseValueSGDRule, SparseNaiveSGDRule);
+
+namespace {
+
+const int kEmbedxDim = 64;
+const char* const kWeightTypes[] = {"fp16", "bf16", "int8"};
+
+// an empty weight_type gives the fp32 CtrCommonAccessor
+TableAccessorParameter GenParam(const std::string& weight_type,
+                                const std::string& embedx_sgd_name) {
+  TableAccessorParameter param;
+  param.set_accessor_class(weight_type.empty() ? "CtrCommonAccessor"
+                                               : "CtrCompressAccessor");
+  param.set_fea_dim(3 + kEmbedxDim);
+  param.set_embedx_dim(kEmbedxDim);
+  param.set_embedx_threshold(0);
+  auto* ctr_param = param.mutable_ctr_accessor_param();
+  ctr_param->set_nonclk_coeff(0.2);
+  ctr_param->set_click_coeff(1);
+  ctr_param->set_base_threshold(0.5);
+  ctr_param->set_delta_threshold(0.2);
+  ctr_param->set_delta_keep_days(16);
+  ctr_param->set_show_click_decay_rate(0.99);
+  if (!weight_type.empty()) {
+    ctr_param->set_embedx_weight_type(weight_type);
+  }
+
+  param.mutable_embed_sgd_param()->set_name("SparseAdaGradSGDRule");
+  auto* adagrad_param = param.mutable_embed_sgd_param()->mutable_adagrad();
+  adagrad_param->set_learning_rate(0.05);
+  adagrad_param->set_initial_range(0.0);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->add_weight_bounds(-10.0);
+  adagrad_param->add_weight_bounds(10.0);
+
+  param.mutable_embedx_sgd_param()->set_name(embedx_sgd_name);
+  if (embedx_sgd_name == "SparseNaiveSGDRule") {
+    auto* naive_param = param.mutable_embedx_sgd_param()->mutable_naive();
+    naive_param->set_learning_rate(1.0);
+    naive_param->set_initial_range(0.0);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  } else {
+    adagrad_param = param.mutable_embedx_sgd_param()->mutable_adagrad();
+    adagrad_param->set_learning_rate(0.05);
+    adagrad_param->set_initial_range(0.01);
+    adagrad_param->set_initial_g2sum(3.0);
+    adagrad_param->add_weight_bounds(-10.0);
+    adagrad_param->add_weight_bounds(10.0);
+  }
+  return param;
+}
+
+std::unique_ptr<CtrCommonAccessor> CreateAccessor(
+    const std::string& weight_type,
+    const std::string& embedx_sgd_name = "SparseAdaGradSGDRule") {
+  std::unique_ptr<CtrCommonAccessor> acc;
+  if (weight_type.empty()) {
+    acc.reset(new CtrCommonAccessor());
+  } else {
+    acc.reset(new CtrCompressAccessor());
+  }
+  EXPECT_EQ(acc->Configure(GenParam(weight_type, embedx_sgd_name)), 0);
+  EXPECT_EQ(acc->Initialize(), 0);
+  return acc;
+}
+
+// rows stored back to back, with the pointer arrays the accessor api takes
+struct Rows {
+  Rows(size_t num, size_t dim) : data(num * dim, 0.0) {
+    for (size_t i = 0; i < num; ++i) {
+      ptrs.push_back(data.data() + i * dim);
+      const_ptrs.push_back(data.data() + i * dim);
+    }
+  }
+  Rows(const Rows& other)
+      : Rows(other.size(), other.data.size() / other.size()) {
+    std::copy(other.data.begin(), other.data.end(), data.begin());
+  }
+  size_t size() const { return ptrs.size(); }
+  std::vector<float> data;
+  std::vector<float*> ptrs;
+  std::vector<const float*> const_ptrs;
+};
+
+void RandomPush(std::default_random_engine* engine,
+                float embedx_g_mean,
+                Rows* push) {
+  std::normal_distribution<float> dist(0.0, 0.1);
+  size_t dim = push->data.size() / push->size();
+  for (size_t i = 0; i < push->size(); ++i) {
+    float* push_value = push->ptrs[i];
+    push_value[CtrCommonAccessor::CtrCommonPushValue::SlotIndex()] = 1;
+    push_value[CtrCommonAccessor::CtrCommonPushValue::ShowIndex()] = 1;
+    push_value[CtrCommonAccessor::CtrCommonPushValue::ClickIndex()] =
+        i % 3 == 0;
+    for (size_t j = CtrCommonAccessor::CtrCommonPushValue::EmbedGIndex();
+         j < dim;
+         ++j) {
+      push_value[j] = embedx_g_mean + dist(*engine);
+    }
+  }
+}
+
+Rows SelectAll(ValueAccessor* acc, Rows* values) {
+  Rows pull(values->size(), acc->GetAccessorInfo().select_dim);
+  acc->Select(pull.ptrs.data(), values->const_ptrs.data(), values->size());
+  return pull;
+}
+
+// relative rms error of the pulled embedx weights
+double EmbedxError(const Rows& expect, const Rows& actual) {
+  size_t dim = expect.data.size() / expect.size();
+  double err = 0;
+  double norm = 0;
+  for (size_t i = 0; i < expect.size(); ++i) {
+    for (size_t j = CtrCommonAccessor::CtrCommonPullValue::EmbedxWIndex();
+         j < dim;
+         ++j) {
+      double diff = actual.ptrs[i][j] - expect.ptrs[i][j];
+      err += diff * diff;
+      norm += expect.ptrs[i][j] * expect.ptrs[i][j];
+    }
+  }
+  return std::sqrt(err / norm);
+}
+
+}  // namespace
+
+TEST(ctr_compress_accessor_test, test_layout) {
+  auto fp32_acc = CreateAccessor("");
+  ASSERT_EQ(fp32_acc->GetAccessorInfo().dim, 8u + kEmbedxDim);
+  // slot to embedx_g2sum stay fp32, then the packed weights
+  const size_t expect_dims[] = {8 + kEmbedxDim / 2,
+                                8 + kEmbedxDim / 2,
+                                8 + 1 + kEmbedxDim / 4};
+  for (int i = 0; i < 3; ++i) {
+    auto acc = CreateAccessor(kWeightTypes[i]);
+    auto info = acc->GetAccessorInfo();
+    ASSERT_EQ(info.dim, expect_dims[i]);
+    ASSERT_EQ(info.size, expect_dims[i] * sizeof(float));
+    ASSERT_EQ(info.mf_size, (expect_dims[i] - 7) * sizeof(float));
+    ASSERT_EQ(info.select_dim, fp32_acc->GetAccessorInfo().select_dim);
+    ASSERT_EQ(info.update_dim, fp32_acc->GetAccessorInfo().update_dim);
+    LOG(INFO) << kWeightTypes[i] << " value size " << info.size
+              << " bytes, fp32 " << fp32_acc->GetAccessorInfo().size;
+  }
+
+  CtrCompressAccessor acc;
+  ASSERT_EQ(acc.Configure(GenParam("fp8", "SparseAdaGradSGDRule")), 0);
+  ASSERT_EQ(acc.Initialize(), -1);
+}
+
+TEST(ctr_compress_accessor_test, test_accuracy) {
+  const size_t row_num = 1000;
+  const int step_num = 100;
+  const double max_error[] = {0.01, 0.05, 0.15};
+  auto fp32_acc = CreateAccessor("");
+  size_t fp32_dim = fp32_acc->GetAccessorInfo().dim;
+  Rows init(row_num, fp32_dim);
+  fp32_acc->Create(init.ptrs.data(), row_num);
+
+  for (int t = 0; t < 3; ++t) {
+    auto acc = CreateAccessor(kWeightTypes[t]);
+    size_t dim = acc->GetAccessorInfo().dim;
+    Rows expect = init;
+    Rows actual(row_num, dim);
+    // the compressed accessor loads the fp32 text format
+    for (size_t i = 0; i < row_num; ++i) {
+      auto str = fp32_acc->ParseToString(init.ptrs[i], fp32_dim);
+      ASSERT_EQ(acc->ParseFromString(str, actual.ptrs[i]),
+                static_cast<int>(dim));
+    }
+    std::default_random_engine engine(t);
+    Rows push(row_num, fp32_acc->GetAccessorInfo().update_dim);
+    for (int step = 0; step < step_num; ++step) {
+      RandomPush(&engine, 0.0, &push);
+      fp32_acc->Update(expect.ptrs.data(), push.const_ptrs.data(), row_num);
+      acc->Update(actual.ptrs.data(), push.const_ptrs.data(), row_num);
+    }
+    auto expect_pull = SelectAll(fp32_acc.get(), &expect);
+    auto actual_pull = SelectAll(acc.get(), &actual);
+    for (size_t i = 0; i < row_num; ++i) {
+      for (int j = 0; j < CtrCommonAccessor::CtrCommonPullValue::EmbedxWIndex();
+           ++j) {
+        ASSERT_EQ(actual_pull.ptrs[i][j], expect_pull.ptrs[i][j]);
+      }
+    }
+    double error = EmbedxError(expect_pull, actual_pull);
+    LOG(INFO) << kWeightTypes[t] << " embedx relative rms error after "
+              << step_num << " steps: " << error;
+    ASSERT_LT(error, max_error[t]);
+  }
+}
+
+// updates far below the storage precision must still move the weights,
+// with round to nearest they would all be lost
+TEST(ctr_compress_accessor_test, test_stochastic_rounding) {
+  const size_t row_num = 16;
+  const int step_num = 1000;
+  const float grad = 1e-4;
+  auto fp32_acc = CreateAccessor("", "SparseNaiveSGDRule");
+  Rows push(row_num, fp32_acc->GetAccessorInfo().update_dim);
+  for (size_t i = 0; i < row_num; ++i) {
+    for (size_t j = 0; j < push.data.size() / row_num; ++j) {
+      push.ptrs[i][j] = j < 4 ? 1 : grad;
+    }
+  }
+  std::string str = "1 0 0 1 1 0 0";
+  for (int j = 0; j < kEmbedxDim; ++j) {
+    str += " 1";
+  }
+
+  for (auto weight_type : kWeightTypes) {
+    auto acc = CreateAccessor(weight_type, "SparseNaiveSGDRule");
+    Rows values(row_num, acc->GetAccessorInfo().dim);
+    for (size_t i = 0; i < row_num; ++i) {
+      acc->ParseFromString(str, values.ptrs[i]);
+    }
+    for (int step = 0; step < step_num; ++step) {
+      acc->Update(values.ptrs.data(), push.const_ptrs.data(), row_num);
+    }
+    auto pull = SelectAll(acc.get(), &values);
+    double sum = 0;
+    for (size_t i = 0; i < row_num; ++i) {
+      for (int j = 0; j < kEmbedxDim; ++j) {
+        sum += CtrCommonAccessor::CtrCommonPullValue::EmbedxW(pull.ptrs[i])[j];
+      }
+    }
+    double mean = sum / (row_num * kEmbedxDim);
+    LOG(INFO) << weight_type << " mean weight " << mean << ", expect "
+              << 1 - grad * step_num;
+    ASSERT_NEAR(mean, 1 - grad * step_num, 0.01);
+  }
+}
+
+TEST(ctr_compress_accessor_test, test_string_related) {
+  const size_t row_num = 100;
+  for (auto weight_type : kWeightTypes) {
+    auto acc = CreateAccessor(weight_type);
+    size_t dim = acc->GetAccessorInfo().dim;
+    Rows values(row_num, dim);
+    acc->Create(values.ptrs.data(), row_num);
+    Rows push(row_num, acc->GetAccessorInfo().update_dim);
+    std::default_random_engine engine(0);
+    RandomPush(&engine, 0.0, &push);
+    acc->Update(values.ptrs.data(), push.const_ptrs.data(), row_num);
+
+    Rows loaded(row_num, dim);
+    for (size_t i = 0; i < row_num; ++i) {
+      auto str = acc->ParseToString(values.ptrs[i], dim);
+      ASSERT_EQ(acc->ParseFromString(str, loaded.ptrs[i]),
+                static_cast<int>(dim));
+    }
+    auto expect = SelectAll(acc.get(), &values);
+    auto actual = SelectAll(acc.get(), &loaded);
+    for (size_t i = 0; i < expect.data.size(); ++i) {
+      ASSERT_NEAR(actual.data[i],
+                  expect.data[i],
+                  1e-5 * std::fabs(expect.data[i]) + 1e-7);
+    }
+
+    // a value without embedx keeps the short row
+    std::string str = "0 1 2 3 4 5 6";
+    ASSERT_EQ(acc->ParseFromString(str, loaded.ptrs[0]), 7);
+  }
+}
+
+TEST(ctr_compress_accessor_test, test_benchmark) {
+  const size_t row_num = 100000;
+  const int round = 5;
+  std::default_random_engine engine(0);
+  auto fp32_acc = CreateAccessor("");
+  Rows push(row_num, fp32_acc->GetAccessorInfo().update_dim);
+  RandomPush(&engine, 0.0, &push);
+
+  std::vector<std::string> weight_types = {""};
+  weight_types.insert(
+      weight_types.end(), std::begin(kWeightTypes), std::end(kWeightTypes));
+  for (auto& weight_type : weight_types) {
+    auto acc = CreateAccessor(weight_type);
+    Rows values(row_num, acc->GetAccessorInfo().dim);
+    acc->Create(values.ptrs.data(), row_num);
+    Rows pull(row_num, acc->GetAccessorInfo().select_dim);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < round; ++i) {
+      acc->Update(values.ptrs.data(), push.const_ptrs.data(), row_num);
+    }
+    auto mid = std::chrono::steady_clock::now();
+    for (int i = 0; i < round; ++i) {
+      acc->Select(pull.ptrs.data(), values.const_ptrs.data(), row_num);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double update_s = std::chrono::duration<double>(mid - start).count();
+    double select_s = std::chrono::duration<double>(end - mid).count();
+    LOG(INFO) << (weight_type.empty() ? "fp32" : weight_type) << ": "
+              << acc->GetAccessorInfo().size << " bytes per value, update "
+              << row_num * round / update_s / 1e6 << " M rows/s, select "
+              << row_num * round / select_s / 1e6 << " M rows/s";
+  }
+}
+
+}  // namespace paddle::distributed
@@ -17,8 +17,10 @@ limitations under the License. */
 #include <ThreadPool.h>
 #include <unistd.h>
 
+#include <random>
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
@@ -152,5 +154,112 @@ TEST(MemorySparseTable, SGD) {
   }
 }
 
+// a CtrCommonAccessor table whose new rows are all zero, so that tables fed
+// the same pushes hold the same values
+static MemorySparseTable *CreateZeroInitTable(int emb_dim) {
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(4);
+  FsClientParameter fs_config;
+  MemorySparseTable *table = new MemorySparseTable();
+  table->SetShard(0, 1);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(emb_dim + 3);
+  accessor_config->set_embedx_dim(emb_dim);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseAdaGradSGDRule");
+    auto *adagrad_param = sgd_param->mutable_adagrad();
+    adagrad_param->set_learning_rate(0.1);
+    adagrad_param->set_initial_g2sum(3.0);
+    adagrad_param->set_initial_range(0.0);
+    adagrad_param->add_weight_bounds(-10.0);
+    adagrad_param->add_weight_bounds(10.0);
+  }
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  return table;
+}
+
+// One PushSparse of many keys updates the rows of a shard in batches, it
+// has to give the rows one PushSparse per key gives: keys pushed twice in a
+// batch, rows extended to their mf part inside a batch, more rows than a
+// batch.
+TEST(MemorySparseTable, BatchedPushMatchesPerKeyPush) {
+  const int emb_dim = 8;
+  const int push_dim = emb_dim + 4;
+  const int pull_dim = emb_dim + 3;
+  std::mt19937_64 rng(2024);
+  std::vector<uint64_t> keys;
+  for (int i = 0; i < 3000; ++i) {
+    // 700 keys, the small ones pushed much more often
+    uint64_t rank = rng() % 700;
+    keys.push_back(((rank * rank) / 700 + 1) * 0x9E3779B97F4A7C15ULL);
+  }
+  std::vector<float> pushes(keys.size() * push_dim);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    float *push = pushes.data() + i * push_dim;
+    // slot, show, click, then the gradients
+    push[0] = 1.0;
+    push[1] = 1.0;
+    push[2] = static_cast<float>(i % 3 == 0);
+    for (int j = 3; j < push_dim; ++j) {
+      push[j] = 0.01 * static_cast<float>(rng() % 200) - 1.0;
+    }
+  }
+  std::vector<const float *> push_ptrs(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    push_ptrs[i] = pushes.data() + i * push_dim;
+  }
+
+  MemorySparseTable *batched = CreateZeroInitTable(emb_dim);
+  MemorySparseTable *batched_ptr = CreateZeroInitTable(emb_dim);
+  MemorySparseTable *per_key = CreateZeroInitTable(emb_dim);
+  // a few rounds, so that the rows get extended between and inside pushes
+  for (int round = 0; round < 3; ++round) {
+    ASSERT_EQ(batched->PushSparse(keys.data(), pushes.data(), keys.size()),
+              0);
+    ASSERT_EQ(
+        batched_ptr->PushSparse(keys.data(), push_ptrs.data(), keys.size()),
+        0);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ASSERT_EQ(per_key->PushSparse(&keys[i], pushes.data() + i * push_dim, 1),
+                0);
+    }
+  }
+  ASSERT_GT(per_key->LocalMFSize(), 0);
+  ASSERT_LT(per_key->LocalMFSize(), per_key->LocalSize());
+  ASSERT_EQ(batched->LocalSize(), per_key->LocalSize());
+  ASSERT_EQ(batched->LocalMFSize(), per_key->LocalMFSize());
+  ASSERT_EQ(batched_ptr->LocalMFSize(), per_key->LocalMFSize());
+
+  std::vector<uint32_t> fres(keys.size(), 1);
+  auto pull = [&](MemorySparseTable *table) {
+    std::vector<float> values(keys.size() * pull_dim);
+    PullSparseValue pull_value(keys, fres, emb_dim);
+    table->PullSparse(values.data(), pull_value);
+    return values;
+  };
+  std::vector<float> expect = pull(per_key);
+  std::vector<float> values = pull(batched);
+  std::vector<float> ptr_values = pull(batched_ptr);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_EQ(values[i], expect[i]) << "key " << keys[i / pull_dim];
+    ASSERT_EQ(ptr_values[i], expect[i]) << "key " << keys[i / pull_dim];
+  }
+  delete batched;
+  delete batched_ptr;
+  delete per_key;
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -14,12 +14,19 @@ limitations under the License. */
 
 #include "paddle/fluid/distributed/ps/table/sparse_sgd_rule.h"
 
+#include <chrono>  // NOLINT
 #include <cmath>
 #include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "paddle/common/flags.h"
 #include "paddle/fluid/distributed/the_one_ps.pb.h"
 
+PD_DECLARE_bool(pserver_sparse_sgd_simd);
+
 namespace paddle {
 namespace distributed {
 
@@ -205,5 +212,106 @@ TEST(downpour_sparse_adam_test, test_init_and_update) {
     ASSERT_FLOAT_EQ(value[i], label[i]) << "i is " << i;
   }
 }
+
+namespace {
+
+SparseCommonSGDRuleParameter SGDRuleParam(const std::string& name) {
+  SparseCommonSGDRuleParameter param;
+  param.set_name(name);
+  auto* naive_param = param.mutable_naive();
+  naive_param->set_learning_rate(0.05);
+  naive_param->add_weight_bounds(-1.0);
+  naive_param->add_weight_bounds(1.0);
+  auto* adagrad_param = param.mutable_adagrad();
+  adagrad_param->set_learning_rate(0.05);
+  adagrad_param->set_initial_g2sum(3.0);
+  adagrad_param->add_weight_bounds(-1.0);
+  adagrad_param->add_weight_bounds(1.0);
+  auto* adam_param = param.mutable_adam();
+  adam_param->set_learning_rate(0.05);
+  adam_param->set_beta1_decay_rate(0.9);
+  adam_param->set_beta2_decay_rate(0.999);
+  adam_param->set_ada_epsilon(1e-08);
+  adam_param->add_weight_bounds(-1.0);
+  adam_param->add_weight_bounds(1.0);
+  return param;
+}
+
+template <class Rule>
+std::unique_ptr<SparseValueSGDRule> CreateRule(const std::string& name,
+                                               size_t dim,
+                                               bool simd) {
+  FLAGS_pserver_sparse_sgd_simd = simd;
+  std::unique_ptr<SparseValueSGDRule> rule(new Rule());
+  rule->LoadConfig(SGDRuleParam(name), dim);
+  FLAGS_pserver_sparse_sgd_simd = true;
+  return rule;
+}
+
+// runs `steps` batched updates over `rows` rows, returns the final values
+// and the update time in ms
+std::vector<float> BatchUpdate(SparseValueSGDRule* rule,
+                               size_t dim,
+                               size_t rows,
+                               int steps,
+                               double* ms) {
+  size_t row_size = dim + rule->Dim();
+  std::vector<float> data(rows * row_size);
+  std::vector<float> grad_data(rows * dim);
+  std::vector<float> scales(rows);
+  std::vector<float*> values(rows);
+  std::vector<const float*> grads(rows);
+  std::mt19937 rng(2024);
+  std::uniform_real_distribution<float> dist(-1.0, 1.0);
+  for (size_t i = 0; i < rows; ++i) {
+    values[i] = data.data() + i * row_size;
+    grads[i] = grad_data.data() + i * dim;
+    rule->InitValue(values[i], values[i] + dim, true);
+    scales[i] = 1.0 + i % 3;
+  }
+  for (auto& g : grad_data) {
+    g = dist(rng);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int step = 0; step < steps; ++step) {
+    rule->UpdateValueBatch(
+        values.data(), 0, dim, grads.data(), 0, scales.data(), rows);
+  }
+  auto end = std::chrono::steady_clock::now();
+  *ms = std::chrono::duration<double, std::milli>(end - start).count();
+  return data;
+}
+
+template <class Rule>
+void CheckSimdRule(const std::string& name) {
+  for (size_t dim : {8, 13, 64}) {
+    auto scalar_rule = CreateRule<Rule>(name, dim, false);
+    auto simd_rule = CreateRule<Rule>(name, dim, true);
+    double scalar_ms = 0;
+    double simd_ms = 0;
+    auto expect = BatchUpdate(scalar_rule.get(), dim, 4096, 20, &scalar_ms);
+    auto actual = BatchUpdate(simd_rule.get(), dim, 4096, 20, &simd_ms);
+    LOG(INFO) << name << " dim " << dim << " scalar: " << scalar_ms
+              << " ms, " << (GetSparseSGDKernels() == nullptr
+                                 ? "scalar"
+                                 : GetSparseSGDKernels()->name)
+              << ": " << simd_ms << " ms";
+    ASSERT_EQ(expect.size(), actual.size());
+    for (size_t i = 0; i < expect.size(); ++i) {
+      ASSERT_NEAR(expect[i], actual[i], 1e-4 + 1e-4 * std::fabs(expect[i]))
+          << name << " dim " << dim << " i " << i;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(sparse_sgd_rule_simd_test, match_scalar) {
+  CheckSimdRule<SparseNaiveSGDRule>("naive");
+  CheckSimdRule<SparseAdaGradSGDRule>("adagrad");
+  CheckSimdRule<StdAdaGradSGDRule>("std_adagrad");
+  CheckSimdRule<SparseAdamSGDRule>("adam");
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -0,0 +1,163 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+PD_DECLARE_int32(pserver_sparse_shard_fanout);
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+const int kEmbDim = 8;
+const int kPullDim = kEmbDim + 3;
+const int kPushDim = kEmbDim + 4;
+
+Table *CreateTable(int fanout) {
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(4);
+  FsClientParameter fs_config;
+  Table *table = new MemorySparseTable();
+  table->SetShard(0, 1);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(kEmbDim + 3);
+  accessor_config->set_embedx_dim(kEmbDim);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  // zero initial range keeps the two tables bit-identical
+  for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto *naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.0);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+
+  FLAGS_pserver_sparse_shard_fanout = fanout;
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  FLAGS_pserver_sparse_shard_fanout = 1;
+  return table;
+}
+
+// Draws feasigns whose rank follows a Zipf(s) law, scrambled over the whole
+// 64-bit space like real CTR feasigns.
+std::vector<uint64_t> ZipfKeys(size_t universe, size_t num, double s) {
+  std::vector<double> cdf(universe);
+  double sum = 0.0;
+  for (size_t i = 0; i < universe; ++i) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+    cdf[i] = sum;
+  }
+  std::mt19937_64 rng(2024);
+  std::uniform_real_distribution<double> dist(0.0, sum);
+  std::vector<uint64_t> keys(num);
+  for (size_t i = 0; i < num; ++i) {
+    size_t rank =
+        std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin();
+    keys[i] = (rank + 1) * 0x9E3779B97F4A7C15ULL;
+  }
+  return keys;
+}
+
+double ReplayMs(Table *table,
+                const std::vector<uint64_t> &keys,
+                size_t batch_size,
+                std::vector<float> *pull_values) {
+  std::vector<float> grads(batch_size * kPushDim, 0.0);
+  for (size_t i = 0; i < batch_size; ++i) {
+    grads[i * kPushDim + 1] = 1.0;  // show
+    grads[i * kPushDim + 2] = static_cast<float>(i % 2);  // click
+    for (int j = 3; j < kPushDim; ++j) {
+      grads[i * kPushDim + j] = 0.01 * (j - 2);
+    }
+  }
+  pull_values->resize(keys.size() * kPullDim);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t begin = 0; begin < keys.size(); begin += batch_size) {
+    size_t num = std::min(batch_size, keys.size() - begin);
+    std::vector<uint64_t> batch(keys.begin() + begin,
+                                keys.begin() + begin + num);
+    std::vector<uint32_t> fres(num, 1);
+    TableContext pull_context;
+    pull_context.value_type = Sparse;
+    pull_context.pull_context.pull_value =
+        PullSparseValue(batch, fres, kEmbDim);
+    pull_context.pull_context.values = pull_values->data() + begin * kPullDim;
+    table->Pull(pull_context);
+
+    TableContext push_context;
+    push_context.value_type = Sparse;
+    push_context.push_context.keys = batch.data();
+    push_context.push_context.values = grads.data();
+    push_context.num = num;
+    table->Push(push_context);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}  // namespace
+
+TEST(MemorySparseTable, ShardFanoutZipf) {
+  const size_t batch_size = 4096;
+  for (double s : {0.8, 1.1}) {
+    auto keys = ZipfKeys(100000, 40 * batch_size, s);
+
+    Table *serial_table = CreateTable(1);
+    Table *fanout_table = CreateTable(4);
+    std::vector<float> serial_values;
+    std::vector<float> fanout_values;
+    double serial_ms = ReplayMs(serial_table, keys, batch_size, &serial_values);
+    double fanout_ms = ReplayMs(fanout_table, keys, batch_size, &fanout_values);
+    LOG(INFO) << "zipf s=" << s << " keys=" << keys.size()
+              << " serial shard: " << serial_ms
+              << " ms, fanout 4 shard: " << fanout_ms << " ms";
+
+    ASSERT_EQ(serial_values.size(), fanout_values.size());
+    for (size_t i = 0; i < serial_values.size(); ++i) {
+      ASSERT_FLOAT_EQ(serial_values[i], fanout_values[i]);
+    }
+    ASSERT_EQ(dynamic_cast<MemorySparseTable *>(serial_table)->LocalSize(),
+              dynamic_cast<MemorySparseTable *>(fanout_table)->LocalSize());
+
+    delete serial_table;
+    delete fanout_table;
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
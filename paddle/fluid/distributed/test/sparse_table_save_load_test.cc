@@ -0,0 +1,374 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/distributed/ps/table/depends/binary_shard.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+#include "paddle/fluid/framework/io/fs.h"
+
+PD_DECLARE_bool(pserver_sparse_table_binary_save);
+PD_DECLARE_bool(pserver_sparse_table_delta_save);
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+const int kEmbDim = 8;
+const int kPullDim = kEmbDim + 3;
+const int kPushDim = kEmbDim + 4;
+
+MemorySparseTable *CreateTable() {
+  TableParameter table_config;
+  table_config.set_table_class("MemorySparseTable");
+  table_config.set_shard_num(8);
+  FsClientParameter fs_config;
+  auto *table = new MemorySparseTable();
+  table->SetShard(0, 1);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(kEmbDim + 3);
+  accessor_config->set_embedx_dim(kEmbDim);
+  accessor_config->set_embedx_threshold(0);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_delete_threshold(0.8);
+  accessor_config->mutable_ctr_accessor_param()->set_delete_after_unseen_days(
+      30);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseAdaGradSGDRule");
+    auto *adagrad_param = sgd_param->mutable_adagrad();
+    adagrad_param->set_learning_rate(0.1);
+    adagrad_param->set_initial_range(0.3);
+    adagrad_param->set_initial_g2sum(0.0);
+    adagrad_param->add_weight_bounds(-10.0);
+    adagrad_param->add_weight_bounds(10.0);
+  }
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+  return table;
+}
+
+std::vector<float> PullAll(Table *table, std::vector<uint64_t> *keys) {
+  std::vector<uint32_t> fres(keys->size(), 1);
+  std::vector<float> values(keys->size() * kPullDim);
+  TableContext context;
+  context.value_type = Sparse;
+  context.pull_context.pull_value = PullSparseValue(*keys, fres, kEmbDim);
+  context.pull_context.values = values.data();
+  table->Pull(context);
+  return values;
+}
+
+void PushKeys(Table *table,
+              const std::vector<uint64_t> &keys,
+              float show,
+              float click) {
+  std::vector<float> grads(keys.size() * kPushDim, 0.0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grads[i * kPushDim + 1] = show;
+    grads[i * kPushDim + 2] = click;
+    for (int j = 3; j < kPushDim; ++j) {
+      grads[i * kPushDim + j] = 0.01 * j;
+    }
+  }
+  TableContext context;
+  context.value_type = Sparse;
+  context.push_context.keys = keys.data();
+  context.push_context.values = grads.data();
+  context.num = keys.size();
+  table->Push(context);
+}
+
+double SaveLoadMs(bool binary,
+                  Table *src,
+                  Table *dst,
+                  const std::string &path,
+                  double *save_ms) {
+  FLAGS_pserver_sparse_table_binary_save = binary;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(src->Save(path, "0"), 0);
+  auto mid = std::chrono::steady_clock::now();
+  EXPECT_EQ(dst->Load(path, "0"), 0);
+  auto end = std::chrono::steady_clock::now();
+  FLAGS_pserver_sparse_table_binary_save = false;
+  *save_ms = std::chrono::duration<double, std::milli>(mid - start).count();
+  return std::chrono::duration<double, std::milli>(end - mid).count();
+}
+
+}  // namespace
+
+TEST(MemorySparseTable, BinaryShardSaveLoad) {
+  const size_t key_num = 200000;
+  std::vector<uint64_t> keys(key_num);
+  for (size_t i = 0; i < key_num; ++i) {
+    keys[i] = (i + 1) * 0x9E3779B97F4A7C15ULL;
+  }
+  std::vector<float> grads(key_num * kPushDim);
+  for (size_t i = 0; i < key_num; ++i) {
+    grads[i * kPushDim + 1] = 2.0;  // show
+    grads[i * kPushDim + 2] = 1.0;  // click
+    for (int j = 3; j < kPushDim; ++j) {
+      grads[i * kPushDim + j] = 0.01 * j;
+    }
+  }
+  MemorySparseTable *table = CreateTable();
+  TableContext push_context;
+  push_context.value_type = Sparse;
+  push_context.push_context.keys = keys.data();
+  push_context.push_context.values = grads.data();
+  push_context.num = key_num;
+  table->Push(push_context);
+  auto expect = PullAll(table, &keys);
+
+  std::string text_path = "./sparse_table_save_load_test/text";
+  std::string binary_path = "./sparse_table_save_load_test/binary";
+  paddle::framework::localfs_remove("./sparse_table_save_load_test");
+
+  MemorySparseTable *text_table = CreateTable();
+  double text_save_ms = 0;
+  double text_load_ms =
+      SaveLoadMs(false, table, text_table, text_path, &text_save_ms);
+  MemorySparseTable *binary_table = CreateTable();
+  double binary_save_ms = 0;
+  double binary_load_ms =
+      SaveLoadMs(true, table, binary_table, binary_path, &binary_save_ms);
+  LOG(INFO) << "rows " << key_num << " text save " << text_save_ms
+            << " ms load " << text_load_ms << " ms, binary save "
+            << binary_save_ms << " ms load " << binary_load_ms << " ms";
+
+  auto files = paddle::framework::localfs_list(binary_path + "/000");
+  ASSERT_EQ(files.size(), 8u);
+  for (auto &file : files) {
+    ASSERT_TRUE(IsBinaryShardFile(file));
+  }
+  ASSERT_EQ(text_table->LocalSize(), table->LocalSize());
+  ASSERT_EQ(binary_table->LocalSize(), table->LocalSize());
+  // the binary format keeps the raw floats
+  auto binary_values = PullAll(binary_table, &keys);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_EQ(binary_values[i], expect[i]);
+  }
+
+  paddle::framework::localfs_remove("./sparse_table_save_load_test");
+  delete table;
+  delete text_table;
+  delete binary_table;
+}
+
+TEST(MemorySparseTable, BinaryShardValidation) {
+  ASSERT_TRUE(IsTableShardFile("/a/000/part-000-00003"));
+  ASSERT_TRUE(IsTableShardFile("part-000-00003.gz"));
+  ASSERT_TRUE(IsTableShardFile("/a/000/part-001-00013.bin"));
+  ASSERT_FALSE(IsTableShardFile("/a/000/part-000-00003.bin.tmp"));
+  ASSERT_FALSE(IsTableShardFile("/a/000/part-000-00003.delta"));
+  ASSERT_FALSE(IsTableShardFile("/a/000/part-000"));
+  ASSERT_TRUE(IsDeltaShardFile("/a/000/part-000-00003.delta"));
+  ASSERT_TRUE(IsDeltaShardFile("part-000-00003.delta.gz"));
+  ASSERT_FALSE(IsDeltaShardFile("/a/000/part-000-00003.delta.tmp"));
+  ASSERT_FALSE(IsDeltaShardFile("/a/000/part-000-00003"));
+
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    keys.push_back(i * 0x9E3779B97F4A7C15ULL);
+  }
+  MemorySparseTable *table = CreateTable();
+  PushKeys(table, keys, 2.0, 1.0);
+  std::string root = "./sparse_table_binary_validation_test";
+  paddle::framework::localfs_remove(root);
+  FLAGS_pserver_sparse_table_binary_save = true;
+  ASSERT_EQ(table->Save(root, "0"), 0);
+  FLAGS_pserver_sparse_table_binary_save = false;
+
+  // the .tmp left by an interrupted save is not counted as a shard
+  std::string shard_path = root + "/000/part-000-00000.bin";
+  std::string tmp_path = shard_path + ".tmp";
+  {
+    FILE *fp = fopen(tmp_path.c_str(), "wb");
+    ASSERT_NE(fp, nullptr);
+    fputs("partial", fp);
+    fclose(fp);
+  }
+  MemorySparseTable *loaded = CreateTable();
+  ASSERT_EQ(loaded->Load(root, "0"), 0);
+  ASSERT_EQ(loaded->LocalSize(), table->LocalSize());
+
+  MappedBinaryShard mapped;
+  ASSERT_EQ(mapped.Open(shard_path), 0);
+  uint32_t stride = mapped.stride();
+  size_t row_num = mapped.size();
+  ASSERT_GT(row_num, 0u);
+  mapped.Close();
+
+  // a header with another stride does not match the file size
+  auto patch = [](const std::string &path, long offset, uint32_t value) {
+    FILE *fp = fopen(path.c_str(), "r+b");
+    ASSERT_NE(fp, nullptr);
+    fseek(fp, offset, SEEK_SET);
+    fwrite(&value, sizeof(value), 1, fp);
+    fclose(fp);
+  };
+  patch(shard_path, offsetof(BinaryShardHeader, stride), stride + 1);
+  ASSERT_NE(mapped.Open(shard_path), 0);
+  MemorySparseTable *bad_header = CreateTable();
+  ASSERT_NE(bad_header->Load(root, "0"), 0);
+
+  // a row longer than the stride
+  patch(shard_path, offsetof(BinaryShardHeader, stride), stride);
+  ASSERT_EQ(mapped.Open(shard_path), 0);
+  mapped.Close();
+  patch(shard_path,
+        sizeof(BinaryShardHeader) + row_num * sizeof(uint64_t),
+        stride + 1);
+  ASSERT_NE(mapped.Open(shard_path), 0);
+
+  paddle::framework::localfs_remove(root);
+  delete table;
+  delete loaded;
+  delete bad_header;
+}
+
+TEST(MemorySparseTable, DeltaCheckpoint) {
+  FLAGS_pserver_sparse_table_delta_save = true;
+  const size_t key_num = 20000;
+  std::vector<uint64_t> hot_keys;
+  std::vector<uint64_t> cold_keys;
+  std::vector<uint64_t> new_keys;
+  for (size_t i = 0; i < key_num; ++i) {
+    uint64_t key = (i + 1) * 0x9E3779B97F4A7C15ULL;
+    (i % 2 == 0 ? hot_keys : cold_keys).push_back(key);
+    new_keys.push_back((i + key_num + 1) * 0x9E3779B97F4A7C15ULL);
+  }
+  MemorySparseTable *table = CreateTable();
+  PushKeys(table, hot_keys, 2.0, 1.0);
+  PushKeys(table, cold_keys, 1.0, 0.0);
+
+  std::string root = "./sparse_table_delta_test";
+  paddle::framework::localfs_remove(root);
+  ASSERT_EQ(table->Save(root + "/base", "0"), 0);
+
+  // touch a tenth of the hot rows, add new rows and shrink the cold ones
+  std::vector<uint64_t> touched(hot_keys.begin(),
+                                hot_keys.begin() + hot_keys.size() / 10);
+  PushKeys(table, touched, 3.0, 2.0);
+  PushKeys(table, new_keys, 2.0, 1.0);
+  ASSERT_EQ(table->Save(root + "/delta_1", "6"), 0);
+  ASSERT_EQ(table->Shrink(""), 0);
+  ASSERT_EQ(table->Save(root + "/delta_2", "6"), 0);
+  ASSERT_EQ(table->Save(root + "/full", "0"), 0);
+  // a leftover of an interrupted save is not replayed as a delta
+  {
+    FILE *fp = fopen((root + "/delta_1/000/part-000-00000.tmp").c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    fputs("1 partial\n", fp);
+    fclose(fp);
+  }
+
+  MemorySparseTable *full_table = CreateTable();
+  ASSERT_EQ(full_table->Load(root + "/full", "0"), 0);
+  MemorySparseTable *delta_table = CreateTable();
+  ASSERT_EQ(delta_table->Load(
+                root + "/base," + root + "/delta_1," + root + "/delta_2", "6"),
+            0);
+  ASSERT_EQ(table->LocalSize(), static_cast<int64_t>(2 * hot_keys.size()));
+  ASSERT_EQ(delta_table->LocalSize(), full_table->LocalSize());
+
+  std::vector<uint64_t> all_keys(hot_keys);
+  all_keys.insert(all_keys.end(), cold_keys.begin(), cold_keys.end());
+  all_keys.insert(all_keys.end(), new_keys.begin(), new_keys.end());
+  auto expect = PullAll(full_table, &all_keys);
+  auto values = PullAll(delta_table, &all_keys);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_EQ(values[i], expect[i]);
+  }
+
+  // a full checkpoint starts a new chain
+  ASSERT_EQ(table->Save(root + "/delta_3", "6,1"), -1);
+
+  paddle::framework::localfs_remove(root);
+  FLAGS_pserver_sparse_table_delta_save = false;
+  delete table;
+  delete full_table;
+  delete delta_table;
+}
+
+TEST(MemorySparseTable, DeltaCheckpointPointerPull) {
+  FLAGS_pserver_sparse_table_delta_save = true;
+  std::vector<uint64_t> keys;
+  for (uint64_t i = 1; i <= 2000; ++i) {
+    keys.push_back(i * 0x9E3779B97F4A7C15ULL);
+  }
+  MemorySparseTable *table = CreateTable();
+  PushKeys(table, keys, 2.0, 1.0);
+  std::string root = "./sparse_table_delta_ptr_test";
+  paddle::framework::localfs_remove(root);
+  ASSERT_EQ(table->Save(root + "/base", "0"), 0);
+
+  auto delta_rows = [&](const std::string &name) {
+    EXPECT_EQ(table->Save(root + "/" + name, "6"), 0);
+    size_t rows = 0;
+    for (auto &file :
+         paddle::framework::localfs_list(root + "/" + name + "/000")) {
+      std::ifstream in(file);
+      std::string line;
+      while (std::getline(in, line)) {
+        rows += !line.empty();
+      }
+    }
+    return rows;
+  };
+
+  // pulling the pointers writes nothing, the rows stay clean
+  std::vector<char *> ptrs(keys.size());
+  TableContext context;
+  context.value_type = Sparse;
+  context.use_ptr = true;
+  context.pull_context.keys = keys.data();
+  context.pull_context.ptr_values = ptrs.data();
+  context.num = keys.size();
+  ASSERT_EQ(table->Pull(context), 0);
+  ASSERT_EQ(delta_rows("delta_1"), 0u);
+
+  // the rows written through their pointers are in the next delta only
+  for (size_t i = 0; i < 7; ++i) {
+    auto *value = reinterpret_cast<FixedFeatureValue *>(ptrs[i]);
+    value->data()[1] += 1.0;
+    value->mark_dirty();
+  }
+  ASSERT_EQ(delta_rows("delta_2"), 7u);
+  ASSERT_EQ(delta_rows("delta_3"), 0u);
+
+  paddle::framework::localfs_remove(root);
+  FLAGS_pserver_sparse_table_delta_save = false;
+  delete table;
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,483 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/fluid/distributed/ps/table/depends/ssd_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/distributed/ps/table/memory_sparse_table.h"
+#include "paddle/fluid/distributed/ps/table/ssd_sparse_table.h"
+#include "paddle/fluid/distributed/ps/table/table.h"
+#include "paddle/fluid/distributed/the_one_ps.pb.h"
+
+PD_DECLARE_string(rocksdb_path);
+PD_DECLARE_int64(pserver_ssd_cache_capacity_per_shard);
+PD_DECLARE_int32(pserver_ssd_writeback_batch_size);
+PD_DECLARE_int32(pserver_ssd_multi_get_batch_size);
+
+namespace paddle {
+namespace distributed {
+
+namespace {
+
+const int kEmbDim = 8;
+const int kPullDim = kEmbDim + 3;
+const int kPushDim = kEmbDim + 4;
+const int kShardNum = 4;
+const size_t kCapacity = 64;
+
+void InitTable(Table *table, const std::string &table_class) {
+  TableParameter table_config;
+  table_config.set_table_class(table_class);
+  table_config.set_shard_num(kShardNum);
+  FsClientParameter fs_config;
+  table->SetShard(0, 1);
+
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CtrCommonAccessor");
+  accessor_config->set_fea_dim(kEmbDim + 3);
+  accessor_config->set_embedx_dim(kEmbDim);
+  accessor_config->set_embedx_threshold(5);
+  accessor_config->mutable_ctr_accessor_param()->set_nonclk_coeff(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_click_coeff(1);
+  accessor_config->mutable_ctr_accessor_param()->set_base_threshold(0.5);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_threshold(0.2);
+  accessor_config->mutable_ctr_accessor_param()->set_delta_keep_days(16);
+  accessor_config->mutable_ctr_accessor_param()->set_show_click_decay_rate(
+      0.99);
+  // zero initial range, so that the ssd table and the in-memory table it is
+  // checked against create the same rows
+  for (auto *sgd_param : {accessor_config->mutable_embed_sgd_param(),
+                          accessor_config->mutable_embedx_sgd_param()}) {
+    sgd_param->set_name("SparseNaiveSGDRule");
+    auto *naive_param = sgd_param->mutable_naive();
+    naive_param->set_learning_rate(0.1);
+    naive_param->set_initial_range(0.0);
+    naive_param->add_weight_bounds(-10.0);
+    naive_param->add_weight_bounds(10.0);
+  }
+  EXPECT_EQ(table->Initialize(table_config, fs_config), 0);
+}
+
+MemorySparseTable *CreateMemoryTable() {
+  auto *table = new MemorySparseTable();
+  InitTable(table, "MemorySparseTable");
+  return table;
+}
+
+// a table whose shards keep kCapacity rows in memory
+SSDSparseTable *CreateSSDTable(const std::string &db_path,
+                               int32_t writeback_batch_size) {
+  FLAGS_rocksdb_path = db_path;
+  FLAGS_pserver_ssd_cache_capacity_per_shard = kCapacity;
+  FLAGS_pserver_ssd_writeback_batch_size = writeback_batch_size;
+  auto *table = new SSDSparseTable();
+  InitTable(table, "SSDSparseTable");
+  FLAGS_pserver_ssd_cache_capacity_per_shard = 0;
+  FLAGS_pserver_ssd_writeback_batch_size = 1024;
+  return table;
+}
+
+// the keys [begin, end) of a shard, in increasing order
+std::vector<uint64_t> ShardKeys(int shard_id, uint64_t begin, uint64_t end) {
+  std::vector<uint64_t> keys;
+  for (uint64_t i = begin; i < end; ++i) {
+    keys.push_back(i * kShardNum + shard_id);
+  }
+  return keys;
+}
+
+std::vector<uint64_t> Range(uint64_t begin, uint64_t end) {
+  std::vector<uint64_t> keys;
+  for (uint64_t key = begin; key < end; ++key) {
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+std::vector<float> Pull(Table *table, std::vector<uint64_t> keys) {
+  std::vector<uint32_t> fres(keys.size(), 1);
+  std::vector<float> values(keys.size() * kPullDim);
+  TableContext context;
+  context.value_type = Sparse;
+  context.pull_context.pull_value = PullSparseValue(keys, fres, kEmbDim);
+  context.pull_context.values = values.data();
+  table->Pull(context);
+  return values;
+}
+
+// a show and a click per key, so that the rows get their mf part after a
+// few pushes
+void Push(Table *table, const std::vector<uint64_t> &keys) {
+  std::vector<float> grads(keys.size() * kPushDim, 0.0);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    float *grad = grads.data() + i * kPushDim;
+    grad[1] = 1.0;
+    grad[2] = 1.0;
+    for (int j = 3; j < kPushDim; ++j) {
+      grad[j] = 0.01 * (j - 2) - 0.001 * static_cast<float>(keys[i] % 7);
+    }
+  }
+  TableContext context;
+  context.value_type = Sparse;
+  context.push_context.keys = keys.data();
+  context.push_context.values = grads.data();
+  context.num = keys.size();
+  table->Push(context);
+}
+
+void ExpectSamePulls(Table *table,
+                     Table *expect_table,
+                     const std::vector<uint64_t> &keys) {
+  std::vector<float> values = Pull(table, keys);
+  std::vector<float> expect = Pull(expect_table, keys);
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(values[i], expect[i]) << "key " << keys[i / kPullDim];
+  }
+}
+
+uint64_t SumStat(SSDSparseTable *table,
+                 std::atomic<uint64_t> SSDCacheStat::*counter) {
+  uint64_t sum = 0;
+  for (int shard_id = 0; shard_id < kShardNum; ++shard_id) {
+    sum += (table->ShardCache(shard_id)->stat().*counter).load();
+  }
+  return sum;
+}
+
+}  // namespace
+
+TEST(SSDShardCache, TinyLFUAdmission) {
+  SSDShardCache cache(128);
+  for (int round = 0; round < 8; ++round) {
+    for (uint64_t key = 0; key < 16; ++key) {
+      cache.Access(key);
+    }
+  }
+  cache.Access(1000);
+  ASSERT_GT(cache.Frequency(3), cache.Frequency(1000));
+
+  // not full yet, everything is admitted
+  ASSERT_TRUE(cache.Admit(1000, 10));
+  cache.set_victim_frequency(cache.Frequency(1000));
+  ASSERT_FALSE(cache.Admit(1000, 128));
+  ASSERT_TRUE(cache.Admit(3, 128));
+  ASSERT_EQ(cache.stat().admitted.load(), 2u);
+  ASSERT_EQ(cache.stat().rejected.load(), 1u);
+}
+
+TEST(SSDShardCache, PinsOfTheLastTwoPasses) {
+  SSDShardCache cache(128);
+  cache.Pin(1, 10);
+  cache.Pin(2, 10);
+  ASSERT_TRUE(cache.Pinned(1));
+  ASSERT_FALSE(cache.Pinned(3));
+
+  // pass 11 is built while pass 10 is still trained
+  cache.Pin(3, 11);
+  ASSERT_TRUE(cache.Pinned(1));
+  ASSERT_TRUE(cache.Pinned(3));
+  ASSERT_EQ(cache.pinned_size(), 3u);
+
+  // pass 12 releases the rows of pass 10
+  cache.Pin(4, 12);
+  ASSERT_FALSE(cache.Pinned(1));
+  ASSERT_FALSE(cache.Pinned(2));
+  ASSERT_TRUE(cache.Pinned(3));
+  ASSERT_TRUE(cache.Pinned(4));
+  ASSERT_EQ(cache.pinned_size(), 2u);
+}
+
+TEST(SSDWriteBackBatcher, PendingAndPersisted) {
+  RocksDBHandler db;
+  db.initialize("./ssd_cache_test_db", 2);
+  SSDWriteBackBatcher batcher(&db, 2, 4);
+
+  std::vector<float> row = {1.0, 2.0, 3.0};
+  for (uint64_t key = 0; key < 10; ++key) {
+    row[0] = static_cast<float>(key);
+    batcher.Put(key % 2, key, row.data(), row.size());
+  }
+  batcher.Delete(1, 3);
+
+  // shard 1 submitted keys 1, 3, 5 and 7, key 9 and the delete of key 3 are
+  // still in the open batch: the delete hides the older put of key 3
+  std::string value;
+  ASSERT_EQ(batcher.Get(1, 3, &value), -1);
+  ASSERT_EQ(batcher.Get(1, 9, &value), 0);
+  ASSERT_EQ(value.size(), row.size() * sizeof(float));
+  ASSERT_FLOAT_EQ(reinterpret_cast<const float *>(value.data())[0], 9.0);
+  batcher.Flush();
+  ASSERT_EQ(batcher.Get(0, 4, &value), 1);
+  ASSERT_EQ(batcher.written_rows(), 11u);
+
+  uint64_t key = 4;
+  ASSERT_EQ(db.get(0, reinterpret_cast<char *>(&key), sizeof(key), value), 0);
+  ASSERT_EQ(value.size(), row.size() * sizeof(float));
+  ASSERT_FLOAT_EQ(reinterpret_cast<const float *>(value.data())[0], 4.0);
+  key = 3;
+  ASSERT_EQ(db.get(1, reinterpret_cast<char *>(&key), sizeof(key), value), 1);
+}
+
+// Rows evicted to rocksdb, and pushed to while they are there, pull the
+// values of a table that keeps every row in memory.
+TEST(SSDSparseTable, EvictToRocksdb) {
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_evict", 16);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  // a hot set pushed every round and a window sliding over 1900 more keys,
+  // which comes back to the keys it left rounds ago
+  for (int round = 0; round < 20; ++round) {
+    std::vector<uint64_t> keys = Range(0, 100);
+    for (uint64_t i = 0; i < 300; ++i) {
+      keys.push_back(100 + (round * 150 + i) % 1900);
+    }
+    Push(table, keys);
+    Push(expect_table, keys);
+    ASSERT_LE(table->LocalSize(), static_cast<int64_t>(kShardNum * kCapacity));
+  }
+  ASSERT_GT(SumStat(table, &SSDCacheStat::evicted), 0u);
+
+  table->FlushWriteBack();
+  for (uint64_t begin = 0; begin < 2000; begin += 200) {
+    ExpectSamePulls(table, expect_table, Range(begin, begin + 200));
+  }
+  ASSERT_GT(SumStat(table, &SSDCacheStat::ssd_hit), 0u);
+  ASSERT_LE(table->LocalSize(), static_cast<int64_t>(kShardNum * kCapacity));
+  delete table;
+  delete expect_table;
+}
+
+// The rows of a batch not written back yet are pulled from the batcher.
+TEST(SSDSparseTable, PullPendingWriteBack) {
+  // no batch gets full, the evicted rows stay pending until the flush
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_pending", 1 << 20);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  for (int round = 0; round < 2; ++round) {
+    for (uint64_t begin = 0; begin < 1000; begin += 250) {
+      Push(table, Range(begin, begin + 250));
+      Push(expect_table, Range(begin, begin + 250));
+    }
+  }
+  uint64_t pending_hit = SumStat(table, &SSDCacheStat::pending_hit);
+  for (uint64_t begin = 0; begin < 1000; begin += 100) {
+    ExpectSamePulls(table, expect_table, Range(begin, begin + 100));
+  }
+  ASSERT_GT(SumStat(table, &SSDCacheStat::pending_hit), pending_hit);
+  ASSERT_EQ(SumStat(table, &SSDCacheStat::ssd_hit), 0u);
+
+  // and from rocksdb once they are written
+  table->FlushWriteBack();
+  for (uint64_t begin = 0; begin < 1000; begin += 100) {
+    ExpectSamePulls(table, expect_table, Range(begin, begin + 100));
+  }
+  ASSERT_GT(SumStat(table, &SSDCacheStat::ssd_hit), 0u);
+  delete table;
+  delete expect_table;
+}
+
+// A full shard whose last eviction round gave up rows of the highest
+// frequency admits no cold row: those are pulled straight from rocksdb and
+// stay there until a push brings them back.
+TEST(SSDSparseTable, RejectedAdmission) {
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_admission", 16);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  std::vector<uint64_t> keys = ShardKeys(0, 0, 300);
+  for (int round = 0; round < 3; ++round) {
+    Push(table, keys);
+    Push(expect_table, keys);
+  }
+  table->FlushWriteBack();
+
+  // the cold rows fill the shard up to its capacity, the rest is rejected
+  SSDShardCache *cache = table->ShardCache(0);
+  cache->set_victim_frequency(FrequencySketch::kMaxCount);
+  uint64_t rejected = cache->stat().rejected.load();
+  ExpectSamePulls(table, expect_table, keys);
+  ASSERT_EQ(cache->stat().rejected.load(),
+            rejected + keys.size() - kCapacity);
+
+  cache->set_victim_frequency(FrequencySketch::kMaxCount);
+  ExpectSamePulls(table, expect_table, keys);
+  Push(table, keys);
+  Push(expect_table, keys);
+  table->FlushWriteBack();
+  ExpectSamePulls(table, expect_table, keys);
+  delete table;
+  delete expect_table;
+}
+
+// Rows handed out by PullSparsePtr are not evicted while their pass pins
+// them, the pointers keep seeing the pushes.
+TEST(SSDSparseTable, PinnedPullSparsePtrRows) {
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_pinned", 16);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  std::vector<uint64_t> pinned_keys = ShardKeys(0, 0, 40);
+  std::vector<char *> rows(pinned_keys.size());
+  std::vector<char *> expect_rows(pinned_keys.size());
+  table->PullSparsePtr(
+      0, rows.data(), pinned_keys.data(), pinned_keys.size(), 1);
+  expect_table->PullSparsePtr(
+      0, expect_rows.data(), pinned_keys.data(), pinned_keys.size(), 1);
+
+  // many more rows than the shard holds
+  std::vector<uint64_t> other_keys = ShardKeys(0, 100, 400);
+  for (int round = 0; round < 5; ++round) {
+    Push(table, pinned_keys);
+    Push(expect_table, pinned_keys);
+    Push(table, other_keys);
+    Push(expect_table, other_keys);
+  }
+  ASSERT_GT(table->ShardCache(0)->stat().evicted.load(), 0u);
+  for (size_t i = 0; i < pinned_keys.size(); ++i) {
+    auto *row = reinterpret_cast<FixedFeatureValue *>(rows[i]);
+    auto *expect_row = reinterpret_cast<FixedFeatureValue *>(expect_rows[i]);
+    ASSERT_EQ(row->size(), expect_row->size());
+    for (size_t j = 0; j < row->size(); ++j) {
+      ASSERT_EQ(row->data()[j], expect_row->data()[j])
+          << "key " << pinned_keys[i];
+    }
+  }
+  std::vector<char *> pulled_again(pinned_keys.size());
+  table->PullSparsePtr(
+      0, pulled_again.data(), pinned_keys.data(), pinned_keys.size(), 1);
+  for (size_t i = 0; i < pinned_keys.size(); ++i) {
+    ASSERT_EQ(static_cast<void *>(pulled_again[i]),
+              static_cast<void *>(rows[i]));
+  }
+
+  // two newer passes release the pins, then the rows may be evicted
+  std::vector<uint64_t> pass_keys = ShardKeys(0, 500, 510);
+  std::vector<char *> pass_rows(pass_keys.size());
+  for (uint16_t pass_id : {2, 3}) {
+    table->PullSparsePtr(
+        0, pass_rows.data(), pass_keys.data(), pass_keys.size(), pass_id);
+    expect_table->PullSparsePtr(
+        0, pass_rows.data(), pass_keys.data(), pass_keys.size(), pass_id);
+  }
+  ASSERT_FALSE(table->ShardCache(0)->Pinned(pinned_keys[0]));
+  for (int round = 0; round < 2; ++round) {
+    Push(table, other_keys);
+    Push(expect_table, other_keys);
+  }
+  ExpectSamePulls(table, expect_table, pinned_keys);
+  delete table;
+  delete expect_table;
+}
+
+// The cold keys of a pull go to rocksdb in MultiGet batches sorted by the
+// shard db comparator. Keys whose little-endian bytes sort differently from
+// their values, spread over many small batches, pull what a table without
+// the pipeline pulls.
+TEST(SSDSparseTable, MultiGetPipelineKeyOrder) {
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_key_order", 16);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  std::vector<uint64_t> keys = {0xff, 0x100, 0x1ff, 0x10000, 0xffff};
+  for (uint64_t i = 1; i <= 600; ++i) {
+    keys.push_back(i * 0x9E3779B97F4A7C15ULL);
+  }
+  for (int round = 0; round < 2; ++round) {
+    Push(table, keys);
+    Push(expect_table, keys);
+  }
+  table->FlushWriteBack();
+
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(2024));
+  uint64_t ssd_hit = SumStat(table, &SSDCacheStat::ssd_hit);
+  FLAGS_pserver_ssd_multi_get_batch_size = 7;
+  ExpectSamePulls(table, expect_table, keys);
+  FLAGS_pserver_ssd_multi_get_batch_size = 256;
+  ASSERT_GE(SumStat(table, &SSDCacheStat::ssd_hit),
+            ssd_hit + keys.size() - kShardNum * kCapacity);
+  delete table;
+  delete expect_table;
+}
+
+// A pull mixing resident rows, rows waiting in the write back batcher and
+// rows in rocksdb, every key pulled more than once.
+TEST(SSDSparseTable, MultiGetPipelineDuplicateAndPendingKeys) {
+  // the rows evicted after the flush stay pending
+  SSDSparseTable *table =
+      CreateSSDTable("./ssd_cache_test_duplicate", 1 << 20);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  std::vector<uint64_t> persisted_keys = Range(0, 500);
+  Push(table, persisted_keys);
+  Push(expect_table, persisted_keys);
+  table->FlushWriteBack();
+  std::vector<uint64_t> pending_keys = Range(500, 800);
+  Push(table, pending_keys);
+  Push(expect_table, pending_keys);
+
+  std::vector<uint64_t> keys = Range(0, 800);
+  keys.insert(keys.end(), persisted_keys.begin(), persisted_keys.end());
+  keys.insert(keys.end(), pending_keys.begin(), pending_keys.end());
+  keys.insert(keys.end(), persisted_keys.begin(), persisted_keys.begin() + 50);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(2024));
+  uint64_t ssd_hit = SumStat(table, &SSDCacheStat::ssd_hit);
+  uint64_t pending_hit = SumStat(table, &SSDCacheStat::pending_hit);
+  FLAGS_pserver_ssd_multi_get_batch_size = 7;
+  ExpectSamePulls(table, expect_table, keys);
+  FLAGS_pserver_ssd_multi_get_batch_size = 256;
+  ASSERT_GT(SumStat(table, &SSDCacheStat::ssd_hit), ssd_hit);
+  ASSERT_GT(SumStat(table, &SSDCacheStat::pending_hit), pending_hit);
+  delete table;
+  delete expect_table;
+}
+
+// The 1024-key MultiGet batches of PullSparsePtr are in pull order
+// (sorted_input=false). A key pulled again in a later batch gets the row its
+// first occurrence promoted.
+TEST(SSDSparseTable, MultiGetPipelinePullSparsePtr) {
+  SSDSparseTable *table = CreateSSDTable("./ssd_cache_test_pull_ptr", 16);
+  MemorySparseTable *expect_table = CreateMemoryTable();
+  std::vector<uint64_t> shard_keys = ShardKeys(0, 0, 1500);
+  for (int round = 0; round < 2; ++round) {
+    Push(table, shard_keys);
+    Push(expect_table, shard_keys);
+  }
+  table->FlushWriteBack();
+
+  std::vector<uint64_t> keys = shard_keys;
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(2024));
+  keys.insert(keys.end(), keys.begin(), keys.begin() + 300);
+  std::vector<char *> rows(keys.size());
+  std::vector<char *> expect_rows(keys.size());
+  table->PullSparsePtr(0, rows.data(), keys.data(), keys.size(), 1);
+  expect_table->PullSparsePtr(
+      0, expect_rows.data(), keys.data(), keys.size(), 1);
+  std::unordered_map<uint64_t, char *> first_rows;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto *row = reinterpret_cast<FixedFeatureValue *>(rows[i]);
+    auto *expect_row = reinterpret_cast<FixedFeatureValue *>(expect_rows[i]);
+    ASSERT_EQ(row->size(), expect_row->size()) << "key " << keys[i];
+    for (size_t j = 0; j < row->size(); ++j) {
+      ASSERT_EQ(row->data()[j], expect_row->data()[j]) << "key " << keys[i];
+    }
+    auto it = first_rows.emplace(keys[i], rows[i]).first;
+    ASSERT_EQ(static_cast<void *>(it->second), static_cast<void *>(rows[i]));
+  }
+  // the pinned rows are resident now, pulls of them skip the pipeline
+  ExpectSamePulls(table, expect_table, shard_keys);
+  delete table;
+  delete expect_table;
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -24,8 +24,11 @@ limitations under the License. */
 #include <stdio_ext.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+
+#include "paddle/fluid/framework/slot_record_binary_file.h"
 #endif
 #include "io/fs.h"
+#include "paddle/fluid/framework/data_feed_text_parser.h"
 #include "paddle/fluid/platform/monitor.h"
 #include "paddle/fluid/platform/timer.h"
 
@@ -56,8 +59,10 @@ class BufferedLineFileReader {
   typedef std::function<bool(const std::string&)> LineFunc;
 
  private:
-  template <typename T>
-  int read_lines(T* reader, LineFunc func, int skip_lines) {
+  // func(char* line, size_t len) gets every line in place as a NUL
+  // terminated view, only lines crossing two reads are copied
+  template <typename T, typename ViewFunc>
+  int read_lines(T* reader, ViewFunc func, int skip_lines) {
     int lines = 0;
     size_t ret = 0;
     char* ptr = nullptr;
@@ -72,18 +77,27 @@ class BufferedLineFileReader {
       ptr = buff_;
       eol = reinterpret_cast<char*>(memchr(ptr, '\n', ret));
       while (eol != nullptr) {
-        int size = static_cast<int>((eol - ptr) + 1);
-        x.append(ptr, size - 1);
+        size_t size = eol - ptr;
         ++lines;
-        if (lines > skip_lines && spfunc()) {
-          if (!func(x)) {
-            ++error_line_;
+        if (x.empty()) {
+          *eol = '\0';
+          if (lines > skip_lines && spfunc()) {
+            if (!func(ptr, size)) {
+              ++error_line_;
+            }
           }
+        } else {
+          x.append(ptr, size);
+          if (lines > skip_lines && spfunc()) {
+            if (!func(&x[0], x.size())) {
+              ++error_line_;
+            }
+          }
+          x.clear();
         }
 
-        x.clear();
-        ptr += size;
-        ret -= size;
+        ptr += size + 1;
+        ret -= size + 1;
         eol = reinterpret_cast<char*>(memchr(ptr, '\n', ret));
       }
       if (ret > 0) {
@@ -93,7 +107,7 @@ class BufferedLineFileReader {
     if (!is_error() && !x.empty()) {
       ++lines;
       if (lines > skip_lines && spfunc()) {
-        if (!func(x)) {
+        if (!func(&x[0], x.size())) {
           ++error_line_;
         }
       }
@@ -114,7 +128,21 @@ class BufferedLineFileReader {
 
   int read_file(FILE* fp, LineFunc func, int skip_lines) {
     FILEReader reader(fp);
-    return read_lines<FILEReader>(&reader, func, skip_lines);
+    std::string line;
+    return read_lines(
+        &reader,
+        [&func, &line](const char* str, size_t len) {
+          line.assign(str, len);
+          return func(line);
+        },
+        skip_lines);
+  }
+  // zero copy version of read_file, the line passed to
+  // func(char* line, size_t len) is only valid during the call
+  template <typename ViewFunc>
+  int read_file_view(FILE* fp, ViewFunc func, int skip_lines) {
+    FILEReader reader(fp);
+    return read_lines(&reader, func, skip_lines);
   }
   uint64_t file_size() { return total_len_; }
   void set_sample_rate(float r) { sample_rate_ = r; }
@@ -855,6 +883,18 @@ bool MultiSlotDataFeed::CheckFile(const char* filename) {
   return true;
 }
 
+// skips the count and the num feasigns of an unused slot, str[pos] is the
+// space before the count or its first char. Returns the position of the
+// space after the last feasign, or of the end of the line.
+static int SkipSlotFeasigns(const char* str, int pos, int num) {
+  const char* begin = str + pos + 1;
+  const char* end = text_parser::FindNthSpace(begin, num + 1);
+  if (end == nullptr) {
+    end = begin + strlen(begin);
+  }
+  return static_cast<int>(end - str);
+}
+
 bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
     std::vector<MultiSlotType>* instance) {
 #ifdef _LINUX
@@ -866,7 +906,6 @@ bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
     int use_slots_num = use_slots_.size();
     instance->resize(use_slots_num);
     const char* str = reader.get();
-    std::string line = std::string(str);
 
     char* endptr = const_cast<char*>(str);
     int pos = 0;
@@ -881,7 +920,7 @@ bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
         ss << "The Origin Input Data:\n";
         ss << "----------------------\n";
 
-        ss << line << "\n";
+        ss << str << "\n";
 
         ss << "\n----------------------\n";
         ss << "Some Possible Errors:\n";
@@ -899,23 +938,18 @@ bool MultiSlotDataFeed::ParseOneInstanceFromPipe(
         (*instance)[idx].Init(all_slots_type_[i]);
         if ((*instance)[idx].GetType()[0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = text_parser::ParseFloat(endptr, &endptr);
             (*instance)[idx].AddValue(feasign);
           }
         } else if ((*instance)[idx].GetType()[0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = text_parser::ParseUint64(endptr, &endptr);
             (*instance)[idx].AddValue(feasign);
           }
         }
         pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          // pos = line.find_first_of(' ', pos + 1);
-          while (line[pos + 1] != ' ') {
-            pos++;
-          }
-        }
+        pos = SkipSlotFeasigns(str, pos, num);
       }
     }
     return true;
@@ -959,20 +993,18 @@ bool MultiSlotDataFeed::ParseOneInstance(std::vector<MultiSlotType>* instance) {
         (*instance)[idx].Init(all_slots_type_[i]);
         if ((*instance)[idx].GetType()[0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = text_parser::ParseFloat(endptr, &endptr);
             (*instance)[idx].AddValue(feasign);
           }
         } else if ((*instance)[idx].GetType()[0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = text_parser::ParseUint64(endptr, &endptr);
             (*instance)[idx].AddValue(feasign);
           }
         }
         pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          pos = line.find_first_of(' ', pos + 1);
-        }
+        pos = SkipSlotFeasigns(str, pos, num);
       }
     }
   } else {
@@ -1153,8 +1185,6 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
     return false;
   } else {
     const char* str = reader.get();
-    std::string line = std::string(str);
-    // VLOG(3) << line;
     char* endptr = const_cast<char*>(str);
     int pos = 0;
     if (parse_ins_id_) {
@@ -1237,7 +1267,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
       if (idx != -1) {
         if (all_slots_type_[i][0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = text_parser::ParseFloat(endptr, &endptr);
             // if float feasign is equal to zero, ignore it
             // except when slot is dense
             if (fabs(feasign) < 1e-6 && !use_slots_is_dense_[i]) {
@@ -1249,7 +1279,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
           }
         } else if (all_slots_type_[i][0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = text_parser::ParseUint64(endptr, &endptr);
             // if uint64 feasign is equal to zero, ignore it
             // except when slot is dense
             if (feasign == 0 && !use_slots_is_dense_[i]) {
@@ -1262,12 +1292,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
         }
         pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          // pos = line.find_first_of(' ', pos + 1);
-          while (line[pos + 1] != ' ') {
-            pos++;
-          }
-        }
+        pos = SkipSlotFeasigns(str, pos, num);
       }
     }
     instance->float_feasigns_.shrink_to_fit();
@@ -1312,7 +1337,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
       if (idx != -1) {
         if (all_slots_type_[i][0] == 'f') {  // float
           for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
+            float feasign = text_parser::ParseFloat(endptr, &endptr);
             if (fabs(feasign) < 1e-6) {
               continue;
             }
@@ -1322,7 +1347,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
           }
         } else if (all_slots_type_[i][0] == 'u') {  // uint64
           for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
+            uint64_t feasign = text_parser::ParseUint64(endptr, &endptr);
             if (feasign == 0) {
               continue;
             }
@@ -1333,9 +1358,7 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
         }
         pos = endptr - str;
       } else {
-        for (int j = 0; j <= num; ++j) {
-          pos = line.find_first_of(' ', pos + 1);
-        }
+        pos = SkipSlotFeasigns(str, pos, num);
       }
     }
     instance->float_feasigns_.shrink_to_fit();
@@ -2376,9 +2399,10 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByCommand() {
       CHECK(this->fp_ != nullptr);
       __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
 
-      lines = line_reader.read_file(
+      lines = line_reader.read_file_view(
           this->fp_.get(),
-          [this, &record_vec, &offset, &filename](const std::string& line) {
+          [this, &record_vec, &offset, &filename](const char* line,
+                                                  size_t len UNUSED) {
             if (ParseOneInstance(line, &record_vec[offset])) {
               ++offset;
             } else {
@@ -2432,19 +2456,13 @@ static void parser_log_key(const std::string& log_key,
   *rank = static_cast<uint32_t>(strtoul(rank_str.c_str(), nullptr, 16));
 }
 
-bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
+bool SlotRecordInMemoryDataFeed::ParseOneInstance(const char* str,
                                                   SlotRecord* ins) {
   SlotRecord& rec = (*ins);
   // parse line
-  const char* str = line.c_str();
   char* endptr = const_cast<char*>(str);
   int pos = 0;
 
-  thread_local std::vector<std::vector<float>> slot_float_feasigns;
-  thread_local std::vector<std::vector<uint64_t>> slot_uint64_feasigns;
-  slot_float_feasigns.resize(float_use_slot_size_);
-  slot_uint64_feasigns.resize(uint64_use_slot_size_);
-
   if (parse_ins_id_) {
     int num = static_cast<int>(strtol(&str[pos], &endptr, 10));
     CHECK(num == 1);  // NOLINT
@@ -2478,8 +2496,13 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
     pos += static_cast<int>(len + 1);
   }
 
-  int float_total_slot_num = 0;
-  int uint64_total_slot_num = 0;
+  // the feasigns are appended to the record directly, slot_value_idx
+  // increases along all_slots_info_
+  auto& float_feasigns = rec->slot_float_feasigns_;
+  auto& uint64_feasigns = rec->slot_uint64_feasigns_;
+  float_feasigns.slot_offsets.resize(float_use_slot_size_ + 1);
+  uint64_feasigns.slot_offsets.resize(uint64_use_slot_size_ + 1);
+  size_t uint64_begin = uint64_feasigns.slot_values.size();
 
   for (auto& info : all_slots_info_) {
     int num = static_cast<int>(strtol(&str[pos], &endptr, 10));
@@ -2491,42 +2514,231 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
                    str);
     if (info.used_idx != -1) {
       if (info.type[0] == 'f') {  // float
-        auto& slot_fea = slot_float_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        auto& values = float_feasigns.slot_values;
+        float_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(values.size());
+        bool dense = used_slots_info_[info.used_idx].dense;
         for (int j = 0; j < num; ++j) {
-          float feasign = strtof(endptr, &endptr);
-          if (fabs(feasign) < 1e-6 && !used_slots_info_[info.used_idx].dense) {
+          float feasign = text_parser::ParseFloat(endptr, &endptr);
+          if (fabs(feasign) < 1e-6 && !dense) {
             continue;
           }
-          slot_fea.push_back(feasign);
-          ++float_total_slot_num;
+          values.push_back(feasign);
         }
       } else if (info.type[0] == 'u') {  // uint64
-        auto& slot_fea = slot_uint64_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        auto& values = uint64_feasigns.slot_values;
+        uint64_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(values.size());
         for (int j = 0; j < num; ++j) {
-          uint64_t feasign =
-              static_cast<uint64_t>(strtoull(endptr, &endptr, 10));
-          slot_fea.push_back(feasign);
-          ++uint64_total_slot_num;
+          values.push_back(text_parser::ParseUint64(endptr, &endptr));
         }
       }
       pos = static_cast<int>(endptr - str);
     } else {
-      for (int j = 0; j <= num; ++j) {
-        // pos = line.find_first_of(' ', pos + 1);
-        while (line[pos + 1] != ' ') {
-          pos++;
+      pos = SkipSlotFeasigns(str, pos, num);
+    }
+  }
+  float_feasigns.slot_offsets[float_use_slot_size_] =
+      static_cast<uint32_t>(float_feasigns.slot_values.size());
+  uint64_feasigns.slot_offsets[uint64_use_slot_size_] =
+      static_cast<uint32_t>(uint64_feasigns.slot_values.size());
+
+  return (uint64_feasigns.slot_values.size() > uint64_begin);
+}
+
+uint64_t SlotRecordBinaryInMemoryDataFeed::SlotSignature() const {
+  // FNV-1a over the used slot names and types in slot value order
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const std::string& str) {
+    for (char c : str) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+    hash = (hash ^ 0xFF) * 1099511628211ULL;
+  };
+  for (auto& info : all_slots_info_) {
+    if (info.used_idx != -1) {
+      mix(info.slot);
+      mix(info.type);
+    }
+  }
+  return hash;
+}
+
+#ifdef _LINUX
+template <typename T>
+static void CopySlotValues(const T* values,
+                           const uint32_t* offsets,
+                           int slot_num,
+                           SlotValues<T>* slot_values) {
+  uint32_t base =
+      static_cast<uint32_t>(slot_values->slot_values.size()) - offsets[0];
+  slot_values->slot_offsets.resize(slot_num + 1);
+  for (int s = 0; s <= slot_num; ++s) {
+    slot_values->slot_offsets[s] = offsets[s] + base;
+  }
+  slot_values->slot_values.insert(slot_values->slot_values.end(),
+                                  values + offsets[0],
+                                  values + offsets[slot_num]);
+}
+#endif
+
+void SlotRecordBinaryInMemoryDataFeed::FillSlotRecord(
+    const SlotBinaryRecordView& view, SlotRecord rec) {
+#ifdef _LINUX
+  if (parse_ins_id_ || parse_logkey_) {
+    rec->ins_id_.assign(view.ins_id, view.ins_id_len);
+  }
+  rec->search_id = view.search_id;
+  rec->rank = view.rank;
+  rec->cmatch = view.cmatch;
+  CopySlotValues(view.uint64_values,
+                 view.uint64_offsets,
+                 uint64_use_slot_size_,
+                 &rec->slot_uint64_feasigns_);
+  CopySlotValues(view.float_values,
+                 view.float_offsets,
+                 float_use_slot_size_,
+                 &rec->slot_float_feasigns_);
+#endif
+}
+
+void SlotRecordBinaryInMemoryDataFeed::LoadIntoMemory() {
+#ifdef _LINUX
+  VLOG(3) << "SlotRecordBinary LoadIntoMemory() begin, thread_id="
+          << thread_id_;
+  std::string filename;
+  MappedSlotBinaryFile file;
+  MappedSlotBinaryFile::Block block;
+  SlotBinaryRecordView view;
+  const uint64_t signature = SlotSignature();
+  uint64_t total_records = 0;
+
+  while (this->PickOneFile(&filename)) {
+    VLOG(3) << "PickOneFile, filename=" << filename
+            << ", thread_id=" << thread_id_;
+    platform::Timer timeline;
+    timeline.Start();
+    PADDLE_ENFORCE_EQ(
+        file.Open(filename),
+        0,
+        platform::errors::Unavailable(
+            "Failed to map the slot binary file %s, binary files have to be "
+            "on a local file system.",
+            filename));
+    PADDLE_ENFORCE_EQ(
+        file.slot_signature(),
+        signature,
+        platform::errors::InvalidArgument(
+            "The slot binary file %s was converted with other used slots, "
+            "please convert it again with the current data feed config.",
+            filename));
+
+    std::vector<SlotRecord> record_vec;
+    SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+    int offset = 0;
+    for (uint64_t b = 0; b < file.block_num(); ++b) {
+      PADDLE_ENFORCE_EQ(file.GetBlock(b, &block),
+                        0,
+                        platform::errors::InvalidArgument(
+                            "The block %d of slot binary file %s is corrupted.",
+                            b,
+                            filename));
+      for (uint32_t i = 0; i < block.record_num(); ++i) {
+        block.GetRecord(i, &view);
+        FillSlotRecord(view, record_vec[offset]);
+        if (++offset >= OBJPOOL_BLOCK_SIZE) {
+          input_channel_->Write(std::move(record_vec));
+          record_vec.clear();
+          SlotRecordPool().get(&record_vec, OBJPOOL_BLOCK_SIZE);
+          offset = 0;
         }
       }
     }
+    if (offset > 0) {
+      input_channel_->WriteMove(offset, &record_vec[0]);
+      if (offset < OBJPOOL_BLOCK_SIZE) {
+        SlotRecordPool().put(&record_vec[offset],
+                             (OBJPOOL_BLOCK_SIZE - offset));
+      }
+    } else {
+      SlotRecordPool().put(&record_vec);
+    }
+    record_vec.clear();
+    record_vec.shrink_to_fit();
+    total_records += file.record_num();
+    timeline.Pause();
+    VLOG(3) << "LoadIntoMemory() read all records, file=" << filename
+            << ", records=" << file.record_num()
+            << ", cost time=" << timeline.ElapsedSec()
+            << " seconds, thread_id=" << thread_id_;
+    file.Close();
   }
-  rec->slot_float_feasigns_.add_slot_feasigns(slot_float_feasigns,
-                                              float_total_slot_num);
-  rec->slot_uint64_feasigns_.add_slot_feasigns(slot_uint64_feasigns,
-                                               uint64_total_slot_num);
+  VLOG(3) << "SlotRecordBinary LoadIntoMemory() end, thread_id=" << thread_id_
+          << ", total records: " << total_records;
+#endif
+}
 
-  return (uint64_total_slot_num > 0);
+int64_t SlotRecordBinaryInMemoryDataFeed::ConvertTextFile(
+    const std::string& text_file, const std::string& binary_file) {
+#ifdef _LINUX
+  SlotBinaryFileWriter writer;
+  if (writer.Open(binary_file,
+                  uint64_use_slot_size_,
+                  float_use_slot_size_,
+                  SlotSignature()) != 0) {
+    return -1;
+  }
+  int err_no = 0;
+  auto fp = fs_open_read(text_file, &err_no, pipe_command_, true);
+  if (fp == nullptr) {
+    LOG(ERROR) << "ConvertTextFile open " << text_file << " failed";
+    return -1;
+  }
+  __fsetlocking(&*fp, FSETLOCKING_BYCALLER);
+
+  SlotRecord rec = make_slotrecord();
+  SlotBinaryRecordView view;
+  BufferedLineFileReader line_reader;
+  line_reader.read_file_view(
+      fp.get(),
+      [this, rec, &view, &writer, &text_file](const char* line,
+                                              size_t len UNUSED) {
+        rec->clear(false);
+        SlotRecord ins = rec;
+        if (!ParseOneInstance(line, &ins)) {
+          LOG(WARNING) << "read file:[" << text_file << "] item error, line:["
+                       << line << "]";
+          return false;
+        }
+        bool has_log_key = parse_logkey_;
+        view.search_id = has_log_key ? rec->search_id : 0;
+        view.rank = has_log_key ? rec->rank : 0;
+        view.cmatch = has_log_key ? rec->cmatch : 0;
+        view.ins_id = rec->ins_id_.data();
+        view.ins_id_len = static_cast<uint32_t>(rec->ins_id_.size());
+        view.uint64_values = rec->slot_uint64_feasigns_.slot_values.data();
+        view.uint64_offsets = rec->slot_uint64_feasigns_.slot_offsets.data();
+        view.float_values = rec->slot_float_feasigns_.slot_values.data();
+        view.float_offsets = rec->slot_float_feasigns_.slot_offsets.data();
+        writer.Append(view);
+        return true;
+      },
+      0);
+  free_slotrecord(rec);
+  if (line_reader.is_error()) {
+    LOG(ERROR) << "ConvertTextFile " << text_file << " has too many errors";
+    return -1;
+  }
+  int64_t record_num = static_cast<int64_t>(writer.record_num());
+  if (writer.Close() != 0) {
+    return -1;
+  }
+  VLOG(3) << "ConvertTextFile " << text_file << " to " << binary_file
+          << ", records=" << record_num;
+  return record_num;
+#else
+  return -1;
+#endif
 }
 
 void SlotRecordInMemoryDataFeed::AssignFeedVar(const Scope& scope) {
@@ -1918,7 +1918,7 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   void SetInputChannel(void* channel) override {
     input_channel_ = static_cast<ChannelObject<SlotRecord>*>(channel);
   }
-  bool ParseOneInstance(const std::string& line, SlotRecord* rec);
+  bool ParseOneInstance(const char* str, SlotRecord* rec);
   void PutToFeedVec(const SlotRecord* ins_vec, int num) override;
   void AssignFeedVar(const Scope& scope) override;
   std::vector<std::string> GetInputVarNames() override {
@@ -2006,6 +2006,29 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
 #endif
 };
 
+struct SlotBinaryRecordView;
+
+// SlotRecordInMemoryDataFeed reading the columnar files described in
+// slot_record_binary_file.h instead of text. A text file is converted once by
+// ConvertTextFile with the same data feed config, every later pass maps the
+// binary file and copies the records out of it without parsing. The binary
+// files have to be on a local file system.
+class SlotRecordBinaryInMemoryDataFeed : public SlotRecordInMemoryDataFeed {
+ public:
+  SlotRecordBinaryInMemoryDataFeed() = default;
+  virtual ~SlotRecordBinaryInMemoryDataFeed() {}
+  void LoadIntoMemory() override;
+  // parse text_file through pipe_command and write it to binary_file, return
+  // the number of records or -1 on failure
+  int64_t ConvertTextFile(const std::string& text_file,
+                          const std::string& binary_file);
+  // hash of the used slots, a file converted with other slots is refused
+  uint64_t SlotSignature() const;
+
+ protected:
+  void FillSlotRecord(const SlotBinaryRecordView& view, SlotRecord rec);
+};
+
 class PaddleBoxDataFeed : public MultiSlotInMemoryDataFeed {
  public:
   PaddleBoxDataFeed() {}
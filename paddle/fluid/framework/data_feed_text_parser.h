@@ -0,0 +1,213 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define PADDLE_TEXT_PARSER_SSE2
+// the scan reads whole aligned blocks past the NUL
+#define PADDLE_TEXT_PARSER_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define PADDLE_TEXT_PARSER_NO_ASAN
+#endif
+
+namespace paddle {
+namespace framework {
+
+// Number parsing and token scanning for the MultiSlot text format
+// "num v1 v2 ... num v1 ...". The parsers are drop in replacements of
+// strtoull(str, endptr, 10) and strtof(str, endptr) for the plain decimal
+// numbers written by the data generators and give bit identical results,
+// anything unusual (signs on integers, more than 19 digits, inf, nan, hex
+// floats, subnormal or out of range floats) is handed to the libc function.
+//
+// All functions expect a NUL terminated string.
+namespace text_parser {
+
+inline bool IsDigit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+
+// the blanks strtoull and strtof skip
+inline bool IsBlank(char c) {
+  return c == ' ' || static_cast<unsigned>(c - '\t') < 5;
+}
+
+inline uint64_t ParseUint64(const char* str, char** endptr) {
+  const char* p = str;
+  while (IsBlank(*p)) {
+    ++p;
+  }
+  if (!IsDigit(*p)) {
+    return strtoull(str, endptr, 10);
+  }
+  uint64_t value = 0;
+  int digits = 0;
+  for (; IsDigit(*p) && digits < 19; ++p, ++digits) {
+    value = value * 10 + (*p - '0');
+  }
+  if (IsDigit(*p)) {
+    // 20 digits may overflow
+    return strtoull(str, endptr, 10);
+  }
+  *endptr = const_cast<char*>(p);
+  return value;
+}
+
+// The decimal digits are collected into an integer m and a power of ten e,
+// m * 10^e is then computed in double with one correctly rounded operation
+// as long as m < 2^53 and |e| <= 22. Rounding that double to float again is
+// exact unless it lands right on the midpoint of two floats, which is
+// checked.
+inline float ParseFloat(const char* str, char** endptr) {
+  static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* p = str;
+  while (IsBlank(*p)) {
+    ++p;
+  }
+  bool negative = *p == '-';
+  if (negative || *p == '+') {
+    ++p;
+  }
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exp10 = 0;
+  bool has_digit = false;
+  for (; IsDigit(*p); ++p) {
+    has_digit = true;
+    if (mantissa != 0 || *p != '0') {
+      mantissa = mantissa * 10 + (*p - '0');
+      ++digits;
+    }
+    if (digits > 19) {
+      return strtof(str, endptr);
+    }
+  }
+  if (*p == 'x' || *p == 'X') {
+    // hex float
+    return strtof(str, endptr);
+  }
+  if (*p == '.') {
+    for (++p; IsDigit(*p); ++p) {
+      has_digit = true;
+      if (mantissa != 0 || *p != '0') {
+        mantissa = mantissa * 10 + (*p - '0');
+        ++digits;
+      }
+      if (digits > 19) {
+        return strtof(str, endptr);
+      }
+      --exp10;
+    }
+  }
+  if (!has_digit) {
+    return strtof(str, endptr);
+  }
+  if (*p == 'e' || *p == 'E') {
+    const char* q = p + 1;
+    bool exp_negative = *q == '-';
+    if (exp_negative || *q == '+') {
+      ++q;
+    }
+    if (!IsDigit(*q)) {
+      return strtof(str, endptr);
+    }
+    int exp = 0;
+    for (; IsDigit(*q); ++q) {
+      if (exp > 1000) {
+        return strtof(str, endptr);
+      }
+      exp = exp * 10 + (*q - '0');
+    }
+    exp10 += exp_negative ? -exp : exp;
+    p = q;
+  }
+  if (mantissa == 0) {
+    *endptr = const_cast<char*>(p);
+    return negative ? -0.0f : 0.0f;
+  }
+  if (mantissa > (1ULL << 53) || exp10 < -22 || exp10 > 22) {
+    return strtof(str, endptr);
+  }
+  double value = static_cast<double>(mantissa);
+  value = exp10 < 0 ? value / kPow10[-exp10] : value * kPow10[exp10];
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  // a float keeps the top 24 of the 53 bits, the other 29 are rounded away
+  if ((bits & 0x1FFFFFFF) == 0x10000000 || value < FLT_MIN ||
+      value > FLT_MAX) {
+    return strtof(str, endptr);
+  }
+  *endptr = const_cast<char*>(p);
+  float result = static_cast<float>(value);
+  return negative ? -result : result;
+}
+
+// The n-th ' ' at or after p, nullptr if the string ends before. Tokens are
+// separated by single spaces, so this skips n - 1 tokens in one scan.
+PADDLE_TEXT_PARSER_NO_ASAN inline const char* FindNthSpace(const char* p,
+                                                            int n) {
+  if (n <= 0) {
+    return p;
+  }
+#ifdef PADDLE_TEXT_PARSER_SSE2
+  // aligned 16 bytes loads never cross a page, so reading past the NUL
+  // inside the last block is safe
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i zero = _mm_setzero_si128();
+  uintptr_t misalign = reinterpret_cast<uintptr_t>(p) & 15;
+  const char* block = p - misalign;
+  uint32_t valid = 0xFFFFu << misalign;
+  while (true) {
+    __m128i chars = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    uint32_t spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, space)) & valid;
+    uint32_t ends = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, zero)) & valid;
+    if (ends != 0) {
+      // keep the spaces before the first NUL
+      spaces &= (ends & (0u - ends)) - 1;
+    }
+    int count = __builtin_popcount(spaces);
+    if (count >= n) {
+      for (int i = 1; i < n; ++i) {
+        spaces &= spaces - 1;
+      }
+      return block + __builtin_ctz(spaces);
+    }
+    if (ends != 0) {
+      return nullptr;
+    }
+    n -= count;
+    block += 16;
+    valid = 0xFFFF;
+  }
+#else
+  for (; *p != '\0'; ++p) {
+    if (*p == ' ' && --n == 0) {
+      return p;
+    }
+  }
+  return nullptr;
+#endif
+}
+
+}  // namespace text_parser
+}  // namespace framework
+}  // namespace paddle
@@ -14,6 +14,9 @@
 
 #include "paddle/fluid/framework/data_set.h"
 
+#include <functional>
+#include <future>  // NOLINT
+
 #include "google/protobuf/text_format.h"
 #if (defined PADDLE_WITH_DISTRIBUTE) && (defined PADDLE_WITH_PSCORE)
 #include "paddle/fluid/distributed/index_dataset/index_sampler.h"
@@ -42,6 +45,8 @@ COMMON_DECLARE_bool(graph_get_neighbor_id);
 COMMON_DECLARE_int32(gpugraph_storage_mode);
 COMMON_DECLARE_string(graph_edges_split_mode);
 COMMON_DECLARE_bool(query_dest_rank_by_multi_node);
+COMMON_DECLARE_string(dataset_shuffle_spill_dir);
+COMMON_DECLARE_int64(dataset_shuffle_memory_mb);
 
 namespace paddle {
 namespace framework {
@@ -169,6 +174,13 @@ std::vector<std::string> DatasetImpl<T>::GetSlots() {
   return use_slots_;
 }
 
+template <typename T>
+std::vector<std::string> DatasetImpl<T>::ConvertToBinaryFiles(
+    const std::string& output_dir UNUSED) {
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "ConvertToBinaryFiles is only supported by SlotRecordDataset."));
+}
+
 template <typename T>
 void DatasetImpl<T>::SetChannelNum(int channel_num) {
   channel_num_ = channel_num;
@@ -702,6 +714,325 @@ void DatasetImpl<T>::ReleaseMemoryFun() {
   STAT_SUB(STAT_total_feasign_num_in_mem, total_fea_num_);
 }
 
+// serialization of the records spilled by the external shuffle, all fields
+// are kept as the records come back into the same dataset
+static void SpillRecord(const Record& r, BinaryArchive* ar) {
+  *ar << r.uint64_feasigns_;
+  *ar << r.float_feasigns_;
+  *ar << r.ins_id_;
+  *ar << r.content_;
+  *ar << r.search_id;
+  *ar << r.rank;
+  *ar << r.cmatch;
+  *ar << r.uid_;
+}
+
+static void SpillRecord(const SlotRecord& r, BinaryArchive* ar) {
+  *ar << r->search_id;
+  *ar << r->rank;
+  *ar << r->cmatch;
+  *ar << r->ins_id_;
+  *ar << r->slot_uint64_feasigns_.slot_offsets;
+  *ar << r->slot_uint64_feasigns_.slot_values;
+  *ar << r->slot_float_feasigns_.slot_offsets;
+  *ar << r->slot_float_feasigns_.slot_values;
+}
+
+static void ReleaseSpilledRecords(std::vector<Record>* data) {
+  data->clear();
+}
+
+static void ReleaseSpilledRecords(std::vector<SlotRecord>* data) {
+  SlotRecordPool().put(data);
+}
+
+static void LoadSpilledRecords(BinaryArchive* ar,
+                               size_t num,
+                               std::vector<Record>* data) {
+  data->resize(num);
+  for (auto& r : *data) {
+    *ar >> r.uint64_feasigns_;
+    *ar >> r.float_feasigns_;
+    *ar >> r.ins_id_;
+    *ar >> r.content_;
+    *ar >> r.search_id;
+    *ar >> r.rank;
+    *ar >> r.cmatch;
+    *ar >> r.uid_;
+  }
+}
+
+static void LoadSpilledRecords(BinaryArchive* ar,
+                               size_t num,
+                               std::vector<SlotRecord>* data) {
+  SlotRecordPool().get(data, static_cast<int>(num));
+  for (auto& r : *data) {
+    *ar >> r->search_id;
+    *ar >> r->rank;
+    *ar >> r->cmatch;
+    *ar >> r->ins_id_;
+    *ar >> r->slot_uint64_feasigns_.slot_offsets;
+    *ar >> r->slot_uint64_feasigns_.slot_values;
+    *ar >> r->slot_float_feasigns_.slot_offsets;
+    *ar >> r->slot_float_feasigns_.slot_values;
+  }
+}
+
+#ifdef _LINUX
+// Bucket files of the external shuffle, closed and removed at the latest when
+// they go out of scope, so an error leaves no spill files behind.
+class ShuffleBucketFiles {
+ public:
+  ShuffleBucketFiles(const std::string& prefix, size_t bucket_num)
+      : paths_(bucket_num), files_(bucket_num, nullptr) {
+    for (size_t b = 0; b < bucket_num; ++b) {
+      paths_[b] = prefix + std::to_string(b);
+    }
+  }
+  ~ShuffleBucketFiles() {
+    for (size_t b = 0; b < files_.size(); ++b) {
+      Remove(b);
+    }
+  }
+
+  void Create() {
+    for (size_t b = 0; b < files_.size(); ++b) {
+      files_[b] = fopen(paths_[b].c_str(), "wb+");
+      PADDLE_ENFORCE_NOT_NULL(
+          files_[b],
+          platform::errors::Unavailable("Failed to create the shuffle file %s.",
+                                        paths_[b]));
+    }
+  }
+  // a bucket is only removed by the thread that loads it
+  void Remove(size_t b) {
+    if (files_[b] != nullptr) {
+      fclose(files_[b]);
+      files_[b] = nullptr;
+      unlink(paths_[b].c_str());
+    }
+  }
+
+  FILE* file(size_t b) const { return files_[b]; }
+  const std::string& path(size_t b) const { return paths_[b]; }
+
+ private:
+  std::vector<std::string> paths_;
+  std::vector<FILE*> files_;
+};
+#endif
+
+// The records in input_channel_ are spilled by parallel readers to bucket
+// files chosen at random, then the buckets are loaded back in random order,
+// each one shuffled on its own. Only the spill buffers and the buckets being
+// loaded are held besides the records themselves, instead of a second copy
+// of the whole dataset. A bucket file is a list of chunks
+//   | record num (8B) | bytes (8B) | serialized records |
+// Half of memory_bound is for the thread_num * bucket_num spill buffers, the
+// other half for the one bucket each thread loads; a dataset too large for
+// that is refused before anything is spilled. If the spill or the load fails
+// the records are lost. The shuffle is local to this trainer, GlobalShuffle
+// still exchanges and holds the records in memory.
+template <typename T>
+void DatasetImpl<T>::ExternalShuffle(const std::string& spill_dir,
+                                     size_t memory_bound) {
+#ifdef _LINUX
+  const size_t kMinBufferBytes = 4096;
+  const size_t kMaxBufferBytes = 1 << 20;
+  const size_t kMaxBucketNum = 4096;
+  auto fleet_ptr = framework::FleetWrapper::GetInstance();
+  const size_t thread_num = std::max(thread_num_, 1);
+  memory_bound = std::max(memory_bound, static_cast<size_t>(1 << 20));
+  input_channel_->Close();
+  const size_t record_num = input_channel_->Size();
+
+  // size the buckets from the serialized size of the first block
+  std::vector<T> first_block;
+  input_channel_->Read(first_block);
+  auto restore_first_block = [&]() {
+    input_channel_->Open();
+    input_channel_->Write(std::move(first_block));
+    input_channel_->Close();
+  };
+  BinaryArchive sample;
+  for (auto& r : first_block) {
+    SpillRecord(r, &sample);
+  }
+  double record_bytes =
+      static_cast<double>(sample.Length()) /
+      std::max(first_block.size(), static_cast<size_t>(1));
+  sample.Clear();
+  const size_t bucket_bytes = memory_bound / 2 / thread_num;
+  const size_t max_bucket_num = std::min(
+      memory_bound / 2 / (thread_num * kMinBufferBytes), kMaxBucketNum);
+  const size_t need_bucket_num =
+      static_cast<size_t>(record_bytes * record_num / bucket_bytes) + 1;
+  if (need_bucket_num > max_bucket_num) {
+    restore_first_block();
+    PADDLE_THROW(platform::errors::ResourceExhausted(
+        "The external shuffle of %d records (%d MB serialized) with %d "
+        "threads needs %d buckets, but a memory bound of %d MB holds the "
+        "buffers of at most %d buckets. Please raise "
+        "FLAGS_dataset_shuffle_memory_mb or use fewer threads.",
+        record_num,
+        static_cast<size_t>(record_bytes * record_num) >> 20,
+        thread_num,
+        need_bucket_num,
+        memory_bound >> 20,
+        max_bucket_num));
+  }
+  // a bucket per thread at least, as long as the buffers stay within bound
+  const size_t bucket_num =
+      std::min(std::max(need_bucket_num, thread_num), max_bucket_num);
+  const size_t buffer_bytes = std::min(
+      memory_bound / 2 / (thread_num * bucket_num), kMaxBufferBytes);
+
+  std::string prefix = spill_dir + "/shuffle_" + std::to_string(getpid()) +
+                       "_" +
+                       std::to_string(reinterpret_cast<uintptr_t>(this)) + "_";
+  ShuffleBucketFiles files(prefix, bucket_num);
+  std::vector<std::mutex> bucket_mutex(bucket_num);
+  try {
+    localfs_mkdir(spill_dir);
+    files.Create();
+  } catch (...) {
+    restore_first_block();
+    throw;
+  }
+
+  // run func on every thread, the first error is rethrown once all of them
+  // are done since they share the locals here
+  auto run_threads = [thread_num](const std::function<void(size_t)>& func) {
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < thread_num; ++i) {
+      futures.emplace_back(std::async(std::launch::async, func, i));
+    }
+    for (auto& f : futures) {
+      f.wait();
+    }
+    for (auto& f : futures) {
+      f.get();
+    }
+  };
+
+  // spill
+  platform::Timer spill_timer;
+  spill_timer.Start();
+  std::atomic<uint64_t> spill_bytes(0);
+  auto write_chunk = [&](size_t b, BinaryArchive* ar, uint64_t num) {
+    uint64_t bytes = ar->Length();
+    std::lock_guard<std::mutex> lock(bucket_mutex[b]);
+    FILE* fp = files.file(b);
+    bool ok = fwrite(&num, sizeof(num), 1, fp) == 1 &&
+              fwrite(&bytes, sizeof(bytes), 1, fp) == 1 &&
+              fwrite(ar->Buffer(), 1, bytes, fp) == bytes;
+    PADDLE_ENFORCE_EQ(
+        ok,
+        true,
+        platform::errors::Unavailable("Failed to write the shuffle file %s.",
+                                      files.path(b)));
+    spill_bytes += bytes + 2 * sizeof(uint64_t);
+  };
+  run_threads([&](size_t i) {
+    std::vector<BinaryArchive> ars(bucket_num);
+    std::vector<uint64_t> counts(bucket_num, 0);
+    std::vector<T> data;
+    if (i == 0) {
+      data.swap(first_block);
+    }
+    do {
+      for (auto& r : data) {
+        size_t b = fleet_ptr->LocalRandomEngine()() % bucket_num;
+        SpillRecord(r, &ars[b]);
+        ++counts[b];
+        if (ars[b].Length() >= buffer_bytes) {
+          write_chunk(b, &ars[b], counts[b]);
+          ars[b].Clear();
+          counts[b] = 0;
+        }
+      }
+      ReleaseSpilledRecords(&data);
+    } while (input_channel_->Read(data));
+    for (size_t b = 0; b < bucket_num; ++b) {
+      if (counts[b] > 0) {
+        write_chunk(b, &ars[b], counts[b]);
+      }
+    }
+  });
+  spill_timer.Pause();
+
+  // load the buckets back in random order, each shuffled in memory
+  platform::Timer load_timer;
+  load_timer.Start();
+  std::vector<size_t> order(bucket_num);
+  for (size_t b = 0; b < bucket_num; ++b) {
+    order[b] = b;
+  }
+  std::shuffle(order.begin(), order.end(), fleet_ptr->LocalRandomEngine());
+  std::atomic<size_t> next_bucket(0);
+  std::atomic<uint64_t> loaded_records(0);
+  input_channel_->Open();
+  run_threads([&](size_t) {
+    std::vector<T> data;
+    std::vector<T> chunk;
+    size_t idx = 0;
+    while ((idx = next_bucket++) < bucket_num) {
+      size_t b = order[idx];
+      FILE* fp = files.file(b);
+      long length = ftell(fp);  // NOLINT
+      BinaryArchive ar;
+      ar.Resize(length);
+      bool ok = fseek(fp, 0, SEEK_SET) == 0 &&
+                fread(ar.Buffer(), 1, length, fp) ==
+                    static_cast<size_t>(length);
+      PADDLE_ENFORCE_EQ(
+          ok,
+          true,
+          platform::errors::Unavailable("Failed to read the shuffle file %s.",
+                                        files.path(b)));
+      files.Remove(b);
+      while (ar.Cursor() < ar.Finish()) {
+        uint64_t num = ar.Get<uint64_t>();
+        ar.Get<uint64_t>();  // bytes
+        LoadSpilledRecords(&ar, num, &chunk);
+        data.insert(data.end(),
+                    std::make_move_iterator(chunk.begin()),
+                    std::make_move_iterator(chunk.end()));
+        chunk.clear();
+      }
+      ar.Clear();
+      std::shuffle(data.begin(), data.end(), fleet_ptr->LocalRandomEngine());
+      loaded_records += data.size();
+      input_channel_->Write(std::move(data));
+      data.clear();
+    }
+  });
+  input_channel_->Close();
+  load_timer.Pause();
+
+  PADDLE_ENFORCE_EQ(loaded_records.load(),
+                    record_num,
+                    platform::errors::PreconditionNotMet(
+                        "The external shuffle lost records, %d in and %d out.",
+                        record_num,
+                        loaded_records.load()));
+  double spill_mb = spill_bytes.load() / 1024.0 / 1024.0;
+  VLOG(1) << "DatasetImpl<T>::ExternalShuffle() " << record_num
+          << " records, " << bucket_num << " buckets, " << spill_mb
+          << "MB spilled to " << spill_dir << ", memory bound "
+          << (memory_bound >> 20) << "MB";
+  VLOG(1) << "ExternalShuffle spill phase " << spill_timer.ElapsedSec()
+          << " seconds, " << spill_mb / spill_timer.ElapsedSec() << " MB/s, "
+          << record_num / spill_timer.ElapsedSec() << " records/s";
+  VLOG(1) << "ExternalShuffle load phase " << load_timer.ElapsedSec()
+          << " seconds, " << spill_mb / load_timer.ElapsedSec() << " MB/s, "
+          << record_num / load_timer.ElapsedSec() << " records/s";
+#else
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "The external shuffle of dataset is only supported on Linux."));
+#endif
+}
+
 // do local shuffle
 template <typename T>
 void DatasetImpl<T>::LocalShuffle() {
@@ -713,6 +1044,14 @@ void DatasetImpl<T>::LocalShuffle() {
     VLOG(3) << "DatasetImpl<T>::LocalShuffle() end, no data to shuffle";
     return;
   }
+  if (!FLAGS_dataset_shuffle_spill_dir.empty()) {
+    ExternalShuffle(FLAGS_dataset_shuffle_spill_dir,
+                    FLAGS_dataset_shuffle_memory_mb << 20);
+    timeline.Pause();
+    VLOG(3) << "DatasetImpl<T>::LocalShuffle() end, cost time="
+            << timeline.ElapsedSec() << " seconds";
+    return;
+  }
   auto fleet_ptr = framework::FleetWrapper::GetInstance();
   input_channel_->Close();
   std::vector<T> data;
@@ -860,6 +1199,9 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
     VLOG(3) << "MultiSlotDataset::GlobalShuffle() end, no data to shuffle";
     return;
   }
+  LOG_IF(WARNING, !FLAGS_dataset_shuffle_spill_dir.empty())
+      << "FLAGS_dataset_shuffle_spill_dir only applies to the local shuffle, "
+         "the global shuffle keeps all records in memory";
 
   // local shuffle
   input_channel_->Close();
@@ -2068,5 +2410,76 @@ void SlotRecordDataset::DynamicAdjustReadersNum(int thread_num) {
   PrepareTrain();
 }
 
+std::vector<std::string> SlotRecordDataset::ConvertToBinaryFiles(
+    const std::string& output_dir) {
+  PADDLE_ENFORCE_EQ(
+      data_feed_desc_.name(),
+      "SlotRecordBinaryInMemoryDataFeed",
+      platform::errors::InvalidArgument(
+          "ConvertToBinaryFiles needs the data feed "
+          "SlotRecordBinaryInMemoryDataFeed, but received %s.",
+          data_feed_desc_.name()));
+  PADDLE_ENFORCE_GT(thread_num_,
+                    0,
+                    platform::errors::InvalidArgument(
+                        "The thread num of the dataset should be > 0."));
+  localfs_mkdir(output_dir);
+
+  std::vector<std::string> binary_files(filelist_.size());
+  for (size_t i = 0; i < filelist_.size(); ++i) {
+    std::string name = filelist_[i];
+    size_t pos = name.find_last_of('/');
+    if (pos != std::string::npos) {
+      name = name.substr(pos + 1);
+    }
+    // the index keeps text files of the same name in different dirs apart
+    binary_files[i] =
+        output_dir + "/" + std::to_string(i) + "-" + name + ".bin";
+  }
+
+  const size_t thread_num =
+      std::min(static_cast<size_t>(thread_num_), filelist_.size());
+  std::vector<int64_t> record_nums(filelist_.size(), -1);
+  std::vector<std::thread> convert_threads;
+  for (size_t t = 0; t < thread_num; ++t) {
+    // every thread parses with its own data feed, the parse state of a
+    // data feed is not shared
+    auto feed = DataFeedFactory::CreateDataFeed(data_feed_desc_.name());
+    feed->Init(data_feed_desc_);
+    feed->SetParseInsId(parse_ins_id_);
+    feed->SetParseContent(parse_content_);
+    feed->SetParseLogKey(parse_logkey_);
+    feed->SetEnablePvMerge(enable_pv_merge_);
+    convert_threads.emplace_back([this,
+                                  t,
+                                  thread_num,
+                                  feed,
+                                  &binary_files,
+                                  &record_nums]() {
+      auto* binary_feed =
+          dynamic_cast<SlotRecordBinaryInMemoryDataFeed*>(feed.get());
+      for (size_t i = t; i < filelist_.size(); i += thread_num) {
+        record_nums[i] =
+            binary_feed->ConvertTextFile(filelist_[i], binary_files[i]);
+      }
+    });
+  }
+  for (auto& th : convert_threads) {
+    th.join();
+  }
+  for (size_t i = 0; i < filelist_.size(); ++i) {
+    PADDLE_ENFORCE_GE(
+        record_nums[i],
+        0,
+        platform::errors::Unavailable(
+            "Failed to convert %s to the slot binary file %s.",
+            filelist_[i],
+            binary_files[i]));
+    VLOG(3) << "converted " << filelist_[i] << " to " << binary_files[i]
+            << ", records=" << record_nums[i];
+  }
+  return binary_files;
+}
+
 }  // end namespace framework
 }  // end namespace paddle
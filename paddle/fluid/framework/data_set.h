@@ -166,6 +166,10 @@ class Dataset {
   virtual void SetFleetSendSleepSeconds(int seconds) = 0;
 
   virtual std::vector<std::string> GetSlots() = 0;
+  // convert the text files of the file list to slot binary files in
+  // output_dir, return the binary files in file list order
+  virtual std::vector<std::string> ConvertToBinaryFiles(
+      const std::string& output_dir) = 0;
 
   virtual void SetGpuGraphMode(int is_graph_mode) = 0;
   virtual int GetGpuGraphMode() = 0;
@@ -276,6 +280,8 @@ class DatasetImpl : public Dataset {
   virtual void DynamicAdjustReadersNum(int thread_num);
   virtual void SetFleetSendSleepSeconds(int seconds);
   virtual std::vector<std::string> GetSlots();
+  virtual std::vector<std::string> ConvertToBinaryFiles(
+      const std::string& output_dir);
   virtual bool GetEpochFinish();
   virtual void ClearSampleState();
   virtual void DumpWalkPath(std::string dump_path, size_t dump_rate);
@@ -316,6 +322,9 @@ class DatasetImpl : public Dataset {
     // TODO(yaoxuefeng) for SlotRecordDataset
     return -1;
   }
+  // LocalShuffle through bucket files in spill_dir, at most memory_bound
+  // bytes of serialized records are buffered or loaded at a time
+  void ExternalShuffle(const std::string& spill_dir, size_t memory_bound);
   std::vector<std::shared_ptr<paddle::framework::DataFeed>> readers_;
   std::vector<std::shared_ptr<paddle::framework::DataFeed>> preload_readers_;
   paddle::framework::Channel<T> input_channel_;
@@ -439,6 +448,8 @@ class SlotRecordDataset : public DatasetImpl<SlotRecord> {
                                        bool discard_remaining_ins);
   virtual void PrepareTrain();
   virtual void DynamicAdjustReadersNum(int thread_num);
+  virtual std::vector<std::string> ConvertToBinaryFiles(
+      const std::string& output_dir);
   void DynamicAdjustBatchNum();
 
  protected:
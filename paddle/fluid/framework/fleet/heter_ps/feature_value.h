@@ -422,6 +422,8 @@ class CommonFeatureValueAccessor {
       downpour_value->resize(cpu_accessor->common_feature_value.Dim(mf_dim));
     }
     float* cpu_val = downpour_value->data();
+    // for the delta checkpoints of the cpu table
+    downpour_value->mark_dirty();
     cpu_val[cpu_accessor->common_feature_value.DeltaScoreIndex()] =
         gpu_val[common_feature_value.DeltaScoreIndex()];
     cpu_val[cpu_accessor->common_feature_value.ShowIndex()] =
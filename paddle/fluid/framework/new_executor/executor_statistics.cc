@@ -17,6 +17,7 @@
 #include <fstream>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <queue>
 #include <set>
@@ -37,6 +38,26 @@ PADDLE_DEFINE_EXPORTED_string(static_executor_perfstat_filepath,
 
 namespace paddle::framework {
 
+static std::mutex& SchedulerStatisticsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+static SchedulerStats* MutableSchedulerStatistics() {
+  static SchedulerStats stats;
+  return &stats;
+}
+
+void AddSchedulerStatistics(const SchedulerStats& stats) {
+  std::lock_guard<std::mutex> guard(SchedulerStatisticsMutex());
+  *MutableSchedulerStatistics() += stats;
+}
+
+SchedulerStats GetSchedulerStatistics() {
+  std::lock_guard<std::mutex> guard(SchedulerStatisticsMutex());
+  return *MutableSchedulerStatistics();
+}
+
 class StatisticsEngine {
  public:
   StatisticsEngine() : executor_type_(ExecutorType::EXECUTOR) {}
@@ -554,6 +575,33 @@ void StatisticsEngine::Log(const std::string& filepath) {
                                    evt_stat.count,
                                    evt_stat.normalization_time);
   }
+  SchedulerStats sched = GetSchedulerStatistics();
+  if (sched.num_tasks > 0) {
+    ofs << platform::string_format(std::string(R"JSON(
+  {
+    "statistical item" : "Scheduler",
+    "total number of tasks" : %llu,
+    "total number of steals" : %llu,
+    "total number of wakeups" : %llu,
+    "total number of skipped wakeups" : %llu,
+    "total number of parks" : %llu,
+    "idle time(ns)" : %llu,
+    "average queue depth" : %.3f,
+    "max queue depth" : %llu
+  },)JSON"),
+                                   sched.num_tasks,
+                                   sched.num_steals,
+                                   sched.num_wakeups,
+                                   sched.num_skipped_wakeups,
+                                   sched.num_parks,
+                                   sched.idle_ns,
+                                   sched.num_pushes == 0
+                                       ? 0.0
+                                       : static_cast<double>(
+                                             sched.total_queue_depth) /
+                                             sched.num_pushes,
+                                   sched.max_queue_depth);
+  }
   ofs.seekp(-1, std::ios_base::end);
   ofs << "]";
   if (ofs) {
@@ -16,6 +16,7 @@
 
 #include <memory>
 
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 #include "paddle/fluid/platform/profiler/event_node.h"
 
 namespace paddle {
@@ -24,5 +25,12 @@ namespace framework {
 void StaticGraphExecutorPerfStatistics(
     std::shared_ptr<const platform::NodeTrees> profiling_data);
 
+// The scheduler statistics of the work queues of all executors, reported
+// after each multi-threaded run and written out with the performance
+// statistics.
+void AddSchedulerStatistics(const SchedulerStats& stats);
+
+SchedulerStats GetSchedulerStatistics();
+
 }  // namespace framework
 }  // namespace paddle
@@ -53,6 +53,7 @@ InterpreterCoreEventGarbageCollector::InterpreterCoreEventGarbageCollector(
 
 InterpreterCoreEventGarbageCollector::
     ~InterpreterCoreEventGarbageCollector() {  // NOLINT
+  FlushAll();
   queue_.reset(nullptr);
 }
 
@@ -156,11 +157,16 @@ void InterpreterCoreEventGarbageCollector::Add(
     return;
   }
 
+  if (IsBatched()) {
+    AddPending(std::move(garbage), event, ctx);
+    return;
+  }
+
   if (max_memory_size_ <= 1) {
     Free(garbage, event, ctx);
   } else {
     {  // lock guard
-      std::lock_guard<memory::SpinLock> guard(spinlock_);
+      auto guard = LockGarbages();
       cur_memory_size_ += static_cast<int64_t>(garbage->size());
       garbages_->push_back(std::move(garbage));
       events_[ctx] = event;
@@ -213,4 +219,50 @@ void InterpreterCoreEventGarbageCollector::FreeGarbages() {
   events_.clear();
 }
 
+void InterpreterCoreEventGarbageCollector::FreePending(
+    PendingGarbages* garbages) {
+  if (max_memory_size_ <= 1) {
+    // one event per device context is enough for the whole batch, the
+    // garbages of a context are released after its last recorded event
+    std::unordered_map<const platform::DeviceContext*,
+                       paddle::platform::DeviceEvent*>
+        events;
+    GarbageQueue container;
+    for (auto& pending : *garbages) {
+      events[pending.ctx] = pending.event;
+      container.push_back(std::move(pending.garbage));
+    }
+    garbages->clear();
+    for (auto& vals : events) {
+      vals.second->Record(vals.first);
+      vals.second->SetFinished();  // Only for CPU Event
+    }
+    queue_->AddTask(
+        [container = std::move(container), events = std::move(events)]() {
+          for (auto& vals : events) {
+            while (!vals.second->Query()) {
+#if defined(_WIN32)
+              SleepEx(50, FALSE);
+#else
+              sched_yield();
+#endif
+              continue;
+            }
+          }
+        });
+    return;
+  }
+
+  auto guard = LockGarbages();
+  for (auto& pending : *garbages) {
+    cur_memory_size_ += static_cast<int64_t>(pending.garbage->size());
+    garbages_->push_back(std::move(pending.garbage));
+    events_[pending.ctx] = pending.event;
+  }
+  garbages->clear();
+  if (cur_memory_size_ >= max_memory_size_) {
+    FreeGarbages();
+  }
+}
+
 }  // namespace paddle::framework
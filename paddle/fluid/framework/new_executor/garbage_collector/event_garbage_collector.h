@@ -50,8 +50,9 @@ class InterpreterCoreEventGarbageCollector
 
   void FreeGarbages();
 
+  void FreePending(PendingGarbages* garbages) override;
+
   std::unique_ptr<WorkQueue> queue_;
-  paddle::memory::SpinLock spinlock_;
   std::vector<paddle::platform::DeviceEvent> gc_event_;
   std::unordered_map<const platform::DeviceContext*,
                      paddle::platform::DeviceEvent*>
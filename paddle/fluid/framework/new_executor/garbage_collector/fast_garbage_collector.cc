@@ -86,10 +86,15 @@ void InterpreterCoreFastGarbageCollector::Add(Garbage garbage) {
     return;
   }
 
+  if (IsBatched()) {
+    AddPending(std::move(garbage), nullptr, nullptr);
+    return;
+  }
+
   if (max_memory_size_ > 1) {
     std::unique_ptr<GarbageQueue> pending_delete_garbages;
     {  // lock guard
-      std::lock_guard<memory::SpinLock> guard(spinlock_);
+      auto guard = LockGarbages();
       cur_memory_size_ += static_cast<int64_t>(garbage->size());
       garbages_->push_back(std::move(garbage));
 
@@ -102,5 +107,25 @@ void InterpreterCoreFastGarbageCollector::Add(Garbage garbage) {
   }
 }
 
+void InterpreterCoreFastGarbageCollector::FreePending(
+    PendingGarbages* garbages) {
+  if (max_memory_size_ > 1) {
+    std::unique_ptr<GarbageQueue> pending_delete_garbages;
+    {  // lock guard, taken once per batch
+      auto guard = LockGarbages();
+      for (auto& pending : *garbages) {
+        cur_memory_size_ += static_cast<int64_t>(pending.garbage->size());
+        garbages_->push_back(std::move(pending.garbage));
+      }
+      if (cur_memory_size_ >= max_memory_size_) {
+        cur_memory_size_ = 0;
+        pending_delete_garbages = std::move(garbages_);
+        garbages_ = std::make_unique<GarbageQueue>();
+      }
+    }
+  }
+  garbages->clear();
+}
+
 }  // namespace framework
 }  // namespace paddle
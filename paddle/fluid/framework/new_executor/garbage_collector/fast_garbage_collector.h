@@ -28,6 +28,8 @@ class InterpreterCoreFastGarbageCollector
  private:
   void Add(Variable* var);
   void Add(Garbage garbage);
+
+  void FreePending(PendingGarbages* garbages) override;
 };
 }  // namespace framework
 }  // namespace paddle
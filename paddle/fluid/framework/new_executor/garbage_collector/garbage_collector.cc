@@ -13,6 +13,9 @@
 // limitations under the License.
 
 #include "paddle/fluid/framework/new_executor/garbage_collector/garbage_collector.h"
+
+#include <algorithm>
+
 #include "paddle/fluid/framework/garbage_collector.h"
 #include "paddle/fluid/framework/new_executor/garbage_collector/event_garbage_collector.h"
 #include "paddle/fluid/framework/new_executor/garbage_collector/fast_garbage_collector.h"
@@ -21,12 +24,133 @@
 namespace paddle {
 namespace framework {
 
+namespace {
+
+std::atomic<uint64_t> next_garbage_collector_id{1};
+
+}  // namespace
+
 InterpreterCoreGarbageCollector::InterpreterCoreGarbageCollector()
-    : garbages_(std::make_unique<GarbageQueue>()) {
+    : garbages_(std::make_unique<GarbageQueue>()),
+      batch_size_(static_cast<size_t>(
+          std::max(FLAGS_new_executor_gc_batch_size, 0))),
+      id_(next_garbage_collector_id.fetch_add(1)) {
   max_memory_size_ = static_cast<int64_t>(GetEagerDeletionThreshold());
   cur_memory_size_ = 0;
 }
 
+InterpreterCoreGarbageCollector::~InterpreterCoreGarbageCollector() {
+  VLOG(4) << "InterpreterCoreGarbageCollector released " << num_pending_
+          << " garbages in " << num_batches_ << " batches from "
+          << local_garbages_.size() << " threads, its lock was taken "
+          << num_lock_acquires_ << " times and contended "
+          << num_lock_contentions_ << " times";
+}
+
+std::unique_lock<memory::SpinLock>
+InterpreterCoreGarbageCollector::LockGarbages() {
+  std::unique_lock<memory::SpinLock> lock(spinlock_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    lock.lock();
+    ++num_lock_contentions_;
+  }
+  ++num_lock_acquires_;
+  return lock;
+}
+
+GarbageCollectorStats InterpreterCoreGarbageCollector::GetStats() {
+  GarbageCollectorStats stats;
+  stats.num_garbages = num_pending_;
+  stats.num_batches = num_batches_;
+  std::lock_guard<memory::SpinLock> guard(spinlock_);
+  stats.num_lock_acquires = num_lock_acquires_;
+  stats.num_lock_contentions = num_lock_contentions_;
+  return stats;
+}
+
+InterpreterCoreGarbageCollector::LocalGarbages*
+InterpreterCoreGarbageCollector::GetLocalGarbages() {
+  // a thread usually adds to one or a few collectors (those of the control
+  // flow blocks), the recently used ones are cached to skip the mutex
+  struct CacheEntry {
+    uint64_t id;
+    LocalGarbages* local;
+  };
+  constexpr int kCacheSize = 4;
+  thread_local CacheEntry cache[kCacheSize] = {};
+  thread_local int next_entry = 0;
+  for (auto& entry : cache) {
+    if (entry.id == id_) {
+      return entry.local;
+    }
+  }
+  LocalGarbages* local = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(local_garbages_mutex_);
+    auto& slot = local_garbages_[std::this_thread::get_id()];
+    if (!slot) {
+      slot = std::make_unique<LocalGarbages>();
+    }
+    local = slot.get();
+  }
+  cache[next_entry] = CacheEntry{id_, local};
+  next_entry = (next_entry + 1) % kCacheSize;
+  return local;
+}
+
+void InterpreterCoreGarbageCollector::AddPending(
+    Garbage garbage,
+    platform::DeviceEvent* event,
+    const platform::DeviceContext* ctx) {
+  LocalGarbages* local = GetLocalGarbages();
+  PendingGarbages batch;
+  {
+    std::lock_guard<memory::SpinLock> guard(local->spinlock);
+    local->garbages.push_back(PendingGarbage{std::move(garbage), event, ctx});
+    if (local->garbages.size() < batch_size_) {
+      return;
+    }
+    batch.swap(local->garbages);
+  }
+  num_pending_ += static_cast<int64_t>(batch.size());
+  ++num_batches_;
+  FreePending(&batch);
+}
+
+void InterpreterCoreGarbageCollector::Release(LocalGarbages* local) {
+  PendingGarbages batch;
+  {
+    std::lock_guard<memory::SpinLock> guard(local->spinlock);
+    batch.swap(local->garbages);
+  }
+  if (!batch.empty()) {
+    num_pending_ += static_cast<int64_t>(batch.size());
+    ++num_batches_;
+    FreePending(&batch);
+  }
+}
+
+void InterpreterCoreGarbageCollector::FlushAll() {
+  if (!IsBatched()) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(local_garbages_mutex_);
+  for (auto& item : local_garbages_) {
+    Release(item.second.get());
+  }
+}
+
+GarbageFlushGuard::~GarbageFlushGuard() {
+  if (gc_ == nullptr || !gc_->IsBatched()) {
+    return;
+  }
+  try {
+    gc_->FlushAll();
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Failed to flush the garbage collector: " << e.what();
+  }
+}
+
 std::unique_ptr<InterpreterCoreGarbageCollector>
 CreateInterpreterCoreGarbageCollector(
     const platform::Place& place,
@@ -13,7 +13,12 @@
 // limitations under the License.
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "paddle/common/flags.h"
 #include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
@@ -24,6 +29,7 @@
 
 COMMON_DECLARE_bool(fast_eager_deletion_mode);
 COMMON_DECLARE_bool(new_executor_use_cuda_graph);
+COMMON_DECLARE_int32(new_executor_gc_batch_size);
 
 namespace paddle {
 namespace framework {
@@ -31,22 +37,99 @@ namespace framework {
 using Garbage = std::shared_ptr<memory::Allocation>;
 using GarbageQueue = std::deque<Garbage>;
 
+struct GarbageCollectorStats {
+  // garbages and batches released in batched mode
+  int64_t num_garbages{0};
+  int64_t num_batches{0};
+  // times the lock of the collector was taken, and how many of them had to
+  // wait for another thread
+  int64_t num_lock_acquires{0};
+  int64_t num_lock_contentions{0};
+};
+
 class InterpreterCoreGarbageCollector {
  public:
   InterpreterCoreGarbageCollector();
-  virtual ~InterpreterCoreGarbageCollector() {}
+  virtual ~InterpreterCoreGarbageCollector();
 
   virtual void Add(Variable* var, const Instruction& instruction) = 0;
 
   virtual void Add(Variable* var, const InstructionBase* instruction) = 0;
 
+  // In batched mode (FLAGS_new_executor_gc_batch_size > 0) the garbage is
+  // appended to a list of the thread calling Add, which is released at once
+  // when it holds batch size garbages or by FlushAll. The interpreter calls
+  // FlushAll when a run finishes.
+  bool IsBatched() const { return batch_size_ > 0; }
+
+  // Releases the garbage collected by all threads. The garbage added by
+  // another thread while it runs may be left for the next batch.
+  void FlushAll();
+
+  GarbageCollectorStats GetStats();
+
   DISABLE_COPY_AND_ASSIGN(InterpreterCoreGarbageCollector);
 
  protected:
+  struct PendingGarbage {
+    Garbage garbage;
+    platform::DeviceEvent* event;       // not owned, may be null
+    const platform::DeviceContext* ctx;  // not owned, may be null
+  };
+  using PendingGarbages = std::vector<PendingGarbage>;
+
+  // Appends garbage to the list of the calling thread in batched mode.
+  void AddPending(Garbage garbage,
+                  platform::DeviceEvent* event,
+                  const platform::DeviceContext* ctx);
+
+  // Releases a batch of garbages in bulk and clears it, a subclass taking
+  // the batched mode overrides it. By default the garbages are dropped.
+  virtual void FreePending(PendingGarbages* garbages) { garbages->clear(); }
+
+  // Takes spinlock_, counted in the stats.
+  std::unique_lock<memory::SpinLock> LockGarbages();
+
   std::unique_ptr<GarbageQueue> garbages_;
   int64_t max_memory_size_;
   int64_t cur_memory_size_;
   memory::SpinLock spinlock_;
+
+ private:
+  // The garbage list of one thread, only locked by that thread and FlushAll.
+  struct LocalGarbages {
+    memory::SpinLock spinlock;
+    PendingGarbages garbages;
+  };
+
+  LocalGarbages* GetLocalGarbages();
+  void Release(LocalGarbages* local);
+
+  const size_t batch_size_;
+  // identifies the collector in the caches of the threads, unlike its
+  // address it is never reused
+  const uint64_t id_;
+  std::mutex local_garbages_mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<LocalGarbages>>
+      local_garbages_;
+  std::atomic<int64_t> num_pending_{0};
+  std::atomic<int64_t> num_batches_{0};
+  // guarded by spinlock_
+  int64_t num_lock_acquires_{0};
+  int64_t num_lock_contentions_{0};
+};
+
+// Flushes a batched garbage collector when it goes out of scope, so that the
+// garbage of a run is released even if the run throws.
+class GarbageFlushGuard {
+ public:
+  explicit GarbageFlushGuard(InterpreterCoreGarbageCollector* gc) : gc_(gc) {}
+  ~GarbageFlushGuard();
+
+  DISABLE_COPY_AND_ASSIGN(GarbageFlushGuard);
+
+ private:
+  InterpreterCoreGarbageCollector* gc_;
 };
 
 inline bool IsInterpretercoreFastGCEnabled() {
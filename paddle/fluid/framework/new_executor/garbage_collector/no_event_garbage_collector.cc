@@ -116,7 +116,7 @@ void InterpreterCoreNoEventGarbageCollector::Add(
     queue_->AddTask([container = garbage, ctx = ctx]() { ctx->Wait(); });
   } else {
     // lock guard
-    std::lock_guard<memory::SpinLock> guard(spinlock_);
+    auto guard = LockGarbages();
     cur_memory_size_ += static_cast<int64_t>(garbage->size());
     garbages_->emplace_back(std::move(garbage));
     ctxs_.insert(ctx);
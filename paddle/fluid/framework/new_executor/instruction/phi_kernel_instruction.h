@@ -38,10 +38,16 @@ class PhiKernelInstruction : public InstructionBase {
 
   const phi::KernelContext& KernelContext() const { return kernel_context_; }
 
+  phi::KernelContext* MutableKernelContext() { return &kernel_context_; }
+
   const phi::InferMetaContext& InferMetaContext() const {
     return infer_meta_context_;
   }
 
+  phi::InferMetaContext* MutableInferMetaContext() {
+    return &infer_meta_context_;
+  }
+
   paddle::dialect::InferMetaInterface::Concept* InferMetaInterface() const {
     return infer_meta_interface_;
   }
@@ -0,0 +1,109 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/critical_path.h"
+
+#include <algorithm>
+
+#include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/pir/dialect/kernel/ir/kernel_type.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/pir/include/core/operation.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+static int64_t ValueNumel(::pir::Value value) {
+  if (!value || !value.type()) {
+    return 0;
+  }
+  auto type =
+      value.type().dyn_cast<paddle::dialect::AllocatedDenseTensorType>();
+  if (!type) {
+    return 0;
+  }
+  int64_t numel = 1;
+  for (int i = 0; i < type.dims().size(); ++i) {
+    numel *= std::max<int64_t>(type.dims()[i], 1);
+  }
+  return numel;
+}
+
+int64_t EstimateInstructionCost(const InstructionBase& instr) {
+  int64_t cost = kInstructionDispatchCost;
+  ::pir::Operation* op = instr.Operation();
+  if (op == nullptr) {
+    return cost;
+  }
+  for (uint32_t i = 0; i < op->num_operands(); ++i) {
+    cost += ValueNumel(op->operand_source(i));
+  }
+  for (uint32_t i = 0; i < op->num_results(); ++i) {
+    cost += ValueNumel(op->result(i));
+  }
+  return cost;
+}
+
+std::vector<int64_t> ComputeCriticalPathLength(
+    const std::map<size_t, std::set<size_t>>& downstream_map,
+    const std::vector<int64_t>& costs) {
+  size_t instr_num = costs.size();
+  // Kahn's algorithm from the end of the program: an instruction is done
+  // once all its downstream instructions are
+  std::vector<size_t> remaining_downstream(instr_num, 0);
+  std::vector<std::vector<size_t>> upstream(instr_num);
+  for (auto& item : downstream_map) {
+    for (size_t next_id : item.second) {
+      PADDLE_ENFORCE_LT(
+          next_id,
+          instr_num,
+          platform::errors::OutOfRange(
+              "Downstream instruction %d is out of range [0, %d).",
+              next_id,
+              instr_num));
+      upstream[next_id].push_back(item.first);
+      ++remaining_downstream[item.first];
+    }
+  }
+
+  std::vector<int64_t> length(costs);
+  std::vector<size_t> done;
+  for (size_t id = 0; id < instr_num; ++id) {
+    if (remaining_downstream[id] == 0) {
+      done.push_back(id);
+    }
+  }
+  size_t num_done = 0;
+  while (!done.empty()) {
+    size_t id = done.back();
+    done.pop_back();
+    ++num_done;
+    for (size_t prev_id : upstream[id]) {
+      length[prev_id] = std::max(length[prev_id], costs[prev_id] + length[id]);
+      if (--remaining_downstream[prev_id] == 0) {
+        done.push_back(prev_id);
+      }
+    }
+  }
+  PADDLE_ENFORCE_EQ(num_done,
+                    instr_num,
+                    platform::errors::PreconditionNotMet(
+                        "The dependencies of the instructions have a cycle."));
+  return length;
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
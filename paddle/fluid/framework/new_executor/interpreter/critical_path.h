@@ -0,0 +1,48 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+class InstructionBase;
+
+namespace interpreter {
+
+// The fixed cost of dispatching an instruction, in elements.
+constexpr int64_t kInstructionDispatchCost = 1024;
+
+// Static cost of an instruction: the dispatch cost plus the number of
+// elements of its dense tensor inputs and outputs, since most host kernels
+// are bound by memory traffic. Unknown dims count as 1.
+int64_t EstimateInstructionCost(const InstructionBase& instr);
+
+// The cost of the longest path from each instruction to the end of the
+// program, the instruction itself included. The instructions on the critical
+// path of the program have the largest values among the ready ones, running
+// them first shortens the end to end latency when the threads are scarce.
+std::vector<int64_t> ComputeCriticalPathLength(
+    const std::map<size_t, std::set<size_t>>& downstream_map,
+    const std::vector<int64_t>& costs);
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
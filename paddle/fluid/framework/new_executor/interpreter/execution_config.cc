@@ -14,10 +14,12 @@
 
 #include "paddle/fluid/framework/new_executor/interpreter/execution_config.h"
 
+#include <algorithm>
 #include <set>
 #include <thread>
 
 #include "paddle/fluid/platform/device/ipu/ipu_info.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
 #include "paddle/phi/backends/device_manager.h"
 #include "paddle/phi/backends/gpu/gpu_info.h"
 #include "paddle/phi/backends/xpu/xpu_info.h"
@@ -115,6 +117,14 @@ void ExecutionConfig::AnalyzeThreadPoolConfig(const phi::Place& place,
   if (host_num_threads == 0 || device_num_threads == 0) {
     std::tie(host_num_threads, device_num_threads) =
         GetThreadPoolConfig(place, op_num);
+    // the host threads share the cpus of the node they are pinned to
+    if (numa_node >= 0) {
+      for (const auto& node : phi::backends::cpu::CpuNumaNodes()) {
+        if (node.id == numa_node) {
+          host_num_threads = std::min(host_num_threads, node.cpus.size());
+        }
+      }
+    }
   }
 }
 
@@ -126,7 +136,8 @@ void ExecutionConfig::Log(int log_level) {
           << "used_for_control_flow_op = " << used_for_control_flow_op << "\n"
           << "used_for_jit = " << used_for_jit << "\n"
           << "device_num_threads = " << device_num_threads << "\n"
-          << "host_num_threads = " << host_num_threads << "\n";
+          << "host_num_threads = " << host_num_threads << "\n"
+          << "numa_node = " << numa_node << "\n";
 
   log_str << "force_root_scope_vars = [";
   for (const std::string& var : force_root_scope_vars) {
@@ -33,6 +33,8 @@ struct ExecutionConfig {
 
   size_t device_num_threads{0};
   size_t host_num_threads{0};
+  // pin the worker threads to this NUMA node, -1 for none
+  int numa_node{-1};
 
   std::set<std::string> force_root_scope_vars;
   std::set<std::string> jit_input_vars;
@@ -0,0 +1,175 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/frozen_trace.h"
+
+#include <typeinfo>
+
+#include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/framework/new_executor/instruction/phi_kernel_instruction.h"
+#include "paddle/fluid/pir/dialect/operator/interface/infermeta.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/infermeta_utils.h"
+#include "paddle/phi/core/kernel_context.h"
+#include "paddle/phi/core/kernel_factory.h"
+#include "paddle/phi/core/tensor_utils.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+namespace {
+
+// InferMeta reading the value of a tensor (e.g. the shape of reshape) must
+// run every time, its result is not a function of the metas only
+bool HasTensorAttribute(const phi::InferMetaContext& ctx) {
+  for (size_t i = 0; i < ctx.AttrsSize(); ++i) {
+    const phi::Attribute& attr = ctx.AttrAt(i);
+    if (paddle::holds_alternative<phi::TensorRef>(attr) ||
+        paddle::holds_alternative<std::vector<phi::TensorRef>>(attr)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+FrozenTrace::FrozenTrace(const std::vector<InstructionBase*>& instrs) {
+  steps_.reserve(instrs.size());
+  for (InstructionBase* instr : instrs) {
+    Step step;
+    step.instr = instr;
+    // subclasses such as the onednn instructions run more than the kernel
+    if (typeid(*instr) != typeid(PhiKernelInstruction)) {
+      steps_.push_back(step);
+      continue;
+    }
+    auto* phi_instr = static_cast<PhiKernelInstruction*>(instr);
+    phi::KernelContext* kernel_ctx = phi_instr->MutableKernelContext();
+    std::vector<const phi::DenseTensor*> inputs;
+    std::vector<phi::DenseTensor*> outputs;
+    bool all_dense = true;
+    for (size_t i = 0; all_dense && i < kernel_ctx->InputsSize(); ++i) {
+      const phi::TensorBase* t = kernel_ctx->MutableIutputAt(i);
+      if (t == nullptr) {
+        continue;
+      }
+      all_dense = phi::DenseTensor::classof(t);
+      inputs.push_back(static_cast<const phi::DenseTensor*>(t));
+    }
+    for (size_t i = 0; all_dense && i < kernel_ctx->OutputsSize(); ++i) {
+      phi::TensorBase* t = kernel_ctx->MutableOutputAt(i);
+      if (t == nullptr) {
+        continue;
+      }
+      all_dense = phi::DenseTensor::classof(t);
+      outputs.push_back(static_cast<phi::DenseTensor*>(t));
+    }
+    if (!all_dense || HasTensorAttribute(phi_instr->InferMetaContext())) {
+      steps_.push_back(step);
+      continue;
+    }
+
+    step.kernel = phi_instr->PhiKernel();
+    step.kernel_ctx = kernel_ctx;
+    step.infer_meta_ctx = phi_instr->MutableInferMetaContext();
+    if (phi_instr->InferMetaInterface()) {
+      step.infer_meta = phi_instr->InferMetaInterface()->infer_meta_;
+    }
+    step.input_begin = inputs_.size();
+    inputs_.insert(inputs_.end(), inputs.begin(), inputs.end());
+    step.input_end = inputs_.size();
+    step.output_begin = outputs_.size();
+    outputs_.insert(outputs_.end(), outputs.begin(), outputs.end());
+    step.output_end = outputs_.size();
+    steps_.push_back(step);
+    ++num_frozen_steps_;
+  }
+  input_metas_.resize(inputs_.size());
+  output_metas_.resize(outputs_.size());
+  VLOG(4) << "FrozenTrace: " << num_frozen_steps_ << " of " << steps_.size()
+          << " instructions are frozen";
+}
+
+bool FrozenTrace::InputsChanged(const Step& step) const {
+  if (!step.recorded) {
+    return true;
+  }
+  for (size_t i = step.input_begin; i < step.input_end; ++i) {
+    const phi::DenseTensorMeta& meta = inputs_[i]->meta();
+    const Meta& recorded = input_metas_[i];
+    if (meta.dtype != recorded.dtype || meta.layout != recorded.layout ||
+        meta.dims != recorded.dims || meta.lod != recorded.lod) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FrozenTrace::RunInferMeta(Step* step) {
+  // an inplace kernel has the same tensor as input and output, its input
+  // meta is the one before InferMeta
+  for (size_t i = step->input_begin; i < step->input_end; ++i) {
+    const phi::DenseTensorMeta& meta = inputs_[i]->meta();
+    input_metas_[i] =
+        Meta{meta.dims, meta.strides, meta.dtype, meta.layout, meta.lod};
+  }
+  step->infer_meta(step->infer_meta_ctx);
+  for (size_t i = step->output_begin; i < step->output_end; ++i) {
+    const phi::DenseTensorMeta& meta = outputs_[i]->meta();
+    output_metas_[i] =
+        Meta{meta.dims, meta.strides, meta.dtype, meta.layout, meta.lod};
+  }
+  step->recorded = true;
+  ++num_infer_meta_runs_;
+}
+
+void FrozenTrace::RestoreOutputs(const Step& step) {
+  for (size_t i = step.output_begin; i < step.output_end; ++i) {
+    phi::DenseTensorMeta* meta =
+        phi::DenseTensorUtils::GetMutableMeta(outputs_[i]);
+    const Meta& recorded = output_metas_[i];
+    meta->dims = recorded.dims;
+    meta->strides = recorded.strides;
+    meta->dtype = recorded.dtype;
+    meta->layout = recorded.layout;
+    if (meta->lod != recorded.lod) {
+      meta->lod = recorded.lod;
+    }
+  }
+}
+
+void FrozenTrace::Run(size_t idx) {
+  if (idx == 0) {
+    ++num_replays_;
+  }
+  Step& step = steps_[idx];
+  if (step.kernel == nullptr) {
+    step.instr->Run();
+    return;
+  }
+  if (step.infer_meta) {
+    if (InputsChanged(step)) {
+      RunInferMeta(&step);
+    } else {
+      RestoreOutputs(step);
+    }
+  }
+  (*step.kernel)(step.kernel_ctx);
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,108 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+
+#include "paddle/phi/core/tensor_meta.h"
+
+namespace phi {
+class DenseTensor;
+class InferMetaContext;
+class Kernel;
+class KernelContext;
+}  // namespace phi
+
+namespace paddle {
+namespace framework {
+
+class InstructionBase;
+
+namespace interpreter {
+
+// Frozen replay of the execution order of a PirInterpreter running in trace
+// mode. It is built once after a warm-up run and keeps one flat array of
+// steps: the phi kernel, its prebuilt KernelContext and InferMeta function
+// for each PhiKernelInstruction, and the instruction itself for the others.
+//
+// A frozen step calls the kernel directly. InferMeta is a function of the
+// input metas, so it is run only if the meta (dims, dtype, layout and lod)
+// of an input of the kernel context differs from the one it last ran with.
+// Otherwise the output metas it produced then are written back, which holds
+// even if another run with other shapes happened in between. Instructions
+// whose InferMeta reads tensor values (tensor attributes), or whose kernel
+// context holds other than DenseTensors, are run as usual.
+class FrozenTrace {
+ public:
+  explicit FrozenTrace(const std::vector<InstructionBase*>& instrs);
+
+  size_t size() const { return steps_.size(); }
+
+  InstructionBase* Instruction(size_t idx) const { return steps_[idx].instr; }
+
+  // runs the idx-th step, a replay starts with step 0
+  void Run(size_t idx);
+
+  // the number of replays started so far
+  size_t NumReplays() const { return num_replays_; }
+
+  size_t NumFrozenSteps() const { return num_frozen_steps_; }
+
+  // the number of InferMeta calls made by the frozen steps so far
+  size_t NumInferMetaRuns() const { return num_infer_meta_runs_; }
+
+ private:
+  struct Step {
+    InstructionBase* instr{nullptr};  // not owned
+    // null if the step is not frozen
+    const phi::Kernel* kernel{nullptr};      // not owned
+    phi::KernelContext* kernel_ctx{nullptr};  // not owned
+    phi::InferMetaContext* infer_meta_ctx{nullptr};  // not owned
+    void (*infer_meta)(phi::InferMetaContext*){nullptr};
+    // the inputs of the kernel context are [input_begin, input_end) of
+    // inputs_ and the outputs [output_begin, output_end) of outputs_, their
+    // metas are not recorded before the first InferMeta
+    size_t input_begin{0};
+    size_t input_end{0};
+    size_t output_begin{0};
+    size_t output_end{0};
+    bool recorded{false};
+  };
+
+  struct Meta {
+    phi::DDim dims;
+    phi::DDim strides;
+    phi::DataType dtype;
+    phi::DataLayout layout;
+    phi::LoD lod;
+  };
+
+  bool InputsChanged(const Step& step) const;
+  void RunInferMeta(Step* step);
+  void RestoreOutputs(const Step& step);
+
+  std::vector<Step> steps_;
+  std::vector<const phi::DenseTensor*> inputs_;
+  std::vector<Meta> input_metas_;
+  std::vector<phi::DenseTensor*> outputs_;
+  std::vector<Meta> output_metas_;
+  size_t num_frozen_steps_{0};
+  size_t num_infer_meta_runs_{0};
+  size_t num_replays_{0};
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -52,6 +52,8 @@ COMMON_DECLARE_bool(use_mkldnn);
 COMMON_DECLARE_bool(check_nan_inf);
 COMMON_DECLARE_string(static_runtime_data_save_path);
 COMMON_DECLARE_bool(save_static_runtime_data);
+COMMON_DECLARE_bool(new_executor_work_stealing);
+COMMON_DECLARE_bool(new_executor_scheduler_stats);
 
 namespace paddle::framework::interpreter {
 
@@ -90,7 +92,10 @@ class SingleStreamGuard {
 };
 
 const std::vector<WorkQueueOptions> ConstructWorkQueueOptions(
-    size_t host_num_threads, size_t device_num_threads, EventsWaiter* waiter) {
+    size_t host_num_threads,
+    size_t device_num_threads,
+    EventsWaiter* waiter,
+    int numa_node) {
   std::vector<WorkQueueOptions> group_options;
   // for execute host Kernel
   group_options.emplace_back(/*name*/ "HostTasks",
@@ -100,6 +105,9 @@ const std::vector<WorkQueueOptions> ConstructWorkQueueOptions(
                              /*track_task*/ false,
                              /*detached*/ true,
                              /*events_waiter*/ waiter);
+  group_options.back().work_stealing = FLAGS_new_executor_work_stealing;
+  group_options.back().numa_node = numa_node;
+  group_options.back().collect_stats = FLAGS_new_executor_scheduler_stats;
   // for launch device Kernel
   group_options.emplace_back(/*name*/ "DeviceKernelLaunch",
                              /*num_threads*/ device_num_threads,
@@ -108,15 +116,18 @@ const std::vector<WorkQueueOptions> ConstructWorkQueueOptions(
                              /*track_task*/ false,
                              /*detached*/ true,
                              /*events_waiter*/ waiter);
+  group_options.back().numa_node = numa_node;
+  group_options.back().collect_stats = FLAGS_new_executor_scheduler_stats;
   return group_options;
 }
 
 AsyncWorkQueue::AsyncWorkQueue(size_t host_num_threads,
                                size_t device_num_threads,
-                               EventsWaiter* waiter)
+                               EventsWaiter* waiter,
+                               int numa_node)
     : host_num_thread_(host_num_threads),
       queue_group_(CreateWorkQueueGroup(ConstructWorkQueueOptions(
-          host_num_threads, device_num_threads, waiter))) {}
+          host_num_threads, device_num_threads, waiter, numa_node))) {}
 
 void AsyncWorkQueue::AddTask(const OpFuncType& op_func_type,
                              std::function<void()> fn) {
@@ -125,6 +136,28 @@ void AsyncWorkQueue::AddTask(const OpFuncType& op_func_type,
   queue_group_->AddTask(op_func_type == OpFuncType::kGpuAsync, std::move(fn));
 }
 
+void AsyncWorkQueue::AddTasks(const OpFuncType& op_func_type,
+                              std::vector<std::function<void()>>* fns) {
+  if (fns->empty()) {
+    return;
+  }
+  queue_group_->AddTasks(op_func_type == OpFuncType::kGpuAsync, fns);
+}
+
+SchedulerStats AsyncWorkQueue::GetStats() const {
+  SchedulerStats stats = queue_group_->QueueStats(0);
+  stats += queue_group_->QueueStats(1);
+  return stats;
+}
+
+SchedulerStats AsyncWorkQueue::GetStatsSinceLastCall() {
+  SchedulerStats stats = GetStats();
+  std::lock_guard<std::mutex> guard(stats_mutex_);
+  SchedulerStats diff = stats - last_stats_;
+  last_stats_ = stats;
+  return diff;
+}
+
 bool IsCommunicationOp(const OperatorBase* op) {
   const std::string& op_name = op->Type();
   const std::set<std::string> special_comm_op_set = {
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -49,21 +50,34 @@ class AsyncWorkQueue {
  public:
   AsyncWorkQueue(size_t host_num_threads,
                  size_t device_num_threads,
-                 EventsWaiter* waiter);
+                 EventsWaiter* waiter,
+                 int numa_node = -1);
 
   // void WaitEmpty() { queue_group_->WaitQueueGroupEmpty(); }
 
   void AddTask(const OpFuncType& op_func_type, std::function<void()> fn);
 
+  // Adds the tasks at once, fns is cleared
+  void AddTasks(const OpFuncType& op_func_type,
+                std::vector<std::function<void()>>* fns);
+
   void Cancel() { queue_group_->Cancel(); }
 
   size_t QueueNumThreads(size_t idx) {
     return queue_group_->QueueNumThreads(idx);
   }
 
+  SchedulerStats GetStats() const;
+
+  // The statistics since the last call, so a queue shared by several
+  // interpreters is not counted twice when each of them reports.
+  SchedulerStats GetStatsSinceLastCall();
+
  private:
   size_t host_num_thread_;
   std::unique_ptr<WorkQueueGroup> queue_group_;
+  std::mutex stats_mutex_;
+  SchedulerStats last_stats_;
 };
 
 bool IsCommunicationOp(const OperatorBase* op);
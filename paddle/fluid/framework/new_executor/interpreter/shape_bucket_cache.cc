@@ -0,0 +1,134 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/shape_bucket_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/utils/string/string_helper.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+namespace {
+
+int64_t ParsePositiveInt(const std::string& str, const std::string& spec) {
+  char* end = nullptr;
+  int64_t value = std::strtoll(str.c_str(), &end, 10);
+  PADDLE_ENFORCE_EQ(
+      !str.empty() && *end == '\0' && value > 0,
+      true,
+      phi::errors::InvalidArgument(
+          "The shape bucket policy [%s] expects positive integers, but "
+          "received [%s].",
+          spec,
+          str));
+  return value;
+}
+
+}  // namespace
+
+ShapeBucketPolicy ShapeBucketPolicy::Parse(const std::string& spec) {
+  ShapeBucketPolicy policy;
+  policy.spec_ = spec;
+  size_t colon = spec.find(':');
+  std::string kind = spec.substr(0, colon);
+  std::string args = colon == std::string::npos ? "" : spec.substr(colon + 1);
+  if (kind == "exact" && colon == std::string::npos) {
+    policy.kind_ = Kind::kExact;
+  } else if (kind == "pow2" && colon == std::string::npos) {
+    policy.kind_ = Kind::kPowerOfTwo;
+  } else if (kind == "step" && colon != std::string::npos) {
+    policy.kind_ = Kind::kStep;
+    policy.step_ = ParsePositiveInt(args, spec);
+  } else if (kind == "boundaries" && colon != std::string::npos) {
+    policy.kind_ = Kind::kBoundaries;
+    for (auto& item : paddle::string::split_string(args, ",")) {
+      policy.boundaries_.push_back(ParsePositiveInt(item, spec));
+    }
+    PADDLE_ENFORCE_EQ(
+        std::is_sorted(policy.boundaries_.begin(), policy.boundaries_.end()),
+        true,
+        phi::errors::InvalidArgument(
+            "The boundaries of the shape bucket policy [%s] must be sorted.",
+            spec));
+  } else {
+    PADDLE_THROW(phi::errors::InvalidArgument(
+        "Unknown shape bucket policy [%s], it should be one of exact, pow2, "
+        "step:<n> or boundaries:<b0>,<b1>,...",
+        spec));
+  }
+  return policy;
+}
+
+int64_t ShapeBucketPolicy::Bucket(int64_t dim) const {
+  if (dim <= 0) {
+    return dim;
+  }
+  switch (kind_) {
+    case Kind::kPowerOfTwo: {
+      int64_t bucket = 1;
+      while (bucket < dim) {
+        bucket <<= 1;
+      }
+      return bucket;
+    }
+    case Kind::kStep:
+      return (dim + step_ - 1) / step_ * step_;
+    case Kind::kBoundaries: {
+      auto iter =
+          std::lower_bound(boundaries_.begin(), boundaries_.end(), dim);
+      return iter == boundaries_.end() ? dim : *iter;
+    }
+    default:
+      return dim;
+  }
+}
+
+size_t ShapeBucketKeyHash::operator()(const ShapeBucketKey& key) const {
+  size_t seed = key.size();
+  for (int64_t value : key) {
+    seed ^= std::hash<int64_t>()(value) + 0x9e3779b9 + (seed << 6) +
+            (seed >> 2);
+  }
+  return seed;
+}
+
+void MakeShapeBucketKey(const std::vector<Variable*>& inputs,
+                        const ShapeBucketPolicy& policy,
+                        ShapeBucketKey* key) {
+  key->clear();
+  for (Variable* var : inputs) {
+    if (var == nullptr || !var->IsType<phi::DenseTensor>() ||
+        !var->Get<phi::DenseTensor>().meta().valid()) {
+      key->push_back(-1);
+      continue;
+    }
+    const phi::DenseTensorMeta& meta = var->Get<phi::DenseTensor>().meta();
+    key->push_back(static_cast<int64_t>(meta.dtype));
+    key->push_back(meta.dims.size());
+    for (int i = 0; i < meta.dims.size(); ++i) {
+      key->push_back(policy.Bucket(meta.dims[i]));
+    }
+  }
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,132 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/framework/variable.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+// How the dims of the input tensors are rounded up into buckets, parsed from
+//   "exact"                  every dim is its own bucket
+//   "pow2"                   the next power of two
+//   "step:<n>"               the next multiple of n
+//   "boundaries:<b0>,<b1>.." the first boundary not below the dim, the dims
+//                            above the last boundary are kept as they are
+// Unknown dims (-1) are kept as they are.
+class ShapeBucketPolicy {
+ public:
+  static ShapeBucketPolicy Parse(const std::string& spec);
+
+  int64_t Bucket(int64_t dim) const;
+
+  const std::string& Spec() const { return spec_; }
+
+ private:
+  enum class Kind { kExact, kPowerOfTwo, kStep, kBoundaries };
+
+  std::string spec_;
+  Kind kind_{Kind::kExact};
+  int64_t step_{1};
+  std::vector<int64_t> boundaries_;
+};
+
+// The bucketed signature of the inputs: for each one its dtype, its rank and
+// its bucketed dims, or -1 if it is not an initialized DenseTensor.
+using ShapeBucketKey = std::vector<int64_t>;
+
+struct ShapeBucketKeyHash {
+  size_t operator()(const ShapeBucketKey& key) const;
+};
+
+void MakeShapeBucketKey(const std::vector<Variable*>& inputs,
+                        const ShapeBucketPolicy& policy,
+                        ShapeBucketKey* key);
+
+// A cache of the execution state prepared for each bucket, it keeps the
+// capacity most recently used buckets.
+template <typename T>
+class ShapeBucketCache {
+ public:
+  ShapeBucketCache(ShapeBucketPolicy policy, size_t capacity)
+      : policy_(std::move(policy)), capacity_(capacity > 0 ? capacity : 1) {}
+
+  const ShapeBucketPolicy& Policy() const { return policy_; }
+
+  // returns the state of key, a default one on a miss, and makes it the most
+  // recently used. The state of the least recently used bucket is destroyed
+  // if the cache is full, the pointers returned before may dangle then.
+  T* Get(const ShapeBucketKey& key) {
+    auto iter = index_.find(key);
+    if (iter != index_.end()) {
+      ++hits_;
+      entries_.splice(entries_.begin(), entries_, iter->second);
+      return &iter->second->second;
+    }
+    ++misses_;
+    if (entries_.size() >= capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+      ++evictions_;
+    }
+    entries_.emplace_front(key, T());
+    index_.emplace(key, entries_.begin());
+    return &entries_.front().second;
+  }
+
+  // returns the state of key if cached, without counting it as a use
+  T* Find(const ShapeBucketKey& key) {
+    auto iter = index_.find(key);
+    return iter == index_.end() ? nullptr : &iter->second->second;
+  }
+
+  void Clear() {
+    index_.clear();
+    entries_.clear();
+  }
+
+  size_t Size() const { return entries_.size(); }
+  size_t Capacity() const { return capacity_; }
+  size_t Hits() const { return hits_; }
+  size_t Misses() const { return misses_; }
+  size_t Evictions() const { return evictions_; }
+
+ private:
+  using Entry = std::pair<ShapeBucketKey, T>;
+
+  ShapeBucketPolicy policy_;
+  size_t capacity_;
+  // the most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<ShapeBucketKey,
+                     typename std::list<Entry>::iterator,
+                     ShapeBucketKeyHash>
+      index_;
+  size_t hits_{0};
+  size_t misses_{0};
+  size_t evictions_{0};
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
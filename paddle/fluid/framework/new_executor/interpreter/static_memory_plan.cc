@@ -0,0 +1,253 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/framework/new_executor/pir_adaptor/pir_adaptor_util.h"
+#include "paddle/fluid/memory/malloc.h"
+#include "paddle/phi/core/dense_tensor.h"
+
+namespace paddle {
+namespace framework {
+namespace interpreter {
+
+size_t PlanMemoryOffsets(const std::vector<MemoryPlanBuffer>& buffers,
+                         size_t alignment,
+                         std::vector<size_t>* offsets) {
+  auto align = [alignment](size_t size) {
+    return (size + alignment - 1) / alignment * alignment;
+  };
+  std::vector<size_t> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (buffers[a].size != buffers[b].size) {
+      return buffers[a].size > buffers[b].size;
+    }
+    return buffers[a].first < buffers[b].first;
+  });
+
+  offsets->assign(buffers.size(), 0);
+  std::vector<size_t> placed;
+  std::vector<std::pair<size_t, size_t>> busy;
+  size_t arena_size = 0;
+  for (size_t id : order) {
+    const MemoryPlanBuffer& buffer = buffers[id];
+    size_t size = align(buffer.size);
+    // the memory ranges taken by the buffers alive at the same time
+    busy.clear();
+    for (size_t other : placed) {
+      const MemoryPlanBuffer& placed_buffer = buffers[other];
+      if (placed_buffer.last >= buffer.first &&
+          buffer.last >= placed_buffer.first) {
+        busy.emplace_back((*offsets)[other],
+                          (*offsets)[other] + align(placed_buffer.size));
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t best_offset = 0;
+    size_t best_gap = static_cast<size_t>(-1);
+    size_t end = 0;
+    for (auto& range : busy) {
+      if (range.first > end) {
+        size_t gap = range.first - end;
+        if (gap >= size && gap < best_gap) {
+          best_gap = gap;
+          best_offset = end;
+        }
+      }
+      end = std::max(end, range.second);
+    }
+    if (best_gap == static_cast<size_t>(-1)) {
+      best_offset = end;
+    }
+    (*offsets)[id] = best_offset;
+    arena_size = std::max(arena_size, best_offset + size);
+    placed.push_back(id);
+  }
+  return arena_size;
+}
+
+int StaticMemoryPlan::Find(int var_id) {
+  while (parent_[var_id] != var_id) {
+    parent_[var_id] = parent_[parent_[var_id]];
+    var_id = parent_[var_id];
+  }
+  return var_id;
+}
+
+void StaticMemoryPlan::Use(int var_id,
+                           const std::vector<Variable*>& var_list,
+                           bool is_output) {
+  Variable* var = var_list[var_id];
+  VarInfo& info = vars_[var_id];
+  info.first = std::min(info.first, step_);
+  info.last = std::max(info.last, step_);
+  if (var == nullptr || !var->IsType<phi::DenseTensor>()) {
+    return;
+  }
+  const phi::Allocation* holder = var->Get<phi::DenseTensor>().Holder().get();
+  if (holder == nullptr) {
+    return;
+  }
+  if (is_output) {
+    info.written = true;
+    info.bytes = std::max(info.bytes, holder->size());
+  }
+  if (holder->place() != place_) {
+    info.on_place = false;
+  }
+  // holder_owner_ keeps the last variable seen with a holder. If that one
+  // does not hold it anymore, the holder was freed and the address reused.
+  auto iter = holder_owner_.find(holder);
+  if (iter != holder_owner_.end() && iter->second != var_id) {
+    Variable* owner = var_list[iter->second];
+    if (owner != nullptr && owner->IsType<phi::DenseTensor>() &&
+        owner->Get<phi::DenseTensor>().Holder().get() == holder) {
+      parent_[Find(var_id)] = Find(iter->second);
+    }
+  }
+  holder_owner_[holder] = var_id;
+}
+
+void StaticMemoryPlan::RecordInstruction(
+    const InstructionBase& instr, const ValueExecutionInfo& value_exe_info) {
+  const std::vector<Variable*>& var_list = value_exe_info.GetVarList();
+  if (vars_.size() < var_list.size()) {
+    size_t old_size = parent_.size();
+    vars_.resize(var_list.size());
+    parent_.resize(var_list.size());
+    std::iota(parent_.begin() + old_size, parent_.end(), old_size);
+  }
+  for (auto& item : instr.Inputs()) {
+    for (int var_id : item.second) {
+      if (var_id >= 0) {
+        Use(var_id, var_list, false);
+      }
+    }
+  }
+  for (auto& item : instr.Outputs()) {
+    for (int var_id : item.second) {
+      if (var_id >= 0) {
+        Use(var_id, var_list, true);
+      }
+    }
+  }
+  ++step_;
+}
+
+void StaticMemoryPlan::Build(const std::vector<bool>& candidates) {
+  struct Buffer {
+    MemoryPlanBuffer buffer{0, static_cast<size_t>(-1), 0};
+    bool plannable{true};
+    int producer{-1};
+    std::vector<int> var_ids;
+  };
+  std::unordered_map<int, Buffer> groups;
+  for (size_t var_id = 0; var_id < vars_.size(); ++var_id) {
+    const VarInfo& info = vars_[var_id];
+    if (info.first == static_cast<size_t>(-1)) {
+      continue;
+    }
+    Buffer& group = groups[Find(static_cast<int>(var_id))];
+    group.var_ids.push_back(static_cast<int>(var_id));
+    group.buffer.size = std::max(group.buffer.size, info.bytes);
+    group.buffer.first = std::min(group.buffer.first, info.first);
+    group.buffer.last = std::max(group.buffer.last, info.last);
+    group.plannable = group.plannable && var_id < candidates.size() &&
+                      candidates[var_id] && info.on_place;
+    if (info.written && (group.producer == -1 ||
+                         info.first < vars_[group.producer].first)) {
+      group.producer = static_cast<int>(var_id);
+    }
+  }
+
+  std::vector<MemoryPlanBuffer> buffers;
+  std::vector<Buffer*> planned_groups;
+  for (auto& item : groups) {
+    Buffer& group = item.second;
+    if (group.plannable && group.producer != -1 && group.buffer.size > 0) {
+      buffers.push_back(group.buffer);
+      planned_groups.push_back(&group);
+    }
+  }
+  is_built_ = true;
+  holder_owner_.clear();
+  planned_.assign(vars_.size(), false);
+  if (buffers.empty()) {
+    VLOG(1) << "StaticMemoryPlan finds nothing to plan";
+    return;
+  }
+
+  std::vector<size_t> offsets;
+  size_t arena_size = PlanMemoryOffsets(buffers, kAlignment, &offsets);
+  arena_ = memory::AllocShared(place_, arena_size);
+  auto* base = static_cast<uint8_t*>(arena_->ptr());
+  size_t total_bytes = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    Buffer& group = *planned_groups[i];
+    for (int var_id : group.var_ids) {
+      planned_[var_id] = true;
+    }
+    // the slots do not own memory, the arena does
+    bindings_.emplace_back(group.producer,
+                           std::make_shared<phi::Allocation>(
+                               base + offsets[i], buffers[i].size, place_));
+    total_bytes += buffers[i].size;
+  }
+  planned_bytes_ = total_bytes;
+  VLOG(1) << "StaticMemoryPlan packs " << buffers.size() << " buffers of "
+          << total_bytes << " bytes into an arena of " << arena_size
+          << " bytes";
+}
+
+void StaticMemoryPlan::Bind(const std::vector<Variable*>& var_list) const {
+  for (auto& binding : bindings_) {
+    auto* tensor = var_list[binding.first]->GetMutable<phi::DenseTensor>();
+    // a holder left by the last run is either the slot or one a kernel
+    // allocated itself because the shape grew, both are kept
+    if (tensor->Holder() == nullptr) {
+      tensor->ResetHolder(binding.second);
+    }
+  }
+}
+
+void StaticMemoryPlan::Unbind(const std::vector<Variable*>& var_list) const {
+  if (!arena_) {
+    return;
+  }
+  auto* begin = static_cast<uint8_t*>(arena_->ptr());
+  auto* end = begin + arena_->size();
+  for (size_t var_id = 0; var_id < planned_.size(); ++var_id) {
+    if (!planned_[var_id] || var_list[var_id] == nullptr ||
+        !var_list[var_id]->IsType<phi::DenseTensor>()) {
+      continue;
+    }
+    auto* tensor = var_list[var_id]->GetMutable<phi::DenseTensor>();
+    const auto& holder = tensor->Holder();
+    if (holder != nullptr) {
+      auto* ptr = static_cast<uint8_t*>(holder->ptr());
+      if (ptr >= begin && ptr < end) {
+        tensor->MoveMemoryHolder();
+      }
+    }
+  }
+}
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
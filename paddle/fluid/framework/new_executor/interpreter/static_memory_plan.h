@@ -0,0 +1,125 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/framework/variable.h"
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/allocator.h"
+
+namespace paddle {
+namespace framework {
+
+class InstructionBase;
+class ValueExecutionInfo;
+
+namespace interpreter {
+
+// A buffer alive from the instruction first to the instruction last of the
+// execution order, both included.
+struct MemoryPlanBuffer {
+  size_t size;
+  size_t first;
+  size_t last;
+};
+
+// Best fit interval colouring: the buffers are placed largest first, each
+// into the smallest gap between the already placed buffers whose lifetimes
+// overlap with it, or after all of them if no gap fits. Buffers alive at the
+// same time never overlap in memory. The sizes are rounded up to alignment,
+// returns the size of the arena.
+size_t PlanMemoryOffsets(const std::vector<MemoryPlanBuffer>& buffers,
+                         size_t alignment,
+                         std::vector<size_t>* offsets);
+
+// Static memory plan of the intermediate DenseTensors of a PirInterpreter
+// running in trace mode. The first run is recorded, which gives the lifetime
+// of every variable in the execution order and the variables that share a
+// holder (inplace and view kernels, or any kernel calling ShareDataWith).
+// The variables sharing a holder form one buffer, they are planned together
+// or not at all. Afterwards every buffer gets a fixed offset in one arena and
+// the holders are bound into the arena before each run, so the kernels find
+// their output already allocated and the gc leaves these variables alone.
+//
+// Only the variables the gc would free are planned, a buffer whose size
+// changes between runs is allocated by the kernel as usual.
+class StaticMemoryPlan {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  explicit StaticMemoryPlan(const phi::Place& place) : place_(place) {}
+
+  // called in the first run after each instruction, before its gc
+  void RecordInstruction(const InstructionBase& instr,
+                         const ValueExecutionInfo& value_exe_info);
+
+  // candidates[i] tells whether the i-th variable may be planned, a buffer
+  // is planned if all its variables are candidates
+  void Build(const std::vector<bool>& candidates);
+
+  bool IsBuilt() const { return is_built_; }
+
+  bool IsPlanned(size_t var_id) const {
+    return var_id < planned_.size() && planned_[var_id];
+  }
+
+  // binds the planned holders into the arena, called before each run
+  void Bind(const std::vector<Variable*>& var_list) const;
+
+  // drops the holders still pointing into the arena, called before another
+  // plan is bound or this one is destroyed
+  void Unbind(const std::vector<Variable*>& var_list) const;
+
+  size_t ArenaSize() const { return arena_ ? arena_->size() : 0; }
+  size_t PlannedBufferNum() const { return bindings_.size(); }
+  // the bytes of the planned buffers without sharing the arena
+  size_t PlannedBytes() const { return planned_bytes_; }
+
+ private:
+  struct VarInfo {
+    size_t first{static_cast<size_t>(-1)};
+    size_t last{0};
+    size_t bytes{0};
+    bool written{false};
+    bool on_place{true};
+  };
+
+  int Find(int var_id);
+  void Use(int var_id,
+           const std::vector<Variable*>& var_list,
+           bool is_output);
+
+  phi::Place place_;
+  size_t step_{0};
+  std::vector<VarInfo> vars_;
+  // union find over the variables sharing a holder
+  std::vector<int> parent_;
+  std::unordered_map<const phi::Allocation*, int> holder_owner_;
+
+  bool is_built_{false};
+  std::vector<bool> planned_;
+  std::shared_ptr<phi::Allocation> arena_;
+  size_t planned_bytes_{0};
+  // the first written variable of each buffer and its slot in the arena
+  std::vector<std::pair<int, std::shared_ptr<phi::Allocation>>> bindings_;
+};
+
+}  // namespace interpreter
+}  // namespace framework
+}  // namespace paddle
@@ -14,6 +14,7 @@
 
 #include "paddle/fluid/framework/new_executor/pir_interpreter.h"
 
+#include <algorithm>
 #include <chrono>
 #include <unordered_set>
 
@@ -21,6 +22,8 @@
 
 #include "paddle/fluid/framework/details/nan_inf_utils.h"
 #include "paddle/fluid/framework/details/share_tensor_buffer_functor.h"
+#include "paddle/fluid/framework/new_executor/executor_statistics.h"
+#include "paddle/fluid/framework/new_executor/interpreter/critical_path.h"
 #include "paddle/fluid/framework/new_executor/interpreter/interpreter_util.h"
 #include "paddle/fluid/framework/new_executor/interpreter/static_build.h"
 #include "paddle/fluid/framework/operator.h"
@@ -71,6 +74,7 @@
 #include "paddle/fluid/pir/dialect/operator/ir/control_flow_op.h"
 #include "paddle/fluid/pir/dialect/operator/ir/manual_op.h"
 #include "paddle/fluid/pir/dialect/operator/ir/manual_pylayer_op.h"
+#include "paddle/fluid/pir/dialect/operator/ir/pd_op.h"
 #include "paddle/fluid/pir/dialect/operator/utils/utils.h"
 #include "paddle/pir/include/core/builtin_attribute.h"
 #include "paddle/pir/include/dialect/control_flow/ir/cf_op.h"
@@ -85,6 +89,13 @@ COMMON_DECLARE_bool(dynamic_static_unified_comm);
 
 COMMON_DECLARE_bool(enable_pir_in_executor);
 COMMON_DECLARE_bool(enable_pir_in_executor_trace_run);
+COMMON_DECLARE_bool(enable_pir_static_memory_plan);
+COMMON_DECLARE_bool(enable_pir_frozen_trace_run);
+COMMON_DECLARE_string(pir_shape_bucket_policy);
+COMMON_DECLARE_int32(pir_shape_bucket_capacity);
+COMMON_DECLARE_bool(new_executor_work_stealing);
+COMMON_DECLARE_bool(new_executor_scheduler_stats);
+COMMON_DECLARE_string(new_executor_instruction_priority);
 COMMON_DECLARE_int32(low_precision_op_list);
 
 #define CREATE_INSTR(instr_name)                                   \
@@ -184,6 +195,11 @@ PirInterpreter::PirInterpreter(const platform::Place& place,
     SchedulingPriority rhs_scheduling_priority =
         vec_instruction_base_[rhs]->GetSchedulingPriority();
     if (lhs_scheduling_priority == rhs_scheduling_priority) {
+      if (!instruction_critical_path_.empty() &&
+          instruction_critical_path_[lhs] != instruction_critical_path_[rhs]) {
+        return instruction_critical_path_[lhs] <
+               instruction_critical_path_[rhs];
+      }
       return lhs > rhs;
     }
     return lhs_scheduling_priority > rhs_scheduling_priority;
@@ -275,6 +291,11 @@ PirInterpreter::PirInterpreter(
     SchedulingPriority rhs_scheduling_priority =
         vec_instruction_base_[rhs]->GetSchedulingPriority();
     if (lhs_scheduling_priority == rhs_scheduling_priority) {
+      if (!instruction_critical_path_.empty() &&
+          instruction_critical_path_[lhs] != instruction_critical_path_[rhs]) {
+        return instruction_critical_path_[lhs] <
+               instruction_critical_path_[rhs];
+      }
       return lhs > rhs;
     }
     return lhs_scheduling_priority > rhs_scheduling_priority;
@@ -412,7 +433,8 @@ std::shared_ptr<interpreter::AsyncWorkQueue> PirInterpreter::GetWorkQueue() {
     async_work_queue_ = std::make_shared<interpreter::AsyncWorkQueue>(
         execution_config_.host_num_threads,
         execution_config_.device_num_threads,
-        nullptr);
+        nullptr,
+        execution_config_.numa_node);
   }
   return async_work_queue_;
 }
@@ -765,6 +787,16 @@ void PirInterpreter::AnalyseExecuteOrderForTrace(
 
 void PirInterpreter::BuildInstruction() {
   VLOG(6) << "Build Instructions for pir ... ";
+  // the frozen traces refer to the instructions
+  frozen_trace_.reset();
+  if (shape_bucket_cache_) {
+    if (static_memory_plan_) {
+      static_memory_plan_->Unbind(value_exe_info_->GetVarList());
+      static_memory_plan_.reset();
+    }
+    shape_bucket_cache_->Clear();
+    has_shape_bucket_ = false;
+  }
   vec_instruction_base_.clear();
   size_t op_idx = 0;
   for (auto& op : *ir_block_) {
@@ -1041,9 +1073,39 @@ void PirInterpreter::BuildInstructionDependences() {
   }
   auto downstream_map = ir_dependency_builder_.Build(instructions_ptr);
 
+  PADDLE_ENFORCE_EQ(
+      FLAGS_new_executor_instruction_priority == "fifo" ||
+          FLAGS_new_executor_instruction_priority == "critical_path",
+      true,
+      platform::errors::InvalidArgument(
+          "FLAGS_new_executor_instruction_priority must be fifo or "
+          "critical_path, but received %s.",
+          FLAGS_new_executor_instruction_priority));
+  instruction_critical_path_.clear();
+  if (FLAGS_new_executor_instruction_priority == "critical_path") {
+    std::vector<int64_t> costs;
+    costs.reserve(instr_num);
+    for (auto& instr : vec_instruction_base_) {
+      costs.push_back(interpreter::EstimateInstructionCost(*instr));
+    }
+    instruction_critical_path_ =
+        interpreter::ComputeCriticalPathLength(downstream_map, costs);
+  }
+
   for (size_t instr_id = 0; instr_id < instr_num; ++instr_id) {
     InstructionBase* cur_instr = vec_instruction_base_[instr_id].get();
-    const std::set<size_t>& next_instr_ids = downstream_map[instr_id];
+    std::vector<size_t> next_instr_ids(downstream_map[instr_id].begin(),
+                                       downstream_map[instr_id].end());
+    if (!instruction_critical_path_.empty()) {
+      // the most critical successor is the one kept on this thread, the
+      // others are added to the queues most critical first
+      std::stable_sort(next_instr_ids.begin(),
+                       next_instr_ids.end(),
+                       [this](size_t lhs, size_t rhs) {
+                         return ir_instruction_scheduling_priority_less(rhs,
+                                                                        lhs);
+                       });
+    }
 
     if (FLAGS_new_executor_serial_run) {
       for (size_t next_instr_id : next_instr_ids) {
@@ -1247,6 +1309,9 @@ void PirInterpreter::CheckGC(InstructionBase* instr) {
     VLOG(4) << "GC:" << value_exe_info_->GetNameById(static_cast<int>(var_id))
             << ", id:" << var_id << ", ref:" << refs_[var_id]->DynamicRef();
     bool is_ready = refs_[var_id]->CheckAndDecrease();
+    if (static_memory_plan_ && static_memory_plan_->IsPlanned(var_id)) {
+      continue;
+    }
     // ignore all persistable var while GCphi
     if (parameter_var_names_.count(
             value_exe_info_->GetNameById(static_cast<int>(var_id)))) {
@@ -1596,11 +1661,170 @@ void PirInterpreter::TraceRunImpl() {
     gc_ = CreateInterpreterCoreGarbageCollector(place_, vec_instruction_base_);
   }
 
+  // the first run is recorded for the static memory plan, which also keeps
+  // the output buffers of the frozen trace
+  bool can_freeze = platform::is_cpu_place(place_) &&
+                    !execution_config_.used_for_control_flow_op;
+  if (!is_build_ && can_freeze && !FLAGS_pir_shape_bucket_policy.empty()) {
+    shape_bucket_cache_ = std::make_unique<
+        interpreter::ShapeBucketCache<ShapeBucketState>>(
+        interpreter::ShapeBucketPolicy::Parse(FLAGS_pir_shape_bucket_policy),
+        static_cast<size_t>(std::max(FLAGS_pir_shape_bucket_capacity, 1)));
+    shape_bucket_inputs_.clear();
+    for (auto& op : *ir_block_) {
+      if (!op.attributes().count("op_name")) {
+        continue;
+      }
+      std::string op_name = op.attributes()
+                                .at("op_name")
+                                .dyn_cast<pir::StrAttribute>()
+                                .AsString();
+      if (op_name == paddle::dialect::DataOp::name() ||
+          op_name == paddle::dialect::FeedOp::name()) {
+        std::string name =
+            op.attributes().at("name").dyn_cast<pir::StrAttribute>().AsString();
+        shape_bucket_inputs_.push_back(InnerScope()->FindVar(name));
+      }
+    }
+  }
+  if (shape_bucket_cache_) {
+    SwitchShapeBucket();
+  } else if (!is_build_ && can_freeze &&
+             (FLAGS_enable_pir_static_memory_plan ||
+              FLAGS_enable_pir_frozen_trace_run)) {
+    static_memory_plan_ =
+        std::make_unique<interpreter::StaticMemoryPlan>(place_);
+  }
+  if (static_memory_plan_ && static_memory_plan_->IsBuilt()) {
+    static_memory_plan_->Bind(value_exe_info_->GetVarList());
+  }
+
   interpreter::ResetAtomicGuard guard(&deps_, &refs_);
   VLOG(4) << "Tracing Instruction List";
 
-  TraceRunInstructionList(vec_instruction_base_);
+  {
+    GarbageFlushGuard flush_guard(gc_.get());
+    if (frozen_trace_ && CanRunFrozenTrace()) {
+      FrozenTraceRunInstructionList();
+    } else {
+      TraceRunInstructionList(vec_instruction_base_);
+    }
+  }
   VLOG(4) << "Done TraceRunInstructionList";
+
+  if (static_memory_plan_ && !static_memory_plan_->IsBuilt()) {
+    BuildStaticMemoryPlan();
+  }
+
+  // the first run (of each shape bucket) is the warm-up of the frozen trace
+  if (!frozen_trace_ && can_freeze &&
+      (FLAGS_enable_pir_frozen_trace_run || shape_bucket_cache_)) {
+    std::vector<InstructionBase*> instrs;
+    instrs.reserve(trace_execute_order_.size());
+    for (size_t instr_id : trace_execute_order_) {
+      InstructionBase* instr = vec_instruction_base_.at(instr_id).get();
+      if (!instr->IsArtificial()) {
+        instrs.push_back(instr);
+      }
+    }
+    frozen_trace_ = std::make_unique<interpreter::FrozenTrace>(instrs);
+  }
+}
+
+void PirInterpreter::SwitchShapeBucket() {
+  interpreter::MakeShapeBucketKey(shape_bucket_inputs_,
+                                  shape_bucket_cache_->Policy(),
+                                  &next_shape_bucket_key_);
+  if (has_shape_bucket_ && next_shape_bucket_key_ == shape_bucket_key_) {
+    return;
+  }
+  // the state of the last bucket goes back into the cache, its holders are
+  // unbound first since its arena may be freed on eviction
+  if (has_shape_bucket_) {
+    if (static_memory_plan_) {
+      static_memory_plan_->Unbind(value_exe_info_->GetVarList());
+    }
+    ShapeBucketState* last = shape_bucket_cache_->Find(shape_bucket_key_);
+    if (last != nullptr) {
+      last->static_memory_plan = std::move(static_memory_plan_);
+      last->frozen_trace = std::move(frozen_trace_);
+    }
+    static_memory_plan_.reset();
+    frozen_trace_.reset();
+  }
+  ShapeBucketState* state = shape_bucket_cache_->Get(next_shape_bucket_key_);
+  static_memory_plan_ = std::move(state->static_memory_plan);
+  frozen_trace_ = std::move(state->frozen_trace);
+  if (!static_memory_plan_) {
+    static_memory_plan_ =
+        std::make_unique<interpreter::StaticMemoryPlan>(place_);
+  }
+  shape_bucket_key_.swap(next_shape_bucket_key_);
+  has_shape_bucket_ = true;
+  VLOG(4) << "Switch to shape bucket " << shape_bucket_cache_->Size() << "/"
+          << shape_bucket_cache_->Capacity()
+          << ", hits: " << shape_bucket_cache_->Hits()
+          << ", misses: " << shape_bucket_cache_->Misses()
+          << ", evictions: " << shape_bucket_cache_->Evictions();
+}
+
+bool PirInterpreter::CanRunFrozenTrace() const {
+  // the frozen steps skip the per instruction checks and hooks
+  return !FLAGS_check_nan_inf && !FLAGS_benchmark &&
+         !FLAGS_low_precision_op_list && !enable_job_schedule_profiler_ &&
+         !(execution_config_.used_for_inference &&
+           (!pir_input_hookfuncs_.empty() || !pir_output_hookfuncs_.empty()));
+}
+
+void PirInterpreter::FrozenTraceRunInstructionList() {
+  platform::RecordEvent record_event(
+      "FrozenTraceRunInstructionList",
+      platform::TracerEventType::UserDefined,
+      1);
+  size_t idx = 0;
+  try {
+    for (; idx < frozen_trace_->size(); ++idx) {
+      frozen_trace_->Run(idx);
+      CheckGC(frozen_trace_->Instruction(idx));
+    }
+  } catch (platform::EnforceNotMet& ex) {
+    auto* op = frozen_trace_->Instruction(idx)->Operation();
+    const std::vector<std::string> op_callstack_attr =
+        interpreter::GetInstructionCallStack(op->name(), op->attributes());
+    framework::InsertCallStackInfo(op->name(), op_callstack_attr, &ex);
+    LOG(WARNING) << " OP id:" << frozen_trace_->Instruction(idx)->Id() << " "
+                 << frozen_trace_->Instruction(idx)->Name()
+                 << " raises an EnforceNotMet exception "
+                 << platform::demangle(typeid(ex).name());
+    throw;
+  }
+  VLOG(4) << "Done FrozenTraceRunInstructionList";
+}
+
+void PirInterpreter::BuildStaticMemoryPlan() {
+  // only the variables freed by the gc are planned, the others outlive the
+  // run. The shapes must be fully known so that the buffer sizes of the
+  // first run hold for all runs, unless the plan is the one of a shape
+  // bucket. A kernel then allocates itself the tensors grown past the sizes
+  // of the first run in the bucket.
+  std::vector<bool> candidates(var_ref_count_.size());
+  for (size_t i = 0; i < var_ref_count_.size(); ++i) {
+    candidates[i] = var_ref_count_[i] > 0;
+  }
+  for (auto& item : value_exe_info_->GetValue2VarName()) {
+    int var_id = value_exe_info_->GetIdByName(item.second);
+    if (var_id < 0 || static_cast<size_t>(var_id) >= candidates.size()) {
+      continue;
+    }
+    auto type =
+        item.first.type().dyn_cast<paddle::dialect::AllocatedDenseTensorType>();
+    if (!type ||
+        (!shape_bucket_cache_ && common::contain_unknown_dim(type.dims())) ||
+        parameter_var_names_.count(item.second)) {
+      candidates[var_id] = false;
+    }
+  }
+  static_memory_plan_->Build(candidates);
 }
 
 void PirInterpreter::MultiThreadRunImpl() {
@@ -1610,6 +1834,7 @@ void PirInterpreter::MultiThreadRunImpl() {
   }
 
   interpreter::ResetAtomicGuard guard(&deps_, &refs_);
+  GarbageFlushGuard flush_guard(gc_.get());
   VLOG(4) << "Multi Thread Run Instruction List";
 
   async_work_queue_ = GetWorkQueue();
@@ -1698,18 +1923,40 @@ void PirInterpreter::MultiThreadRunInstructionList(
     }
   }
 
+  bool work_stealing =
+      FLAGS_new_executor_work_stealing && !FLAGS_new_executor_serial_run;
+  std::vector<size_t> root_ids;
   for (size_t i = 0; i < dependency_count_->size(); ++i) {
     if ((*dependency_count_)[i] == 0) {
-      // NOTE(zhiqiu): hot fix for jit input var
-      RecordMemcpyD2H(vec_instr.at(i).get());
-      if (FLAGS_new_executor_serial_run) {
-        RunInstructionBaseAsync(i);
-      } else {
-        async_work_queue_->AddTask(vec_instr.at(i)->KernelType(),
-                                   [this, i] { RunInstructionBaseAsync(i); });
-      }
+      root_ids.push_back(i);
+    }
+  }
+  if (!instruction_critical_path_.empty()) {
+    std::stable_sort(
+        root_ids.begin(), root_ids.end(), [this](size_t lhs, size_t rhs) {
+          return ir_instruction_scheduling_priority_less(rhs, lhs);
+        });
+  }
+  std::vector<std::function<void()>> host_tasks;
+  std::vector<std::function<void()>> device_tasks;
+  for (size_t i : root_ids) {
+    // NOTE(zhiqiu): hot fix for jit input var
+    RecordMemcpyD2H(vec_instr.at(i).get());
+    if (FLAGS_new_executor_serial_run) {
+      RunInstructionBaseAsync(i);
+    } else if (work_stealing) {
+      auto& tasks = vec_instr.at(i)->KernelType() == OpFuncType::kGpuAsync
+                        ? device_tasks
+                        : host_tasks;
+      tasks.emplace_back([this, i] { RunInstructionBaseAsync(i); });
+    } else {
+      async_work_queue_->AddTask(vec_instr.at(i)->KernelType(),
+                                 [this, i] { RunInstructionBaseAsync(i); });
     }
   }
+  // the roots are spread over the host threads at once
+  async_work_queue_->AddTasks(OpFuncType::kCpuSync, &host_tasks);
+  async_work_queue_->AddTasks(OpFuncType::kGpuAsync, &device_tasks);
 
   // For debug hang in main_thread_blocker_.WaitEvent(),
   // launch async task to log deps every
@@ -1750,6 +1997,14 @@ void PirInterpreter::MultiThreadRunInstructionList(
     VLOG(1) << "Logged deps for " << logged_times.get() << " times";
   }
 
+  if (FLAGS_new_executor_scheduler_stats) {
+    SchedulerStats scheduler_stats =
+        async_work_queue_->GetStatsSinceLastCall();
+    AddSchedulerStatistics(scheduler_stats);
+    VLOG(4) << "Scheduler statistics of this run: "
+            << scheduler_stats.ToString();
+  }
+
   if (UNLIKELY(exception_holder_.IsCaught())) {
     VLOG(1) << "Exception caught " << exception_holder_.Type();
     // Graceful exit when the executor encountered a fatal error.
@@ -1814,6 +2069,53 @@ void PirInterpreter::RunNextInstructions(InstructionBase* instr,
     return deps_[next_id]->CheckAndDecrease();
   };
 
+  if (FLAGS_new_executor_work_stealing && !FLAGS_new_executor_serial_run &&
+      instr->KernelType() != OpFuncType::kGpuAsync) {
+    // Continuation stealing: of the ready successors running on the host
+    // threads, the one with the highest priority runs next on this thread,
+    // whose cache still holds the inputs, no matter which one the dependency
+    // analysis chose. The others go onto the queue of this thread at once,
+    // where the idle threads steal them.
+    std::vector<size_t> ready_host_instrs;
+    auto Schedule = [&](size_t next_instr_id) {
+      if (!IsReady(next_instr_id)) {
+        return;
+      }
+      if (vec_instruction_base_[next_instr_id]->KernelType() ==
+          OpFuncType::kGpuAsync) {
+        async_work_queue_->AddTask(OpFuncType::kGpuAsync,
+                                   [this, next_instr_id]() {
+                                     RunInstructionBaseAsync(next_instr_id);
+                                   });
+      } else {
+        ready_host_instrs.push_back(next_instr_id);
+      }
+    };
+    for (size_t next_instr_id : instr->NextInstrsInSameThread()) {
+      Schedule(next_instr_id);
+    }
+    for (size_t next_instr_id : instr->NextInstrsInDifferenceThread()) {
+      Schedule(next_instr_id);
+    }
+    if (ready_host_instrs.empty()) {
+      return;
+    }
+    auto continuation =
+        std::max_element(ready_host_instrs.begin(),
+                         ready_host_instrs.end(),
+                         ir_instruction_scheduling_priority_less);
+    reserved_next_ops->push(*continuation);
+    ready_host_instrs.erase(continuation);
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(ready_host_instrs.size());
+    for (size_t next_instr_id : ready_host_instrs) {
+      tasks.emplace_back(
+          [this, next_instr_id]() { RunInstructionBaseAsync(next_instr_id); });
+    }
+    async_work_queue_->AddTasks(instr->KernelType(), &tasks);
+    return;
+  }
+
   for (size_t next_instr_id : instr->NextInstrsInDifferenceThread()) {
     if (IsReady(next_instr_id)) {
       async_work_queue_->AddTask(
@@ -1893,6 +2195,10 @@ void PirInterpreter::RunInstructionBase(InstructionBase* instr_node) {
               << " runs on " << platform::GetCurrentThreadName() << "\n"
               << "After: " << cur_place << " "
               << instr_node->DebugStringEx(scope_, value_exe_info_.get());
+      if (static_memory_plan_ && !static_memory_plan_->IsBuilt()) {
+        static_memory_plan_->RecordInstruction(*instr_node,
+                                               *value_exe_info_);
+      }
       CheckGC(instr_node);
       VLOG(4) << "done CheckGC";
       memory::LogDeviceMemoryStats(cur_place, instr_node->Name());
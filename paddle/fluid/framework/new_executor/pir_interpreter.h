@@ -15,6 +15,9 @@
 #pragma once
 #include <memory>
 #include "paddle/fluid/framework/new_executor/instruction/instruction_base.h"
+#include "paddle/fluid/framework/new_executor/interpreter/frozen_trace.h"
+#include "paddle/fluid/framework/new_executor/interpreter/shape_bucket_cache.h"
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
 #include "paddle/fluid/framework/new_executor/interpreter_base_impl.h"
 #include "paddle/pir/include/core/value.h"
 
@@ -113,6 +116,37 @@ class PirInterpreter : public InterpreterBaseImpl {
   // Only for debug
   Variable* DebugVar(const std::string& name) const override;
 
+  // the static memory plan of the last run, nullptr if there is none
+  const interpreter::StaticMemoryPlan* GetStaticMemoryPlan() const {
+    return static_memory_plan_.get();
+  }
+
+  // the frozen trace of the last run, nullptr if there is none
+  const interpreter::FrozenTrace* GetFrozenTrace() const {
+    return frozen_trace_.get();
+  }
+
+  // the ids of the instructions in the order the trace run takes them
+  const std::vector<size_t>& GetTraceExecuteOrder() const {
+    return trace_execute_order_;
+  }
+
+  const InstructionBase& GetInstruction(size_t id) const {
+    return *vec_instruction_base_.at(id);
+  }
+
+  // what is kept for each shape bucket besides the one being run
+  struct ShapeBucketState {
+    std::unique_ptr<interpreter::StaticMemoryPlan> static_memory_plan;
+    std::unique_ptr<interpreter::FrozenTrace> frozen_trace;
+  };
+
+  // nullptr if FLAGS_pir_shape_bucket_policy is not set
+  const interpreter::ShapeBucketCache<ShapeBucketState>* GetShapeBucketCache()
+      const {
+    return shape_bucket_cache_.get();
+  }
+
   std::unordered_map<std::string, std::shared_ptr<EventInter>>*
   GetForceEventsToWaitInfo() {
     return force_events_to_wait_;
@@ -187,6 +221,23 @@ class PirInterpreter : public InterpreterBaseImpl {
 
   std::unique_ptr<InterpreterCoreGarbageCollector> gc_;
 
+  // built after the first trace run if FLAGS_enable_pir_static_memory_plan
+  std::unique_ptr<interpreter::StaticMemoryPlan> static_memory_plan_;
+
+  // built after the first trace run if FLAGS_enable_pir_frozen_trace_run
+  std::unique_ptr<interpreter::FrozenTrace> frozen_trace_;
+
+  // built at the first trace run if FLAGS_pir_shape_bucket_policy is set. The
+  // state of the bucket being run is moved out into static_memory_plan_ and
+  // frozen_trace_, and back when another bucket is run.
+  std::unique_ptr<interpreter::ShapeBucketCache<ShapeBucketState>>
+      shape_bucket_cache_;
+  // the variables of the data and feed ops
+  std::vector<Variable*> shape_bucket_inputs_;
+  interpreter::ShapeBucketKey shape_bucket_key_;
+  interpreter::ShapeBucketKey next_shape_bucket_key_;
+  bool has_shape_bucket_{false};
+
   // last_live_ops_[i] contains the id of operators that last access the i-th
   // var
   std::map<size_t, std::set<size_t>> last_live_ops_;
@@ -229,6 +280,10 @@ class PirInterpreter : public InterpreterBaseImpl {
   void TraceRunInstructionList(
       const std::vector<std::unique_ptr<InstructionBase>>& vec_instr);
 
+  bool CanRunFrozenTrace() const;
+
+  void FrozenTraceRunInstructionList();
+
   void MultiThreadRunImpl();
 
   void MultiThreadRunInstructionList(
@@ -247,6 +302,10 @@ class PirInterpreter : public InterpreterBaseImpl {
 
   void CheckGC(InstructionBase* instr);
 
+  void BuildStaticMemoryPlan();
+
+  void SwitchShapeBucket();
+
   void RecordStreamForGC(InstructionBase* instr);
 
   void SolvePersistableVarNames();
@@ -257,6 +316,10 @@ class PirInterpreter : public InterpreterBaseImpl {
 
   InstructionSchedulingPriorityLess ir_instruction_scheduling_priority_less;
 
+  // the critical path length of each instruction, only filled when
+  // FLAGS_new_executor_instruction_priority is critical_path
+  std::vector<int64_t> instruction_critical_path_;
+
   const ::pir::Block* ir_block_{nullptr};
 
   std::unordered_map<::pir::Block*, PirInterpreter*> sub_blocks_;  // Not owned
@@ -146,6 +146,7 @@ void ProgramInterpreter::RunImpl() {
   }
 
   interpreter::ResetAtomicGuard guard(&deps_, &refs_);
+  GarbageFlushGuard flush_guard(gc_.get());
 
   if (is_in_op_profiling_mode_ || execution_config_.used_for_inference ||
       ((execution_config_.used_for_jit || execution_config_.used_for_cinn) &&
@@ -410,7 +411,8 @@ ProgramInterpreter::GetWorkQueue() {
     async_work_queue_ = std::make_shared<interpreter::AsyncWorkQueue>(
         execution_config_.host_num_threads,
         execution_config_.device_num_threads,
-        nullptr);
+        nullptr,
+        execution_config_.numa_node);
   }
   return async_work_queue_;
 }
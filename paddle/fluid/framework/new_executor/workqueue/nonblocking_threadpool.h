@@ -9,7 +9,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <vector>
 
@@ -17,8 +19,10 @@
 #include "paddle/fluid/framework/new_executor/workqueue/event_count.h"
 #include "paddle/fluid/framework/new_executor/workqueue/run_queue.h"
 #include "paddle/fluid/framework/new_executor/workqueue/thread_environment.h"
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 #include "paddle/fluid/platform/os_info.h"
 #include "paddle/fluid/platform/profiler/event_tracing.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
 
 namespace paddle {
 namespace framework {
@@ -33,12 +37,19 @@ class ThreadPoolTempl {
                   int num_threads,
                   bool allow_spinning,
                   bool always_spinning,
+                  bool work_stealing = false,
+                  int numa_node = -1,
+                  bool collect_stats = false,
                   Environment env = Environment())
       : env_(env),
         allow_spinning_(allow_spinning),
         always_spinning_(always_spinning),
+        work_stealing_(work_stealing),
+        numa_node_(numa_node),
+        collect_stats_(collect_stats),
         global_steal_partition_(EncodePartition(0, num_threads)),
         blocked_(0),
+        spinning_(0),
         done_(false),
         cancelled_(false),
         ec_(num_threads),
@@ -110,8 +121,9 @@ class ThreadPoolTempl {
     PerThread* pt = GetPerThread();
     if (pt->pool == this) {
       // Worker thread of this pool, push onto the thread's queue.
-      Queue& q = thread_data_[pt->thread_id].queue;
-      t = q.PushFront(std::move(t));
+      ThreadData& td = thread_data_[pt->thread_id];
+      t = td.queue.PushFront(std::move(t));
+      RecordPush(&td);
     } else {
       // A free-standing thread (or worker of another pool), push onto a random
       // queue.
@@ -120,8 +132,9 @@ class ThreadPoolTempl {
       int num_queues = limit - start;
       int rnd = Rand(&pt->rand) % num_queues;
       assert(start + rnd < limit);
-      Queue& q = thread_data_[start + rnd].queue;
-      t = q.PushBack(std::move(t));
+      ThreadData& td = thread_data_[start + rnd];
+      t = td.queue.PushBack(std::move(t));
+      RecordPush(&td);
     }
 
     // Note: below we touch this after making w available to worker threads.
@@ -134,12 +147,45 @@ class ThreadPoolTempl {
     if (!t.f) {
       // Allow 'false positive' which makes a redundant notification.
       VLOG(6) << "Add task, Notify";
-      ec_.Notify(false);
+      NotifyForNewTasks(1);
     } else {
       env_.ExecuteTask(t);  // Push failed, execute directly.
     }
   }
 
+  // Adds a batch of tasks with at most one notification per task. A worker
+  // thread of this pool pushes them onto its own queue, where the other
+  // threads steal them from the back, a free-standing thread spreads them
+  // over the queues.
+  void AddTasks(std::vector<std::function<void()>>* fns) {
+    PerThread* pt = GetPerThread();
+    unsigned rnd = pt->pool == this ? 0 : Rand(&pt->rand) % num_threads_;
+    unsigned num_pushed = 0;
+    std::vector<Task> rejected;
+    for (size_t i = 0; i < fns->size(); ++i) {
+      Task t = env_.CreateTask(std::move((*fns)[i]));
+      ThreadData& td = pt->pool == this
+                           ? thread_data_[pt->thread_id]
+                           : thread_data_[(rnd + i) % num_threads_];
+      t = pt->pool == this ? td.queue.PushFront(std::move(t))
+                           : td.queue.PushBack(std::move(t));
+      if (t.f) {
+        rejected.emplace_back(std::move(t));
+      } else {
+        RecordPush(&td);
+        ++num_pushed;
+      }
+    }
+    fns->clear();
+    if (num_pushed > 0) {
+      NotifyForNewTasks(num_pushed);
+    }
+    // The queues are full, execute directly after waking the others up.
+    for (auto& t : rejected) {
+      env_.ExecuteTask(t);
+    }
+  }
+
   void Cancel() {
     cancelled_ = true;
     done_ = true;
@@ -165,6 +211,32 @@ class ThreadPoolTempl {
     }
   }
 
+  // The counters are read without synchronization, the result is a best
+  // effort snapshot.
+  SchedulerStats GetStats() const {
+    SchedulerStats stats;
+    auto accumulate = [&stats](const ThreadStats& ts) {
+      stats.num_tasks += ts.num_tasks.load(std::memory_order_relaxed);
+      stats.num_steals += ts.num_steals.load(std::memory_order_relaxed);
+      stats.num_wakeups += ts.num_wakeups.load(std::memory_order_relaxed);
+      stats.num_skipped_wakeups +=
+          ts.num_skipped_wakeups.load(std::memory_order_relaxed);
+      stats.num_parks += ts.num_parks.load(std::memory_order_relaxed);
+      stats.idle_ns += ts.idle_ns.load(std::memory_order_relaxed);
+      stats.num_pushes += ts.num_pushes.load(std::memory_order_relaxed);
+      stats.total_queue_depth +=
+          ts.total_queue_depth.load(std::memory_order_relaxed);
+      stats.max_queue_depth =
+          std::max(stats.max_queue_depth,
+                   ts.max_queue_depth.load(std::memory_order_relaxed));
+    };
+    for (const auto& td : thread_data_) {
+      accumulate(td.stats);
+    }
+    accumulate(external_stats_);
+    return stats;
+  }
+
  private:
   // Create a single atomic<int> that encodes start and limit information for
   // each thread.
@@ -225,36 +297,124 @@ class ThreadPoolTempl {
     int thread_id;          // Worker thread index in pool.
   };
 
+  // Scheduler statistics of a worker thread. The push counters are updated
+  // by the threads pushing onto its queue, the wakeup counters by the worker
+  // itself when it adds tasks, all others by the worker itself.
+  struct ThreadStats {
+    std::atomic<uint64_t> num_tasks{0};
+    std::atomic<uint64_t> num_steals{0};
+    std::atomic<uint64_t> num_wakeups{0};
+    std::atomic<uint64_t> num_skipped_wakeups{0};
+    std::atomic<uint64_t> num_parks{0};
+    std::atomic<uint64_t> idle_ns{0};
+    std::atomic<uint64_t> num_pushes{0};
+    std::atomic<uint64_t> total_queue_depth{0};
+    std::atomic<uint64_t> max_queue_depth{0};
+  };
+
   struct ThreadData {
-    constexpr ThreadData() : thread(), steal_partition(0), queue() {}
+    constexpr ThreadData() : thread(), steal_partition(0), queue(), stats() {}
     std::unique_ptr<Thread> thread;
     std::atomic<unsigned> steal_partition;
     Queue queue;
+    ThreadStats stats;
   };
 
   Environment env_;
   const bool allow_spinning_;
   const bool always_spinning_;
+  // Wake up parked threads only for the tasks the spinning threads can not
+  // take, see NotifyForNewTasks.
+  const bool work_stealing_;
+  // The NUMA node the worker threads are pinned to, -1 for none.
+  const int numa_node_;
+  // Whether the ThreadStats are counted, see WorkQueueOptions.
+  const bool collect_stats_;
   std::vector<std::vector<unsigned>> all_coprimes_;
   unsigned global_steal_partition_;
   std::atomic<unsigned> blocked_;
+  // Number of threads looking for work in the steal loop.
+  std::atomic<unsigned> spinning_;
   std::atomic<bool> done_;
   std::atomic<bool> cancelled_;
   EventCount ec_;
   const int num_threads_;
   std::vector<ThreadData> thread_data_;
+  // Wakeups issued by free-standing threads.
+  ThreadStats external_stats_;
   std::string name_;
 
+  static inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  inline ThreadStats* StatsOfCurrentThread() {
+    PerThread* pt = GetPerThread();
+    return pt->pool == this ? &thread_data_[pt->thread_id].stats
+                            : &external_stats_;
+  }
+
+  // Samples the depth of a queue right after a push.
+  inline void RecordPush(ThreadData* td) {
+    if (!collect_stats_) {
+      return;
+    }
+    uint64_t depth = td->queue.Size();
+    ThreadStats& ts = td->stats;
+    ts.num_pushes.fetch_add(1, std::memory_order_relaxed);
+    ts.total_queue_depth.fetch_add(depth, std::memory_order_relaxed);
+    uint64_t max_depth = ts.max_queue_depth.load(std::memory_order_relaxed);
+    while (depth > max_depth &&
+           !ts.max_queue_depth.compare_exchange_weak(
+               max_depth, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Wakes up parked threads for num_tasks new tasks. In work stealing mode a
+  // worker adding tasks to its own queue only wakes up threads for the tasks
+  // exceeding the number of threads in the steal loop, which take them by
+  // themselves. Concurrent adders may count on the same spinning thread, a
+  // task is delayed then but never lost, the adder runs it at the latest
+  // when it is back to its own queue.
+  void NotifyForNewTasks(unsigned num_tasks) {
+    ThreadStats* ts = collect_stats_ ? StatsOfCurrentThread() : nullptr;
+    unsigned num_notify = num_tasks;
+    if (work_stealing_ && GetPerThread()->pool == this) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      unsigned spinning = spinning_.load(std::memory_order_relaxed);
+      num_notify = num_tasks > spinning ? num_tasks - spinning : 0;
+      num_notify = std::min(num_notify, static_cast<unsigned>(num_threads_));
+      if (collect_stats_) {
+        ts->num_skipped_wakeups.fetch_add(num_tasks - num_notify,
+                                          std::memory_order_relaxed);
+      }
+    }
+    for (unsigned i = 0; i < num_notify; ++i) {
+      ec_.Notify(false);
+    }
+    if (collect_stats_) {
+      ts->num_wakeups.fetch_add(num_notify, std::memory_order_relaxed);
+    }
+  }
+
   // Main worker thread loop.
   void WorkerLoop(int thread_id) {
     std::string thr_name = name_ + "_thread_" + std::to_string(thread_id);
     VLOG(1) << thr_name << " started ";
     platform::SetCurrentThreadName(thr_name);
+    if (numa_node_ >= 0 &&
+        !phi::backends::cpu::BindCurrentThreadToNumaNode(numa_node_)) {
+      LOG(WARNING) << thr_name << " failed to bind to NUMA node "
+                   << numa_node_;
+    }
     PerThread* pt = GetPerThread();
     pt->pool = this;
     pt->rand = GlobalThreadIdHash();
     pt->thread_id = thread_id;
     Queue& q = thread_data_[thread_id].queue;
+    ThreadStats& ts = thread_data_[thread_id].stats;
     EventCount::Waiter* waiter = ec_.GetWaiter(thread_id);
     // TODO(dvyukov,rmlarsen): The time spent in NonEmptyQueueIndex() is
     // proportional to num_threads_ and we assume that new work is scheduled at
@@ -271,36 +431,53 @@ class ThreadPoolTempl {
       // pools tend to be used for.
       while (!cancelled_) {
         Task t = q.PopFront();
-        for (int i = 0; i < spin_count && !t.f; i++) {
-          if (!cancelled_.load(std::memory_order_relaxed)) {
-            t = q.PopFront();
+        uint64_t idle_start = 0;
+        if (!t.f) {
+          idle_start = collect_stats_ ? NowNs() : 0;
+          spinning_.fetch_add(1, std::memory_order_seq_cst);
+          for (int i = 0; i < spin_count && !t.f; i++) {
+            if (!cancelled_.load(std::memory_order_relaxed)) {
+              t = q.PopFront();
+            }
           }
+          spinning_.fetch_sub(1, std::memory_order_seq_cst);
         }
         if (!t.f) {
           if (!WaitForWork(waiter, &t)) {
             return;
           }
         }
+        if (idle_start != 0) {
+          ts.idle_ns.fetch_add(NowNs() - idle_start, std::memory_order_relaxed);
+        }
         if (t.f) {
+          if (collect_stats_) {
+            ts.num_tasks.fetch_add(1, std::memory_order_relaxed);
+          }
           env_.ExecuteTask(t);
         }
       }
     } else {
       while (!cancelled_) {
         Task t = q.PopFront();
+        uint64_t idle_start = 0;
         if (!t.f) {
+          idle_start = collect_stats_ ? NowNs() : 0;
           t = LocalSteal();
           if (!t.f) {
             t = GlobalSteal();
             if (!t.f) {
               if (allow_spinning_) {
+                spinning_.fetch_add(1, std::memory_order_seq_cst);
                 for (int i = 0; i < spin_count && !t.f; i++) {
                   if (!cancelled_.load(std::memory_order_relaxed)) {
                     t = GlobalSteal();
                   } else {
+                    spinning_.fetch_sub(1, std::memory_order_seq_cst);
                     return;
                   }
                 }
+                spinning_.fetch_sub(1, std::memory_order_seq_cst);
               }
               if (!t.f) {
                 if (!WaitForWork(waiter, &t)) {
@@ -309,8 +486,18 @@ class ThreadPoolTempl {
               }
             }
           }
+          if (collect_stats_) {
+            ts.idle_ns.fetch_add(NowNs() - idle_start,
+                                 std::memory_order_relaxed);
+            if (t.f) {
+              ts.num_steals.fetch_add(1, std::memory_order_relaxed);
+            }
+          }
         }
         if (t.f) {
+          if (collect_stats_) {
+            ts.num_tasks.fetch_add(1, std::memory_order_relaxed);
+          }
           env_.ExecuteTask(t);
         }
       }
@@ -423,6 +610,10 @@ class ThreadPoolTempl {
     // Wait for work
     platform::RecordEvent record(
         "WaitForWork", platform::TracerEventType::UserDefined, 10);
+    if (collect_stats_) {
+      StatsOfCurrentThread()->num_parks.fetch_add(1,
+                                                  std::memory_order_relaxed);
+    }
     ec_.CommitWait(waiter);
     blocked_--;
     return true;
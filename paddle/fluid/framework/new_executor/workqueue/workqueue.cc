@@ -50,7 +50,10 @@ class WorkQueueImpl : public WorkQueue {
     queue_ = new NonblockingThreadPool(options_.name,
                                        static_cast<int>(options_.num_threads),
                                        options_.allow_spinning,
-                                       options_.always_spinning);
+                                       options_.always_spinning,
+                                       options_.work_stealing,
+                                       options_.numa_node,
+                                       options_.collect_stats);
   }
 
   ~WorkQueueImpl() override {
@@ -82,6 +85,8 @@ class WorkQueueImpl : public WorkQueue {
 
   size_t NumThreads() const override { return queue_->NumThreads(); }
 
+  SchedulerStats GetStats() const override { return queue_->GetStats(); }
+
  private:
   NonblockingThreadPool* queue_{nullptr};
   TaskTracker* tracker_{nullptr};
@@ -98,10 +103,15 @@ class WorkQueueGroupImpl : public WorkQueueGroup {
 
   void AddTask(size_t queue_idx, std::function<void()> fn) override;
 
+  void AddTasks(size_t queue_idx,
+                std::vector<std::function<void()>>* fns) override;
+
   size_t QueueNumThreads(size_t queue_idx) const override;
 
   size_t QueueGroupNumThreads() const override;
 
+  SchedulerStats QueueStats(size_t queue_idx) const override;
+
   void Cancel() override;
 
  private:
@@ -143,7 +153,10 @@ WorkQueueGroupImpl::WorkQueueGroupImpl(
         NonblockingThreadPool(options.name,
                               static_cast<int>(options.num_threads),
                               options.allow_spinning,
-                              options.always_spinning);
+                              options.always_spinning,
+                              options.work_stealing,
+                              options.numa_node,
+                              options.collect_stats);
   }
 }
 
@@ -179,6 +192,25 @@ void WorkQueueGroupImpl::AddTask(size_t queue_idx, std::function<void()> fn) {
   queues_[queue_idx]->AddTask(std::move(fn));
 }
 
+void WorkQueueGroupImpl::AddTasks(size_t queue_idx,
+                                  std::vector<std::function<void()>>* fns) {
+  platform::RecordEvent record("WorkQueue::AddTask",
+                               platform::TracerEventType::UserDefined,
+                               10 /*level*/);
+  assert(queue_idx < queues_.size());
+  PADDLE_ENFORCE_NOT_NULL(
+      queues_.at(queue_idx),
+      platform::errors::NotFound("Workqueue of index %d is not initialized.",
+                                 queue_idx));
+  if (queues_options_.at(queue_idx).track_task) {
+    for (auto& fn : *fns) {
+      fn = [task = std::move(fn),
+            raii = CounterGuard<TaskTracker>(tracker_)]() mutable { task(); };
+    }
+  }
+  queues_[queue_idx]->AddTasks(fns);
+}
+
 size_t WorkQueueGroupImpl::QueueNumThreads(size_t queue_idx) const {
   assert(queue_idx < queues_.size());
   if (!queues_.at(queue_idx)) {
@@ -195,6 +227,14 @@ size_t WorkQueueGroupImpl::QueueGroupNumThreads() const {
   return total_num;
 }
 
+SchedulerStats WorkQueueGroupImpl::QueueStats(size_t queue_idx) const {
+  assert(queue_idx < queues_.size());
+  if (!queues_.at(queue_idx)) {
+    return SchedulerStats();
+  }
+  return queues_.at(queue_idx)->GetStats();
+}
+
 void WorkQueueGroupImpl::Cancel() {
   for (auto queue : queues_) {
     if (queue) {
@@ -21,6 +21,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 #include "paddle/fluid/platform/enforce.h"
 
 namespace paddle {
@@ -93,6 +94,16 @@ struct WorkQueueOptions {
   // Worker threads will never sleep if this flag is set.
   // Better performance vs. higher CPU utilization.
   bool always_spinning{false};
+  // A worker thread adding tasks only wakes up parked threads for the tasks
+  // the spinning threads can not take.
+  bool work_stealing{false};
+  // Worker threads are pinned to the cpus of this NUMA node and allocate
+  // from its memory, see phi::backends::cpu::BindCurrentThreadToNumaNode.
+  // -1 means no pinning.
+  int numa_node{-1};
+  // Worker threads keep the counters of SchedulerStats, which costs a few
+  // atomic updates and clock reads per task. Without it QueueStats is empty.
+  bool collect_stats{false};
   // If you need to blocking the calling  thread to wait "queue empty", set
   // track_task = true and set events_waiter. EventsWaiter::WaitEvent will
   // block the calling thread until any of events (including "queue empty")
@@ -136,6 +147,8 @@ class WorkQueue {
 
   virtual size_t NumThreads() const = 0;
 
+  virtual SchedulerStats GetStats() const = 0;
+
   virtual void Cancel() = 0;
 
  protected:
@@ -155,6 +168,10 @@ class WorkQueueGroup {
 
   virtual void AddTask(size_t queue_idx, std::function<void()> fn) = 0;
 
+  // Adds the tasks at once, fns is cleared
+  virtual void AddTasks(size_t queue_idx,
+                        std::vector<std::function<void()>>* fns) = 0;
+
   // Higher cost than AddTask
   template <typename F, typename... Args>
   std::future<typename std::result_of<F(Args...)>::type> AddAwaitableTask(
@@ -178,6 +195,8 @@ class WorkQueueGroup {
 
   virtual size_t QueueGroupNumThreads() const = 0;
 
+  virtual SchedulerStats QueueStats(size_t queue_idx) const = 0;
+
   virtual void Cancel() = 0;
 
  protected:
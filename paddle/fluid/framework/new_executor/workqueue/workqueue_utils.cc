@@ -14,11 +14,53 @@
 
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
+#include <sstream>
 
 namespace paddle::framework {
 
+SchedulerStats& SchedulerStats::operator+=(const SchedulerStats& other) {
+  num_tasks += other.num_tasks;
+  num_steals += other.num_steals;
+  num_wakeups += other.num_wakeups;
+  num_skipped_wakeups += other.num_skipped_wakeups;
+  num_parks += other.num_parks;
+  idle_ns += other.idle_ns;
+  num_pushes += other.num_pushes;
+  total_queue_depth += other.total_queue_depth;
+  max_queue_depth = std::max(max_queue_depth, other.max_queue_depth);
+  return *this;
+}
+
+SchedulerStats SchedulerStats::operator-(const SchedulerStats& other) const {
+  SchedulerStats diff;
+  diff.num_tasks = num_tasks - other.num_tasks;
+  diff.num_steals = num_steals - other.num_steals;
+  diff.num_wakeups = num_wakeups - other.num_wakeups;
+  diff.num_skipped_wakeups = num_skipped_wakeups - other.num_skipped_wakeups;
+  diff.num_parks = num_parks - other.num_parks;
+  diff.idle_ns = idle_ns - other.idle_ns;
+  diff.num_pushes = num_pushes - other.num_pushes;
+  diff.total_queue_depth = total_queue_depth - other.total_queue_depth;
+  diff.max_queue_depth = max_queue_depth;
+  return diff;
+}
+
+std::string SchedulerStats::ToString() const {
+  std::ostringstream os;
+  os << "tasks: " << num_tasks << ", steals: " << num_steals
+     << ", wakeups: " << num_wakeups
+     << ", skipped wakeups: " << num_skipped_wakeups
+     << ", parks: " << num_parks << ", idle(ns): " << idle_ns
+     << ", avg queue depth: "
+     << (num_pushes == 0 ? 0.0
+                         : static_cast<double>(total_queue_depth) / num_pushes)
+     << ", max queue depth: " << max_queue_depth;
+  return os.str();
+}
+
 void* AlignedMalloc(size_t size, size_t alignment) {
   assert(alignment >= sizeof(void*) && (alignment & (alignment - 1)) == 0);
   size = (size + alignment - 1) / alignment * alignment;
@@ -17,6 +17,7 @@
 #include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <set>
@@ -65,6 +66,33 @@ class CounterGuard {
   Holder* counter_holder_{nullptr};
 };
 
+// Statistics of the scheduling of a thread pool, summed over its threads.
+struct SchedulerStats {
+  // tasks executed
+  uint64_t num_tasks{0};
+  // tasks a thread took from the queue of another thread
+  uint64_t num_steals{0};
+  // notifications sent to parked threads for new tasks
+  uint64_t num_wakeups{0};
+  // notifications saved since a spinning thread would take the task
+  uint64_t num_skipped_wakeups{0};
+  // times a thread parked for lack of work
+  uint64_t num_parks{0};
+  // time the threads spent looking for work, spinning or parked
+  uint64_t idle_ns{0};
+  // queue depth sampled after every push
+  uint64_t num_pushes{0};
+  uint64_t total_queue_depth{0};
+  uint64_t max_queue_depth{0};
+
+  // max_queue_depth is the maximum of both
+  SchedulerStats& operator+=(const SchedulerStats& other);
+  // the difference of the counters, max_queue_depth of this is kept
+  SchedulerStats operator-(const SchedulerStats& other) const;
+
+  std::string ToString() const;
+};
+
 void* AlignedMalloc(size_t size, size_t alignment);
 
 void AlignedFree(void* memory_ptr);
@@ -0,0 +1,563 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace paddle {
+namespace framework {
+
+// Columnar binary file of slot records, written once from the MultiSlot text
+// format and then mapped by every pass instead of parsing text again:
+//
+//   | header (64B) | block 0 | block 1 | ... | block index (24B * blocks) |
+//
+// A block holds up to block_size records, column by column:
+//
+//   | block header (32B) | search_id (8B * n) | rank (4B * n) |
+//   | cmatch (4B * n) | ins_id offsets (4B * (n + 1)) | ins_id bytes |
+//   | uint64 offsets (4B * (n * uint64_slot_num + 1)) |
+//   | float offsets (4B * (n * float_slot_num + 1)) |
+//   | uint64 values (8B * uint64_value_num) | float values |
+//
+// every column starts 8 bytes aligned. The offsets of record r, slot s are
+// at r * slot_num + s, so the feasigns of a record are one contiguous range
+// and a record is read in place from the mapping. Blocks are independent,
+// the index lets readers split a file between workers by block.
+static const char kSlotBinaryMagic[8] = {
+    'P', 'D', 'S', 'L', 'O', 'T', 'B', '\0'};
+static const uint32_t kSlotBinaryVersion = 1;
+static const uint32_t kSlotBinaryDefaultBlockSize = 4096;
+
+struct SlotBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_size;
+  uint32_t uint64_slot_num;
+  uint32_t float_slot_num;
+  // identifies the used slots the file was converted with
+  uint64_t slot_signature;
+  uint64_t record_num;
+  uint64_t block_num;
+  uint64_t index_offset;
+  uint64_t reserved;
+};
+static_assert(sizeof(SlotBinaryHeader) == 64,
+              "SlotBinaryHeader must be 64 bytes");
+
+struct SlotBinaryBlockIndex {
+  uint64_t offset;
+  uint64_t size;
+  uint32_t record_num;
+  uint32_t reserved;
+};
+static_assert(sizeof(SlotBinaryBlockIndex) == 24,
+              "SlotBinaryBlockIndex must be 24 bytes");
+
+struct SlotBinaryBlockHeader {
+  uint32_t record_num;
+  uint32_t ins_id_bytes;
+  uint64_t uint64_value_num;
+  uint64_t float_value_num;
+  uint64_t reserved;
+};
+static_assert(sizeof(SlotBinaryBlockHeader) == 32,
+              "SlotBinaryBlockHeader must be 32 bytes");
+
+// One record. The feasigns of slot s are values[offsets[s]] to
+// values[offsets[s + 1]], offsets holds slot_num + 1 entries.
+struct SlotBinaryRecordView {
+  uint64_t search_id = 0;
+  uint32_t rank = 0;
+  uint32_t cmatch = 0;
+  const char* ins_id = nullptr;
+  uint32_t ins_id_len = 0;
+  const uint64_t* uint64_values = nullptr;
+  const uint32_t* uint64_offsets = nullptr;
+  const float* float_values = nullptr;
+  const uint32_t* float_offsets = nullptr;
+};
+
+// byte offsets of the columns inside a block
+struct SlotBinaryBlockLayout {
+  SlotBinaryBlockLayout(const SlotBinaryBlockHeader& header,
+                        uint32_t uint64_slot_num,
+                        uint32_t float_slot_num) {
+    uint64_t n = header.record_num;
+    search_id = sizeof(SlotBinaryBlockHeader);
+    rank = search_id + n * sizeof(uint64_t);
+    cmatch = AlignUp(rank + n * sizeof(uint32_t));
+    ins_id_offsets = AlignUp(cmatch + n * sizeof(uint32_t));
+    ins_id = ins_id_offsets + (n + 1) * sizeof(uint32_t);
+    uint64_offsets = AlignUp(ins_id + header.ins_id_bytes);
+    float_offsets =
+        AlignUp(uint64_offsets + (n * uint64_slot_num + 1) * sizeof(uint32_t));
+    uint64_values =
+        AlignUp(float_offsets + (n * float_slot_num + 1) * sizeof(uint32_t));
+    float_values = uint64_values + header.uint64_value_num * sizeof(uint64_t);
+    size = AlignUp(float_values + header.float_value_num * sizeof(float));
+  }
+
+  static uint64_t AlignUp(uint64_t offset) { return (offset + 7) & ~7ULL; }
+
+  uint64_t search_id;
+  uint64_t rank;
+  uint64_t cmatch;
+  uint64_t ins_id_offsets;
+  uint64_t ins_id;
+  uint64_t uint64_offsets;
+  uint64_t float_offsets;
+  uint64_t uint64_values;
+  uint64_t float_values;
+  uint64_t size;
+};
+
+class SlotBinaryFileWriter {
+ public:
+  SlotBinaryFileWriter() {}
+  SlotBinaryFileWriter(const SlotBinaryFileWriter&) = delete;
+  ~SlotBinaryFileWriter() {
+    if (fp_ != nullptr) {
+      fclose(fp_);
+      unlink(tmp_path_.c_str());
+    }
+  }
+
+  // return 0 on success
+  int Open(const std::string& path,
+           uint32_t uint64_slot_num,
+           uint32_t float_slot_num,
+           uint64_t slot_signature,
+           uint32_t block_size = kSlotBinaryDefaultBlockSize) {
+    path_ = path;
+    // write to a temp file first so readers never see a torn file
+    tmp_path_ = path + ".tmp";
+    fp_ = fopen(tmp_path_.c_str(), "wb");
+    if (fp_ == nullptr) {
+      LOG(ERROR) << "SlotBinaryFileWriter open " << tmp_path_ << " failed";
+      return -1;
+    }
+    io_buffer_.resize(4 * 1024 * 1024);
+    setvbuf(fp_, io_buffer_.data(), _IOFBF, io_buffer_.size());
+    memset(&header_, 0, sizeof(header_));
+    memcpy(header_.magic, kSlotBinaryMagic, sizeof(header_.magic));
+    header_.version = kSlotBinaryVersion;
+    header_.block_size = block_size;
+    header_.uint64_slot_num = uint64_slot_num;
+    header_.float_slot_num = float_slot_num;
+    header_.slot_signature = slot_signature;
+    offset_ = sizeof(header_);
+    index_.clear();
+    ClearBlock();
+    // the header is rewritten by Close
+    ok_ = fwrite(&header_, sizeof(header_), 1, fp_) == 1;
+    return ok_ ? 0 : -1;
+  }
+
+  void Append(const SlotBinaryRecordView& record) {
+    search_ids_.push_back(record.search_id);
+    ranks_.push_back(record.rank);
+    cmatches_.push_back(record.cmatch);
+    ins_ids_.insert(ins_ids_.end(),
+                    record.ins_id,
+                    record.ins_id + record.ins_id_len);
+    ins_id_offsets_.push_back(static_cast<uint32_t>(ins_ids_.size()));
+    AppendSlots(record.uint64_values,
+                record.uint64_offsets,
+                header_.uint64_slot_num,
+                &uint64_values_,
+                &uint64_offsets_);
+    AppendSlots(record.float_values,
+                record.float_offsets,
+                header_.float_slot_num,
+                &float_values_,
+                &float_offsets_);
+    if (search_ids_.size() >= header_.block_size) {
+      FlushBlock();
+    }
+  }
+
+  // write the last block and the index, return 0 on success
+  int Close() {
+    if (fp_ == nullptr) {
+      return -1;
+    }
+    if (!search_ids_.empty()) {
+      FlushBlock();
+    }
+    header_.block_num = index_.size();
+    header_.index_offset = offset_;
+    ok_ = ok_ && (index_.empty() || fwrite(index_.data(),
+                                           sizeof(SlotBinaryBlockIndex),
+                                           index_.size(),
+                                           fp_) == index_.size());
+    ok_ = ok_ && fseek(fp_, 0, SEEK_SET) == 0 &&
+          fwrite(&header_, sizeof(header_), 1, fp_) == 1;
+    ok_ = (fclose(fp_) == 0) && ok_;
+    fp_ = nullptr;
+    if (!ok_ || rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+      LOG(ERROR) << "SlotBinaryFileWriter write " << path_ << " failed";
+      unlink(tmp_path_.c_str());
+      return -1;
+    }
+    return 0;
+  }
+
+  uint64_t record_num() const {
+    return header_.record_num + search_ids_.size();
+  }
+
+ private:
+  template <typename T>
+  static void AppendSlots(const T* values,
+                          const uint32_t* offsets,
+                          uint32_t slot_num,
+                          std::vector<T>* block_values,
+                          std::vector<uint32_t>* block_offsets) {
+    uint32_t base = static_cast<uint32_t>(block_values->size()) - offsets[0];
+    for (uint32_t s = 1; s <= slot_num; ++s) {
+      block_offsets->push_back(offsets[s] + base);
+    }
+    block_values->insert(
+        block_values->end(), values + offsets[0], values + offsets[slot_num]);
+  }
+
+  template <typename T>
+  void WriteColumn(const std::vector<T>& column, uint64_t begin) {
+    // zero padding up to the column start
+    static const char zeros[8] = {0};
+    if (ok_ && begin > written_) {
+      ok_ = fwrite(zeros, 1, begin - written_, fp_) == begin - written_;
+    }
+    if (ok_ && !column.empty()) {
+      ok_ = fwrite(column.data(), sizeof(T), column.size(), fp_) ==
+            column.size();
+    }
+    written_ = begin + column.size() * sizeof(T);
+  }
+
+  void FlushBlock() {
+    SlotBinaryBlockHeader block;
+    memset(&block, 0, sizeof(block));
+    block.record_num = static_cast<uint32_t>(search_ids_.size());
+    block.ins_id_bytes = static_cast<uint32_t>(ins_ids_.size());
+    block.uint64_value_num = uint64_values_.size();
+    block.float_value_num = float_values_.size();
+    SlotBinaryBlockLayout layout(
+        block, header_.uint64_slot_num, header_.float_slot_num);
+    ok_ = ok_ && fwrite(&block, sizeof(block), 1, fp_) == 1;
+    written_ = sizeof(block);
+    WriteColumn(search_ids_, layout.search_id);
+    WriteColumn(ranks_, layout.rank);
+    WriteColumn(cmatches_, layout.cmatch);
+    WriteColumn(ins_id_offsets_, layout.ins_id_offsets);
+    WriteColumn(ins_ids_, layout.ins_id);
+    WriteColumn(uint64_offsets_, layout.uint64_offsets);
+    WriteColumn(float_offsets_, layout.float_offsets);
+    WriteColumn(uint64_values_, layout.uint64_values);
+    WriteColumn(float_values_, layout.float_values);
+    WriteColumn(std::vector<char>(), layout.size);
+
+    SlotBinaryBlockIndex index;
+    memset(&index, 0, sizeof(index));
+    index.offset = offset_;
+    index.size = layout.size;
+    index.record_num = block.record_num;
+    index_.push_back(index);
+    offset_ += layout.size;
+    header_.record_num += block.record_num;
+    ClearBlock();
+  }
+
+  void ClearBlock() {
+    search_ids_.clear();
+    ranks_.clear();
+    cmatches_.clear();
+    ins_ids_.clear();
+    ins_id_offsets_.assign(1, 0);
+    uint64_values_.clear();
+    uint64_offsets_.assign(1, 0);
+    float_values_.clear();
+    float_offsets_.assign(1, 0);
+  }
+
+  std::string path_;
+  std::string tmp_path_;
+  FILE* fp_ = nullptr;
+  std::vector<char> io_buffer_;
+  bool ok_ = false;
+  SlotBinaryHeader header_;
+  uint64_t offset_ = 0;
+  uint64_t written_ = 0;
+  std::vector<SlotBinaryBlockIndex> index_;
+
+  std::vector<uint64_t> search_ids_;
+  std::vector<uint32_t> ranks_;
+  std::vector<uint32_t> cmatches_;
+  std::vector<char> ins_ids_;
+  std::vector<uint32_t> ins_id_offsets_;
+  std::vector<uint64_t> uint64_values_;
+  std::vector<uint32_t> uint64_offsets_;
+  std::vector<float> float_values_;
+  std::vector<uint32_t> float_offsets_;
+};
+
+// Read-only view of a slot binary file mapped into memory.
+class MappedSlotBinaryFile {
+ public:
+  MappedSlotBinaryFile() {}
+  MappedSlotBinaryFile(const MappedSlotBinaryFile&) = delete;
+  ~MappedSlotBinaryFile() { Close(); }
+
+  // return 0 on success
+  int Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      LOG(ERROR) << "MappedSlotBinaryFile open " << path << " failed";
+      return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(SlotBinaryHeader)) {
+      LOG(ERROR) << "MappedSlotBinaryFile " << path << " is truncated";
+      close(fd);
+      return -1;
+    }
+    length_ = st.st_size;
+    addr_ = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+      LOG(ERROR) << "MappedSlotBinaryFile mmap " << path << " failed";
+      addr_ = nullptr;
+      return -1;
+    }
+    base_ = reinterpret_cast<const char*>(addr_);
+    header_ = reinterpret_cast<const SlotBinaryHeader*>(addr_);
+    // the sizes are compared by division so that a corrupt header can not
+    // overflow them
+    if (memcmp(header_->magic, kSlotBinaryMagic, sizeof(header_->magic)) !=
+            0 ||
+        header_->version != kSlotBinaryVersion ||
+        header_->index_offset < sizeof(SlotBinaryHeader) ||
+        header_->index_offset > length_ ||
+        header_->block_num > (length_ - header_->index_offset) /
+                                 sizeof(SlotBinaryBlockIndex)) {
+      LOG(ERROR) << "MappedSlotBinaryFile " << path
+                 << " has a bad header or is truncated, version "
+                 << header_->version << ", file length " << length_;
+      Close();
+      return -1;
+    }
+    index_ = reinterpret_cast<const SlotBinaryBlockIndex*>(
+        base_ + header_->index_offset);
+    uint64_t record_num = 0;
+    for (uint64_t b = 0; b < header_->block_num; ++b) {
+      if (index_[b].offset < sizeof(SlotBinaryHeader) ||
+          index_[b].size < sizeof(SlotBinaryBlockHeader) ||
+          index_[b].size > header_->index_offset ||
+          index_[b].offset > header_->index_offset - index_[b].size) {
+        LOG(ERROR) << "MappedSlotBinaryFile " << path << " block " << b
+                   << " at " << index_[b].offset << " size "
+                   << index_[b].size << " is out of the blocks, which end at "
+                   << header_->index_offset;
+        Close();
+        return -1;
+      }
+      record_num += index_[b].record_num;
+    }
+    if (record_num != header_->record_num) {
+      LOG(ERROR) << "MappedSlotBinaryFile " << path << " has " << record_num
+                 << " records in its blocks, but " << header_->record_num
+                 << " in its header";
+      Close();
+      return -1;
+    }
+    // the records are read front to back
+    madvise(addr_, length_, MADV_SEQUENTIAL);
+    return 0;
+  }
+
+  void Close() {
+    if (addr_ != nullptr) {
+      munmap(addr_, length_);
+    }
+    addr_ = nullptr;
+    length_ = 0;
+    header_ = nullptr;
+  }
+
+  uint64_t record_num() const { return header_->record_num; }
+  uint64_t block_num() const { return header_->block_num; }
+  uint32_t uint64_slot_num() const { return header_->uint64_slot_num; }
+  uint32_t float_slot_num() const { return header_->float_slot_num; }
+  uint64_t slot_signature() const { return header_->slot_signature; }
+  uint32_t block_record_num(uint64_t block) const {
+    return index_[block].record_num;
+  }
+
+  // Columns of one block, valid as long as the file stays open.
+  class Block {
+   public:
+    uint32_t record_num() const { return header_->record_num; }
+
+    void GetRecord(uint32_t i, SlotBinaryRecordView* record) const {
+      record->search_id = search_ids_[i];
+      record->rank = ranks_[i];
+      record->cmatch = cmatches_[i];
+      record->ins_id = ins_ids_ + ins_id_offsets_[i];
+      record->ins_id_len = ins_id_offsets_[i + 1] - ins_id_offsets_[i];
+      record->uint64_values = uint64_values_;
+      record->uint64_offsets = uint64_offsets_ + i * uint64_slot_num_;
+      record->float_values = float_values_;
+      record->float_offsets = float_offsets_ + i * float_slot_num_;
+    }
+
+   private:
+    friend class MappedSlotBinaryFile;
+
+    const SlotBinaryBlockHeader* header_ = nullptr;
+    uint32_t uint64_slot_num_ = 0;
+    uint32_t float_slot_num_ = 0;
+    const uint64_t* search_ids_ = nullptr;
+    const uint32_t* ranks_ = nullptr;
+    const uint32_t* cmatches_ = nullptr;
+    const uint32_t* ins_id_offsets_ = nullptr;
+    const char* ins_ids_ = nullptr;
+    const uint32_t* uint64_offsets_ = nullptr;
+    const uint32_t* float_offsets_ = nullptr;
+    const uint64_t* uint64_values_ = nullptr;
+    const float* float_values_ = nullptr;
+  };
+
+  // Return 0 on success, -1 if the block is corrupted. The offsets of every
+  // record are checked, so the records of a block read by GetRecord stay
+  // inside the block.
+  int GetBlock(uint64_t b, Block* block) const {
+    const char* begin = base_ + index_[b].offset;
+    const uint64_t size = index_[b].size;
+    block->header_ = reinterpret_cast<const SlotBinaryBlockHeader*>(begin);
+    const SlotBinaryBlockHeader& block_header = *block->header_;
+    // bound the counts first, the layout of larger ones could overflow
+    if (block_header.record_num != index_[b].record_num ||
+        block_header.ins_id_bytes > size ||
+        block_header.uint64_value_num > size / sizeof(uint64_t) ||
+        block_header.float_value_num > size / sizeof(float) ||
+        static_cast<uint64_t>(block_header.record_num) *
+                header_->uint64_slot_num >
+            size / sizeof(uint32_t) ||
+        static_cast<uint64_t>(block_header.record_num) *
+                header_->float_slot_num >
+            size / sizeof(uint32_t)) {
+      LOG(ERROR) << "MappedSlotBinaryFile block " << b
+                 << " has a bad header";
+      return -1;
+    }
+    SlotBinaryBlockLayout layout(
+        block_header, header_->uint64_slot_num, header_->float_slot_num);
+    if (layout.size != size) {
+      LOG(ERROR) << "MappedSlotBinaryFile block " << b << " has size " << size
+                 << " in the index, but its columns take " << layout.size;
+      return -1;
+    }
+    const uint64_t n = block_header.record_num;
+    if (!CheckOffsets(b,
+                      "ins_id",
+                      begin + layout.ins_id_offsets,
+                      n,
+                      1,
+                      block_header.ins_id_bytes) ||
+        !CheckOffsets(b,
+                      "uint64",
+                      begin + layout.uint64_offsets,
+                      n,
+                      header_->uint64_slot_num,
+                      block_header.uint64_value_num) ||
+        !CheckOffsets(b,
+                      "float",
+                      begin + layout.float_offsets,
+                      n,
+                      header_->float_slot_num,
+                      block_header.float_value_num)) {
+      return -1;
+    }
+    block->uint64_slot_num_ = header_->uint64_slot_num;
+    block->float_slot_num_ = header_->float_slot_num;
+    block->search_ids_ =
+        reinterpret_cast<const uint64_t*>(begin + layout.search_id);
+    block->ranks_ = reinterpret_cast<const uint32_t*>(begin + layout.rank);
+    block->cmatches_ = reinterpret_cast<const uint32_t*>(begin + layout.cmatch);
+    block->ins_id_offsets_ =
+        reinterpret_cast<const uint32_t*>(begin + layout.ins_id_offsets);
+    block->ins_ids_ = begin + layout.ins_id;
+    block->uint64_offsets_ =
+        reinterpret_cast<const uint32_t*>(begin + layout.uint64_offsets);
+    block->float_offsets_ =
+        reinterpret_cast<const uint32_t*>(begin + layout.float_offsets);
+    block->uint64_values_ =
+        reinterpret_cast<const uint64_t*>(begin + layout.uint64_values);
+    block->float_values_ =
+        reinterpret_cast<const float*>(begin + layout.float_values);
+    return 0;
+  }
+
+ private:
+  // whether the n * per_record + 1 offsets of a column of block b rise from
+  // 0 to value_num, that is every record reads inside the column
+  static bool CheckOffsets(uint64_t b,
+                           const char* column,
+                           const char* data,
+                           uint64_t n,
+                           uint32_t per_record,
+                           uint64_t value_num) {
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data);
+    const uint64_t num = n * per_record;
+    for (uint64_t i = 0; i < num; ++i) {
+      if (offsets[i + 1] < offsets[i] || offsets[i + 1] > value_num) {
+        LOG(ERROR) << "MappedSlotBinaryFile block " << b << " record "
+                   << i / per_record << " has " << column << " values ["
+                   << offsets[i] << ", " << offsets[i + 1]
+                   << ") out of the " << value_num << " of its block";
+        return false;
+      }
+    }
+    if (offsets[0] != 0 || offsets[num] != value_num) {
+      LOG(ERROR) << "MappedSlotBinaryFile block " << b << " has " << column
+                 << " offsets from " << offsets[0] << " to " << offsets[num]
+                 << ", but " << value_num << " values";
+      return false;
+    }
+    return true;
+  }
+
+  void* addr_ = nullptr;
+  size_t length_ = 0;
+  const char* base_ = nullptr;
+  const SlotBinaryHeader* header_ = nullptr;
+  const SlotBinaryBlockIndex* index_ = nullptr;
+};
+
+}  // namespace framework
+}  // namespace paddle
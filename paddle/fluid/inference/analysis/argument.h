@@ -173,6 +173,8 @@ struct Argument {
 
   // For JITLayer
   DECL_ARGUMENT_FIELD(skip_load_params, SkipLoadParams, bool);
+  // Map the combined params file instead of reading it.
+  DECL_ARGUMENT_FIELD(memory_mapped_params, MemoryMappedParams, bool);
 
   // The overall graph to work on.
   DECL_ARGUMENT_UNIQUE_FIELD(main_graph, MainGraph, framework::ir::Graph);
@@ -56,7 +56,9 @@ void IrGraphBuildPass::RunImpl(Argument *argument) {
         argument->scope_ptr(),
         place,
         argument->model_from_memory_valid() && argument->model_from_memory(),
-        argument->skip_load_params());
+        argument->skip_load_params(),
+        argument->memory_mapped_params_valid() &&
+            argument->memory_mapped_params());
     argument->SetMainProgram(program.release());
   } else {
     PADDLE_THROW(platform::errors::PreconditionNotMet(
@@ -119,10 +121,16 @@ std::unique_ptr<framework::ProgramDesc> IrGraphBuildPass::LoadModel(
     framework::Scope *scope,
     const platform::Place &place,
     bool model_from_memory,
-    bool skip_load_params) {
+    bool skip_load_params,
+    bool memory_mapped_params) {
   framework::Executor exe(place);
   if (!model_from_memory) {  // NOLINT
-    return Load(&exe, scope, program_path, params_path, !skip_load_params);
+    return Load(&exe,
+                scope,
+                program_path,
+                params_path,
+                !skip_load_params,
+                memory_mapped_params);
   } else {
     return LoadFromMemory(&exe, scope, program_path, params_path);
   }
@@ -44,7 +44,8 @@ class IrGraphBuildPass : public AnalysisPass {
       framework::Scope *scope,
       const platform::Place &place,
       bool model_from_memory,
-      bool skip_load_params);
+      bool skip_load_params,
+      bool memory_mapped_params);
 
   std::string model_binary_str_;
 };
@@ -439,6 +439,7 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(model_dir_);
   CP_MEMBER(model_from_memory_);  // the memory model reuses prog_file_ and
                                   // params_file_ fields.
+  CP_MEMBER(memory_mapped_params_);
   CP_MEMBER(save_optimized_model_);
   CP_MEMBER(opt_cache_dir_);
   CP_MEMBER(prog_file_);
@@ -545,6 +546,8 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(use_optimized_model_);
 
   CP_MEMBER(cpu_math_library_num_threads_);
+  CP_MEMBER(cpu_numa_node_);
+  CP_MEMBER(numa_node_predictors_);
 
   CP_MEMBER(serialized_info_cache_);
 
@@ -1176,6 +1179,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
   for (auto &item : quantize_excluded_op_ids_) ss << item;
   ss << ";";
   ss << model_from_memory_;
+  ss << memory_mapped_params_;
 
   ss << with_profile_;
 
@@ -1188,6 +1192,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
 
   ss << specify_input_name_;
   ss << cpu_math_library_num_threads_;
+  ss << cpu_numa_node_;
 
   ss << use_xpu_;
   ss << xpu_config_.device_id;
@@ -1241,6 +1246,19 @@ void AnalysisConfig::SetCpuMathLibraryNumThreads(
   Update();
 }
 
+void AnalysisConfig::SetCpuNumaNode(int node) {
+  PADDLE_ENFORCE_GE(
+      node,
+      -1,
+      platform::errors::InvalidArgument(
+          "The NUMA node should be -1 or a node id, but received %d.", node));
+  cpu_numa_node_ = node;
+}
+
+void AnalysisConfig::EnableNumaNodePredictors(bool x) {
+  numa_node_predictors_ = x;
+}
+
 float AnalysisConfig::fraction_of_gpu_memory_for_pool() const {
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
   // Get the GPU memory details and calculate the fraction of memory for the
@@ -1338,11 +1356,20 @@ std::string AnalysisConfig::Summary() {
   if (model_from_memory_) {
     os.InsertRow({"model_from_memory", params_file_});
   }
+  if (memory_mapped_params_) {
+    os.InsertRow({"memory_mapped_params", "true"});
+  }
   os.InsetDivider();
 
   // cpu info
   os.InsertRow(
       {"cpu_math_thread", std::to_string(cpu_math_library_num_threads_)});
+  if (cpu_numa_node_ >= 0) {
+    os.InsertRow({"cpu_numa_node", std::to_string(cpu_numa_node_)});
+  }
+  if (numa_node_predictors_) {
+    os.InsertRow({"numa_node_predictors", "true"});
+  }
   os.InsertRow({"enable_mkldnn", use_mkldnn_ ? "true" : "false"});
   os.InsertRow(
       {"mkldnn_cache_capacity", std::to_string(mkldnn_cache_capacity_)});
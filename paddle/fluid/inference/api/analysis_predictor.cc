@@ -50,6 +50,7 @@
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
 #include "paddle/fluid/inference/api/paddle_inference_pass.h"
 #include "paddle/fluid/inference/api/resource_manager.h"
+#include "paddle/fluid/inference/io.h"
 #include "paddle/fluid/inference/utils/io_utils.h"
 #include "paddle/fluid/inference/utils/model_utils.h"
 #include "paddle/fluid/inference/utils/singleton.h"
@@ -64,6 +65,7 @@
 #include "paddle/phi/api/include/context_pool.h"
 #include "paddle/phi/api/include/tensor.h"
 #include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
 #include "paddle/phi/common/backend.h"
 #include "paddle/phi/common/data_type.h"
 #include "paddle/phi/common/place.h"
@@ -437,6 +439,9 @@ bool AnalysisPredictor::Init(
 
   // no matter with or without OneDNN
   paddle::platform::SetNumThreads(config_.cpu_math_library_num_threads());
+  // the parameters are loaded into the memory of the node
+  phi::backends::cpu::ScopedNumaNodeBinding numa_binding(
+      config_.cpu_numa_node());
 
   // Use Optimized model to inference
   if (config_.use_optimized_model_) {
@@ -997,6 +1002,10 @@ bool AnalysisPredictor::LoadPirParameters() {
     vars.emplace_back(pair.second);
   }
 
+  // the mapped parameters get their memory from the file
+  bool memory_mapped = config_.memory_mapped_params_enabled() &&
+                       !config_.model_from_memory() &&
+                       platform::is_cpu_place(place_);
   size_t len = vars.size();
   std::vector<phi::DenseTensor *> tensor_out;
   for (size_t i = 0; i < len; ++i) {
@@ -1006,6 +1015,10 @@ bool AnalysisPredictor::LoadPirParameters() {
       var = sub_scope_->Var(param_names[i]);
       auto *tensor_temp = var->GetMutable<phi::DenseTensor>();
       tensor_temp->Resize(common::make_ddim(pir::GetShapeFromValue(value)));
+      if (memory_mapped) {
+        tensor_out.push_back(tensor_temp);
+        continue;
+      }
       phi::DeviceContextPool &pool = phi::DeviceContextPool::Instance();
       const phi::DeviceContext *dev_ctx = nullptr;
       dev_ctx = pool.Get(place_);
@@ -1018,8 +1031,12 @@ bool AnalysisPredictor::LoadPirParameters() {
   }
 
   CreateFeedFetchVar(sub_scope_);
-  pir::LoadCombineFunction(
-      config_.params_file(), param_names, &tensor_out, false, place_);
+  if (memory_mapped) {
+    inference::LoadCombineFromMemoryMap(config_.params_file(), tensor_out);
+  } else {
+    pir::LoadCombineFunction(
+        config_.params_file(), param_names, &tensor_out, false, place_);
+  }
   return true;
 }
 
@@ -1173,6 +1190,7 @@ bool AnalysisPredictor::PrepareExecutor() {
     framework::interpreter::ExecutionConfig execution_config;
     execution_config.create_local_scope = false;
     execution_config.used_for_inference = true;
+    execution_config.numa_node = config_.cpu_numa_node();
 
     auto input_names = GetInputNames();
 
@@ -1563,6 +1581,8 @@ bool AnalysisPredictor::Run(const std::vector<PaddleTensor> &inputs,
                             std::vector<PaddleTensor> *output_data,
                             int batch_size) {
   paddle::platform::SetNumThreads(config_.cpu_math_library_num_threads());
+  phi::backends::cpu::ScopedNumaNodeBinding numa_binding(
+      config_.cpu_numa_node());
 #ifdef PADDLE_WITH_DNNL
   if (config_.use_mkldnn_) MkldnnPreSet(inputs);
 #endif
@@ -1640,6 +1660,8 @@ bool AnalysisPredictor::Run(const std::vector<paddle::Tensor> &inputs,
     pool.SyncDeviceContext(place_);
   }
   paddle::platform::SetNumThreads(config_.cpu_math_library_num_threads());
+  phi::backends::cpu::ScopedNumaNodeBinding numa_binding(
+      config_.cpu_numa_node());
 #ifdef PADDLE_WITH_DNNL
   if (config_.use_mkldnn_) MkldnnPreSet(inputs);
 #endif
@@ -1938,6 +1960,7 @@ void AnalysisPredictor::PrepareArgument() {
   argument_->SetOptimizedModelSavePath(GetOptimizedModelPath());
   // For JITLayer
   argument_->SetSkipLoadParams(config_.skip_load_params_);
+  argument_->SetMemoryMappedParams(config_.memory_mapped_params_enabled());
 
   argument_->SetTensorRtPrecisionMode(static_cast<int>(
       paddle::ConvertPrecision(config_.tensorrt_precision_mode_)));
@@ -2620,6 +2643,8 @@ bool AnalysisPredictor::ZeroCopyRun(bool switch_stream) {
     pool.SyncDeviceContext(place_);
   }
   paddle::platform::SetNumThreads(config_.cpu_math_library_num_threads());
+  phi::backends::cpu::ScopedNumaNodeBinding numa_binding(
+      config_.cpu_numa_node());
 #ifdef PADDLE_WITH_DNNL
   if (config_.use_mkldnn_) {
     std::vector<std::vector<int>> shape_vector;
@@ -2992,10 +3017,14 @@ bool AnalysisPredictor::LoadParameters() {
       new framework::ProgramDesc());
   framework::BlockDesc *load_block = load_program->MutableBlock(0);
   std::vector<std::string> params;
+  // only the DenseTensors can be mapped, e.g. not the vocabularies
+  bool all_dense_tensors = true;
 
   for (auto *var : global_block->AllVars()) {
     if (IsPersistable(var)) {
       VLOG(3) << "persistable variable's name: " << var->Name();
+      all_dense_tensors &=
+          (var->GetType() == framework::proto::VarType::LOD_TENSOR);
 
       framework::VarDesc *new_var = load_block->Var(var->Name());
       new_var->SetShape(var->GetShape());
@@ -3020,12 +3049,23 @@ bool AnalysisPredictor::LoadParameters() {
   if (!config_.params_file().empty()) {
     // sort paramlist to have consistent ordering
     std::sort(params.begin(), params.end());
-    // append just the load_combine op
-    framework::OpDesc *op = load_block->AppendOp();
-    op->SetType("load_combine");
-    op->SetOutput("Out", params);
-    op->SetAttr("file_path", {config_.params_file()});
-    op->CheckAttrs();
+    if (config_.memory_mapped_params_enabled() &&
+        !config_.model_from_memory() && platform::is_cpu_place(place_) &&
+        all_dense_tensors) {
+      std::vector<phi::DenseTensor *> tensors;
+      tensors.reserve(params.size());
+      for (auto &name : params) {
+        tensors.push_back(scope_->Var(name)->GetMutable<phi::DenseTensor>());
+      }
+      inference::LoadCombineFromMemoryMap(config_.params_file(), tensors);
+    } else {
+      // append just the load_combine op
+      framework::OpDesc *op = load_block->AppendOp();
+      op->SetType("load_combine");
+      op->SetOutput("Out", params);
+      op->SetAttr("file_path", {config_.params_file()});
+      op->CheckAttrs();
+    }
   }
 
   // Use NaiveExecutor to Load parameters.
@@ -3719,6 +3759,34 @@ PredictorPool::PredictorPool(const Config &config, size_t size) : preds_() {
           "The predictor pool size should be greater than 1, but it's (%d)",
           size));
   Config copy_config(config);
+  const auto &numa_nodes = phi::backends::cpu::CpuNumaNodes();
+  if (config.numa_node_predictors_enabled() && numa_nodes.size() > 1) {
+    // the i-th predictor runs on the (i % nodes)-th node, the first one on
+    // each node loads the parameters there and the others clone it
+    std::vector<Predictor *> node_preds;
+    for (size_t i = 0; i < size; i++) {
+      Predictor *pred = nullptr;
+      if (i < numa_nodes.size()) {
+        Config node_config(copy_config);
+        node_config.SetCpuNumaNode(numa_nodes[i].id);
+        if (i == 0) {
+          main_pred_ = std::make_unique<Predictor>(node_config);
+          pred = main_pred_.get();
+        } else {
+          preds_.emplace_back(new Predictor(node_config));
+          pred = preds_.back().get();
+        }
+        node_preds.push_back(pred);
+      } else if (config.tensorrt_engine_enabled()) {
+        Config node_config(copy_config);
+        node_config.SetCpuNumaNode(numa_nodes[i % numa_nodes.size()].id);
+        preds_.emplace_back(new Predictor(node_config));
+      } else {
+        preds_.emplace_back(node_preds[i % numa_nodes.size()]->Clone());
+      }
+    }
+    return;
+  }
   main_pred_ = std::make_unique<Predictor>(config);
   for (size_t i = 0; i < size - 1; i++) {
     if (config.tensorrt_engine_enabled()) {
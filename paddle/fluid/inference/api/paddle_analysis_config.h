@@ -939,7 +939,9 @@ struct PD_INFER_DECL AnalysisConfig {
   bool mkldnn_enabled() const { return use_mkldnn_; }
 
   ///
-  /// \brief Set the number of cpu math library threads.
+  /// \brief Set the number of cpu math library threads. It is also the
+  /// number of threads of the shared intra-op thread pool a parallel loop
+  /// of the CPU kernels started by the predictor may use.
   ///
   /// \param cpu_math_library_num_threads The number of cpu math library
   /// threads.
@@ -955,6 +957,36 @@ struct PD_INFER_DECL AnalysisConfig {
     return cpu_math_library_num_threads_;
   }
 
+  ///
+  /// \brief Run the predictor on a NUMA node (a socket). The threads running
+  /// it are pinned to the cpus of the node, and the memory they allocate,
+  /// including the parameters, is preferably taken from the node.
+  ///
+  /// \param node The id of the NUMA node, -1 to not pin (default).
+  ///
+  void SetCpuNumaNode(int node);
+  ///
+  /// \brief The NUMA node the predictor runs on.
+  ///
+  /// \return int The id of the NUMA node, -1 if not pinned.
+  ///
+  int cpu_numa_node() const { return cpu_numa_node_; }
+  ///
+  /// \brief Spread the predictors of a PredictorPool over the NUMA nodes of
+  /// the machine. Each node gets its own copy of the parameters, shared by
+  /// the predictors on it.
+  ///
+  /// \param x Whether to spread the predictors over the NUMA nodes.
+  ///
+  void EnableNumaNodePredictors(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the predictors of a
+  /// PredictorPool are spread over the NUMA nodes.
+  ///
+  /// \return bool Whether the predictors are spread over the NUMA nodes.
+  ///
+  bool numa_node_predictors_enabled() const { return numa_node_predictors_; }
+
   ///
   /// \brief Transform the AnalysisConfig to NativeConfig.
   ///
@@ -1066,6 +1098,25 @@ struct PD_INFER_DECL AnalysisConfig {
   ///
   bool model_from_memory() const { return model_from_memory_; }
 
+  ///
+  /// \brief Load the combined parameters file by mapping it into memory
+  /// instead of reading it. The parameters loaded on CPU alias the mapping
+  /// when their data is aligned in the file, so the file is paged in lazily
+  /// on first use and its pages are shared by the processes loading the
+  /// same model. A parameter written by the predictor gets a private copy
+  /// of its pages, the file is never modified.
+  ///
+  /// \param x Whether to map the combined parameters file.
+  ///
+  void EnableMemoryMappedParams(bool x = true) { memory_mapped_params_ = x; }
+  ///
+  /// \brief A boolean state telling whether the combined parameters file is
+  /// mapped into memory.
+  ///
+  /// \return bool Whether the combined parameters file is mapped.
+  ///
+  bool memory_mapped_params_enabled() const { return memory_mapped_params_; }
+
   ///
   /// \brief Turn on memory optimize
   /// NOTE still in development.
@@ -1324,6 +1375,7 @@ struct PD_INFER_DECL AnalysisConfig {
   std::unordered_set<std::string> mkldnn_enabled_op_types_;
 
   bool model_from_memory_{false};
+  bool memory_mapped_params_{false};
 
   bool enable_ir_optim_{true};
   bool ir_debug_{false};
@@ -1336,6 +1388,10 @@ struct PD_INFER_DECL AnalysisConfig {
 
   int cpu_math_library_num_threads_{1};
 
+  int cpu_numa_node_{-1};
+
+  bool numa_node_predictors_{false};
+
   bool with_profile_{false};
 
   bool with_glog_info_{true};
@@ -15,13 +15,18 @@ limitations under the License. */
 #include "paddle/fluid/inference/io.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <vector>
 
 #include "paddle/fluid/framework/block_desc.h"
+#include "paddle/fluid/framework/convert_utils.h"
+#include "paddle/fluid/framework/data_type.h"
 #include "paddle/fluid/framework/feed_fetch_type.h"
+#include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/version.h"
+#include "paddle/fluid/memory/allocation/mmap_allocator.h"
 #include "paddle/fluid/platform/cpu_helper.h"
 #include "paddle/fluid/platform/enforce.h"
 #include "paddle/fluid/pybind/pybind.h"
@@ -81,12 +86,15 @@ void LoadPersistables(framework::Executor* executor,
                       const framework::ProgramDesc& main_program,
                       const std::string& dirname,
                       const std::string& param_filename,
-                      bool model_from_memory = false) {
+                      bool model_from_memory,
+                      bool use_memory_map) {
   const framework::BlockDesc& global_block = main_program.Block(0);
 
   framework::ProgramDesc* load_program = new framework::ProgramDesc();
   framework::BlockDesc* load_block = load_program->MutableBlock(0);
   std::vector<std::string> param_list;
+  // only the DenseTensors can be mapped, e.g. not the vocabularies
+  bool all_dense_tensors = true;
 
   for (auto* var : global_block.AllVars()) {
     if (IsPersistable(var)) {
@@ -97,6 +105,8 @@ void LoadPersistables(framework::Executor* executor,
       new_var->SetDataType(var->GetDataType());
       auto var_type = var->GetType();
       new_var->SetType(var_type);
+      all_dense_tensors &=
+          (var_type == framework::proto::VarType::LOD_TENSOR);
 
       if ((var_type !=
            framework::proto::VarType::Type::VarType_Type_SELECTED_ROWS) &&
@@ -122,13 +132,22 @@ void LoadPersistables(framework::Executor* executor,
   if (!param_filename.empty()) {
     // sort param_list to have consistent ordering
     std::sort(param_list.begin(), param_list.end());
-    // append just the load_combine op
-    framework::OpDesc* op = load_block->AppendOp();
-    op->SetType("load_combine");
-    op->SetOutput("Out", param_list);
-    op->SetAttr("file_path", {param_filename});
-    op->SetAttr("model_from_memory", {model_from_memory});
-    op->CheckAttrs();
+    if (use_memory_map && !model_from_memory && all_dense_tensors) {
+      std::vector<phi::DenseTensor*> tensors;
+      tensors.reserve(param_list.size());
+      for (auto& name : param_list) {
+        tensors.push_back(scope->Var(name)->GetMutable<phi::DenseTensor>());
+      }
+      LoadCombineFromMemoryMap(param_filename, tensors);
+    } else {
+      // append just the load_combine op
+      framework::OpDesc* op = load_block->AppendOp();
+      op->SetType("load_combine");
+      op->SetOutput("Out", param_list);
+      op->SetAttr("file_path", {param_filename});
+      op->SetAttr("model_from_memory", {model_from_memory});
+      op->CheckAttrs();
+    }
   }
 
   executor->Run(*load_program, scope, 0, true, true);
@@ -166,7 +185,8 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                                              framework::Scope* scope,
                                              const std::string& prog_filename,
                                              const std::string& param_filename,
-                                             bool load_params) {
+                                             bool load_params,
+                                             bool use_memory_map) {
   std::string program_desc_str;
   ReadBinaryFile(prog_filename, &program_desc_str);
 
@@ -183,7 +203,8 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                      *main_program,
                      "",
                      param_filename,
-                     false /* model_from_memory */);
+                     false /* model_from_memory */,
+                     use_memory_map);
   }
   return main_program;
 }
@@ -210,6 +231,159 @@ std::unique_ptr<framework::ProgramDesc> LoadFromMemory(
   return main_program;
 }
 
+#ifndef _WIN32
+namespace {
+
+// The data of a parameter inside the mapping of the params file, which it
+// keeps mapped.
+class MappedParamAllocation : public phi::Allocation {
+ public:
+  MappedParamAllocation(void* ptr,
+                        size_t size,
+                        std::shared_ptr<phi::Allocation> mapping)
+      : phi::Allocation(ptr, size, phi::CPUPlace()),
+        mapping_(std::move(mapping)) {}
+
+ private:
+  std::shared_ptr<phi::Allocation> mapping_;
+};
+
+struct MappedFileReader {
+  const char* Next(size_t size) {
+    PADDLE_ENFORCE_LE(
+        size,
+        file_size - offset,
+        platform::errors::Unavailable(
+            "An error occurred while loading model parameters from %s. "
+            "Please check whether the model file is complete or damaged.",
+            file_path));
+    const char* data = file_data + offset;
+    offset += size;
+    return data;
+  }
+
+  template <typename T>
+  T Next() {
+    T value;
+    std::memcpy(&value, Next(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  const std::string& file_path;
+  const char* file_data;
+  size_t file_size;
+  size_t offset;
+};
+
+}  // namespace
+#endif
+
+void LoadCombineFromMemoryMap(const std::string& file_path,
+                              const std::vector<phi::DenseTensor*>& out) {
+#ifndef _WIN32
+  std::shared_ptr<phi::Allocation> mapping =
+      memory::allocation::AllocateMappedFileAllocation(file_path);
+  MappedFileReader reader{file_path,
+                          static_cast<const char*>(mapping->ptr()),
+                          mapping->size(),
+                          0};
+  size_t num_mapped = 0;
+  for (auto* tensor : out) {
+    // the format of DeserializeFromStream: the version and LoD of the
+    // DenseTensor, then the version, desc and data of TensorFromStream
+    uint32_t version = reader.Next<uint32_t>();
+    PADDLE_ENFORCE_EQ(version,
+                      0U,
+                      platform::errors::InvalidArgument(
+                          "Tensor version %u is not supported.", version));
+    uint64_t lod_level = reader.Next<uint64_t>();
+    auto& lod = *tensor->mutable_lod();
+    lod.resize(lod_level);
+    for (uint64_t i = 0; i < lod_level; ++i) {
+      uint64_t size = reader.Next<uint64_t>();
+      const char* lod_data = reader.Next(size);
+      lod[i].resize(size / sizeof(size_t));
+      std::memcpy(lod[i].data(), lod_data, lod[i].size() * sizeof(size_t));
+    }
+    version = reader.Next<uint32_t>();
+    PADDLE_ENFORCE_EQ(version,
+                      0U,
+                      platform::errors::InvalidArgument(
+                          "Tensor version %u is not supported.", version));
+    int32_t desc_size = reader.Next<int32_t>();
+    PADDLE_ENFORCE_GE(desc_size,
+                      0,
+                      platform::errors::InvalidArgument(
+                          "phi::DenseTensor desc size should >= 0"));
+    framework::proto::VarType::TensorDesc desc;
+    PADDLE_ENFORCE_EQ(
+        desc.ParseFromArray(reader.Next(desc_size), desc_size),
+        true,
+        platform::errors::InvalidArgument("Cannot parse tensor desc"));
+    // the dims of a damaged file must not overflow the size of the data,
+    // which is checked against the rest of the file
+    size_t type_size = framework::SizeOfType(desc.data_type());
+    size_t max_numel = (reader.file_size - reader.offset) / type_size;
+    size_t numel = 1;
+    for (int64_t dim : desc.dims()) {
+      PADDLE_ENFORCE_EQ(
+          dim >= 0 &&
+              (dim == 0 || numel <= max_numel / static_cast<size_t>(dim)),
+          true,
+          platform::errors::Unavailable(
+              "An error occurred while loading model parameters from %s. "
+              "Please check whether the model file is complete or damaged.",
+              file_path));
+      numel *= static_cast<size_t>(dim);
+    }
+    std::vector<int64_t> dims(desc.dims().begin(), desc.dims().end());
+    tensor->Resize(common::make_ddim(dims));
+    auto dtype = framework::TransToPhiDataType(desc.data_type());
+    size_t size = numel * type_size;
+    const char* data = reader.Next(size);
+    tensor->set_offset(0);
+    // the mapping starts on a page, so the alignment of the data in the file
+    // is its alignment in memory
+    if (size > 0 &&
+        reinterpret_cast<uintptr_t>(data) % phi::SizeOf(dtype) == 0) {
+      tensor->ResetHolderWithType(
+          std::make_shared<MappedParamAllocation>(
+              const_cast<char*>(data), size, mapping),
+          dtype);
+      ++num_mapped;
+    } else {
+      void* buf = tensor->mutable_data(phi::CPUPlace(), dtype);
+      std::memcpy(buf, data, size);
+    }
+  }
+  PADDLE_ENFORCE_EQ(reader.offset,
+                    reader.file_size,
+                    platform::errors::Unavailable(
+                        "Not allowed to load partial data via "
+                        "load_combine_op, please use load_op instead."));
+  VLOG(3) << "Mapped " << num_mapped << " of " << out.size()
+          << " parameters from " << file_path << ", copied the others";
+#else
+  // no mapping on windows, read the file like load_combine
+  std::ifstream fin(file_path, std::ios::binary);
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fin),
+      true,
+      platform::errors::Unavailable("Failed to open file %s.", file_path));
+  auto& dev_ctx = *platform::DeviceContextPool::Instance().Get(
+      platform::CPUPlace());
+  for (auto* tensor : out) {
+    framework::DeserializeFromStream(fin, tensor, dev_ctx);
+  }
+  fin.peek();
+  PADDLE_ENFORCE_EQ(fin.eof(),
+                    true,
+                    platform::errors::Unavailable(
+                        "Not allowed to load partial data via "
+                        "load_combine_op, please use load_op instead."));
+#endif
+}
+
 void SaveVars(const framework::Scope& scope,
               const std::vector<std::string>& vars,
               const std::string& dirname,
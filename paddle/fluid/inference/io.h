@@ -22,6 +22,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/scope.h"
 #include "paddle/fluid/platform/init.h"
+#include "paddle/utils/test_macros.h"
 
 namespace paddle {
 namespace inference {
@@ -33,7 +34,8 @@ void LoadPersistables(framework::Executor* executor,
                       const framework::ProgramDesc& main_program,
                       const std::string& dirname,
                       const std::string& param_filename,
-                      bool model_from_memory);
+                      bool model_from_memory,
+                      bool use_memory_map = false);
 
 std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                                              framework::Scope* scope,
@@ -43,7 +45,16 @@ std::unique_ptr<framework::ProgramDesc> Load(framework::Executor* executor,
                                              framework::Scope* scope,
                                              const std::string& prog_filename,
                                              const std::string& param_filename,
-                                             bool load_params = true);
+                                             bool load_params = true,
+                                             bool use_memory_map = false);
+
+// Loads the tensors saved by save_combine in file_path into out on CPU, in
+// order, like the load_combine op. The file is mapped into memory instead of
+// read: a tensor whose data is aligned to its element size in the file
+// aliases the mapping, so it is paged in on first use and its pages are
+// shared with the other processes mapping the file until written.
+TEST_API void LoadCombineFromMemoryMap(
+    const std::string& file_path, const std::vector<phi::DenseTensor*>& out);
 
 std::unique_ptr<framework::ProgramDesc> LoadFromMemory(
     framework::Executor* executor,
@@ -23,6 +23,7 @@
 #include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator_v2.h"
 #include "paddle/fluid/memory/allocation/cpu_allocator.h"
 #include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/pooled_cpu_allocator.h"
 #include "paddle/fluid/memory/allocation/retry_allocator.h"
 #include "paddle/fluid/memory/allocation/stat_allocator.h"
 #include "paddle/fluid/platform/device_context.h"
@@ -806,6 +807,11 @@ class AllocatorFacadePrivate {
     allocators_[platform::CPUPlace()] =
         std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace());
 #else
+    if (GetCPUAllocatorStrategy() == CPUAllocatorStrategy::kPooled) {
+      allocators_[platform::CPUPlace()] =
+          std::make_shared<PooledCPUAllocator>();
+      return;
+    }
     allocators_[platform::CPUPlace()] = std::make_shared<CPUAllocator>();
 #endif
   }
@@ -18,6 +18,7 @@
 #include "paddle/fluid/platform/enforce.h"
 
 COMMON_DECLARE_string(allocator_strategy);
+COMMON_DECLARE_string(cpu_allocator_strategy);
 
 namespace paddle {
 namespace memory {
@@ -47,6 +48,26 @@ AllocatorStrategy GetAllocatorStrategy() {
   return strategy;
 }
 
+static CPUAllocatorStrategy GetCPUStrategyFromFlag() {
+  if (FLAGS_cpu_allocator_strategy == "system") {
+    return CPUAllocatorStrategy::kSystem;
+  }
+
+  if (FLAGS_cpu_allocator_strategy == "pooled") {
+    return CPUAllocatorStrategy::kPooled;
+  }
+
+  PADDLE_THROW(platform::errors::InvalidArgument(
+      "Unsupported cpu allocator strategy: %s, candidates are system or "
+      "pooled.",
+      FLAGS_cpu_allocator_strategy));
+}
+
+CPUAllocatorStrategy GetCPUAllocatorStrategy() {
+  static CPUAllocatorStrategy strategy = GetCPUStrategyFromFlag();
+  return strategy;
+}
+
 void UseAllocatorStrategyGFlag() {}
 }  // namespace allocation
 }  // namespace memory
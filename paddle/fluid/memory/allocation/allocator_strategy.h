@@ -23,6 +23,13 @@ enum class AllocatorStrategy { kNaiveBestFit, kAutoGrowth, kThreadLocal };
 
 extern AllocatorStrategy GetAllocatorStrategy();
 
+// The allocator of CPUPlace, chosen independently of the device strategy
+// above. kSystem allocates from the system on every request, kPooled caches
+// the freed blocks in size class free lists (see PooledCPUAllocator).
+enum class CPUAllocatorStrategy { kSystem, kPooled };
+
+extern CPUAllocatorStrategy GetCPUAllocatorStrategy();
+
 // Do nothing, just make sure linker do not prune this file.
 TEST_API void UseAllocatorStrategyGFlag();
 
@@ -18,6 +18,7 @@
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <cstdlib>
 
 #include <atomic>
@@ -325,6 +326,43 @@ std::shared_ptr<MemoryMapReaderAllocation> RebuildMemoryMapReaderAllocation(
   return std::make_shared<MemoryMapReaderAllocation>(ptr, size, ipc_name);
 }
 
+std::shared_ptr<MappedFileAllocation> AllocateMappedFileAllocation(
+    const std::string &file_name) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_NE(
+      fd,
+      -1,
+      platform::errors::Unavailable("Failed to open file %s.", file_name));
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1 || file_stat.st_size <= 0) {
+    close(fd);
+    PADDLE_THROW(platform::errors::Unavailable(
+        "Failed to map file %s, it is empty or cannot be read.", file_name));
+  }
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  // the mapping keeps a reference to the file
+  close(fd);
+  PADDLE_ENFORCE_NE(
+      ptr,
+      MAP_FAILED,
+      platform::errors::Unavailable(
+          "Memory map of file %s failed: %s.", file_name, strerror(errno)));
+  VLOG(4) << "Map file " << file_name << " of " << size << " bytes";
+  return std::make_shared<MappedFileAllocation>(ptr, size, file_name);
+}
+
+void MappedFileAllocation::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  if (munmap(map_ptr_, map_size_) == -1) {
+    LOG(WARNING) << "Could not unmap file " << ipc_name_ << ": "
+                 << strerror(errno);
+  }
+}
+
 MemoryMapFdSet &MemoryMapFdSet::Instance() {  // NOLINT
   static MemoryMapFdSet set;
   return set;
@@ -154,6 +154,23 @@ std::shared_ptr<MemoryMapWriterAllocation> AllocateMemoryMapWriterAllocation(
 std::shared_ptr<MemoryMapReaderAllocation> RebuildMemoryMapReaderAllocation(
     const std::string &ipc_name, size_t size);
 
+// A private (copy-on-write) mapping of a regular file, e.g. the combined
+// parameters file of an inference model. Its pages are read from the page
+// cache on first access and shared with the other processes mapping the
+// file until they are written, the file itself is never modified.
+class MappedFileAllocation : public MemoryMapAllocation {
+ public:
+  explicit MappedFileAllocation(void *ptr, size_t size, std::string file_name)
+      : MemoryMapAllocation(ptr, size, std::move(file_name), -1) {}
+
+  void close() override;
+
+  ~MappedFileAllocation() override { close(); }
+};
+
+std::shared_ptr<MappedFileAllocation> AllocateMappedFileAllocation(
+    const std::string &file_name);
+
 class MemoryMapFdSet {
  public:
   static MemoryMapFdSet &Instance();  // NOLINT
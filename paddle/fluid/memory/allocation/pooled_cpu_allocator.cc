@@ -0,0 +1,428 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/pooled_cpu_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "paddle/common/flags.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/memory/stats.h"
+#include "paddle/fluid/platform/enforce.h"
+
+COMMON_DECLARE_int64(pooled_cpu_allocator_max_cached_mb);
+COMMON_DECLARE_bool(pooled_cpu_allocator_use_huge_page);
+
+namespace paddle::memory::allocation {
+
+namespace {
+
+constexpr size_t kHugePageSize = 2UL << 20;
+// the blocks held by one magazine
+constexpr size_t kMagazineBytes = 512UL << 10;
+constexpr size_t kMaxMagazineSize = 64;
+
+// floor(log2(x)) for x > 0
+inline int FloorLog2(size_t x) {
+#if defined(_WIN32)
+  int k = 0;
+  while (x >>= 1) {
+    ++k;
+  }
+  return k;
+#else
+  return 63 - __builtin_clzll(static_cast<uint64_t>(x));
+#endif
+}
+
+PooledCPUAllocator::Options OptionsFromFlags() {
+  PooledCPUAllocator::Options options;
+  options.max_cached_bytes =
+      static_cast<size_t>(FLAGS_pooled_cpu_allocator_max_cached_mb) << 20;
+  options.use_huge_page = FLAGS_pooled_cpu_allocator_use_huge_page;
+  return options;
+}
+
+}  // namespace
+
+// The free lists shared by all threads. It is owned by the allocator and by
+// the thread caches, so that a thread exiting after the allocator is gone
+// can still hand its blocks back.
+class PooledCPUCentralPool {
+ public:
+  explicit PooledCPUCentralPool(const PooledCPUAllocator::Options& options)
+      : options_(options) {}
+
+  ~PooledCPUCentralPool() { Trim(0); }
+
+  void* SystemAlloc(size_t bytes) {
+    size_t alignment = bytes < CPUAllocator::kAlignment
+                           ? PooledCPUAllocator::kMinSizeClass
+                           : CPUAllocator::kAlignment;
+    bool huge_page = options_.use_huge_page && bytes >= kHugePageSize;
+    if (huge_page) {
+      alignment = kHugePageSize;
+    }
+    void* p = nullptr;
+    int error = posix_memalign(&p, alignment, bytes);
+    if (error != 0) {
+      // the cached blocks may be of the wrong classes, give them back and
+      // try once more
+      Trim(0);
+      error = posix_memalign(&p, alignment, bytes);
+    }
+    PADDLE_ENFORCE_EQ(
+        error,
+        0,
+        platform::errors::ResourceExhausted(
+            "Fail to alloc memory of %ld size, error code is %d.",
+            bytes,
+            error));
+#if defined(MADV_HUGEPAGE)
+    if (huge_page) {
+      // only advisory, the pages stay normal if THP is disabled
+      madvise(p, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    system_alloc_count_.fetch_add(1, std::memory_order_relaxed);
+    reserved_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    HOST_MEMORY_STAT_UPDATE(Reserved, 0, bytes);
+    return p;
+  }
+
+  void SystemFree(void* p, size_t bytes) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);  // NOLINT
+#endif
+    system_free_count_.fetch_add(1, std::memory_order_relaxed);
+    reserved_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    HOST_MEMORY_STAT_UPDATE(Reserved, 0, -static_cast<int64_t>(bytes));
+  }
+
+  // moves up to num blocks of class index into blocks, the most recently
+  // freed ones first
+  size_t Fetch(size_t index, size_t num, void** blocks) {
+    FreeList& list = lists_[index];
+    std::lock_guard<std::mutex> guard(list.mutex);
+    num = std::min(num, list.blocks.size());
+    if (num == 0) {
+      return 0;
+    }
+    std::copy(list.blocks.end() - num, list.blocks.end(), blocks);
+    list.blocks.resize(list.blocks.size() - num);
+    cached_bytes_.fetch_sub(num * PooledCPUAllocator::SizeClassBytes(index),
+                            std::memory_order_relaxed);
+    return num;
+  }
+
+  void Put(size_t index, void* const* blocks, size_t num) {
+    size_t bytes = num * PooledCPUAllocator::SizeClassBytes(index);
+    {
+      FreeList& list = lists_[index];
+      std::lock_guard<std::mutex> guard(list.mutex);
+      list.blocks.insert(list.blocks.end(), blocks, blocks + num);
+    }
+    size_t cached =
+        cached_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (cached > options_.max_cached_bytes) {
+      // trim to 3/4 of the watermark so that a workload running right at
+      // the watermark does not release on every free
+      Trim(options_.max_cached_bytes / 4 * 3);
+    }
+  }
+
+  // releases the oldest blocks of the largest classes until at most target
+  // bytes are cached, returns the released bytes
+  uint64_t Trim(size_t target) {
+    std::lock_guard<std::mutex> trim_guard(trim_mutex_);
+    uint64_t released = 0;
+    std::vector<void*> victims;
+    for (size_t index = PooledCPUAllocator::kNumSizeClasses; index-- > 0;) {
+      size_t cached = cached_bytes_.load(std::memory_order_relaxed);
+      if (cached <= target) {
+        break;
+      }
+      size_t bytes = PooledCPUAllocator::SizeClassBytes(index);
+      {
+        FreeList& list = lists_[index];
+        std::lock_guard<std::mutex> guard(list.mutex);
+        size_t num = std::min((cached - target + bytes - 1) / bytes,
+                              list.blocks.size());
+        victims.assign(list.blocks.begin(), list.blocks.begin() + num);
+        list.blocks.erase(list.blocks.begin(), list.blocks.begin() + num);
+      }
+      cached_bytes_.fetch_sub(victims.size() * bytes,
+                              std::memory_order_relaxed);
+      for (void* p : victims) {
+        SystemFree(p, bytes);
+      }
+      released += victims.size() * bytes;
+    }
+    if (released > 0) {
+      HOST_MEMORY_STAT_UPDATE(Cached, 0, -static_cast<int64_t>(released));
+      VLOG(4) << "PooledCPUAllocator releases " << released
+              << " bytes to the system, cached "
+              << cached_bytes_.load(std::memory_order_relaxed) << " bytes";
+    }
+    return released;
+  }
+
+  void Close() { closed_.store(true, std::memory_order_release); }
+  bool IsClosed() const { return closed_.load(std::memory_order_acquire); }
+
+  PooledCPUAllocator::Stats GetStats() const {
+    PooledCPUAllocator::Stats stats;
+    stats.system_alloc_count =
+        system_alloc_count_.load(std::memory_order_relaxed);
+    stats.system_free_count =
+        system_free_count_.load(std::memory_order_relaxed);
+    stats.reserved_bytes = reserved_bytes_.load(std::memory_order_relaxed);
+    stats.central_cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<void*> blocks;
+  };
+
+  PooledCPUAllocator::Options options_;
+  FreeList lists_[PooledCPUAllocator::kNumSizeClasses];
+  std::atomic<size_t> cached_bytes_{0};
+  std::mutex trim_mutex_;
+  std::atomic<bool> closed_{false};
+
+  std::atomic<uint64_t> system_alloc_count_{0};
+  std::atomic<uint64_t> system_free_count_{0};
+  std::atomic<uint64_t> reserved_bytes_{0};
+};
+
+namespace {
+
+// The magazines of one thread for one pool, refilled from and flushed to the
+// central free lists half a magazine at a time.
+class PooledCPUThreadCache {
+ public:
+  explicit PooledCPUThreadCache(std::shared_ptr<PooledCPUCentralPool> pool)
+      : pool_(std::move(pool)) {
+    for (size_t index = 0; index < kNumMagazines; ++index) {
+      size_t capacity =
+          kMagazineBytes / PooledCPUAllocator::SizeClassBytes(index);
+      magazines_[index].capacity = std::min(capacity, kMaxMagazineSize);
+    }
+  }
+
+  ~PooledCPUThreadCache() { Flush(); }
+
+  PooledCPUCentralPool* pool() const { return pool_.get(); }
+
+  // nullptr if the central free list is empty too
+  void* Allocate(size_t index) {
+    Magazine& magazine = magazines_[index];
+    if (magazine.size == 0) {
+      magazine.size =
+          pool_->Fetch(index, (magazine.capacity + 1) / 2, magazine.blocks);
+      if (magazine.size == 0) {
+        return nullptr;
+      }
+    }
+    return magazine.blocks[--magazine.size];
+  }
+
+  void Free(size_t index, void* p) {
+    Magazine& magazine = magazines_[index];
+    if (magazine.size == magazine.capacity) {
+      size_t keep = magazine.capacity / 2;
+      pool_->Put(index, magazine.blocks + keep, magazine.size - keep);
+      magazine.size = keep;
+    }
+    magazine.blocks[magazine.size++] = p;
+  }
+
+  void Flush() {
+    for (size_t index = 0; index < kNumMagazines; ++index) {
+      Magazine& magazine = magazines_[index];
+      if (magazine.size > 0) {
+        pool_->Put(index, magazine.blocks, magazine.size);
+        magazine.size = 0;
+      }
+    }
+  }
+
+  static constexpr size_t kNumMagazines =
+      PooledCPUAllocator::kNumSizeClasses;
+
+ private:
+  struct Magazine {
+    size_t capacity{0};
+    size_t size{0};
+    void* blocks[kMaxMagazineSize];
+  };
+
+  std::shared_ptr<PooledCPUCentralPool> pool_;
+  Magazine magazines_[kNumMagazines];
+};
+
+// The caches of the current thread, one per live pool. The pointers below
+// are trivially destructible, so they stay usable when the registry has
+// already been destroyed at thread exit, e.g. by a free from the destructor
+// of another thread local.
+struct PooledCPUThreadCacheRegistry {
+  ~PooledCPUThreadCacheRegistry();
+  std::vector<std::unique_ptr<PooledCPUThreadCache>> caches;
+};
+
+thread_local PooledCPUThreadCache* tls_last_cache = nullptr;
+thread_local bool tls_registry_destroyed = false;
+
+PooledCPUThreadCacheRegistry::~PooledCPUThreadCacheRegistry() {
+  tls_last_cache = nullptr;
+  tls_registry_destroyed = true;
+}
+
+PooledCPUThreadCache* GetThreadCache(
+    const std::shared_ptr<PooledCPUCentralPool>& pool) {
+  if (tls_last_cache != nullptr && tls_last_cache->pool() == pool.get()) {
+    return tls_last_cache;
+  }
+  if (tls_registry_destroyed) {
+    return nullptr;
+  }
+  thread_local PooledCPUThreadCacheRegistry registry;
+  auto& caches = registry.caches;
+  // the caches of destroyed allocators go back to their pools here
+  caches.erase(std::remove_if(caches.begin(),
+                              caches.end(),
+                              [](const auto& cache) {
+                                return cache->pool()->IsClosed();
+                              }),
+               caches.end());
+  for (auto& cache : caches) {
+    if (cache->pool() == pool.get()) {
+      tls_last_cache = cache.get();
+      return tls_last_cache;
+    }
+  }
+  caches.emplace_back(std::make_unique<PooledCPUThreadCache>(pool));
+  tls_last_cache = caches.back().get();
+  return tls_last_cache;
+}
+
+}  // namespace
+
+PooledCPUAllocator::PooledCPUAllocator()
+    : PooledCPUAllocator(OptionsFromFlags()) {}
+
+PooledCPUAllocator::PooledCPUAllocator(const Options& options)
+    : pool_(std::make_shared<PooledCPUCentralPool>(options)) {
+  VLOG(1) << "PooledCPUAllocator max_cached_bytes " << options.max_cached_bytes
+          << ", use_huge_page " << options.use_huge_page;
+}
+
+PooledCPUAllocator::~PooledCPUAllocator() {
+  pool_->Close();
+  // the cache of the current thread is dropped right away, the other
+  // threads drop theirs on the next allocation or at exit
+  if (tls_last_cache != nullptr && tls_last_cache->pool() == pool_.get()) {
+    tls_last_cache = nullptr;
+  }
+}
+
+size_t PooledCPUAllocator::SizeClassIndex(size_t size) {
+  if (size <= kMinSizeClass) {
+    return 0;
+  }
+  // 2^k < size <= 2^(k+1) is split into four classes of 2^(k-2) bytes
+  int k = FloorLog2(size - 1);
+  size_t step_index = (size - 1 - (1UL << k)) >> (k - 2);
+  return 1 + (k - 6) * 4 + step_index;
+}
+
+size_t PooledCPUAllocator::SizeClassBytes(size_t index) {
+  if (index == 0) {
+    return kMinSizeClass;
+  }
+  size_t k = (index - 1) / 4 + 6;
+  size_t step_index = (index - 1) % 4;
+  return (1UL << k) + ((step_index + 1) << (k - 2));
+}
+
+PooledCPUAllocator::Stats PooledCPUAllocator::GetStats() const {
+  return pool_->GetStats();
+}
+
+phi::Allocation* PooledCPUAllocator::AllocateImpl(size_t size) {
+  if (UNLIKELY(size > kMaxPooledSize)) {
+    return new Allocation(
+        pool_->SystemAlloc(size), size, platform::CPUPlace());
+  }
+  size_t index = SizeClassIndex(size);
+  size_t bytes = SizeClassBytes(index);
+  void* p = nullptr;
+  PooledCPUThreadCache* cache =
+      bytes <= kMaxMagazineBlockSize ? GetThreadCache(pool_) : nullptr;
+  if (cache != nullptr) {
+    p = cache->Allocate(index);
+  } else {
+    pool_->Fetch(index, 1, &p);
+  }
+  if (p != nullptr) {
+    HOST_MEMORY_STAT_UPDATE(Cached, 0, -static_cast<int64_t>(bytes));
+  } else {
+    p = pool_->SystemAlloc(bytes);
+  }
+  return new Allocation(p, size, platform::CPUPlace());
+}
+
+void PooledCPUAllocator::FreeImpl(phi::Allocation* allocation) {
+  size_t size = allocation->size();
+  void* p = allocation->ptr();
+  delete allocation;
+  if (UNLIKELY(size > kMaxPooledSize)) {
+    pool_->SystemFree(p, size);
+    return;
+  }
+  size_t index = SizeClassIndex(size);
+  size_t bytes = SizeClassBytes(index);
+  HOST_MEMORY_STAT_UPDATE(Cached, 0, bytes);
+  PooledCPUThreadCache* cache =
+      bytes <= kMaxMagazineBlockSize ? GetThreadCache(pool_) : nullptr;
+  if (cache != nullptr) {
+    cache->Free(index, p);
+  } else {
+    pool_->Put(index, &p, 1);
+  }
+}
+
+uint64_t PooledCPUAllocator::ReleaseImpl(
+    const platform::Place& place UNUSED) {
+  PooledCPUThreadCache* cache = GetThreadCache(pool_);
+  if (cache != nullptr) {
+    cache->Flush();
+  }
+  return pool_->Trim(0);
+}
+
+}  // namespace paddle::memory::allocation
@@ -0,0 +1,89 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+class PooledCPUCentralPool;
+
+// A caching allocator for CPUPlace. Requests are rounded up to size classes
+// (four classes per power of two, so at most 25% is wasted) and freed blocks
+// are kept in per class free lists instead of going back to the system:
+//
+//   thread cache (magazines, no lock) -> central free list (lock per class)
+//     -> posix_memalign
+//
+// Each thread owns a small magazine per class for blocks up to
+// kMaxMagazineBlockSize, which are refilled from and flushed to the central
+// lists in batches. Cached bytes above max_cached_bytes are released to the
+// system, oldest blocks of the largest classes first. Requests larger than
+// kMaxPooledSize are not cached.
+class PooledCPUAllocator : public Allocator {
+ public:
+  struct Options {
+    // the release to OS watermark of the central free lists
+    size_t max_cached_bytes{1UL << 30};
+    // back blocks of at least 2MB with transparent huge pages
+    bool use_huge_page{false};
+  };
+
+  struct Stats {
+    uint64_t system_alloc_count{0};
+    uint64_t system_free_count{0};
+    // bytes obtained from the system and not yet returned
+    uint64_t reserved_bytes{0};
+    // bytes in the central free lists, the thread caches not included
+    uint64_t central_cached_bytes{0};
+  };
+
+  static constexpr size_t kMinSizeClass = 64;
+  static constexpr size_t kMaxPooledSize = 1UL << 28;
+  static constexpr size_t kMaxMagazineBlockSize = 256UL << 10;
+  static constexpr size_t kNumSizeClasses = 89;
+
+  // options are read from FLAGS_pooled_cpu_allocator_*
+  PooledCPUAllocator();
+  explicit PooledCPUAllocator(const Options& options);
+  ~PooledCPUAllocator() override;
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  Stats GetStats() const;
+
+  // the size class of size, which must not exceed kMaxPooledSize
+  static size_t SizeClassIndex(size_t size);
+  static size_t SizeClassBytes(size_t index);
+
+ protected:
+  phi::Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(phi::Allocation* allocation) override;
+  // flushes the magazines of the calling thread and releases all cached
+  // blocks of the central free lists
+  uint64_t ReleaseImpl(const platform::Place& place) override;
+
+ private:
+  std::shared_ptr<PooledCPUCentralPool> pool_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
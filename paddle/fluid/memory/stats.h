@@ -230,6 +230,8 @@ DEVICE_MEMORY_STAT_DECLARE(Reserved);
 
 HOST_MEMORY_STAT_DECLARE(Allocated);
 HOST_MEMORY_STAT_DECLARE(Reserved);
+// bytes kept in the free lists of the pooled CPU allocator
+HOST_MEMORY_STAT_DECLARE(Cached);
 
 }  // namespace memory
 }  // namespace paddle
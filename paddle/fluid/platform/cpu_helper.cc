@@ -14,6 +14,8 @@ limitations under the License. */
 
 #include "paddle/fluid/platform/cpu_helper.h"
 
+#include "paddle/phi/backends/cpu/intra_op_thread_pool.h"
+
 #ifdef PADDLE_WITH_MKLML
 #include <omp.h>
 
@@ -30,6 +32,8 @@ namespace paddle {
 namespace platform {
 
 void SetNumThreads(int num_threads) {
+  // the thread budget of the parallel loops of the phi CPU kernels
+  phi::SetIntraOpNumThreads(num_threads > 1 ? num_threads : 1);
 #ifdef PADDLE_USE_OPENBLAS
 // windows has no support for openblas multi-thread
 // please refer to: https://github.com/PaddlePaddle/Paddle/issues/7234
@@ -19,7 +19,8 @@ limitations under the License. */
 namespace paddle {
 namespace platform {
 
-//! Set the number of threads in use.
+//! Set the number of threads in use by the calling thread: the threads of
+//! the math library and the budget of phi::funcs::ParallelFor.
 void SetNumThreads(int num_threads);
 
 }  // namespace platform
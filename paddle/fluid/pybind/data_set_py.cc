@@ -285,6 +285,9 @@ void BindDataset(py::module *m) {
       .def("local_shuffle",
            &framework::Dataset::LocalShuffle,
            py::call_guard<py::gil_scoped_release>())
+      .def("convert_to_binary_files",
+           &framework::Dataset::ConvertToBinaryFiles,
+           py::call_guard<py::gil_scoped_release>())
       .def("global_shuffle",
            &framework::Dataset::GlobalShuffle,
            py::call_guard<py::gil_scoped_release>())
@@ -14,6 +14,7 @@
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
 
+#include "paddle/phi/backends/cpu/intra_op_thread_pool.h"
 #include "paddle/phi/common/place.h"
 #include "paddle/phi/core/enforce.h"
 
@@ -50,6 +51,7 @@ struct CPUContext::Impl {
 
   bool owned_{false};
   Eigen::DefaultDevice* eigen_device_{nullptr};
+  IntraOpThreadPool* intra_op_pool_{nullptr};  // not owned
   Place place_;
 };
 
@@ -75,6 +77,15 @@ Eigen::DefaultDevice* CPUContext::eigen_device() const {
 
 const Place& CPUContext::GetPlace() const { return impl_->place_; }
 
+IntraOpThreadPool* CPUContext::GetIntraOpThreadPool() const {
+  return impl_->intra_op_pool_ ? impl_->intra_op_pool_
+                               : IntraOpThreadPool::GetInstance();
+}
+
+void CPUContext::SetIntraOpThreadPool(IntraOpThreadPool* pool) {
+  impl_->intra_op_pool_ = pool;
+}
+
 void CPUContext::SetEigenDevice(Eigen::DefaultDevice* device) {
   impl_->eigen_device_ = device;
 }
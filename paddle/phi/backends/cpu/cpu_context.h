@@ -24,6 +24,8 @@ limitations under the License. */
 
 namespace phi {
 
+class IntraOpThreadPool;
+
 class PADDLE_API CPUContext : public DeviceContext,
                               public TypeInfoTraits<DeviceContext, CPUContext> {
  public:
@@ -35,6 +37,13 @@ class PADDLE_API CPUContext : public DeviceContext,
   Eigen::DefaultDevice* eigen_device() const;
   const Place& GetPlace() const override;
 
+  // The thread pool running the parallel loops of the kernels, the shared
+  // IntraOpThreadPool::GetInstance() unless set.
+  IntraOpThreadPool* GetIntraOpThreadPool() const;
+  // Runs the parallel loops on pool, which is not owned. nullptr restores
+  // the shared pool.
+  void SetIntraOpThreadPool(IntraOpThreadPool* pool);
+
   static const char* name() { return "CPUContext"; }
 
  protected:
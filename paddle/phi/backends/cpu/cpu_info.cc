@@ -27,13 +27,22 @@ limitations under the License. */
 #include <unistd.h>
 #endif  // _WIN32
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
 #ifdef PADDLE_WITH_XBYAK
 #include "xbyak/xbyak_util.h"
 #endif
 
 #include <algorithm>
+#include <fstream>
+#include <string>
 
+#include "glog/logging.h"
 #include "paddle/common/flags.h"
+#include "paddle/utils/string/string_helper.h"
 
 COMMON_DECLARE_double(fraction_of_cpu_memory_to_use);
 COMMON_DECLARE_uint64(initial_cpu_memory_in_mb);
@@ -199,6 +208,214 @@ bool MayIUse(const cpu_isa_t cpu_isa) {
 }
 #endif
 
+namespace {
+
+// the node the calling thread is bound to by BindCurrentThreadToNumaNode
+thread_local int tls_numa_node = -1;
+
+#ifdef __linux__
+// MPOL_DEFAULT and MPOL_PREFERRED of <numaif.h>, without linking libnuma
+constexpr int kMemPolicyDefault = 0;
+constexpr int kMemPolicyPreferred = 1;
+
+bool ReadFirstLine(const std::string& path, std::string* line) {
+  std::ifstream fin(path);
+  return fin.is_open() && std::getline(fin, *line);
+}
+
+// parses a cpu or node list of sysfs such as "0-3,8-11"
+std::vector<int> ParseIdList(const std::string& list) {
+  std::vector<int> ids;
+  for (auto& range : paddle::string::split_string(list, ",")) {
+    if (range.empty()) {
+      continue;
+    }
+    size_t dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first
+                                         : std::stoi(range.substr(dash + 1));
+    for (int id = first; id <= last; ++id) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+std::vector<CpuNumaNode> ReadCpuNumaNodes() {
+  std::vector<CpuNumaNode> nodes;
+  std::string list;
+  if (!ReadFirstLine("/sys/devices/system/node/online", &list)) {
+    return nodes;
+  }
+  try {
+    for (int id : ParseIdList(list)) {
+      std::string cpus;
+      if (!ReadFirstLine("/sys/devices/system/node/node" +
+                             std::to_string(id) + "/cpulist",
+                         &cpus)) {
+        continue;
+      }
+      CpuNumaNode node{id, ParseIdList(cpus)};
+      // memory only nodes have no cpus to run on
+      if (!node.cpus.empty()) {
+        nodes.push_back(std::move(node));
+      }
+    }
+  } catch (const std::exception& e) {
+    VLOG(3) << "Failed to read the NUMA topology: " << e.what();
+    nodes.clear();
+  }
+  return nodes;
+}
+
+bool SetCpuAffinity(const std::vector<int>& cpus) {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &mask);
+    }
+  }
+  return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+}
+
+constexpr int kBitsPerLong = sizeof(unsigned long) * 8;  // NOLINT
+// get_mempolicy refuses a mask shorter than the possible nodes, the kernel
+// supports at most 1024 of them
+constexpr int kMaxMemPolicyNodes = 1024;
+
+bool SetMemPolicy(int mode,
+                  const std::vector<unsigned long>& nodemask) {  // NOLINT
+  // the kernel reads maxnode - 1 bits
+  unsigned long maxnode = nodemask.size() * kBitsPerLong + 1;  // NOLINT
+  return syscall(SYS_set_mempolicy,
+                 mode,
+                 nodemask.empty() ? nullptr : nodemask.data(),
+                 nodemask.empty() ? 0 : maxnode) == 0;
+}
+
+bool SetMemPolicy(int mode, int node) {
+  std::vector<unsigned long> nodemask;  // NOLINT
+  if (mode != kMemPolicyDefault) {
+    nodemask.resize(node / kBitsPerLong + 1, 0);
+    nodemask[node / kBitsPerLong] |= 1UL << (node % kBitsPerLong);
+  }
+  return SetMemPolicy(mode, nodemask);
+}
+
+// the mode returned keeps its MPOL_F_STATIC_NODES and MPOL_F_RELATIVE_NODES
+// flags, so that it can be set again as it is
+bool GetMemPolicy(int* mode, std::vector<unsigned long>* nodemask) {  // NOLINT
+  nodemask->assign(kMaxMemPolicyNodes / kBitsPerLong, 0);
+  return syscall(SYS_get_mempolicy,
+                 mode,
+                 nodemask->data(),
+                 kMaxMemPolicyNodes,
+                 nullptr,
+                 0) == 0;
+}
+#endif
+
+}  // namespace
+
+const std::vector<CpuNumaNode>& CpuNumaNodes() {
+  static const std::vector<CpuNumaNode> nodes = [] {
+    std::vector<CpuNumaNode> nodes;
+#ifdef __linux__
+    nodes = ReadCpuNumaNodes();
+#endif
+    if (nodes.empty()) {
+      CpuNumaNode node{0, {}};
+#ifdef _WIN32
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      int num_cpus = static_cast<int>(info.dwNumberOfProcessors);
+#else
+      int num_cpus = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+      for (int cpu = 0; cpu < num_cpus; ++cpu) {
+        node.cpus.push_back(cpu);
+      }
+      nodes.push_back(std::move(node));
+    }
+    return nodes;
+  }();
+  return nodes;
+}
+
+bool BindCurrentThreadToNumaNode(int node, bool bind_memory) {
+#ifdef __linux__
+  const auto& nodes = CpuNumaNodes();
+  auto iter = std::find_if(
+      nodes.begin(), nodes.end(), [node](const CpuNumaNode& n) {
+        return n.id == node;
+      });
+  if (iter == nodes.end()) {
+    VLOG(3) << "There is no NUMA node " << node << " to bind to";
+    return false;
+  }
+  if (!SetCpuAffinity(iter->cpus)) {
+    VLOG(3) << "Failed to set the cpu affinity to NUMA node " << node;
+    return false;
+  }
+  // there is no remote memory on a single node
+  if (bind_memory && nodes.size() > 1 &&
+      !SetMemPolicy(kMemPolicyPreferred, node)) {
+    VLOG(3) << "Failed to prefer the memory of NUMA node " << node;
+  }
+  tls_numa_node = node;
+  return true;
+#else
+  return false;
+#endif
+}
+
+ScopedNumaNodeBinding::ScopedNumaNodeBinding(int node) {
+#ifdef __linux__
+  if (node < 0 || node == tls_numa_node) {
+    return;
+  }
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+    return;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &mask)) {
+      last_cpus_.push_back(cpu);
+    }
+  }
+  // the memory policy is only changed if there are several nodes
+  if (CpuNumaNodes().size() > 1) {
+    has_last_mem_policy_ = GetMemPolicy(&last_mem_mode_, &last_mem_nodes_);
+    if (!has_last_mem_policy_) {
+      VLOG(3) << "Failed to get the memory policy, the default one is "
+                 "restored after the NUMA node binding";
+    }
+  }
+  last_node_ = tls_numa_node;
+  active_ = BindCurrentThreadToNumaNode(node, true);
+#endif
+}
+
+ScopedNumaNodeBinding::~ScopedNumaNodeBinding() {
+#ifdef __linux__
+  if (!active_) {
+    return;
+  }
+  SetCpuAffinity(last_cpus_);
+  if (CpuNumaNodes().size() > 1) {
+    bool restored = has_last_mem_policy_
+                        ? SetMemPolicy(last_mem_mode_, last_mem_nodes_)
+                        : SetMemPolicy(kMemPolicyDefault, 0);
+    if (!restored) {
+      VLOG(3) << "Failed to restore the memory policy";
+    }
+  }
+  tls_numa_node = last_node_;
+#endif
+}
+
 }  // namespace cpu
 }  // namespace backends
 }  // namespace phi
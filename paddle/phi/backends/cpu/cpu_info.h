@@ -16,6 +16,8 @@
 
 #include <stddef.h>
 
+#include <vector>
+
 #ifdef _WIN32
 #if defined(__AVX2__)
 #include <immintrin.h>  // avx2
@@ -92,6 +94,41 @@ typedef enum {
 
 // May I use some instruction
 TEST_API bool MayIUse(const cpu_isa_t cpu_isa);
+
+//! A NUMA node (usually a socket) and the logical cpus in it.
+struct CpuNumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+//! Get the NUMA nodes with cpus, read once from sysfs. It is one node with
+//! all the online cpus if the topology is unknown.
+TEST_API const std::vector<CpuNumaNode>& CpuNumaNodes();
+
+//! Pin the calling thread to the cpus of a NUMA node and, if bind_memory,
+//! prefer the node for the pages it allocates. Returns false if the node
+//! does not exist or the binding is not supported.
+TEST_API bool BindCurrentThreadToNumaNode(int node, bool bind_memory = true);
+
+//! Binds the calling thread to a NUMA node while in scope, and restores its
+//! cpu affinity and memory policy afterwards. It does nothing for a negative
+//! node or if the thread is already bound to the node.
+class TEST_API ScopedNumaNodeBinding {
+ public:
+  explicit ScopedNumaNodeBinding(int node);
+  ~ScopedNumaNodeBinding();
+
+  ScopedNumaNodeBinding(const ScopedNumaNodeBinding&) = delete;
+  ScopedNumaNodeBinding& operator=(const ScopedNumaNodeBinding&) = delete;
+
+ private:
+  bool active_{false};
+  int last_node_{-1};
+  std::vector<int> last_cpus_;
+  bool has_last_mem_policy_{false};
+  int last_mem_mode_{0};
+  std::vector<unsigned long> last_mem_nodes_;  // NOLINT
+};
 }  // namespace cpu
 }  // namespace backends
 }  // namespace phi
@@ -0,0 +1,184 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/backends/cpu/intra_op_thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#include "glog/logging.h"
+#include "paddle/common/flags.h"
+
+COMMON_DECLARE_int32(cpu_intra_op_num_threads);
+
+namespace phi {
+
+namespace {
+
+thread_local bool tls_in_parallel_region = false;
+thread_local int tls_intra_op_num_threads = 0;
+
+}  // namespace
+
+struct IntraOpThreadPool::Job {
+  Job(int64_t num_tasks, const std::function<void(int64_t)>* fn)
+      : num_tasks(num_tasks), fn(fn) {}
+
+  // runs tasks until none is left to start
+  void RunTasks() {
+    bool in_parallel_region = tls_in_parallel_region;
+    tls_in_parallel_region = true;
+    int64_t idx;
+    while ((idx = next.fetch_add(1, std::memory_order_relaxed)) < num_tasks) {
+      try {
+        (*fn)(idx);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!exception) {
+          exception = std::current_exception();
+        }
+      }
+      if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == num_tasks) {
+        std::lock_guard<std::mutex> guard(mutex);
+        finished.notify_all();
+      }
+    }
+    tls_in_parallel_region = in_parallel_region;
+  }
+
+  bool HasTasksToStart() const {
+    return next.load(std::memory_order_relaxed) < num_tasks;
+  }
+
+  const int64_t num_tasks;
+  const std::function<void(int64_t)>* fn;  // not owned
+  std::atomic<int64_t> next{0};
+  std::atomic<int64_t> done{0};
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::exception_ptr exception;
+};
+
+IntraOpThreadPool::IntraOpThreadPool(int num_threads)
+    : num_threads_(std::max(num_threads, 1)) {
+  threads_.reserve(num_threads_ - 1);
+  for (int i = 0; i < num_threads_ - 1; ++i) {
+    threads_.emplace_back([this] { WorkerLoop(); });
+  }
+  VLOG(3) << "IntraOpThreadPool with " << num_threads_ << " threads";
+}
+
+IntraOpThreadPool::~IntraOpThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    running_ = false;
+  }
+  scheduled_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+IntraOpThreadPool* IntraOpThreadPool::GetInstance() {
+  static IntraOpThreadPool* pool = [] {
+    int num_threads = FLAGS_cpu_intra_op_num_threads;
+    if (num_threads <= 0) {
+      num_threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    // never destroyed, the workers may outlive the other statics
+    return new IntraOpThreadPool(num_threads);
+  }();
+  return pool;
+}
+
+bool IntraOpThreadPool::InParallelRegion() { return tls_in_parallel_region; }
+
+void IntraOpThreadPool::Run(int64_t num_tasks,
+                            const std::function<void(int64_t)>& fn) {
+  if (num_tasks <= 0) {
+    return;
+  }
+  if (num_tasks == 1 || threads_.empty() || tls_in_parallel_region) {
+    bool in_parallel_region = tls_in_parallel_region;
+    tls_in_parallel_region = true;
+    try {
+      for (int64_t i = 0; i < num_tasks; ++i) {
+        fn(i);
+      }
+    } catch (...) {
+      tls_in_parallel_region = in_parallel_region;
+      throw;
+    }
+    tls_in_parallel_region = in_parallel_region;
+    return;
+  }
+
+  auto job = std::make_shared<Job>(num_tasks, &fn);
+  int64_t num_helpers =
+      std::min<int64_t>(num_tasks - 1, static_cast<int64_t>(threads_.size()));
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    jobs_.push_back(job);
+  }
+  for (int64_t i = 0; i < num_helpers; ++i) {
+    scheduled_.notify_one();
+  }
+  job->RunTasks();
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto iter = std::find(jobs_.begin(), jobs_.end(), job);
+    if (iter != jobs_.end()) {
+      jobs_.erase(iter);
+    }
+  }
+  // the tasks started by the workers may still run
+  if (job->done.load(std::memory_order_acquire) < num_tasks) {
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->finished.wait(lock, [&job, num_tasks] {
+      return job->done.load(std::memory_order_acquire) == num_tasks;
+    });
+  }
+  if (job->exception) {
+    std::rethrow_exception(job->exception);
+  }
+}
+
+void IntraOpThreadPool::WorkerLoop() {
+  while (true) {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      scheduled_.wait(lock, [this] { return !running_ || !jobs_.empty(); });
+      if (!running_) {
+        return;
+      }
+      job = jobs_.front();
+      // a job whose tasks are all started needs no more threads
+      if (!job->HasTasksToStart()) {
+        jobs_.pop_front();
+        continue;
+      }
+    }
+    job->RunTasks();
+  }
+}
+
+void SetIntraOpNumThreads(int num_threads) {
+  tls_intra_op_num_threads = std::max(num_threads, 0);
+}
+
+int GetIntraOpNumThreads() { return tls_intra_op_num_threads; }
+
+}  // namespace phi
@@ -0,0 +1,83 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paddle/common/macros.h"
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+
+// IntraOpThreadPool runs the parallel loops of the CPU kernels, see
+// phi::funcs::ParallelFor. It has num_threads - 1 worker threads, the thread
+// calling Run is the last one and takes part in its own loop.
+//
+// Several threads may call Run at the same time, e.g. the workers of the new
+// executor or the predictors of a process, they share the worker threads
+// instead of each starting its own OpenMP team, so at most num_threads
+// threads run kernels besides the callers.
+class TEST_API IntraOpThreadPool {
+ public:
+  explicit IntraOpThreadPool(int num_threads);
+
+  ~IntraOpThreadPool();
+
+  // The pool shared by the CPUContexts, of FLAGS_cpu_intra_op_num_threads
+  // threads.
+  static IntraOpThreadPool* GetInstance();
+
+  int NumThreads() const { return num_threads_; }
+
+  // Calls fn(i) for every i in [0, num_tasks), on at most num_tasks threads
+  // including the caller, and returns when all calls are done. A task run by
+  // the pool that calls Run again runs the nested tasks serially. The first
+  // exception thrown by fn is rethrown.
+  void Run(int64_t num_tasks, const std::function<void(int64_t)>& fn);
+
+  // Whether the calling thread is running a task of Run.
+  static bool InParallelRegion();
+
+ private:
+  DISABLE_COPY_AND_ASSIGN(IntraOpThreadPool);
+
+  struct Job;
+
+  void WorkerLoop();
+
+  int num_threads_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable scheduled_;
+  // the jobs with tasks nobody has started yet, the oldest first
+  std::deque<std::shared_ptr<Job>> jobs_;
+  bool running_{true};
+};
+
+// The number of threads a parallel loop started by the calling thread may
+// use, set by paddle::platform::SetNumThreads like omp_set_num_threads.
+// 0 (default) means all the threads of the pool.
+TEST_API void SetIntraOpNumThreads(int num_threads);
+TEST_API int GetIntraOpNumThreads();
+
+}  // namespace phi
@@ -5029,6 +5029,53 @@ void StackInferMeta(const std::vector<const MetaTensor*>& x,
   out->share_lod(*x.at(0));
 }
 
+void TopKTopPSamplingInferMeta(const MetaTensor& x,
+                               const MetaTensor& ps,
+                               const MetaTensor& threshold,
+                               const MetaTensor& pre_ids,
+                               int top_k,
+                               float temperature,
+                               float repetition_penalty,
+                               float presence_penalty,
+                               bool is_logits,
+                               int random_seed,
+                               MetaTensor* out,
+                               MetaTensor* ids) {
+  TopPSamplingInferMeta(x, ps, threshold, random_seed, out, ids);
+  PADDLE_ENFORCE_GT(
+      temperature,
+      0.f,
+      phi::errors::InvalidArgument(
+          "The temperature of top_k_top_p_sampling should be positive, but "
+          "received %f.",
+          temperature));
+  PADDLE_ENFORCE_GT(
+      repetition_penalty,
+      0.f,
+      phi::errors::InvalidArgument(
+          "The repetition_penalty of top_k_top_p_sampling should be "
+          "positive, but received %f.",
+          repetition_penalty));
+  if (pre_ids.initialized()) {
+    auto pre_ids_dims = pre_ids.dims();
+    PADDLE_ENFORCE_EQ(
+        pre_ids_dims.size(),
+        2,
+        phi::errors::InvalidArgument(
+            "The pre_ids of top_k_top_p_sampling should be [batch_size, "
+            "pre_ids_len], but received {%s}.",
+            pre_ids_dims));
+    PADDLE_ENFORCE_EQ(
+        pre_ids_dims[0],
+        x.dims()[0],
+        phi::errors::InvalidArgument(
+            "The pre_ids of top_k_top_p_sampling should have one row per row "
+            "of x, but received %d rows for %d rows.",
+            pre_ids_dims[0],
+            x.dims()[0]));
+  }
+}
+
 void UnchangedMultiInferMeta(const std::vector<const MetaTensor*>& x,
                              std::vector<MetaTensor*> out) {
   PADDLE_ENFORCE_EQ(
@@ -948,6 +948,19 @@ void StackInferMeta(const std::vector<const MetaTensor*>& x,
                     MetaTensor* out,
                     MetaConfig config = MetaConfig());
 
+void TopKTopPSamplingInferMeta(const MetaTensor& x,
+                               const MetaTensor& ps,
+                               const MetaTensor& threshold,
+                               const MetaTensor& pre_ids,
+                               int top_k,
+                               float temperature,
+                               float repetition_penalty,
+                               float presence_penalty,
+                               bool is_logits,
+                               int random_seed,
+                               MetaTensor* out,
+                               MetaTensor* ids);
+
 void UnchangedMultiInferMeta(const std::vector<const MetaTensor*>& x,
                              std::vector<MetaTensor*> out);
 
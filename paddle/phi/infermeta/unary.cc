@@ -5782,11 +5782,12 @@ void WeightQuantizeInferMeta(const MetaTensor& x,
                              const int32_t group_size,
                              MetaTensor* out,
                              MetaTensor* scale) {
-  PADDLE_ENFORCE_EQ(
-      ((arch == 80) || (arch == 86) || (arch == 70) || (arch == 75)),
-      true,
-      phi::errors::InvalidArgument(
-          "Currently, arch only support 70, 75, 80, 86."));
+  PADDLE_ENFORCE_EQ(((arch == 80) || (arch == 86) || (arch == 70) ||
+                     (arch == 75) || (arch == 0)),
+                    true,
+                    phi::errors::InvalidArgument(
+                        "Currently, arch only support 0 (CPU), 70, 75, 80, "
+                        "86."));
 
   auto x_dims = x.dims();
   PADDLE_ENFORCE_EQ(
@@ -17,6 +17,7 @@ limitations under the License. */
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/kernels/funcs/activation_functor.h"
+#include "paddle/phi/kernels/funcs/activation_jit.h"
 #include "paddle/phi/kernels/impl/activation_impl.h"
 
 namespace phi {
@@ -71,6 +72,23 @@ namespace phi {
         dev_ctx, x, out, functor);                          \
   }
 
+template <typename T, typename Context>
+void SiluKernel(const Context& dev_ctx,
+                const DenseTensor& x,
+                DenseTensor* out) {
+#ifdef PADDLE_WITH_XBYAK
+  if constexpr (std::is_same<T, float>::value) {
+    dev_ctx.template Alloc<T>(out);
+    funcs::ActivationJitCPU<jit::VSiluTuple<float>>(
+        dev_ctx, x.data<T>(), out->data<T>(), x.numel());
+    return;
+  }
+#endif
+  funcs::SiluFunctor<T> functor;
+  ActivationImpl<T, T, Context, funcs::SiluFunctor<T>>(
+      dev_ctx, x, out, functor);
+}
+
 DEFINE_CPU_ACTIVATION_KERNEL(Sin, SinFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Cos, CosFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Tan, TanFunctor)
@@ -85,7 +103,6 @@ DEFINE_CPU_ACTIVATION_KERNEL(Atanh, AtanhFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Relu, ReluCPUFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Tanh, TanhFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(TanhShrink, TanhShrinkFunctor)
-DEFINE_CPU_ACTIVATION_KERNEL(Silu, SiluFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Reciprocal, ReciprocalFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Square, SquareFunctor)
 DEFINE_CPU_ACTIVATION_KERNEL(Sqrt, SqrtFunctor)
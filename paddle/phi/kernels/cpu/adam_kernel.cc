@@ -23,6 +23,7 @@
 #include "paddle/phi/core/tensor_utils.h"
 #include "paddle/phi/kernels/funcs/adam_functors.h"
 #include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 PD_DECLARE_int32(inner_op_parallelism);
 
@@ -131,24 +132,24 @@ void AdamDenseKernel(const Context& dev_ctx,
 
   static constexpr int64_t chunk_size = 512;
 
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (int64_t i = 0; i < numel / chunk_size; ++i) {
-    const int64_t offset = i * chunk_size;
-    adam(beta1_,
-         beta2_,
-         -learning_rate_,
-         eps,
-         chunk_size,
-         grad_ptr + offset,
-         mom1_ptr + offset,
-         mom2_ptr + offset,
-         param_ptr + offset,
-         mom1_out_ptr + offset,
-         mom2_out_ptr + offset,
-         param_out_ptr + offset);
-  }
+  funcs::ParallelFor(
+      dev_ctx, 0, numel / chunk_size, 32, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t offset = i * chunk_size;
+          adam(beta1_,
+               beta2_,
+               -learning_rate_,
+               eps,
+               chunk_size,
+               grad_ptr + offset,
+               mom1_ptr + offset,
+               mom2_ptr + offset,
+               param_ptr + offset,
+               mom1_out_ptr + offset,
+               mom2_out_ptr + offset,
+               param_out_ptr + offset);
+        }
+      });
 
   if (numel % chunk_size != 0) {
     const int64_t offset = (numel / chunk_size) * chunk_size;
@@ -25,6 +25,7 @@
 #include "paddle/phi/kernels/adam_kernel.h"
 #include "paddle/phi/kernels/funcs/adam_functors.h"
 #include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
@@ -148,27 +149,27 @@ void AdamwDenseKernel(const Context& dev_ctx,
 
   static constexpr int64_t chunk_size = 512;
 
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (int64_t i = 0; i < numel / chunk_size; ++i) {
-    const int64_t offset = i * chunk_size;
-    adamw(beta1_,
-          beta2_,
-          -learning_rate_,
-          eps,
-          old_lr,
-          lr_ratio_,
-          coeff_,
-          chunk_size,
-          grad_ptr + offset,
-          mom1_ptr + offset,
-          mom2_ptr + offset,
-          param_ptr + offset,
-          mom1_out_ptr + offset,
-          mom2_out_ptr + offset,
-          param_out_ptr + offset);
-  }
+  funcs::ParallelFor(
+      dev_ctx, 0, numel / chunk_size, 32, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t offset = i * chunk_size;
+          adamw(beta1_,
+                beta2_,
+                -learning_rate_,
+                eps,
+                old_lr,
+                lr_ratio_,
+                coeff_,
+                chunk_size,
+                grad_ptr + offset,
+                mom1_ptr + offset,
+                mom2_ptr + offset,
+                param_ptr + offset,
+                mom1_out_ptr + offset,
+                mom2_out_ptr + offset,
+                param_out_ptr + offset);
+        }
+      });
 
   if (numel % chunk_size != 0) {
     const int64_t offset = (numel / chunk_size) * chunk_size;
@@ -19,12 +19,14 @@
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 #include "paddle/phi/kernels/transpose_kernel.h"
 
 namespace phi {
 
 template <typename T, typename Type>
-static void FullSort(Type input_height,
+static void FullSort(const CPUContext& dev_ctx,
+                     Type input_height,
                      Type input_width,
                      int input_dim,
                      const DenseTensor* input,
@@ -32,39 +34,28 @@ static void FullSort(Type input_height,
                      Type* t_indices,
                      bool descending,
                      bool stable) {
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (Type i = 0; i < input_height; ++i) {
-    std::vector<std::pair<T, Type>> col_vec;
-    col_vec.reserve(input_width);
-    if (input_dim == 1) {
-      auto e_input = EigenVector<T>::Flatten(*input);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.push_back(std::pair<T, Type>(e_input(j), j));
-      }
-    } else {
-      auto e_input = EigenMatrix<T>::Reshape(*input, input_dim - 1);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.push_back(std::pair<T, Type>(e_input(i, j), j));
-      }
-    }
-    if (stable) {
-      std::stable_sort(
-          col_vec.begin(),
-          col_vec.end(),
-          [&](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-            if (descending)
-              return (std::isnan(static_cast<double>(l.first)) &&
-                      !std::isnan(static_cast<double>(r.first))) ||
-                     (l.first > r.first);
-            else
-              return (!std::isnan(static_cast<double>(l.first)) &&
-                      std::isnan(static_cast<double>(r.first))) ||
-                     (l.first < r.first);
-          });
-    } else {
-      std::sort(col_vec.begin(),
+  // the rows a chunk of ParallelFor takes, 16k elements
+  const int64_t grain = std::max<int64_t>(
+      1, (16 << 10) / std::max<int64_t>(input_width, 1));
+  funcs::ParallelFor(
+      dev_ctx, 0, input_height, grain, [&](int64_t begin, int64_t end) {
+        for (Type i = begin; i < end; ++i) {
+          std::vector<std::pair<T, Type>> col_vec;
+          col_vec.reserve(input_width);
+          if (input_dim == 1) {
+            auto e_input = EigenVector<T>::Flatten(*input);
+            for (Type j = 0; j < input_width; ++j) {
+              col_vec.push_back(std::pair<T, Type>(e_input(j), j));
+            }
+          } else {
+            auto e_input = EigenMatrix<T>::Reshape(*input, input_dim - 1);
+            for (Type j = 0; j < input_width; ++j) {
+              col_vec.push_back(std::pair<T, Type>(e_input(i, j), j));
+            }
+          }
+          if (stable) {
+            std::stable_sort(
+                col_vec.begin(),
                 col_vec.end(),
                 [&](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
                   if (descending)
@@ -76,13 +67,28 @@ static void FullSort(Type input_height,
                             std::isnan(static_cast<double>(r.first))) ||
                            (l.first < r.first);
                 });
-    }
-
-    for (Type j = 0; j < input_width; ++j) {
-      t_out[i * input_width + j] = col_vec[j].first;
-      t_indices[i * input_width + j] = col_vec[j].second;
-    }
-  }
+          } else {
+            std::sort(col_vec.begin(),
+                      col_vec.end(),
+                      [&](const std::pair<T, Type>& l,
+                          const std::pair<T, Type>& r) {
+                        if (descending)
+                          return (std::isnan(static_cast<double>(l.first)) &&
+                                  !std::isnan(static_cast<double>(r.first))) ||
+                                 (l.first > r.first);
+                        else
+                          return (!std::isnan(static_cast<double>(l.first)) &&
+                                  std::isnan(static_cast<double>(r.first))) ||
+                                 (l.first < r.first);
+                      });
+          }
+
+          for (Type j = 0; j < input_width; ++j) {
+            t_out[i * input_width + j] = col_vec[j].first;
+            t_indices[i * input_width + j] = col_vec[j].second;
+          }
+        }
+      });
 }
 
 template <typename T, typename Context>
@@ -112,7 +118,8 @@ void ArgsortKernel(const Context& dev_ctx,
         common::product(common::slice_ddim(in_dims, 0, in_dims.size() - 1));
     const int64_t input_width = in_dims[in_dims.size() - 1];
     int64_t* ids_data = dev_ctx.template Alloc<int64_t>(indices);
-    FullSort<T, int64_t>(input_height,
+    FullSort<T, int64_t>(dev_ctx,
+                         input_height,
                          input_width,
                          in_dims.size(),
                          &input,
@@ -154,7 +161,8 @@ void ArgsortKernel(const Context& dev_ctx,
     tmp_indices.Resize(trans_dims);
     auto* t_ind = dev_ctx.template Alloc<int64_t>(&tmp_indices);
 
-    FullSort<T, int64_t>(input_height,
+    FullSort<T, int64_t>(dev_ctx,
+                         input_height,
                          input_width,
                          in_dims.size(),
                          &trans_inp,
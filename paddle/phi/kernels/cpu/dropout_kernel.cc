@@ -19,6 +19,7 @@
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/kernels/expand_kernel.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
@@ -31,12 +32,12 @@ void ComputeDropoutInference(const Context& ctx,
   if (upscale_in_train) {
     const auto* X_data = x.data<T>();
     T* Y_data = ctx.template Alloc<T>(y);
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-    for (int i = 0; i < x.numel(); i++) {
-      Y_data[i] = X_data[i];
-    }
+    funcs::ParallelFor(
+        ctx, 0, x.numel(), 1 << 16, [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            Y_data[i] = X_data[i];
+          }
+        });
   } else {
     auto X = EigenMatrix<T>::Reshape(x, 1);
     auto Y = EigenMatrix<T>::Reshape(*y, 1);
@@ -14,11 +14,14 @@
 
 #include "paddle/phi/kernels/embedding_kernel.h"
 
+#include <algorithm>
+
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/common/data_type.h"
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/core/utils/data_type.h"
 #include "paddle/phi/kernels/funcs/embedding_util.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
@@ -71,19 +74,21 @@ struct EmbeddingCPUFunctor {
       }
     }
 
-#if defined(_OPENMP) && !defined(PADDLE_WITH_CUDA)
-#pragma omp parallel for
-#endif
-
-    for (int64_t i = 0; i < ids_numel; ++i) {
-      if (padding_idx_ != kNoPadding && ids[i] == padding_idx_) {
-        memset(output + i * row_width, 0, row_width * sizeof(T));
-      } else {
-        memcpy(output + i * row_width,
-               table + ids[i] * row_width,
-               row_width * sizeof(T));
-      }
-    }
+    // each chunk copies at least 32KB
+    int64_t grain_size = std::max<int64_t>(
+        1, (32 << 10) / std::max<int64_t>(row_width * sizeof(T), 1));
+    funcs::ParallelFor(
+        dev_ctx_, 0, ids_numel, grain_size, [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            if (padding_idx_ != kNoPadding && ids[i] == padding_idx_) {
+              memset(output + i * row_width, 0, row_width * sizeof(T));
+            } else {
+              memcpy(output + i * row_width,
+                     table + ids[i] * row_width,
+                     row_width * sizeof(T));
+            }
+          }
+        });
   }
 
  private:
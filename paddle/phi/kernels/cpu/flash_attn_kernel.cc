@@ -0,0 +1,275 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/kernels/flash_attn_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/flash_attn_cpu.h"
+
+namespace phi {
+
+namespace {
+
+void CheckFlashAttnCPUArgs(float dropout,
+                           bool causal,
+                           bool return_softmax,
+                           bool is_test,
+                           const DenseTensor* attn_mask) {
+  PADDLE_ENFORCE_EQ(
+      dropout == 0.f || is_test,
+      true,
+      phi::errors::Unimplemented("flash_attn on CPU only supports inference, "
+                                 "the dropout should be 0 or is_test should "
+                                 "be true, but received dropout %f.",
+                                 dropout));
+  if (return_softmax) {
+    PADDLE_THROW(phi::errors::Unimplemented(
+        "return_softmax should be false for flash_attn on CPU."));
+  }
+  if (attn_mask) {
+    PADDLE_ENFORCE_NE(causal,
+                      true,
+                      phi::errors::InvalidArgument(
+                          "When attn_mask is set, causal can not be true."));
+  }
+}
+
+// Fills params.mask_batch and params.mask_heads from the dims of attn_mask,
+// [..., mask_heads, seqlen_q, seqlen_k] with the leading dims flattened.
+template <typename T>
+const T* GetAttnMask(const DenseTensor* attn_mask,
+                     funcs::FlashAttnCPUParams* params) {
+  if (attn_mask == nullptr) {
+    return nullptr;
+  }
+  PADDLE_ENFORCE_EQ(
+      attn_mask->dtype(),
+      phi::CppTypeToDataType<T>::Type(),
+      phi::errors::InvalidArgument(
+          "attn_mask is expected to have the same data type with q."));
+  const auto& dims = attn_mask->dims();
+  int rank = dims.size();
+  PADDLE_ENFORCE_GE(
+      rank,
+      4,
+      phi::errors::InvalidArgument(
+          "The number of dimensions of attn_mask is expected to be greater "
+          "or equal to 4, but received %d. The shape of attn_mask is {%s}",
+          rank,
+          dims));
+  int64_t mask_batch = 1;
+  for (int i = 0; i < rank - 3; ++i) {
+    mask_batch *= dims[i];
+  }
+  int64_t mask_heads = dims[rank - 3];
+  PADDLE_ENFORCE_EQ(
+      (mask_batch == 1 || mask_batch == params->batch_size) &&
+          (mask_heads == 1 || mask_heads == params->num_heads) &&
+          dims[rank - 2] == params->max_seqlen_q &&
+          dims[rank - 1] == params->max_seqlen_k,
+      true,
+      phi::errors::InvalidArgument(
+          "The shape of attn_mask should be [batch_size or 1, num_heads or 1, "
+          "seqlen_q, seqlen_k] = [%d or 1, %d or 1, %d, %d], but received "
+          "{%s}.",
+          params->batch_size,
+          params->num_heads,
+          params->max_seqlen_q,
+          params->max_seqlen_k,
+          dims));
+  params->mask_batch = mask_batch;
+  params->mask_heads = mask_heads;
+  return attn_mask->data<T>();
+}
+
+void FillSeedOffset(const CPUContext& ctx,
+                    const paddle::optional<DenseTensor>& fixed_seed_offset,
+                    DenseTensor* seed_offset) {
+  // no dropout on CPU, the seed and offset are only passed through
+  seed_offset->Resize({2});
+  int64_t* seed_offset_data = ctx.HostAlloc<int64_t>(seed_offset);
+  seed_offset_data[0] = 0;
+  seed_offset_data[1] = 0;
+  if (fixed_seed_offset.get_ptr()) {
+    const int64_t* fixed_seed_offset_data = fixed_seed_offset->data<int64_t>();
+    seed_offset_data[0] = fixed_seed_offset_data[0];
+    seed_offset_data[1] = fixed_seed_offset_data[1];
+  }
+}
+
+template <typename T>
+void FlashAttnCPU(const CPUContext& ctx,
+                  const DenseTensor& q,
+                  const DenseTensor& k,
+                  const DenseTensor& v,
+                  const DenseTensor* attn_mask,
+                  funcs::FlashAttnCPUParams* params,
+                  DenseTensor* out,
+                  DenseTensor* softmax_lse) {
+  PADDLE_ENFORCE_EQ(
+      k.dims()[k.dims().size() - 1],
+      params->head_dim,
+      phi::errors::InvalidArgument(
+          "The head_dim of q and k should be equal, but received %d and %d.",
+          params->head_dim,
+          k.dims()[k.dims().size() - 1]));
+  const T* mask = GetAttnMask<T>(attn_mask, params);
+
+  auto round_multiple = [](int64_t x) { return (x + 127) / 128 * 128; };
+  params->lse_stride = round_multiple(params->max_seqlen_q);
+  softmax_lse->Resize(
+      {params->batch_size, params->num_heads, params->lse_stride});
+  float* lse_data = ctx.Alloc<float>(softmax_lse);
+  std::fill(lse_data,
+            lse_data + softmax_lse->numel(),
+            std::numeric_limits<float>::infinity());
+  T* out_data = ctx.Alloc<T>(out);
+
+  funcs::FlashAttnCPUForward(ctx,
+                             *params,
+                             q.data<T>(),
+                             k.data<T>(),
+                             v.data<T>(),
+                             mask,
+                             out_data,
+                             lse_data);
+}
+
+}  // namespace
+
+template <typename T, typename Context>
+void FlashAttnUnpaddedKernel(
+    const Context& ctx,
+    const DenseTensor& q,
+    const DenseTensor& k,
+    const DenseTensor& v,
+    const DenseTensor& cu_seqlens_q,
+    const DenseTensor& cu_seqlens_k,
+    const paddle::optional<DenseTensor>& fixed_seed_offset,
+    const paddle::optional<DenseTensor>& attn_mask,
+    int64_t max_seqlen_q,
+    int64_t max_seqlen_k,
+    float scale,
+    float dropout,
+    bool causal,
+    bool return_softmax,
+    bool is_test,
+    const std::string& rng_name,
+    DenseTensor* out,
+    DenseTensor* softmax,
+    DenseTensor* softmax_lse,
+    DenseTensor* seed_offset) {
+  CheckFlashAttnCPUArgs(
+      dropout, causal, return_softmax, is_test, attn_mask.get_ptr());
+  // q, k, v [total_seq_len, num_heads, head_dim]
+  const auto& dims = q.dims();
+  PADDLE_ENFORCE_EQ(dims.size(),
+                    3,
+                    phi::errors::InvalidArgument(
+                        "flash_attn_raw receive input with dim "
+                        "[total_seq_len, num_heads, head_dim]"));
+  PADDLE_ENFORCE_EQ(
+      cu_seqlens_q.numel() == cu_seqlens_k.numel() &&
+          cu_seqlens_q.dtype() == phi::DataType::INT32 &&
+          cu_seqlens_k.dtype() == phi::DataType::INT32,
+      true,
+      phi::errors::InvalidArgument("cu_seqlens_q and cu_seqlens_k should be "
+                                   "int32 tensors of batch_size + 1 offsets."));
+
+  funcs::FlashAttnCPUParams params;
+  params.batch_size = cu_seqlens_q.numel() - 1;
+  params.max_seqlen_q = max_seqlen_q;
+  params.max_seqlen_k = max_seqlen_k;
+  params.num_heads = dims[1];
+  params.num_heads_k = k.dims()[1];
+  params.head_dim = dims[2];
+  params.head_dim_v = v.dims()[2];
+  params.cu_seqlens_q = cu_seqlens_q.data<int32_t>();
+  params.cu_seqlens_k = cu_seqlens_k.data<int32_t>();
+  params.scale = scale;
+  params.causal = causal;
+  FillSeedOffset(ctx, fixed_seed_offset, seed_offset);
+  FlashAttnCPU<T>(
+      ctx, q, k, v, attn_mask.get_ptr(), &params, out, softmax_lse);
+}
+
+template <typename T, typename Context>
+void FlashAttnKernel(const Context& ctx,
+                     const DenseTensor& q,
+                     const DenseTensor& k,
+                     const DenseTensor& v,
+                     const paddle::optional<DenseTensor>& fixed_seed_offset,
+                     const paddle::optional<DenseTensor>& attn_mask,
+                     float dropout,
+                     bool causal,
+                     bool return_softmax,
+                     bool is_test,
+                     const std::string& rng_name,
+                     DenseTensor* out,
+                     DenseTensor* softmax,
+                     DenseTensor* softmax_lse,
+                     DenseTensor* seed_offset) {
+  CheckFlashAttnCPUArgs(
+      dropout, causal, return_softmax, is_test, attn_mask.get_ptr());
+  // q, k, v [batch_size, seq_len, num_heads, head_dim]
+  const auto& dims = q.dims();
+  PADDLE_ENFORCE_EQ(dims.size(),
+                    4,
+                    phi::errors::InvalidArgument(
+                        "flash_attn receive input with dim "
+                        "[batch_size, seq_len, num_heads, head_dim]"));
+
+  funcs::FlashAttnCPUParams params;
+  params.batch_size = dims[0];
+  params.max_seqlen_q = dims[1];
+  params.max_seqlen_k = k.dims()[1];
+  params.num_heads = dims[2];
+  params.num_heads_k = k.dims()[2];
+  params.head_dim = dims[3];
+  params.head_dim_v = v.dims()[3];
+  params.scale = 1.0f / std::sqrt(static_cast<float>(params.head_dim));
+  params.causal = causal;
+  FillSeedOffset(ctx, fixed_seed_offset, seed_offset);
+  FlashAttnCPU<T>(
+      ctx, q, k, v, attn_mask.get_ptr(), &params, out, softmax_lse);
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(flash_attn_unpadded,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::FlashAttnUnpaddedKernel,
+                   float,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {
+  kernel->InputAt(5).SetBackend(
+      phi::Backend::ALL_BACKEND);  // fixed_seed_offset
+}
+
+PD_REGISTER_KERNEL(flash_attn,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::FlashAttnKernel,
+                   float,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {
+  kernel->InputAt(3).SetBackend(
+      phi::Backend::ALL_BACKEND);  // fixed_seed_offset
+}
@@ -21,6 +21,7 @@
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/activation_jit.h"
 #include "paddle/phi/kernels/funcs/blas/blas.h"
 #include "paddle/phi/kernels/funcs/blas/blas_impl.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
@@ -93,6 +94,18 @@ void GeluKernel(const Context& dev_ctx,
                 bool approximate,
                 DenseTensor* out) {
   dev_ctx.template Alloc<T>(out);
+#ifdef PADDLE_WITH_XBYAK
+  if constexpr (std::is_same<T, float>::value) {
+    if (approximate) {
+      funcs::ActivationJitCPU<jit::VGeluTanhTuple<float>>(
+          dev_ctx, x.data<T>(), out->data<T>(), x.numel());
+    } else {
+      funcs::ActivationJitCPU<jit::VGeluErfTuple<float>>(
+          dev_ctx, x.data<T>(), out->data<T>(), x.numel());
+    }
+    return;
+  }
+#endif
   auto eigen_out = EigenVector<T>::Flatten(*out);
   auto eigen_x = EigenVector<T>::Flatten(x);
   auto& dev = *dev_ctx.eigen_device();
@@ -20,6 +20,7 @@
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/eigen/eigen_function.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/softmax.h"
 
 namespace phi {
 
@@ -28,14 +29,6 @@ template <typename T,
           typename IndexType = Eigen::DenseIndex>
 using EigenMatrixTemplate = EigenMatrix<T, MajorType, IndexType>;
 
-template <typename T>
-struct ValueClip {
-  HOSTDEVICE T operator()(const T& x) const {
-    const T kThreshold = static_cast<T>(-64.);
-    return x < kThreshold ? kThreshold : x;
-  }
-};
-
 template <typename Context, typename T>
 struct LogSoftmaxFunctor {
   void operator()(const Context& context,
@@ -58,6 +51,20 @@ struct LogSoftmaxFunctor {
     const int num_classes = logits.dimension(kClassDim);
     const int num_remain = num_classes / axis_dim;
 
+#ifdef PADDLE_WITH_XBYAK
+    if constexpr (std::is_same<T, float>::value) {
+      if (num_remain == 1) {
+        funcs::SoftmaxRowsCPU(context,
+                              X->data<T>(),
+                              Y->data<T>(),
+                              num_classes,
+                              batch_size,
+                              /*log=*/true);
+        return;
+      }
+    }
+#endif
+
     Eigen::DSizes<int, 1> along_axis(kAxisDim);
     Eigen::DSizes<int, 2> batch_classes(batch_size, num_classes);
     Eigen::DSizes<int, 2> batch_by_one(batch_size, 1);
@@ -69,26 +76,25 @@ struct LogSoftmaxFunctor {
 
     // For numerical stability, logits should be shifted by maximum number along
     // axis, calculate shifted_logits into log_softmax tensor for memory reuse.
+    // The shifted logits are not clipped, like the jit kernel and the GPU.
     if (num_remain == 1) {
       // axis == -1, axis and class in same dimension, calculate along
       // class dimension directly for higher performance
       log_softmax.device(*context.eigen_device()) =
-          (logits - logits.maximum(along_axis)
-                        .eval()
-                        .reshape(batch_by_one)
-                        .broadcast(one_by_class))
-              .unaryExpr(ValueClip<T>());
+          logits - logits.maximum(along_axis)
+                       .eval()
+                       .reshape(batch_by_one)
+                       .broadcast(one_by_class);
     } else {
       // axis != -1, class dimension split into (axis, remain), max and sum
       // should be calculated along axis dimension
       log_softmax.device(*context.eigen_device()) =
-          (logits.reshape(batch_axis_remain) - logits.reshape(batch_axis_remain)
-                                                   .maximum(along_axis)
-                                                   .eval()
-                                                   .reshape(batch_one_remain)
-                                                   .broadcast(one_axis_one)
-                                                   .reshape(batch_classes))
-              .unaryExpr(ValueClip<T>());
+          logits.reshape(batch_axis_remain) - logits.reshape(batch_axis_remain)
+                                                  .maximum(along_axis)
+                                                  .eval()
+                                                  .reshape(batch_one_remain)
+                                                  .broadcast(one_axis_one)
+                                                  .reshape(batch_classes);
     }
 
     log_softmax.device(*context.eigen_device()) =
@@ -13,9 +13,15 @@
 // limitations under the License.
 
 #include "paddle/phi/kernels/swiglu_kernel.h"
+
+#include <algorithm>
+#include <limits>
+
 #include "paddle/phi/backends/cpu/cpu_context.h"
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/kernels/funcs/activation_functor.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
@@ -31,6 +37,28 @@ void SwiGLUKernelImpl(
     y = x + n;
   }
 
+#ifdef PADDLE_WITH_XBYAK
+  if constexpr (std::is_same<T, float>::value) {
+    if (n <= std::numeric_limits<int>::max()) {
+      // the cache of the jit kernels is thread local, get it before
+      // ParallelFor
+      auto swiglu =
+          jit::KernelFuncs<jit::VSwigluTuple<float>, CPUPlace>::Cache().At(
+              jit::kAnySize);
+      // the rows a chunk of ParallelFor takes, 16k elements
+      const int64_t grain =
+          std::max<int64_t>(1, (16 << 10) / std::max<int64_t>(n, 1));
+      funcs::ParallelFor(ctx, 0, m, grain, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          swiglu(
+              x + i * stride, y + i * stride, z + i * n, static_cast<int>(n));
+        }
+      });
+      return;
+    }
+  }
+#endif
+
   for (int64_t i = 0; i < m; ++i) {
     for (int64_t j = 0; j < n; ++j) {
       z[i * n + j] = functor(x[i * stride + j], y[i * stride + j]);
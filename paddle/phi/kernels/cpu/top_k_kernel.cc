@@ -18,11 +18,13 @@
 #include "paddle/phi/core/kernel_registry.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
 #include "paddle/phi/kernels/funcs/math_function.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 
 template <typename T, typename Type>
-static void FullTopK(Type input_height,
+static void FullTopK(const CPUContext& dev_ctx,
+                     Type input_height,
                      Type input_width,
                      int input_dim,
                      const DenseTensor* input,
@@ -42,90 +44,96 @@ static void FullTopK(Type input_height,
   // when the k is small, will the partial sort
   bool partial_sort_flag = (k * 64) < input_width;
 
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (Type i = 0; i < input_height; ++i) {
-    std::vector<std::pair<T, Type>> col_vec;
-    col_vec.reserve(input_width);
-    if (input_dim == 1) {
-      auto e_input = EigenVector<T>::Flatten(*input);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.emplace_back(std::pair<T, Type>(e_input(j), j));
-      }
-    } else {
-      auto e_input = EigenMatrix<T>::Reshape(*input, input_dim - 1);
-      for (Type j = 0; j < input_width; ++j) {
-        col_vec.emplace_back(std::pair<T, Type>(e_input(i, j), j));
-      }
-    }
-    if (partial_sort_flag) {
-      std::partial_sort(
-          col_vec.begin(),
-          col_vec.begin() + k,
-          col_vec.end(),
-          [&largest](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
+  // the rows a chunk of ParallelFor takes, 16k elements
+  const int64_t grain = std::max<int64_t>(
+      1, (16 << 10) / std::max<int64_t>(input_width, 1));
+  funcs::ParallelFor(
+      dev_ctx, 0, input_height, grain, [&](int64_t begin, int64_t end) {
+        for (Type i = begin; i < end; ++i) {
+          std::vector<std::pair<T, Type>> col_vec;
+          col_vec.reserve(input_width);
+          if (input_dim == 1) {
+            auto e_input = EigenVector<T>::Flatten(*input);
+            for (Type j = 0; j < input_width; ++j) {
+              col_vec.emplace_back(std::pair<T, Type>(e_input(j), j));
+            }
+          } else {
+            auto e_input = EigenMatrix<T>::Reshape(*input, input_dim - 1);
+            for (Type j = 0; j < input_width; ++j) {
+              col_vec.emplace_back(std::pair<T, Type>(e_input(i, j), j));
+            }
+          }
+          if (partial_sort_flag) {
+            std::partial_sort(
+                col_vec.begin(),
+                col_vec.begin() + k,
+                col_vec.end(),
+                [&largest](const std::pair<T, Type>& l,
+                           const std::pair<T, Type>& r) {
+                  if (largest) {
+                    return (std::isnan(static_cast<double>(l.first)) &&
+                            !std::isnan(static_cast<double>(r.first))) ||
+                           (l.first > r.first);
+                  } else {
+                    return (!std::isnan(static_cast<double>(l.first)) &&
+                            std::isnan(static_cast<double>(r.first))) ||
+                           (l.first < r.first);
+                  }
+                });
+          } else {
+            // use the nth-element to get the K-larger or K-small element
             if (largest) {
-              return (std::isnan(static_cast<double>(l.first)) &&
-                      !std::isnan(static_cast<double>(r.first))) ||
-                     (l.first > r.first);
+              std::nth_element(
+                  col_vec.begin(),
+                  col_vec.begin() + k - 1,
+                  col_vec.end(),
+                  [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
+                    return (std::isnan(static_cast<double>(l.first)) &&
+                            !std::isnan(static_cast<double>(r.first))) ||
+                           (l.first > r.first);
+                  });
+              // the nth-element will get the unorder elements, sort the element
+              if (sorted) {
+                std::sort(
+                    col_vec.begin(),
+                    col_vec.begin() + k - 1,
+                    [](const std::pair<T, Type>& l,
+                       const std::pair<T, Type>& r) {
+                      return (std::isnan(static_cast<double>(l.first)) &&
+                              !std::isnan(static_cast<double>(r.first))) ||
+                             (l.first > r.first);
+                    });
+              }
             } else {
-              return (!std::isnan(static_cast<double>(l.first)) &&
-                      std::isnan(static_cast<double>(r.first))) ||
-                     (l.first < r.first);
+              std::nth_element(
+                  col_vec.begin(),
+                  col_vec.begin() + k - 1,
+                  col_vec.end(),
+                  [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
+                    return (!std::isnan(static_cast<double>(l.first)) &&
+                            std::isnan(static_cast<double>(r.first))) ||
+                           (l.first < r.first);
+                  });
+              // the nth-element will get the unorder elements, sort the element
+              if (sorted) {
+                std::sort(
+                    col_vec.begin(),
+                    col_vec.begin() + k - 1,
+                    [](const std::pair<T, Type>& l,
+                       const std::pair<T, Type>& r) {
+                      return (!std::isnan(static_cast<double>(l.first)) &&
+                              std::isnan(static_cast<double>(r.first))) ||
+                             (l.first < r.first);
+                    });
+              }
             }
-          });
-    } else {
-      // use the nth-element to get the K-larger or K-small element
-      if (largest) {
-        std::nth_element(
-            col_vec.begin(),
-            col_vec.begin() + k - 1,
-            col_vec.end(),
-            [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-              return (std::isnan(static_cast<double>(l.first)) &&
-                      !std::isnan(static_cast<double>(r.first))) ||
-                     (l.first > r.first);
-            });
-        // the nth-element will get the unorder elements, sort the element
-        if (sorted) {
-          std::sort(
-              col_vec.begin(),
-              col_vec.begin() + k - 1,
-              [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-                return (std::isnan(static_cast<double>(l.first)) &&
-                        !std::isnan(static_cast<double>(r.first))) ||
-                       (l.first > r.first);
-              });
-        }
-      } else {
-        std::nth_element(
-            col_vec.begin(),
-            col_vec.begin() + k - 1,
-            col_vec.end(),
-            [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-              return (!std::isnan(static_cast<double>(l.first)) &&
-                      std::isnan(static_cast<double>(r.first))) ||
-                     (l.first < r.first);
-            });
-        // the nth-element will get the unorder elements, sort the element
-        if (sorted) {
-          std::sort(
-              col_vec.begin(),
-              col_vec.begin() + k - 1,
-              [](const std::pair<T, Type>& l, const std::pair<T, Type>& r) {
-                return (!std::isnan(static_cast<double>(l.first)) &&
-                        std::isnan(static_cast<double>(r.first))) ||
-                       (l.first < r.first);
-              });
+          }
+          for (Type j = 0; j < k; ++j) {
+            t_out[i * k + j] = col_vec[j].first;
+            t_indices[i * k + j] = col_vec[j].second;
+          }
         }
-      }
-    }
-    for (Type j = 0; j < k; ++j) {
-      t_out[i * k + j] = col_vec[j].first;
-      t_indices[i * k + j] = col_vec[j].second;
-    }
-  }
+      });
 }
 
 template <typename T, typename Context>
@@ -174,7 +182,8 @@ void TopkKernel(const Context& dev_ctx,
     const int64_t& input_height =
         common::product(common::slice_ddim(in_dims, 0, in_dims.size() - 1));
     const int64_t& input_width = in_dims[in_dims.size() - 1];
-    FullTopK<T, int64_t>(input_height,
+    FullTopK<T, int64_t>(dev_ctx,
+                         input_height,
                          input_width,
                          in_dims.size(),
                          input,
@@ -227,7 +236,8 @@ void TopkKernel(const Context& dev_ctx,
     auto* t_ind = dev_ctx.template Alloc<int64_t>(&tmp_indices);
 
     // get the TopK value
-    FullTopK<T, int64_t>(input_height,
+    FullTopK<T, int64_t>(dev_ctx,
+                         input_height,
                          input_width,
                          in_dims.size(),
                          &trans_inp,
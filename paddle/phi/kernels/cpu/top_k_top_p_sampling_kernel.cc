@@ -0,0 +1,108 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/kernels/top_k_top_p_sampling_kernel.h"
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/top_p_sampling_cpu.h"
+
+namespace phi {
+
+template <typename T, typename Context>
+void TopKTopPSamplingKernel(const Context& dev_ctx,
+                            const DenseTensor& x,
+                            const DenseTensor& ps,
+                            const paddle::optional<DenseTensor>& threshold,
+                            const paddle::optional<DenseTensor>& pre_ids,
+                            int top_k,
+                            float temperature,
+                            float repetition_penalty,
+                            float presence_penalty,
+                            bool is_logits,
+                            int random_seed,
+                            DenseTensor* out,
+                            DenseTensor* ids) {
+  const auto& in_dims = x.dims();
+  PADDLE_ENFORCE_EQ(
+      in_dims.size(),
+      2,
+      phi::errors::InvalidArgument(
+          "The x of top_p_sampling should be [batch_size, vocab_size], but "
+          "received {%s}.",
+          in_dims));
+  funcs::TopPSamplingCPUParams params;
+  params.batch_size = in_dims[0];
+  params.vocab_size = in_dims[1];
+  PADDLE_ENFORCE_EQ(
+      ps.numel(),
+      params.batch_size,
+      phi::errors::InvalidArgument(
+          "The ps of top_p_sampling should have one value per row of x, but "
+          "received %d values for %d rows.",
+          ps.numel(),
+          params.batch_size));
+  const T* threshold_data = nullptr;
+  if (threshold.get_ptr()) {
+    PADDLE_ENFORCE_EQ(
+        threshold->numel(),
+        params.batch_size,
+        phi::errors::InvalidArgument(
+            "The threshold of top_p_sampling should have one value per row "
+            "of x, but received %d values for %d rows.",
+            threshold->numel(),
+            params.batch_size));
+    threshold_data = threshold->data<T>();
+  }
+  if (pre_ids.get_ptr() && params.batch_size > 0) {
+    PADDLE_ENFORCE_EQ(
+        pre_ids->numel() % params.batch_size,
+        0,
+        phi::errors::InvalidArgument(
+            "The pre_ids of top_p_sampling should be [batch_size, "
+            "pre_ids_len], but received {%s} for %d rows.",
+            pre_ids->dims(),
+            params.batch_size));
+    params.pre_ids = pre_ids->data<int64_t>();
+    params.pre_ids_len = pre_ids->numel() / params.batch_size;
+  }
+  params.is_logits = is_logits;
+  params.top_k = top_k;
+  params.temperature = temperature;
+  params.repetition_penalty = repetition_penalty;
+  params.presence_penalty = presence_penalty;
+  params.seed = random_seed == -1 ? dev_ctx.GetGenerator()->Random64()
+                                  : static_cast<uint64_t>(random_seed);
+
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  int64_t* ids_data = dev_ctx.template Alloc<int64_t>(ids);
+  funcs::TopPSamplingCPU(dev_ctx,
+                         params,
+                         x.data<T>(),
+                         ps.data<T>(),
+                         threshold_data,
+                         out_data,
+                         ids_data);
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(top_k_top_p_sampling,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::TopKTopPSamplingKernel,
+                   float,
+                   double,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {}
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/phi/kernels/top_p_sampling_kernel.h"
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/top_k_top_p_sampling_kernel.h"
+
+namespace phi {
+
+template <typename T, typename Context>
+void TopPSamplingKernel(const Context& dev_ctx,
+                        const DenseTensor& x,
+                        const DenseTensor& ps,
+                        const paddle::optional<DenseTensor>& threshold,
+                        int random_seed,
+                        DenseTensor* out,
+                        DenseTensor* ids) {
+  // x holds the probabilities, as on GPU
+  TopKTopPSamplingKernel<T, Context>(dev_ctx,
+                                     x,
+                                     ps,
+                                     threshold,
+                                     paddle::none,
+                                     0,
+                                     1.f,
+                                     1.f,
+                                     0.f,
+                                     false,
+                                     random_seed,
+                                     out,
+                                     ids);
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(top_p_sampling,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::TopPSamplingKernel,
+                   float,
+                   double,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/weight_dequantize_kernel.h"
+
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm.h"
+
+namespace phi {
+
+// Dequantizes the CPU layout of weight_quantize (arch = 0).
+template <typename T, typename Context>
+void WeightDequantizeKernel(const Context& dev_ctx,
+                            const DenseTensor& x,
+                            const DenseTensor& scale,
+                            const std::string& algo,
+                            DataType out_dtype,
+                            int32_t group_size,
+                            DenseTensor* out) {
+  PADDLE_ENFORCE_EQ(
+      algo == "weight_only_int8" || algo == "weight_only_int4",
+      true,
+      phi::errors::InvalidArgument(
+          "The algo must be weight_only_int8 or weight_only_int4, but got %s.",
+          algo));
+  dev_ctx.template Alloc<T>(out);
+  int bits = algo == "weight_only_int8" ? 8 : 4;
+  int64_t k = x.dims()[1];
+  int64_t n = bits == 8 ? x.dims()[0] : x.dims()[0] * 2;
+
+  std::vector<float> scale_buffer;
+  const float* scale_data =
+      funcs::ToFloatBuffer(scale.data<T>(), scale.numel(), &scale_buffer);
+  T* out_data = out->data<T>();
+  std::vector<float> out_buffer;
+  float* y = reinterpret_cast<float*>(out_data);
+  if (!std::is_same<T, float>::value) {
+    out_buffer.resize(k * n);
+    y = out_buffer.data();
+  }
+  funcs::WeightOnlyDequantize(
+      dev_ctx, x.data<int8_t>(), scale_data, y, n, k, bits, group_size);
+  if (!std::is_same<T, float>::value) {
+    for (int64_t i = 0; i < k * n; ++i) {
+      out_data[i] = static_cast<T>(y[i]);
+    }
+  }
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(weight_dequantize,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::WeightDequantizeKernel,
+                   float,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {}
@@ -0,0 +1,99 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/weight_only_linear_kernel.h"
+
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm.h"
+
+namespace phi {
+
+template <typename T, typename Context>
+void WeightOnlyLinearKernel(const Context& dev_ctx,
+                            const DenseTensor& x,
+                            const DenseTensor& weight,
+                            const paddle::optional<DenseTensor>& bias,
+                            const DenseTensor& weight_scale,
+                            const std::string& weight_dtype,
+                            const int32_t arch,
+                            const int32_t group_size,
+                            DenseTensor* out) {
+  PADDLE_ENFORCE_EQ(
+      arch,
+      0,
+      phi::errors::InvalidArgument(
+          "The CPU weight_only_linear only supports the weight quantized by "
+          "weight_quantize with arch = 0, but got arch %d.",
+          arch));
+  PADDLE_ENFORCE_EQ(
+      weight_dtype == "int8" || weight_dtype == "int4",
+      true,
+      phi::errors::InvalidArgument(
+          "The weight_dtype must be int8 or int4, but got %s.", weight_dtype));
+  dev_ctx.template Alloc<T>(out);
+  int bits = weight_dtype == "int8" ? 8 : 4;
+  int64_t n =
+      group_size > 0 ? weight_scale.dims()[1] : weight_scale.dims()[0];
+  int64_t k = weight.dims()[1];
+  int64_t m = k > 0 ? x.numel() / k : 0;
+
+  std::vector<float> x_buffer;
+  std::vector<float> scale_buffer;
+  std::vector<float> bias_buffer;
+  const float* x_data = funcs::ToFloatBuffer(x.data<T>(), x.numel(), &x_buffer);
+  const float* scale_data = funcs::ToFloatBuffer(
+      weight_scale.data<T>(), weight_scale.numel(), &scale_buffer);
+  const float* bias_data =
+      bias ? funcs::ToFloatBuffer(
+                 bias.get().data<T>(), bias.get().numel(), &bias_buffer)
+           : nullptr;
+
+  T* out_data = out->data<T>();
+  std::vector<float> out_buffer;
+  float* y = reinterpret_cast<float*>(out_data);
+  if (!std::is_same<T, float>::value) {
+    out_buffer.resize(m * n);
+    y = out_buffer.data();
+  }
+  funcs::WeightOnlyGemm(dev_ctx,
+                        x_data,
+                        weight.data<int8_t>(),
+                        scale_data,
+                        bias_data,
+                        y,
+                        m,
+                        n,
+                        k,
+                        bits,
+                        group_size);
+  if (!std::is_same<T, float>::value) {
+    for (int64_t i = 0; i < m * n; ++i) {
+      out_data[i] = static_cast<T>(y[i]);
+    }
+  }
+}
+
+}  // namespace phi
+
+PD_REGISTER_KERNEL(weight_only_linear,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::WeightOnlyLinearKernel,
+                   float,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {}
@@ -34,11 +34,12 @@ void quant_compute(const DeviceContext& dev_ctx,
                    const std::string& algo,
                    const int32_t arch,
                    const int32_t group_size) {
-  PADDLE_ENFORCE_EQ(
-      ((arch == 80) || (arch == 86) || (arch == 75) || (arch == 70)),
-      true,
-      phi::errors::InvalidArgument(
-          "Currently, arch only support 70, 75, 80, 86."));
+  PADDLE_ENFORCE_EQ(((arch == 80) || (arch == 86) || (arch == 75) ||
+                     (arch == 70) || (arch == 0)),
+                    true,
+                    phi::errors::InvalidArgument(
+                        "Currently, arch only support 0 (CPU), 70, 75, 80, "
+                        "86."));
 
   const auto x_dims = x.dims();
   PADDLE_ENFORCE_EQ(
@@ -59,6 +60,9 @@ void quant_compute(const DeviceContext& dev_ctx,
   if ((arch == 80) || (arch == 75) || (arch == 86) || (arch == 89) ||
       (arch == 90)) {
     x_int.Resize({static_cast<int64_t>(m), static_cast<int64_t>(n)});
+  } else if (arch == 0) {
+    // the bytes of the rows, two int4 columns share a byte
+    x_int.Resize({static_cast<int64_t>(m), static_cast<int64_t>(n * bits / 8)});
   } else {
     // phi::Copy may change tensor meta info, here we transpose the quanted
     // data's shape.
@@ -90,7 +94,9 @@ void quant_compute(const DeviceContext& dev_ctx,
 
     group_wise_quant<T, bits>(x_int_data, x_data, scale_data, m, n, group_size);
   }
-  if (algo == "llm.int8") {
+  if (algo == "llm.int8" || arch == 0) {
+    // The CPU layout of the weight only kernels is the transpose of the
+    // bytes, see funcs/weight_only_gemm.h.
     std::vector<int> axis = {1, 0};
     funcs::Transpose<DeviceContext, int8_t, 2> trans;
     trans(dev_ctx, x_int, out, axis);
@@ -151,5 +157,6 @@ PD_REGISTER_KERNEL(weight_quantize,
                    CPU,
                    ALL_LAYOUT,
                    phi::WeightQuantizeKernel,
+                   float,
                    phi::dtype::float16,
                    phi::dtype::bfloat16) {}
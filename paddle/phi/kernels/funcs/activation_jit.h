@@ -0,0 +1,57 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace funcs {
+
+// Applies the elementwise jit kernel of KernelTuple, a jit::XYNTuple of
+// float whose code takes any size, to the numel floats of x. The floats are
+// split into blocks of kActivationJitBlock over the intra-op threads of
+// dev_ctx. x and y can be the same.
+constexpr int kActivationJitBlock = 4096;
+
+template <typename KernelTuple>
+void ActivationJitCPU(const CPUContext& dev_ctx,
+                      const float* x,
+                      float* y,
+                      int64_t numel) {
+  const int64_t num_blocks = numel / kActivationJitBlock;
+  const int rest = static_cast<int>(numel % kActivationJitBlock);
+  // the cache of the jit kernels is thread local, get it before ParallelFor
+  auto act = jit::KernelFuncs<KernelTuple, CPUPlace>::Cache().At(jit::kAnySize);
+  // 16k elements a chunk
+  ParallelFor(dev_ctx,
+              0,
+              num_blocks + (rest > 0 ? 1 : 0),
+              4,
+              [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                  const int64_t offset = i * kActivationJitBlock;
+                  act(x + offset,
+                      y + offset,
+                      i < num_blocks ? kActivationJitBlock : rest);
+                }
+              });
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,503 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/block_attn_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/blas/blas.h"
+#include "paddle/phi/kernels/funcs/flash_attn_cpu.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace funcs {
+
+namespace {
+
+// A token of qkv and its position in its sequence.
+struct TokenPos {
+  int64_t token;
+  int64_t batch;
+  int64_t pos;
+};
+
+bool IsPrefill(const BlockAttnCPUParams& params, int64_t bi) {
+  return params.seq_lens_encoder[bi] > 0;
+}
+
+// The positions written by the step, checking the caches and the tables
+// hold them before any thread writes.
+std::vector<TokenPos> MakeTokens(const BlockAttnCPUParams& params) {
+  std::vector<TokenPos> tokens;
+  for (int64_t bi = 0; bi < params.batch_size; ++bi) {
+    const int64_t len = params.seq_lens_this_time[bi];
+    if (len == 0) {
+      continue;
+    }
+    int64_t first_pos = 0;
+    if (IsPrefill(params, bi)) {
+      PADDLE_ENFORCE_EQ(len,
+                        params.seq_lens_encoder[bi],
+                        phi::errors::InvalidArgument(
+                            "The sequence %d prefills %d tokens, but "
+                            "seq_lens_this_time of it is %d.",
+                            bi,
+                            params.seq_lens_encoder[bi],
+                            len));
+    } else {
+      PADDLE_ENFORCE_EQ(len,
+                        1,
+                        phi::errors::InvalidArgument(
+                            "The sequence %d decodes %d tokens, but the "
+                            "decoding step of block_multihead_attention on "
+                            "CPU takes one token of a sequence.",
+                            bi,
+                            len));
+      first_pos = params.seq_lens_decoder[bi];
+      PADDLE_ENFORCE_GE(first_pos,
+                        0,
+                        phi::errors::InvalidArgument(
+                            "The sequence %d decodes at the position %d.",
+                            bi,
+                            first_pos));
+    }
+    const int64_t end_pos = first_pos + len;
+    PADDLE_ENFORCE_LE(
+        end_pos,
+        params.max_blocks_per_seq * params.block_size,
+        phi::errors::OutOfRange(
+            "The sequence %d reaches %d tokens, more than the %d blocks of "
+            "block_size %d of a row of block_tables.",
+            bi,
+            end_pos,
+            params.max_blocks_per_seq,
+            params.block_size));
+    const int32_t* table = params.block_tables + bi * params.max_blocks_per_seq;
+    for (int64_t b = 0; b * params.block_size < end_pos; ++b) {
+      PADDLE_ENFORCE_GE(
+          table[b],
+          0,
+          phi::errors::InvalidArgument(
+              "The block %d of the sequence %d is not allocated in "
+              "block_tables.",
+              b,
+              bi));
+      PADDLE_ENFORCE_LT(
+          table[b],
+          params.num_blocks,
+          phi::errors::OutOfRange(
+              "The block %d of the sequence %d is %d in block_tables, but "
+              "the caches hold %d blocks.",
+              b,
+              bi,
+              table[b],
+              params.num_blocks));
+    }
+    if (params.rope_emb) {
+      PADDLE_ENFORCE_LE(end_pos,
+                        params.rope_seq_len,
+                        phi::errors::OutOfRange(
+                            "The sequence %d reaches %d tokens, more than "
+                            "the %d positions of rope_emb.",
+                            bi,
+                            end_pos,
+                            params.rope_seq_len));
+    }
+    for (int64_t t = 0; t < len; ++t) {
+      tokens.push_back({params.cu_seqlens_q[bi] + t, bi, first_pos + t});
+    }
+  }
+  return tokens;
+}
+
+// Rotates a head of q or k by the angles of pos.
+template <typename T>
+void ApplyRope(const BlockAttnCPUParams& params, int64_t pos, T* x) {
+  const int64_t half = params.head_dim / 2;
+  const float* cos = params.rope_emb + pos * half;
+  const float* sin = cos + params.rope_seq_len * half;
+  for (int64_t i = 0; i < half; ++i) {
+    int64_t left = params.use_neox_style ? i : 2 * i;
+    int64_t right = params.use_neox_style ? i + half : 2 * i + 1;
+    float x0 = static_cast<float>(x[left]);
+    float x1 = static_cast<float>(x[right]);
+    x[left] = static_cast<T>(x0 * cos[i] - x1 * sin[i]);
+    x[right] = static_cast<T>(x1 * cos[i] + x0 * sin[i]);
+  }
+}
+
+// Adds the bias and the rotary embedding, and writes k and v to the caches.
+template <typename T>
+void WriteCache(const CPUContext& dev_ctx,
+                const BlockAttnCPUParams& params,
+                const std::vector<TokenPos>& tokens,
+                const T* qkv_bias,
+                T* qkv,
+                T* key_cache,
+                T* value_cache) {
+  const int64_t d = params.head_dim;
+  const int64_t hq = params.num_heads;
+  const int64_t hk = params.num_heads_k;
+  const int64_t stride = (hq + 2 * hk) * d;
+  const int64_t bs = params.block_size;
+  const int64_t num_tokens = static_cast<int64_t>(tokens.size());
+  ParallelFor(dev_ctx, 0, num_tokens, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t t = begin; t < end; ++t) {
+      const TokenPos& tp = tokens[t];
+      T* x = qkv + tp.token * stride;
+      if (qkv_bias) {
+        for (int64_t c = 0; c < stride; ++c) {
+          x[c] = static_cast<T>(static_cast<float>(x[c]) +
+                                static_cast<float>(qkv_bias[c]));
+        }
+      }
+      if (params.rope_emb) {
+        for (int64_t h = 0; h < hq + hk; ++h) {
+          ApplyRope(params, tp.pos, x + h * d);
+        }
+      }
+      const int64_t block =
+          params.block_tables[tp.batch * params.max_blocks_per_seq +
+                              tp.pos / bs];
+      const T* k = x + hq * d;
+      const T* v = k + hk * d;
+      for (int64_t h = 0; h < hk; ++h) {
+        int64_t offset = ((block * hk + h) * bs + tp.pos % bs) * d;
+        std::copy(k + h * d, k + (h + 1) * d, key_cache + offset);
+        std::copy(v + h * d, v + (h + 1) * d, value_cache + offset);
+      }
+    }
+  });
+}
+
+template <typename T>
+void Prefill(const CPUContext& dev_ctx,
+             const BlockAttnCPUParams& params,
+             const T* mask,
+             const T* qkv,
+             T* out) {
+  const int64_t d = params.head_dim;
+  const int64_t stride = (params.num_heads + 2 * params.num_heads_k) * d;
+  for (int64_t bi = 0; bi < params.batch_size; ++bi) {
+    if (!IsPrefill(params, bi) || params.seq_lens_this_time[bi] == 0) {
+      continue;
+    }
+    const int32_t len = params.seq_lens_encoder[bi];
+    const int32_t cu_seqlens[2] = {0, len};
+    FlashAttnCPUParams p;
+    p.batch_size = 1;
+    p.max_seqlen_q = len;
+    p.max_seqlen_k = len;
+    p.num_heads = params.num_heads;
+    p.num_heads_k = params.num_heads_k;
+    p.head_dim = d;
+    p.head_dim_v = d;
+    p.cu_seqlens_q = cu_seqlens;
+    p.cu_seqlens_k = cu_seqlens;
+    p.q_stride = stride;
+    p.k_stride = stride;
+    p.v_stride = stride;
+    p.scale = 1.f / std::sqrt(static_cast<float>(d));
+    const T* seq_mask = nullptr;
+    if (mask) {
+      PADDLE_ENFORCE_EQ(
+          params.mask_rows >= len && params.mask_cols >= len,
+          true,
+          phi::errors::InvalidArgument(
+              "The mask [%d, %d] of block_multihead_attention is smaller "
+              "than the %d tokens of the sequence %d.",
+              params.mask_rows,
+              params.mask_cols,
+              len,
+              bi));
+      p.max_seqlen_q = params.mask_rows;
+      p.max_seqlen_k = params.mask_cols;
+      p.mask_batch = 1;
+      p.mask_heads = params.mask_heads;
+      seq_mask = mask + (params.mask_batch == 1 ? 0 : bi) * params.mask_heads *
+                            params.mask_rows * params.mask_cols;
+    } else {
+      p.causal = true;
+    }
+    const T* q = qkv + params.cu_seqlens_q[bi] * stride;
+    const T* k = q + params.num_heads * d;
+    const T* v = k + params.num_heads_k * d;
+    FlashAttnCPUForward(dev_ctx,
+                        p,
+                        q,
+                        k,
+                        v,
+                        seq_mask,
+                        out + params.cu_seqlens_q[bi] * params.num_heads * d,
+                        nullptr);
+  }
+}
+
+// Every decoded token against the cache of its sequence, the query heads of
+// a kv head together.
+template <typename T>
+void Decode(const CPUContext& dev_ctx,
+            const BlockAttnCPUParams& params,
+            const T* tgt_mask,
+            const T* qkv,
+            const T* key_cache,
+            const T* value_cache,
+            T* out) {
+  const int64_t d = params.head_dim;
+  const int64_t bs = params.block_size;
+  const int64_t hk = params.num_heads_k;
+  const int64_t group = params.num_heads / hk;
+  const int64_t stride = (params.num_heads + 2 * hk) * d;
+  const float scale = 1.f / std::sqrt(static_cast<float>(d));
+  // float caches are used in place
+  constexpr bool kInPlaceKV = std::is_same<T, float>::value;
+
+  std::vector<int64_t> batches;
+  for (int64_t bi = 0; bi < params.batch_size; ++bi) {
+    if (IsPrefill(params, bi) || params.seq_lens_this_time[bi] == 0) {
+      continue;
+    }
+    if (tgt_mask) {
+      PADDLE_ENFORCE_GT(
+          params.tgt_mask_cols,
+          params.seq_lens_decoder[bi],
+          phi::errors::InvalidArgument(
+              "The tgt_mask of block_multihead_attention has %d keys, but "
+              "the sequence %d attends to %d keys.",
+              params.tgt_mask_cols,
+              bi,
+              params.seq_lens_decoder[bi] + 1));
+    }
+    batches.push_back(bi);
+  }
+  if (batches.empty()) {
+    return;
+  }
+
+  auto blas = GetBlas<CPUContext, float>(dev_ctx);
+  const int64_t num_tasks = static_cast<int64_t>(batches.size()) * hk;
+  ParallelFor(
+      dev_ctx, 0, num_tasks, 1, [&](int64_t task_begin, int64_t task_end) {
+        std::vector<float> q_buf(group * d);
+        std::vector<float> o_buf(group * d);
+        std::vector<float> s_buf;
+        std::vector<float> k_buf(kInPlaceKV ? 0 : bs * d);
+        std::vector<float> v_buf(kInPlaceKV ? 0 : bs * d);
+        for (int64_t t = task_begin; t < task_end; ++t) {
+          const int64_t bi = batches[t / hk];
+          const int64_t kv_head = t % hk;
+          const int64_t first_head = kv_head * group;
+          const int64_t num_keys = params.seq_lens_decoder[bi] + 1;
+          const int64_t num_blocks = (num_keys + bs - 1) / bs;
+          const int32_t* table =
+              params.block_tables + bi * params.max_blocks_per_seq;
+          const T* q =
+              qkv + params.cu_seqlens_q[bi] * stride + first_head * d;
+          for (int64_t c = 0; c < group * d; ++c) {
+            q_buf[c] = static_cast<float>(q[c]);
+          }
+          s_buf.resize(group * num_keys);
+
+          // s = scale * q k^T, a block of keys at a time
+          for (int64_t b = 0; b < num_blocks; ++b) {
+            const int64_t n = std::min(bs, num_keys - b * bs);
+            const T* k_src = key_cache + (table[b] * hk + kv_head) * bs * d;
+            const float* k_blk;
+            if constexpr (kInPlaceKV) {
+              k_blk = k_src;
+            } else {
+              for (int64_t c = 0; c < n * d; ++c) {
+                k_buf[c] = static_cast<float>(k_src[c]);
+              }
+              k_blk = k_buf.data();
+            }
+            blas.GEMM(false,
+                      true,
+                      group,
+                      n,
+                      d,
+                      scale,
+                      q_buf.data(),
+                      d,
+                      k_blk,
+                      d,
+                      0.f,
+                      s_buf.data() + b * bs,
+                      num_keys);
+          }
+
+          for (int64_t g = 0; g < group; ++g) {
+            float* s = s_buf.data() + g * num_keys;
+            if (tgt_mask) {
+              int64_t mb = params.tgt_mask_batch == 1 ? 0 : bi;
+              int64_t mh = params.tgt_mask_heads == 1 ? 0 : first_head + g;
+              const T* mask_row =
+                  tgt_mask +
+                  (mb * params.tgt_mask_heads + mh) * params.tgt_mask_cols;
+              for (int64_t j = 0; j < num_keys; ++j) {
+                s[j] += static_cast<float>(mask_row[j]);
+              }
+            }
+            float max = -std::numeric_limits<float>::infinity();
+            for (int64_t j = 0; j < num_keys; ++j) {
+              max = std::max(max, s[j]);
+            }
+            if (max == -std::numeric_limits<float>::infinity()) {
+              // every key is masked out, the output is zero
+              std::fill(s, s + num_keys, 0.f);
+              continue;
+            }
+            for (int64_t j = 0; j < num_keys; ++j) {
+              s[j] -= max;
+            }
+            blas.VEXP(num_keys, s, s);
+            float sum = 0.f;
+            for (int64_t j = 0; j < num_keys; ++j) {
+              sum += s[j];
+            }
+            float inv_sum = 1.f / sum;
+            for (int64_t j = 0; j < num_keys; ++j) {
+              s[j] *= inv_sum;
+            }
+          }
+
+          // o = p v
+          for (int64_t b = 0; b < num_blocks; ++b) {
+            const int64_t n = std::min(bs, num_keys - b * bs);
+            const T* v_src = value_cache + (table[b] * hk + kv_head) * bs * d;
+            const float* v_blk;
+            if constexpr (kInPlaceKV) {
+              v_blk = v_src;
+            } else {
+              for (int64_t c = 0; c < n * d; ++c) {
+                v_buf[c] = static_cast<float>(v_src[c]);
+              }
+              v_blk = v_buf.data();
+            }
+            blas.GEMM(false,
+                      false,
+                      group,
+                      d,
+                      n,
+                      1.f,
+                      s_buf.data() + b * bs,
+                      num_keys,
+                      v_blk,
+                      d,
+                      b == 0 ? 0.f : 1.f,
+                      o_buf.data(),
+                      d);
+          }
+
+          T* dst = out + params.cu_seqlens_q[bi] * params.num_heads * d +
+                   first_head * d;
+          for (int64_t c = 0; c < group * d; ++c) {
+            dst[c] = static_cast<T>(o_buf[c]);
+          }
+        }
+      });
+}
+
+template <typename T>
+void BlockAttnForwardImpl(const CPUContext& dev_ctx,
+                          const BlockAttnCPUParams& params,
+                          const T* qkv_bias,
+                          const T* mask,
+                          const T* tgt_mask,
+                          T* qkv,
+                          T* key_cache,
+                          T* value_cache,
+                          T* out) {
+  PADDLE_ENFORCE_EQ(params.num_heads % params.num_heads_k,
+                    0,
+                    phi::errors::InvalidArgument(
+                        "The number of heads of q (%d) should be a multiple "
+                        "of the number of heads of k and v (%d).",
+                        params.num_heads,
+                        params.num_heads_k));
+  std::vector<TokenPos> tokens = MakeTokens(params);
+  WriteCache(dev_ctx, params, tokens, qkv_bias, qkv, key_cache, value_cache);
+  Prefill(dev_ctx, params, mask, qkv, out);
+  Decode(dev_ctx, params, tgt_mask, qkv, key_cache, value_cache, out);
+}
+
+}  // namespace
+
+void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                         const BlockAttnCPUParams& params,
+                         const float* qkv_bias,
+                         const float* mask,
+                         const float* tgt_mask,
+                         float* qkv,
+                         float* key_cache,
+                         float* value_cache,
+                         float* out) {
+  BlockAttnForwardImpl(dev_ctx,
+                       params,
+                       qkv_bias,
+                       mask,
+                       tgt_mask,
+                       qkv,
+                       key_cache,
+                       value_cache,
+                       out);
+}
+
+void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                         const BlockAttnCPUParams& params,
+                         const phi::dtype::float16* qkv_bias,
+                         const phi::dtype::float16* mask,
+                         const phi::dtype::float16* tgt_mask,
+                         phi::dtype::float16* qkv,
+                         phi::dtype::float16* key_cache,
+                         phi::dtype::float16* value_cache,
+                         phi::dtype::float16* out) {
+  BlockAttnForwardImpl(dev_ctx,
+                       params,
+                       qkv_bias,
+                       mask,
+                       tgt_mask,
+                       qkv,
+                       key_cache,
+                       value_cache,
+                       out);
+}
+
+void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                         const BlockAttnCPUParams& params,
+                         const phi::dtype::bfloat16* qkv_bias,
+                         const phi::dtype::bfloat16* mask,
+                         const phi::dtype::bfloat16* tgt_mask,
+                         phi::dtype::bfloat16* qkv,
+                         phi::dtype::bfloat16* key_cache,
+                         phi::dtype::bfloat16* value_cache,
+                         phi::dtype::bfloat16* out) {
+  BlockAttnForwardImpl(dev_ctx,
+                       params,
+                       qkv_bias,
+                       mask,
+                       tgt_mask,
+                       qkv,
+                       key_cache,
+                       value_cache,
+                       out);
+}
+
+}  // namespace funcs
+}  // namespace phi
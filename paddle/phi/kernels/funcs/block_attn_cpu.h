@@ -0,0 +1,114 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/bfloat16.h"
+#include "paddle/phi/common/float16.h"
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+namespace funcs {
+
+// The shapes of a step of block_multihead_attention on CPU.
+//
+// qkv is [token_num, (num_heads + 2 * num_heads_k) * head_dim], the tokens
+// of the sequence bi starting at cu_seqlens_q[bi]. The sequence bi either
+// prefills seq_lens_encoder[bi] tokens at the positions 0, 1, ..., or
+// decodes seq_lens_this_time[bi] = 1 token at the position
+// seq_lens_decoder[bi] when seq_lens_encoder[bi] is 0; it is skipped when
+// seq_lens_this_time[bi] is 0.
+//
+// key_cache and value_cache are [num_blocks, num_heads_k, block_size,
+// head_dim], the token t of the sequence bi lives in the slot
+// t % block_size of the block block_tables[bi * max_blocks_per_seq +
+// t / block_size], see PagedKVCache. The blocks of the tables are in
+// [0, num_blocks), -1 for the blocks not allocated.
+//
+// rope_emb is the float table of the cos and then the sin of the
+// positions, each [rope_seq_len, head_dim / 2]; the pairs (2i, 2i + 1) of
+// q and k are rotated by the angle i of the position, or the pairs
+// (i, i + head_dim / 2) with use_neox_style.
+//
+// mask is an optional additive mask [mask_batch, mask_heads, mask_rows,
+// mask_cols] of the prefill, which is causal without it, and tgt_mask an
+// optional additive mask [tgt_mask_batch, tgt_mask_heads, 1,
+// tgt_mask_cols] of the keys of the decoded tokens; mask_batch in {1,
+// batch_size} and mask_heads in {1, num_heads}.
+struct BlockAttnCPUParams {
+  int64_t batch_size = 0;
+  int64_t num_heads = 0;
+  int64_t num_heads_k = 0;
+  int64_t head_dim = 0;
+  int64_t block_size = 0;
+  int64_t num_blocks = 0;
+  int64_t max_blocks_per_seq = 0;
+  const int32_t* seq_lens_encoder = nullptr;
+  const int32_t* seq_lens_decoder = nullptr;
+  const int32_t* seq_lens_this_time = nullptr;
+  const int32_t* cu_seqlens_q = nullptr;
+  const int32_t* block_tables = nullptr;
+  const float* rope_emb = nullptr;
+  int64_t rope_seq_len = 0;
+  bool use_neox_style = false;
+  int64_t mask_batch = 0;
+  int64_t mask_heads = 0;
+  int64_t mask_rows = 0;
+  int64_t mask_cols = 0;
+  int64_t tgt_mask_batch = 0;
+  int64_t tgt_mask_heads = 0;
+  int64_t tgt_mask_cols = 0;
+};
+
+// Adds qkv_bias [(num_heads + 2 * num_heads_k) * head_dim] (if not null)
+// and the rotary embedding to qkv in place, writes k and v to the caches,
+// and writes the attention of the queries to out [token_num, num_heads *
+// head_dim]. The prefills run FlashAttnCPUForward on the k and v of qkv;
+// a decoded token attends to the whole cache of its sequence, all the
+// query heads sharing a kv head together, one Blas GEMM per cache block.
+TEST_API void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                                  const BlockAttnCPUParams& params,
+                                  const float* qkv_bias,
+                                  const float* mask,
+                                  const float* tgt_mask,
+                                  float* qkv,
+                                  float* key_cache,
+                                  float* value_cache,
+                                  float* out);
+
+TEST_API void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                                  const BlockAttnCPUParams& params,
+                                  const phi::dtype::float16* qkv_bias,
+                                  const phi::dtype::float16* mask,
+                                  const phi::dtype::float16* tgt_mask,
+                                  phi::dtype::float16* qkv,
+                                  phi::dtype::float16* key_cache,
+                                  phi::dtype::float16* value_cache,
+                                  phi::dtype::float16* out);
+
+TEST_API void BlockAttnCPUForward(const CPUContext& dev_ctx,
+                                  const BlockAttnCPUParams& params,
+                                  const phi::dtype::bfloat16* qkv_bias,
+                                  const phi::dtype::bfloat16* mask,
+                                  const phi::dtype::bfloat16* tgt_mask,
+                                  phi::dtype::bfloat16* qkv,
+                                  phi::dtype::bfloat16* key_cache,
+                                  phi::dtype::bfloat16* value_cache,
+                                  phi::dtype::bfloat16* out);
+
+}  // namespace funcs
+}  // namespace phi
@@ -14,13 +14,21 @@ limitations under the License. */
 
 #include "paddle/phi/kernels/funcs/fc_functor.h"
 
+#include <algorithm>
+
 #include "paddle/phi/backends/all_context.h"
 #include "paddle/phi/kernels/funcs/blas/blas.h"
 #include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 
 namespace phi {
 namespace funcs {
 
+// the rows of width elements a chunk of ParallelFor takes, 16k elements
+static int64_t RowGrainSize(int width) {
+  return std::max<int64_t>(1, (16 << 10) / std::max(width, 1));
+}
+
 template <typename DeviceContext, typename T>
 void FCFunctor<DeviceContext, T>::operator()(const DeviceContext& context,
                                              const int M,
@@ -44,12 +52,15 @@ void FCFunctor<DeviceContext, T>::operator()(const DeviceContext& context,
 
     Y1.Resize({M * (N + 4)});
     Y1_data = context.template HostAlloc<T>(&Y1);
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-    for (int i = 0; i < M; i++) {
-      memcpy(X1_data + i * KK, X + i * K, K * sizeof(T));
-    }
+    ParallelFor(context,
+                0,
+                M,
+                RowGrainSize(K),
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t i = begin; i < end; i++) {
+                    memcpy(X1_data + i * KK, X + i * K, K * sizeof(T));
+                  }
+                });
     blas.GEMM(false,
               false,
               M,
@@ -68,12 +79,15 @@ void FCFunctor<DeviceContext, T>::operator()(const DeviceContext& context,
   }
   if (B == nullptr) {
     if (padding_weights) {
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-      for (int i = 0; i < M; i++) {
-        memcpy(Y + i * N, Y1_data + i * (N + 4), N * sizeof(T));
-      }
+      ParallelFor(context,
+                  0,
+                  M,
+                  RowGrainSize(N),
+                  [&](int64_t begin, int64_t end) {
+                    for (int64_t i = begin; i < end; i++) {
+                      memcpy(Y + i * N, Y1_data + i * (N + 4), N * sizeof(T));
+                    }
+                  });
     }
     PADDLE_ENFORCE_EQ(
         relu,
@@ -87,14 +101,14 @@ void FCFunctor<DeviceContext, T>::operator()(const DeviceContext& context,
                       : phi::jit::KernelFuncs<phi::jit::VAddTuple<T>,
                                               phi::CPUPlace>::Cache()
                             .At(N);
-#ifdef PADDLE_WITH_MKLML
-#pragma omp parallel for
-#endif
-  for (int i = 0; i < M; i++) {
-    T* dst = Y + i * N;
-    T* src = (padding_weights) ? Y1_data + i * (N + 4) : dst;
-    compute(B, src, dst, N);
-  }
+  ParallelFor(
+      context, 0, M, RowGrainSize(N), [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+          T* dst = Y + i * N;
+          T* src = (padding_weights) ? Y1_data + i * (N + 4) : dst;
+          compute(B, src, dst, N);
+        }
+      });
 }
 
 template class FCFunctor<CPUContext, float>;
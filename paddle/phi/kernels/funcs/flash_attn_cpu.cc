@@ -0,0 +1,339 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/flash_attn_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/blas/blas.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace funcs {
+
+namespace {
+
+// The query rows of a head in a block.
+constexpr int64_t kBlockQ = 64;
+// The float K and V blocks together take about this many bytes, to stay in
+// L2 while all the query heads of the group run against them.
+constexpr int64_t kKVBlockBytes = 1 << 18;
+
+// The queries [row_begin, row_begin + rows) of a sequence against the kv
+// head kv_head.
+struct AttnTask {
+  int64_t batch;
+  int64_t kv_head;
+  int64_t q_offset;
+  int64_t k_offset;
+  int64_t seqlen_q;
+  int64_t seqlen_k;
+  int64_t row_begin;
+  int64_t rows;
+};
+
+int64_t BlockK(const FlashAttnCPUParams& params) {
+  int64_t floats_per_key = params.head_dim + params.head_dim_v;
+  int64_t block = kKVBlockBytes / sizeof(float) / floats_per_key / 16 * 16;
+  return std::min<int64_t>(std::max<int64_t>(block, 16), 512);
+}
+
+std::vector<AttnTask> MakeTasks(const FlashAttnCPUParams& params) {
+  std::vector<AttnTask> tasks;
+  for (int64_t b = 0; b < params.batch_size; ++b) {
+    int64_t q_offset = b * params.max_seqlen_q;
+    int64_t k_offset = b * params.max_seqlen_k;
+    int64_t seqlen_q = params.max_seqlen_q;
+    int64_t seqlen_k = params.max_seqlen_k;
+    if (params.cu_seqlens_q) {
+      q_offset = params.cu_seqlens_q[b];
+      k_offset = params.cu_seqlens_k[b];
+      seqlen_q = params.cu_seqlens_q[b + 1] - q_offset;
+      seqlen_k = params.cu_seqlens_k[b + 1] - k_offset;
+    }
+    int64_t num_blocks = (seqlen_q + kBlockQ - 1) / kBlockQ;
+    for (int64_t h = 0; h < params.num_heads_k; ++h) {
+      for (int64_t i = 0; i < num_blocks; ++i) {
+        // the causal blocks get more expensive along the sequence, the
+        // order 0, n - 1, 1, n - 2, ... balances the contiguous chunks of
+        // ParallelFor
+        int64_t block = i;
+        if (params.causal) {
+          block = i % 2 == 0 ? i / 2 : num_blocks - 1 - i / 2;
+        }
+        int64_t row_begin = block * kBlockQ;
+        tasks.push_back({b,
+                         h,
+                         q_offset,
+                         k_offset,
+                         seqlen_q,
+                         seqlen_k,
+                         row_begin,
+                         std::min(kBlockQ, seqlen_q - row_begin)});
+      }
+    }
+  }
+  return tasks;
+}
+
+// dst[rows, cols] = src rows of stride ld
+template <typename T>
+void LoadRows(
+    const T* src, int64_t ld, int64_t rows, int64_t cols, float* dst) {
+  for (int64_t r = 0; r < rows; ++r) {
+    const T* s = src + r * ld;
+    float* d = dst + r * cols;
+    for (int64_t c = 0; c < cols; ++c) {
+      d[c] = static_cast<float>(s[c]);
+    }
+  }
+}
+
+template <typename T>
+void FlashAttnForwardImpl(const CPUContext& dev_ctx,
+                          const FlashAttnCPUParams& params,
+                          const T* q,
+                          const T* k,
+                          const T* v,
+                          const T* mask,
+                          T* out,
+                          float* softmax_lse) {
+  PADDLE_ENFORCE_EQ(params.num_heads % params.num_heads_k,
+                    0,
+                    phi::errors::InvalidArgument(
+                        "The number of heads of q (%d) should be a multiple "
+                        "of the number of heads of k and v (%d).",
+                        params.num_heads,
+                        params.num_heads_k));
+  const int64_t d = params.head_dim;
+  const int64_t dv = params.head_dim_v;
+  const int64_t group = params.num_heads / params.num_heads_k;
+  const int64_t q_ld =
+      params.q_stride > 0 ? params.q_stride : params.num_heads * d;
+  const int64_t k_ld =
+      params.k_stride > 0 ? params.k_stride : params.num_heads_k * d;
+  const int64_t v_ld =
+      params.v_stride > 0 ? params.v_stride : params.num_heads_k * dv;
+  const int64_t out_ld = params.num_heads * dv;
+  const int64_t block_k = BlockK(params);
+  constexpr float kNegInf = -std::numeric_limits<float>::infinity();
+  // float k and v are used in place, with the strides of the tokens
+  constexpr bool kInPlaceKV = std::is_same<T, float>::value;
+
+  std::vector<AttnTask> tasks = MakeTasks(params);
+  auto blas = GetBlas<CPUContext, float>(dev_ctx);
+  int64_t num_tasks = static_cast<int64_t>(tasks.size());
+  ParallelFor(
+      dev_ctx, 0, num_tasks, 1, [&](int64_t task_begin, int64_t task_end) {
+        // the rows of all the heads of a group, head major
+        const int64_t max_rows = group * kBlockQ;
+        std::vector<float> q_buf(max_rows * d);
+        std::vector<float> s_buf(max_rows * block_k);
+        std::vector<float> o_buf(max_rows * dv);
+        std::vector<float> row_max(max_rows);
+        std::vector<float> row_sum(max_rows);
+        std::vector<float> k_buf(kInPlaceKV ? 0 : block_k * d);
+        std::vector<float> v_buf(kInPlaceKV ? 0 : block_k * dv);
+
+        for (int64_t t = task_begin; t < task_end; ++t) {
+          const AttnTask& task = tasks[t];
+          const int64_t rows = task.rows;
+          const int64_t m = group * rows;
+          // query i sees the keys j <= i + causal_shift
+          const int64_t causal_shift = task.seqlen_k - task.seqlen_q;
+          const int64_t first_head = task.kv_head * group;
+          for (int64_t g = 0; g < group; ++g) {
+            LoadRows(q + (task.q_offset + task.row_begin) * q_ld +
+                         (first_head + g) * d,
+                     q_ld,
+                     rows,
+                     d,
+                     q_buf.data() + g * rows * d);
+          }
+          std::fill(o_buf.begin(), o_buf.begin() + m * dv, 0.f);
+          std::fill(row_max.begin(), row_max.begin() + m, kNegInf);
+          std::fill(row_sum.begin(), row_sum.begin() + m, 0.f);
+
+          int64_t k_end = task.seqlen_k;
+          if (params.causal) {
+            k_end = std::min(k_end, task.row_begin + rows + causal_shift);
+          }
+          for (int64_t kb = 0; kb < k_end; kb += block_k) {
+            const int64_t n = std::min(block_k, k_end - kb);
+            const float* k_blk;
+            const float* v_blk;
+            int64_t k_blk_ld = d;
+            int64_t v_blk_ld = dv;
+            const T* k_src =
+                k + (task.k_offset + kb) * k_ld + task.kv_head * d;
+            const T* v_src =
+                v + (task.k_offset + kb) * v_ld + task.kv_head * dv;
+            if constexpr (kInPlaceKV) {
+              k_blk = k_src;
+              v_blk = v_src;
+              k_blk_ld = k_ld;
+              v_blk_ld = v_ld;
+            } else {
+              LoadRows(k_src, k_ld, n, d, k_buf.data());
+              LoadRows(v_src, v_ld, n, dv, v_buf.data());
+              k_blk = k_buf.data();
+              v_blk = v_buf.data();
+            }
+
+            // s = scale * q k^T
+            blas.GEMM(false,
+                      true,
+                      m,
+                      n,
+                      d,
+                      params.scale,
+                      q_buf.data(),
+                      d,
+                      k_blk,
+                      k_blk_ld,
+                      0.f,
+                      s_buf.data(),
+                      block_k);
+
+            for (int64_t r = 0; r < m; ++r) {
+              const int64_t head = first_head + r / rows;
+              const int64_t i = task.row_begin + r % rows;
+              float* s = s_buf.data() + r * block_k;
+              if (mask) {
+                int64_t mb = params.mask_batch == 1 ? 0 : task.batch;
+                int64_t mh = params.mask_heads == 1 ? 0 : head;
+                const T* mask_row =
+                    mask +
+                    ((mb * params.mask_heads + mh) * params.max_seqlen_q + i) *
+                        params.max_seqlen_k +
+                    kb;
+                for (int64_t j = 0; j < n; ++j) {
+                  s[j] += static_cast<float>(mask_row[j]);
+                }
+              }
+              int64_t valid = n;
+              if (params.causal) {
+                valid = std::max<int64_t>(
+                    0, std::min(n, i + causal_shift + 1 - kb));
+                std::fill(s + valid, s + n, kNegInf);
+              }
+              float block_max = kNegInf;
+              for (int64_t j = 0; j < valid; ++j) {
+                block_max = std::max(block_max, s[j]);
+              }
+              float new_max = std::max(row_max[r], block_max);
+              if (new_max == kNegInf) {
+                // nothing seen yet, the row keeps contributing nothing
+                std::fill(s, s + n, 0.f);
+                continue;
+              }
+              for (int64_t j = 0; j < n; ++j) {
+                s[j] -= new_max;
+              }
+              blas.VEXP(n, s, s);
+              float sum = 0.f;
+              for (int64_t j = 0; j < n; ++j) {
+                sum += s[j];
+              }
+              if (row_max[r] != new_max) {
+                float correction = std::exp(row_max[r] - new_max);
+                row_sum[r] *= correction;
+                float* o = o_buf.data() + r * dv;
+                for (int64_t c = 0; c < dv; ++c) {
+                  o[c] *= correction;
+                }
+              }
+              row_max[r] = new_max;
+              row_sum[r] += sum;
+            }
+
+            // o += p v
+            blas.GEMM(false,
+                      false,
+                      m,
+                      dv,
+                      n,
+                      1.f,
+                      s_buf.data(),
+                      block_k,
+                      v_blk,
+                      v_blk_ld,
+                      1.f,
+                      o_buf.data(),
+                      dv);
+          }
+
+          for (int64_t r = 0; r < m; ++r) {
+            const int64_t head = first_head + r / rows;
+            const int64_t i = task.row_begin + r % rows;
+            const float* o = o_buf.data() + r * dv;
+            T* dst = out + (task.q_offset + i) * out_ld + head * dv;
+            float inv_sum = row_sum[r] > 0.f ? 1.f / row_sum[r] : 0.f;
+            for (int64_t c = 0; c < dv; ++c) {
+              dst[c] = static_cast<T>(o[c] * inv_sum);
+            }
+            if (softmax_lse) {
+              softmax_lse[(task.batch * params.num_heads + head) *
+                              params.lse_stride +
+                          i] = row_sum[r] > 0.f
+                                   ? row_max[r] + std::log(row_sum[r])
+                                   : std::numeric_limits<float>::infinity();
+            }
+          }
+        }
+      });
+}
+
+}  // namespace
+
+void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                         const FlashAttnCPUParams& params,
+                         const float* q,
+                         const float* k,
+                         const float* v,
+                         const float* mask,
+                         float* out,
+                         float* softmax_lse) {
+  FlashAttnForwardImpl(dev_ctx, params, q, k, v, mask, out, softmax_lse);
+}
+
+void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                         const FlashAttnCPUParams& params,
+                         const phi::dtype::float16* q,
+                         const phi::dtype::float16* k,
+                         const phi::dtype::float16* v,
+                         const phi::dtype::float16* mask,
+                         phi::dtype::float16* out,
+                         float* softmax_lse) {
+  FlashAttnForwardImpl(dev_ctx, params, q, k, v, mask, out, softmax_lse);
+}
+
+void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                         const FlashAttnCPUParams& params,
+                         const phi::dtype::bfloat16* q,
+                         const phi::dtype::bfloat16* k,
+                         const phi::dtype::bfloat16* v,
+                         const phi::dtype::bfloat16* mask,
+                         phi::dtype::bfloat16* out,
+                         float* softmax_lse) {
+  FlashAttnForwardImpl(dev_ctx, params, q, k, v, mask, out, softmax_lse);
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,97 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/bfloat16.h"
+#include "paddle/phi/common/float16.h"
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+namespace funcs {
+
+// The shapes of a flash attention forward on CPU.
+//
+// q is [tokens_q, num_heads, head_dim], k is [tokens_k, num_heads_k,
+// head_dim] and v is [tokens_k, num_heads_k, head_dim_v], where the tokens
+// are either batch_size sequences of max_seqlen_q / max_seqlen_k tokens, or
+// packed sequences given by cu_seqlens_q / cu_seqlens_k (int32,
+// batch_size + 1 offsets). out is [tokens_q, num_heads, head_dim_v].
+//
+// mask is an optional additive mask [mask_batch, mask_heads, max_seqlen_q,
+// max_seqlen_k] of the dtype of q, mask_batch in {1, batch_size} and
+// mask_heads in {1, num_heads}; -inf masks out a key, e.g. a padding token.
+// The causal mask is aligned to the bottom right corner, i.e. query i of a
+// sequence sees the keys j <= i + seqlen_k - seqlen_q, like flash attention
+// v2. A query which sees no key gets a zero output and a +inf lse.
+struct FlashAttnCPUParams {
+  int64_t batch_size = 0;
+  int64_t max_seqlen_q = 0;
+  int64_t max_seqlen_k = 0;
+  int64_t num_heads = 0;
+  int64_t num_heads_k = 0;
+  int64_t head_dim = 0;
+  int64_t head_dim_v = 0;
+  const int32_t* cu_seqlens_q = nullptr;
+  const int32_t* cu_seqlens_k = nullptr;
+  // the elements between two tokens, 0 for the dense [tokens, heads, dim]
+  int64_t q_stride = 0;
+  int64_t k_stride = 0;
+  int64_t v_stride = 0;
+  float scale = 1.f;
+  bool causal = false;
+  int64_t mask_batch = 0;
+  int64_t mask_heads = 0;
+  // softmax_lse is [batch_size, num_heads, lse_stride] if not null
+  int64_t lse_stride = 0;
+};
+
+// The blocked attention with an online softmax: the queries of a sequence
+// are split in blocks and all the query heads sharing a kv head (GQA/MQA)
+// run together against blocks of the keys, keeping the running max and sum
+// of every row, so the scratch memory is O(block_q * block_k) per thread
+// instead of O(seqlen_q * seqlen_k). float16 and bfloat16 blocks are
+// converted to float for the Blas GEMMs.
+TEST_API void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                                  const FlashAttnCPUParams& params,
+                                  const float* q,
+                                  const float* k,
+                                  const float* v,
+                                  const float* mask,
+                                  float* out,
+                                  float* softmax_lse);
+
+TEST_API void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                                  const FlashAttnCPUParams& params,
+                                  const phi::dtype::float16* q,
+                                  const phi::dtype::float16* k,
+                                  const phi::dtype::float16* v,
+                                  const phi::dtype::float16* mask,
+                                  phi::dtype::float16* out,
+                                  float* softmax_lse);
+
+TEST_API void FlashAttnCPUForward(const CPUContext& dev_ctx,
+                                  const FlashAttnCPUParams& params,
+                                  const phi::dtype::bfloat16* q,
+                                  const phi::dtype::bfloat16* k,
+                                  const phi::dtype::bfloat16* v,
+                                  const phi::dtype::bfloat16* mask,
+                                  phi::dtype::bfloat16* out,
+                                  float* softmax_lse);
+
+}  // namespace funcs
+}  // namespace phi
@@ -186,6 +186,22 @@ void BenchKernelXYN() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelXYNH() {
+  using T = typename KernelTuple::data_type;
+  for (int height : {1, 8, 32}) {
+    for (int d : TestSizes()) {
+      phi::DenseTensor x, y;
+      x.Resize({height, d});
+      y.Resize({height, d});
+      T* x_data = x.mutable_data<T>(PlaceType());
+      T* y_data = y.mutable_data<T>(PlaceType());
+      RandomVec<T>(height * d, x_data);
+      BenchAllImpls<KernelTuple, PlaceType>(d, x.data<T>(), y_data, d, height);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelLSTM() {
   using T = typename KernelTuple::data_type;
@@ -426,6 +442,31 @@ void BenchKernelLayerNorm() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelRMSNorm() {
+  using T = typename KernelTuple::data_type;
+  const float epsilon = 1e-6;
+  for (int left : {1, 9, 17, 50}) {
+    for (int right : TestSizes()) {
+      int sz = left * right;
+      phi::DenseTensor x, scale, out;
+      x.Resize({left, right});
+      out.Resize({left, right});
+      scale.Resize({right});
+
+      RandomVec<T>(sz, x.mutable_data<T>(PlaceType()), -2.f, 2.f);
+      RandomVec<T>(right, scale.mutable_data<T>(PlaceType()), -2.f, 2.f);
+
+      const T* x_data = x.data<T>();
+      const T* scale_data = scale.data<T>();
+      T* out_data = out.mutable_data<T>(PlaceType());
+
+      BenchAllImpls<KernelTuple, PlaceType>(
+          right, x_data, scale_data, out_data, left, epsilon, right);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelCRFDecoding() {
   using T = typename KernelTuple::data_type;
@@ -476,6 +517,7 @@ void BenchKernelVBroadcast() {
 #define BenchKernelVAdd BenchKernelXYZN
 #define BenchKernelVAddRelu BenchKernelXYZN
 #define BenchKernelVSub BenchKernelXYZN
+#define BenchKernelVSwiglu BenchKernelXYZN
 
 #define BenchKernelVScal BenchKernelAXYN
 #define BenchKernelVAddBias BenchKernelAXYN
@@ -487,6 +529,12 @@ void BenchKernelVBroadcast() {
 #define BenchKernelVSigmoid BenchKernelXYN
 #define BenchKernelVTanh BenchKernelXYN
 #define BenchKernelVCopy BenchKernelXYN
+#define BenchKernelVGeluTanh BenchKernelXYN
+#define BenchKernelVGeluErf BenchKernelXYN
+#define BenchKernelVSilu BenchKernelXYN
+
+#define BenchKernelSoftmax BenchKernelXYNH
+#define BenchKernelLogSoftmax BenchKernelXYNH
 
 #define BenchKernelLSTMCtHt BenchKernelLSTM
 #define BenchKernelLSTMC1H1 BenchKernelLSTM
@@ -507,6 +555,7 @@ BENCH_FP32_CPU(VMul);
 BENCH_FP32_CPU(VAdd);
 BENCH_FP32_CPU(VAddRelu);
 BENCH_FP32_CPU(VSub);
+BENCH_FP32_CPU(VSwiglu);
 
 // axyn
 BENCH_FP32_CPU(VScal);
@@ -520,6 +569,13 @@ BENCH_FP32_CPU(VExp);
 BENCH_FP32_CPU(VSigmoid);
 BENCH_FP32_CPU(VTanh);
 BENCH_FP32_CPU(VCopy);
+BENCH_FP32_CPU(VGeluTanh);
+BENCH_FP32_CPU(VGeluErf);
+BENCH_FP32_CPU(VSilu);
+
+// xynh
+BENCH_FP32_CPU(Softmax);
+BENCH_FP32_CPU(LogSoftmax);
 
 // LSTM
 BENCH_FP32_CPU(LSTMCtHt);
@@ -531,6 +587,7 @@ BENCH_FP32_CPU(GRUHtPart1);
 BENCH_FP32_CPU(GRUHtPart2);
 
 BENCH_FP32_CPU(LayerNorm);
+BENCH_FP32_CPU(RMSNorm);
 BENCH_FP32_CPU(CRFDecoding);
 
 BENCH_FP32_CPU(SeqPool);
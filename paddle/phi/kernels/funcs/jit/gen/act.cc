@@ -14,6 +14,7 @@
 
 #include "paddle/phi/kernels/funcs/jit/gen/act.h"
 #include <array>
+#include <limits>
 
 #include "paddle/phi/backends/cpu/cpu_info.h"
 #include "paddle/phi/kernels/funcs/jit/registry.h"
@@ -39,7 +40,17 @@ const float ALIGN32_BEG exp_float_consts[] ALIGN32_END = {  // NOLINT
     REPEAT_8TIMES(CEPHES_EXP_P5),
     REPEAT_8TIMES(EXP_MAX_INPUT),
     REPEAT_8TIMES(SIGMOID_THRESHOLD_MAX),
-    REPEAT_8TIMES(SIGMOID_THRESHOLD_MIN)};
+    REPEAT_8TIMES(SIGMOID_THRESHOLD_MIN),
+    REPEAT_8TIMES(GELU_TANH_C),
+    REPEAT_8TIMES(GELU_SQRT_2_PI),
+    REPEAT_8TIMES(GELU_SQRT1_2),
+    REPEAT_8TIMES(GELU_ERF_P),
+    REPEAT_8TIMES(GELU_ERF_A1),
+    REPEAT_8TIMES(GELU_ERF_A2),
+    REPEAT_8TIMES(GELU_ERF_A3),
+    REPEAT_8TIMES(GELU_ERF_A4),
+    REPEAT_8TIMES(GELU_ERF_A5),
+    REPEAT_8TIMES(std::numeric_limits<float>::lowest())};
 
 const int ALIGN32_BEG exp_int_0x7f[] ALIGN32_END = {  // NOLINT
     REPEAT_8TIMES(0x7f)};                             // NOLINT
@@ -80,6 +91,78 @@ void VActJitCode::genCode() {
   ret();
 }
 
+void VActNJitCode::genCode() {
+  Label l_next_block, l_rest, l_next_one, l_end;
+  movsxd(reg_n, param3.cvt32());
+  cmp(reg_n, YMM_FLOAT_BLOCK);
+  jl(l_rest, T_NEAR);
+  L(l_next_block);
+  {
+    vmovups(ymm_src, ptr[param1]);
+    act<ymm_t>(ymm_dst, ymm_src, type_);
+    vmovups(ptr[param2], ymm_dst);
+    add(param1, sizeof(float) * YMM_FLOAT_BLOCK);
+    add(param2, sizeof(float) * YMM_FLOAT_BLOCK);
+    sub(reg_n, YMM_FLOAT_BLOCK);
+    cmp(reg_n, YMM_FLOAT_BLOCK);
+    jge(l_next_block, T_NEAR);
+  }
+  L(l_rest);
+  cmp(reg_n, 0);
+  jle(l_end, T_NEAR);
+  L(l_next_one);
+  {
+    vmovss(xmm_src, ptr[param1]);
+    act<xmm_t>(xmm_dst, xmm_src, type_);
+    vmovss(ptr[param2], xmm_dst);
+    add(param1, sizeof(float));
+    add(param2, sizeof(float));
+    dec(reg_n);
+    jnz(l_next_one, T_NEAR);
+  }
+  L(l_end);
+  ret();
+}
+
+void VSwigluJitCode::genCode() {
+  Label l_next_block, l_rest, l_next_one, l_end;
+  movsxd(reg_n, param_n.cvt32());
+  cmp(reg_n, YMM_FLOAT_BLOCK);
+  jl(l_rest, T_NEAR);
+  L(l_next_block);
+  {
+    vmovups(ymm_src, ptr[param_x]);
+    silu_jmm<ymm_t>(ymm_dst, ymm_src);
+    vmovups(ymm_y, ptr[param_y]);
+    vmulps(ymm_dst, ymm_dst, ymm_y);
+    vmovups(ptr[param_z], ymm_dst);
+    add(param_x, sizeof(float) * YMM_FLOAT_BLOCK);
+    add(param_y, sizeof(float) * YMM_FLOAT_BLOCK);
+    add(param_z, sizeof(float) * YMM_FLOAT_BLOCK);
+    sub(reg_n, YMM_FLOAT_BLOCK);
+    cmp(reg_n, YMM_FLOAT_BLOCK);
+    jge(l_next_block, T_NEAR);
+  }
+  L(l_rest);
+  cmp(reg_n, 0);
+  jle(l_end, T_NEAR);
+  L(l_next_one);
+  {
+    vmovss(xmm_src, ptr[param_x]);
+    silu_jmm<xmm_t>(xmm_dst, xmm_src);
+    vmovss(xmm_y, ptr[param_y]);
+    vmulps(xmm_dst, xmm_dst, xmm_y);
+    vmovss(ptr[param_z], xmm_dst);
+    add(param_x, sizeof(float));
+    add(param_y, sizeof(float));
+    add(param_z, sizeof(float));
+    dec(reg_n);
+    jnz(l_next_one, T_NEAR);
+  }
+  L(l_end);
+  ret();
+}
+
 #define DECLARE_ACT_CREATOR(name)                                            \
   class name##Creator : public JitCodeCreator<int> {                         \
    public:                                                                   \
@@ -149,6 +232,28 @@ size_t VTanhCreator::CodeSize(const int& d) const {
 
 #undef DECLARE_ACT_CREATOR
 
+// the code loops over n, its size only depends on the activation. These run
+// on the intra-op threads, so avx2 is required: without it exp_jmm goes
+// through the shared g_tmp_mem.
+#define DECLARE_ACT_N_CREATOR(name, code_size)                               \
+  class name##Creator : public JitCodeCreator<int> {                         \
+   public:                                                                   \
+    bool CanBeUsed(const int& attr) const override {                         \
+      return phi::backends::cpu::MayIUse(phi::backends::cpu::avx2);          \
+    }                                                                        \
+    size_t CodeSize(const int& d) const override { return code_size; }       \
+    std::unique_ptr<GenBase> CreateJitCode(const int& attr) const override { \
+      return make_unique<name##JitCode>(CodeSize(attr));                     \
+    }                                                                        \
+  }
+
+DECLARE_ACT_N_CREATOR(VGeluTanh, 96 + 2 * 100 * 8);
+DECLARE_ACT_N_CREATOR(VGeluErf, 96 + 2 * 110 * 8);
+DECLARE_ACT_N_CREATOR(VSilu, 96 + 2 * 80 * 8);
+DECLARE_ACT_N_CREATOR(VSwiglu, 96 + 2 * 85 * 8);
+
+#undef DECLARE_ACT_N_CREATOR
+
 }  // namespace gen
 }  // namespace jit
 }  // namespace phi
@@ -161,3 +266,7 @@ REGISTER_JITKERNEL_GEN(kVIdentity, gen::VIdentityCreator);
 REGISTER_JITKERNEL_GEN(kVExp, gen::VExpCreator);
 REGISTER_JITKERNEL_GEN(kVSigmoid, gen::VSigmoidCreator);
 REGISTER_JITKERNEL_GEN(kVTanh, gen::VTanhCreator);
+REGISTER_JITKERNEL_GEN(kVGeluTanh, gen::VGeluTanhCreator);
+REGISTER_JITKERNEL_GEN(kVGeluErf, gen::VGeluErfCreator);
+REGISTER_JITKERNEL_GEN(kVSilu, gen::VSiluCreator);
+REGISTER_JITKERNEL_GEN(kVSwiglu, gen::VSwigluCreator);
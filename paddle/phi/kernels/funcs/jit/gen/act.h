@@ -40,6 +40,17 @@ extern int g_tmp_mem[];
 #define CEPHES_EXP_P4 1.6666665459E-1
 #define CEPHES_EXP_P5 5.0000001201E-1
 
+// GELU, the erf is of Abramowitz and Stegun 7.1.26
+#define GELU_TANH_C 0.044715f
+#define GELU_SQRT_2_PI 0.79788456080286535588f
+#define GELU_SQRT1_2 0.70710678118654752440f
+#define GELU_ERF_P 0.3275911f
+#define GELU_ERF_A1 0.254829592f
+#define GELU_ERF_A2 -0.284496736f
+#define GELU_ERF_A3 1.421413741f
+#define GELU_ERF_A4 -1.453152027f
+#define GELU_ERF_A5 1.061405429f
+
 #define REPEAT_8TIMES(val) val, val, val, val, val, val, val, val
 
 #define OFFSET_EXP_ONE 0 * YMM_FLOAT_BLOCK * sizeof(float)
@@ -59,6 +70,16 @@ extern int g_tmp_mem[];
 #define OFFSET_EXP_MAX_INPUT 14 * YMM_FLOAT_BLOCK * sizeof(float)
 #define OFFSET_SIGMOID_MAX 15 * YMM_FLOAT_BLOCK * sizeof(float)
 #define OFFSET_SIGMOID_MIN 16 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_TANH_C 17 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_SQRT_2_PI 18 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_SQRT1_2 19 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_P 20 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_A1 21 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_A2 22 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_A3 23 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_A4 24 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_GELU_ERF_A5 25 * YMM_FLOAT_BLOCK * sizeof(float)
+#define OFFSET_FLT_LOWEST 26 * YMM_FLOAT_BLOCK * sizeof(float)
 
 class VActFunc : public JitCode {
  public:
@@ -232,6 +253,119 @@ class VActFunc : public JitCode {
     pop(reg_ptr_global);
   }
 
+  // compute SILU with ymm, xmm
+  template <typename JMM>
+  void silu_jmm(JMM& dst,          // NOLINT
+                JMM& src,          // NOLINT
+                int src_idx = 11,  // NOLINT
+                int fx_idx = 12,
+                int fy_idx = 13,
+                int mask_idx = 14,
+                int tmp_idx = 15) {
+    // y = x / (1 + e^-x), dst can not be src
+    JMM jmm_src = JMM(src_idx);
+    JMM jmm_tmp = JMM(tmp_idx);
+    reg64_t reg_ptr_global = rax;
+    push(reg_ptr_global);
+    mov(reg_ptr_global, reinterpret_cast<size_t>(exp_float_consts));
+    vxorps(jmm_tmp, jmm_tmp, jmm_tmp);
+    vsubps(jmm_src, jmm_tmp, src);
+    exp_jmm<JMM>(dst, jmm_src, src_idx, fx_idx, fy_idx, mask_idx, tmp_idx);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_ONE]);
+    vaddps(dst, dst, jmm_tmp);
+    vdivps(dst, src, dst);
+    pop(reg_ptr_global);
+  }
+
+  // compute GELU of tanh approximation with ymm, xmm
+  template <typename JMM>
+  void gelu_tanh_jmm(JMM& dst,          // NOLINT
+                     JMM& src,          // NOLINT
+                     int src_idx = 11,  // NOLINT
+                     int fx_idx = 12,
+                     int fy_idx = 13,
+                     int mask_idx = 14,
+                     int tmp_idx = 15) {
+    // y = 0.5x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715x^3))),
+    // dst can not be src
+    JMM jmm_tmp = JMM(tmp_idx);
+    reg64_t reg_ptr_global = rax;
+    push(reg_ptr_global);
+    mov(reg_ptr_global, reinterpret_cast<size_t>(exp_float_consts));
+    vmulps(dst, src, src);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_GELU_TANH_C]);
+    vmulps(dst, dst, jmm_tmp);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_ONE]);
+    vaddps(dst, dst, jmm_tmp);
+    vmulps(dst, dst, src);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_GELU_SQRT_2_PI]);
+    vmulps(dst, dst, jmm_tmp);
+    tanh_jmm<JMM>(dst, dst, src_idx, fx_idx, fy_idx, mask_idx, tmp_idx);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_ONE]);
+    vaddps(dst, dst, jmm_tmp);
+    vmulps(dst, dst, src);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_0P5]);
+    vmulps(dst, dst, jmm_tmp);
+    pop(reg_ptr_global);
+  }
+
+  // compute GELU of erf with ymm, xmm
+  template <typename JMM>
+  void gelu_erf_jmm(JMM& dst,          // NOLINT
+                    JMM& src,          // NOLINT
+                    int z_idx = 2,     // NOLINT
+                    int t_idx = 3,     // NOLINT
+                    int src_idx = 11,  // NOLINT
+                    int fx_idx = 12,
+                    int fy_idx = 13,
+                    int mask_idx = 14,
+                    int tmp_idx = 15) {
+    // y = 0.5x * (1 + erf(x / sqrt(2))), with z = |x| / sqrt(2),
+    // t = 1 / (1 + p * z) and q = 0.5 * (1 - erf(z))
+    //   = 0.5 * t * (a1 + t * (a2 + t * (a3 + t * (a4 + t * a5)))) * e^(-z^2)
+    // y = x * (1 - q) if x >= 0 else x * q, dst can not be src
+    JMM jmm_z = JMM(z_idx);
+    JMM jmm_t = JMM(t_idx);
+    JMM jmm_tmp = JMM(tmp_idx);
+    reg64_t reg_ptr_global = rax;
+    push(reg_ptr_global);
+    mov(reg_ptr_global, reinterpret_cast<size_t>(exp_float_consts));
+    vxorps(jmm_tmp, jmm_tmp, jmm_tmp);
+    vsubps(jmm_z, jmm_tmp, src);
+    vmaxps(jmm_z, jmm_z, src);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_GELU_SQRT1_2]);
+    vmulps(jmm_z, jmm_z, jmm_tmp);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_GELU_ERF_P]);
+    vmulps(jmm_t, jmm_z, jmm_tmp);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_ONE]);
+    vaddps(jmm_t, jmm_t, jmm_tmp);
+    vdivps(jmm_t, jmm_tmp, jmm_t);
+    vmulps(jmm_z, jmm_z, jmm_z);
+    vxorps(jmm_tmp, jmm_tmp, jmm_tmp);
+    vsubps(jmm_z, jmm_tmp, jmm_z);
+    exp_jmm<JMM>(dst, jmm_z, src_idx, fx_idx, fy_idx, mask_idx, tmp_idx);
+    // the polynomial of t
+    vmovaps(jmm_z, ptr[reg_ptr_global + OFFSET_GELU_ERF_A5]);
+    for (size_t i = OFFSET_GELU_ERF_A4; i >= OFFSET_GELU_ERF_A1;
+         i -= (YMM_FLOAT_BLOCK * sizeof(float))) {
+      vmulps(jmm_z, jmm_z, jmm_t);
+      vmovaps(jmm_tmp, ptr[reg_ptr_global + i]);  // A4~A1
+      vaddps(jmm_z, jmm_z, jmm_tmp);
+    }
+    vmulps(jmm_z, jmm_z, jmm_t);
+    vmulps(dst, dst, jmm_z);
+    vmovaps(jmm_tmp, ptr[reg_ptr_global + OFFSET_EXP_0P5]);
+    vmulps(dst, dst, jmm_tmp);
+    vmovaps(jmm_t, ptr[reg_ptr_global + OFFSET_EXP_ONE]);
+    vsubps(jmm_t, jmm_t, dst);
+    // select q where x < 0
+    vxorps(jmm_tmp, jmm_tmp, jmm_tmp);
+    vcmpltps(jmm_z, src, jmm_tmp);
+    vblendvps(dst, jmm_t, dst, jmm_z);
+    vmulps(dst, dst, src);
+    pop(reg_ptr_global);
+  }
+
   // compute IDENTITY with ymm, xmm
   template <typename JMM>
   void identity_jmm(JMM& dst, JMM& src, int zero_idx) {  // NOLINT
@@ -242,6 +376,34 @@ class VActFunc : public JitCode {
     // dst.setIdx(src.getIdx());
   }
 
+  // reduce the 8 floats of src by ADD or MAX into every float of the xmm
+  // with the same index
+  void reduce_ymm(const ymm_t& src, operand_type type, int tmp_idx = 15) {
+    xmm_t xmm_src = xmm_t(src.getIdx());
+    xmm_t xmm_tmp = xmm_t(tmp_idx);
+    auto reduce_op = [&]() {
+      if (type == operand_type::MAX) {
+        vmaxps(xmm_src, xmm_src, xmm_tmp);
+      } else {
+        vaddps(xmm_src, xmm_src, xmm_tmp);
+      }
+    };
+    vextractf128(xmm_tmp, src, 1);
+    reduce_op();
+    vpermilps(xmm_tmp, xmm_src, 0x4E);  // swap the 64 bits halves
+    reduce_op();
+    vpermilps(xmm_tmp, xmm_src, 0xB1);  // swap the neighbours
+    reduce_op();
+  }
+
+  // broadcast the lowest float of the xmm with the same index to every float
+  // of dst, without the register form of AVX2 vbroadcastss
+  void broadcast_ymm(const ymm_t& dst) {
+    xmm_t xmm_dst = xmm_t(dst.getIdx());
+    vpermilps(xmm_dst, xmm_dst, 0);
+    vinsertf128(dst, dst, xmm_dst, 1);
+  }
+
   template <typename JMM>
   void act(JMM& dst, JMM& src, operand_type type) {  // NOLINT
     // use 11~15
@@ -264,6 +426,16 @@ class VActFunc : public JitCode {
       case operand_type::IDENTITY:
         identity_jmm<JMM>(dst, src, 15);
         break;
+      case operand_type::SILU:
+        silu_jmm<JMM>(dst, src, 11, 12, 13, 14, 15);
+        break;
+      case operand_type::GELU_TANH:
+        gelu_tanh_jmm<JMM>(dst, src, 11, 12, 13, 14, 15);
+        break;
+      case operand_type::GELU_ERF:
+        // use 2, 3 as well
+        gelu_erf_jmm<JMM>(dst, src, 2, 3, 11, 12, 13, 14, 15);
+        break;
       default:
         PADDLE_THROW(phi::errors::Unimplemented(
             "Do not support operand type code: %d.", type));
@@ -345,6 +517,96 @@ DECLARE_ACT_JITCODE(VTanh, operand_type::TANH);
 
 #undef DECLARE_ACT_JITCODE
 
+// Unlike VActJitCode, which unrolls the d elements of the attr, the code
+// loops over the runtime n, so the size of the code does not grow with n.
+class VActNJitCode : public VActFunc {
+ public:
+  explicit VActNJitCode(operand_type type,
+                        size_t code_size,
+                        void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr), type_(type) {
+    if (!(type_ == operand_type::GELU_TANH ||
+          type_ == operand_type::GELU_ERF || type_ == operand_type::SILU)) {
+      PADDLE_THROW(phi::errors::Unimplemented(
+          "Do not support operand type code: %d.", type));
+    }
+    this->genCode();
+  }
+
+  std::string name() const override {
+    std::string base = "VActNJitCode";
+    switch (type_) {
+      case operand_type::GELU_TANH:
+        base += "_GeluTanh";
+        break;
+      case operand_type::GELU_ERF:
+        base += "_GeluErf";
+        break;
+      case operand_type::SILU:
+        base += "_Silu";
+        break;
+      default:
+        break;
+    }
+    return base;
+  }
+  void genCode() override;
+
+ protected:
+  operand_type type_;
+  reg64_t param1{abi_param1};
+  reg64_t param2{abi_param2};
+  reg64_t param3{abi_param3};
+  reg64_t reg_n{r8};
+
+  xmm_t xmm_src = xmm_t(0);
+  ymm_t ymm_src = ymm_t(0);
+
+  xmm_t xmm_dst = xmm_t(1);
+  ymm_t ymm_dst = ymm_t(1);
+};
+
+#define DECLARE_ACT_N_JITCODE(name, op_type)                           \
+  class name##JitCode : public VActNJitCode {                          \
+   public:                                                             \
+    explicit name##JitCode(size_t code_size, void* code_ptr = nullptr) \
+        : VActNJitCode(op_type, code_size, code_ptr) {}                \
+  };
+
+DECLARE_ACT_N_JITCODE(VGeluTanh, operand_type::GELU_TANH);
+DECLARE_ACT_N_JITCODE(VGeluErf, operand_type::GELU_ERF);
+DECLARE_ACT_N_JITCODE(VSilu, operand_type::SILU);
+
+#undef DECLARE_ACT_N_JITCODE
+
+// z = silu(x) * y, loops over the runtime n as VActNJitCode
+class VSwigluJitCode : public VActFunc {
+ public:
+  explicit VSwigluJitCode(size_t code_size, void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr) {
+    this->genCode();
+  }
+
+  DECLARE_JIT_CODE(VSwigluJitCode);
+  void genCode() override;
+
+ private:
+  reg64_t param_x{abi_param1};
+  reg64_t param_y{abi_param2};
+  reg64_t param_z{abi_param3};
+  reg64_t param_n{abi_param4};
+  reg64_t reg_n{r8};
+
+  xmm_t xmm_src = xmm_t(0);
+  ymm_t ymm_src = ymm_t(0);
+
+  xmm_t xmm_dst = xmm_t(1);
+  ymm_t ymm_dst = ymm_t(1);
+
+  xmm_t xmm_y = xmm_t(2);
+  ymm_t ymm_y = ymm_t(2);
+};
+
 }  // namespace gen
 }  // namespace jit
 }  // namespace phi
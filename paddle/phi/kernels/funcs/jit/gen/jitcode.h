@@ -61,7 +61,10 @@ typedef enum {
   SQUARE,
   SIGMOID,
   TANH,
-  IDENTITY
+  IDENTITY,
+  GELU_TANH,
+  GELU_ERF,
+  SILU
 } operand_type;
 
 #define DECLARE_JIT_CODE(codename) \
@@ -0,0 +1,135 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/jit/gen/rmsnorm.h"
+
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/jit/registry.h"
+
+namespace phi::jit::gen {
+
+void RMSNormJitCode::genCode() {
+  Label l_next_row, l_end;
+  vmovaps(xmm_epsilon, xmm_epsilon_param);
+  movsxd(reg_height, param_height.cvt32());
+  movsxd(reg_right, param_right.cvt32());
+  cmp(reg_height, 0);
+  jle(l_end, T_NEAR);
+  cmp(reg_right, 0);
+  jle(l_end, T_NEAR);
+  mov(rax, reinterpret_cast<size_t>(exp_float_consts));
+  vmovss(xmm_one, ptr[rax + OFFSET_EXP_ONE]);
+  vcvtsi2ss(xmm_inv_right, xmm_inv_right, reg_right);
+  vdivss(xmm_inv_right, xmm_one, xmm_inv_right);
+  L(l_next_row);
+  {
+    // sum of x^2
+    Label l_sum_block, l_sum_rest, l_sum_one, l_sum_end;
+    vxorps(ymm_sum, ymm_sum, ymm_sum);
+    mov(reg_ptr_x, param_x);
+    mov(reg_rest, reg_right);
+    cmp(reg_rest, YMM_FLOAT_BLOCK);
+    jl(l_sum_rest, T_NEAR);
+    L(l_sum_block);
+    {
+      vmovups(ymm_src, ptr[reg_ptr_x]);
+      vmulps(ymm_src, ymm_src, ymm_src);
+      vaddps(ymm_sum, ymm_sum, ymm_src);
+      add(reg_ptr_x, sizeof(float) * YMM_FLOAT_BLOCK);
+      sub(reg_rest, YMM_FLOAT_BLOCK);
+      cmp(reg_rest, YMM_FLOAT_BLOCK);
+      jge(l_sum_block, T_NEAR);
+    }
+    L(l_sum_rest);
+    reduce_ymm(ymm_sum, operand_type::ADD);
+    cmp(reg_rest, 0);
+    jle(l_sum_end, T_NEAR);
+    L(l_sum_one);
+    {
+      vmovss(xmm_src, ptr[reg_ptr_x]);
+      vmulss(xmm_src, xmm_src, xmm_src);
+      vaddss(xmm_sum, xmm_sum, xmm_src);
+      add(reg_ptr_x, sizeof(float));
+      dec(reg_rest);
+      jnz(l_sum_one, T_NEAR);
+    }
+    L(l_sum_end);
+
+    // 1 / sqrt(sum / right + epsilon)
+    vmulss(xmm_sum, xmm_sum, xmm_inv_right);
+    vaddss(xmm_sum, xmm_sum, xmm_epsilon);
+    vsqrtss(xmm_sum, xmm_sum, xmm_sum);
+    vdivss(xmm_sum, xmm_one, xmm_sum);
+    broadcast_ymm(ymm_sum);
+
+    // y = x * inv_rms * scale, moves param_x and param_y to the next row
+    Label l_out_block, l_out_rest, l_out_one, l_out_end;
+    mov(reg_ptr_scale, param_scale);
+    mov(reg_rest, reg_right);
+    cmp(reg_rest, YMM_FLOAT_BLOCK);
+    jl(l_out_rest, T_NEAR);
+    L(l_out_block);
+    {
+      vmovups(ymm_src, ptr[param_x]);
+      vmulps(ymm_src, ymm_src, ymm_sum);
+      vmovups(ymm_tmp, ptr[reg_ptr_scale]);
+      vmulps(ymm_src, ymm_src, ymm_tmp);
+      vmovups(ptr[param_y], ymm_src);
+      add(param_x, sizeof(float) * YMM_FLOAT_BLOCK);
+      add(reg_ptr_scale, sizeof(float) * YMM_FLOAT_BLOCK);
+      add(param_y, sizeof(float) * YMM_FLOAT_BLOCK);
+      sub(reg_rest, YMM_FLOAT_BLOCK);
+      cmp(reg_rest, YMM_FLOAT_BLOCK);
+      jge(l_out_block, T_NEAR);
+    }
+    L(l_out_rest);
+    cmp(reg_rest, 0);
+    jle(l_out_end, T_NEAR);
+    L(l_out_one);
+    {
+      vmovss(xmm_src, ptr[param_x]);
+      vmulss(xmm_src, xmm_src, xmm_sum);
+      vmovss(xmm_tmp, ptr[reg_ptr_scale]);
+      vmulss(xmm_src, xmm_src, xmm_tmp);
+      vmovss(ptr[param_y], xmm_src);
+      add(param_x, sizeof(float));
+      add(reg_ptr_scale, sizeof(float));
+      add(param_y, sizeof(float));
+      dec(reg_rest);
+      jnz(l_out_one, T_NEAR);
+    }
+    L(l_out_end);
+    dec(reg_height);
+    jnz(l_next_row, T_NEAR);
+  }
+  L(l_end);
+  ret();
+}
+
+class RMSNormCreator : public JitCodeCreator<int> {
+ public:
+  bool CanBeUsed(const int& right) const override {
+    return phi::backends::cpu::MayIUse(phi::backends::cpu::avx);
+  }
+  size_t CodeSize(const int& right) const override { return 96 + 80 * 8; }
+  std::unique_ptr<GenBase> CreateJitCode(const int& right) const override {
+    return make_unique<RMSNormJitCode>(CodeSize(right));
+  }
+};
+
+}  // namespace phi::jit::gen
+
+namespace gen = phi::jit::gen;
+
+REGISTER_JITKERNEL_GEN(kRMSNorm, gen::RMSNormCreator);
@@ -0,0 +1,68 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include <string>
+
+#include "glog/logging.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/jit/gen/act.h"
+
+namespace phi {
+namespace jit {
+namespace gen {
+
+// y = x / sqrt(mean(x^2) + epsilon) * scale of each row of height rows of
+// right floats, in two passes over the row.
+class RMSNormJitCode : public VActFunc {
+ public:
+  explicit RMSNormJitCode(size_t code_size, void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr) {
+    this->genCode();
+  }
+
+  DECLARE_JIT_CODE(RMSNormJitCode);
+  void genCode() override;
+
+ private:
+  reg64_t param_x{abi_param1};
+  reg64_t param_scale{abi_param2};
+  reg64_t param_y{abi_param3};
+  reg64_t param_height{abi_param4};
+  reg64_t param_right{abi_param5};
+
+  reg64_t reg_height{r9};
+  reg64_t reg_right{r10};
+  reg64_t reg_ptr_x{r11};
+  reg64_t reg_ptr_scale{rax};
+  // param_height is free once copied
+  reg64_t reg_rest{rcx};
+
+  // epsilon is passed in xmm0
+  xmm_t xmm_epsilon_param = xmm_t(0);
+  xmm_t xmm_src = xmm_t(0);
+  ymm_t ymm_src = ymm_t(0);
+  xmm_t xmm_sum = xmm_t(1);
+  ymm_t ymm_sum = ymm_t(1);
+  xmm_t xmm_tmp = xmm_t(2);
+  ymm_t ymm_tmp = ymm_t(2);
+  xmm_t xmm_one = xmm_t(3);
+  xmm_t xmm_inv_right = xmm_t(4);
+  xmm_t xmm_epsilon = xmm_t(5);
+};
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace phi
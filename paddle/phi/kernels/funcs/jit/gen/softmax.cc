@@ -0,0 +1,170 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/jit/gen/softmax.h"
+
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/jit/registry.h"
+
+namespace phi::jit::gen {
+
+template <typename BlockFunc, typename RestBeginFunc, typename OneFunc>
+void SoftmaxJitCode::row_pass(BlockFunc block,
+                              RestBeginFunc rest_begin,
+                              OneFunc one) {
+  Label l_next_block, l_rest, l_next_one, l_end;
+  mov(reg_ptr_x, param_x);
+  mov(reg_ptr_y, param_y);
+  mov(reg_rest, reg_n);
+  cmp(reg_rest, YMM_FLOAT_BLOCK);
+  jl(l_rest, T_NEAR);
+  L(l_next_block);
+  {
+    block();
+    add(reg_ptr_x, sizeof(float) * YMM_FLOAT_BLOCK);
+    add(reg_ptr_y, sizeof(float) * YMM_FLOAT_BLOCK);
+    sub(reg_rest, YMM_FLOAT_BLOCK);
+    cmp(reg_rest, YMM_FLOAT_BLOCK);
+    jge(l_next_block, T_NEAR);
+  }
+  L(l_rest);
+  rest_begin();
+  cmp(reg_rest, 0);
+  jle(l_end, T_NEAR);
+  L(l_next_one);
+  {
+    one();
+    add(reg_ptr_x, sizeof(float));
+    add(reg_ptr_y, sizeof(float));
+    dec(reg_rest);
+    jnz(l_next_one, T_NEAR);
+  }
+  L(l_end);
+}
+
+void SoftmaxJitCode::genCode() {
+  Label l_next_row, l_end;
+  movsxd(reg_n, param_n.cvt32());
+  movsxd(reg_height, param_height.cvt32());
+  cmp(reg_n, 0);
+  jle(l_end, T_NEAR);
+  cmp(reg_height, 0);
+  jle(l_end, T_NEAR);
+  L(l_next_row);
+  {
+    // max of the row
+    mov(rax, reinterpret_cast<size_t>(exp_float_consts));
+    vmovaps(ymm_max, ptr[rax + OFFSET_FLT_LOWEST]);
+    row_pass([&] { vmaxps(ymm_max, ymm_max, ptr[reg_ptr_x]); },
+             [&] { reduce_ymm(ymm_max, operand_type::MAX); },
+             [&] { vmaxss(xmm_max, xmm_max, ptr[reg_ptr_x]); });
+    broadcast_ymm(ymm_max);
+
+    // sum of e^(x - max), which is y of softmax
+    vxorps(ymm_sum, ymm_sum, ymm_sum);
+    row_pass(
+        [&] {
+          vmovups(ymm_src, ptr[reg_ptr_x]);
+          vsubps(ymm_src, ymm_src, ymm_max);
+          exp_jmm<ymm_t>(ymm_dst, ymm_src);
+          if (!is_log_) {
+            vmovups(ptr[reg_ptr_y], ymm_dst);
+          }
+          vaddps(ymm_sum, ymm_sum, ymm_dst);
+        },
+        [&] { reduce_ymm(ymm_sum, operand_type::ADD); },
+        [&] {
+          vmovss(xmm_src, ptr[reg_ptr_x]);
+          vsubss(xmm_src, xmm_src, xmm_max);
+          exp_jmm<xmm_t>(xmm_dst, xmm_src);
+          if (!is_log_) {
+            vmovss(ptr[reg_ptr_y], xmm_dst);
+          }
+          vaddss(xmm_sum, xmm_sum, xmm_dst);
+        });
+
+    if (is_log_) {
+      // max + log(sum) with x87, ln(sum) = ln(2) * log2(sum)
+      sub(rsp, sizeof(float) * 2);
+      vmovss(ptr[rsp], xmm_sum);
+      fldln2();
+      fld(dword[rsp]);
+      fyl2x();
+      fstp(dword[rsp]);
+      vaddss(xmm_sum, xmm_max, ptr[rsp]);
+      add(rsp, sizeof(float) * 2);
+      broadcast_ymm(ymm_sum);
+      row_pass(
+          [&] {
+            vmovups(ymm_src, ptr[reg_ptr_x]);
+            vsubps(ymm_dst, ymm_src, ymm_sum);
+            vmovups(ptr[reg_ptr_y], ymm_dst);
+          },
+          [] {},
+          [&] {
+            vmovss(xmm_src, ptr[reg_ptr_x]);
+            vsubss(xmm_dst, xmm_src, xmm_sum);
+            vmovss(ptr[reg_ptr_y], xmm_dst);
+          });
+    } else {
+      mov(rax, reinterpret_cast<size_t>(exp_float_consts));
+      vmovss(xmm_src, ptr[rax + OFFSET_EXP_ONE]);
+      vdivss(xmm_sum, xmm_src, xmm_sum);
+      broadcast_ymm(ymm_sum);
+      row_pass(
+          [&] {
+            vmulps(ymm_dst, ymm_sum, ptr[reg_ptr_y]);
+            vmovups(ptr[reg_ptr_y], ymm_dst);
+          },
+          [] {},
+          [&] {
+            vmulss(xmm_dst, xmm_sum, ptr[reg_ptr_y]);
+            vmovss(ptr[reg_ptr_y], xmm_dst);
+          });
+    }
+    // the last pass leaves the pointers at the next row
+    mov(param_x, reg_ptr_x);
+    mov(param_y, reg_ptr_y);
+    dec(reg_height);
+    jnz(l_next_row, T_NEAR);
+  }
+  L(l_end);
+  ret();
+}
+
+// avx2 for exp_jmm without the shared g_tmp_mem, as the rows run on the
+// intra-op threads
+#define DECLARE_SOFTMAX_CREATOR(name, is_log)                                \
+  class name##Creator : public JitCodeCreator<int> {                         \
+   public:                                                                   \
+    bool CanBeUsed(const int& attr) const override {                         \
+      return phi::backends::cpu::MayIUse(phi::backends::cpu::avx2);          \
+    }                                                                        \
+    size_t CodeSize(const int& d) const override { return 96 + 320 * 8; }    \
+    std::unique_ptr<GenBase> CreateJitCode(const int& attr) const override { \
+      return make_unique<SoftmaxJitCode>(is_log, CodeSize(attr));            \
+    }                                                                        \
+  }
+
+DECLARE_SOFTMAX_CREATOR(Softmax, false);
+DECLARE_SOFTMAX_CREATOR(LogSoftmax, true);
+
+#undef DECLARE_SOFTMAX_CREATOR
+
+}  // namespace phi::jit::gen
+
+namespace gen = phi::jit::gen;
+
+REGISTER_JITKERNEL_GEN(kSoftmax, gen::SoftmaxCreator);
+REGISTER_JITKERNEL_GEN(kLogSoftmax, gen::LogSoftmaxCreator);
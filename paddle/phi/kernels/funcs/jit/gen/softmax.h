@@ -0,0 +1,74 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#pragma once
+
+#include <string>
+
+#include "glog/logging.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/jit/gen/act.h"
+
+namespace phi {
+namespace jit {
+namespace gen {
+
+// The softmax, or log softmax, of each row of height rows of n floats: the
+// max, the sum of exp and the output are three passes over the row.
+class SoftmaxJitCode : public VActFunc {
+ public:
+  explicit SoftmaxJitCode(bool is_log,
+                          size_t code_size,
+                          void* code_ptr = nullptr)
+      : VActFunc(code_size, code_ptr), is_log_(is_log) {
+    this->genCode();
+  }
+
+  std::string name() const override {
+    return is_log_ ? "LogSoftmaxJitCode" : "SoftmaxJitCode";
+  }
+  void genCode() override;
+
+ private:
+  // block() for every YMM_FLOAT_BLOCK floats of the row, then rest_begin(),
+  // then one() for every rest float. Each step moves reg_ptr_x and reg_ptr_y.
+  template <typename BlockFunc, typename RestBeginFunc, typename OneFunc>
+  void row_pass(BlockFunc block, RestBeginFunc rest_begin, OneFunc one);
+
+  bool is_log_;
+  reg64_t param_x{abi_param1};
+  reg64_t param_y{abi_param2};
+  reg64_t param_n{abi_param3};
+  reg64_t param_height{abi_param4};
+
+  reg64_t reg_n{r8};
+  reg64_t reg_height{r9};
+  reg64_t reg_ptr_x{r10};
+  reg64_t reg_ptr_y{r11};
+  // param_height is free once copied
+  reg64_t reg_rest{rcx};
+
+  xmm_t xmm_src = xmm_t(0);
+  ymm_t ymm_src = ymm_t(0);
+  xmm_t xmm_dst = xmm_t(1);
+  ymm_t ymm_dst = ymm_t(1);
+  xmm_t xmm_max = xmm_t(2);
+  ymm_t ymm_max = ymm_t(2);
+  xmm_t xmm_sum = xmm_t(3);
+  ymm_t ymm_sum = ymm_t(3);
+};
+
+}  // namespace gen
+}  // namespace jit
+}  // namespace phi
@@ -47,6 +47,12 @@ const char* to_string(KernelType kt) {
     ONE_CASE(kVSquare);
     ONE_CASE(kVSigmoid);
     ONE_CASE(kVTanh);
+    ONE_CASE(kVGeluTanh);
+    ONE_CASE(kVGeluErf);
+    ONE_CASE(kVSilu);
+    ONE_CASE(kVSwiglu);
+    ONE_CASE(kSoftmax);
+    ONE_CASE(kLogSoftmax);
     ONE_CASE(kLSTMCtHt);
     ONE_CASE(kLSTMC1H1);
     ONE_CASE(kGRUH1);
@@ -54,6 +60,7 @@ const char* to_string(KernelType kt) {
     ONE_CASE(kGRUHtPart2);
     ONE_CASE(kCRFDecoding);
     ONE_CASE(kLayerNorm);
+    ONE_CASE(kRMSNorm);
     ONE_CASE(kSeqPool);
     ONE_CASE(kMatMul);
     ONE_CASE(kAdam);
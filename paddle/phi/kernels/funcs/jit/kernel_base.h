@@ -34,22 +34,29 @@ typedef enum {
   kLSTMCtHt,
   kLSTMC1H1,
   kLayerNorm,
+  kLogSoftmax,
   kMatMul,
+  kRMSNorm,
   kSeqPool,
+  kSoftmax,
   kVAdd,
   kVAddBias,
   kVAddRelu,
   kVBroadcast,
   kVCopy,
   kVExp,
+  kVGeluErf,
+  kVGeluTanh,
   kVIdentity,
   kVMul,
   kVRelu,
   kVScal,
   kSgd,
   kVSigmoid,
+  kVSilu,
   kVSquare,
   kVSub,
+  kVSwiglu,
   kVTanh,
 } KernelType;
 
@@ -96,6 +103,19 @@ struct XRNSTuple {
   typedef void (*func_type)(const T*, T*, int, int);
 };
 
+// x, y, n, height: height rows of n contiguous elements
+template <typename T>
+struct XYNHTuple {
+  typedef T data_type;
+  typedef int attr_type;
+  typedef void (*func_type)(const T*, T*, int, int);
+};
+
+// The attr the softmax, RMSNorm, GELU, SiLU and SwiGLU kernels are got
+// with. Their code loops over the size passed at call time, so one code
+// serves every size instead of one cached per size.
+constexpr int kAnySize = 0;
+
 #define DECLARE_KERNELTUPLE(kernel_tuple, type)        \
   template <typename T>                                \
   struct type##Tuple : public kernel_tuple<T> {        \
@@ -107,6 +127,7 @@ DECLARE_KERNELTUPLE(XYZNTuple, VMul);
 DECLARE_KERNELTUPLE(XYZNTuple, VAdd);
 DECLARE_KERNELTUPLE(XYZNTuple, VAddRelu);
 DECLARE_KERNELTUPLE(XYZNTuple, VSub);
+DECLARE_KERNELTUPLE(XYZNTuple, VSwiglu);
 
 DECLARE_KERNELTUPLE(AXYNTuple, VScal);
 DECLARE_KERNELTUPLE(AXYNTuple, VAddBias);
@@ -118,6 +139,12 @@ DECLARE_KERNELTUPLE(XYNTuple, VExp);
 DECLARE_KERNELTUPLE(XYNTuple, VSigmoid);
 DECLARE_KERNELTUPLE(XYNTuple, VTanh);
 DECLARE_KERNELTUPLE(XYNTuple, VCopy);
+DECLARE_KERNELTUPLE(XYNTuple, VGeluTanh);
+DECLARE_KERNELTUPLE(XYNTuple, VGeluErf);
+DECLARE_KERNELTUPLE(XYNTuple, VSilu);
+
+DECLARE_KERNELTUPLE(XYNHTuple, Softmax);
+DECLARE_KERNELTUPLE(XYNHTuple, LogSoftmax);
 
 typedef struct lstm_t {
   void* gates;  // gates: x_ch, x_ih, x_fh, x_oh
@@ -334,6 +361,15 @@ struct LayerNormTuple {
       T*, T*, T*, T*, const T*, const T*, int, const float, int);
 };
 
+// x, scale, y, height, epsilon, right
+template <typename T>
+struct RMSNormTuple {
+  static constexpr KernelType kernel_type = kRMSNorm;
+  typedef T data_type;
+  typedef int attr_type;
+  typedef void (*func_type)(const T*, const T*, T*, int, const float, int);
+};
+
 // Just for adding to kernel pool without template
 class Kernel {
  public:
@@ -26,6 +26,7 @@ REGISTER_REFER_KERNEL(VMul);
 REGISTER_REFER_KERNEL(VAdd);
 REGISTER_REFER_KERNEL(VAddRelu);
 REGISTER_REFER_KERNEL(VSub);
+REGISTER_REFER_KERNEL(VSwiglu);
 
 REGISTER_REFER_KERNEL(VScal);
 REGISTER_REFER_KERNEL(VAddBias);
@@ -37,6 +38,12 @@ REGISTER_REFER_KERNEL(VSquare);
 REGISTER_REFER_KERNEL(VExp);
 REGISTER_REFER_KERNEL(VSigmoid);
 REGISTER_REFER_KERNEL(VTanh);
+REGISTER_REFER_KERNEL(VGeluTanh);
+REGISTER_REFER_KERNEL(VGeluErf);
+REGISTER_REFER_KERNEL(VSilu);
+
+REGISTER_REFER_KERNEL(Softmax);
+REGISTER_REFER_KERNEL(LogSoftmax);
 
 REGISTER_REFER_KERNEL(LSTMCtHt);
 REGISTER_REFER_KERNEL(LSTMC1H1);
@@ -47,6 +54,7 @@ REGISTER_REFER_KERNEL(GRUHtPart2);
 
 REGISTER_REFER_KERNEL(CRFDecoding);
 REGISTER_REFER_KERNEL(LayerNorm);
+REGISTER_REFER_KERNEL(RMSNorm);
 REGISTER_REFER_KERNEL(SeqPool);
 REGISTER_REFER_KERNEL(MatMul);
 REGISTER_REFER_KERNEL(EmbSeqPool);
@@ -135,6 +135,43 @@ void VTanh(const T* x, T* y, int n) {
   }
 }
 
+template <typename T>
+void VGeluTanh(const T* x, T* y, int n) {
+  // y = 0.5x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715x^3)))
+  const T k = static_cast<T>(0.79788456080286535588);
+  const T c = static_cast<T>(0.044715);
+  for (int i = 0; i < n; ++i) {
+    T u = k * x[i] * (static_cast<T>(1) + c * x[i] * x[i]);
+    y[i] = static_cast<T>(0.5) * x[i] * (static_cast<T>(1) + std::tanh(u));
+  }
+}
+
+template <typename T>
+void VGeluErf(const T* x, T* y, int n) {
+  // y = 0.5x * (1 + erf(x / sqrt(2)))
+  const T k = static_cast<T>(0.70710678118654752440);
+  for (int i = 0; i < n; ++i) {
+    y[i] = static_cast<T>(0.5) * x[i] *
+           (static_cast<T>(1) + std::erf(k * x[i]));
+  }
+}
+
+template <typename T>
+void VSilu(const T* x, T* y, int n) {
+  // y = x / (1 + e^-x)
+  for (int i = 0; i < n; ++i) {
+    y[i] = x[i] / (static_cast<T>(1) + std::exp(-x[i]));
+  }
+}
+
+template <typename T>
+void VSwiglu(const T* x, const T* y, T* z, int n) {
+  // z = silu(x) * y
+  for (int i = 0; i < n; ++i) {
+    z[i] = x[i] / (static_cast<T>(1) + std::exp(-x[i])) * y[i];
+  }
+}
+
 template <typename T>
 void (*getActFunc(KernelType type))(const T*, T*, int) {  // NOLINT
   if (type == kVSigmoid) {
@@ -353,6 +390,68 @@ void LayerNorm(T* x,
   }
 }
 
+template <typename T>
+void RMSNorm(const T* x,
+             const T* scale,
+             T* y,
+             int height,
+             const float epsilon,
+             int right) {
+  // y = x / sqrt(mean(x^2) + epsilon) * scale
+  for (int i = 0; i < height; ++i) {
+    const T* x_row = x + i * right;
+    T* y_row = y + i * right;
+    T sum = 0;
+    for (int j = 0; j < right; ++j) {
+      sum += x_row[j] * x_row[j];
+    }
+    T inv_rms =
+        static_cast<T>(1) / std::sqrt(sum / right + static_cast<T>(epsilon));
+    for (int j = 0; j < right; ++j) {
+      y_row[j] = x_row[j] * inv_rms * scale[j];
+    }
+  }
+}
+
+// softmax of each row, y = e^(x - max) / sum(e^(x - max))
+template <typename T>
+void Softmax(const T* x, T* y, int n, int height) {
+  for (int i = 0; i < height; ++i, x += n, y += n) {
+    T max = std::numeric_limits<T>::lowest();
+    for (int j = 0; j < n; ++j) {
+      max = x[j] > max ? x[j] : max;
+    }
+    T sum = 0;
+    for (int j = 0; j < n; ++j) {
+      y[j] = std::exp(x[j] - max);
+      sum += y[j];
+    }
+    T scale = static_cast<T>(1) / sum;
+    for (int j = 0; j < n; ++j) {
+      y[j] *= scale;
+    }
+  }
+}
+
+// log softmax of each row, y = x - max - log(sum(e^(x - max)))
+template <typename T>
+void LogSoftmax(const T* x, T* y, int n, int height) {
+  for (int i = 0; i < height; ++i, x += n, y += n) {
+    T max = std::numeric_limits<T>::lowest();
+    for (int j = 0; j < n; ++j) {
+      max = x[j] > max ? x[j] : max;
+    }
+    T sum = 0;
+    for (int j = 0; j < n; ++j) {
+      sum += std::exp(x[j] - max);
+    }
+    T shift = max + std::log(sum);
+    for (int j = 0; j < n; ++j) {
+      y[j] = x[j] - shift;
+    }
+  }
+}
+
 template <typename T>
 void SeqPool(const T* x, T* y, const seq_pool_attr_t* attr) {
   for (int w = 0; w < attr->w; ++w) {
@@ -574,6 +673,7 @@ DECLARE_REFER_KERNEL(VMul);
 DECLARE_REFER_KERNEL(VAdd);
 DECLARE_REFER_KERNEL(VAddRelu);
 DECLARE_REFER_KERNEL(VSub);
+DECLARE_REFER_KERNEL(VSwiglu);
 
 // const T* a, const T* x, T* y, int n
 DECLARE_REFER_KERNEL(VScal);
@@ -587,6 +687,13 @@ DECLARE_REFER_KERNEL(VSigmoid);
 DECLARE_REFER_KERNEL(VTanh);
 DECLARE_REFER_KERNEL(VSquare);
 DECLARE_REFER_KERNEL(VCopy);
+DECLARE_REFER_KERNEL(VGeluTanh);
+DECLARE_REFER_KERNEL(VGeluErf);
+DECLARE_REFER_KERNEL(VSilu);
+
+// const T* x, T* y, int n, int height
+DECLARE_REFER_KERNEL(Softmax);
+DECLARE_REFER_KERNEL(LogSoftmax);
 
 // lstm_t*, const lstm_attr_t*
 DECLARE_REFER_KERNEL(LSTMCtHt);
@@ -600,6 +707,7 @@ DECLARE_REFER_KERNEL(GRUHtPart2);
 // others
 DECLARE_REFER_KERNEL(CRFDecoding);
 DECLARE_REFER_KERNEL(LayerNorm);
+DECLARE_REFER_KERNEL(RMSNorm);
 DECLARE_REFER_KERNEL(SeqPool);
 DECLARE_REFER_KERNEL(MatMul);
 DECLARE_REFER_KERNEL(EmbSeqPool);
@@ -228,6 +228,53 @@ void TestKernelXYN() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelXYNH() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  for (int height : {1, 3, 17}) {
+    for (int d : TestSizes()) {
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+
+      const int sz = height * d;
+      std::vector<T> x(sz), yref(sz);
+      std::vector<T> xinp(sz);  // inplace test
+      RandomVec<T>(sz, x.data(), static_cast<T>(-10.f), static_cast<T>(10.f));
+      std::copy(x.begin(), x.end(), xinp.begin());
+
+      const T* x_data = x.data();
+      T* yref_data = yref.data();
+      T* xinp_data = xinp.data();
+      // test refer code inplace
+      ref(x_data, yref_data, d, height);
+      ref(xinp_data, xinp_data, d, height);
+      ExpectEQ<T>(xinp_data, yref_data, sz);
+      auto verifier = [](const typename KernelTuple::func_type tgt,
+                         const std::vector<T>& x,
+                         const std::vector<T>& yref,
+                         const int& d,
+                         const int& height) {
+        EXPECT_TRUE(tgt != nullptr);
+        EXPECT_EQ(yref.size(), x.size());
+        EXPECT_EQ(yref.size(), static_cast<size_t>(d * height));
+        const T* x_data = x.data();
+        const T* yref_data = yref.data();
+        std::vector<T> ytgt(yref.size());
+        T* ytgt_data = ytgt.data();
+        // test normal
+        tgt(x_data, ytgt_data, d, height);
+        ExpectEQ<T>(ytgt_data, yref_data, yref.size());
+        // test inplace x
+        std::copy(x.begin(), x.end(), ytgt.begin());
+        tgt(ytgt_data, ytgt_data, d, height);
+        ExpectEQ<T>(ytgt_data, yref_data, yref.size());
+      };
+      TestAllImpls<KernelTuple, PlaceType>(d, verifier, x, yref, d, height);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelLSTM() {
   using T = typename KernelTuple::data_type;
@@ -487,6 +534,47 @@ void TestKernelLayerNorm() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelRMSNorm() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  const float epsilon = 1e-6;
+  for (int left : {1, 9, 17, 50}) {
+    for (int right : TestSizes()) {
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+      int sz = left * right;
+      std::vector<T> x(sz), scale(right), outref(sz);
+      RandomVec<T>(sz, x.data());
+      RandomVec<T>(right, scale.data());
+
+      ref(x.data(), scale.data(), outref.data(), left, epsilon, right);
+
+      auto verifier = [](const typename KernelTuple::func_type tgt,
+                         const std::vector<T>& x,
+                         const std::vector<T>& scale,
+                         const std::vector<T>& outref,
+                         const int& left,
+                         const float& epsilon,
+                         const typename KernelTuple::attr_type& right) {
+        EXPECT_TRUE(tgt != nullptr);
+        EXPECT_EQ(x.size(), static_cast<size_t>(left * right));
+        EXPECT_EQ(scale.size(), static_cast<size_t>(right));
+        std::vector<T> outtgt(outref.size());
+        // test normal
+        tgt(x.data(), scale.data(), outtgt.data(), left, epsilon, right);
+        ExpectEQ<T>(outtgt.data(), outref.data(), outref.size());
+        // test inplace x
+        std::copy(x.begin(), x.end(), outtgt.begin());
+        tgt(outtgt.data(), scale.data(), outtgt.data(), left, epsilon, right);
+        ExpectEQ<T>(outtgt.data(), outref.data(), outref.size());
+      };
+      TestAllImpls<KernelTuple, PlaceType>(
+          right, verifier, x, scale, outref, left, epsilon, right);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelCRFDecoding() {
   using T = typename KernelTuple::data_type;
@@ -1159,6 +1247,28 @@ TEST(JITKernel_helper, KernelFuncs) {
 #endif
 }
 
+// The kernels got with kAnySize run every size with one code.
+TEST(JITKernel_helper, KernelFuncsAnySize) {
+  auto silu = jit::KernelFuncs<jit::VSiluTuple<float>, CPUPlace>::Cache().At(
+      jit::kAnySize);
+  auto silu_ref = jit::GetReferFunc<jit::VSiluTuple<float>>();
+  auto softmax =
+      jit::KernelFuncs<jit::SoftmaxTuple<float>, CPUPlace>::Cache().At(
+          jit::kAnySize);
+  auto softmax_ref = jit::GetReferFunc<jit::SoftmaxTuple<float>>();
+  for (int d : TestSizes()) {
+    const int height = 3;
+    std::vector<float> x(height * d), y(height * d), yref(height * d);
+    RandomVec<float>(height * d, x.data(), -10.f, 10.f);
+    silu(x.data(), y.data(), height * d);
+    silu_ref(x.data(), yref.data(), height * d);
+    ExpectEQ<float>(y.data(), yref.data(), height * d);
+    softmax(x.data(), y.data(), d, height);
+    softmax_ref(x.data(), yref.data(), d, height);
+    ExpectEQ<float>(y.data(), yref.data(), height * d);
+  }
+}
+
 TEST(JITKernel_helper, GetAllCandidateFuncs) {
   auto funcs = jit::GetAllCandidateFuncs<jit::VExpTuple<float>, CPUPlace>(10);
   auto kers = jit::GetAllCandidateKernels<jit::VExpTuple<float>, CPUPlace>(10);
@@ -1414,6 +1524,7 @@ TEST(JITKernel_key, sgd) {
 #define TestKernelVAdd TestKernelXYZN
 #define TestKernelVAddRelu TestKernelXYZN
 #define TestKernelVSub TestKernelXYZN
+#define TestKernelVSwiglu TestKernelXYZN
 
 #define TestKernelVScal TestKernelAXYN
 #define TestKernelVAddBias TestKernelAXYN
@@ -1425,6 +1536,12 @@ TEST(JITKernel_key, sgd) {
 #define TestKernelVSigmoid TestKernelXYN
 #define TestKernelVTanh TestKernelXYN
 #define TestKernelVCopy TestKernelXYN
+#define TestKernelVGeluTanh TestKernelXYN
+#define TestKernelVGeluErf TestKernelXYN
+#define TestKernelVSilu TestKernelXYN
+
+#define TestKernelSoftmax TestKernelXYNH
+#define TestKernelLogSoftmax TestKernelXYNH
 
 #define TestKernelLSTMCtHt TestKernelLSTM
 #define TestKernelLSTMC1H1 TestKernelLSTM
@@ -1443,6 +1560,7 @@ TEST_CPU_KERNEL(VMul);
 TEST_CPU_KERNEL(VAdd);
 TEST_CPU_KERNEL(VAddRelu);
 TEST_CPU_KERNEL(VSub);
+TEST_CPU_KERNEL(VSwiglu);
 
 TEST_CPU_KERNEL(VScal);
 TEST_CPU_KERNEL(VAddBias);
@@ -1454,6 +1572,12 @@ TEST_CPU_KERNEL(VExp);
 TEST_CPU_KERNEL(VSigmoid);
 TEST_CPU_KERNEL(VTanh);
 TEST_CPU_KERNEL(VCopy);
+TEST_CPU_KERNEL(VGeluTanh);
+TEST_CPU_KERNEL(VGeluErf);
+TEST_CPU_KERNEL(VSilu);
+
+TEST_CPU_KERNEL(Softmax);
+TEST_CPU_KERNEL(LogSoftmax);
 
 TEST_CPU_KERNEL(LSTMCtHt);
 TEST_CPU_KERNEL(LSTMC1H1);
@@ -1463,6 +1587,7 @@ TEST_CPU_KERNEL(GRUHtPart1);
 TEST_CPU_KERNEL(GRUHtPart2);
 
 TEST_CPU_KERNEL(LayerNorm);
+TEST_CPU_KERNEL(RMSNorm);
 TEST_CPU_KERNEL(CRFDecoding);
 
 TEST_CPU_KERNEL(SeqPool);
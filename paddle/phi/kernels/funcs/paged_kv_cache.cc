@@ -0,0 +1,182 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/paged_kv_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "paddle/phi/core/enforce.h"
+
+namespace phi {
+namespace funcs {
+
+PagedKVCache::PagedKVCache(int64_t num_blocks, int64_t block_size)
+    : block_size_(block_size), ref_counts_(num_blocks, 0) {
+  PADDLE_ENFORCE_GT(
+      block_size,
+      0,
+      phi::errors::InvalidArgument(
+          "The block_size of PagedKVCache should be positive, but got %d.",
+          block_size));
+  // the lowest blocks are taken first
+  free_blocks_.reserve(num_blocks);
+  for (int64_t i = num_blocks - 1; i >= 0; --i) {
+    free_blocks_.push_back(static_cast<int32_t>(i));
+  }
+}
+
+bool PagedKVCache::HasSequence(int64_t seq_id) const {
+  return sequences_.count(seq_id) > 0;
+}
+
+const PagedKVCache::Sequence& PagedKVCache::GetSequence(
+    int64_t seq_id) const {
+  auto it = sequences_.find(seq_id);
+  PADDLE_ENFORCE_EQ(
+      it != sequences_.end(),
+      true,
+      phi::errors::NotFound("The sequence %d is not in PagedKVCache.", seq_id));
+  return it->second;
+}
+
+int64_t PagedKVCache::SequenceLength(int64_t seq_id) const {
+  return GetSequence(seq_id).length;
+}
+
+const std::vector<int32_t>& PagedKVCache::BlockTable(int64_t seq_id) const {
+  return GetSequence(seq_id).blocks;
+}
+
+void PagedKVCache::AddSequence(int64_t seq_id) {
+  PADDLE_ENFORCE_EQ(HasSequence(seq_id),
+                    false,
+                    phi::errors::AlreadyExists(
+                        "The sequence %d is already in PagedKVCache.", seq_id));
+  sequences_[seq_id] = Sequence();
+}
+
+void PagedKVCache::ForkSequence(int64_t parent_id, int64_t child_id) {
+  PADDLE_ENFORCE_EQ(
+      HasSequence(child_id),
+      false,
+      phi::errors::AlreadyExists("The sequence %d is already in PagedKVCache.",
+                                 child_id));
+  Sequence child = GetSequence(parent_id);
+  for (int32_t block : child.blocks) {
+    ++ref_counts_[block];
+  }
+  sequences_[child_id] = std::move(child);
+}
+
+void PagedKVCache::FreeSequence(int64_t seq_id) {
+  const Sequence& seq = GetSequence(seq_id);
+  for (int32_t block : seq.blocks) {
+    ReleaseBlock(block);
+  }
+  sequences_.erase(seq_id);
+}
+
+int64_t PagedKVCache::BlocksToAppend(int64_t seq_id,
+                                     int64_t num_tokens) const {
+  const Sequence& seq = GetSequence(seq_id);
+  int64_t needed = (seq.length + num_tokens + block_size_ - 1) / block_size_ -
+                   static_cast<int64_t>(seq.blocks.size());
+  // a shared block with free slots is written, so it is copied
+  if (num_tokens > 0 && seq.length % block_size_ != 0 &&
+      ref_counts_[seq.blocks.back()] > 1) {
+    ++needed;
+  }
+  return needed;
+}
+
+void PagedKVCache::Append(int64_t seq_id,
+                          int64_t num_tokens,
+                          std::vector<KVCacheBlockCopy>* copies) {
+  int64_t needed = BlocksToAppend(seq_id, num_tokens);
+  PADDLE_ENFORCE_LE(
+      needed,
+      NumFreeBlocks(),
+      phi::errors::ResourceExhausted(
+          "PagedKVCache needs %d free blocks to append %d tokens to the "
+          "sequence %d, but only %d are left.",
+          needed,
+          num_tokens,
+          seq_id,
+          NumFreeBlocks()));
+  Sequence& seq = sequences_[seq_id];
+  if (num_tokens > 0 && seq.length % block_size_ != 0 &&
+      ref_counts_[seq.blocks.back()] > 1) {
+    int32_t src = seq.blocks.back();
+    int32_t dst = AllocateBlock();
+    ReleaseBlock(src);
+    seq.blocks.back() = dst;
+    copies->push_back({src, dst});
+  }
+  seq.length += num_tokens;
+  while (static_cast<int64_t>(seq.blocks.size()) * block_size_ < seq.length) {
+    seq.blocks.push_back(AllocateBlock());
+  }
+}
+
+void PagedKVCache::FillBlockTables(const std::vector<int64_t>& seq_ids,
+                                   int64_t max_blocks_per_seq,
+                                   int32_t* block_tables) const {
+  for (size_t i = 0; i < seq_ids.size(); ++i) {
+    const std::vector<int32_t>& blocks = BlockTable(seq_ids[i]);
+    int64_t num_blocks = static_cast<int64_t>(blocks.size());
+    PADDLE_ENFORCE_LE(
+        num_blocks,
+        max_blocks_per_seq,
+        phi::errors::OutOfRange(
+            "The sequence %d takes %d blocks, more than the %d blocks of a "
+            "row of block_tables.",
+            seq_ids[i],
+            num_blocks,
+            max_blocks_per_seq));
+    int32_t* row = block_tables + i * max_blocks_per_seq;
+    std::copy(blocks.begin(), blocks.end(), row);
+    std::fill(row + num_blocks, row + max_blocks_per_seq, -1);
+  }
+}
+
+int32_t PagedKVCache::AllocateBlock() {
+  int32_t block = free_blocks_.back();
+  free_blocks_.pop_back();
+  ref_counts_[block] = 1;
+  return block;
+}
+
+void PagedKVCache::ReleaseBlock(int32_t block) {
+  if (--ref_counts_[block] == 0) {
+    free_blocks_.push_back(block);
+  }
+}
+
+void CopyKVCacheBlocks(const std::vector<KVCacheBlockCopy>& copies,
+                       int64_t block_bytes,
+                       void* key_cache,
+                       void* value_cache) {
+  for (void* cache : {key_cache, value_cache}) {
+    char* data = static_cast<char*>(cache);
+    for (const KVCacheBlockCopy& copy : copies) {
+      std::memcpy(data + copy.dst * block_bytes,
+                  data + copy.src * block_bytes,
+                  block_bytes);
+    }
+  }
+}
+
+}  // namespace funcs
+}  // namespace phi
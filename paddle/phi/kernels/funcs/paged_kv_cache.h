@@ -0,0 +1,124 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+namespace funcs {
+
+// A copy of a cache block before it is written, see PagedKVCache::Append.
+struct KVCacheBlockCopy {
+  int32_t src;
+  int32_t dst;
+};
+
+// The block manager of a paged kv cache, i.e. the key_cache and value_cache
+// [num_blocks, num_heads_k, block_size, head_dim] of block_multihead_attention
+// shared by many sequences of different lengths.
+//
+// Token t of a sequence lives in the slot t % block_size of the block
+// BlockTable(seq_id)[t / block_size], so a sequence grows by a block at a
+// time instead of reallocating its cache. Blocks are reference counted:
+// ForkSequence shares all the blocks of a sequence (a common prompt, the
+// beams of a beam search), and a shared block is copied before it is
+// written (copy on write), so only the partially filled last block is ever
+// copied.
+//
+// A decoding step of the sequences seq_ids looks like
+//
+//   std::vector<KVCacheBlockCopy> copies;
+//   for (auto id : seq_ids) {
+//     seq_lens_decoder.push_back(cache.SequenceLength(id));
+//     cache.Append(id, num_new_tokens, &copies);
+//   }
+//   CopyKVCacheBlocks(copies, block_bytes, key_cache, value_cache);
+//   cache.FillBlockTables(seq_ids, max_blocks_per_seq, block_tables);
+//   // run block_multihead_attention
+//
+// It is not thread safe, the scheduler of the sequences owns it.
+class TEST_API PagedKVCache {
+ public:
+  PagedKVCache(int64_t num_blocks, int64_t block_size);
+
+  int64_t block_size() const { return block_size_; }
+  int64_t NumBlocks() const {
+    return static_cast<int64_t>(ref_counts_.size());
+  }
+  int64_t NumFreeBlocks() const {
+    return static_cast<int64_t>(free_blocks_.size());
+  }
+
+  bool HasSequence(int64_t seq_id) const;
+  int64_t SequenceLength(int64_t seq_id) const;
+  const std::vector<int32_t>& BlockTable(int64_t seq_id) const;
+  // The number of sequences using the block.
+  int32_t RefCount(int32_t block) const { return ref_counts_[block]; }
+
+  // Starts an empty sequence.
+  void AddSequence(int64_t seq_id);
+  // Starts child_id with the tokens of parent_id, sharing its blocks.
+  void ForkSequence(int64_t parent_id, int64_t child_id);
+  // Releases the blocks of seq_id, a block is free when no sequence uses it.
+  void FreeSequence(int64_t seq_id);
+
+  // The free blocks Append(seq_id, num_tokens) takes.
+  int64_t BlocksToAppend(int64_t seq_id, int64_t num_tokens) const;
+  // Makes room for the kv of the tokens [SequenceLength(seq_id),
+  // SequenceLength(seq_id) + num_tokens) of seq_id, which the next step
+  // writes. If the last block is shared it is replaced by a private copy,
+  // and the copy is appended to copies to be run on the caches before the
+  // step. Throws ResourceExhausted without changing anything if there are
+  // not enough free blocks.
+  void Append(int64_t seq_id,
+              int64_t num_tokens,
+              std::vector<KVCacheBlockCopy>* copies);
+
+  // Writes the block tables of seq_ids into the rows of block_tables
+  // [seq_ids.size(), max_blocks_per_seq], padded with -1.
+  void FillBlockTables(const std::vector<int64_t>& seq_ids,
+                       int64_t max_blocks_per_seq,
+                       int32_t* block_tables) const;
+
+ private:
+  struct Sequence {
+    int64_t length = 0;
+    std::vector<int32_t> blocks;
+  };
+
+  const Sequence& GetSequence(int64_t seq_id) const;
+  int32_t AllocateBlock();
+  void ReleaseBlock(int32_t block);
+
+  int64_t block_size_;
+  std::vector<int32_t> ref_counts_;
+  std::vector<int32_t> free_blocks_;
+  std::unordered_map<int64_t, Sequence> sequences_;
+};
+
+// Runs the block copies of PagedKVCache::Append on the caches, where a
+// block takes block_bytes, i.e. num_heads_k * block_size * head_dim
+// elements.
+TEST_API void CopyKVCacheBlocks(const std::vector<KVCacheBlockCopy>& copies,
+                                int64_t block_bytes,
+                                void* key_cache,
+                                void* value_cache);
+
+}  // namespace funcs
+}  // namespace phi
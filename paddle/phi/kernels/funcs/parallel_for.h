@@ -0,0 +1,120 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/backends/cpu/intra_op_thread_pool.h"
+
+namespace phi {
+namespace funcs {
+
+// The number of chunks [begin, end) is split into: one per thread of the
+// pool of dev_ctx, limited by the budget of the calling thread
+// (SetIntraOpNumThreads), with at least grain_size iterations in each.
+inline int64_t ParallelNumChunks(const CPUContext& dev_ctx,
+                                 int64_t begin,
+                                 int64_t end,
+                                 int64_t grain_size) {
+  int64_t n = end - begin;
+  if (n <= 0) {
+    return 0;
+  }
+  if (IntraOpThreadPool::InParallelRegion()) {
+    return 1;
+  }
+  int64_t num_threads = dev_ctx.GetIntraOpThreadPool()->NumThreads();
+  int budget = GetIntraOpNumThreads();
+  if (budget > 0) {
+    num_threads = std::min<int64_t>(num_threads, budget);
+  }
+  grain_size = std::max<int64_t>(grain_size, 1);
+  return std::max<int64_t>(
+      std::min(num_threads, (n + grain_size - 1) / grain_size), 1);
+}
+
+// Calls f(chunk_begin, chunk_end) over the contiguous chunks of [begin, end)
+// in parallel on the intra-op thread pool of dev_ctx, e.g.
+//
+//   funcs::ParallelFor(dev_ctx, 0, rows, 16, [&](int64_t b, int64_t e) {
+//     for (int64_t i = b; i < e; ++i) { ... }
+//   });
+//
+// A grain_size of about 10k~100k simple element operations is enough for
+// the work of a chunk to outweigh waking a thread up.
+template <typename Function>
+void ParallelFor(const CPUContext& dev_ctx,
+                 int64_t begin,
+                 int64_t end,
+                 int64_t grain_size,
+                 const Function& f) {
+  int64_t num_chunks = ParallelNumChunks(dev_ctx, begin, end, grain_size);
+  if (num_chunks <= 1) {
+    if (begin < end) {
+      f(begin, end);
+    }
+    return;
+  }
+  int64_t chunk_size = (end - begin + num_chunks - 1) / num_chunks;
+  dev_ctx.GetIntraOpThreadPool()->Run(num_chunks, [&](int64_t idx) {
+    int64_t chunk_begin = begin + idx * chunk_size;
+    int64_t chunk_end = std::min(chunk_begin + chunk_size, end);
+    if (chunk_begin < chunk_end) {
+      f(chunk_begin, chunk_end);
+    }
+  });
+}
+
+// Reduces [begin, end): f(chunk_begin, chunk_end, identity) returns the
+// partial result of a chunk, and the partial results are combined in the
+// order of the chunks with reduce(a, b). The result only depends on the
+// number of chunks, i.e. it is deterministic for a given thread budget.
+template <typename T, typename Function, typename Reduce>
+T ParallelReduce(const CPUContext& dev_ctx,
+                 int64_t begin,
+                 int64_t end,
+                 int64_t grain_size,
+                 const T& identity,
+                 const Function& f,
+                 const Reduce& reduce) {
+  int64_t num_chunks = ParallelNumChunks(dev_ctx, begin, end, grain_size);
+  if (num_chunks == 0) {
+    return identity;
+  }
+  if (num_chunks == 1) {
+    return f(begin, end, identity);
+  }
+  int64_t chunk_size = (end - begin + num_chunks - 1) / num_chunks;
+  std::vector<T> partials(num_chunks, identity);
+  dev_ctx.GetIntraOpThreadPool()->Run(num_chunks, [&](int64_t idx) {
+    int64_t chunk_begin = begin + idx * chunk_size;
+    int64_t chunk_end = std::min(chunk_begin + chunk_size, end);
+    if (chunk_begin < chunk_end) {
+      partials[idx] = f(chunk_begin, chunk_end, identity);
+    }
+  });
+  T result = identity;
+  for (const T& partial : partials) {
+    result = reduce(result, partial);
+  }
+  return result;
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -14,11 +14,34 @@ limitations under the License. */
 
 #include "paddle/phi/kernels/funcs/softmax.h"
 
+#include <algorithm>
+
 #include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
 #include "paddle/phi/kernels/funcs/softmax_impl.h"
 
 namespace phi::funcs {
 
+void SoftmaxRowsCPU(const CPUContext& context,
+                    const float* x,
+                    float* y,
+                    int n,
+                    int height,
+                    bool log) {
+  // the cache of the jit kernels is thread local, get it before ParallelFor
+  auto softmax =
+      log ? jit::KernelFuncs<jit::LogSoftmaxTuple<float>, CPUPlace>::Cache()
+                .At(jit::kAnySize)
+          : jit::KernelFuncs<jit::SoftmaxTuple<float>, CPUPlace>::Cache().At(
+                jit::kAnySize);
+  // the rows a chunk of ParallelFor takes, 16k elements
+  const int64_t grain = std::max<int64_t>(1, (16 << 10) / std::max(n, 1));
+  ParallelFor(context, 0, height, grain, [&](int64_t begin, int64_t end) {
+    softmax(x + begin * n, y + begin * n, n, static_cast<int>(end - begin));
+  });
+}
+
 template class SoftmaxFunctor<phi::CPUContext, float>;
 template class SoftmaxFunctor<phi::CPUContext, double>;
 template class SoftmaxGradFunctor<phi::CPUContext, float>;
@@ -16,6 +16,8 @@ limitations under the License. */
 #include "paddle/phi/core/dense_tensor.h"
 
 namespace phi {
+class CPUContext;
+
 namespace funcs {
 
 template <typename DeviceContext, typename T, typename Enable = void>
@@ -37,6 +39,16 @@ class SoftmaxGradFunctor {
                   phi::DenseTensor* x_grad);
 };
 
+// The softmax, or the log softmax if log, of each of the height rows of n
+// floats on CPU by the jit kernel, with the rows split over the intra-op
+// threads of context. x and y can be the same.
+void SoftmaxRowsCPU(const CPUContext& context,
+                    const float* x,
+                    float* y,
+                    int n,
+                    int height,
+                    bool log = false);
+
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 template <typename T, typename DeviceContext>
 class SoftmaxCUDNNFunctor {
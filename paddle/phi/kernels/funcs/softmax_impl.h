@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #pragma once
+#include <type_traits>
 #include <vector>
 
 #include "paddle/phi/backends/cpu/cpu_context.h"
@@ -23,6 +24,7 @@ limitations under the License. */
 #include "paddle/phi/core/dense_tensor.h"
 #include "paddle/phi/kernels/funcs/cpu_vec.h"
 #include "paddle/phi/kernels/funcs/eigen/common.h"
+#include "paddle/phi/kernels/funcs/softmax.h"
 
 namespace phi {
 namespace funcs {
@@ -245,6 +247,15 @@ class SoftmaxFunctor<DeviceContext, T, enable_if_CPU<DeviceContext>> {
     const int batch_size = in_dims[kBatchDim];
     const int num_remain = num_classes / axis_dim;
 
+#ifdef PADDLE_WITH_XBYAK
+    if constexpr (std::is_same<T, float>::value) {
+      if (num_remain == 1) {
+        SoftmaxRowsCPU(
+            context, X->data<T>(), Y->data<T>(), num_classes, batch_size);
+        return;
+      }
+    }
+#endif
     if (num_remain == 1 &&
         phi::backends::cpu::MayIUse(phi::backends::cpu::avx)) {
       const T* in_data = X->data<T>();
@@ -0,0 +1,413 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/top_p_sampling_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/cpu_vec.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace funcs {
+
+namespace {
+
+// The candidates selected first when there is no top_k.
+constexpr int64_t kMinCandidates = 256;
+// A float weight is bucketed by its bits >> kBucketShift, the sign bit of
+// the non-negative weights is 0.
+constexpr int kBucketShift = 20;
+constexpr int kNumBuckets = 1 << (31 - kBucketShift);
+
+struct Candidate {
+  float weight;
+  int64_t id;
+};
+
+// The heavier first, the smaller id first for equal weights.
+bool Before(const Candidate& a, const Candidate& b) {
+  return a.weight > b.weight || (a.weight == b.weight && a.id < b.id);
+}
+
+// Keeps the k heaviest weights of w[0, n) in *cands, sorted by Before. The
+// buffer holds up to 2k candidates and is cut back to k with nth_element
+// when it is full, so most of the vocabulary is rejected by one comparison
+// with the k-th weight kept so far.
+void SelectTopK(const float* w,
+                int64_t n,
+                int64_t k,
+                std::vector<Candidate>* cands) {
+  cands->clear();
+  k = std::min(k, n);
+  if (k <= 0) {
+    return;
+  }
+  cands->reserve(2 * k);
+  // the weights are not negative; a later id loses a tie, so the weights
+  // equal to the bound are rejected too
+  float bound = -1.f;
+  for (int64_t i = 0; i < n; ++i) {
+    if (w[i] <= bound) {
+      continue;
+    }
+    cands->push_back({w[i], i});
+    if (static_cast<int64_t>(cands->size()) == 2 * k) {
+      std::nth_element(
+          cands->begin(), cands->begin() + (k - 1), cands->end(), Before);
+      cands->resize(k);
+      bound = (*cands)[k - 1].weight;
+    }
+  }
+  if (static_cast<int64_t>(cands->size()) > k) {
+    std::nth_element(
+        cands->begin(), cands->begin() + (k - 1), cands->end(), Before);
+    cands->resize(k);
+  }
+  std::sort(cands->begin(), cands->end(), Before);
+}
+
+// A uniform double in [0, 1) for a row, the splitmix64 hash of the seed and
+// the row, so the draws do not depend on how the rows are split in chunks.
+double UniformOf(uint64_t seed, int64_t row) {
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (static_cast<uint64_t>(row) + 1);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  return static_cast<double>(z >> 11) * 0x1.0p-53;
+}
+
+// The bucket of a weight: the exponent and the 3 leading mantissa bits, which
+// order the positive floats like their values. The others are in bucket 0.
+inline int WeightBucket(float weight) {
+  if (!(weight > 0.f)) {
+    return 0;
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &weight, sizeof(bits));
+  return static_cast<int>(bits >> kBucketShift);
+}
+
+// Draws a token from a nucleus too large to select, without sorting the
+// vocabulary: a histogram of the mass per WeightBucket finds the bucket where
+// the mass reaches top_p of total, only the tokens of that bucket are sorted,
+// and the nucleus is sampled in place. With top_p >= 1 every token is in.
+// The tokens below min_weight are skipped, the heaviest token is drawn when
+// none is left.
+int64_t SampleAboveCutoff(const float* w,
+                          int64_t n,
+                          float top_p,
+                          double total,
+                          double min_weight,
+                          double u,
+                          std::vector<Candidate>* boundary) {
+  boundary->clear();
+  int64_t best = 0;
+  int cutoff = -1;
+  int64_t num_boundary = 0;
+  double mass = 0.0;
+  if (top_p < 1.f) {
+    std::vector<double> hist(kNumBuckets, 0.0);
+    for (int64_t i = 0; i < n; ++i) {
+      hist[WeightBucket(w[i])] += w[i];
+    }
+    const double target = static_cast<double>(top_p) * total;
+    for (cutoff = kNumBuckets - 1; cutoff > 0; --cutoff) {
+      if (mass + hist[cutoff] >= target) {
+        break;
+      }
+      mass += hist[cutoff];
+    }
+    for (int64_t i = 0; i < n; ++i) {
+      if (WeightBucket(w[i]) == cutoff) {
+        boundary->push_back({w[i], i});
+      }
+    }
+    std::sort(boundary->begin(), boundary->end(), Before);
+    // the heaviest tokens of the cutoff bucket complete the nucleus
+    double boundary_mass = mass;
+    while (num_boundary < static_cast<int64_t>(boundary->size()) &&
+           boundary_mass < target) {
+      boundary_mass += (*boundary)[num_boundary++].weight;
+    }
+  }
+
+  mass = 0.0;
+  for (int64_t i = 0; i < n; ++i) {
+    if (WeightBucket(w[i]) > cutoff && w[i] >= min_weight) {
+      mass += w[i];
+    }
+    if (w[i] > w[best]) {
+      best = i;
+    }
+  }
+  for (int64_t j = 0; j < num_boundary; ++j) {
+    if ((*boundary)[j].weight >= min_weight) {
+      mass += (*boundary)[j].weight;
+    }
+  }
+  const double r = u * mass;
+  double cumsum = 0.0;
+  for (int64_t i = 0; i < n; ++i) {
+    if (w[i] > 0.f && w[i] >= min_weight && WeightBucket(w[i]) > cutoff) {
+      cumsum += w[i];
+      if (cumsum > r) {
+        return i;
+      }
+    }
+  }
+  for (int64_t j = 0; j < num_boundary; ++j) {
+    const Candidate& cand = (*boundary)[j];
+    if (cand.weight > 0.f && cand.weight >= min_weight) {
+      cumsum += cand.weight;
+      if (cumsum > r) {
+        return cand.id;
+      }
+    }
+  }
+  return best;
+}
+
+float PenalizedScore(const TopPSamplingCPUParams& params, float logit) {
+  if (params.repetition_penalty != 1.f) {
+    logit = logit > 0.f ? logit / params.repetition_penalty
+                        : logit * params.repetition_penalty;
+  }
+  return (logit - params.presence_penalty) / params.temperature;
+}
+
+template <typename T>
+void SampleRow(const TopPSamplingCPUParams& params,
+               int64_t row,
+               const T* x,
+               float top_p,
+               float threshold,
+               std::vector<float>* weights,
+               std::vector<Candidate>* cands,
+               T* prob,
+               int64_t* id) {
+  const int64_t vocab_size = params.vocab_size;
+  const float inv_temperature = 1.f / params.temperature;
+
+  // the penalized tokens of the row and their scores
+  std::vector<std::pair<int64_t, float>> penalized;
+  if (params.pre_ids) {
+    const int64_t* pre_ids = params.pre_ids + row * params.pre_ids_len;
+    for (int64_t j = 0; j < params.pre_ids_len; ++j) {
+      if (pre_ids[j] >= 0 && pre_ids[j] < vocab_size) {
+        penalized.emplace_back(pre_ids[j], 0.f);
+      }
+    }
+    std::sort(penalized.begin(), penalized.end());
+    penalized.erase(std::unique(penalized.begin(),
+                                penalized.end(),
+                                [](const auto& a, const auto& b) {
+                                  return a.first == b.first;
+                                }),
+                    penalized.end());
+    for (auto& token : penalized) {
+      float v = static_cast<float>(x[token.first]);
+      token.second =
+          PenalizedScore(params, params.is_logits ? v : std::log(v));
+    }
+  }
+
+  // weights[i] = exp(score_i - ref), where ref is the largest score for
+  // logits and 0 for probabilities
+  float* w = weights->data();
+  float ref = 0.f;
+  if (params.is_logits) {
+    float x_max = -std::numeric_limits<float>::infinity();
+    for (int64_t i = 0; i < vocab_size; ++i) {
+      x_max = std::max(x_max, static_cast<float>(x[i]));
+    }
+    ref = x_max * inv_temperature;
+    for (const auto& token : penalized) {
+      ref = std::max(ref, token.second);
+    }
+    if (!std::isfinite(ref)) {
+      ref = 0.f;
+    }
+    for (int64_t i = 0; i < vocab_size; ++i) {
+      w[i] = static_cast<float>(x[i]) * inv_temperature - ref;
+    }
+    vec_exp<float>(static_cast<int>(vocab_size), w, w);
+  } else if (params.temperature == 1.f) {
+    for (int64_t i = 0; i < vocab_size; ++i) {
+      w[i] = static_cast<float>(x[i]);
+    }
+  } else {
+    for (int64_t i = 0; i < vocab_size; ++i) {
+      w[i] = std::pow(static_cast<float>(x[i]), inv_temperature);
+    }
+  }
+  for (const auto& token : penalized) {
+    w[token.first] = std::exp(token.second - ref);
+  }
+  double total = 0.0;
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    total += w[i];
+  }
+  const double min_weight = static_cast<double>(threshold) * total;
+  const double u = UniformOf(params.seed, row);
+
+  int64_t chosen = -1;
+  if (params.top_k > 0 || top_p < 1.f) {
+    // the nucleus: the fewest candidates holding top_p of the mass of the
+    // top_k, or of the whole row without top_k
+    SelectTopK(
+        w, vocab_size, params.top_k > 0 ? params.top_k : kMinCandidates, cands);
+    double mass = total;
+    if (params.top_k > 0) {
+      mass = 0.0;
+      for (const auto& cand : *cands) {
+        mass += cand.weight;
+      }
+    }
+    const double target = static_cast<double>(top_p) * mass;
+    int64_t nucleus = 0;
+    double nucleus_mass = 0.0;
+    while (nucleus < static_cast<int64_t>(cands->size())) {
+      nucleus_mass += (*cands)[nucleus++].weight;
+      if (nucleus_mass >= target) {
+        break;
+      }
+    }
+    if (nucleus_mass >= target || params.top_k > 0 || nucleus == vocab_size) {
+      // the candidates below the threshold are dropped, but the first one
+      while (nucleus > 1 && (*cands)[nucleus - 1].weight < min_weight) {
+        nucleus_mass -= (*cands)[--nucleus].weight;
+      }
+      chosen = (*cands)[0].id;
+      const double r = u * nucleus_mass;
+      double cumsum = 0.0;
+      for (int64_t j = 0; j < nucleus && (*cands)[j].weight > 0.f; ++j) {
+        chosen = (*cands)[j].id;
+        cumsum += (*cands)[j].weight;
+        if (cumsum > r) {
+          break;
+        }
+      }
+    }
+  }
+  if (chosen < 0) {
+    chosen = SampleAboveCutoff(
+        w, vocab_size, top_p, total, min_weight, u, cands);
+  }
+  *id = chosen;
+  *prob = static_cast<T>(total > 0.0 ? w[chosen] / total : 0.0);
+}
+
+template <typename T>
+void TopPSamplingImpl(const CPUContext& dev_ctx,
+                      const TopPSamplingCPUParams& params,
+                      const T* x,
+                      const T* top_ps,
+                      const T* thresholds,
+                      T* probs,
+                      int64_t* ids) {
+  PADDLE_ENFORCE_GT(
+      params.temperature,
+      0.f,
+      phi::errors::InvalidArgument(
+          "The temperature of the sampling should be greater than 0, but "
+          "received %f.",
+          params.temperature));
+  PADDLE_ENFORCE_GT(
+      params.repetition_penalty,
+      0.f,
+      phi::errors::InvalidArgument(
+          "The repetition_penalty of the sampling should be greater than 0, "
+          "but received %f.",
+          params.repetition_penalty));
+  PADDLE_ENFORCE_LE(
+      params.vocab_size,
+      std::numeric_limits<int>::max(),
+      phi::errors::InvalidArgument(
+          "The vocab_size of the sampling should fit in int32, but received "
+          "%d.",
+          params.vocab_size));
+  if (params.batch_size <= 0 || params.vocab_size <= 0) {
+    return;
+  }
+  ParallelFor(
+      dev_ctx, 0, params.batch_size, 1, [&](int64_t begin, int64_t end) {
+        std::vector<float> weights(params.vocab_size);
+        std::vector<Candidate> cands;
+        for (int64_t i = begin; i < end; ++i) {
+          const float threshold =
+              thresholds ? static_cast<float>(thresholds[i]) : 0.f;
+          SampleRow(params,
+                    i,
+                    x + i * params.vocab_size,
+                    static_cast<float>(top_ps[i]),
+                    threshold,
+                    &weights,
+                    &cands,
+                    probs + i,
+                    ids + i);
+        }
+      });
+}
+
+}  // namespace
+
+void TopPSamplingCPU(const CPUContext& dev_ctx,
+                     const TopPSamplingCPUParams& params,
+                     const float* x,
+                     const float* top_ps,
+                     const float* thresholds,
+                     float* probs,
+                     int64_t* ids) {
+  TopPSamplingImpl(dev_ctx, params, x, top_ps, thresholds, probs, ids);
+}
+
+void TopPSamplingCPU(const CPUContext& dev_ctx,
+                     const TopPSamplingCPUParams& params,
+                     const double* x,
+                     const double* top_ps,
+                     const double* thresholds,
+                     double* probs,
+                     int64_t* ids) {
+  TopPSamplingImpl(dev_ctx, params, x, top_ps, thresholds, probs, ids);
+}
+
+void TopPSamplingCPU(const CPUContext& dev_ctx,
+                     const TopPSamplingCPUParams& params,
+                     const phi::dtype::float16* x,
+                     const phi::dtype::float16* top_ps,
+                     const phi::dtype::float16* thresholds,
+                     phi::dtype::float16* probs,
+                     int64_t* ids) {
+  TopPSamplingImpl(dev_ctx, params, x, top_ps, thresholds, probs, ids);
+}
+
+void TopPSamplingCPU(const CPUContext& dev_ctx,
+                     const TopPSamplingCPUParams& params,
+                     const phi::dtype::bfloat16* x,
+                     const phi::dtype::bfloat16* top_ps,
+                     const phi::dtype::bfloat16* thresholds,
+                     phi::dtype::bfloat16* probs,
+                     int64_t* ids) {
+  TopPSamplingImpl(dev_ctx, params, x, top_ps, thresholds, probs, ids);
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,96 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/bfloat16.h"
+#include "paddle/phi/common/float16.h"
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+namespace funcs {
+
+// The sampling of one token from each row of x [batch_size, vocab_size].
+//
+// x holds logits if is_logits, otherwise probabilities, which are read as
+// the logits log(x). The score of a token is its logit, penalized if the
+// token is in the row of pre_ids, divided by temperature:
+// - repetition_penalty divides a positive logit and multiplies a negative
+//   one, like the CTRL paper;
+// - presence_penalty is subtracted from the logit.
+// pre_ids is [batch_size, pre_ids_len], negative ids are padding.
+//
+// The candidates are the top_k tokens by score (all tokens if top_k <= 0),
+// then the fewest of them holding at least top_ps[i] of their probability,
+// then those with a probability of at least thresholds[i] (the first
+// candidate is always kept). One of them is drawn in proportion to its
+// probability. probs[i] is the probability of the drawn token under the
+// softmax of the scores over the whole vocabulary, i.e. x[i, ids[i]] for
+// probabilities without temperature or penalty.
+struct TopPSamplingCPUParams {
+  int64_t batch_size = 0;
+  int64_t vocab_size = 0;
+  bool is_logits = false;
+  int64_t top_k = 0;
+  float temperature = 1.f;
+  float repetition_penalty = 1.f;
+  float presence_penalty = 0.f;
+  const int64_t* pre_ids = nullptr;
+  int64_t pre_ids_len = 0;
+  // row i draws the uniform number hashed from {seed, i}
+  uint64_t seed = 0;
+};
+
+// Every row runs in one task of the intra-op thread pool: the weights of
+// the row are computed in one vectorized pass, and the candidates are found
+// with a partial selection instead of sorting the vocabulary. Without top_k,
+// a few hundred candidates are selected first; when they do not hold top_p
+// of the probability, a histogram of the weights finds the nucleus.
+TEST_API void TopPSamplingCPU(const CPUContext& dev_ctx,
+                              const TopPSamplingCPUParams& params,
+                              const float* x,
+                              const float* top_ps,
+                              const float* thresholds,
+                              float* probs,
+                              int64_t* ids);
+
+TEST_API void TopPSamplingCPU(const CPUContext& dev_ctx,
+                              const TopPSamplingCPUParams& params,
+                              const double* x,
+                              const double* top_ps,
+                              const double* thresholds,
+                              double* probs,
+                              int64_t* ids);
+
+TEST_API void TopPSamplingCPU(const CPUContext& dev_ctx,
+                              const TopPSamplingCPUParams& params,
+                              const phi::dtype::float16* x,
+                              const phi::dtype::float16* top_ps,
+                              const phi::dtype::float16* thresholds,
+                              phi::dtype::float16* probs,
+                              int64_t* ids);
+
+TEST_API void TopPSamplingCPU(const CPUContext& dev_ctx,
+                              const TopPSamplingCPUParams& params,
+                              const phi::dtype::bfloat16* x,
+                              const phi::dtype::bfloat16* top_ps,
+                              const phi::dtype::bfloat16* thresholds,
+                              phi::dtype::bfloat16* probs,
+                              int64_t* ids);
+
+}  // namespace funcs
+}  // namespace phi
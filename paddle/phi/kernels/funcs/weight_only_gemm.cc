@@ -0,0 +1,459 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/weight_only_gemm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/blas/blas.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm_isa.h"
+
+namespace phi {
+namespace funcs {
+
+namespace detail {
+
+namespace {
+
+inline int Int4Low(int8_t v) {
+  return ((static_cast<uint8_t>(v) & 0xf) ^ 8) - 8;
+}
+
+inline int Int4High(int8_t v) {
+  return ((static_cast<uint8_t>(v) >> 4) ^ 8) - 8;
+}
+
+void RefDotS8(const float* x,
+              int64_t ldx,
+              int rows,
+              const int8_t* w,
+              int64_t k,
+              const float* scale,
+              int64_t scale_stride,
+              int64_t group,
+              float* out) {
+  for (int r = 0; r < rows; ++r) {
+    float sum = 0.f;
+    for (int64_t g = 0; g < k; g += group) {
+      float part = 0.f;
+      for (int64_t i = g; i < std::min(g + group, k); ++i) {
+        part += x[r * ldx + i] * static_cast<float>(w[i]);
+      }
+      sum += part * scale[(g / group) * scale_stride];
+    }
+    out[r] = sum;
+  }
+}
+
+void RefDotS4x2(const float* x,
+                int64_t ldx,
+                int rows,
+                const int8_t* w,
+                int64_t k,
+                const float* scale,
+                int64_t scale_stride,
+                int64_t group,
+                float* out) {
+  for (int r = 0; r < rows; ++r) {
+    float sum_lo = 0.f;
+    float sum_hi = 0.f;
+    for (int64_t g = 0; g < k; g += group) {
+      float part_lo = 0.f;
+      float part_hi = 0.f;
+      for (int64_t i = g; i < std::min(g + group, k); ++i) {
+        part_lo += x[r * ldx + i] * static_cast<float>(Int4Low(w[i]));
+        part_hi += x[r * ldx + i] * static_cast<float>(Int4High(w[i]));
+      }
+      const float* s = scale + (g / group) * scale_stride;
+      sum_lo += part_lo * s[0];
+      sum_hi += part_hi * s[1];
+    }
+    out[2 * r] = sum_lo;
+    out[2 * r + 1] = sum_hi;
+  }
+}
+
+void RefDotS8S8(const int8_t* a,
+                int64_t lda,
+                int rows,
+                const int8_t* w,
+                int64_t k,
+                int32_t* out) {
+  for (int r = 0; r < rows; ++r) {
+    int32_t sum = 0;
+    for (int64_t i = 0; i < k; ++i) {
+      sum += static_cast<int32_t>(a[r * lda + i]) * w[i];
+    }
+    out[r] = sum;
+  }
+}
+
+}  // namespace
+
+const WeightOnlyMicroKernels* GetWeightOnlyRefMicroKernels() {
+  static const WeightOnlyMicroKernels kernels = {
+      "ref", RefDotS8, RefDotS4x2, RefDotS8S8};
+  return &kernels;
+}
+
+}  // namespace detail
+
+namespace {
+
+using detail::kWeightOnlyMaxRows;
+using detail::WeightOnlyMicroKernels;
+
+// The number of weight elements a thread works on at least.
+constexpr int64_t kParallelGrain = 1 << 16;
+// The float weight tile the GEMM path dequantizes at once, in elements.
+constexpr int64_t kDequantTileSize = 1 << 18;
+
+const WeightOnlyMicroKernels* GetMicroKernels() {
+  static const WeightOnlyMicroKernels* kernels = [] {
+    namespace cpu = phi::backends::cpu;
+    const WeightOnlyMicroKernels* selected = nullptr;
+    if (cpu::MayIUse(cpu::avx512_core)) {
+      selected = detail::GetWeightOnlyAVX512MicroKernels(
+          cpu::MayIUse(cpu::avx512_core_vnni));
+    }
+    if (selected == nullptr && cpu::MayIUse(cpu::avx2)) {
+      selected = detail::GetWeightOnlyAVX2MicroKernels();
+    }
+    if (selected == nullptr) {
+      selected = detail::GetWeightOnlyRefMicroKernels();
+    }
+    VLOG(3) << "The weight only gemm uses the " << selected->name
+            << " micro kernels";
+    return selected;
+  }();
+  return kernels;
+}
+
+void CheckWeightOnlyArgs(int64_t n, int bits, int group_size) {
+  PADDLE_ENFORCE_EQ(
+      bits == 8 || bits == 4,
+      true,
+      phi::errors::InvalidArgument(
+          "The weight of weight only gemm must be int8 or int4, but got %d "
+          "bits.",
+          bits));
+  PADDLE_ENFORCE_EQ(
+      bits == 8 || n % 2 == 0,
+      true,
+      phi::errors::InvalidArgument(
+          "The int4 weight must have an even number of channels, but got %d.",
+          n));
+  PADDLE_ENFORCE_EQ(group_size == -1 || group_size > 0,
+                    true,
+                    phi::errors::InvalidArgument(
+                        "The group_size must be -1 or positive, but got %d.",
+                        group_size));
+}
+
+void FillBias(const float* bias, float* y, int64_t m, int64_t n) {
+  for (int64_t r = 0; r < m; ++r) {
+    for (int64_t c = 0; c < n; ++c) {
+      y[r * n + c] = bias ? bias[c] : 0.f;
+    }
+  }
+}
+
+// out[c - c_begin][i] = dequant(weight)[c][i] for c in [c_begin, c_end).
+void DequantizeChannels(const int8_t* weight,
+                        const float* scale,
+                        int64_t c_begin,
+                        int64_t c_end,
+                        int64_t n,
+                        int64_t k,
+                        int bits,
+                        int group_size,
+                        float* out) {
+  int64_t group = group_size > 0 ? group_size : k;
+  for (int64_t c = c_begin; c < c_end; ++c) {
+    float* dst = out + (c - c_begin) * k;
+    for (int64_t g = 0; g < k; g += group) {
+      int64_t len = std::min(group, k - g);
+      float s = group_size > 0 ? scale[(g / group) * n + c] : scale[c];
+      if (bits == 8) {
+        const int8_t* src = weight + c * k + g;
+        for (int64_t i = 0; i < len; ++i) {
+          dst[g + i] = static_cast<float>(src[i]) * s;
+        }
+      } else {
+        const int8_t* src = weight + (c / 2) * k + g;
+        if (c % 2 == 0) {
+          for (int64_t i = 0; i < len; ++i) {
+            dst[g + i] = static_cast<float>(detail::Int4Low(src[i])) * s;
+          }
+        } else {
+          for (int64_t i = 0; i < len; ++i) {
+            dst[g + i] = static_cast<float>(detail::Int4High(src[i])) * s;
+          }
+        }
+      }
+    }
+  }
+}
+
+// The decoding path: every weight is decoded once in the micro kernels for
+// all the m <= kWeightOnlyMaxRows rows of x, and the group scales are applied
+// to the partial dot products.
+void WeightOnlyGemv(const CPUContext& dev_ctx,
+                    const float* x,
+                    const int8_t* weight,
+                    const float* scale,
+                    const float* bias,
+                    float* y,
+                    int rows,
+                    int64_t n,
+                    int64_t k,
+                    int bits,
+                    int group_size) {
+  const WeightOnlyMicroKernels* kernels = GetMicroKernels();
+  int64_t group = group_size > 0 ? group_size : k;
+  // an int4 "channel" below is the pair of channels sharing a byte
+  int64_t channels = bits == 8 ? n : n / 2;
+  int width = bits == 8 ? 1 : 2;
+  int64_t grain = std::max<int64_t>(1, kParallelGrain / k);
+  ParallelFor(dev_ctx, 0, channels, grain, [&](int64_t begin, int64_t end) {
+    float acc[2 * kWeightOnlyMaxRows];
+    for (int64_t p = begin; p < end; ++p) {
+      const int8_t* w = weight + p * k;
+      if (bits == 8) {
+        kernels->dot_s8(x, k, rows, w, k, scale + p, n, group, acc);
+      } else {
+        kernels->dot_s4x2(x, k, rows, w, k, scale + 2 * p, n, group, acc);
+      }
+      for (int r = 0; r < rows; ++r) {
+        for (int h = 0; h < width; ++h) {
+          int64_t c = p * width + h;
+          y[r * n + c] = acc[r * width + h] + (bias ? bias[c] : 0.f);
+        }
+      }
+    }
+  });
+}
+
+}  // namespace
+
+void WeightOnlyGemm(const CPUContext& dev_ctx,
+                    const float* x,
+                    const int8_t* weight,
+                    const float* scale,
+                    const float* bias,
+                    float* y,
+                    int64_t m,
+                    int64_t n,
+                    int64_t k,
+                    int bits,
+                    int group_size) {
+  CheckWeightOnlyArgs(n, bits, group_size);
+  if (m == 0 || n == 0) {
+    return;
+  }
+  if (k == 0) {
+    FillBias(bias, y, m, n);
+    return;
+  }
+  if (m <= kWeightOnlyMaxRows) {
+    WeightOnlyGemv(dev_ctx,
+                   x,
+                   weight,
+                   scale,
+                   bias,
+                   y,
+                   static_cast<int>(m),
+                   n,
+                   k,
+                   bits,
+                   group_size);
+    return;
+  }
+
+  // The prefill path: the weight is dequantized by tiles of channels small
+  // enough to stay in the cache, and multiplied by a GEMM.
+  int64_t tile = std::max<int64_t>(kDequantTileSize / k, 16) / 16 * 16;
+  tile = std::min(tile, n);
+  std::vector<float> buffer(tile * k);
+  auto blas = GetBlas<CPUContext, float>(dev_ctx);
+  int64_t grain = std::max<int64_t>(1, kParallelGrain / k);
+  for (int64_t c0 = 0; c0 < n; c0 += tile) {
+    int64_t cn = std::min(tile, n - c0);
+    ParallelFor(dev_ctx, 0, cn, grain, [&](int64_t begin, int64_t end) {
+      DequantizeChannels(weight,
+                         scale,
+                         c0 + begin,
+                         c0 + end,
+                         n,
+                         k,
+                         bits,
+                         group_size,
+                         buffer.data() + begin * k);
+    });
+    blas.GEMM(false,
+              true,
+              static_cast<int>(m),
+              static_cast<int>(cn),
+              static_cast<int>(k),
+              1.f,
+              x,
+              static_cast<int>(k),
+              buffer.data(),
+              static_cast<int>(k),
+              0.f,
+              y + c0,
+              static_cast<int>(n));
+  }
+  if (bias) {
+    ParallelFor(
+        dev_ctx, 0, m, kParallelGrain / n + 1, [&](int64_t begin, int64_t end) {
+          for (int64_t r = begin; r < end; ++r) {
+            for (int64_t c = 0; c < n; ++c) {
+              y[r * n + c] += bias[c];
+            }
+          }
+        });
+  }
+}
+
+void WeightOnlyDequantize(const CPUContext& dev_ctx,
+                          const int8_t* weight,
+                          const float* scale,
+                          float* out,
+                          int64_t n,
+                          int64_t k,
+                          int bits,
+                          int group_size) {
+  CheckWeightOnlyArgs(n, bits, group_size);
+  constexpr int64_t kTile = 16;
+  int64_t tiles = (n + kTile - 1) / kTile;
+  int64_t grain =
+      std::max<int64_t>(1, kParallelGrain / (kTile * std::max<int64_t>(k, 1)));
+  ParallelFor(dev_ctx, 0, tiles, grain, [&](int64_t begin, int64_t end) {
+    std::vector<float> buffer(kTile * k);
+    for (int64_t t = begin; t < end; ++t) {
+      int64_t c0 = t * kTile;
+      int64_t cn = std::min(kTile, n - c0);
+      DequantizeChannels(
+          weight, scale, c0, c0 + cn, n, k, bits, group_size, buffer.data());
+      for (int64_t i = 0; i < k; ++i) {
+        for (int64_t c = 0; c < cn; ++c) {
+          out[i * n + c0 + c] = buffer[c * k + i];
+        }
+      }
+    }
+  });
+}
+
+void LLMInt8Gemm(const CPUContext& dev_ctx,
+                 const float* x,
+                 const int8_t* weight,
+                 const float* scale,
+                 const float* bias,
+                 float* y,
+                 int64_t m,
+                 int64_t n,
+                 int64_t k,
+                 float threshold) {
+  if (m == 0 || n == 0) {
+    return;
+  }
+  if (k == 0) {
+    FillBias(bias, y, m, n);
+    return;
+  }
+  // the outlier columns of x
+  std::vector<char> is_outlier(k, 0);
+  for (int64_t r = 0; r < m; ++r) {
+    for (int64_t i = 0; i < k; ++i) {
+      if (std::fabs(x[r * k + i]) > threshold) {
+        is_outlier[i] = 1;
+      }
+    }
+  }
+  std::vector<int64_t> outliers;
+  for (int64_t i = 0; i < k; ++i) {
+    if (is_outlier[i]) {
+      outliers.push_back(i);
+    }
+  }
+  int64_t num_outliers = static_cast<int64_t>(outliers.size());
+
+  // x without the outliers quantized by the absmax of its rows, and the
+  // outlier columns of x
+  std::vector<int8_t> x_int8(m * k);
+  std::vector<float> row_ranges(m);
+  std::vector<float> x_outlier(m * num_outliers);
+  ParallelFor(dev_ctx, 0, m, kParallelGrain / k + 1, [&](int64_t b, int64_t e) {
+    for (int64_t r = b; r < e; ++r) {
+      const float* src = x + r * k;
+      float range = 0.f;
+      for (int64_t i = 0; i < k; ++i) {
+        if (!is_outlier[i]) {
+          range = std::max(range, std::fabs(src[i]));
+        }
+      }
+      float inv_range = range > 0.f ? 127.f / range : 0.f;
+      int8_t* dst = x_int8.data() + r * k;
+      for (int64_t i = 0; i < k; ++i) {
+        float v = is_outlier[i] ? 0.f : std::round(src[i] * inv_range);
+        dst[i] = static_cast<int8_t>(std::max(-127.f, std::min(127.f, v)));
+      }
+      for (int64_t o = 0; o < num_outliers; ++o) {
+        x_outlier[r * num_outliers + o] = src[outliers[o]];
+      }
+      row_ranges[r] = range;
+    }
+  });
+
+  // tiles of 16 weight rows are multiplied with blocks of kWeightOnlyMaxRows
+  // rows of x, which stay in the L1 cache meanwhile
+  constexpr int64_t kTile = 16;
+  const WeightOnlyMicroKernels* kernels = GetMicroKernels();
+  int64_t tiles = (n + kTile - 1) / kTile;
+  int64_t grain = std::max<int64_t>(1, kParallelGrain / (kTile * k * m) + 1);
+  ParallelFor(dev_ctx, 0, tiles, grain, [&](int64_t begin, int64_t end) {
+    int32_t acc[kWeightOnlyMaxRows];
+    for (int64_t t = begin; t < end; ++t) {
+      int64_t c_end = std::min(n, (t + 1) * kTile);
+      for (int64_t r0 = 0; r0 < m; r0 += kWeightOnlyMaxRows) {
+        int rows = static_cast<int>(
+            std::min<int64_t>(kWeightOnlyMaxRows, m - r0));
+        for (int64_t c = t * kTile; c < c_end; ++c) {
+          const int8_t* w = weight + c * k;
+          kernels->dot_s8s8(x_int8.data() + r0 * k, k, rows, w, k, acc);
+          for (int r = 0; r < rows; ++r) {
+            float sum = 0.f;
+            const float* xo = x_outlier.data() + (r0 + r) * num_outliers;
+            for (int64_t o = 0; o < num_outliers; ++o) {
+              sum += xo[o] * static_cast<float>(w[outliers[o]]);
+            }
+            float dot =
+                static_cast<float>(acc[r]) * row_ranges[r0 + r] / 127.f + sum;
+            y[(r0 + r) * n + c] = dot * scale[c] + (bias ? bias[c] : 0.f);
+          }
+        }
+      }
+    }
+  });
+}
+
+}  // namespace funcs
+}  // namespace phi
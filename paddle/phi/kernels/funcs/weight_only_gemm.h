@@ -0,0 +1,97 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/utils/test_macros.h"
+
+namespace phi {
+namespace funcs {
+
+// The CPU kernels of weight_only_linear, weight_dequantize and
+// llm_int8_linear. They work on the layout weight_quantize produces with
+// arch = 0: the weight of n output channels and k input features is
+//
+//   int8: [n, k], one byte per weight, row j holds channel j;
+//   int4: [n / 2, k], byte (j, i) holds row i of channel 2j in its low nibble
+//         and of channel 2j + 1 in its high nibble, two's complement.
+//
+// The scale is [n] per channel, or [ceil(k / group_size), n] group-wise,
+// and dequant(w)[j][i] = w[j][i] * scale[i / group_size][j].
+
+// y[m, n] = x[m, k] * dequant(weight)^T + bias, bias may be nullptr. The
+// dequantization is fused into the dot products for small m (decoding), the
+// weight is dequantized by channel tiles into the cache for a Blas GEMM
+// otherwise.
+TEST_API void WeightOnlyGemm(const CPUContext& dev_ctx,
+                             const float* x,
+                             const int8_t* weight,
+                             const float* scale,
+                             const float* bias,
+                             float* y,
+                             int64_t m,
+                             int64_t n,
+                             int64_t k,
+                             int bits,
+                             int group_size);
+
+// out[k, n] = dequant(weight)^T, i.e. the weight before weight_quantize.
+TEST_API void WeightOnlyDequantize(const CPUContext& dev_ctx,
+                                   const int8_t* weight,
+                                   const float* scale,
+                                   float* out,
+                                   int64_t n,
+                                   int64_t k,
+                                   int bits,
+                                   int group_size);
+
+// The llm.int8 matmul: the columns of x with an element above threshold
+// (in absolute value) are multiplied in float, the others are quantized to
+// int8 per row and multiplied in int32 with the int8 weight [n, k] of
+// per-channel scale [n].
+TEST_API void LLMInt8Gemm(const CPUContext& dev_ctx,
+                          const float* x,
+                          const int8_t* weight,
+                          const float* scale,
+                          const float* bias,
+                          float* y,
+                          int64_t m,
+                          int64_t n,
+                          int64_t k,
+                          float threshold);
+
+// The float copy of data in buffer, or data itself if it is float already.
+template <typename T>
+const float* ToFloatBuffer(const T* data,
+                           int64_t numel,
+                           std::vector<float>* buffer) {
+  buffer->resize(numel);
+  for (int64_t i = 0; i < numel; ++i) {
+    (*buffer)[i] = static_cast<float>(data[i]);
+  }
+  return buffer->data();
+}
+
+inline const float* ToFloatBuffer(const float* data,
+                                  int64_t numel,
+                                  std::vector<float>* buffer) {
+  return data;
+}
+
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,279 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/weight_only_gemm_isa.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace phi {
+namespace funcs {
+namespace detail {
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+namespace {
+
+inline float ReduceAdd(__m256 v) {
+  __m128 sum =
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  return _mm_cvtss_f32(sum);
+}
+
+inline int32_t ReduceAdd(__m256i v) {
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v),
+                              _mm256_extracti128_si256(v, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+  return _mm_cvtsi128_si32(sum);
+}
+
+template <int Rows>
+void DotS8(const float* x,
+           int64_t ldx,
+           const int8_t* w,
+           int64_t k,
+           const float* scale,
+           int64_t scale_stride,
+           int64_t group,
+           float* out) {
+  __m256 total[Rows];
+  float tail[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    total[r] = _mm256_setzero_ps();
+    tail[r] = 0.f;
+  }
+  for (int64_t g = 0; g < k; g += group, scale += scale_stride) {
+    int64_t end = g + group < k ? g + group : k;
+    // two accumulators per row hide the latency of the fma
+    __m256 acc[Rows];
+    __m256 acc2[Rows];
+    for (int r = 0; r < Rows; ++r) {
+      acc[r] = _mm256_setzero_ps();
+      acc2[r] = _mm256_setzero_ps();
+    }
+    int64_t i = g;
+    for (; i + 16 <= end; i += 16) {
+      __m256 wv = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i))));
+      __m256 wv2 = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i + 8))));
+      for (int r = 0; r < Rows; ++r) {
+        const float* xr = x + r * ldx + i;
+        acc[r] = _mm256_fmadd_ps(_mm256_loadu_ps(xr), wv, acc[r]);
+        acc2[r] = _mm256_fmadd_ps(_mm256_loadu_ps(xr + 8), wv2, acc2[r]);
+      }
+    }
+    for (; i + 8 <= end; i += 8) {
+      __m256 wv = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i))));
+      for (int r = 0; r < Rows; ++r) {
+        acc[r] = _mm256_fmadd_ps(_mm256_loadu_ps(x + r * ldx + i), wv, acc[r]);
+      }
+    }
+    __m256 s = _mm256_set1_ps(*scale);
+    for (int r = 0; r < Rows; ++r) {
+      total[r] = _mm256_fmadd_ps(_mm256_add_ps(acc[r], acc2[r]), s, total[r]);
+      float sum = 0.f;
+      for (int64_t j = i; j < end; ++j) {
+        sum += x[r * ldx + j] * static_cast<float>(w[j]);
+      }
+      tail[r] += sum * *scale;
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    out[r] = ReduceAdd(total[r]) + tail[r];
+  }
+}
+
+template <int Rows>
+void DotS4x2(const float* x,
+             int64_t ldx,
+             const int8_t* w,
+             int64_t k,
+             const float* scale,
+             int64_t scale_stride,
+             int64_t group,
+             float* out) {
+  const __m256i mask = _mm256_set1_epi32(0xf);
+  const __m256i eight = _mm256_set1_epi32(8);
+  __m256 total_lo[Rows];
+  __m256 total_hi[Rows];
+  float tail_lo[Rows];
+  float tail_hi[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    total_lo[r] = _mm256_setzero_ps();
+    total_hi[r] = _mm256_setzero_ps();
+    tail_lo[r] = 0.f;
+    tail_hi[r] = 0.f;
+  }
+  for (int64_t g = 0; g < k; g += group, scale += scale_stride) {
+    int64_t end = g + group < k ? g + group : k;
+    __m256 acc_lo[Rows];
+    __m256 acc_hi[Rows];
+    for (int r = 0; r < Rows; ++r) {
+      acc_lo[r] = _mm256_setzero_ps();
+      acc_hi[r] = _mm256_setzero_ps();
+    }
+    int64_t i = g;
+    for (; i + 8 <= end; i += 8) {
+      __m256i v = _mm256_cvtepu8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(w + i)));
+      // sign extends a nibble by (v ^ 8) - 8
+      __m256i lo = _mm256_sub_epi32(
+          _mm256_xor_si256(_mm256_and_si256(v, mask), eight), eight);
+      __m256i hi = _mm256_sub_epi32(
+          _mm256_xor_si256(_mm256_srli_epi32(v, 4), eight), eight);
+      __m256 lo_ps = _mm256_cvtepi32_ps(lo);
+      __m256 hi_ps = _mm256_cvtepi32_ps(hi);
+      for (int r = 0; r < Rows; ++r) {
+        __m256 xv = _mm256_loadu_ps(x + r * ldx + i);
+        acc_lo[r] = _mm256_fmadd_ps(xv, lo_ps, acc_lo[r]);
+        acc_hi[r] = _mm256_fmadd_ps(xv, hi_ps, acc_hi[r]);
+      }
+    }
+    __m256 s_lo = _mm256_set1_ps(scale[0]);
+    __m256 s_hi = _mm256_set1_ps(scale[1]);
+    for (int r = 0; r < Rows; ++r) {
+      total_lo[r] = _mm256_fmadd_ps(acc_lo[r], s_lo, total_lo[r]);
+      total_hi[r] = _mm256_fmadd_ps(acc_hi[r], s_hi, total_hi[r]);
+      float sum_lo = 0.f;
+      float sum_hi = 0.f;
+      for (int64_t j = i; j < end; ++j) {
+        int v = static_cast<uint8_t>(w[j]);
+        sum_lo += x[r * ldx + j] * static_cast<float>(((v & 0xf) ^ 8) - 8);
+        sum_hi += x[r * ldx + j] * static_cast<float>(((v >> 4) ^ 8) - 8);
+      }
+      tail_lo[r] += sum_lo * scale[0];
+      tail_hi[r] += sum_hi * scale[1];
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    out[2 * r] = ReduceAdd(total_lo[r]) + tail_lo[r];
+    out[2 * r + 1] = ReduceAdd(total_hi[r]) + tail_hi[r];
+  }
+}
+
+template <int Rows>
+void DotS8S8(
+    const int8_t* a, int64_t lda, const int8_t* w, int64_t k, int32_t* out) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i acc[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    acc[r] = _mm256_setzero_si256();
+  }
+  int64_t i = 0;
+  for (; i + 32 <= k; i += 32) {
+    // |w| * (a with the sign of w) fits the unsigned x signed maddubs, the
+    // sum of two products is at most 2 * 128 * 127 and does not saturate
+    __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i));
+    __m256i w_abs = _mm256_abs_epi8(wv);
+    for (int r = 0; r < Rows; ++r) {
+      __m256i av = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(a + r * lda + i));
+      __m256i prod = _mm256_maddubs_epi16(w_abs, _mm256_sign_epi8(av, wv));
+      acc[r] = _mm256_add_epi32(acc[r], _mm256_madd_epi16(prod, ones));
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    int32_t sum = ReduceAdd(acc[r]);
+    for (int64_t j = i; j < k; ++j) {
+      sum += static_cast<int32_t>(a[r * lda + j]) * w[j];
+    }
+    out[r] = sum;
+  }
+}
+
+void DotS8Rows(const float* x,
+               int64_t ldx,
+               int rows,
+               const int8_t* w,
+               int64_t k,
+               const float* scale,
+               int64_t scale_stride,
+               int64_t group,
+               float* out) {
+  switch (rows) {
+    case 1:
+      return DotS8<1>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 2:
+      return DotS8<2>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 3:
+      return DotS8<3>(x, ldx, w, k, scale, scale_stride, group, out);
+    default:
+      return DotS8<4>(x, ldx, w, k, scale, scale_stride, group, out);
+  }
+}
+
+void DotS4x2Rows(const float* x,
+                 int64_t ldx,
+                 int rows,
+                 const int8_t* w,
+                 int64_t k,
+                 const float* scale,
+                 int64_t scale_stride,
+                 int64_t group,
+                 float* out) {
+  switch (rows) {
+    case 1:
+      return DotS4x2<1>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 2:
+      return DotS4x2<2>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 3:
+      return DotS4x2<3>(x, ldx, w, k, scale, scale_stride, group, out);
+    default:
+      return DotS4x2<4>(x, ldx, w, k, scale, scale_stride, group, out);
+  }
+}
+
+void DotS8S8Rows(const int8_t* a,
+                 int64_t lda,
+                 int rows,
+                 const int8_t* w,
+                 int64_t k,
+                 int32_t* out) {
+  switch (rows) {
+    case 1:
+      return DotS8S8<1>(a, lda, w, k, out);
+    case 2:
+      return DotS8S8<2>(a, lda, w, k, out);
+    case 3:
+      return DotS8S8<3>(a, lda, w, k, out);
+    default:
+      return DotS8S8<4>(a, lda, w, k, out);
+  }
+}
+
+}  // namespace
+
+const WeightOnlyMicroKernels* GetWeightOnlyAVX2MicroKernels() {
+  static const WeightOnlyMicroKernels kernels = {
+      "avx2", DotS8Rows, DotS4x2Rows, DotS8S8Rows};
+  return &kernels;
+}
+
+#else
+
+const WeightOnlyMicroKernels* GetWeightOnlyAVX2MicroKernels() {
+  return nullptr;
+}
+
+#endif
+
+}  // namespace detail
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,279 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include "paddle/phi/kernels/funcs/weight_only_gemm_isa.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+namespace phi {
+namespace funcs {
+namespace detail {
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+
+namespace {
+
+template <int Rows>
+void DotS8(const float* x,
+           int64_t ldx,
+           const int8_t* w,
+           int64_t k,
+           const float* scale,
+           int64_t scale_stride,
+           int64_t group,
+           float* out) {
+  __m512 total[Rows];
+  float tail[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    total[r] = _mm512_setzero_ps();
+    tail[r] = 0.f;
+  }
+  for (int64_t g = 0; g < k; g += group, scale += scale_stride) {
+    int64_t end = g + group < k ? g + group : k;
+    // two accumulators per row hide the latency of the fma
+    __m512 acc[Rows];
+    __m512 acc2[Rows];
+    for (int r = 0; r < Rows; ++r) {
+      acc[r] = _mm512_setzero_ps();
+      acc2[r] = _mm512_setzero_ps();
+    }
+    int64_t i = g;
+    for (; i + 32 <= end; i += 32) {
+      __m512 wv = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i))));
+      __m512 wv2 = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i + 16))));
+      for (int r = 0; r < Rows; ++r) {
+        const float* xr = x + r * ldx + i;
+        acc[r] = _mm512_fmadd_ps(_mm512_loadu_ps(xr), wv, acc[r]);
+        acc2[r] = _mm512_fmadd_ps(_mm512_loadu_ps(xr + 16), wv2, acc2[r]);
+      }
+    }
+    for (; i + 16 <= end; i += 16) {
+      __m512 wv = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i))));
+      for (int r = 0; r < Rows; ++r) {
+        acc[r] = _mm512_fmadd_ps(_mm512_loadu_ps(x + r * ldx + i), wv, acc[r]);
+      }
+    }
+    __m512 s = _mm512_set1_ps(*scale);
+    for (int r = 0; r < Rows; ++r) {
+      total[r] = _mm512_fmadd_ps(_mm512_add_ps(acc[r], acc2[r]), s, total[r]);
+      float sum = 0.f;
+      for (int64_t j = i; j < end; ++j) {
+        sum += x[r * ldx + j] * static_cast<float>(w[j]);
+      }
+      tail[r] += sum * *scale;
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    out[r] = _mm512_reduce_add_ps(total[r]) + tail[r];
+  }
+}
+
+template <int Rows>
+void DotS4x2(const float* x,
+             int64_t ldx,
+             const int8_t* w,
+             int64_t k,
+             const float* scale,
+             int64_t scale_stride,
+             int64_t group,
+             float* out) {
+  const __m512i mask = _mm512_set1_epi32(0xf);
+  const __m512i eight = _mm512_set1_epi32(8);
+  __m512 total_lo[Rows];
+  __m512 total_hi[Rows];
+  float tail_lo[Rows];
+  float tail_hi[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    total_lo[r] = _mm512_setzero_ps();
+    total_hi[r] = _mm512_setzero_ps();
+    tail_lo[r] = 0.f;
+    tail_hi[r] = 0.f;
+  }
+  for (int64_t g = 0; g < k; g += group, scale += scale_stride) {
+    int64_t end = g + group < k ? g + group : k;
+    __m512 acc_lo[Rows];
+    __m512 acc_hi[Rows];
+    for (int r = 0; r < Rows; ++r) {
+      acc_lo[r] = _mm512_setzero_ps();
+      acc_hi[r] = _mm512_setzero_ps();
+    }
+    int64_t i = g;
+    for (; i + 16 <= end; i += 16) {
+      __m512i v = _mm512_cvtepu8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + i)));
+      // sign extends a nibble by (v ^ 8) - 8
+      __m512i lo = _mm512_sub_epi32(
+          _mm512_xor_si512(_mm512_and_si512(v, mask), eight), eight);
+      __m512i hi = _mm512_sub_epi32(
+          _mm512_xor_si512(_mm512_srli_epi32(v, 4), eight), eight);
+      __m512 lo_ps = _mm512_cvtepi32_ps(lo);
+      __m512 hi_ps = _mm512_cvtepi32_ps(hi);
+      for (int r = 0; r < Rows; ++r) {
+        __m512 xv = _mm512_loadu_ps(x + r * ldx + i);
+        acc_lo[r] = _mm512_fmadd_ps(xv, lo_ps, acc_lo[r]);
+        acc_hi[r] = _mm512_fmadd_ps(xv, hi_ps, acc_hi[r]);
+      }
+    }
+    __m512 s_lo = _mm512_set1_ps(scale[0]);
+    __m512 s_hi = _mm512_set1_ps(scale[1]);
+    for (int r = 0; r < Rows; ++r) {
+      total_lo[r] = _mm512_fmadd_ps(acc_lo[r], s_lo, total_lo[r]);
+      total_hi[r] = _mm512_fmadd_ps(acc_hi[r], s_hi, total_hi[r]);
+      float sum_lo = 0.f;
+      float sum_hi = 0.f;
+      for (int64_t j = i; j < end; ++j) {
+        int v = static_cast<uint8_t>(w[j]);
+        sum_lo += x[r * ldx + j] * static_cast<float>(((v & 0xf) ^ 8) - 8);
+        sum_hi += x[r * ldx + j] * static_cast<float>(((v >> 4) ^ 8) - 8);
+      }
+      tail_lo[r] += sum_lo * scale[0];
+      tail_hi[r] += sum_hi * scale[1];
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    out[2 * r] = _mm512_reduce_add_ps(total_lo[r]) + tail_lo[r];
+    out[2 * r + 1] = _mm512_reduce_add_ps(total_hi[r]) + tail_hi[r];
+  }
+}
+
+// |w| * (a with the sign of w): an unsigned x signed product, for vpdpbusd
+// or vpmaddubsw.
+template <int Rows, bool Vnni>
+void DotS8S8(
+    const int8_t* a, int64_t lda, const int8_t* w, int64_t k, int32_t* out) {
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i ones = _mm512_set1_epi16(1);
+  __m512i acc[Rows];
+  for (int r = 0; r < Rows; ++r) {
+    acc[r] = _mm512_setzero_si512();
+  }
+  int64_t i = 0;
+  for (; i + 64 <= k; i += 64) {
+    __m512i wv = _mm512_loadu_si512(w + i);
+    __m512i w_abs = _mm512_abs_epi8(wv);
+    __mmask64 negative = _mm512_movepi8_mask(wv);
+    for (int r = 0; r < Rows; ++r) {
+      __m512i av = _mm512_loadu_si512(a + r * lda + i);
+      av = _mm512_mask_sub_epi8(av, negative, zero, av);
+#if defined(__AVX512VNNI__)
+      if (Vnni) {
+        acc[r] = _mm512_dpbusd_epi32(acc[r], w_abs, av);
+        continue;
+      }
+#endif
+      __m512i prod = _mm512_maddubs_epi16(w_abs, av);
+      acc[r] = _mm512_add_epi32(acc[r], _mm512_madd_epi16(prod, ones));
+    }
+  }
+  for (int r = 0; r < Rows; ++r) {
+    int32_t sum = _mm512_reduce_add_epi32(acc[r]);
+    for (int64_t j = i; j < k; ++j) {
+      sum += static_cast<int32_t>(a[r * lda + j]) * w[j];
+    }
+    out[r] = sum;
+  }
+}
+
+void DotS8Rows(const float* x,
+               int64_t ldx,
+               int rows,
+               const int8_t* w,
+               int64_t k,
+               const float* scale,
+               int64_t scale_stride,
+               int64_t group,
+               float* out) {
+  switch (rows) {
+    case 1:
+      return DotS8<1>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 2:
+      return DotS8<2>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 3:
+      return DotS8<3>(x, ldx, w, k, scale, scale_stride, group, out);
+    default:
+      return DotS8<4>(x, ldx, w, k, scale, scale_stride, group, out);
+  }
+}
+
+void DotS4x2Rows(const float* x,
+                 int64_t ldx,
+                 int rows,
+                 const int8_t* w,
+                 int64_t k,
+                 const float* scale,
+                 int64_t scale_stride,
+                 int64_t group,
+                 float* out) {
+  switch (rows) {
+    case 1:
+      return DotS4x2<1>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 2:
+      return DotS4x2<2>(x, ldx, w, k, scale, scale_stride, group, out);
+    case 3:
+      return DotS4x2<3>(x, ldx, w, k, scale, scale_stride, group, out);
+    default:
+      return DotS4x2<4>(x, ldx, w, k, scale, scale_stride, group, out);
+  }
+}
+
+template <bool Vnni>
+void DotS8S8Rows(const int8_t* a,
+                 int64_t lda,
+                 int rows,
+                 const int8_t* w,
+                 int64_t k,
+                 int32_t* out) {
+  switch (rows) {
+    case 1:
+      return DotS8S8<1, Vnni>(a, lda, w, k, out);
+    case 2:
+      return DotS8S8<2, Vnni>(a, lda, w, k, out);
+    case 3:
+      return DotS8S8<3, Vnni>(a, lda, w, k, out);
+    default:
+      return DotS8S8<4, Vnni>(a, lda, w, k, out);
+  }
+}
+
+}  // namespace
+
+const WeightOnlyMicroKernels* GetWeightOnlyAVX512MicroKernels(bool vnni) {
+  static const WeightOnlyMicroKernels kernels = {
+      "avx512", DotS8Rows, DotS4x2Rows, DotS8S8Rows<false>};
+#if defined(__AVX512VNNI__)
+  static const WeightOnlyMicroKernels vnni_kernels = {
+      "avx512_vnni", DotS8Rows, DotS4x2Rows, DotS8S8Rows<true>};
+  if (vnni) {
+    return &vnni_kernels;
+  }
+#endif
+  return &kernels;
+}
+
+#else
+
+const WeightOnlyMicroKernels* GetWeightOnlyAVX512MicroKernels(bool vnni) {
+  return nullptr;
+}
+
+#endif
+
+}  // namespace detail
+}  // namespace funcs
+}  // namespace phi
@@ -0,0 +1,84 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+#include <cstdint>
+
+#include "paddle/utils/test_macros.h"
+
+// The micro kernels of weight_only_gemm.cc for one instruction set. Each set
+// is built in its own translation unit with the compile flags of its
+// instruction set (see paddle/phi/CMakeLists.txt) and is chosen at runtime
+// by MayIUse, so these files must not instantiate any inline function or
+// template shared with the other translation units.
+
+namespace phi {
+namespace funcs {
+namespace detail {
+
+// The number of rows of x a micro kernel multiplies with a weight at once,
+// the weight is loaded and decoded once for all of them.
+constexpr int kWeightOnlyMaxRows = 4;
+
+struct WeightOnlyMicroKernels {
+  const char* name;
+
+  // out[r] = sum_i x[r * ldx + i] * w[i] * scale[(i / group) * scale_stride],
+  // for r < rows <= kWeightOnlyMaxRows. The scales of the groups are applied
+  // to the vector accumulators, group is k for a per-channel scale.
+  void (*dot_s8)(const float* x,
+                 int64_t ldx,
+                 int rows,
+                 const int8_t* w,
+                 int64_t k,
+                 const float* scale,
+                 int64_t scale_stride,
+                 int64_t group,
+                 float* out);
+
+  // out[2 * r] and out[2 * r + 1] are the dot products of row r of x with
+  // the low and the high int4 nibbles of w, whose scales are scale[0] and
+  // scale[1] of every group.
+  void (*dot_s4x2)(const float* x,
+                   int64_t ldx,
+                   int rows,
+                   const int8_t* w,
+                   int64_t k,
+                   const float* scale,
+                   int64_t scale_stride,
+                   int64_t group,
+                   float* out);
+
+  // out[r] = sum_i a[r * lda + i] * w[i], the elements of a must be in
+  // [-127, 127].
+  void (*dot_s8s8)(const int8_t* a,
+                   int64_t lda,
+                   int rows,
+                   const int8_t* w,
+                   int64_t k,
+                   int32_t* out);
+};
+
+// The portable kernels, always available.
+TEST_API const WeightOnlyMicroKernels* GetWeightOnlyRefMicroKernels();
+// The AVX2 + FMA kernels, nullptr if they are not built.
+TEST_API const WeightOnlyMicroKernels* GetWeightOnlyAVX2MicroKernels();
+// The AVX512 kernels using VNNI if vnni, nullptr if they are not built.
+TEST_API const WeightOnlyMicroKernels* GetWeightOnlyAVX512MicroKernels(
+    bool vnni);
+
+}  // namespace detail
+}  // namespace funcs
+}  // namespace phi
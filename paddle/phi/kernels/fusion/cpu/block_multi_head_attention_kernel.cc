@@ -0,0 +1,232 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/block_attn_cpu.h"
+
+namespace phi {
+namespace fusion {
+
+namespace {
+
+// The dims [mask_batch, mask_heads, rows, cols] of a mask of
+// block_multihead_attention.
+template <typename T>
+const T* GetBlockAttnMask(const paddle::optional<DenseTensor>& mask,
+                          const std::string& name,
+                          int64_t batch_size,
+                          int64_t num_heads,
+                          int64_t* mask_batch,
+                          int64_t* mask_heads,
+                          int64_t* rows,
+                          int64_t* cols) {
+  if (!mask) {
+    return nullptr;
+  }
+  const auto& dims = mask->dims();
+  PADDLE_ENFORCE_EQ(
+      dims.size() == 4 && (dims[0] == 1 || dims[0] == batch_size) &&
+          (dims[1] == 1 || dims[1] == num_heads),
+      true,
+      phi::errors::InvalidArgument(
+          "The shape of %s should be [batch_size or 1, num_heads or 1, "
+          "rows, cols] = [%d or 1, %d or 1, rows, cols], but received {%s}.",
+          name,
+          batch_size,
+          num_heads,
+          dims));
+  *mask_batch = dims[0];
+  *mask_heads = dims[1];
+  *rows = dims[2];
+  *cols = dims[3];
+  return mask->data<T>();
+}
+
+template <typename T>
+T* AllocInplace(const CPUContext& dev_ctx,
+                const DenseTensor& x,
+                DenseTensor* out) {
+  out->Resize(x.dims());
+  T* out_data = dev_ctx.Alloc<T>(out);
+  const T* x_data = x.data<T>();
+  if (out_data != x_data) {
+    std::copy(x_data, x_data + x.numel(), out_data);
+  }
+  return out_data;
+}
+
+}  // namespace
+
+template <typename T, typename Context>
+void BlockMultiheadAttentionKernel(
+    const Context& dev_ctx,
+    const DenseTensor& qkv,
+    const DenseTensor& key_cache,
+    const DenseTensor& value_cache,
+    const DenseTensor& seq_lens_encoder,
+    const DenseTensor& seq_lens_decoder,
+    const DenseTensor& seq_lens_this_time,
+    const DenseTensor& padding_offsets,
+    const DenseTensor& cum_offsets,
+    const DenseTensor& cu_seqlens_q,
+    const DenseTensor& cu_seqlens_k,
+    const DenseTensor& block_tables,
+    const paddle::optional<DenseTensor>& pre_key_cache,
+    const paddle::optional<DenseTensor>& pre_value_cache,
+    const paddle::optional<DenseTensor>& rope_emb,
+    const paddle::optional<DenseTensor>& mask,
+    const paddle::optional<DenseTensor>& tgt_mask,
+    const paddle::optional<DenseTensor>& cache_k_quant_scales,
+    const paddle::optional<DenseTensor>& cache_v_quant_scales,
+    const paddle::optional<DenseTensor>& cache_k_dequant_scales,
+    const paddle::optional<DenseTensor>& cache_v_dequant_scales,
+    const paddle::optional<DenseTensor>& qkv_out_scale,
+    const paddle::optional<DenseTensor>& qkv_bias,
+    const paddle::optional<DenseTensor>& out_shift,
+    const paddle::optional<DenseTensor>& out_smooth,
+    const paddle::optional<DenseTensor>& max_enc_len_this_time,
+    const paddle::optional<DenseTensor>& max_dec_len_this_time,
+    int max_seq_len,
+    int block_size,
+    bool use_neox_style,
+    const bool dynamic_cachekv_quant,
+    const int quant_round_type,
+    const float quant_max_bound,
+    const float quant_min_bound,
+    const float out_scale,
+    const std::string& compute_dtype,
+    DenseTensor* fmha_out,
+    DenseTensor* qkv_out,
+    DenseTensor* key_cache_out,
+    DenseTensor* value_cache_out) {
+  if (pre_key_cache || pre_value_cache) {
+    PADDLE_THROW(phi::errors::Unimplemented(
+        "pre_key_cache and pre_value_cache of block_multihead_attention are "
+        "not supported on CPU."));
+  }
+  if (cache_k_quant_scales || cache_v_quant_scales ||
+      cache_k_dequant_scales || cache_v_dequant_scales) {
+    PADDLE_THROW(phi::errors::Unimplemented(
+        "The int8 cache of block_multihead_attention is not supported on "
+        "CPU."));
+  }
+  if (qkv_out_scale || out_shift || out_smooth || out_scale > 0) {
+    PADDLE_THROW(phi::errors::Unimplemented(
+        "The quantized input and output of block_multihead_attention are not "
+        "supported on CPU."));
+  }
+
+  const auto& key_cache_dims = key_cache.dims();
+  PADDLE_ENFORCE_EQ(value_cache.dims(),
+                    key_cache_dims,
+                    phi::errors::InvalidArgument(
+                        "The value_cache [%s] of block_multihead_attention "
+                        "should be as large as the key_cache [%s].",
+                        value_cache.dims(),
+                        key_cache_dims));
+  funcs::BlockAttnCPUParams params;
+  params.batch_size = cum_offsets.dims()[0];
+  params.num_heads_k = key_cache_dims[1];
+  params.head_dim = key_cache_dims[3];
+  params.num_heads = qkv.dims()[qkv.dims().size() - 1] / params.head_dim -
+                     2 * params.num_heads_k;
+  params.block_size = key_cache_dims[2];
+  params.num_blocks = key_cache_dims[0];
+  params.max_blocks_per_seq = block_tables.dims()[1];
+  PADDLE_ENFORCE_EQ(params.block_size,
+                    block_size,
+                    phi::errors::InvalidArgument(
+                        "The block_size of key_cache is %d, but the "
+                        "attribute block_size is %d.",
+                        params.block_size,
+                        block_size));
+  params.seq_lens_encoder = seq_lens_encoder.data<int>();
+  params.seq_lens_decoder = seq_lens_decoder.data<int>();
+  params.seq_lens_this_time = seq_lens_this_time.data<int>();
+  params.cu_seqlens_q = cu_seqlens_q.data<int>();
+  params.block_tables = block_tables.data<int>();
+  if (rope_emb) {
+    // [2, 1, rope_seq_len, 1, head_dim / 2], the cos and then the sin
+    params.rope_emb = rope_emb->data<float>();
+    params.rope_seq_len = rope_emb->dims()[2];
+    PADDLE_ENFORCE_EQ(
+        rope_emb->numel(),
+        params.rope_seq_len * (params.head_dim / 2) * 2,
+        phi::errors::InvalidArgument(
+            "The shape of rope_emb should be [2, 1, seq_len, 1, head_dim / "
+            "2] with head_dim %d, but received {%s}.",
+            params.head_dim,
+            rope_emb->dims()));
+  }
+  params.use_neox_style = use_neox_style;
+  int64_t tgt_mask_rows = 0;
+  const T* mask_data = GetBlockAttnMask<T>(mask,
+                                           "mask",
+                                           params.batch_size,
+                                           params.num_heads,
+                                           &params.mask_batch,
+                                           &params.mask_heads,
+                                           &params.mask_rows,
+                                           &params.mask_cols);
+  const T* tgt_mask_data = GetBlockAttnMask<T>(tgt_mask,
+                                               "tgt_mask",
+                                               params.batch_size,
+                                               params.num_heads,
+                                               &params.tgt_mask_batch,
+                                               &params.tgt_mask_heads,
+                                               &tgt_mask_rows,
+                                               &params.tgt_mask_cols);
+  if (tgt_mask) {
+    PADDLE_ENFORCE_EQ(tgt_mask_rows,
+                      1,
+                      phi::errors::InvalidArgument(
+                          "The tgt_mask is [batch_size or 1, num_heads or 1, "
+                          "1, cols], but its rows are %d.",
+                          tgt_mask_rows));
+  }
+
+  T* qkv_data = AllocInplace<T>(dev_ctx, qkv, qkv_out);
+  T* key_cache_data = AllocInplace<T>(dev_ctx, key_cache, key_cache_out);
+  T* value_cache_data = AllocInplace<T>(dev_ctx, value_cache, value_cache_out);
+  T* out_data = dev_ctx.template Alloc<T>(fmha_out);
+  std::fill(out_data, out_data + fmha_out->numel(), static_cast<T>(0));
+
+  funcs::BlockAttnCPUForward(dev_ctx,
+                             params,
+                             qkv_bias ? qkv_bias->data<T>() : nullptr,
+                             mask_data,
+                             tgt_mask_data,
+                             qkv_data,
+                             key_cache_data,
+                             value_cache_data,
+                             out_data);
+}
+
+}  // namespace fusion
+}  // namespace phi
+
+PD_REGISTER_KERNEL(block_multihead_attention,
+                   CPU,
+                   ALL_LAYOUT,
+                   phi::fusion::BlockMultiheadAttentionKernel,
+                   float,
+                   phi::dtype::float16,
+                   phi::dtype::bfloat16) {
+  kernel->InputAt(24).SetBackend(phi::Backend::CPU);
+  kernel->InputAt(25).SetBackend(phi::Backend::CPU);
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/kernel_registry.h"
+#include "paddle/phi/kernels/funcs/jit/kernels.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace fusion {
+
+// The rms_norm of the builds without the AVX-512 kernel
+// (rms_norm_avx_kernel.cc), on the jit kernels of the CPU.
+template <typename T, typename Context>
+void RmsNormKernel(const Context& dev_ctx,
+                   const DenseTensor& x,
+                   const paddle::optional<DenseTensor>& bias,
+                   const paddle::optional<DenseTensor>& residual,
+                   const DenseTensor& norm_weight,
+                   const paddle::optional<DenseTensor>& norm_bias,
+                   const float epsilon,
+                   const int begin_norm_axis,
+                   const float quant_scale,
+                   const int quant_round_type,
+                   const float quant_max_bound,
+                   const float quant_min_bound,
+                   DenseTensor* out,
+                   DenseTensor* residual_out,
+                   DenseTensor* inv_var) {
+  if (quant_scale > 0.0f) {
+    PD_THROW("NOT supported quant int8. ");
+  }
+
+  int64_t rows = 1;
+  int64_t cols = 1;
+  for (int i = 0; i < begin_norm_axis; i++) {
+    rows *= x.dims()[i];
+  }
+  for (int i = begin_norm_axis; i < x.dims().size(); i++) {
+    cols *= x.dims()[i];
+  }
+  PADDLE_ENFORCE_LE(
+      cols,
+      std::numeric_limits<int>::max(),
+      phi::errors::InvalidArgument(
+          "The normalized size of rms_norm should be at most INT_MAX, but "
+          "received %d.",
+          cols));
+  const int size = static_cast<int>(cols);
+
+  const T* x_data = x.data<T>();
+  const T* norm_weight_data = norm_weight.data<T>();
+  const T* norm_bias_data = norm_bias ? norm_bias.get().data<T>() : nullptr;
+  const T* residual_data = residual ? residual.get().data<T>() : nullptr;
+  const T* bias_data = bias ? bias.get().data<T>() : nullptr;
+  T* out_data = dev_ctx.template Alloc<T>(out);
+  T* residual_out_data =
+      residual ? dev_ctx.template Alloc<T>(residual_out) : nullptr;
+
+  // the cache of the jit kernels is thread local, get them before ParallelFor
+  auto rms_norm =
+      jit::KernelFuncs<jit::RMSNormTuple<T>, CPUPlace>::Cache().At(
+          jit::kAnySize);
+  // the code of vadd is generated for the size
+  auto vadd = jit::KernelFuncs<jit::VAddTuple<T>, CPUPlace>::Cache().At(size);
+
+  // 16k elements a chunk
+  const int64_t grain = std::max<int64_t>(1, (1 << 14) / cols);
+  funcs::ParallelFor(dev_ctx, 0, rows, grain, [&](int64_t begin, int64_t end) {
+    const T* px = x_data + begin * cols;
+    T* py = out_data + begin * cols;
+    if (residual) {
+      // residual_out = x + residual + bias, and it is normalized
+      T* pr_out = residual_out_data + begin * cols;
+      for (int64_t r = begin; r < end; ++r) {
+        const int64_t offset = r * cols;
+        vadd(x_data + offset,
+             residual_data + offset,
+             residual_out_data + offset,
+             size);
+        if (bias) {
+          vadd(bias_data,
+               residual_out_data + offset,
+               residual_out_data + offset,
+               size);
+        }
+      }
+      px = pr_out;
+    }
+    rms_norm(px,
+             norm_weight_data,
+             py,
+             static_cast<int>(end - begin),
+             epsilon,
+             size);
+    if (norm_bias_data) {
+      for (int64_t r = begin; r < end; ++r) {
+        vadd(norm_bias_data, out_data + r * cols, out_data + r * cols, size);
+      }
+    }
+  });
+}
+
+}  // namespace fusion
+}  // namespace phi
+
+PD_REGISTER_KERNEL(
+    rms_norm, CPU, ALL_LAYOUT, phi::fusion::RmsNormKernel, float, double) {}
@@ -0,0 +1,38 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "paddle/phi/core/dense_tensor.h"
+
+namespace phi {
+
+// top_p_sampling with the top_k, temperature and penalties of
+// funcs::TopPSamplingCPUParams, x holding logits if is_logits.
+template <typename T, typename Context>
+void TopKTopPSamplingKernel(const Context& dev_ctx,
+                            const DenseTensor& x,
+                            const DenseTensor& ps,
+                            const paddle::optional<DenseTensor>& threshold,
+                            const paddle::optional<DenseTensor>& pre_ids,
+                            int top_k,
+                            float temperature,
+                            float repetition_penalty,
+                            float presence_penalty,
+                            bool is_logits,
+                            int random_seed,
+                            DenseTensor* out,
+                            DenseTensor* ids);
+
+}  // namespace phi
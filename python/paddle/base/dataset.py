@@ -404,7 +404,10 @@ class InMemoryDataset(DatasetBase):
         Set data_feed_desc
         """
         self.proto_desc.name = data_feed_type
-        if self.proto_desc.name == "SlotRecordInMemoryDataFeed":
+        if self.proto_desc.name in (
+            "SlotRecordInMemoryDataFeed",
+            "SlotRecordBinaryInMemoryDataFeed",
+        ):
             self.dataset = core.Dataset("SlotRecordDataset")
 
     @deprecated(
@@ -837,6 +840,37 @@ class InMemoryDataset(DatasetBase):
         self.dataset.wait_preload_done()
         self.dataset.destroy_preload_readers()
 
+    @deprecated(
+        since="2.0.0",
+        update_to="paddle.distributed.InMemoryDataset.convert_to_binary_files",
+    )
+    def convert_to_binary_files(self, output_dir):
+        """
+        Convert the text files of the filelist to the slot binary files read by
+        SlotRecordBinaryInMemoryDataFeed, return the binary files
+
+        Examples:
+            .. code-block:: python
+
+                >>> # doctest: +SKIP('Depends on external files.')
+                >>> import paddle.base as base
+                >>> dataset = base.DatasetFactory().create_dataset("InMemoryDataset")
+                >>> dataset.set_feed_type("SlotRecordBinaryInMemoryDataFeed")
+                >>> dataset.set_filelist(["a.txt", "b.txt"])
+                >>> binary_files = dataset.convert_to_binary_files("./binary")
+                >>> dataset.set_filelist(binary_files)
+                >>> dataset.load_into_memory()
+        """
+        # no readers are created here, they would keep the text filelist
+        if self.thread_num <= 0:
+            self.thread_num = 1
+        self.dataset.set_thread_num(self.thread_num)
+        self.dataset.set_parse_ins_id(self.parse_ins_id)
+        self.dataset.set_parse_content(self.parse_content)
+        self.dataset.set_parse_logkey(self.parse_logkey)
+        self.dataset.set_data_feed_desc(self._desc())
+        return self.dataset.convert_to_binary_files(output_dir)
+
     @deprecated(
         since="2.0.0",
         update_to="paddle.distributed.InMemoryDataset.local_shuffle",
@@ -619,7 +619,10 @@ class InMemoryDataset(DatasetBase):
         Set data_feed_desc
         """
         self.proto_desc.name = data_feed_type
-        if self.proto_desc.name == "SlotRecordInMemoryDataFeed":
+        if self.proto_desc.name in (
+            "SlotRecordInMemoryDataFeed",
+            "SlotRecordBinaryInMemoryDataFeed",
+        ):
             self.dataset = core.Dataset("SlotRecordDataset")
 
     def _prepare_to_run(self):
@@ -975,6 +978,59 @@ class InMemoryDataset(DatasetBase):
         self.dataset.wait_preload_done()
         self.dataset.destroy_preload_readers()
 
+    def convert_to_binary_files(self, output_dir):
+        """
+        :api_attr: Static Graph
+
+        Convert the text files of the filelist to the slot binary files read by
+        SlotRecordBinaryInMemoryDataFeed. The conversion parses the files with
+        the current slots and pipe_command, so later passes load the binary
+        files without parsing. The binary files have to be on a local file
+        system.
+
+        Args:
+            output_dir(str): local directory the binary files are written to
+
+        Returns:
+            list[str], the binary files in the order of the filelist
+
+        Examples:
+            .. code-block:: python
+
+                >>> # doctest: +SKIP('No files to read')
+                >>> import paddle
+                >>> paddle.enable_static()
+
+                >>> dataset = paddle.distributed.InMemoryDataset()
+                >>> dataset._set_feed_type("SlotRecordBinaryInMemoryDataFeed")
+                >>> slots = ["slot1", "slot2", "slot3", "slot4"]
+                >>> slots_vars = []
+                >>> for slot in slots:
+                ...     var = paddle.static.data(
+                ...         name=slot, shape=[None, 1], dtype="int64", lod_level=1)
+                ...     slots_vars.append(var)
+                >>> dataset.init(
+                ...     batch_size=1,
+                ...     thread_num=2,
+                ...     input_type=1,
+                ...     pipe_command="cat",
+                ...     use_var=slots_vars)
+                >>> dataset.set_filelist(["a.txt", "b.txt"])
+                >>> binary_files = dataset.convert_to_binary_files("./binary")
+                >>> dataset.set_filelist(binary_files)
+                >>> dataset.load_into_memory()
+
+        """
+        # no readers are created here, they would keep the text filelist
+        if self.thread_num <= 0:
+            self.thread_num = 1
+        self.dataset.set_thread_num(self.thread_num)
+        self.dataset.set_parse_ins_id(self.parse_ins_id)
+        self.dataset.set_parse_content(self.parse_content)
+        self.dataset.set_parse_logkey(self.parse_logkey)
+        self.dataset.set_data_feed_desc(self._desc())
+        return self.dataset.convert_to_binary_files(output_dir)
+
     def local_shuffle(self):
         """
         :api_attr: Static Graph
@@ -1324,3 +1324,96 @@ def top_p_sampling(x, ps, threshold=None, seed=None, name=None):
         attrs=attrs,
     )
     return out, ids
+
+
+def top_k_top_p_sampling(
+    x,
+    ps,
+    threshold=None,
+    pre_ids=None,
+    top_k=0,
+    temperature=1.0,
+    repetition_penalty=1.0,
+    presence_penalty=0.0,
+    is_logits=False,
+    seed=None,
+    name=None,
+):
+    """
+    Sample a token from each row of `x` like `top_p_sampling`, after top-k,
+    temperature and the penalties of the tokens in `pre_ids`. Only CPU is
+    supported.
+
+    Args:
+        x(Tensor): A 2-D Tensor [batch_size, vocab_size] with type float32, float64, float16 and bfloat16,
+            the probabilities of the tokens, or their logits if `is_logits`.
+        ps(Tensor): A 1-D Tensor with the type of `x`, the cumulative probability threshold of each row.
+        threshold(Tensor, optional): A 1-D Tensor with the type of `x`, the absolute probability threshold of each row.
+        pre_ids(Tensor, optional): A 2-D Tensor [batch_size, pre_ids_len] with type int64, the tokens
+            penalized in each row, negative ids are padding.
+        top_k(int, optional): the number of candidates of the highest scores, all tokens if not positive. Default: 0.
+        temperature(float, optional): the divisor of the scores. Default: 1.0.
+        repetition_penalty(float, optional): divides the positive logits of `pre_ids` and multiplies the negative ones. Default: 1.0.
+        presence_penalty(float, optional): subtracted from the logits of `pre_ids`. Default: 0.0.
+        is_logits(bool, optional): whether `x` holds logits instead of probabilities. Default: False.
+        seed(int, optional): the random seed.
+        name (str, optional): For details, please refer to :ref:`api_guide_Name`. Generally, no setting is required. Default: None.
+
+    Returns:
+        tuple(Tensor), return the probabilities and indices of the sampled tokens. The probabilities data type is the same as the input `x`. The indices data type is int64.
+
+    Examples:
+
+        .. code-block:: python
+
+            >>> import paddle
+
+            >>> paddle.device.set_device('cpu')
+            >>> x = paddle.to_tensor([[1.0, 3.0, 2.0], [0.5, 0.2, 4.0]])
+            >>> ps = paddle.to_tensor([0.9, 0.9])
+            >>> value, index = paddle.tensor.top_k_top_p_sampling(
+            ...     x, ps, top_k=1, is_logits=True
+            ... )
+            >>> print(index)
+            Tensor(shape=[2, 1], dtype=int64, place=Place(cpu), stop_gradient=True,
+            [[1],
+             [2]])
+    """
+
+    if seed is None:
+        seed = -1
+
+    if in_dynamic_or_pir_mode():
+        return _C_ops.top_k_top_p_sampling(
+            x,
+            ps,
+            threshold,
+            pre_ids,
+            top_k,
+            temperature,
+            repetition_penalty,
+            presence_penalty,
+            is_logits,
+            seed,
+        )
+
+    inputs = {"x": x, "ps": ps, "threshold": threshold, "pre_ids": pre_ids}
+    attrs = {
+        "top_k": top_k,
+        "temperature": temperature,
+        "repetition_penalty": repetition_penalty,
+        "presence_penalty": presence_penalty,
+        "is_logits": is_logits,
+        "seed": seed,
+    }
+
+    helper = LayerHelper('top_k_top_p_sampling', **locals())
+    out = helper.create_variable_for_type_inference(dtype=x.dtype)
+    ids = helper.create_variable_for_type_inference(dtype="int64")
+    helper.append_op(
+        type='top_k_top_p_sampling',
+        inputs=inputs,
+        outputs={'out': out, 'ids': ids},
+        attrs=attrs,
+    )
+    return out, ids
@@ -0,0 +1,225 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/data_feed_text_parser.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+static void CheckFloat(const std::string& text) {
+  char* expect_end = nullptr;
+  char* end = nullptr;
+  float expect = strtof(text.c_str(), &expect_end);
+  float value = text_parser::ParseFloat(text.c_str(), &end);
+  uint32_t expect_bits, bits;
+  memcpy(&expect_bits, &expect, sizeof(float));
+  memcpy(&bits, &value, sizeof(float));
+  if (expect == expect) {
+    EXPECT_EQ(expect_bits, bits) << text;
+  } else {
+    EXPECT_NE(value, value) << text;
+  }
+  EXPECT_EQ(expect_end - text.c_str(), end - text.c_str()) << text;
+}
+
+static void CheckUint64(const std::string& text) {
+  char* expect_end = nullptr;
+  char* end = nullptr;
+  uint64_t expect = strtoull(text.c_str(), &expect_end, 10);
+  uint64_t value = text_parser::ParseUint64(text.c_str(), &end);
+  EXPECT_EQ(expect, value) << text;
+  EXPECT_EQ(expect_end - text.c_str(), end - text.c_str()) << text;
+}
+
+TEST(DataFeedTextParser, float_cases) {
+  const char* cases[] = {
+      "0",         "-0",          "0.0",       "1",          "-1",
+      "1.5",       ".5",          "5.",        "  3.25 7",   "1e10",
+      "1E-5",      "1e",          "1e+",       "2.5e+3x",    "123456789",
+      "0.1",       "0.2",         "0.3",       "3.4028235e38", "3.5e38",
+      "1e-38",     "1e-45",       "1e-50",     "inf",        "-nan",
+      "0x1p3",     "",            " ",         "-",          "abc",
+      "16777217",  "33554435",    "0.000001",  "1.00000005960464477539",
+      "99999999999999999999", "1234567890123456789012", "0.00000000000001",
+      "4.2e22",    "4.2e23",      "000000123.000", "1.17549435e-38",
+      "9007199254740993", "+7.5",  "7.5e0000000000000000001"};
+  for (auto text : cases) {
+    CheckFloat(text);
+  }
+}
+
+TEST(DataFeedTextParser, float_random) {
+  std::mt19937_64 rng(2024);
+  char buf[64];
+  for (int i = 0; i < 200000; ++i) {
+    uint32_t bits = static_cast<uint32_t>(rng());
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    if (f != f) {
+      continue;
+    }
+    // shortest round trip and shorter truncated forms
+    snprintf(buf, sizeof(buf), "%.9g", f);
+    CheckFloat(buf);
+    snprintf(buf, sizeof(buf), "%.*g", static_cast<int>(rng() % 9 + 1), f);
+    CheckFloat(buf);
+    // the fixed notation written by the data generators
+    double d = static_cast<double>(rng() % 2000000) / 1000.0 - 1000.0;
+    snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(rng() % 8), d);
+    CheckFloat(buf);
+  }
+  // midpoints between two floats need the slow path
+  for (int i = 0; i < 10000; ++i) {
+    uint64_t m = (rng() & ((1ULL << 24) - 1)) | (1ULL << 24);
+    m = m * 2 + 1;  // 25 bits, an exact tie at float precision
+    snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(m));
+    CheckFloat(buf);
+  }
+}
+
+TEST(DataFeedTextParser, uint64_cases) {
+  const char* cases[] = {"0",
+                         "1",
+                         "  42 7",
+                         "18446744073709551615",
+                         "18446744073709551616",
+                         "9999999999999999999",
+                         "10000000000000000000",
+                         "-1",
+                         "+5",
+                         "",
+                         "x",
+                         "0000000000000000000000012"};
+  for (auto text : cases) {
+    CheckUint64(text);
+  }
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 100000; ++i) {
+    uint64_t value = rng() >> (rng() % 64);
+    CheckUint64(std::to_string(value));
+  }
+}
+
+TEST(DataFeedTextParser, find_nth_space) {
+  std::mt19937 rng(1);
+  // every alignment, token length and space count
+  std::vector<char> buffer(256);
+  for (int offset = 0; offset < 16; ++offset) {
+    for (int trial = 0; trial < 200; ++trial) {
+      char* line = buffer.data() + offset;
+      int len = static_cast<int>(rng() % 200);
+      for (int i = 0; i < len; ++i) {
+        line[i] = rng() % 4 == 0 ? ' ' : 'a';
+      }
+      line[len] = '\0';
+      for (int n = 0; n < 40; ++n) {
+        const char* expect = n == 0 ? line : nullptr;
+        int count = 0;
+        for (int i = 0; i < len && n > 0; ++i) {
+          if (line[i] == ' ' && ++count == n) {
+            expect = line + i;
+            break;
+          }
+        }
+        EXPECT_EQ(expect, text_parser::FindNthSpace(line, n));
+      }
+    }
+  }
+}
+
+// synthetic slot lines: a click label and a mix of sparse uint64 slots with
+// several feasigns and dense float slots
+static std::string MakeSlotLines(int lines) {
+  std::mt19937_64 rng(3);
+  std::string text;
+  char buf[64];
+  for (int l = 0; l < lines; ++l) {
+    text += "1 ";
+    text += std::to_string(rng() % 2);
+    for (int slot = 0; slot < 100; ++slot) {
+      if (slot % 10 == 0) {
+        text += " 4";
+        for (int i = 0; i < 4; ++i) {
+          snprintf(buf, sizeof(buf), " %.6f", (rng() % 100000) / 1000.0);
+          text += buf;
+        }
+      } else {
+        int num = static_cast<int>(rng() % 3 + 1);
+        text += " " + std::to_string(num);
+        for (int i = 0; i < num; ++i) {
+          text += " " + std::to_string(rng() >> 1);
+        }
+      }
+    }
+    text += '\n';
+  }
+  return text;
+}
+
+template <typename FloatFunc, typename Uint64Func>
+static double ParseSlotLines(const std::string& text,
+                             FloatFunc parse_float,
+                             Uint64Func parse_uint64,
+                             double* checksum) {
+  auto begin = std::chrono::steady_clock::now();
+  const char* str = text.c_str();
+  char* endptr = const_cast<char*>(str);
+  double sum = 0;
+  while (*endptr != '\0') {
+    for (int slot = 0; slot < 101; ++slot) {
+      int num = static_cast<int>(strtol(endptr, &endptr, 10));
+      if (slot % 10 == 1) {
+        for (int i = 0; i < num; ++i) {
+          sum += parse_float(endptr, &endptr);
+        }
+      } else {
+        for (int i = 0; i < num; ++i) {
+          sum += static_cast<double>(parse_uint64(endptr, &endptr) & 0xFF);
+        }
+      }
+    }
+    ++endptr;  // '\n'
+  }
+  *checksum = sum;
+  std::chrono::duration<double> cost = std::chrono::steady_clock::now() - begin;
+  return text.size() / cost.count() / 1024 / 1024;
+}
+
+TEST(DataFeedTextParser, benchmark) {
+  std::string text = MakeSlotLines(2000);
+  double fast_sum = 0;
+  double libc_sum = 0;
+  double fast = ParseSlotLines(
+      text, text_parser::ParseFloat, text_parser::ParseUint64, &fast_sum);
+  double libc = ParseSlotLines(
+      text,
+      [](const char* str, char** endptr) { return strtof(str, endptr); },
+      [](const char* str, char** endptr) { return strtoull(str, endptr, 10); },
+      &libc_sum);
+  EXPECT_EQ(fast_sum, libc_sum);
+  LOG(INFO) << "parse " << text.size() / 1024 / 1024 << "MB slot lines, "
+            << fast << " MB/s vs strtof/strtoull " << libc << " MB/s";
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,191 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/data_set.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/framework/io/fs.h"
+
+COMMON_DECLARE_string(dataset_shuffle_spill_dir);
+COMMON_DECLARE_int64(dataset_shuffle_memory_mb);
+
+namespace paddle {
+namespace framework {
+
+struct TextRecord {
+  std::vector<uint64_t> uint64_values;
+  std::vector<float> float_values;
+};
+
+// slot "show" is not used, it has to be skipped by the parser
+static std::string SlotDataFeedDesc(const std::string& name) {
+  std::string str;
+  str += "name: \"" + name + "\"\nbatch_size: 2\npipe_command: \"cat\"\n";
+  str += "multi_slot_desc {\n";
+  str += "slots {\nname: \"words\"\ntype: \"uint64\"\nis_dense: false\n";
+  str += "is_used: true\n}\n";
+  str += "slots {\nname: \"show\"\ntype: \"uint64\"\nis_dense: false\n";
+  str += "is_used: false\n}\n";
+  str += "slots {\nname: \"ctr\"\ntype: \"float\"\nis_dense: false\n";
+  str += "is_used: true\n}\n}\n";
+  return str;
+}
+
+// write `num` records with ins ids from `begin` to a text file
+static void WriteTextFile(const std::string& path,
+                          int begin,
+                          int num,
+                          std::map<std::string, TextRecord>* records) {
+  std::ofstream out(path);
+  for (int i = begin; i < begin + num; ++i) {
+    std::string ins_id = "ins_" + std::to_string(i);
+    TextRecord& rec = (*records)[ins_id];
+    for (int j = 0; j <= i % 3; ++j) {
+      rec.uint64_values.push_back(1000 * i + j);
+    }
+    rec.float_values.push_back(0.5f + static_cast<float>(i));
+    out << "1 " << ins_id << " " << rec.uint64_values.size();
+    for (auto value : rec.uint64_values) {
+      out << " " << value;
+    }
+    out << " 1 7 " << rec.float_values.size();
+    for (auto value : rec.float_values) {
+      out << " " << value;
+    }
+    out << "\n";
+  }
+}
+
+// every record of the dataset has to match one of `records`, and all of
+// them have to be there
+static void CheckRecords(SlotRecordDataset* dataset,
+                         std::map<std::string, TextRecord> records) {
+  std::vector<SlotRecord> loaded;
+  dataset->GetInputChannel()->ReadAll(loaded);
+  ASSERT_EQ(loaded.size(), records.size());
+  for (auto* rec : loaded) {
+    auto it = records.find(rec->ins_id_);
+    ASSERT_TRUE(it != records.end()) << rec->ins_id_;
+    size_t num = 0;
+    uint64_t* uint64_values = rec->slot_uint64_feasigns_.get_values(0, &num);
+    ASSERT_EQ(std::vector<uint64_t>(uint64_values, uint64_values + num),
+              it->second.uint64_values);
+    float* float_values = rec->slot_float_feasigns_.get_values(0, &num);
+    ASSERT_EQ(num, it->second.float_values.size());
+    for (size_t i = 0; i < num; ++i) {
+      ASSERT_FLOAT_EQ(float_values[i], it->second.float_values[i]);
+    }
+    records.erase(it);
+  }
+  ASSERT_TRUE(records.empty());
+  SlotRecordPool().put(&loaded);
+}
+
+static std::shared_ptr<SlotRecordDataset> LoadTextDataset(
+    const std::vector<std::string>& files) {
+  auto dataset = std::make_shared<SlotRecordDataset>();
+  dataset->SetFileList(files);
+  dataset->SetThreadNum(2);
+  dataset->SetParseInsId(true);
+  dataset->SetDataFeedDesc(SlotDataFeedDesc("SlotRecordInMemoryDataFeed"));
+  dataset->CreateChannel();
+  dataset->CreateReaders();
+  dataset->LoadIntoMemory();
+  return dataset;
+}
+
+TEST(SlotRecordDataset, ConvertToBinaryFilesRoundTrip) {
+#ifdef _LINUX
+  std::map<std::string, TextRecord> records;
+  WriteTextFile("./data_set_test_a.txt", 0, 5, &records);
+  WriteTextFile("./data_set_test_b.txt", 5, 4, &records);
+  const std::string desc = SlotDataFeedDesc("SlotRecordBinaryInMemoryDataFeed");
+
+  auto converter = std::make_shared<SlotRecordDataset>();
+  converter->SetFileList({"./data_set_test_a.txt", "./data_set_test_b.txt"});
+  converter->SetThreadNum(2);
+  converter->SetParseInsId(true);
+  converter->SetDataFeedDesc(desc);
+  auto binary_files = converter->ConvertToBinaryFiles("./data_set_test_bin");
+  ASSERT_EQ(binary_files.size(), 2u);
+
+  auto dataset = std::make_shared<SlotRecordDataset>();
+  dataset->SetFileList(binary_files);
+  dataset->SetThreadNum(2);
+  dataset->SetParseInsId(true);
+  dataset->SetDataFeedDesc(desc);
+  dataset->CreateChannel();
+  dataset->CreateReaders();
+  dataset->LoadIntoMemory();
+  ASSERT_EQ(dataset->GetMemoryDataSize(), 9);
+
+  CheckRecords(dataset.get(), records);
+#endif
+}
+
+TEST(SlotRecordDataset, ConvertToBinaryFilesNeedsBinaryFeed) {
+  auto dataset = std::make_shared<SlotRecordDataset>();
+  dataset->SetFileList({"./data_set_test_a.txt"});
+  dataset->SetThreadNum(1);
+  dataset->SetDataFeedDesc(SlotDataFeedDesc("SlotRecordInMemoryDataFeed"));
+  ASSERT_ANY_THROW(dataset->ConvertToBinaryFiles("./data_set_test_bin"));
+}
+
+TEST(SlotRecordDataset, ExternalShuffleRoundTrip) {
+#ifdef _LINUX
+  std::map<std::string, TextRecord> records;
+  WriteTextFile("./data_set_test_c.txt", 0, 200, &records);
+  WriteTextFile("./data_set_test_d.txt", 200, 100, &records);
+  auto dataset =
+      LoadTextDataset({"./data_set_test_c.txt", "./data_set_test_d.txt"});
+  ASSERT_EQ(dataset->GetMemoryDataSize(), 300);
+
+  FLAGS_dataset_shuffle_spill_dir = "./data_set_test_spill";
+  FLAGS_dataset_shuffle_memory_mb = 16;
+  dataset->LocalShuffle();
+  FLAGS_dataset_shuffle_spill_dir = "";
+  CheckRecords(dataset.get(), records);
+  // all bucket files are removed once they are loaded
+  ASSERT_TRUE(localfs_list("./data_set_test_spill").empty());
+#endif
+}
+
+TEST(SlotRecordDataset, ExternalShuffleMemoryBound) {
+#ifdef _LINUX
+  std::map<std::string, TextRecord> records;
+  WriteTextFile("./data_set_test_e.txt", 0, 50, &records);
+  auto dataset = LoadTextDataset({"./data_set_test_e.txt"});
+
+  // 1MB can not hold a 4KB spill buffer per thread
+  dataset->SetThreadNum(200);
+  FLAGS_dataset_shuffle_spill_dir = "./data_set_test_spill_bound";
+  FLAGS_dataset_shuffle_memory_mb = 1;
+  ASSERT_ANY_THROW(dataset->LocalShuffle());
+  FLAGS_dataset_shuffle_spill_dir = "";
+  FLAGS_dataset_shuffle_memory_mb = 1024;
+  // the refused shuffle keeps the records
+  CheckRecords(dataset.get(), records);
+  ASSERT_TRUE(localfs_list("./data_set_test_spill_bound").empty());
+#endif
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,127 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/garbage_collector/fast_garbage_collector.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/framework/variable.h"
+#include "paddle/fluid/platform/enforce.h"
+
+COMMON_DECLARE_double(eager_delete_tensor_gb);
+
+namespace paddle {
+namespace framework {
+
+// variables holding a small tensor each, and the memory of the tensors
+static void MakeVariables(
+    size_t num,
+    std::vector<std::unique_ptr<Variable>>* vars,
+    std::vector<std::weak_ptr<phi::Allocation>>* holders) {
+  for (size_t i = 0; i < num; ++i) {
+    vars->emplace_back(new Variable());
+    auto* tensor = vars->back()->GetMutable<phi::DenseTensor>();
+    tensor->Resize({16});
+    tensor->mutable_data<float>(phi::CPUPlace());
+    holders->emplace_back(tensor->Holder());
+  }
+}
+
+static size_t NumReleased(
+    const std::vector<std::weak_ptr<phi::Allocation>>& holders) {
+  size_t num = 0;
+  for (auto& holder : holders) {
+    num += holder.expired() ? 1 : 0;
+  }
+  return num;
+}
+
+TEST(InterpreterCoreGarbageCollector, BatchedReleaseAtBatchSize) {
+  FLAGS_new_executor_gc_batch_size = 4;
+  InterpreterCoreFastGarbageCollector gc;
+  FLAGS_new_executor_gc_batch_size = 0;
+  ASSERT_TRUE(gc.IsBatched());
+
+  std::vector<std::unique_ptr<Variable>> vars;
+  std::vector<std::weak_ptr<phi::Allocation>> holders;
+  MakeVariables(6, &vars, &holders);
+  for (size_t i = 0; i < 3; ++i) {
+    gc.Add(vars[i].get(), nullptr);
+  }
+  // kept until the batch is full
+  EXPECT_EQ(NumReleased(holders), 0UL);
+  gc.Add(vars[3].get(), nullptr);
+  EXPECT_EQ(NumReleased(holders), 4UL);
+
+  // the partial batch is released at the end of the run
+  gc.Add(vars[4].get(), nullptr);
+  gc.Add(vars[5].get(), nullptr);
+  EXPECT_EQ(NumReleased(holders), 4UL);
+  gc.FlushAll();
+  EXPECT_EQ(NumReleased(holders), 6UL);
+
+  auto stats = gc.GetStats();
+  EXPECT_EQ(stats.num_garbages, 6);
+  EXPECT_EQ(stats.num_batches, 2);
+}
+
+TEST(InterpreterCoreGarbageCollector, BatchedReleaseAfterException) {
+  FLAGS_new_executor_gc_batch_size = 4;
+  InterpreterCoreFastGarbageCollector gc;
+  FLAGS_new_executor_gc_batch_size = 0;
+
+  std::vector<std::unique_ptr<Variable>> vars;
+  std::vector<std::weak_ptr<phi::Allocation>> holders;
+  MakeVariables(2, &vars, &holders);
+  try {
+    // as in the run of an interpreter that fails half way
+    GarbageFlushGuard flush_guard(&gc);
+    gc.Add(vars[0].get(), nullptr);
+    gc.Add(vars[1].get(), nullptr);
+    EXPECT_EQ(NumReleased(holders), 0UL);
+    PADDLE_THROW(phi::errors::Fatal("the run failed"));
+  } catch (const std::exception&) {
+  }
+  EXPECT_EQ(NumReleased(holders), 2UL);
+}
+
+TEST(InterpreterCoreGarbageCollector, BatchedLockOncePerBatch) {
+  // the garbage is queued under the lock of the collector
+  double eager_delete_tensor_gb = FLAGS_eager_delete_tensor_gb;
+  FLAGS_eager_delete_tensor_gb = 1.0;
+  InterpreterCoreFastGarbageCollector gc;
+  FLAGS_new_executor_gc_batch_size = 4;
+  InterpreterCoreFastGarbageCollector batched_gc;
+  FLAGS_new_executor_gc_batch_size = 0;
+  FLAGS_eager_delete_tensor_gb = eager_delete_tensor_gb;
+
+  std::vector<std::unique_ptr<Variable>> vars;
+  std::vector<std::weak_ptr<phi::Allocation>> holders;
+  MakeVariables(16, &vars, &holders);
+  for (size_t i = 0; i < 8; ++i) {
+    gc.Add(vars[i].get(), nullptr);
+    batched_gc.Add(vars[8 + i].get(), nullptr);
+  }
+  EXPECT_EQ(gc.GetStats().num_lock_acquires, 8);
+  EXPECT_EQ(batched_gc.GetStats().num_lock_acquires, 2);
+  // a single thread never waits
+  EXPECT_EQ(gc.GetStats().num_lock_contentions, 0);
+  EXPECT_EQ(batched_gc.GetStats().num_lock_contentions, 0);
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -14,12 +14,21 @@
 
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue.h"
 
+#include <sched.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 #include <atomic>
 #include <thread>
+#include <vector>
 
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "paddle/fluid/framework/new_executor/workqueue/workqueue_utils.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
 
 TEST(WorkQueueUtils, TestEventsWaiter) {
   using paddle::framework::EventsWaiter;
@@ -192,6 +201,9 @@ TEST(WorkQueue, TestWorkQueueGroup) {
   events_waiter.WaitEvent();
   EXPECT_EQ(counter.load(), kLoopNum * kExternalLoopNum + kLoopNum);
   EXPECT_EQ(handle.get(), random_num);
+  // no scheduler statistics without collect_stats
+  EXPECT_EQ(queue_group->QueueStats(1).num_tasks, 0u);
+  EXPECT_EQ(queue_group->QueueStats(1).num_pushes, 0u);
   // Cancel
   queue_group->Cancel();
   // Wait kQueueDestructEvent
@@ -203,3 +215,140 @@ TEST(WorkQueue, TestWorkQueueGroup) {
   queue_group.reset();
   waiter_thread.join();
 }
+
+TEST(WorkQueue, TestWorkStealing) {
+  using paddle::framework::CreateWorkQueueGroup;
+  using paddle::framework::EventsWaiter;
+  using paddle::framework::SchedulerStats;
+  using paddle::framework::WorkQueueGroup;
+  using paddle::framework::WorkQueueOptions;
+  EventsWaiter events_waiter;
+  std::vector<WorkQueueOptions> group_options;
+  for (size_t num_threads : {4u, 1u}) {
+    group_options.emplace_back(/*name*/ "WorkStealingQueueForTesting",
+                               num_threads,
+                               /*allow_spinning*/ true,
+                               /*always_spinning*/ false,
+                               /*track_task*/ true,
+                               /*detached*/ true,
+                               &events_waiter);
+    group_options.back().work_stealing = true;
+    group_options.back().collect_stats = true;
+  }
+  auto queue_group = CreateWorkQueueGroup(group_options);
+  // Every task of the first 10 levels adds 3 children at once from a worker
+  // thread, which are stolen by the others.
+  constexpr int kDepth = 10;
+  std::atomic<unsigned> counter{0};
+  std::function<void(int)> expand;
+  expand = [&](int depth) {
+    ++counter;
+    if (depth == kDepth) {
+      return;
+    }
+    std::vector<std::function<void()>> children;
+    for (int i = 0; i < 3; ++i) {
+      children.emplace_back([&expand, depth]() { expand(depth + 1); });
+    }
+    queue_group->AddTasks(0, &children);
+    EXPECT_TRUE(children.empty());
+  };
+  std::vector<std::function<void()>> roots;
+  for (int i = 0; i < 8; ++i) {
+    roots.emplace_back([&expand]() { expand(1); });
+  }
+  queue_group->AddTasks(0, &roots);
+  events_waiter.WaitEvent();
+  unsigned num_tasks = 8 * (59049 - 1) / 2;  // 8 * (3^0 + ... + 3^9)
+  EXPECT_EQ(counter.load(), num_tasks);
+
+  SchedulerStats stats = queue_group->QueueStats(0);
+  EXPECT_EQ(stats.num_tasks, num_tasks);
+  EXPECT_EQ(stats.num_pushes, num_tasks);
+  EXPECT_GE(stats.max_queue_depth, 1u);
+  EXPECT_GE(stats.total_queue_depth, stats.num_pushes);
+  EXPECT_LE(stats.num_steals, stats.num_tasks);
+  EXPECT_EQ(queue_group->QueueStats(1).num_tasks, 0u);
+  VLOG(1) << stats.ToString();
+}
+
+#ifdef __linux__
+TEST(WorkQueue, TestNumaNodePinning) {
+  using paddle::framework::CreateSingleThreadedWorkQueue;
+  using paddle::framework::WorkQueueOptions;
+  const auto& nodes = phi::backends::cpu::CpuNumaNodes();
+  ASSERT_FALSE(nodes.empty());
+  const auto& node = nodes.back();
+  WorkQueueOptions options(/*name*/ "NumaNodeQueueForTesting",
+                           /*num_threads*/ 1,
+                           /*allow_spinning*/ true,
+                           /*track_task*/ false);
+  options.numa_node = node.id;
+  auto work_queue = CreateSingleThreadedWorkQueue(options);
+  auto cpu = work_queue->AddAwaitableTask([]() { return sched_getcpu(); });
+  EXPECT_NE(std::find(node.cpus.begin(), node.cpus.end(), cpu.get()),
+            node.cpus.end());
+}
+
+static std::vector<int> CurrentThreadCpus() {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  EXPECT_EQ(sched_getaffinity(0, sizeof(mask), &mask), 0);
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &mask)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+TEST(WorkQueue, TestScopedNumaNodeBindingRestores) {
+  const auto& nodes = phi::backends::cpu::CpuNumaNodes();
+  ASSERT_FALSE(nodes.empty());
+  // a thread of its own, the binding of the test thread is left alone
+  std::thread([&nodes]() {
+    // MPOL_INTERLEAVE over all nodes, which the binding has to give back
+    // instead of the default policy
+    constexpr int kBitsPerLong = sizeof(unsigned long) * 8;  // NOLINT
+    constexpr int kInterleave = 3;
+    std::vector<unsigned long> nodemask(1024 / kBitsPerLong, 0);  // NOLINT
+    for (const auto& node : nodes) {
+      nodemask[node.id / kBitsPerLong] |= 1UL << (node.id % kBitsPerLong);
+    }
+    bool multi_node = nodes.size() > 1;
+    if (multi_node) {
+      ASSERT_EQ(syscall(SYS_set_mempolicy,
+                        kInterleave,
+                        nodemask.data(),
+                        nodemask.size() * kBitsPerLong + 1),
+                0);
+    }
+    auto cpus = CurrentThreadCpus();
+    {
+      phi::backends::cpu::ScopedNumaNodeBinding binding(nodes.back().id);
+      auto bound_cpus = CurrentThreadCpus();
+      for (int cpu : bound_cpus) {
+        EXPECT_NE(std::find(nodes.back().cpus.begin(),
+                            nodes.back().cpus.end(),
+                            cpu),
+                  nodes.back().cpus.end());
+      }
+    }
+    EXPECT_EQ(CurrentThreadCpus(), cpus);
+    if (multi_node) {
+      int mode = -1;
+      std::vector<unsigned long> restored(nodemask.size(), 0);  // NOLINT
+      ASSERT_EQ(syscall(SYS_get_mempolicy,
+                        &mode,
+                        restored.data(),
+                        restored.size() * kBitsPerLong,
+                        nullptr,
+                        0),
+                0);
+      EXPECT_EQ(mode, kInterleave);
+      EXPECT_EQ(restored, nodemask);
+    }
+  }).join();
+}
+#endif
@@ -0,0 +1,231 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/slot_record_binary_file.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+struct TestRecord {
+  uint64_t search_id;
+  uint32_t rank;
+  uint32_t cmatch;
+  std::string ins_id;
+  std::vector<uint64_t> uint64_values;
+  std::vector<uint32_t> uint64_offsets;
+  std::vector<float> float_values;
+  std::vector<uint32_t> float_offsets;
+};
+
+template <typename T>
+static void RandomSlots(std::mt19937_64* rng,
+                        int slot_num,
+                        std::vector<T>* values,
+                        std::vector<uint32_t>* offsets) {
+  // a few unused leading values, offsets do not have to start at 0
+  int skip = static_cast<int>((*rng)() % 3);
+  values->assign(skip, T(0));
+  offsets->assign(1, skip);
+  for (int s = 0; s < slot_num; ++s) {
+    int num = static_cast<int>((*rng)() % 4);
+    for (int i = 0; i < num; ++i) {
+      values->push_back(static_cast<T>((*rng)() % 100000));
+    }
+    offsets->push_back(values->size());
+  }
+}
+
+static std::vector<TestRecord> MakeRecords(int num,
+                                           int uint64_slot_num,
+                                           int float_slot_num) {
+  std::mt19937_64 rng(5);
+  std::vector<TestRecord> records(num);
+  for (int i = 0; i < num; ++i) {
+    auto& rec = records[i];
+    rec.search_id = rng();
+    rec.rank = static_cast<uint32_t>(rng());
+    rec.cmatch = static_cast<uint32_t>(rng());
+    rec.ins_id = std::string(rng() % 20, 'a' + i % 26);
+    RandomSlots(&rng, uint64_slot_num, &rec.uint64_values, &rec.uint64_offsets);
+    RandomSlots(&rng, float_slot_num, &rec.float_values, &rec.float_offsets);
+  }
+  return records;
+}
+
+template <typename T>
+static void CheckSlots(const T* values,
+                       const uint32_t* offsets,
+                       const std::vector<T>& expect_values,
+                       const std::vector<uint32_t>& expect_offsets) {
+  for (size_t s = 0; s + 1 < expect_offsets.size(); ++s) {
+    ASSERT_EQ(offsets[s + 1] - offsets[s],
+              expect_offsets[s + 1] - expect_offsets[s]);
+    for (uint32_t i = 0; i < offsets[s + 1] - offsets[s]; ++i) {
+      EXPECT_EQ(values[offsets[s] + i], expect_values[expect_offsets[s] + i]);
+    }
+  }
+}
+
+static int WriteRecords(const std::string& path,
+                        const std::vector<TestRecord>& records,
+                        int uint64_slot_num,
+                        int float_slot_num) {
+  SlotBinaryFileWriter writer;
+  if (writer.Open(path, uint64_slot_num, float_slot_num, 0x1234, 64) != 0) {
+    return -1;
+  }
+  for (auto& rec : records) {
+    SlotBinaryRecordView view;
+    view.search_id = rec.search_id;
+    view.rank = rec.rank;
+    view.cmatch = rec.cmatch;
+    view.ins_id = rec.ins_id.data();
+    view.ins_id_len = rec.ins_id.size();
+    view.uint64_values = rec.uint64_values.data();
+    view.uint64_offsets = rec.uint64_offsets.data();
+    view.float_values = rec.float_values.data();
+    view.float_offsets = rec.float_offsets.data();
+    writer.Append(view);
+  }
+  return writer.Close();
+}
+
+TEST(SlotRecordBinaryFile, write_and_map) {
+  const int uint64_slot_num = 7;
+  const int float_slot_num = 2;
+  std::string path = "slot_record_binary_file_test.bin";
+  for (int num : {0, 1, 100, 1000}) {
+    auto records = MakeRecords(num, uint64_slot_num, float_slot_num);
+    ASSERT_EQ(WriteRecords(path, records, uint64_slot_num, float_slot_num),
+              0);
+
+    MappedSlotBinaryFile file;
+    ASSERT_EQ(file.Open(path), 0);
+    ASSERT_EQ(file.record_num(), static_cast<uint64_t>(num));
+    ASSERT_EQ(file.block_num(), static_cast<uint64_t>((num + 63) / 64));
+    ASSERT_EQ(file.slot_signature(), 0x1234ULL);
+    ASSERT_EQ(file.uint64_slot_num(), static_cast<uint32_t>(uint64_slot_num));
+    ASSERT_EQ(file.float_slot_num(), static_cast<uint32_t>(float_slot_num));
+    int idx = 0;
+    MappedSlotBinaryFile::Block block;
+    SlotBinaryRecordView view;
+    for (uint64_t b = 0; b < file.block_num(); ++b) {
+      ASSERT_EQ(file.GetBlock(b, &block), 0);
+      ASSERT_EQ(block.record_num(), file.block_record_num(b));
+      for (uint32_t i = 0; i < block.record_num(); ++i, ++idx) {
+        auto& rec = records[idx];
+        block.GetRecord(i, &view);
+        EXPECT_EQ(view.search_id, rec.search_id);
+        EXPECT_EQ(view.rank, rec.rank);
+        EXPECT_EQ(view.cmatch, rec.cmatch);
+        EXPECT_EQ(std::string(view.ins_id, view.ins_id_len), rec.ins_id);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(view.uint64_values) % 8, 0u);
+        CheckSlots(view.uint64_values,
+                   view.uint64_offsets,
+                   rec.uint64_values,
+                   rec.uint64_offsets);
+        CheckSlots(view.float_values,
+                   view.float_offsets,
+                   rec.float_values,
+                   rec.float_offsets);
+      }
+    }
+    EXPECT_EQ(idx, num);
+  }
+  remove(path.c_str());
+}
+
+TEST(SlotRecordBinaryFile, reject_bad_files) {
+  std::string path = "slot_record_binary_file_bad.bin";
+  FILE* fp = fopen(path.c_str(), "wb");
+  ASSERT_NE(fp, nullptr);
+  std::string text = "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 "
+                     "22 23 24 25 26 27 28 29 30";
+  fwrite(text.data(), 1, text.size(), fp);
+  fclose(fp);
+  MappedSlotBinaryFile file;
+  EXPECT_EQ(file.Open(path), -1);
+  EXPECT_EQ(file.Open(path + ".missing"), -1);
+  remove(path.c_str());
+}
+
+// overwrite the uint32 at offset of the file
+static void PatchFile(const std::string& path, uint64_t offset, uint32_t v) {
+  FILE* fp = fopen(path.c_str(), "r+b");
+  ASSERT_NE(fp, nullptr);
+  ASSERT_EQ(fseek(fp, offset, SEEK_SET), 0);
+  ASSERT_EQ(fwrite(&v, sizeof(v), 1, fp), 1u);
+  fclose(fp);
+}
+
+TEST(SlotRecordBinaryFile, reject_corrupt_records) {
+  const int uint64_slot_num = 3;
+  const int float_slot_num = 1;
+  std::string path = "slot_record_binary_file_corrupt.bin";
+  auto records = MakeRecords(100, uint64_slot_num, float_slot_num);
+  ASSERT_EQ(WriteRecords(path, records, uint64_slot_num, float_slot_num), 0);
+  SlotBinaryHeader header;
+  SlotBinaryBlockHeader block_header;
+  {
+    FILE* fp = fopen(path.c_str(), "rb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(fread(&header, sizeof(header), 1, fp), 1u);
+    ASSERT_EQ(fread(&block_header, sizeof(block_header), 1, fp), 1u);
+    fclose(fp);
+  }
+  // the first block follows the header
+  SlotBinaryBlockLayout layout(block_header, uint64_slot_num, float_slot_num);
+  const uint64_t block = sizeof(SlotBinaryHeader);
+  MappedSlotBinaryFile file;
+  MappedSlotBinaryFile::Block view;
+
+  // the end of the ins_id of record 5 past the ins_id bytes
+  ASSERT_EQ(file.Open(path), 0);
+  ASSERT_EQ(file.GetBlock(0, &view), 0);
+  file.Close();
+  PatchFile(path, block + layout.ins_id_offsets + 6 * 4, 1u << 30);
+  ASSERT_EQ(file.Open(path), 0);
+  EXPECT_EQ(file.GetBlock(0, &view), -1);
+  EXPECT_EQ(file.GetBlock(1, &view), 0);
+  file.Close();
+
+  // the uint64 values of record 2 past the ones of the block
+  ASSERT_EQ(WriteRecords(path, records, uint64_slot_num, float_slot_num), 0);
+  PatchFile(path, block + layout.uint64_offsets + 7 * 4, 0xffffffffu);
+  ASSERT_EQ(file.Open(path), 0);
+  EXPECT_EQ(file.GetBlock(0, &view), -1);
+  file.Close();
+
+  // a file cut in the middle of its blocks loses its index
+  ASSERT_EQ(WriteRecords(path, records, uint64_slot_num, float_slot_num), 0);
+  ASSERT_EQ(truncate(path.c_str(), header.index_offset / 2), 0);
+  EXPECT_EQ(file.Open(path), -1);
+
+  // a block index pointing past the blocks
+  ASSERT_EQ(WriteRecords(path, records, uint64_slot_num, float_slot_num), 0);
+  PatchFile(path,
+            header.index_offset + sizeof(SlotBinaryBlockIndex),
+            static_cast<uint32_t>(header.index_offset));
+  EXPECT_EQ(file.Open(path), -1);
+  remove(path.c_str());
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -16,6 +16,10 @@
 
 #include "paddle/fluid/memory/allocation/mmap_allocator.h"
 
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace paddle {
@@ -46,6 +50,32 @@ TEST(MemoryMapAllocation, test_allocation_base) {
   }
 }
 
+TEST(MemoryMapAllocation, test_mapped_file) {
+  std::string file_name = "mapped_file_test.bin";
+  std::vector<int32_t> data(1024);
+  for (int32_t i = 0; i < 1024; ++i) {
+    data[i] = i;
+  }
+  {
+    std::ofstream fout(file_name, std::ios::binary);
+    fout.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size() * sizeof(int32_t)));
+  }
+  {
+    auto mapping = AllocateMappedFileAllocation(file_name);
+    ASSERT_EQ(mapping->size(), data.size() * sizeof(int32_t));
+    auto* ptr = static_cast<int32_t*>(mapping->ptr());
+    for (int32_t i = 0; i < 1024; ++i) {
+      ASSERT_EQ(ptr[i], i);
+    }
+    // the mapping is private, the file keeps its content
+    ptr[0] = -1;
+    auto other = AllocateMappedFileAllocation(file_name);
+    EXPECT_EQ(static_cast<int32_t*>(other->ptr())[0], 0);
+  }
+  std::remove(file_name.c_str());
+}
+
 }  // namespace allocation
 }  // namespace memory
 }  // namespace paddle
@@ -0,0 +1,271 @@
+// Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/pooled_cpu_allocator.h"
+
+#include <chrono>   // NOLINT
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/common/flags.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/memory/stats.h"
+
+PD_DEFINE_string(alloc_trace_file,
+                 "",
+                 "An allocation trace to replay in the benchmark, one event "
+                 "per line, 'a <var> <bytes>' or 'f <var>'.");
+PD_DEFINE_int32(alloc_trace_repeat, 20, "Times to replay the trace.");
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(PooledCPUAllocator, size_class) {
+  size_t last_bytes = 0;
+  for (size_t index = 0; index < PooledCPUAllocator::kNumSizeClasses;
+       ++index) {
+    size_t bytes = PooledCPUAllocator::SizeClassBytes(index);
+    EXPECT_GT(bytes, last_bytes);
+    EXPECT_EQ(PooledCPUAllocator::SizeClassIndex(bytes), index);
+    EXPECT_EQ(PooledCPUAllocator::SizeClassIndex(last_bytes + 1), index);
+    last_bytes = bytes;
+  }
+  EXPECT_EQ(last_bytes, PooledCPUAllocator::kMaxPooledSize);
+
+  std::mt19937 engine(0);
+  for (int i = 0; i < 10000; ++i) {
+    size_t size = engine() % PooledCPUAllocator::kMaxPooledSize + 1;
+    size_t bytes = PooledCPUAllocator::SizeClassBytes(
+        PooledCPUAllocator::SizeClassIndex(size));
+    EXPECT_GE(bytes, size);
+    EXPECT_LE(bytes, std::max<size_t>(size + size / 4, 64));
+  }
+}
+
+TEST(PooledCPUAllocator, reuse) {
+  PooledCPUAllocator allocator(PooledCPUAllocator::Options{});
+  void* first = nullptr;
+  for (size_t size : {100UL, 4000UL, 1UL << 20, 3UL << 20}) {
+    for (int i = 0; i < 10; ++i) {
+      auto allocation = allocator.Allocate(size);
+      ASSERT_NE(allocation->ptr(), nullptr);
+      EXPECT_EQ(allocation->size(), size);
+      EXPECT_TRUE(platform::is_cpu_place(allocation->place()));
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(allocation->ptr()) % 64, 0UL);
+      memset(allocation->ptr(), 0xFF, size);
+      if (i == 0) {
+        first = allocation->ptr();
+      } else {
+        EXPECT_EQ(allocation->ptr(), first);
+      }
+    }
+  }
+  EXPECT_EQ(allocator.GetStats().system_alloc_count, 4UL);
+  EXPECT_EQ(allocator.GetStats().system_free_count, 0UL);
+}
+
+TEST(PooledCPUAllocator, release_to_os_watermark) {
+  PooledCPUAllocator::Options options;
+  options.max_cached_bytes = 4UL << 20;
+  PooledCPUAllocator allocator(options);
+  // 1MB is beyond the thread caches, all frees go to the central lists
+  std::vector<AllocationPtr> allocations;
+  for (int i = 0; i < 16; ++i) {
+    allocations.emplace_back(allocator.Allocate(1UL << 20));
+  }
+  EXPECT_EQ(allocator.GetStats().reserved_bytes, 16UL << 20);
+  allocations.clear();
+  auto stats = allocator.GetStats();
+  EXPECT_LE(stats.central_cached_bytes, options.max_cached_bytes);
+  EXPECT_EQ(stats.reserved_bytes, stats.central_cached_bytes);
+  EXPECT_GT(stats.system_free_count, 0UL);
+
+  // larger than kMaxPooledSize goes straight back
+  size_t huge_size = PooledCPUAllocator::kMaxPooledSize + 1;
+  allocator.Allocate(huge_size);
+  EXPECT_EQ(allocator.GetStats().reserved_bytes, stats.reserved_bytes);
+
+  EXPECT_EQ(allocator.Release(platform::CPUPlace()), stats.reserved_bytes);
+  EXPECT_EQ(allocator.GetStats().reserved_bytes, 0UL);
+}
+
+TEST(PooledCPUAllocator, multi_thread) {
+  PooledCPUAllocator allocator(PooledCPUAllocator::Options{});
+  int64_t cached_before = HOST_MEMORY_STAT_CURRENT_VALUE(Cached, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&allocator, t] {
+      std::mt19937 engine(t);
+      std::vector<AllocationPtr> live(32);
+      for (int i = 0; i < 20000; ++i) {
+        auto& slot = live[engine() % live.size()];
+        size_t size = 1UL << (engine() % 20);
+        slot = allocator.Allocate(size);
+        memset(slot->ptr(), t, size);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // the exited threads gave all blocks back to the central lists
+  auto stats = allocator.GetStats();
+  EXPECT_EQ(stats.reserved_bytes, stats.central_cached_bytes);
+  int64_t cached = HOST_MEMORY_STAT_CURRENT_VALUE(Cached, 0);
+  EXPECT_EQ(cached - cached_before,
+            static_cast<int64_t>(stats.central_cached_bytes));
+  allocator.Release(platform::CPUPlace());
+  cached = HOST_MEMORY_STAT_CURRENT_VALUE(Cached, 0);
+  EXPECT_EQ(cached, cached_before);
+}
+
+// The benchmark replays the allocations of an executor running the same
+// program again and again: every op allocates its outputs and the garbage
+// collector frees a variable after its last reader.
+struct AllocEvent {
+  bool alloc;
+  size_t var;
+  size_t bytes;
+};
+
+static std::vector<AllocEvent> LoadTrace(const std::string& path) {
+  std::vector<AllocEvent> trace;
+  std::ifstream fin(path);
+  std::string type;
+  size_t var = 0;
+  while (fin >> type >> var) {
+    AllocEvent event{type == "a", var, 0};
+    if (event.alloc) {
+      fin >> event.bytes;
+    }
+    trace.push_back(event);
+  }
+  return trace;
+}
+
+// A transformer like program, per layer an attention and a ffn block, with
+// the small shape and index tensors the pir kernels produce in between. The
+// sequence length changes from run to run.
+static std::vector<AllocEvent> MakeInterpreterCoreTrace() {
+  const size_t hidden = 768;
+  const std::vector<size_t> seq_lens = {128, 96, 128, 64};
+  std::vector<AllocEvent> trace;
+  size_t var = 0;
+  for (size_t seq_len : seq_lens) {
+    size_t act = seq_len * hidden * sizeof(float);
+    size_t x = var++;
+    trace.push_back({true, x, act});
+    for (int layer = 0; layer < 12; ++layer) {
+      auto op = [&](size_t bytes) {
+        trace.push_back({true, var, bytes});
+        return var++;
+      };
+      size_t shape = op(4 * sizeof(int64_t));
+      size_t qkv = op(3 * act);
+      size_t scores = op(12 * seq_len * seq_len * sizeof(float));
+      trace.push_back({false, shape, 0});
+      size_t probs = op(12 * seq_len * seq_len * sizeof(float));
+      trace.push_back({false, scores, 0});
+      size_t context = op(act);
+      trace.push_back({false, qkv, 0});
+      trace.push_back({false, probs, 0});
+      size_t attn_out = op(act);
+      trace.push_back({false, context, 0});
+      size_t mean = op(seq_len * sizeof(float));
+      size_t norm = op(act);
+      trace.push_back({false, attn_out, 0});
+      trace.push_back({false, mean, 0});
+      size_t ffn = op(4 * act);
+      size_t gelu = op(4 * act);
+      trace.push_back({false, ffn, 0});
+      size_t ffn_out = op(act);
+      trace.push_back({false, gelu, 0});
+      trace.push_back({false, norm, 0});
+      trace.push_back({false, x, 0});
+      x = ffn_out;
+    }
+    trace.push_back({false, x, 0});
+  }
+  return trace;
+}
+
+static double ReplayTrace(Allocator* allocator,
+                          const std::vector<AllocEvent>& trace,
+                          int repeat) {
+  size_t num_vars = 0;
+  for (auto& event : trace) {
+    num_vars = std::max(num_vars, event.var + 1);
+  }
+  std::vector<AllocationPtr> vars(num_vars);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeat; ++i) {
+    for (auto& event : trace) {
+      if (event.alloc) {
+        vars[event.var] = allocator->Allocate(event.bytes);
+        // the kernel writes its output, which is where the page faults of
+        // fresh memory show up
+        memset(vars[event.var]->ptr(), 0, std::min<size_t>(event.bytes, 4096));
+        static_cast<char*>(vars[event.var]->ptr())[event.bytes - 1] = 0;
+      } else {
+        vars[event.var].reset();
+      }
+    }
+    for (auto& var : vars) {
+      var.reset();
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() /
+         repeat;
+}
+
+TEST(PooledCPUAllocator, interpreter_core_trace_benchmark) {
+  auto trace = FLAGS_alloc_trace_file.empty()
+                   ? MakeInterpreterCoreTrace()
+                   : LoadTrace(FLAGS_alloc_trace_file);
+  ASSERT_FALSE(trace.empty());
+  size_t num_allocs = 0;
+  for (auto& event : trace) {
+    num_allocs += event.alloc;
+  }
+
+  CPUAllocator system_allocator;
+  double system_us =
+      ReplayTrace(&system_allocator, trace, FLAGS_alloc_trace_repeat);
+
+  PooledCPUAllocator pooled_allocator(PooledCPUAllocator::Options{});
+  // the first run only fills the free lists
+  ReplayTrace(&pooled_allocator, trace, 1);
+  auto warm = pooled_allocator.GetStats();
+  double pooled_us =
+      ReplayTrace(&pooled_allocator, trace, FLAGS_alloc_trace_repeat);
+  auto stats = pooled_allocator.GetStats();
+
+  LOG(INFO) << "replay " << num_allocs << " allocations: system "
+            << system_us << " us/run, pooled " << pooled_us
+            << " us/run, pooled reserved " << stats.reserved_bytes
+            << " bytes in " << stats.system_alloc_count << " system calls";
+  // steady state runs are served from the free lists only
+  EXPECT_EQ(stats.system_alloc_count, warm.system_alloc_count);
+  EXPECT_EQ(stats.system_free_count, 0UL);
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -12,12 +12,19 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "paddle/fluid/framework/framework.pb.h"
+#include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/inference/io.h"
 #include "paddle/fluid/platform/bfloat16.h"
 #include "paddle/fluid/platform/float16.h"
 #include "paddle/phi/core/kernel_registry.h"
@@ -368,3 +375,179 @@ TEST(SaveLoadTestWithCombineOp, CPU) {
     }
   }
 }
+
+#ifndef _WIN32
+template <typename T>
+void FillForMemoryMap(const std::string& var_name,
+                      const std::vector<int64_t>& dims,
+                      paddle::framework::Scope* scope) {
+  auto tensor = scope->Var(var_name)->GetMutable<phi::DenseTensor>();
+  tensor->Resize(common::make_ddim(dims));
+  T* data = tensor->mutable_data<T>(paddle::platform::CPUPlace());
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = static_cast<T>(i % 100 - 50);
+  }
+}
+
+// The parameters mapped by LoadCombineFromMemoryMap have to be the ones
+// loaded by load_combine, whether their data is aliased in the mapping or
+// copied out of it.
+TEST(LoadCombineFromMemoryMap, CPU) {
+  paddle::framework::Scope scope;
+  paddle::platform::CPUPlace place;
+  // the 3 bytes of int8 leave the data of the next tensors unaligned
+  std::vector<std::string> names = {
+      "mmap_var1", "mmap_var2", "mmap_var3", "mmap_var4"};
+  FillForMemoryMap<float>(names[0], {16, 4}, &scope);
+  scope.Var(names[0])->GetMutable<phi::DenseTensor>()->set_lod(
+      {{0, 2, 16}});
+  FillForMemoryMap<int8_t>(names[1], {3}, &scope);
+  FillForMemoryMap<float>(names[2], {5, 3}, &scope);
+  FillForMemoryMap<double>(names[3], {2, 4}, &scope);
+
+  std::string filename = "check_tensor_mmap.ls";
+  paddle::framework::AttributeMap attrs;
+  attrs.insert({"file_path", filename});
+  auto save_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "save_combine", {{"X", names}}, {}, attrs);
+  save_combine_op->Run(scope, place);
+
+  std::vector<std::string> ref_names;
+  std::vector<phi::DenseTensor*> mapped;
+  std::vector<phi::DenseTensor> mapped_tensors(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    ref_names.push_back("ref_" + names[i]);
+    GeneratePlaceholderBeforeLoad(ref_names.back(), &scope);
+    mapped.push_back(&mapped_tensors[i]);
+  }
+  auto load_combine_op = paddle::framework::OpRegistry::CreateOp(
+      "load_combine", {}, {{"Out", ref_names}}, attrs);
+  load_combine_op->Run(scope, place);
+  paddle::inference::LoadCombineFromMemoryMap(filename, mapped);
+
+  // where the data of each tensor is in the file, it ends its record
+  std::vector<size_t> data_offsets;
+  size_t file_size = 0;
+  for (auto& name : names) {
+    auto& tensor = scope.FindVar(name)->Get<phi::DenseTensor>();
+    std::ostringstream record;
+    paddle::framework::SerializeToStream(record, tensor);
+    file_size += record.str().size();
+    data_offsets.push_back(file_size - tensor.memory_size());
+  }
+
+  // the aliased tensors are at their offset from the start of the mapping
+  const char* mapping = nullptr;
+  size_t num_aliased = 0;
+  size_t num_copied = 0;
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto& ref = scope.FindVar(ref_names[i])->Get<phi::DenseTensor>();
+    auto& actual = mapped_tensors[i];
+    EXPECT_EQ(actual.dims(), ref.dims());
+    EXPECT_EQ(actual.dtype(), ref.dtype());
+    EXPECT_EQ(actual.lod(), ref.lod());
+    ASSERT_EQ(actual.memory_size(), ref.memory_size());
+    const char* data = static_cast<const char*>(actual.data());
+    EXPECT_EQ(std::memcmp(data, ref.data(), ref.memory_size()), 0);
+
+    if (data_offsets[i] % phi::SizeOf(ref.dtype()) == 0) {
+      if (mapping == nullptr) {
+        mapping = data - data_offsets[i];
+      }
+      EXPECT_EQ(data, mapping + data_offsets[i]) << names[i];
+      ++num_aliased;
+    } else {
+      ++num_copied;
+    }
+  }
+  ASSERT_GT(num_aliased, 0UL);
+  ASSERT_GT(num_copied, 0UL);
+  for (size_t i = 0; i < names.size(); ++i) {
+    const char* data = static_cast<const char*>(mapped_tensors[i].data());
+    if (data_offsets[i] % phi::SizeOf(mapped_tensors[i].dtype()) != 0) {
+      EXPECT_TRUE(data + mapped_tensors[i].memory_size() <= mapping ||
+                  data >= mapping + file_size)
+          << names[i] << " is unaligned in the file, it has to be copied";
+    }
+  }
+
+  // the mapping is private, writing a parameter leaves the file alone
+  mapped_tensors[0].data<float>()[0] = 1000.0f;
+  std::vector<phi::DenseTensor> reloaded_tensors(names.size());
+  std::vector<phi::DenseTensor*> reloaded;
+  for (auto& tensor : reloaded_tensors) {
+    reloaded.push_back(&tensor);
+  }
+  paddle::inference::LoadCombineFromMemoryMap(filename, reloaded);
+  EXPECT_EQ(reloaded_tensors[0].data<float>()[0], -50.0f);
+
+  // one tensor more than saved
+  phi::DenseTensor extra;
+  reloaded.push_back(&extra);
+  EXPECT_ANY_THROW(
+      paddle::inference::LoadCombineFromMemoryMap(filename, reloaded));
+  // one tensor less, the rest of the file is left
+  reloaded.resize(names.size() - 1);
+  EXPECT_ANY_THROW(
+      paddle::inference::LoadCombineFromMemoryMap(filename, reloaded));
+  std::remove(filename.c_str());
+}
+
+// A truncated or damaged file is refused before the data of a tensor could
+// be read past the end of the mapping.
+TEST(LoadCombineFromMemoryMap, DamagedFile) {
+  paddle::framework::Scope scope;
+  FillForMemoryMap<float>("damaged_var", {8, 8}, &scope);
+  std::ostringstream record;
+  paddle::framework::SerializeToStream(
+      record, scope.FindVar("damaged_var")->Get<phi::DenseTensor>());
+  std::string content = record.str();
+
+  phi::DenseTensor tensor;
+  std::vector<phi::DenseTensor*> out = {&tensor};
+  std::string filename = "check_tensor_mmap_damaged.ls";
+  auto write_file = [&filename](const std::string& data) {
+    std::ofstream fout(filename, std::ios::binary);
+    fout.write(data.data(), static_cast<std::streamsize>(data.size()));
+  };
+
+  // in the data, and in the header
+  for (size_t size : {content.size() - 1, static_cast<size_t>(10)}) {
+    write_file(content.substr(0, size));
+    EXPECT_ANY_THROW(paddle::inference::LoadCombineFromMemoryMap(filename, out))
+        << "truncated to " << size << " bytes";
+  }
+
+  // dims whose number of elements overflows, or is negative
+  std::vector<std::vector<int64_t>> bad_dims = {
+      {int64_t{1} << 40, int64_t{1} << 40}, {-1, 16}, {int64_t{1} << 62, 4}};
+  for (auto& dims : bad_dims) {
+    paddle::framework::proto::VarType::TensorDesc desc;
+    desc.set_data_type(paddle::framework::proto::VarType::FP32);
+    for (int64_t dim : dims) {
+      desc.add_dims(dim);
+    }
+    std::string desc_str = desc.SerializeAsString();
+    std::string damaged;
+    uint32_t version = 0;
+    uint64_t lod_level = 0;
+    int32_t desc_size = static_cast<int32_t>(desc_str.size());
+    damaged.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    damaged.append(reinterpret_cast<const char*>(&lod_level),
+                   sizeof(lod_level));
+    damaged.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    damaged.append(reinterpret_cast<const char*>(&desc_size),
+                   sizeof(desc_size));
+    damaged.append(desc_str);
+    damaged.append(std::string(64, '\0'));
+    write_file(damaged);
+    EXPECT_ANY_THROW(paddle::inference::LoadCombineFromMemoryMap(filename, out))
+        << "dims " << dims[0] << ", " << dims[1];
+  }
+
+  // an empty file can not be mapped
+  write_file("");
+  EXPECT_ANY_THROW(paddle::inference::LoadCombineFromMemoryMap(filename, out));
+  std::remove(filename.c_str());
+}
+#endif
@@ -34,6 +34,25 @@ TEST(Analyzer_seq_pool1_compare, compare) {
       reinterpret_cast<const PaddlePredictor::Config *>(&cfg), input_slots_all);
 }
 
+// the outputs of a predictor whose params are mapped are the ones of a
+// predictor loading them with load_combine
+TEST(Analyzer_seq_pool1_compare, memory_mapped_params) {
+  AnalysisConfig cfg;
+  SetConfig(&cfg);
+  AnalysisConfig mapped_cfg;
+  SetConfig(&mapped_cfg);
+  mapped_cfg.EnableMemoryMappedParams();
+  ASSERT_TRUE(mapped_cfg.memory_mapped_params_enabled());
+
+  std::vector<std::vector<PaddleTensor>> input_slots_all;
+  SetInput(&input_slots_all);
+  auto pred = CreateTestPredictor(
+      reinterpret_cast<const PaddlePredictor::Config *>(&cfg), true);
+  auto mapped_pred = CreateTestPredictor(
+      reinterpret_cast<const PaddlePredictor::Config *>(&mapped_cfg), true);
+  CompareNativeAndAnalysis(pred.get(), mapped_pred.get(), input_slots_all);
+}
+
 }  // namespace seq_pool1_tester
 }  // namespace analysis
 }  // namespace inference
@@ -16,12 +16,21 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <random>
+#include <set>
 #include <string>
 
 #include "paddle/phi/core/kernel_registry.h"
 
+#include "paddle/fluid/framework/new_executor/interpreter/critical_path.h"
+#include "paddle/fluid/framework/new_executor/interpreter/shape_bucket_cache.h"
+#include "paddle/fluid/framework/new_executor/interpreter/static_memory_plan.h"
 #include "paddle/fluid/framework/new_executor/pir_interpreter.h"
 #include "paddle/fluid/pir/dialect/operator/ir/control_flow_op.h"
 #include "paddle/fluid/pir/dialect/operator/ir/op_dialect.h"
@@ -33,12 +42,20 @@
 
 #include "paddle/fluid/pir/dialect/operator/ir/op_type.h"
 
+#include "paddle/common/flags.h"
 #include "paddle/common/macros.h"
 #include "paddle/pir/include/dialect/control_flow/ir/cf_dialect.h"
 #include "paddle/pir/include/dialect/control_flow/ir/cf_op.h"
 
 DECLARE_FILE_SYMBOLS(kernel_dialect);
 
+COMMON_DECLARE_bool(enable_pir_in_executor_trace_run);
+COMMON_DECLARE_bool(enable_pir_static_memory_plan);
+COMMON_DECLARE_bool(enable_pir_frozen_trace_run);
+COMMON_DECLARE_string(pir_shape_bucket_policy);
+COMMON_DECLARE_int32(pir_shape_bucket_capacity);
+COMMON_DECLARE_string(new_executor_instruction_priority);
+
 PD_DECLARE_KERNEL(full, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(full_int_array, CPU, ALL_LAYOUT);
 PD_DECLARE_KERNEL(uniform, CPU, ALL_LAYOUT);
@@ -344,5 +361,378 @@ TEST(StandaloneExecutor, while_op) {
   EXPECT_EQ(res0, true);
 }
 
+TEST(StaticMemoryPlan, best_fit) {
+  using interpreter::MemoryPlanBuffer;
+  // the chain takes turns on two slots, the late large buffer reuses the
+  // memory of all of them
+  std::vector<MemoryPlanBuffer> buffers = {
+      {256, 0, 1}, {256, 1, 2}, {256, 2, 3}, {64, 0, 0}, {448, 4, 5}};
+  std::vector<size_t> offsets;
+  size_t arena_size = interpreter::PlanMemoryOffsets(buffers, 64, &offsets);
+  EXPECT_EQ(arena_size, 512UL);
+  EXPECT_NE(offsets[0], offsets[1]);
+  EXPECT_EQ(offsets[0], offsets[2]);
+
+  std::mt19937 engine(0);
+  buffers.clear();
+  for (int i = 0; i < 200; ++i) {
+    size_t first = engine() % 100;
+    buffers.push_back({engine() % 10000 + 1, first, first + engine() % 20});
+  }
+  arena_size = interpreter::PlanMemoryOffsets(buffers, 64, &offsets);
+  size_t total = 0;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    EXPECT_EQ(offsets[i] % 64, 0UL);
+    EXPECT_LE(offsets[i] + buffers[i].size, arena_size);
+    total += buffers[i].size;
+    for (size_t j = 0; j < i; ++j) {
+      bool alive_together = buffers[i].first <= buffers[j].last &&
+                            buffers[j].first <= buffers[i].last;
+      bool overlap = offsets[i] < offsets[j] + buffers[j].size &&
+                     offsets[j] < offsets[i] + buffers[i].size;
+      EXPECT_FALSE(alive_together && overlap);
+    }
+  }
+  EXPECT_LT(arena_size, total);
+}
+
+TEST(StandaloneExecutor, static_memory_plan) {
+  FLAGS_enable_pir_in_executor_trace_run = true;
+  FLAGS_enable_pir_static_memory_plan = true;
+
+  pir::IrContext* ctx = pir::IrContext::Instance();
+  pir::Program program((ctx));
+  ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
+  pir::Builder builder = pir::Builder(ctx, program.block());
+
+  // out = sqrt(((x + x) + x) + x) with x = 4, every add result is freed
+  // right after its reader
+  paddle::dialect::FullOp full = builder.Build<paddle::dialect::FullOp>(
+      std::vector<int64_t>{64, 64},
+      4.0,
+      phi::DataType::FLOAT32,
+      phi::CPUPlace());
+  pir::Value sum = full->result(0);
+  for (int i = 0; i < 3; ++i) {
+    sum = builder.Build<paddle::dialect::AddOp>(sum, full->result(0))
+              ->result(0);
+  }
+  auto sqrt = builder.Build<paddle::dialect::SqrtOp>(sum);
+  std::string out_name = "sqrt_out";
+  builder.Build<pir::ShadowOutputOp>(sqrt->result(0), out_name);
+
+  auto kernel_program = paddle::dialect::PdOpLowerToKernelPass(&program);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  InterpreterCore test_core(place, {}, kernel_program->block(), &scope);
+  test_core.SetSkipGcVars({out_name});
+  auto* pir_interpreter =
+      dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  ASSERT_NE(pir_interpreter, nullptr);
+
+  size_t arena_size = 0;
+  for (int run = 0; run < 3; ++run) {
+    test_core.Run({});
+    auto out_tensor =
+        test_core.local_scope() == nullptr
+            ? scope.FindVar(out_name)->Get<phi::DenseTensor>()
+            : test_core.local_scope()
+                  ->FindVar(out_name)
+                  ->Get<phi::DenseTensor>();
+    for (int64_t i = 0; i < out_tensor.numel(); ++i) {
+      ASSERT_TRUE(simple_cmp(out_tensor.data<float>()[i], 4.0));
+    }
+
+    // the plan is built by the first run and kept by the later ones
+    const interpreter::StaticMemoryPlan* plan =
+        pir_interpreter->GetStaticMemoryPlan();
+    ASSERT_NE(plan, nullptr);
+    ASSERT_TRUE(plan->IsBuilt());
+    if (run == 0) {
+      arena_size = plan->ArenaSize();
+    }
+    EXPECT_EQ(plan->ArenaSize(), arena_size);
+    // the three add outputs at least, the first and the last one do not
+    // live at the same time and share their slot
+    const size_t tensor_bytes = 64 * 64 * sizeof(float);
+    EXPECT_GE(plan->PlannedBufferNum(), 3UL);
+    EXPECT_GE(plan->ArenaSize(), 2 * tensor_bytes);
+    EXPECT_LT(plan->ArenaSize(), plan->PlannedBytes());
+  }
+
+  FLAGS_enable_pir_in_executor_trace_run = false;
+  FLAGS_enable_pir_static_memory_plan = false;
+}
+
+// runs out = sqrt((x + x) + x) with x fed in each run with the given numel,
+// check is called with the interpreter after each run
+static void RunFeedSqrtProgram(
+    const std::vector<int64_t>& numels,
+    const std::function<void(size_t, const PirInterpreter&)>& check =
+        nullptr) {
+  pir::IrContext* ctx = pir::IrContext::Instance();
+  pir::Program program(ctx);
+  ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
+  pir::Builder builder = pir::Builder(ctx, program.block());
+
+  pir::OpInfo feed_op_info =
+      ctx->GetRegisteredOpInfo(paddle::dialect::FeedOp::name());
+  phi::DDim dims = {-1};
+  phi::LoD lod = {{0}};
+  pir::Type dense_tensor_dtype = paddle::dialect::DenseTensorType::get(
+      ctx, pir::Float32Type::get(ctx), dims, phi::DataLayout::NCHW, lod, 0);
+  pir::AttributeMap attr_map;
+  attr_map.insert(std::pair<std::string, pir::Attribute>(
+      "name", pir::StrAttribute::get(ctx, "x")));
+  attr_map.insert(std::pair<std::string, pir::Attribute>(
+      "col", pir::Int32Attribute::get(ctx, 0)));
+  pir::Operation* feed_op =
+      pir::Operation::Create({}, attr_map, {dense_tensor_dtype}, feed_op_info);
+  program.block()->push_back(feed_op);
+
+  pir::Value x = feed_op->result(0);
+  pir::Value sum = builder.Build<paddle::dialect::AddOp>(x, x)->result(0);
+  sum = builder.Build<paddle::dialect::AddOp>(sum, x)->result(0);
+  auto sqrt = builder.Build<paddle::dialect::SqrtOp>(sum);
+  std::string out_name = "sqrt_out";
+  builder.Build<pir::ShadowOutputOp>(sqrt->result(0), out_name);
+
+  auto kernel_program = paddle::dialect::PdOpLowerToKernelPass(&program);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  InterpreterCore test_core(place, {}, kernel_program->block(), &scope);
+  test_core.SetSkipGcVars({out_name});
+  auto* pir_interpreter =
+      dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  ASSERT_NE(pir_interpreter, nullptr);
+
+  paddle::platform::DeviceContext* dev_ctx =
+      paddle::platform::DeviceContextPool::Instance().Get(place);
+  for (size_t run = 0; run < numels.size(); ++run) {
+    int64_t numel = numels[run];
+    phi::DenseTensor tensor_x;
+    tensor_x.Resize({numel});
+    dev_ctx->Alloc(&tensor_x, phi::DataType::FLOAT32);
+    float value = 3.0 * (run + 1);
+    for (int64_t i = 0; i < numel; ++i) {
+      tensor_x.data<float>()[i] = value;
+    }
+
+    test_core.Run({"x"}, {tensor_x});
+    auto out_tensor =
+        test_core.local_scope() == nullptr
+            ? scope.FindVar(out_name)->Get<phi::DenseTensor>()
+            : test_core.local_scope()
+                  ->FindVar(out_name)
+                  ->Get<phi::DenseTensor>();
+    ASSERT_EQ(out_tensor.numel(), numel);
+    for (int64_t i = 0; i < numel; ++i) {
+      ASSERT_TRUE(
+          simple_cmp(out_tensor.data<float>()[i], std::sqrt(3.0 * value)));
+    }
+    if (check) {
+      check(run, *pir_interpreter);
+    }
+  }
+}
+
+TEST(StandaloneExecutor, frozen_trace_run) {
+  FLAGS_enable_pir_in_executor_trace_run = true;
+  FLAGS_enable_pir_frozen_trace_run = true;
+  // the shape changes at the fourth run, the frozen steps infer the metas
+  // again
+  size_t infer_meta_runs = 0;
+  RunFeedSqrtProgram(
+      {4, 4, 4, 6, 6, 6},
+      [&infer_meta_runs](size_t run, const PirInterpreter& pir_interpreter) {
+        // frozen after the warm-up run, every later run is a replay
+        const interpreter::FrozenTrace* trace =
+            pir_interpreter.GetFrozenTrace();
+        ASSERT_NE(trace, nullptr);
+        EXPECT_EQ(trace->NumReplays(), run);
+        // the two adds and the sqrt
+        EXPECT_GE(trace->NumFrozenSteps(), 3UL);
+        if (run == 1 || run == 3) {
+          // the first replay and the new shape run InferMeta
+          EXPECT_GT(trace->NumInferMetaRuns(), infer_meta_runs);
+        } else {
+          // the same shapes reuse the recorded output metas
+          EXPECT_EQ(trace->NumInferMetaRuns(), infer_meta_runs);
+        }
+        infer_meta_runs = trace->NumInferMetaRuns();
+      });
+  FLAGS_enable_pir_in_executor_trace_run = false;
+  FLAGS_enable_pir_frozen_trace_run = false;
+}
+
+TEST(ShapeBucketCache, policy_and_lru) {
+  using interpreter::ShapeBucketPolicy;
+  EXPECT_EQ(ShapeBucketPolicy::Parse("exact").Bucket(7), 7);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("pow2").Bucket(5), 8);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("pow2").Bucket(8), 8);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("step:32").Bucket(33), 64);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("boundaries:16,64").Bucket(17), 64);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("boundaries:16,64").Bucket(100), 100);
+  EXPECT_EQ(ShapeBucketPolicy::Parse("pow2").Bucket(-1), -1);
+  EXPECT_ANY_THROW(ShapeBucketPolicy::Parse("step:0"));
+  EXPECT_ANY_THROW(ShapeBucketPolicy::Parse("boundaries:64,16"));
+  EXPECT_ANY_THROW(ShapeBucketPolicy::Parse("linear"));
+
+  interpreter::ShapeBucketCache<int> cache(ShapeBucketPolicy::Parse("exact"),
+                                           2);
+  *cache.Get({1}) = 1;
+  *cache.Get({2}) = 2;
+  EXPECT_EQ(*cache.Get({1}), 1);
+  *cache.Get({3}) = 3;
+  EXPECT_EQ(cache.Find({2}), nullptr);
+  EXPECT_EQ(*cache.Find({1}), 1);
+  EXPECT_EQ(*cache.Find({3}), 3);
+  EXPECT_EQ(cache.Size(), 2UL);
+  EXPECT_EQ(cache.Hits(), 1UL);
+  EXPECT_EQ(cache.Misses(), 3UL);
+  EXPECT_EQ(cache.Evictions(), 1UL);
+}
+
+TEST(StandaloneExecutor, shape_bucket_cache) {
+  FLAGS_enable_pir_in_executor_trace_run = true;
+  FLAGS_pir_shape_bucket_policy = "pow2";
+  FLAGS_pir_shape_bucket_capacity = 2;
+  // the buckets are 4, 8, 8, 4, 16, 8, 4, 8: with two kept some are evicted
+  // and warmed again, and the sizes inside a bucket differ. The third run
+  // stays in its bucket and does not look the cache up.
+  const std::vector<size_t> hits = {0, 0, 0, 1, 1, 1, 1, 2};
+  const std::vector<size_t> misses = {1, 2, 2, 2, 3, 4, 5, 5};
+  const std::vector<size_t> evictions = {0, 0, 0, 0, 1, 2, 3, 3};
+  RunFeedSqrtProgram(
+      {3, 7, 8, 4, 16, 5, 3, 6},
+      [&](size_t run, const PirInterpreter& pir_interpreter) {
+        auto* cache = pir_interpreter.GetShapeBucketCache();
+        ASSERT_NE(cache, nullptr);
+        EXPECT_EQ(cache->Hits(), hits[run]) << "run " << run;
+        EXPECT_EQ(cache->Misses(), misses[run]) << "run " << run;
+        EXPECT_EQ(cache->Evictions(), evictions[run]) << "run " << run;
+        EXPECT_EQ(cache->Size(), std::min<size_t>(run + 1, 2));
+        // each bucket is warmed up by its first run and frozen after it
+        EXPECT_NE(pir_interpreter.GetFrozenTrace(), nullptr);
+      });
+  FLAGS_enable_pir_in_executor_trace_run = false;
+  FLAGS_pir_shape_bucket_policy = "";
+  FLAGS_pir_shape_bucket_capacity = 8;
+}
+
+TEST(CriticalPath, longest_path) {
+  // 0 -> 1 -> 3, 0 -> 2 -> 3, 4 alone
+  std::map<size_t, std::set<size_t>> downstream_map = {
+      {0, {1, 2}}, {1, {3}}, {2, {3}}};
+  std::vector<int64_t> costs = {1, 10, 5, 2, 7};
+  auto length = interpreter::ComputeCriticalPathLength(downstream_map, costs);
+  EXPECT_EQ(length, (std::vector<int64_t>{13, 12, 7, 2, 7}));
+
+  downstream_map[3].insert(0);
+  EXPECT_ANY_THROW(
+      interpreter::ComputeCriticalPathLength(downstream_map, costs));
+}
+
+// A long chain of ops and many short branches coming before it in the
+// program, on two host threads. In fifo order the short branches are taken
+// first and the chain waits, in critical_path order the chain is taken at
+// once. Returns the names of the instructions in the trace order.
+static std::vector<std::string> RunMultiBranchProgram(
+    const std::string& priority) {
+  FLAGS_new_executor_instruction_priority = priority;
+  pir::IrContext* ctx = pir::IrContext::Instance();
+  pir::Program program(ctx);
+  ctx->GetOrRegisterDialect<paddle::dialect::OperatorDialect>();
+  pir::Builder builder = pir::Builder(ctx, program.block());
+
+  const std::vector<int64_t> shape = {512, 512};
+  std::vector<std::string> out_names;
+  for (int branch = 0; branch < 8; ++branch) {
+    pir::Value x = builder
+                       .Build<paddle::dialect::FullOp>(
+                           shape, 1.0, phi::DataType::FLOAT32, phi::CPUPlace())
+                       ->result(0);
+    for (int i = 0; i < 3; ++i) {
+      x = builder.Build<paddle::dialect::AddOp>(x, x)->result(0);
+    }
+    out_names.push_back("branch_out_" + std::to_string(branch));
+    builder.Build<pir::ShadowOutputOp>(x, out_names.back());
+  }
+  pir::Value chain =
+      builder
+          .Build<paddle::dialect::FullOp>(
+              shape, 2.0, phi::DataType::FLOAT32, phi::CPUPlace())
+          ->result(0);
+  for (int i = 0; i < 24; ++i) {
+    chain = builder.Build<paddle::dialect::AddOp>(chain, chain)->result(0);
+    chain = builder.Build<paddle::dialect::SqrtOp>(chain)->result(0);
+  }
+  out_names.push_back("chain_out");
+  builder.Build<pir::ShadowOutputOp>(chain, out_names.back());
+
+  auto kernel_program = paddle::dialect::PdOpLowerToKernelPass(&program);
+  auto place = platform::CPUPlace();
+  Scope scope;
+  interpreter::ExecutionConfig config;
+  config.host_num_threads = 2;
+  config.device_num_threads = 1;
+  InterpreterCore test_core(place, {}, kernel_program->block(), &scope, config);
+  test_core.SetSkipGcVars(
+      std::set<std::string>(out_names.begin(), out_names.end()));
+  test_core.Run({});
+  test_core.Run({});
+
+  Scope* out_scope =
+      test_core.local_scope() == nullptr ? &scope : test_core.local_scope();
+  // sqrt(2 * x) keeps x = 2 fixed
+  auto& chain_out = out_scope->FindVar("chain_out")->Get<phi::DenseTensor>();
+  EXPECT_TRUE(simple_cmp(chain_out.data<float>()[0], 2.0));
+  auto& branch_out =
+      out_scope->FindVar("branch_out_0")->Get<phi::DenseTensor>();
+  EXPECT_TRUE(simple_cmp(branch_out.data<float>()[0], 8.0));
+
+  std::vector<std::string> order;
+  auto* pir_interpreter = dynamic_cast<const PirInterpreter*>(test_core.Impl());
+  EXPECT_NE(pir_interpreter, nullptr);
+  if (pir_interpreter != nullptr) {
+    for (size_t id : pir_interpreter->GetTraceExecuteOrder()) {
+      order.push_back(pir_interpreter->GetInstruction(id).Name());
+    }
+  }
+  FLAGS_new_executor_instruction_priority = "fifo";
+  return order;
+}
+
+// the number of full ops, the roots of the branches and of the chain, taken
+// before the last sqrt of the chain
+static int FullsBeforeChainEnd(const std::vector<std::string>& order) {
+  int fulls = 0;
+  int fulls_before_chain_end = -1;
+  for (const auto& name : order) {
+    if (name.find("full") != std::string::npos) {
+      ++fulls;
+    } else if (name.find("sqrt") != std::string::npos) {
+      fulls_before_chain_end = fulls;
+    }
+  }
+  return fulls_before_chain_end;
+}
+
+TEST(StandaloneExecutor, critical_path_priority) {
+  std::vector<std::string> fifo = RunMultiBranchProgram("fifo");
+  std::vector<std::string> critical_path =
+      RunMultiBranchProgram("critical_path");
+  ASSERT_EQ(fifo.size(), critical_path.size());
+  // program order: the eight branches come before the chain
+  EXPECT_EQ(FullsBeforeChainEnd(fifo), 9);
+  // the chain is picked ahead of the short independent branches
+  EXPECT_EQ(FullsBeforeChainEnd(critical_path), 1);
+  EXPECT_NE(critical_path.front().find("full"), std::string::npos);
+  EXPECT_NE(critical_path[1].find("add"), std::string::npos);
+  EXPECT_NE(critical_path[2].find("sqrt"), std::string::npos);
+}
+
 }  // namespace framework
 }  // namespace paddle
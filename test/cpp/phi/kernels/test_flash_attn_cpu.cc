@@ -0,0 +1,255 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/flash_attn_cpu.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+using funcs::FlashAttnCPUParams;
+
+std::vector<float> RandomFloats(int64_t numel, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+int64_t SeqOffset(const int32_t* cu_seqlens, int64_t max_seqlen, int64_t b) {
+  return cu_seqlens ? cu_seqlens[b] : b * max_seqlen;
+}
+
+int64_t SeqLen(const int32_t* cu_seqlens, int64_t max_seqlen, int64_t b) {
+  return cu_seqlens ? cu_seqlens[b + 1] - cu_seqlens[b] : max_seqlen;
+}
+
+// The softmax attention of every query in double, out and lse laid out like
+// FlashAttnCPUForward.
+void ReferenceAttention(const FlashAttnCPUParams& p,
+                        const std::vector<float>& q,
+                        const std::vector<float>& k,
+                        const std::vector<float>& v,
+                        const float* mask,
+                        std::vector<float>* out,
+                        std::vector<float>* lse) {
+  const int64_t group = p.num_heads / p.num_heads_k;
+  for (int64_t b = 0; b < p.batch_size; ++b) {
+    int64_t q_offset = SeqOffset(p.cu_seqlens_q, p.max_seqlen_q, b);
+    int64_t k_offset = SeqOffset(p.cu_seqlens_k, p.max_seqlen_k, b);
+    int64_t seqlen_q = SeqLen(p.cu_seqlens_q, p.max_seqlen_q, b);
+    int64_t seqlen_k = SeqLen(p.cu_seqlens_k, p.max_seqlen_k, b);
+    for (int64_t h = 0; h < p.num_heads; ++h) {
+      int64_t hk = h / group;
+      for (int64_t i = 0; i < seqlen_q; ++i) {
+        std::vector<double> s(seqlen_k, -INFINITY);
+        double max = -INFINITY;
+        for (int64_t j = 0; j < seqlen_k; ++j) {
+          if (p.causal && j > i + seqlen_k - seqlen_q) {
+            continue;
+          }
+          double dot = 0;
+          for (int64_t c = 0; c < p.head_dim; ++c) {
+            dot += static_cast<double>(
+                       q[((q_offset + i) * p.num_heads + h) * p.head_dim +
+                         c]) *
+                   k[((k_offset + j) * p.num_heads_k + hk) * p.head_dim + c];
+          }
+          s[j] = dot * p.scale;
+          if (mask) {
+            int64_t mb = p.mask_batch == 1 ? 0 : b;
+            int64_t mh = p.mask_heads == 1 ? 0 : h;
+            s[j] += mask[((mb * p.mask_heads + mh) * p.max_seqlen_q + i) *
+                             p.max_seqlen_k +
+                         j];
+          }
+          max = std::max(max, s[j]);
+        }
+        double sum = 0;
+        std::vector<double> o(p.head_dim_v, 0.);
+        if (max != -INFINITY) {
+          for (int64_t j = 0; j < seqlen_k; ++j) {
+            double e = std::exp(s[j] - max);
+            sum += e;
+            for (int64_t c = 0; c < p.head_dim_v; ++c) {
+              o[c] +=
+                  e *
+                  v[((k_offset + j) * p.num_heads_k + hk) * p.head_dim_v + c];
+            }
+          }
+        }
+        for (int64_t c = 0; c < p.head_dim_v; ++c) {
+          (*out)[((q_offset + i) * p.num_heads + h) * p.head_dim_v + c] =
+              sum > 0 ? static_cast<float>(o[c] / sum) : 0.f;
+        }
+        (*lse)[(b * p.num_heads + h) * p.lse_stride + i] =
+            sum > 0 ? static_cast<float>(max + std::log(sum)) : INFINITY;
+      }
+    }
+  }
+}
+
+void CheckAttention(const FlashAttnCPUParams& p,
+                    int64_t tokens_q,
+                    int64_t tokens_k,
+                    const std::vector<float>& mask) {
+  CPUContext dev_ctx;
+  std::vector<float> q = RandomFloats(tokens_q * p.num_heads * p.head_dim, 1);
+  std::vector<float> k =
+      RandomFloats(tokens_k * p.num_heads_k * p.head_dim, 2);
+  std::vector<float> v =
+      RandomFloats(tokens_k * p.num_heads_k * p.head_dim_v, 3);
+  const float* mask_data = mask.empty() ? nullptr : mask.data();
+  int64_t out_numel = tokens_q * p.num_heads * p.head_dim_v;
+  int64_t lse_numel = p.batch_size * p.num_heads * p.lse_stride;
+  std::vector<float> expect(out_numel), expect_lse(lse_numel, INFINITY);
+  ReferenceAttention(p, q, k, v, mask_data, &expect, &expect_lse);
+
+  std::vector<float> out(out_numel), lse(lse_numel, INFINITY);
+  funcs::FlashAttnCPUForward(dev_ctx,
+                             p,
+                             q.data(),
+                             k.data(),
+                             v.data(),
+                             mask_data,
+                             out.data(),
+                             lse.data());
+  for (int64_t i = 0; i < out_numel; ++i) {
+    ASSERT_NEAR(out[i], expect[i], 1e-4) << i;
+  }
+  for (int64_t i = 0; i < lse_numel; ++i) {
+    if (std::isinf(expect_lse[i])) {
+      ASSERT_TRUE(std::isinf(lse[i])) << i;
+    } else {
+      ASSERT_NEAR(lse[i], expect_lse[i], 1e-4) << i;
+    }
+  }
+
+  // bfloat16 against the float result of the rounded inputs
+  auto to_bf16 = [](const std::vector<float>& x) {
+    std::vector<phi::dtype::bfloat16> y(x.begin(), x.end());
+    return y;
+  };
+  auto round_bf16 = [](const std::vector<float>& x) {
+    std::vector<float> y(x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+      y[i] = static_cast<float>(static_cast<phi::dtype::bfloat16>(x[i]));
+    }
+    return y;
+  };
+  std::vector<phi::dtype::bfloat16> q16 = to_bf16(q), k16 = to_bf16(k),
+                                    v16 = to_bf16(v), mask16 = to_bf16(mask);
+  std::vector<phi::dtype::bfloat16> out16(out_numel);
+  funcs::FlashAttnCPUForward(dev_ctx,
+                             p,
+                             q16.data(),
+                             k16.data(),
+                             v16.data(),
+                             mask.empty() ? nullptr : mask16.data(),
+                             out16.data(),
+                             lse.data());
+  std::vector<float> mask_rounded = round_bf16(mask);
+  ReferenceAttention(p,
+                     round_bf16(q),
+                     round_bf16(k),
+                     round_bf16(v),
+                     mask.empty() ? nullptr : mask_rounded.data(),
+                     &expect,
+                     &expect_lse);
+  for (int64_t i = 0; i < out_numel; ++i) {
+    ASSERT_NEAR(static_cast<float>(out16[i]), expect[i], 1e-2) << i;
+  }
+}
+
+FlashAttnCPUParams MakeParams(int64_t batch_size,
+                              int64_t seqlen_q,
+                              int64_t seqlen_k,
+                              int64_t num_heads,
+                              int64_t num_heads_k,
+                              int64_t head_dim,
+                              bool causal) {
+  FlashAttnCPUParams p;
+  p.batch_size = batch_size;
+  p.max_seqlen_q = seqlen_q;
+  p.max_seqlen_k = seqlen_k;
+  p.num_heads = num_heads;
+  p.num_heads_k = num_heads_k;
+  p.head_dim = head_dim;
+  p.head_dim_v = head_dim;
+  p.scale = 1.f / std::sqrt(static_cast<float>(head_dim));
+  p.causal = causal;
+  p.lse_stride = (seqlen_q + 127) / 128 * 128;
+  return p;
+}
+
+}  // namespace
+
+// several blocks of queries and keys, GQA and MQA
+TEST(FlashAttnCPU, padded) {
+  for (bool causal : {false, true}) {
+    for (int64_t num_heads_k : {4, 2, 1}) {
+      // seqlen_k = 600 spans 3 blocks of keys with head_dim 128
+      for (int64_t seqlen_q : {70, 300}) {
+        FlashAttnCPUParams p =
+            MakeParams(2, seqlen_q, 600, 4, num_heads_k, 128, causal);
+        CheckAttention(p, 2 * seqlen_q, 2 * 600, {});
+      }
+    }
+  }
+}
+
+// an additive padding mask, with fully masked rows
+TEST(FlashAttnCPU, mask) {
+  FlashAttnCPUParams p = MakeParams(2, 90, 600, 4, 2, 32, false);
+  p.mask_batch = 2;
+  p.mask_heads = 1;
+  std::vector<float> mask(2 * 90 * 600, 0.f);
+  const float kNegInf = -std::numeric_limits<float>::infinity();
+  for (int64_t i = 0; i < 90; ++i) {
+    // the last 250 keys of the second sequence are padding
+    for (int64_t j = 350; j < 600; ++j) {
+      mask[(90 + i) * 600 + j] = kNegInf;
+    }
+  }
+  for (int64_t j = 0; j < 600; ++j) {
+    mask[(90 + 5) * 600 + j] = kNegInf;
+  }
+  CheckAttention(p, 2 * 90, 2 * 600, mask);
+}
+
+// packed sequences of different lengths, including an empty one
+TEST(FlashAttnCPU, varlen) {
+  std::vector<int32_t> cu_seqlens_q = {0, 37, 166, 166, 230};
+  std::vector<int32_t> cu_seqlens_k = {0, 50, 179, 190, 254};
+  for (bool causal : {false, true}) {
+    FlashAttnCPUParams p = MakeParams(4, 129, 129, 6, 2, 48, causal);
+    p.cu_seqlens_q = cu_seqlens_q.data();
+    p.cu_seqlens_k = cu_seqlens_k.data();
+    CheckAttention(p, 230, 254, {});
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,339 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/block_attn_cpu.h"
+#include "paddle/phi/kernels/funcs/paged_kv_cache.h"
+
+namespace phi {
+namespace tests {
+
+using funcs::KVCacheBlockCopy;
+using funcs::PagedKVCache;
+
+TEST(PagedKVCache, fork_and_copy_on_write) {
+  PagedKVCache cache(4, 4);
+  std::vector<KVCacheBlockCopy> copies;
+  cache.AddSequence(0);
+  cache.Append(0, 6, &copies);
+  EXPECT_EQ(cache.BlockTable(0), std::vector<int32_t>({0, 1}));
+  EXPECT_EQ(cache.NumFreeBlocks(), 2);
+  EXPECT_TRUE(copies.empty());
+
+  // the child shares both blocks, writing the last one copies it
+  cache.ForkSequence(0, 1);
+  EXPECT_EQ(cache.RefCount(0), 2);
+  EXPECT_EQ(cache.RefCount(1), 2);
+  EXPECT_EQ(cache.BlocksToAppend(1, 1), 1);
+  cache.Append(1, 1, &copies);
+  ASSERT_EQ(copies.size(), 1UL);
+  EXPECT_EQ(copies[0].src, 1);
+  EXPECT_EQ(copies[0].dst, 2);
+  EXPECT_EQ(cache.BlockTable(1), std::vector<int32_t>({0, 2}));
+  EXPECT_EQ(cache.RefCount(1), 1);
+  EXPECT_EQ(cache.SequenceLength(1), 7);
+
+  cache.Append(1, 2, &copies);
+  EXPECT_EQ(cache.BlockTable(1), std::vector<int32_t>({0, 2, 3}));
+  EXPECT_EQ(cache.NumFreeBlocks(), 0);
+  EXPECT_EQ(copies.size(), 1UL);
+
+  // no free block left, nothing changes
+  EXPECT_THROW(cache.Append(0, 3, &copies), common::enforce::EnforceNotMet);
+  EXPECT_EQ(cache.SequenceLength(0), 6);
+  EXPECT_EQ(cache.BlockTable(0).size(), 2UL);
+  EXPECT_THROW(cache.AddSequence(0), common::enforce::EnforceNotMet);
+
+  cache.FreeSequence(1);
+  EXPECT_FALSE(cache.HasSequence(1));
+  EXPECT_EQ(cache.NumFreeBlocks(), 2);
+  EXPECT_EQ(cache.RefCount(0), 1);
+  std::vector<int32_t> tables(2 * 3);
+  cache.AddSequence(5);
+  cache.FillBlockTables({0, 5}, 3, tables.data());
+  EXPECT_EQ(tables, std::vector<int32_t>({0, 1, -1, -1, -1, -1}));
+  EXPECT_THROW(cache.FillBlockTables({0}, 1, tables.data()),
+               common::enforce::EnforceNotMet);
+}
+
+namespace {
+
+constexpr int64_t kNumHeads = 4;
+constexpr int64_t kNumHeadsK = 2;
+constexpr int64_t kHeadDim = 16;
+constexpr int64_t kStride = (kNumHeads + 2 * kNumHeadsK) * kHeadDim;
+constexpr int64_t kBlockSize = 4;
+constexpr int64_t kRopeSeqLen = 32;
+
+// The raw qkv rows of a sequence, processed up to length.
+struct TestSequence {
+  int64_t id;
+  int64_t prompt;
+  std::vector<float> rows;
+  int64_t length = 0;
+};
+
+std::vector<float> RandomFloats(int64_t numel, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-1.f, 1.f);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+// The rows with the bias and the rotary embedding, in double.
+std::vector<double> ReferenceQKV(const std::vector<float>& rows,
+                                 const std::vector<float>& bias,
+                                 const std::vector<float>& rope,
+                                 bool neox) {
+  const int64_t half = kHeadDim / 2;
+  std::vector<double> x(rows.size());
+  for (size_t i = 0; i < rows.size(); ++i) {
+    x[i] = static_cast<double>(rows[i]) + bias[i % kStride];
+  }
+  for (int64_t t = 0; t < static_cast<int64_t>(rows.size()) / kStride; ++t) {
+    for (int64_t h = 0; h < kNumHeads + kNumHeadsK; ++h) {
+      double* head = x.data() + t * kStride + h * kHeadDim;
+      for (int64_t i = 0; i < half; ++i) {
+        double cos = rope[t * half + i];
+        double sin = rope[(kRopeSeqLen + t) * half + i];
+        double& x0 = head[neox ? i : 2 * i];
+        double& x1 = head[neox ? i + half : 2 * i + 1];
+        double y0 = x0 * cos - x1 * sin;
+        double y1 = x1 * cos + x0 * sin;
+        x0 = y0;
+        x1 = y1;
+      }
+    }
+  }
+  return x;
+}
+
+// The attention of the query at pos to the keys 0..pos.
+std::vector<double> ReferenceAttention(const std::vector<double>& x,
+                                       int64_t pos) {
+  const int64_t group = kNumHeads / kNumHeadsK;
+  std::vector<double> out(kNumHeads * kHeadDim, 0.);
+  for (int64_t h = 0; h < kNumHeads; ++h) {
+    const double* q = x.data() + pos * kStride + h * kHeadDim;
+    const int64_t k_offset = (kNumHeads + h / group) * kHeadDim;
+    const int64_t v_offset = k_offset + kNumHeadsK * kHeadDim;
+    std::vector<double> s(pos + 1);
+    double max = -INFINITY;
+    for (int64_t j = 0; j <= pos; ++j) {
+      double dot = 0;
+      for (int64_t c = 0; c < kHeadDim; ++c) {
+        dot += q[c] * x[j * kStride + k_offset + c];
+      }
+      s[j] = dot / std::sqrt(static_cast<double>(kHeadDim));
+      max = std::max(max, s[j]);
+    }
+    double sum = 0;
+    for (int64_t j = 0; j <= pos; ++j) {
+      s[j] = std::exp(s[j] - max);
+      sum += s[j];
+    }
+    for (int64_t j = 0; j <= pos; ++j) {
+      for (int64_t c = 0; c < kHeadDim; ++c) {
+        out[h * kHeadDim + c] += s[j] / sum * x[j * kStride + v_offset + c];
+      }
+    }
+  }
+  return out;
+}
+
+}  // namespace
+
+// Prefills and decoding steps in one batch, a forked sequence copying the
+// shared block, against the attention over the whole sequences.
+TEST(BlockAttnCPU, prefill_and_decode) {
+  for (bool neox : {false, true}) {
+    CPUContext dev_ctx;
+    PagedKVCache cache(64, kBlockSize);
+    const int64_t max_blocks_per_seq = 8;
+    const int64_t block_numel = kNumHeadsK * kBlockSize * kHeadDim;
+    std::vector<float> key_cache(64 * block_numel);
+    std::vector<float> value_cache(64 * block_numel);
+    std::vector<float> bias = RandomFloats(kStride, 1);
+    std::vector<float> rope(2 * kRopeSeqLen * kHeadDim / 2);
+    for (int64_t t = 0; t < kRopeSeqLen; ++t) {
+      for (int64_t i = 0; i < kHeadDim / 2; ++i) {
+        double angle = t * std::pow(10000., -2. * i / kHeadDim);
+        rope[t * kHeadDim / 2 + i] = std::cos(angle);
+        rope[(kRopeSeqLen + t) * kHeadDim / 2 + i] = std::sin(angle);
+      }
+    }
+
+    // the sequence 0 prefills 7 tokens, the sequence 1 forks it after the
+    // prefill and the sequence 2 prefills 5 tokens at the step 2
+    std::vector<TestSequence> seqs = {{0, 7, RandomFloats(16 * kStride, 2)},
+                                      {1, 0, RandomFloats(16 * kStride, 3)},
+                                      {2, 5, RandomFloats(16 * kStride, 4)}};
+    std::copy(seqs[0].rows.begin(),
+              seqs[0].rows.begin() + 7 * kStride,
+              seqs[1].rows.begin());
+    for (int step = 0; step < 6; ++step) {
+      if (step == 1) {
+        cache.ForkSequence(0, 1);
+        seqs[1].length = 7;
+      }
+      if (step == 0 || step == 2) {
+        cache.AddSequence(step == 0 ? 0 : 2);
+      }
+      std::vector<int64_t> ids;
+      std::vector<int32_t> encoder, decoder, this_time, cu_seqlens_q = {0};
+      std::vector<float> qkv;
+      std::vector<KVCacheBlockCopy> copies;
+      for (auto& seq : seqs) {
+        if (!cache.HasSequence(seq.id)) {
+          continue;
+        }
+        bool prefill = seq.length == 0;
+        int64_t n = prefill ? seq.prompt : 1;
+        ids.push_back(seq.id);
+        encoder.push_back(prefill ? n : 0);
+        decoder.push_back(prefill ? 0 : seq.length);
+        this_time.push_back(n);
+        cu_seqlens_q.push_back(cu_seqlens_q.back() + n);
+        qkv.insert(qkv.end(),
+                   seq.rows.begin() + seq.length * kStride,
+                   seq.rows.begin() + (seq.length + n) * kStride);
+        cache.Append(seq.id, n, &copies);
+      }
+      // the first decoding step of the fork copies the shared block
+      EXPECT_EQ(copies.size(), step == 1 ? 1UL : 0UL);
+      funcs::CopyKVCacheBlocks(copies,
+                               block_numel * sizeof(float),
+                               key_cache.data(),
+                               value_cache.data());
+      std::vector<int32_t> block_tables(ids.size() * max_blocks_per_seq);
+      cache.FillBlockTables(ids, max_blocks_per_seq, block_tables.data());
+
+      funcs::BlockAttnCPUParams p;
+      p.batch_size = static_cast<int64_t>(ids.size());
+      p.num_heads = kNumHeads;
+      p.num_heads_k = kNumHeadsK;
+      p.head_dim = kHeadDim;
+      p.block_size = kBlockSize;
+      p.num_blocks = 64;
+      p.max_blocks_per_seq = max_blocks_per_seq;
+      p.seq_lens_encoder = encoder.data();
+      p.seq_lens_decoder = decoder.data();
+      p.seq_lens_this_time = this_time.data();
+      p.cu_seqlens_q = cu_seqlens_q.data();
+      p.block_tables = block_tables.data();
+      p.rope_emb = rope.data();
+      p.rope_seq_len = kRopeSeqLen;
+      p.use_neox_style = neox;
+      std::vector<float> out(cu_seqlens_q.back() * kNumHeads * kHeadDim);
+      funcs::BlockAttnCPUForward(dev_ctx,
+                                 p,
+                                 bias.data(),
+                                 nullptr,
+                                 nullptr,
+                                 qkv.data(),
+                                 key_cache.data(),
+                                 value_cache.data(),
+                                 out.data());
+
+      int64_t token = 0;
+      for (auto& seq : seqs) {
+        if (!cache.HasSequence(seq.id)) {
+          continue;
+        }
+        int64_t end = cache.SequenceLength(seq.id);
+        std::vector<float> rows(seq.rows.begin(),
+                                seq.rows.begin() + end * kStride);
+        std::vector<double> x = ReferenceQKV(rows, bias, rope, neox);
+        for (int64_t pos = seq.length; pos < end; ++pos, ++token) {
+          std::vector<double> expect = ReferenceAttention(x, pos);
+          for (int64_t c = 0; c < kNumHeads * kHeadDim; ++c) {
+            ASSERT_NEAR(out[token * kNumHeads * kHeadDim + c], expect[c], 1e-4)
+                << "step " << step << " sequence " << seq.id << " pos "
+                << pos;
+          }
+        }
+        seq.length = end;
+      }
+    }
+  }
+}
+
+// The blocks out of the caches and the blocks not allocated are refused
+// before the caches are written.
+TEST(BlockAttnCPU, block_tables_out_of_range) {
+  CPUContext dev_ctx;
+  const int64_t num_blocks = 4;
+  const int64_t max_blocks_per_seq = 2;
+  const int64_t block_numel = kNumHeadsK * kBlockSize * kHeadDim;
+  std::vector<float> key_cache(num_blocks * block_numel, 0.f);
+  std::vector<float> value_cache(num_blocks * block_numel, 0.f);
+  // the sequence 1 decodes the token kBlockSize, in its second block
+  std::vector<int32_t> encoder = {3, 0};
+  std::vector<int32_t> decoder = {0, static_cast<int32_t>(kBlockSize)};
+  std::vector<int32_t> this_time = {3, 1};
+  std::vector<int32_t> cu_seqlens_q = {0, 3, 4};
+  std::vector<float> qkv = RandomFloats(4 * kStride, 1);
+  std::vector<float> out(4 * kNumHeads * kHeadDim);
+
+  funcs::BlockAttnCPUParams p;
+  p.batch_size = 2;
+  p.num_heads = kNumHeads;
+  p.num_heads_k = kNumHeadsK;
+  p.head_dim = kHeadDim;
+  p.block_size = kBlockSize;
+  p.num_blocks = num_blocks;
+  p.max_blocks_per_seq = max_blocks_per_seq;
+  p.seq_lens_encoder = encoder.data();
+  p.seq_lens_decoder = decoder.data();
+  p.seq_lens_this_time = this_time.data();
+  p.cu_seqlens_q = cu_seqlens_q.data();
+  auto forward = [&](std::vector<int32_t> block_tables) {
+    p.block_tables = block_tables.data();
+    funcs::BlockAttnCPUForward(dev_ctx,
+                               p,
+                               nullptr,
+                               nullptr,
+                               nullptr,
+                               qkv.data(),
+                               key_cache.data(),
+                               value_cache.data(),
+                               out.data());
+  };
+
+  forward({0, -1, 1, 2});
+  std::fill(key_cache.begin(), key_cache.end(), 0.f);
+  std::fill(value_cache.begin(), value_cache.end(), 0.f);
+  ASSERT_ANY_THROW(forward({0, -1, 1, static_cast<int32_t>(num_blocks)}));
+  ASSERT_ANY_THROW(forward({4096, -1, 1, 2}));
+  // the sentinel of a block the sequence reaches
+  ASSERT_ANY_THROW(forward({0, -1, 1, -1}));
+  decoder[1] = -1;
+  ASSERT_ANY_THROW(forward({0, -1, 1, 2}));
+  for (int64_t i = 0; i < num_blocks * block_numel; ++i) {
+    ASSERT_EQ(key_cache[i], 0.f);
+    ASSERT_EQ(value_cache[i], 0.f);
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
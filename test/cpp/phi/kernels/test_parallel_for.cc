@@ -0,0 +1,152 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/backends/cpu/intra_op_thread_pool.h"
+#include "paddle/phi/core/enforce.h"
+#include "paddle/phi/kernels/funcs/parallel_for.h"
+
+namespace phi {
+namespace tests {
+
+TEST(IntraOpThreadPool, parallel_for) {
+  IntraOpThreadPool pool(4);
+  CPUContext dev_ctx;
+  dev_ctx.SetIntraOpThreadPool(&pool);
+  EXPECT_EQ(dev_ctx.GetIntraOpThreadPool(), &pool);
+
+  const int64_t n = 100003;
+  std::vector<int> visits(n, 0);
+  std::atomic<int> num_chunks{0};
+  funcs::ParallelFor(dev_ctx, 0, n, 1000, [&](int64_t begin, int64_t end) {
+    ++num_chunks;
+    for (int64_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  for (int64_t i = 0; i < n; ++i) {
+    ASSERT_EQ(visits[i], 1) << i;
+  }
+  EXPECT_EQ(num_chunks.load(), 4);
+
+  // small loops are not split
+  num_chunks = 0;
+  funcs::ParallelFor(dev_ctx, 0, 10, 1000, [&](int64_t begin, int64_t end) {
+    ++num_chunks;
+    EXPECT_EQ(begin, 0);
+    EXPECT_EQ(end, 10);
+  });
+  EXPECT_EQ(num_chunks.load(), 1);
+
+  // the budget of the calling thread limits the chunks
+  SetIntraOpNumThreads(2);
+  num_chunks = 0;
+  funcs::ParallelFor(
+      dev_ctx, 0, n, 1, [&](int64_t begin, int64_t end) { ++num_chunks; });
+  EXPECT_EQ(num_chunks.load(), 2);
+  SetIntraOpNumThreads(0);
+  dev_ctx.SetIntraOpThreadPool(nullptr);
+  EXPECT_EQ(dev_ctx.GetIntraOpThreadPool(), IntraOpThreadPool::GetInstance());
+}
+
+TEST(IntraOpThreadPool, parallel_reduce) {
+  IntraOpThreadPool pool(3);
+  CPUContext dev_ctx;
+  dev_ctx.SetIntraOpThreadPool(&pool);
+  auto sum = [&](int64_t n) {
+    return funcs::ParallelReduce(
+        dev_ctx,
+        0,
+        n,
+        16,
+        int64_t(0),
+        [](int64_t begin, int64_t end, int64_t init) {
+          for (int64_t i = begin; i < end; ++i) {
+            init += i;
+          }
+          return init;
+        },
+        [](int64_t a, int64_t b) { return a + b; });
+  };
+  EXPECT_EQ(sum(0), 0);
+  EXPECT_EQ(sum(10), 45);
+  EXPECT_EQ(sum(100000), int64_t(100000) * 99999 / 2);
+}
+
+TEST(IntraOpThreadPool, nested_and_concurrent) {
+  IntraOpThreadPool pool(4);
+  CPUContext dev_ctx;
+  dev_ctx.SetIntraOpThreadPool(&pool);
+  // a nested loop runs serially on the thread of its outer chunk
+  std::atomic<int64_t> total{0};
+  funcs::ParallelFor(dev_ctx, 0, 8, 1, [&](int64_t begin, int64_t end) {
+    EXPECT_TRUE(IntraOpThreadPool::InParallelRegion());
+    funcs::ParallelFor(dev_ctx, 0, 1000, 1, [&](int64_t b, int64_t e) {
+      EXPECT_EQ(b, 0);
+      EXPECT_EQ(e, 1000);
+      total += (end - begin) * (e - b);
+    });
+  });
+  EXPECT_FALSE(IntraOpThreadPool::InParallelRegion());
+  EXPECT_EQ(total.load(), 8000);
+
+  // several threads share the pool
+  std::vector<std::thread> callers;
+  std::atomic<int64_t> count{0};
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&] {
+      for (int r = 0; r < 100; ++r) {
+        funcs::ParallelFor(dev_ctx, 0, 4096, 64, [&](int64_t b, int64_t e) {
+          count += e - b;
+        });
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(count.load(), 4 * 100 * 4096);
+}
+
+TEST(IntraOpThreadPool, exception) {
+  IntraOpThreadPool pool(4);
+  CPUContext dev_ctx;
+  dev_ctx.SetIntraOpThreadPool(&pool);
+  EXPECT_THROW(
+      funcs::ParallelFor(dev_ctx,
+                         0,
+                         100,
+                         1,
+                         [&](int64_t begin, int64_t end) {
+                           PADDLE_ENFORCE_LT(
+                               begin,
+                               50,
+                               phi::errors::InvalidArgument("out of range"));
+                         }),
+      common::enforce::EnforceNotMet);
+  // the pool still works afterwards
+  std::atomic<int64_t> count{0};
+  funcs::ParallelFor(
+      dev_ctx, 0, 100, 1, [&](int64_t b, int64_t e) { count += e - b; });
+  EXPECT_EQ(count.load(), 100);
+}
+
+}  // namespace tests
+}  // namespace phi
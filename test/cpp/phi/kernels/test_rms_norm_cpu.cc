@@ -0,0 +1,205 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/data_type.h"
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/kernel_context.h"
+#include "paddle/phi/core/kernel_factory.h"
+#include "paddle/phi/core/meta_tensor.h"
+#include "paddle/phi/infermeta/multiary.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+template <typename T>
+std::vector<T> RandomValues(int64_t numel, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> dist(-2., 2.);
+  std::vector<T> data(numel);
+  for (auto& v : data) {
+    v = static_cast<T>(dist(rng));
+  }
+  return data;
+}
+
+template <typename T>
+DenseTensor MakeTensor(const std::vector<T>& data,
+                       const std::vector<int64_t>& dims) {
+  auto& pool = phi::DeviceContextPool::Instance();
+  const auto& dev_ctx =
+      *static_cast<const CPUContext*>(pool.GetByPlace(phi::CPUPlace()));
+  DenseTensor tensor;
+  tensor.Resize(common::make_ddim(dims));
+  T* ptr = dev_ctx.template Alloc<T>(&tensor);
+  std::copy(data.begin(), data.end(), ptr);
+  return tensor;
+}
+
+struct RmsNormInputs {
+  std::vector<int64_t> dims;
+  int begin_norm_axis = 1;
+  bool with_residual = false;
+  bool with_norm_bias = false;
+};
+
+// Runs the rms_norm kernel registered for CPU, like the op does, and checks
+// out (and residual_out) against the float64 rms_norm of the rows of
+// cols = prod(dims[begin_norm_axis:]) elements.
+template <typename T>
+void CheckRmsNorm(const RmsNormInputs& in, double tol) {
+  int64_t rows = 1;
+  int64_t cols = 1;
+  for (int i = 0; i < static_cast<int>(in.dims.size()); ++i) {
+    (i < in.begin_norm_axis ? rows : cols) *= in.dims[i];
+  }
+  const float epsilon = 1e-6f;
+  std::vector<T> x_data = RandomValues<T>(rows * cols, 1);
+  std::vector<T> residual_data = RandomValues<T>(rows * cols, 2);
+  std::vector<T> bias_data = RandomValues<T>(cols, 3);
+  std::vector<T> weight_data = RandomValues<T>(cols, 4);
+  std::vector<T> norm_bias_data = RandomValues<T>(cols, 5);
+  DenseTensor x = MakeTensor(x_data, in.dims);
+  DenseTensor residual = MakeTensor(residual_data, in.dims);
+  DenseTensor bias = MakeTensor(bias_data, {cols});
+  DenseTensor weight = MakeTensor(weight_data, {cols});
+  DenseTensor norm_bias = MakeTensor(norm_bias_data, {cols});
+
+  DenseTensor out;
+  DenseTensor residual_out;
+  DenseTensor inv_var;
+  MetaTensor meta_out(&out);
+  MetaTensor meta_residual_out(&residual_out);
+  MetaTensor meta_inv_var(&inv_var);
+  RmsNormInferMeta(x,
+                   in.with_residual ? MetaTensor(bias) : MetaTensor(),
+                   in.with_residual ? MetaTensor(residual) : MetaTensor(),
+                   weight,
+                   in.with_norm_bias ? MetaTensor(norm_bias) : MetaTensor(),
+                   epsilon,
+                   in.begin_norm_axis,
+                   -1.f,
+                   0,
+                   0.f,
+                   0.f,
+                   &meta_out,
+                   &meta_residual_out,
+                   &meta_inv_var);
+
+  auto kernel_result = KernelFactory::Instance().SelectKernelOrThrowError(
+      "rms_norm",
+      {Backend::CPU, DataLayout::ALL_LAYOUT, CppTypeToDataType<T>::Type()});
+  auto& pool = phi::DeviceContextPool::Instance();
+  KernelContext ctx(pool.Get(phi::CPUPlace()));
+  ctx.EmplaceBackInput(&x);
+  ctx.EmplaceBackInput(in.with_residual ? &bias : nullptr);
+  ctx.EmplaceBackInput(in.with_residual ? &residual : nullptr);
+  ctx.EmplaceBackInput(&weight);
+  ctx.EmplaceBackInput(in.with_norm_bias ? &norm_bias : nullptr);
+  ctx.EmplaceBackAttr(epsilon);
+  ctx.EmplaceBackAttr(in.begin_norm_axis);
+  ctx.EmplaceBackAttr(-1.f);
+  ctx.EmplaceBackAttr(0);
+  ctx.EmplaceBackAttr(0.f);
+  ctx.EmplaceBackAttr(0.f);
+  ctx.EmplaceBackOutput(&out);
+  ctx.EmplaceBackOutput(in.with_residual ? &residual_out : nullptr);
+  ctx.EmplaceBackOutput(&inv_var);
+  kernel_result.kernel(&ctx);
+
+  ASSERT_EQ(out.dims(), x.dims());
+  const T* y = out.data<T>();
+  for (int64_t r = 0; r < rows; ++r) {
+    std::vector<double> row(cols);
+    for (int64_t j = 0; j < cols; ++j) {
+      row[j] = x_data[r * cols + j];
+      if (in.with_residual) {
+        row[j] += static_cast<double>(residual_data[r * cols + j]) +
+                  static_cast<double>(bias_data[j]);
+        ASSERT_NEAR(residual_out.data<T>()[r * cols + j], row[j], tol);
+      }
+    }
+    double sum = 0.;
+    for (double v : row) {
+      sum += v * v;
+    }
+    double inv_rms = 1. / std::sqrt(sum / cols + epsilon);
+    for (int64_t j = 0; j < cols; ++j) {
+      double expect = row[j] * inv_rms * weight_data[j];
+      if (in.with_norm_bias) {
+        expect += norm_bias_data[j];
+      }
+      ASSERT_NEAR(y[r * cols + j], expect, tol)
+          << "row " << r << " col " << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(DEV_API, rms_norm_cpu) {
+  // cols below and above a block of the jit kernel, and a rest
+  CheckRmsNorm<float>({{7, 5}, 1, false, false}, 1e-5);
+  CheckRmsNorm<float>({{7, 300}, 1, false, false}, 1e-5);
+  CheckRmsNorm<float>({{2, 3, 4, 10}, 2, false, false}, 1e-5);
+  CheckRmsNorm<double>({{7, 300}, 1, false, false}, 1e-10);
+}
+
+TEST(DEV_API, rms_norm_cpu_residual_and_bias) {
+  CheckRmsNorm<float>({{9, 77}, 1, true, false}, 1e-5);
+  CheckRmsNorm<float>({{9, 77}, 1, false, true}, 1e-5);
+  CheckRmsNorm<float>({{3, 3, 64}, 2, true, true}, 1e-5);
+  CheckRmsNorm<double>({{9, 77}, 1, true, true}, 1e-10);
+}
+
+TEST(DEV_API, rms_norm_cpu_quant) {
+  DenseTensor x = MakeTensor(RandomValues<float>(2 * 8, 1), {2, 8});
+  DenseTensor weight = MakeTensor(RandomValues<float>(8, 2), {8});
+  auto kernel_result = KernelFactory::Instance().SelectKernelOrThrowError(
+      "rms_norm", {Backend::CPU, DataLayout::ALL_LAYOUT, DataType::FLOAT32});
+  auto& pool = phi::DeviceContextPool::Instance();
+  KernelContext ctx(pool.Get(phi::CPUPlace()));
+  ctx.EmplaceBackInput(&x);
+  ctx.EmplaceBackInput(nullptr);
+  ctx.EmplaceBackInput(nullptr);
+  ctx.EmplaceBackInput(&weight);
+  ctx.EmplaceBackInput(nullptr);
+  ctx.EmplaceBackAttr(1e-6f);
+  ctx.EmplaceBackAttr(1);
+  ctx.EmplaceBackAttr(1.f);
+  ctx.EmplaceBackAttr(0);
+  ctx.EmplaceBackAttr(127.f);
+  ctx.EmplaceBackAttr(-127.f);
+  DenseTensor out;
+  DenseTensor inv_var;
+  out.Resize(x.dims());
+  ctx.EmplaceBackOutput(&out);
+  ctx.EmplaceBackOutput(nullptr);
+  ctx.EmplaceBackOutput(&inv_var);
+  // the int8 output of quant_scale > 0 is only on the AVX-512 kernel
+  ASSERT_ANY_THROW(kernel_result.kernel(&ctx));
+}
+
+}  // namespace tests
+}  // namespace phi
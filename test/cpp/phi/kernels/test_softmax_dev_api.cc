@@ -0,0 +1,139 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/kernels/log_softmax_kernel.h"
+#include "paddle/phi/kernels/softmax_kernel.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+const int64_t kRows = 6;
+const int64_t kClasses = 300;
+
+// rows of logits, the last ones far below the max of their row: e^-64 and
+// less is lost in the float sum, but not in the log softmax
+std::vector<float> MakeLogits() {
+  std::mt19937 rng(2024);
+  std::uniform_real_distribution<float> dist(-10.f, 10.f);
+  std::vector<float> x(kRows * kClasses);
+  for (auto& v : x) {
+    v = dist(rng);
+  }
+  for (int64_t j = 0; j < kClasses; ++j) {
+    x[4 * kClasses + j] = j == 7 ? 100.f : -50.f + 0.1f * j;
+    x[5 * kClasses + j] = j % 3 == 0 ? -1e4f : 0.5f * dist(rng);
+  }
+  return x;
+}
+
+// the softmax or log softmax of x [rows, classes] along axis, of a tensor
+// [rows, classes] or of its transpose [classes, rows] with axis 0
+std::vector<float> RunKernel(const std::vector<float>& x,
+                             bool transpose,
+                             bool log) {
+  auto& pool = phi::DeviceContextPool::Instance();
+  const auto& dev_ctx =
+      *static_cast<const CPUContext*>(pool.GetByPlace(phi::CPUPlace()));
+  DenseTensor in;
+  in.Resize(transpose ? common::make_ddim({kClasses, kRows})
+                      : common::make_ddim({kRows, kClasses}));
+  float* in_data = dev_ctx.template Alloc<float>(&in);
+  for (int64_t r = 0; r < kRows; ++r) {
+    for (int64_t j = 0; j < kClasses; ++j) {
+      int64_t i = transpose ? j * kRows + r : r * kClasses + j;
+      in_data[i] = x[r * kClasses + j];
+    }
+  }
+  DenseTensor out;
+  out.Resize(in.dims());
+  int axis = transpose ? 0 : -1;
+  if (log) {
+    LogSoftmaxKernel<float, CPUContext>(dev_ctx, in, axis, &out);
+  } else {
+    SoftmaxKernel<float, CPUContext>(dev_ctx, in, axis, &out);
+  }
+  const float* out_data = out.data<float>();
+  std::vector<float> y(kRows * kClasses);
+  for (int64_t r = 0; r < kRows; ++r) {
+    for (int64_t j = 0; j < kClasses; ++j) {
+      int64_t i = transpose ? j * kRows + r : r * kClasses + j;
+      y[r * kClasses + j] = out_data[i];
+    }
+  }
+  return y;
+}
+
+std::vector<double> Reference(const std::vector<float>& x, bool log) {
+  std::vector<double> y(x.size());
+  for (int64_t r = 0; r < kRows; ++r) {
+    const float* row = x.data() + r * kClasses;
+    double max = *std::max_element(row, row + kClasses);
+    double sum = 0.;
+    for (int64_t j = 0; j < kClasses; ++j) {
+      sum += std::exp(row[j] - max);
+    }
+    for (int64_t j = 0; j < kClasses; ++j) {
+      double shifted = row[j] - max;
+      y[r * kClasses + j] =
+          log ? shifted - std::log(sum) : std::exp(shifted) / sum;
+    }
+  }
+  return y;
+}
+
+}  // namespace
+
+// The last axis runs the jit kernel for float (with xbyak), the first axis
+// of the transpose the Eigen one: both give the unclipped log softmax.
+TEST(DEV_API, log_softmax_jit_and_eigen) {
+  std::vector<float> x = MakeLogits();
+  std::vector<float> jit = RunKernel(x, false, true);
+  std::vector<float> eigen = RunKernel(x, true, true);
+  std::vector<double> ref = Reference(x, true);
+  for (size_t i = 0; i < x.size(); ++i) {
+    double tol = 1e-5 * std::max(1., std::fabs(ref[i]));
+    ASSERT_NEAR(jit[i], ref[i], tol) << "at " << i;
+    ASSERT_NEAR(eigen[i], ref[i], tol) << "at " << i;
+  }
+  // the gap of 150 to the max of the row 4
+  EXPECT_NEAR(jit[4 * kClasses], -150., 1e-3);
+  EXPECT_NEAR(eigen[4 * kClasses], -150., 1e-3);
+}
+
+TEST(DEV_API, softmax_jit_and_eigen) {
+  std::vector<float> x = MakeLogits();
+  std::vector<float> jit = RunKernel(x, false, false);
+  std::vector<float> eigen = RunKernel(x, true, false);
+  std::vector<double> ref = Reference(x, false);
+  for (size_t i = 0; i < x.size(); ++i) {
+    ASSERT_NEAR(jit[i], ref[i], 1e-6) << "at " << i;
+    ASSERT_NEAR(eigen[i], ref[i], 1e-6) << "at " << i;
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
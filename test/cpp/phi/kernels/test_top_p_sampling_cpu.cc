@@ -0,0 +1,274 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/kernels/funcs/top_p_sampling_cpu.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+using funcs::TopPSamplingCPUParams;
+
+std::vector<float> RandomLogits(int64_t numel, float scale, int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> dist(0.f, scale);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+std::vector<double> Softmax(const float* logits, int64_t n) {
+  double max = *std::max_element(logits, logits + n);
+  std::vector<double> probs(n);
+  double sum = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    probs[i] = std::exp(logits[i] - max);
+    sum += probs[i];
+  }
+  for (auto& p : probs) {
+    p /= sum;
+  }
+  return probs;
+}
+
+// The ids of the nucleus of probs: the fewest most probable tokens holding
+// top_p of the probability.
+std::vector<int64_t> Nucleus(const std::vector<double>& probs, double top_p) {
+  std::vector<int64_t> order(probs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+    return probs[a] > probs[b];
+  });
+  double sum = 0;
+  size_t n = 0;
+  while (n < order.size() && sum < top_p - 1e-6) {
+    sum += probs[order[n++]];
+  }
+  order.resize(n);
+  return order;
+}
+
+// Samples the same row of x batch_size times and returns the ids.
+std::vector<int64_t> SampleRepeated(const TopPSamplingCPUParams& base,
+                                    const std::vector<float>& row,
+                                    float top_p,
+                                    int64_t batch_size,
+                                    std::vector<float>* probs = nullptr) {
+  CPUContext dev_ctx;
+  TopPSamplingCPUParams params = base;
+  params.batch_size = batch_size;
+  params.vocab_size = row.size();
+  std::vector<float> x;
+  for (int64_t i = 0; i < batch_size; ++i) {
+    x.insert(x.end(), row.begin(), row.end());
+  }
+  std::vector<float> top_ps(batch_size, top_p);
+  std::vector<float> out(batch_size);
+  std::vector<int64_t> ids(batch_size, -1);
+  funcs::TopPSamplingCPU(dev_ctx,
+                         params,
+                         x.data(),
+                         top_ps.data(),
+                         nullptr,
+                         out.data(),
+                         ids.data());
+  if (probs) {
+    *probs = out;
+  }
+  return ids;
+}
+
+}  // namespace
+
+TEST(TopPSamplingCPU, greedy_with_top_k_1) {
+  const int64_t vocab = 50000;
+  auto logits = RandomLogits(vocab, 3.f, 1);
+  TopPSamplingCPUParams params;
+  params.is_logits = true;
+  params.top_k = 1;
+  std::vector<float> probs;
+  auto ids = SampleRepeated(params, logits, 0.9f, 4, &probs);
+  int64_t argmax =
+      std::max_element(logits.begin(), logits.end()) - logits.begin();
+  auto expected = Softmax(logits.data(), vocab);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(ids[i], argmax);
+    EXPECT_NEAR(probs[i], expected[argmax], 1e-5);
+  }
+}
+
+TEST(TopPSamplingCPU, penalties) {
+  std::vector<float> logits = {1.f, 4.f, 3.5f, 3.f, -2.f};
+  TopPSamplingCPUParams params;
+  params.is_logits = true;
+  params.top_k = 1;
+  std::vector<int64_t> pre_ids = {1, -1, 1};
+  params.pre_ids = pre_ids.data();
+  params.pre_ids_len = pre_ids.size();
+
+  // 4 / 2 = 2 < 3.5
+  params.repetition_penalty = 2.f;
+  EXPECT_EQ(SampleRepeated(params, logits, 1.f, 1)[0], 2);
+
+  // 4 - 0.4 = 3.6 > 3.5
+  params.repetition_penalty = 1.f;
+  params.presence_penalty = 0.4f;
+  EXPECT_EQ(SampleRepeated(params, logits, 1.f, 1)[0], 1);
+
+  // 4 - 1 = 3 < 3.5, and the probability is of the penalized scores
+  params.presence_penalty = 1.f;
+  std::vector<float> probs;
+  EXPECT_EQ(SampleRepeated(params, logits, 1.f, 1, &probs)[0], 2);
+  std::vector<float> penalized = {1.f, 3.f, 3.5f, 3.f, -2.f};
+  EXPECT_NEAR(probs[0], Softmax(penalized.data(), 5)[2], 1e-5);
+}
+
+TEST(TopPSamplingCPU, nucleus_distribution) {
+  // probabilities 0.4, 0.3, 0.2, 0.05, 0.05: top_p 0.75 keeps three tokens
+  std::vector<float> probs = {0.05f, 0.3f, 0.05f, 0.4f, 0.2f};
+  TopPSamplingCPUParams params;
+  params.seed = 2024;
+  const int64_t batch_size = 20000;
+  std::vector<float> out;
+  auto ids = SampleRepeated(params, probs, 0.75f, batch_size, &out);
+  std::vector<int64_t> counts(probs.size(), 0);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    ASSERT_TRUE(ids[i] == 1 || ids[i] == 3 || ids[i] == 4) << ids[i];
+    EXPECT_FLOAT_EQ(out[i], probs[ids[i]]);
+    ++counts[ids[i]];
+  }
+  EXPECT_NEAR(counts[3] / static_cast<double>(batch_size), 0.4 / 0.9, 0.02);
+  EXPECT_NEAR(counts[1] / static_cast<double>(batch_size), 0.3 / 0.9, 0.02);
+  EXPECT_NEAR(counts[4] / static_cast<double>(batch_size), 0.2 / 0.9, 0.02);
+
+  // the same seed draws the same tokens
+  EXPECT_EQ(ids, SampleRepeated(params, probs, 0.75f, batch_size));
+}
+
+TEST(TopPSamplingCPU, large_nucleus_grows_the_selection) {
+  // a flat distribution, the nucleus has thousands of tokens
+  const int64_t vocab = 100000;
+  auto logits = RandomLogits(vocab, 0.5f, 2);
+  auto probs = Softmax(logits.data(), vocab);
+  auto nucleus = Nucleus(probs, 0.9);
+  ASSERT_GT(nucleus.size(), 1000u);
+  std::vector<bool> in_nucleus(vocab, false);
+  for (int64_t id : nucleus) {
+    in_nucleus[id] = true;
+  }
+  TopPSamplingCPUParams params;
+  params.is_logits = true;
+  params.seed = 7;
+  auto ids = SampleRepeated(params, logits, 0.9f, 64);
+  for (int64_t id : ids) {
+    ASSERT_GE(id, 0);
+    ASSERT_LT(id, vocab);
+    EXPECT_TRUE(in_nucleus[id]) << id;
+  }
+}
+
+TEST(TopPSamplingCPU, top_k_and_temperature) {
+  const int64_t vocab = 30000;
+  auto logits = RandomLogits(vocab, 2.f, 3);
+  std::vector<int64_t> order(vocab);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int64_t a, int64_t b) {
+    return logits[a] > logits[b];
+  });
+  std::vector<bool> in_top_k(vocab, false);
+  for (int i = 0; i < 20; ++i) {
+    in_top_k[order[i]] = true;
+  }
+  TopPSamplingCPUParams params;
+  params.is_logits = true;
+  params.top_k = 20;
+  params.temperature = 0.7f;
+  std::vector<float> probs;
+  auto ids = SampleRepeated(params, logits, 1.f, 256, &probs);
+  std::vector<float> scaled(logits);
+  for (auto& v : scaled) {
+    v /= 0.7f;
+  }
+  auto expected = Softmax(scaled.data(), vocab);
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_TRUE(in_top_k[ids[i]]) << ids[i];
+    EXPECT_NEAR(probs[i], expected[ids[i]], 1e-5);
+  }
+}
+
+TEST(TopPSamplingCPU, threshold_and_float16) {
+  CPUContext dev_ctx;
+  std::vector<float> row = {0.1f, 0.45f, 0.05f, 0.4f};
+  const int64_t batch_size = 512;
+  TopPSamplingCPUParams params;
+  params.batch_size = batch_size;
+  params.vocab_size = row.size();
+  params.seed = 11;
+  std::vector<phi::dtype::float16> x;
+  for (int64_t i = 0; i < batch_size; ++i) {
+    for (float v : row) {
+      x.emplace_back(v);
+    }
+  }
+  // top_p 1 samples the whole row, the threshold drops 0.1 and 0.05
+  std::vector<phi::dtype::float16> top_ps(batch_size,
+                                          phi::dtype::float16(1.f));
+  std::vector<phi::dtype::float16> thresholds(batch_size,
+                                              phi::dtype::float16(0.2f));
+  std::vector<phi::dtype::float16> out(batch_size);
+  std::vector<int64_t> ids(batch_size);
+  funcs::TopPSamplingCPU(dev_ctx,
+                         params,
+                         x.data(),
+                         top_ps.data(),
+                         thresholds.data(),
+                         out.data(),
+                         ids.data());
+  int64_t count_1 = 0;
+  for (int64_t i = 0; i < batch_size; ++i) {
+    ASSERT_TRUE(ids[i] == 1 || ids[i] == 3) << ids[i];
+    EXPECT_NEAR(static_cast<float>(out[i]), row[ids[i]], 1e-3);
+    count_1 += ids[i] == 1;
+  }
+  EXPECT_GT(count_1, batch_size / 4);
+  EXPECT_LT(count_1, batch_size * 3 / 4);
+
+  // a threshold above every token keeps the most probable one
+  std::fill(top_ps.begin(), top_ps.end(), phi::dtype::float16(0.5f));
+  std::fill(thresholds.begin(), thresholds.end(), phi::dtype::float16(0.9f));
+  funcs::TopPSamplingCPU(dev_ctx,
+                         params,
+                         x.data(),
+                         top_ps.data(),
+                         thresholds.data(),
+                         out.data(),
+                         ids.data());
+  for (int64_t i = 0; i < batch_size; ++i) {
+    EXPECT_EQ(ids[i], 1);
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,268 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/backends/cpu/cpu_info.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm_isa.h"
+#include "paddle/phi/kernels/impl/weight_quantize_kernel_impl.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+std::vector<float> RandomFloats(int64_t numel, float bound, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-bound, bound);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+// Quantizes w [k, n] like weight_quantize with arch = 0.
+void QuantizeForCPU(const std::vector<float>& w,
+                    int64_t k,
+                    int64_t n,
+                    int bits,
+                    int group_size,
+                    std::vector<int8_t>* weight,
+                    std::vector<float>* scale) {
+  float bound = bits == 8 ? 127.f : 7.f;
+  int64_t bytes = n * bits / 8;
+  std::vector<int8_t> rows(k * bytes);
+  if (group_size == -1) {
+    scale->resize(n);
+    per_channel_scale(scale->data(), w.data(), k, n, bound);
+    if (bits == 8) {
+      per_channel_quant<float, 8>(rows.data(), w.data(), scale->data(), k, n);
+    } else {
+      per_channel_quant<float, 4>(rows.data(), w.data(), scale->data(), k, n);
+    }
+  } else {
+    scale->resize((k + group_size - 1) / group_size * n);
+    group_wise_scale(scale->data(), w.data(), k, n, bound, group_size);
+    if (bits == 8) {
+      group_wise_quant<float, 8>(
+          rows.data(), w.data(), scale->data(), k, n, group_size);
+    } else {
+      group_wise_quant<float, 4>(
+          rows.data(), w.data(), scale->data(), k, n, group_size);
+    }
+  }
+  weight->resize(k * bytes);
+  for (int64_t i = 0; i < k; ++i) {
+    for (int64_t j = 0; j < bytes; ++j) {
+      (*weight)[j * k + i] = rows[i * bytes + j];
+    }
+  }
+}
+
+// The relative L2 error of y to ref.
+double RelativeError(const std::vector<float>& y,
+                     const std::vector<float>& ref) {
+  double diff = 0;
+  double norm = 0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    diff += (y[i] - ref[i]) * (y[i] - ref[i]);
+    norm += ref[i] * ref[i];
+  }
+  return std::sqrt(diff / norm);
+}
+
+// y[m, n] = x[m, k] * w[k, n] + bias
+std::vector<float> MatMul(const std::vector<float>& x,
+                          const std::vector<float>& w,
+                          const std::vector<float>& bias,
+                          int64_t m,
+                          int64_t n,
+                          int64_t k) {
+  std::vector<float> y(m * n);
+  for (int64_t r = 0; r < m; ++r) {
+    for (int64_t c = 0; c < n; ++c) {
+      double sum = bias[c];
+      for (int64_t i = 0; i < k; ++i) {
+        sum += static_cast<double>(x[r * k + i]) * w[i * n + c];
+      }
+      y[r * n + c] = static_cast<float>(sum);
+    }
+  }
+  return y;
+}
+
+}  // namespace
+
+TEST(WeightOnlyGemm, micro_kernels) {
+  namespace cpu = phi::backends::cpu;
+  using funcs::detail::WeightOnlyMicroKernels;
+  const WeightOnlyMicroKernels* ref =
+      funcs::detail::GetWeightOnlyRefMicroKernels();
+  std::vector<const WeightOnlyMicroKernels*> candidates;
+  if (cpu::MayIUse(cpu::avx2)) {
+    candidates.push_back(funcs::detail::GetWeightOnlyAVX2MicroKernels());
+  }
+  if (cpu::MayIUse(cpu::avx512_core)) {
+    candidates.push_back(funcs::detail::GetWeightOnlyAVX512MicroKernels(
+        cpu::MayIUse(cpu::avx512_core_vnni)));
+  }
+
+  const int64_t k = 211;
+  std::vector<float> x = RandomFloats(4 * k, 1.f, 1);
+  std::vector<int8_t> w(k);
+  std::vector<int8_t> a(4 * k);
+  // the two scales of each of the 4 groups
+  std::vector<float> scale = RandomFloats(8, 1.f, 3);
+  std::mt19937 rng(2);
+  std::uniform_int_distribution<int> dist(-127, 127);
+  for (auto& v : w) {
+    v = static_cast<int8_t>(dist(rng));
+  }
+  for (auto& v : a) {
+    v = static_cast<int8_t>(dist(rng));
+  }
+  for (const WeightOnlyMicroKernels* kernels : candidates) {
+    if (kernels == nullptr) {
+      continue;
+    }
+    for (int rows = 1; rows <= funcs::detail::kWeightOnlyMaxRows; ++rows) {
+      float expect[8], out[8];
+      int32_t expect_int[4], out_int[4];
+      // per channel, then group-wise with a ragged last group
+      for (int64_t group : {k, static_cast<int64_t>(64)}) {
+        const float* s = scale.data();
+        ref->dot_s8(x.data(), k, rows, w.data(), k, s, 2, group, expect);
+        kernels->dot_s8(x.data(), k, rows, w.data(), k, s, 2, group, out);
+        for (int r = 0; r < rows; ++r) {
+          EXPECT_NEAR(out[r], expect[r], 1e-3) << kernels->name;
+        }
+        ref->dot_s4x2(x.data(), k, rows, w.data(), k, s, 2, group, expect);
+        kernels->dot_s4x2(x.data(), k, rows, w.data(), k, s, 2, group, out);
+        for (int r = 0; r < 2 * rows; ++r) {
+          EXPECT_NEAR(out[r], expect[r], 1e-3) << kernels->name;
+        }
+      }
+      ref->dot_s8s8(a.data(), k, rows, w.data(), k, expect_int);
+      kernels->dot_s8s8(a.data(), k, rows, w.data(), k, out_int);
+      for (int r = 0; r < rows; ++r) {
+        EXPECT_EQ(out_int[r], expect_int[r]) << kernels->name;
+      }
+    }
+  }
+}
+
+TEST(WeightOnlyGemm, accuracy) {
+  CPUContext dev_ctx;
+  const int64_t n = 48;
+  const int64_t k = 192;
+  std::vector<float> w = RandomFloats(k * n, 0.5f, 3);
+  std::vector<float> bias = RandomFloats(n, 1.f, 4);
+  for (int bits : {8, 4}) {
+    for (int group_size : {-1, 64}) {
+      std::vector<int8_t> weight;
+      std::vector<float> scale;
+      QuantizeForCPU(w, k, n, bits, group_size, &weight, &scale);
+
+      std::vector<float> dequant(k * n);
+      funcs::WeightOnlyDequantize(dev_ctx,
+                                  weight.data(),
+                                  scale.data(),
+                                  dequant.data(),
+                                  n,
+                                  k,
+                                  bits,
+                                  group_size);
+      // the quantization error is at most half a step
+      float step = 0.5f / (bits == 8 ? 127.f : 7.f);
+      for (int64_t i = 0; i < k * n; ++i) {
+        ASSERT_NEAR(dequant[i], w[i], step * 0.5f + 1e-6f) << i;
+      }
+
+      for (int64_t m : {1, 3, 4, 9, 33}) {
+        std::vector<float> x = RandomFloats(m * k, 1.f, static_cast<int>(m));
+        std::vector<float> y(m * n);
+        funcs::WeightOnlyGemm(dev_ctx,
+                              x.data(),
+                              weight.data(),
+                              scale.data(),
+                              bias.data(),
+                              y.data(),
+                              m,
+                              n,
+                              k,
+                              bits,
+                              group_size);
+        EXPECT_LT(RelativeError(y, MatMul(x, dequant, bias, m, n, k)), 1e-5)
+            << "bits " << bits << " group_size " << group_size << " m " << m;
+        EXPECT_LT(RelativeError(y, MatMul(x, w, bias, m, n, k)),
+                  bits == 8 ? 0.01 : 0.1)
+            << "bits " << bits << " group_size " << group_size << " m " << m;
+      }
+    }
+  }
+}
+
+TEST(LLMInt8Gemm, accuracy) {
+  CPUContext dev_ctx;
+  const int64_t m = 6;
+  const int64_t n = 32;
+  const int64_t k = 128;
+  const float threshold = 6.f;
+  std::vector<float> w = RandomFloats(k * n, 0.5f, 5);
+  std::vector<float> bias = RandomFloats(n, 1.f, 6);
+  std::vector<float> x = RandomFloats(m * k, 2.f, 7);
+  // two outlier columns
+  x[2 * k + 7] = 40.f;
+  x[5 * k + 100] = -25.f;
+
+  std::vector<int8_t> weight;
+  std::vector<float> scale;
+  QuantizeForCPU(w, k, n, 8, -1, &weight, &scale);
+  std::vector<float> y(m * n);
+  funcs::LLMInt8Gemm(dev_ctx,
+                     x.data(),
+                     weight.data(),
+                     scale.data(),
+                     bias.data(),
+                     y.data(),
+                     m,
+                     n,
+                     k,
+                     threshold);
+  EXPECT_LT(RelativeError(y, MatMul(x, w, bias, m, n, k)), 0.02);
+
+  // without the outlier columns in float, the error of the outliers spreads
+  std::vector<float> y_no_outlier(m * n);
+  funcs::LLMInt8Gemm(dev_ctx,
+                     x.data(),
+                     weight.data(),
+                     scale.data(),
+                     bias.data(),
+                     y_no_outlier.data(),
+                     m,
+                     n,
+                     k,
+                     100.f);
+  EXPECT_LT(RelativeError(y, MatMul(x, w, bias, m, n, k)),
+            RelativeError(y_no_outlier, MatMul(x, w, bias, m, n, k)));
+}
+
+}  // namespace tests
+}  // namespace phi
@@ -0,0 +1,269 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "paddle/phi/backends/context_pool.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/common/place.h"
+#include "paddle/phi/core/dense_tensor.h"
+#include "paddle/phi/core/meta_tensor.h"
+#include "paddle/phi/infermeta/binary.h"
+#include "paddle/phi/infermeta/multiary.h"
+#include "paddle/phi/infermeta/unary.h"
+#include "paddle/phi/kernels/llm_int8_linear_kernel.h"
+#include "paddle/phi/kernels/weight_dequantize_kernel.h"
+#include "paddle/phi/kernels/weight_only_linear_kernel.h"
+#include "paddle/phi/kernels/weight_quantize_kernel.h"
+
+namespace phi {
+namespace tests {
+
+namespace {
+
+const CPUContext& GetCPUContext() {
+  auto& pool = phi::DeviceContextPool::Instance();
+  return *static_cast<const CPUContext*>(pool.GetByPlace(phi::CPUPlace()));
+}
+
+DenseTensor MakeTensor(const std::vector<float>& data,
+                       const std::vector<int64_t>& dims) {
+  DenseTensor tensor;
+  tensor.Resize(common::make_ddim(dims));
+  float* ptr = GetCPUContext().template Alloc<float>(&tensor);
+  std::copy(data.begin(), data.end(), ptr);
+  return tensor;
+}
+
+std::vector<float> RandomFloats(int64_t numel, float bound, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-bound, bound);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+// the scale of w[i][j] of the weight [k, n]
+float ScaleOf(const DenseTensor& scale, int64_t i, int64_t j, int group_size) {
+  const float* data = scale.data<float>();
+  if (group_size == -1) {
+    return data[j];
+  }
+  return data[(i / group_size) * scale.dims()[1] + j];
+}
+
+// y[m, n] = x[m, k] * w[k, n] + bias
+std::vector<float> MatMul(const std::vector<float>& x,
+                          const float* w,
+                          const std::vector<float>& bias,
+                          int64_t m,
+                          int64_t n,
+                          int64_t k) {
+  std::vector<float> y(m * n);
+  for (int64_t r = 0; r < m; ++r) {
+    for (int64_t j = 0; j < n; ++j) {
+      double sum = bias[j];
+      for (int64_t i = 0; i < k; ++i) {
+        sum += static_cast<double>(x[r * k + i]) * w[i * n + j];
+      }
+      y[r * n + j] = static_cast<float>(sum);
+    }
+  }
+  return y;
+}
+
+// weight_quantize (arch = 0), weight_dequantize and weight_only_linear of
+// a weight [k, n] against the float matmul
+void CheckWeightOnlyLinear(const std::string& weight_dtype, int group_size) {
+  const auto& dev_ctx = GetCPUContext();
+  const int64_t k = 128;
+  const int64_t n = 32;
+  std::vector<float> w_data = RandomFloats(k * n, 1.f, 1);
+  std::vector<float> bias_data = RandomFloats(n, 1.f, 2);
+  DenseTensor w = MakeTensor(w_data, {k, n});
+  DenseTensor bias = MakeTensor(bias_data, {n});
+  std::string algo = "weight_only_" + weight_dtype;
+
+  DenseTensor weight;
+  DenseTensor scale;
+  MetaTensor meta_weight(&weight);
+  MetaTensor meta_scale(&scale);
+  WeightQuantizeInferMeta(w, algo, 0, group_size, &meta_weight, &meta_scale);
+  WeightQuantizeKernel<float, CPUContext>(
+      dev_ctx, w, algo, 0, group_size, &weight, &scale);
+  ASSERT_EQ(weight.dims(),
+            common::make_ddim({weight_dtype == "int8" ? n : n / 2, k}));
+
+  // the dequantized weight is the closest one on the grid of the scale
+  DenseTensor dequant;
+  MetaTensor meta_dequant(&dequant);
+  WeightDequantizeInferMeta(
+      weight, scale, algo, DataType::FLOAT32, group_size, &meta_dequant);
+  WeightDequantizeKernel<float, CPUContext>(
+      dev_ctx, weight, scale, algo, DataType::FLOAT32, group_size, &dequant);
+  ASSERT_EQ(dequant.dims(), common::make_ddim({k, n}));
+  const float* dw = dequant.data<float>();
+  for (int64_t i = 0; i < k; ++i) {
+    for (int64_t j = 0; j < n; ++j) {
+      float s = ScaleOf(scale, i, j, group_size);
+      ASSERT_LE(std::fabs(dw[i * n + j] - w_data[i * n + j]), 0.5f * s + 1e-6f)
+          << algo << " group_size " << group_size << " at " << i << ", " << j;
+    }
+  }
+
+  // m = 3 takes the fused dequantization, m = 9 the dequantized tiles
+  for (int64_t m : {3, 9}) {
+    std::vector<float> x_data = RandomFloats(m * k, 1.f, 3);
+    DenseTensor x = MakeTensor(x_data, {m, k});
+    DenseTensor out;
+    MetaTensor meta_out(&out);
+    WeightOnlyLinearInferMeta(x,
+                              weight,
+                              bias,
+                              scale,
+                              weight_dtype,
+                              0,
+                              group_size,
+                              &meta_out);
+    WeightOnlyLinearKernel<float, CPUContext>(dev_ctx,
+                                              x,
+                                              weight,
+                                              bias,
+                                              scale,
+                                              weight_dtype,
+                                              0,
+                                              group_size,
+                                              &out);
+    ASSERT_EQ(out.dims(), common::make_ddim({m, n}));
+    const float* y = out.data<float>();
+    std::vector<float> y_dequant = MatMul(x_data, dw, bias_data, m, n, k);
+    std::vector<float> y_float =
+        MatMul(x_data, w_data.data(), bias_data, m, n, k);
+    for (int64_t r = 0; r < m; ++r) {
+      for (int64_t j = 0; j < n; ++j) {
+        // the error of the quantization bounds the one of the matmul
+        float bound = 1e-3f;
+        for (int64_t i = 0; i < k; ++i) {
+          bound += std::fabs(x_data[r * k + i]) * 0.5f *
+                   ScaleOf(scale, i, j, group_size);
+        }
+        EXPECT_NEAR(y[r * n + j], y_dequant[r * n + j], 1e-3f)
+            << algo << " group_size " << group_size << " m " << m;
+        EXPECT_NEAR(y[r * n + j], y_float[r * n + j], bound)
+            << algo << " group_size " << group_size << " m " << m;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(DEV_API, weight_only_linear_int8) {
+  CheckWeightOnlyLinear("int8", -1);
+  CheckWeightOnlyLinear("int8", 64);
+}
+
+TEST(DEV_API, weight_only_linear_int4) {
+  CheckWeightOnlyLinear("int4", -1);
+  CheckWeightOnlyLinear("int4", 128);
+}
+
+TEST(DEV_API, weight_only_linear_gpu_layout) {
+  const auto& dev_ctx = GetCPUContext();
+  DenseTensor x = MakeTensor(RandomFloats(64, 1.f, 1), {1, 64});
+  DenseTensor w = MakeTensor(RandomFloats(64 * 16, 1.f, 2), {64, 16});
+  DenseTensor weight;
+  DenseTensor scale;
+  MetaTensor meta_weight(&weight);
+  MetaTensor meta_scale(&scale);
+  WeightQuantizeInferMeta(
+      w, "weight_only_int8", 0, -1, &meta_weight, &meta_scale);
+  WeightQuantizeKernel<float, CPUContext>(
+      dev_ctx, w, "weight_only_int8", 0, -1, &weight, &scale);
+  // the CPU kernel can't read the layouts of the GPU archs
+  DenseTensor out;
+  ASSERT_ANY_THROW((WeightOnlyLinearKernel<float, CPUContext>(
+      dev_ctx, x, weight, paddle::none, scale, "int8", 80, -1, &out)));
+}
+
+TEST(DEV_API, llm_int8_linear) {
+  const auto& dev_ctx = GetCPUContext();
+  const int64_t k = 128;
+  const int64_t n = 32;
+  const float threshold = 6.f;
+  std::vector<float> w_data = RandomFloats(k * n, 1.f, 1);
+  std::vector<float> bias_data = RandomFloats(n, 1.f, 2);
+  DenseTensor w = MakeTensor(w_data, {k, n});
+  DenseTensor bias = MakeTensor(bias_data, {n});
+
+  DenseTensor weight;
+  DenseTensor scale;
+  MetaTensor meta_weight(&weight);
+  MetaTensor meta_scale(&scale);
+  WeightQuantizeInferMeta(w, "llm.int8", 0, -1, &meta_weight, &meta_scale);
+  WeightQuantizeKernel<float, CPUContext>(
+      dev_ctx, w, "llm.int8", 0, -1, &weight, &scale);
+  ASSERT_EQ(weight.dims(), common::make_ddim({n, k}));
+  const int8_t* q = weight.data<int8_t>();
+  const float* s = scale.data<float>();
+
+  for (int64_t m : {3, 9}) {
+    // columns 5 and 77 of x hold outliers
+    std::vector<float> x_data = RandomFloats(m * k, 1.f, 3);
+    x_data[5] = 20.f;
+    x_data[(m - 1) * k + 77] = -10.f;
+    DenseTensor x = MakeTensor(x_data, {m, k});
+    DenseTensor out;
+    MetaTensor meta_out(&out);
+    LLMInt8LinearInferMeta(x, weight, bias, scale, threshold, &meta_out);
+    LLMInt8LinearKernel<float, CPUContext>(
+        dev_ctx, x, weight, bias, scale, threshold, &out);
+    ASSERT_EQ(out.dims(), common::make_ddim({m, n}));
+    const float* y = out.data<float>();
+    std::vector<float> y_float =
+        MatMul(x_data, w_data.data(), bias_data, m, n, k);
+    for (int64_t r = 0; r < m; ++r) {
+      // x is quantized by the absmax of the row without the outliers
+      float x_range = 0.f;
+      for (int64_t i = 0; i < k; ++i) {
+        float v = std::fabs(x_data[r * k + i]);
+        if (v <= threshold) {
+          x_range = std::max(x_range, v);
+        }
+      }
+      for (int64_t j = 0; j < n; ++j) {
+        float bound = 1e-3f;
+        for (int64_t i = 0; i < k; ++i) {
+          float x_abs = std::fabs(x_data[r * k + i]);
+          bound += x_abs * 0.5f * s[j];
+          if (x_abs <= threshold) {
+            bound += std::fabs(q[j * k + i] * s[j]) * 0.5f * x_range / 127.f;
+          }
+        }
+        EXPECT_NEAR(y[r * n + j], y_float[r * n + j], bound) << "m " << m;
+      }
+    }
+  }
+}
+
+}  // namespace tests
+}  // namespace phi
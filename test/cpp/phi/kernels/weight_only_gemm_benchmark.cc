@@ -0,0 +1,236 @@
+/* Copyright (c) 2024 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cmath>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "paddle/common/flags.h"
+#include "paddle/phi/backends/cpu/cpu_context.h"
+#include "paddle/phi/core/os_info.h"
+#include "paddle/phi/kernels/funcs/blas/blas.h"
+#include "paddle/phi/kernels/funcs/weight_only_gemm.h"
+#include "paddle/phi/kernels/impl/weight_quantize_kernel_impl.h"
+
+PD_DEFINE_int32(burning, 5, "Burning times.");
+PD_DEFINE_int32(repeat, 50, "Repeat times.");
+PD_DEFINE_string(m, "1,4,16,128", "The rows of x to test.");  // NOLINT
+PD_DEFINE_int32(n, 4096, "The output features.");
+PD_DEFINE_int32(k, 4096, "The input features.");
+PD_DEFINE_int32(group_size, 128, "The group size of the group-wise runs.");
+
+namespace {
+
+std::vector<float> RandomFloats(int64_t numel, float bound, int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-bound, bound);
+  std::vector<float> data(numel);
+  for (auto& v : data) {
+    v = dist(rng);
+  }
+  return data;
+}
+
+// The weight [k, n] quantized like weight_quantize with arch = 0.
+struct QuantizedWeight {
+  QuantizedWeight(const std::vector<float>& w,
+                  int64_t k,
+                  int64_t n,
+                  int bits,
+                  int group_size)
+      : bits(bits), group_size(group_size) {
+    float bound = bits == 8 ? 127.f : 7.f;
+    int64_t bytes = n * bits / 8;
+    std::vector<int8_t> rows(k * bytes);
+    if (group_size == -1) {
+      scale.resize(n);
+      phi::per_channel_scale(scale.data(), w.data(), k, n, bound);
+      if (bits == 8) {
+        phi::per_channel_quant<float, 8>(
+            rows.data(), w.data(), scale.data(), k, n);
+      } else {
+        phi::per_channel_quant<float, 4>(
+            rows.data(), w.data(), scale.data(), k, n);
+      }
+    } else {
+      scale.resize((k + group_size - 1) / group_size * n);
+      phi::group_wise_scale(scale.data(), w.data(), k, n, bound, group_size);
+      if (bits == 8) {
+        phi::group_wise_quant<float, 8>(
+            rows.data(), w.data(), scale.data(), k, n, group_size);
+      } else {
+        phi::group_wise_quant<float, 4>(
+            rows.data(), w.data(), scale.data(), k, n, group_size);
+      }
+    }
+    weight.resize(k * bytes);
+    for (int64_t i = 0; i < k; ++i) {
+      for (int64_t j = 0; j < bytes; ++j) {
+        weight[j * k + i] = rows[i * bytes + j];
+      }
+    }
+  }
+
+  int bits;
+  int group_size;
+  std::vector<int8_t> weight;
+  std::vector<float> scale;
+};
+
+// the average time of f in us
+double Bench(const std::function<void()>& f) {
+  for (int i = 0; i < FLAGS_burning; ++i) {
+    f();
+  }
+  double start = static_cast<double>(phi::PosixInNsec()) * 1e-3;
+  for (int i = 0; i < FLAGS_repeat; ++i) {
+    f();
+  }
+  double end = static_cast<double>(phi::PosixInNsec()) * 1e-3;
+  return (end - start) / FLAGS_repeat;
+}
+
+double RelativeError(const std::vector<float>& y,
+                     const std::vector<float>& ref) {
+  double diff = 0;
+  double norm = 0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    diff += (y[i] - ref[i]) * (y[i] - ref[i]);
+    norm += ref[i] * ref[i];
+  }
+  return std::sqrt(diff / norm);
+}
+
+std::vector<int64_t> ParseSizes(const std::string& s) {
+  std::vector<int64_t> sizes;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    sizes.push_back(std::stoll(item));
+  }
+  return sizes;
+}
+
+void BenchShape(const phi::CPUContext& dev_ctx,
+                int64_t m,
+                int64_t n,
+                int64_t k,
+                const std::vector<float>& w_t,
+                const std::vector<QuantizedWeight>& weights) {
+  std::vector<float> x = RandomFloats(m * k, 1.f, static_cast<int>(m));
+  std::vector<float> ref(m * n);
+  std::vector<float> y(m * n);
+  auto blas = phi::funcs::GetBlas<phi::CPUContext, float>(dev_ctx);
+  auto fp32 = [&] {
+    blas.GEMM(false,
+              true,
+              m,
+              n,
+              k,
+              1.f,
+              x.data(),
+              k,
+              w_t.data(),
+              k,
+              0.f,
+              ref.data(),
+              n);
+  };
+  double fp32_us = Bench(fp32);
+  double flops = 2.0 * m * n * k;
+
+  std::ostringstream infos;
+  infos << "m " << m << " n " << n << " k " << k << ": fp32 matmul takes "
+        << fp32_us << " us (" << flops / fp32_us * 1e-3 << " GFLOPS); ";
+  for (const auto& q : weights) {
+    double us = Bench([&] {
+      phi::funcs::WeightOnlyGemm(dev_ctx,
+                                 x.data(),
+                                 q.weight.data(),
+                                 q.scale.data(),
+                                 nullptr,
+                                 y.data(),
+                                 m,
+                                 n,
+                                 k,
+                                 q.bits,
+                                 q.group_size);
+    });
+    infos << "int" << q.bits << (q.group_size > 0 ? " group-wise" : "")
+          << " takes " << us << " us (" << flops / us * 1e-3
+          << " GFLOPS, speedup " << fp32_us / us << ", error "
+          << RelativeError(y, ref) << "); ";
+    if (q.bits == 8 && q.group_size == -1) {
+      double llm_us = Bench([&] {
+        phi::funcs::LLMInt8Gemm(dev_ctx,
+                                x.data(),
+                                q.weight.data(),
+                                q.scale.data(),
+                                nullptr,
+                                y.data(),
+                                m,
+                                n,
+                                k,
+                                6.f);
+      });
+      infos << "llm.int8 takes " << llm_us << " us (speedup "
+            << fp32_us / llm_us << ", error " << RelativeError(y, ref)
+            << "); ";
+    }
+  }
+  LOG(INFO) << infos.str();
+}
+
+}  // namespace
+
+// Benchmarks the throughput and the accuracy of the CPU weight only and
+// llm.int8 matmuls against the fp32 matmul, for the GEMV (decoding) and the
+// GEMM (prefill) shapes.
+// To use this tool, run command: ./weight_only_gemm_benchmark [options...]
+// Options:
+//     --burning: the burning time before count
+//     --repeat: the repeat times
+//     --m: the rows of x, e.g. 1,4,16,128
+//     --n, --k: the shape of the weight
+//     --group_size: the group size of the group-wise runs
+int main(int argc, char* argv[]) {
+  paddle::flags::ParseCommandLineFlags(&argc, &argv);
+  google::InitGoogleLogging(argv[0]);
+  LOG(INFO) << "Burning " << FLAGS_burning << " times, Repeat " << FLAGS_repeat
+            << " times.";
+
+  phi::CPUContext dev_ctx;
+  int64_t n = FLAGS_n;
+  int64_t k = FLAGS_k;
+  std::vector<float> w = RandomFloats(k * n, 0.05f, 0);
+  // the fp32 weight in the layout of the quantized one, [n, k]
+  std::vector<float> w_t(n * k);
+  for (int64_t i = 0; i < k; ++i) {
+    for (int64_t j = 0; j < n; ++j) {
+      w_t[j * k + i] = w[i * n + j];
+    }
+  }
+  std::vector<QuantizedWeight> weights;
+  weights.emplace_back(w, k, n, 8, -1);
+  weights.emplace_back(w, k, n, 8, FLAGS_group_size);
+  weights.emplace_back(w, k, n, 4, -1);
+  weights.emplace_back(w, k, n, 4, FLAGS_group_size);
+  for (int64_t m : ParseSizes(FLAGS_m)) {
+    BenchShape(dev_ctx, m, n, k, w_t, weights);
+  }
+}
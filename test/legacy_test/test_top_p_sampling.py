@@ -153,5 +153,51 @@ class TestTopPAPI(unittest.TestCase):
                 self.run_static(place)
 
 
+class TestTopKTopPSamplingCPU(unittest.TestCase):
+    def setUp(self):
+        self.place = core.CPUPlace()
+        self.logits = np.array(
+            [[1.0, 3.0, 2.5, -1.0], [0.5, -2.0, 4.0, 3.9]], dtype="float32"
+        )
+        self.ps = np.array([0.99, 0.99], dtype="float32")
+
+    def sample(self, **kwargs):
+        with paddle.base.dygraph.guard(self.place):
+            x = paddle.to_tensor(self.logits)
+            ps = paddle.to_tensor(self.ps)
+            if "pre_ids" in kwargs:
+                kwargs["pre_ids"] = paddle.to_tensor(kwargs["pre_ids"])
+            out, ids = paddle.tensor.top_k_top_p_sampling(
+                x, ps, is_logits=True, seed=2024, **kwargs
+            )
+            return out.numpy().flatten(), ids.numpy().flatten()
+
+    def test_top_k(self):
+        out, ids = self.sample(top_k=1)
+        np.testing.assert_array_equal(ids, [1, 2])
+        # the probability under the softmax of the whole row
+        probs = np.exp(self.logits)
+        probs /= probs.sum(axis=-1, keepdims=True)
+        np.testing.assert_allclose(out, [probs[0, 1], probs[1, 2]], rtol=1e-5)
+
+    def test_penalties(self):
+        # the best token of each row is penalized below the second one,
+        # the padding id -1 is ignored
+        pre_ids = np.array([[1, -1], [2, -1]], dtype="int64")
+        _, ids = self.sample(top_k=1, pre_ids=pre_ids, repetition_penalty=2.0)
+        np.testing.assert_array_equal(ids, [2, 3])
+        _, ids = self.sample(top_k=1, pre_ids=pre_ids, presence_penalty=1.0)
+        np.testing.assert_array_equal(ids, [2, 3])
+
+    def test_temperature(self):
+        # a low temperature leaves the best token alone in the nucleus
+        _, ids = self.sample(temperature=0.01)
+        np.testing.assert_array_equal(ids, [1, 2])
+
+    def test_invalid_attrs(self):
+        with self.assertRaises(ValueError):
+            self.sample(temperature=0.0)
+
+
 if __name__ == "__main__":
     unittest.main()